@@ -23,6 +23,7 @@ option(WITH_ASAN "Enable address sanitizer" OFF) # gcc4.8+, clang 3.1+
 
 option(WITH_HARDENING "Enable hardening: Compile-time protection against static sized buffer overflows" OFF)
 option(USE_TELEMETRY "Build with Telemetry" OFF)
+option(USE_VOGL_PROFILER "Build the built-in profiler backend for the Telemetry macros" OFF)
 
 # Unless user specifies BUILD_X64 explicitly, assume native target
 if (BUILD_X64 STREQUAL "")
@@ -80,6 +81,8 @@ set(OPENGL_LIBRARY "GL")
 
 if (USE_TELEMETRY)
   add_definitions("-DUSE_TELEMETRY")
+elseif (USE_VOGL_PROFILER)
+  add_definitions("-DUSE_VOGL_PROFILER")
 endif()
 
 if ("${CMAKE_C_COMPILER_ID}" STREQUAL "Clang")
@@ -302,7 +305,7 @@ function(telemetry_init)
   endif()
 endfunction()
 
-if (USE_TELEMETRY)
+if (USE_TELEMETRY OR USE_VOGL_PROFILER)
   set(TELEMETRY_LIBRARY telemetry)
 else()
   set(TELEMETRY_LIBRARY )
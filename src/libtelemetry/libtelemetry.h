@@ -74,8 +74,108 @@ SO_API_EXPORT int telemetry_get_level();
 
 #else
 
+#if defined( USE_VOGL_PROFILER )
+
+/*
+ * USE_VOGL_PROFILER
+ * Built-in backend (see libtelemetry_profiler.cpp): zones are recorded into per-thread buffers and written
+ * to a Chrome trace event JSON file (.json extension), or a compact binary file, when the level goes back
+ * to -1 or at exit. The level can also be set with the VOGL_TELEMETRY_LEVEL environment variable, and the
+ * file with VOGL_TELEMETRY_FILE.
+ */
+#define SO_API_EXPORT extern "C" __attribute__((visibility ("default")))
+#define SO_GLOBAL_EXPORT extern "C" __attribute__((visibility ("default")))
+
+struct telemetry_context_t;
+typedef telemetry_context_t *HTELEMETRY;
+
+typedef struct telemetry_info_t
+{
+    HTELEMETRY ctx[8];
+} telemetry_ctx_t;
+SO_GLOBAL_EXPORT telemetry_info_t g_tminfo;
+// See the USE_TELEMETRY note above, don't reference g_tminfo directly.
+inline telemetry_info_t& get_tminfo() { return g_tminfo; }
+
+#define TELEMETRY_LEVEL_MIN 0
+#define TELEMETRY_LEVEL_MAX 3
+#define TELEMETRY_LEVEL0 get_tminfo().ctx[0]
+#define TELEMETRY_LEVEL1 get_tminfo().ctx[1]
+#define TELEMETRY_LEVEL2 get_tminfo().ctx[2]
+#define TELEMETRY_LEVEL3 get_tminfo().ctx[3]
+
+SO_API_EXPORT void telemetry_tick();
+
+SO_API_EXPORT void telemetry_set_servername(const char *servername);
+SO_API_EXPORT const char *telemetry_get_servername();
+
+SO_API_EXPORT void telemetry_set_appname(const char *appname);
+SO_API_EXPORT const char *telemetry_get_appname();
+
+// Takes effect immediately, -1 disables recording and writes the output file.
+SO_API_EXPORT void telemetry_set_level(int level);
+SO_API_EXPORT int telemetry_get_level();
+
+// Defaults to <appname>_<pid>_telemetry.json.
+SO_API_EXPORT void telemetry_set_output_filename(const char *filename);
+SO_API_EXPORT const char *telemetry_get_output_filename();
+
+// Writes everything recorded so far to the output file.
+SO_API_EXPORT bool telemetry_flush();
+
+// Only called by the macros below once the context is known to be enabled.
+SO_API_EXPORT bool telemetry_zone_enter(HTELEMETRY ctx, const char *pFmt, ...) __attribute__((format(printf, 2, 3)));
+SO_API_EXPORT void telemetry_zone_leave();
+SO_API_EXPORT void telemetry_message(HTELEMETRY ctx, const char *pFmt, ...) __attribute__((format(printf, 2, 3)));
+SO_API_EXPORT void telemetry_thread_name(HTELEMETRY ctx, const char *pFmt, ...) __attribute__((format(printf, 2, 3)));
+
+class telemetry_scoped_zone
+{
+    bool m_entered;
+
+public:
+    inline telemetry_scoped_zone(bool entered)
+        : m_entered(entered)
+    {
+    }
+
+    inline ~telemetry_scoped_zone()
+    {
+        if (m_entered)
+            telemetry_zone_leave();
+    }
+};
+
+#define TELEMETRY_JOIN_INNER(a, b) a##b
+#define TELEMETRY_JOIN(a, b) TELEMETRY_JOIN_INNER(a, b)
+
+// The context is checked before the arguments are evaluated, so disabled zones are a load and a branch.
+#define tmZone(_ctx, _flags, ...) \
+    telemetry_scoped_zone TELEMETRY_JOIN(tm_zone_, __COUNTER__)((_ctx) && telemetry_zone_enter((_ctx), __VA_ARGS__))
+// The threshold isn't supported, filtered zones are always recorded.
+#define tmZoneFiltered(_ctx, _threshold, _flags, ...) \
+    telemetry_scoped_zone TELEMETRY_JOIN(tm_zone_, __COUNTER__)((_ctx) && telemetry_zone_enter((_ctx), __VA_ARGS__))
+#define tmEnter(_ctx, _flags, ...) \
+    ((_ctx) ? (void)telemetry_zone_enter((_ctx), __VA_ARGS__) : (void)0)
+#define tmLeave(_ctx) \
+    ((_ctx) ? telemetry_zone_leave() : (void)0)
+#define tmMessage(_ctx, _flags, ...) \
+    ((_ctx) ? telemetry_message((_ctx), __VA_ARGS__) : (void)0)
+// Only naming the calling thread (thread id 0) is supported.
+#define tmThreadName(_ctx, _thread_id, ...) \
+    (((_ctx) && !(_thread_id)) ? telemetry_thread_name((_ctx), __VA_ARGS__) : (void)0)
+
+#define TMZF_NONE 0
+#define TMZF_STALL 1
+#define TMZF_IDLE 2
+
+#define tmEnterEx(...)
+#define tmLeaveEx(...)
+
+#else
+
 /* 
- * !USE_TELEMETRY
+ * !USE_TELEMETRY && !USE_VOGL_PROFILER
  */
 #define NTELEMETRY 1
 
@@ -97,6 +197,22 @@ SO_API_EXPORT int telemetry_get_level();
 #define telemetry_set_level(_level)
 #define telemetry_get_level() -1
 
+#define tmEnter(...)
+#define tmEnterEx(...)
+#define tmZone(...)
+#define tmZoneFiltered(...)
+#define tmLeave(...)
+#define tmLeaveEx(...)
+#define tmThreadName(...)
+#define tmMessage(...)
+
+typedef char *HTELEMETRY;
+
+#endif // !USE_VOGL_PROFILER
+
+/*
+ * Everything that isn't recorded by the built-in profiler.
+ */
 #define TMERR_DISABLED 1
 #define TMPRINTF_TOKEN_NONE 0
 
@@ -122,12 +238,6 @@ SO_API_EXPORT int telemetry_get_level();
 #define tmInitializeContext(...) TMERR_DISABLED
 #define tmShutdown(...) TMERR_DISABLED
 
-#define tmEnter(...)
-#define tmEnterEx(...)
-#define tmZone(...) 
-#define tmZoneFiltered(...)
-#define tmLeaveEx(...)
-
 #define tmBeginTimeSpan(...)
 #define tmEndTimeSpan(...)
 
@@ -140,9 +250,7 @@ SO_API_EXPORT int telemetry_get_level();
 #define tmBlob(...)
 #define tmDisjointBlob(...)
 #define tmSetTimelineSectionName(...)
-#define tmThreadName(...)
 #define tmLockName(...)
-#define tmMessage(...)
 #define tmAlloc(...)
 #define tmAllocEx(...)
 
@@ -168,8 +276,6 @@ SO_API_EXPORT int telemetry_get_level();
 #define TM_CONTEXT_LITE(val) ((char*)(val))
 #define TM_CONTEXT_FULL(val) ((char*)(val))
 
-typedef char *HTELEMETRY;
-
 #endif // !USE_TELEMETRY
 
 #endif // _LIBTELEMETRY_H
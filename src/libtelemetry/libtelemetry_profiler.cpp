@@ -0,0 +1,683 @@
+/**************************************************************************
+ *
+ * Copyright 2013-2014 RAD Game Tools and Valve Software
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+//
+// libtelemetry_profiler.cpp
+//
+// Built-in backend for the Telemetry macros (USE_VOGL_PROFILER).
+//
+// Each thread appends its events to its own list of chunks, so recording never takes a lock. A chunk's event
+// count is only bumped after the event is written, which lets telemetry_flush() read the buffers while the
+// threads keep recording. Zone names are interned into a global string table, with a per-thread cache in front
+// of it so the lock is only taken the first time a thread sees a name.
+//
+// The profiler only uses libc, it's linked into the tracer and shouldn't go through (or show up in) the vogl heap,
+// or depend on voglcore being initialized before the first zone.
+//
+// Binary file layout (little endian), written when the output filename doesn't end in .json:
+//   char sig[4] = "VPRF"; uint32 version; uint64 ticks_per_second; uint32 num_strings; uint32 num_threads;
+//   num_strings x { uint32 length; char chars[length]; }
+//   num_threads x { uint32 thread_id; uint32 name_index (0xFFFFFFFF if unnamed); uint64 num_events;
+//                   num_events x { uint64 begin; uint64 end; uint32 name_index; uint32 depth (0xFFFFFFFF for messages); } }
+//
+#include "libtelemetry.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#if !defined( USE_VOGL_PROFILER )
+#error "libtelemetry_profiler.cpp should not be built when USE_VOGL_PROFILER is not defined."
+#endif
+
+telemetry_ctx_t g_tminfo;
+
+// HTELEMETRY only needs to be non-NULL for enabled levels.
+struct telemetry_context_t
+{
+    int m_unused;
+};
+
+static telemetry_context_t g_tm_context;
+
+enum
+{
+    cTMEventsPerChunk = 16384,
+    cTMMaxZoneDepth = 256,
+    cTMStringCacheSize = 1024,
+    cTMMaxNameLen = 256,
+    cTMInvalidIndex = 0xFFFFFFFF
+};
+
+static const uint32_t cTMBinarySig = 0x46525056; // 'VPRF'
+static const uint32_t cTMBinaryVersion = 1;
+
+// Events stop being recorded past this much memory, across all threads.
+static const uint64_t g_tm_max_event_bytes = 1024ULL * 1024ULL * 1024ULL;
+
+#pragma pack(push, 1)
+struct telemetry_event_t
+{
+    uint64_t m_begin;
+    uint64_t m_end;
+    uint32_t m_name;
+    uint32_t m_depth;
+};
+#pragma pack(pop)
+
+struct telemetry_chunk_t
+{
+    telemetry_chunk_t *volatile m_pNext;
+    volatile uint32_t m_count;
+    telemetry_event_t m_events[cTMEventsPerChunk];
+};
+
+struct telemetry_string_cache_entry_t
+{
+    uint32_t m_hash;
+    uint32_t m_index;
+    const char *m_pStr;
+};
+
+struct telemetry_thread_t
+{
+    telemetry_thread_t *m_pNext;
+    uint32_t m_thread_id;
+    volatile uint32_t m_name;
+
+    telemetry_chunk_t *volatile m_pFirst_chunk;
+    telemetry_chunk_t *m_pCur_chunk;
+
+    uint32_t m_depth;
+    uint64_t m_zone_begin[cTMMaxZoneDepth];
+    uint32_t m_zone_name[cTMMaxZoneDepth];
+
+    telemetry_string_cache_entry_t m_string_cache[cTMStringCacheSize];
+};
+
+static struct
+{
+    int level;
+    char servername[256];
+    char appname[256];
+    char filename[1024];
+
+    // Threads are only ever added, at the head, and are never freed.
+    telemetry_thread_t *volatile pThreads;
+
+    // Interned zone names, protected by mutex. The strings themselves never move.
+    pthread_mutex_t mutex;
+    char **pStrings;
+    uint32_t num_strings;
+    uint32_t max_strings;
+    uint32_t *pString_hash_table;
+    uint32_t string_hash_table_size;
+
+    volatile uint64_t total_event_bytes;
+    volatile uint32_t dropped_events;
+
+    uint64_t base_time;
+} g_tmdata = { -1, { 0 }, { 0 }, { 0 }, NULL, PTHREAD_MUTEX_INITIALIZER, NULL, 0, 0, NULL, 0, 0, 0, 0 };
+
+static __thread telemetry_thread_t *g_pTM_thread;
+
+static inline uint64_t telemetry_get_time()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline uint32_t telemetry_hash_string(const char *pStr)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261U;
+    while (*pStr)
+        hash = (hash ^ static_cast<uint8_t>(*pStr++)) * 16777619U;
+    return hash;
+}
+
+static telemetry_thread_t *telemetry_get_thread()
+{
+    telemetry_thread_t *pThread = g_pTM_thread;
+    if (pThread)
+        return pThread;
+
+    pThread = static_cast<telemetry_thread_t *>(calloc(1, sizeof(telemetry_thread_t)));
+    if (!pThread)
+        return NULL;
+
+    pThread->m_thread_id = static_cast<uint32_t>(syscall(SYS_gettid));
+    pThread->m_name = cTMInvalidIndex;
+
+    telemetry_thread_t *pHead;
+    do
+    {
+        pHead = g_tmdata.pThreads;
+        pThread->m_pNext = pHead;
+    } while (__sync_val_compare_and_swap(&g_tmdata.pThreads, pHead, pThread) != pHead);
+
+    g_pTM_thread = pThread;
+    return pThread;
+}
+
+// Caller holds g_tmdata.mutex.
+static bool telemetry_grow_string_table()
+{
+    uint32_t new_max_strings = g_tmdata.max_strings ? (g_tmdata.max_strings * 2) : 1024;
+    char **pNew_strings = static_cast<char **>(realloc(g_tmdata.pStrings, new_max_strings * sizeof(char *)));
+    if (!pNew_strings)
+        return false;
+    g_tmdata.pStrings = pNew_strings;
+    g_tmdata.max_strings = new_max_strings;
+
+    // Open addressing, kept at most half full.
+    uint32_t new_table_size = new_max_strings * 2;
+    uint32_t *pNew_table = static_cast<uint32_t *>(malloc(new_table_size * sizeof(uint32_t)));
+    if (!pNew_table)
+        return false;
+    memset(pNew_table, 0xFF, new_table_size * sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < g_tmdata.num_strings; i++)
+    {
+        uint32_t slot = telemetry_hash_string(g_tmdata.pStrings[i]) & (new_table_size - 1);
+        while (pNew_table[slot] != cTMInvalidIndex)
+            slot = (slot + 1) & (new_table_size - 1);
+        pNew_table[slot] = i;
+    }
+
+    free(g_tmdata.pString_hash_table);
+    g_tmdata.pString_hash_table = pNew_table;
+    g_tmdata.string_hash_table_size = new_table_size;
+    return true;
+}
+
+static uint32_t telemetry_intern_string(telemetry_thread_t *pThread, const char *pStr)
+{
+    uint32_t hash = telemetry_hash_string(pStr);
+
+    telemetry_string_cache_entry_t &entry = pThread->m_string_cache[hash & (cTMStringCacheSize - 1)];
+    if ((entry.m_pStr) && (entry.m_hash == hash) && (!strcmp(entry.m_pStr, pStr)))
+        return entry.m_index;
+
+    pthread_mutex_lock(&g_tmdata.mutex);
+
+    uint32_t index = cTMInvalidIndex;
+    if (g_tmdata.string_hash_table_size)
+    {
+        uint32_t slot = hash & (g_tmdata.string_hash_table_size - 1);
+        while (g_tmdata.pString_hash_table[slot] != cTMInvalidIndex)
+        {
+            if (!strcmp(g_tmdata.pStrings[g_tmdata.pString_hash_table[slot]], pStr))
+            {
+                index = g_tmdata.pString_hash_table[slot];
+                break;
+            }
+            slot = (slot + 1) & (g_tmdata.string_hash_table_size - 1);
+        }
+    }
+
+    if (index == cTMInvalidIndex)
+    {
+        char *pCopy = strdup(pStr);
+        if ((pCopy) && ((g_tmdata.num_strings < g_tmdata.max_strings) || (telemetry_grow_string_table())))
+        {
+            index = g_tmdata.num_strings++;
+            g_tmdata.pStrings[index] = pCopy;
+
+            uint32_t slot = hash & (g_tmdata.string_hash_table_size - 1);
+            while (g_tmdata.pString_hash_table[slot] != cTMInvalidIndex)
+                slot = (slot + 1) & (g_tmdata.string_hash_table_size - 1);
+            g_tmdata.pString_hash_table[slot] = index;
+        }
+        else
+        {
+            free(pCopy);
+        }
+    }
+
+    if (index != cTMInvalidIndex)
+    {
+        entry.m_hash = hash;
+        entry.m_index = index;
+        entry.m_pStr = g_tmdata.pStrings[index];
+    }
+
+    pthread_mutex_unlock(&g_tmdata.mutex);
+
+    return index;
+}
+
+static uint32_t telemetry_intern_formatted(telemetry_thread_t *pThread, const char *pFmt, va_list args)
+{
+    // Most zone names are literals, only format if there's something to format.
+    if (!strchr(pFmt, '%'))
+        return telemetry_intern_string(pThread, pFmt);
+
+    // VOGL_FUNC_TRACER passes the function name through "%s".
+    if ((pFmt[0] == '%') && (pFmt[1] == 's') && (!pFmt[2]))
+    {
+        const char *pStr = va_arg(args, const char *);
+        return telemetry_intern_string(pThread, pStr ? pStr : "(null)");
+    }
+
+    char buf[cTMMaxNameLen];
+    vsnprintf(buf, sizeof(buf), pFmt, args);
+    buf[sizeof(buf) - 1] = '\0';
+
+    return telemetry_intern_string(pThread, buf);
+}
+
+static void telemetry_add_event(telemetry_thread_t *pThread, uint64_t begin, uint64_t end, uint32_t name, uint32_t depth)
+{
+    telemetry_chunk_t *pChunk = pThread->m_pCur_chunk;
+    if ((!pChunk) || (pChunk->m_count == cTMEventsPerChunk))
+    {
+        if (__sync_add_and_fetch(&g_tmdata.total_event_bytes, sizeof(telemetry_chunk_t)) > g_tm_max_event_bytes)
+        {
+            __sync_sub_and_fetch(&g_tmdata.total_event_bytes, sizeof(telemetry_chunk_t));
+            __sync_add_and_fetch(&g_tmdata.dropped_events, 1);
+            return;
+        }
+
+        telemetry_chunk_t *pNew_chunk = static_cast<telemetry_chunk_t *>(malloc(sizeof(telemetry_chunk_t)));
+        if (!pNew_chunk)
+        {
+            __sync_add_and_fetch(&g_tmdata.dropped_events, 1);
+            return;
+        }
+
+        pNew_chunk->m_pNext = NULL;
+        pNew_chunk->m_count = 0;
+
+        // Publish the chunk, the flush may be walking the list.
+        __sync_synchronize();
+        if (pChunk)
+            pChunk->m_pNext = pNew_chunk;
+        else
+            pThread->m_pFirst_chunk = pNew_chunk;
+
+        pThread->m_pCur_chunk = pChunk = pNew_chunk;
+    }
+
+    telemetry_event_t &event = pChunk->m_events[pChunk->m_count];
+    event.m_begin = begin - g_tmdata.base_time;
+    event.m_end = end - g_tmdata.base_time;
+    event.m_name = name;
+    event.m_depth = depth;
+
+    // The event must be visible before the count.
+    __sync_synchronize();
+    pChunk->m_count++;
+}
+
+SO_API_EXPORT bool
+telemetry_zone_enter(HTELEMETRY ctx, const char *pFmt, ...)
+{
+    (void)ctx;
+
+    telemetry_thread_t *pThread = telemetry_get_thread();
+    if (!pThread)
+        return false;
+
+    if (pThread->m_depth < cTMMaxZoneDepth)
+    {
+        va_list args;
+        va_start(args, pFmt);
+        pThread->m_zone_name[pThread->m_depth] = telemetry_intern_formatted(pThread, pFmt, args);
+        va_end(args);
+
+        // Take the time last so the name lookup isn't part of the zone.
+        pThread->m_zone_begin[pThread->m_depth] = telemetry_get_time();
+    }
+
+    // Zones past the max depth aren't recorded, but still have to be balanced.
+    pThread->m_depth++;
+    return true;
+}
+
+SO_API_EXPORT void
+telemetry_zone_leave()
+{
+    uint64_t end = telemetry_get_time();
+
+    telemetry_thread_t *pThread = g_pTM_thread;
+    if ((!pThread) || (!pThread->m_depth))
+        return;
+
+    uint32_t depth = --pThread->m_depth;
+    if ((depth < cTMMaxZoneDepth) && (pThread->m_zone_name[depth] != cTMInvalidIndex))
+        telemetry_add_event(pThread, pThread->m_zone_begin[depth], end, pThread->m_zone_name[depth], depth);
+}
+
+SO_API_EXPORT void
+telemetry_message(HTELEMETRY ctx, const char *pFmt, ...)
+{
+    (void)ctx;
+
+    telemetry_thread_t *pThread = telemetry_get_thread();
+    if (!pThread)
+        return;
+
+    va_list args;
+    va_start(args, pFmt);
+    uint32_t name = telemetry_intern_formatted(pThread, pFmt, args);
+    va_end(args);
+
+    if (name != cTMInvalidIndex)
+    {
+        uint64_t time = telemetry_get_time();
+        telemetry_add_event(pThread, time, time, name, cTMInvalidIndex);
+    }
+}
+
+SO_API_EXPORT void
+telemetry_thread_name(HTELEMETRY ctx, const char *pFmt, ...)
+{
+    (void)ctx;
+
+    telemetry_thread_t *pThread = telemetry_get_thread();
+    if (!pThread)
+        return;
+
+    va_list args;
+    va_start(args, pFmt);
+    pThread->m_name = telemetry_intern_formatted(pThread, pFmt, args);
+    va_end(args);
+}
+
+static void
+telemetry_write_json_string(FILE *pFile, const char *pStr)
+{
+    fputc('"', pFile);
+    for (; *pStr; pStr++)
+    {
+        uint8_t c = static_cast<uint8_t>(*pStr);
+        if ((c == '"') || (c == '\\'))
+            fprintf(pFile, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(pFile, "\\u%04x", c);
+        else
+            fputc(c, pFile);
+    }
+    fputc('"', pFile);
+}
+
+// Caller holds g_tmdata.mutex, so the string table doesn't change while writing.
+static bool
+telemetry_write_json(FILE *pFile)
+{
+    uint32_t pid = static_cast<uint32_t>(getpid());
+
+    fprintf(pFile, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(pFile, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":0,\"args\":{\"name\":", pid);
+    telemetry_write_json_string(pFile, telemetry_get_appname());
+    fprintf(pFile, "}}");
+
+    for (telemetry_thread_t *pThread = g_tmdata.pThreads; pThread; pThread = pThread->m_pNext)
+    {
+        uint32_t thread_name = pThread->m_name;
+        if (thread_name < g_tmdata.num_strings)
+        {
+            fprintf(pFile, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":", pid, pThread->m_thread_id);
+            telemetry_write_json_string(pFile, g_tmdata.pStrings[thread_name]);
+            fprintf(pFile, "}}");
+        }
+
+        for (telemetry_chunk_t *pChunk = pThread->m_pFirst_chunk; pChunk; pChunk = pChunk->m_pNext)
+        {
+            uint32_t count = pChunk->m_count;
+            __sync_synchronize();
+
+            for (uint32_t i = 0; i < count; i++)
+            {
+                const telemetry_event_t &event = pChunk->m_events[i];
+                if (event.m_name >= g_tmdata.num_strings)
+                    continue;
+
+                fprintf(pFile, ",\n{\"name\":");
+                telemetry_write_json_string(pFile, g_tmdata.pStrings[event.m_name]);
+
+                // Chrome wants microseconds
+                if (event.m_depth == cTMInvalidIndex)
+                    fprintf(pFile, ",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":%u,\"tid\":%u}",
+                            event.m_begin / 1000.0, pid, pThread->m_thread_id);
+                else
+                    fprintf(pFile, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%u,\"tid\":%u}",
+                            event.m_begin / 1000.0, (event.m_end - event.m_begin) / 1000.0, pid, pThread->m_thread_id);
+            }
+        }
+    }
+
+    fprintf(pFile, "\n]}\n");
+    return !ferror(pFile);
+}
+
+// Caller holds g_tmdata.mutex.
+static bool
+telemetry_write_binary(FILE *pFile)
+{
+    uint32_t num_threads = 0;
+    for (telemetry_thread_t *pThread = g_tmdata.pThreads; pThread; pThread = pThread->m_pNext)
+        num_threads++;
+
+    uint64_t ticks_per_second = 1000000000ULL;
+    fwrite(&cTMBinarySig, sizeof(cTMBinarySig), 1, pFile);
+    fwrite(&cTMBinaryVersion, sizeof(cTMBinaryVersion), 1, pFile);
+    fwrite(&ticks_per_second, sizeof(ticks_per_second), 1, pFile);
+    fwrite(&g_tmdata.num_strings, sizeof(g_tmdata.num_strings), 1, pFile);
+    fwrite(&num_threads, sizeof(num_threads), 1, pFile);
+
+    for (uint32_t i = 0; i < g_tmdata.num_strings; i++)
+    {
+        uint32_t len = static_cast<uint32_t>(strlen(g_tmdata.pStrings[i]));
+        fwrite(&len, sizeof(len), 1, pFile);
+        fwrite(g_tmdata.pStrings[i], 1, len, pFile);
+    }
+
+    for (telemetry_thread_t *pThread = g_tmdata.pThreads; pThread; pThread = pThread->m_pNext)
+    {
+        // Snapshot the counts first, the thread may still be adding events.
+        uint64_t num_events = 0;
+        uint32_t num_chunks = 0;
+        for (telemetry_chunk_t *pChunk = pThread->m_pFirst_chunk; pChunk; pChunk = pChunk->m_pNext)
+            num_chunks++;
+
+        uint32_t *pCounts = static_cast<uint32_t *>(malloc((num_chunks + 1) * sizeof(uint32_t)));
+        if (!pCounts)
+            return false;
+
+        uint32_t chunk_index = 0;
+        for (telemetry_chunk_t *pChunk = pThread->m_pFirst_chunk; pChunk && (chunk_index < num_chunks); pChunk = pChunk->m_pNext)
+        {
+            pCounts[chunk_index] = pChunk->m_count;
+            num_events += pCounts[chunk_index++];
+        }
+        __sync_synchronize();
+
+        uint32_t thread_name = pThread->m_name;
+        fwrite(&pThread->m_thread_id, sizeof(pThread->m_thread_id), 1, pFile);
+        fwrite(&thread_name, sizeof(thread_name), 1, pFile);
+        fwrite(&num_events, sizeof(num_events), 1, pFile);
+
+        chunk_index = 0;
+        for (telemetry_chunk_t *pChunk = pThread->m_pFirst_chunk; pChunk && (chunk_index < num_chunks); pChunk = pChunk->m_pNext)
+            fwrite(pChunk->m_events, sizeof(telemetry_event_t), pCounts[chunk_index++], pFile);
+
+        free(pCounts);
+    }
+
+    return !ferror(pFile);
+}
+
+SO_API_EXPORT bool
+telemetry_flush()
+{
+    const char *pFilename = telemetry_get_output_filename();
+
+    pthread_mutex_lock(&g_tmdata.mutex);
+
+    bool success = false;
+    FILE *pFile = fopen(pFilename, "wb");
+    if (pFile)
+    {
+        size_t len = strlen(pFilename);
+        if ((len >= 5) && (!strcasecmp(pFilename + len - 5, ".json")))
+            success = telemetry_write_json(pFile);
+        else
+            success = telemetry_write_binary(pFile);
+
+        if (fclose(pFile) != 0)
+            success = false;
+    }
+
+    pthread_mutex_unlock(&g_tmdata.mutex);
+
+    if (!success)
+        fprintf(stderr, "telemetry: Failed writing \"%s\"\n", pFilename);
+    else if (g_tmdata.dropped_events)
+        fprintf(stderr, "telemetry: Wrote \"%s\", %u events were dropped\n", pFilename, g_tmdata.dropped_events);
+
+    return success;
+}
+
+class CTelemetryProfiler
+{
+public:
+    CTelemetryProfiler()
+    {
+        g_tmdata.base_time = telemetry_get_time();
+
+        // The tracer has no command line, so the level and file can also come from the environment.
+        const char *pFilename = getenv("VOGL_TELEMETRY_FILE");
+        if (pFilename)
+            telemetry_set_output_filename(pFilename);
+
+        const char *pLevel = getenv("VOGL_TELEMETRY_LEVEL");
+        if (pLevel)
+            telemetry_set_level(atoi(pLevel));
+    }
+
+    ~CTelemetryProfiler()
+    {
+        telemetry_set_level(-1);
+    }
+} g_TelemetryProfiler;
+
+SO_API_EXPORT void
+telemetry_tick()
+{
+    // Marks frame boundaries, levels are applied right away by telemetry_set_level().
+    if (get_tminfo().ctx[0])
+        telemetry_message(get_tminfo().ctx[0], "tick");
+}
+
+SO_API_EXPORT const char *
+telemetry_get_servername()
+{
+    if (!g_tmdata.servername[0])
+        return "localhost";
+    return g_tmdata.servername;
+}
+
+SO_API_EXPORT void
+telemetry_set_servername(const char *servername)
+{
+    // Nothing to connect to, only kept for compatibility with the Telemetry runtime.
+    if (servername)
+        strncpy(g_tmdata.servername, servername, sizeof(g_tmdata.servername) - 1);
+    else
+        g_tmdata.servername[0] = 0;
+}
+
+SO_API_EXPORT const char *
+telemetry_get_appname()
+{
+    if ((!g_tmdata.appname[0]) && (program_invocation_short_name))
+        strncpy(g_tmdata.appname, program_invocation_short_name, sizeof(g_tmdata.appname) - 1);
+    if (!g_tmdata.appname[0])
+        return "AppName";
+    return g_tmdata.appname;
+}
+
+SO_API_EXPORT void
+telemetry_set_appname(const char *appname)
+{
+    if (appname)
+        strncpy(g_tmdata.appname, appname, sizeof(g_tmdata.appname) - 1);
+    else
+        g_tmdata.appname[0] = 0;
+}
+
+SO_API_EXPORT const char *
+telemetry_get_output_filename()
+{
+    if (!g_tmdata.filename[0])
+        snprintf(g_tmdata.filename, sizeof(g_tmdata.filename), "%s_%u_telemetry.json", telemetry_get_appname(), static_cast<uint32_t>(getpid()));
+    return g_tmdata.filename;
+}
+
+SO_API_EXPORT void
+telemetry_set_output_filename(const char *filename)
+{
+    if (filename)
+        strncpy(g_tmdata.filename, filename, sizeof(g_tmdata.filename) - 1);
+    else
+        g_tmdata.filename[0] = 0;
+}
+
+SO_API_EXPORT int
+telemetry_get_level()
+{
+    return g_tmdata.level;
+}
+
+SO_API_EXPORT void
+telemetry_set_level(int level)
+{
+    static const int max_levels = (int)(sizeof(get_tminfo().ctx) / sizeof(get_tminfo().ctx[0]));
+    if (level >= max_levels)
+        level = max_levels - 1;
+    if (level < -1)
+        level = -1;
+
+    int prev_level = g_tmdata.level;
+    g_tmdata.level = level;
+
+    for (int i = 0; i < max_levels; i++)
+        get_tminfo().ctx[i] = (i <= level) ? &g_tm_context : NULL;
+
+    // Write out what was recorded when recording stops.
+    if ((level == -1) && (prev_level != -1))
+        telemetry_flush();
+}
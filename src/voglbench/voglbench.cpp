@@ -74,12 +74,19 @@ static command_line_param_desc g_command_line_param_descs[] =
         { "lock_window_dimensions", 0, false, "Replay: Don't automatically change window's dimensions during replay" },
         { "endless", 0, false, "Replay: Loop replay endlessly instead of exiting" },
         { "force_debug_context", 0, false, "Replay: Force GL debug contexts" },
+        { "gl_debug_log", 0, false, "Dump GL prolog/epilog messages to stdout (very slow - helpful to narrow down driver crashes)" },
 #ifdef USE_TELEMETRY
         { "telemetry_level", 1, false, "Set Telemetry level." },
+#elif defined(USE_VOGL_PROFILER)
+        { "telemetry_level", 1, false, "Record profiler zones up to this level (0-3), written out at exit" },
+        { "telemetry_file", 1, false, "Profiler output file, Chrome trace event JSON if it ends in .json, binary otherwise" },
 #endif
         { "loop_frame", 1, false, "Replay: loop mode's start frame" },
         { "loop_len", 1, false, "Replay: loop mode's loop length" },
         { "loop_count", 1, false, "Replay: loop mode's loop count" },
+        { "loop_full_restore", 0, false, "Replay: loop mode applies the full snapshot at each loop start, instead of only restoring what the loop touched" },
+        { "loop_from_trace", 0, false, "Replay: loop mode reads the loop's frames from the trace on each pass, instead of decoding them once up front" },
+        { "prefetch_frames", 1, false, "Replay: read and decode up to this many frames ahead of the replayer on a helper thread (binary traces only, default is 4, 0 disables)" },
         { "logfile", 1, false, "Create logfile" },
         { "logfile_append", 1, false, "Append output to logfile" },
         { "help", 0, false, "Display this help" },
@@ -268,6 +275,14 @@ static bool voglbench_init(int argc, char *argv[])
                                                                  TELEMETRY_LEVEL_MIN + 1, TELEMETRY_LEVEL_MIN, TELEMETRY_LEVEL_MAX);
     telemetry_set_level(telemetry_level);
     telemetry_tick();
+#elif defined(USE_VOGL_PROFILER)
+    // Profiling is off unless asked for, every enabled zone is recorded.
+    if (g_command_line_params().has_key("telemetry_file"))
+        telemetry_set_output_filename(g_command_line_params().get_value_as_string_or_empty("telemetry_file").get_ptr());
+    if (g_command_line_params().has_key("telemetry_level"))
+        telemetry_set_level(g_command_line_params().get_value_as_int("telemetry_level", 0,
+                                                                     TELEMETRY_LEVEL_MIN, TELEMETRY_LEVEL_MIN, TELEMETRY_LEVEL_MAX));
+    telemetry_tick();
 #endif
 
     vogl_common_lib_early_init();
@@ -285,7 +300,7 @@ static bool voglbench_init(int argc, char *argv[])
     if (!load_gl())
         return false;
 
-    bool wrap_all_gl_calls = false;
+    bool wrap_all_gl_calls = g_command_line_params().get_value_as_bool("gl_debug_log");
     vogl_init_actual_gl_entrypoints(vogl_get_proc_address_helper, wrap_all_gl_calls);
     return true;
 }
@@ -361,6 +376,136 @@ static uint get_replayer_flags_from_command_line_params()
     return replayer_flags;
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+// class compiled_loop
+// The loop's frames deserialized once up front and compiled into a vogl_gl_command_stream, so each pass over the loop
+// costs little more than the driver: no packet reading or decoding, and most calls go straight to GL with their handles
+// and uniform locations already remapped.
+//----------------------------------------------------------------------------------------------------------------------
+class compiled_loop
+{
+    VOGL_NO_COPY_OR_ASSIGNMENT_OP(compiled_loop);
+
+public:
+    enum
+    {
+        cMaxCompiledBytes = 1024U * 1024U * 1024U
+    };
+
+    compiled_loop()
+        : m_total_bytes(0),
+          m_ends_at_eof(false)
+    {
+    }
+
+    ~compiled_loop()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        m_stream.clear();
+
+        m_total_bytes = 0;
+        m_ends_at_eof = false;
+    }
+
+    // Doesn't change the reader's position. The replayer must be at the start of the loop.
+    bool compile(vogl_trace_file_reader &trace_reader, vogl_gl_replayer &replayer, uint start_frame, uint num_frames)
+    {
+        VOGL_FUNC_TRACER
+
+        clear();
+
+        vogl_trace_packet_array trace_packets;
+        uint actual_frames = 0;
+        if (trace_reader.read_frame_packets(start_frame, num_frames, trace_packets, actual_frames) != vogl_trace_file_reader::cOK)
+        {
+            vogl_error_printf("%s: Failed reading frames %u-%u\n", VOGL_FUNCTION_INFO_CSTR, start_frame, start_frame + num_frames - 1);
+            return false;
+        }
+
+        for (uint i = 0; i < trace_packets.size(); i++)
+        {
+            const vogl_trace_stream_packet_types_t packet_type = trace_packets.get_packet_type(i);
+            if (packet_type == cTSPTEOF)
+            {
+                m_ends_at_eof = true;
+                break;
+            }
+            else if (packet_type != cTSPTGLEntrypoint)
+                continue;
+
+            m_total_bytes += sizeof(vogl_trace_packet) + trace_packets.get_packet_size(i);
+            if (m_total_bytes > cMaxCompiledBytes)
+            {
+                vogl_warning_printf("%s: Frames %u-%u need more than %u MB once decoded, replaying them from the trace instead\n", VOGL_FUNCTION_INFO_CSTR,
+                                    start_frame, start_frame + num_frames - 1, cMaxCompiledBytes / (1024U * 1024U));
+                clear();
+                return false;
+            }
+
+            vogl_trace_packet *pPacket = m_stream.add_packet(&replayer.get_trace_gl_ctypes());
+
+            if (!pPacket->deserialize(trace_packets.get_packet_ptr(i), trace_packets.get_packet_size(i), true))
+            {
+                vogl_error_printf("%s: Failed deserializing GL entrypoint packet %u of frames %u-%u\n", VOGL_FUNCTION_INFO_CSTR, i, start_frame, start_frame + num_frames - 1);
+                clear();
+                return false;
+            }
+        }
+
+        // Stopping short of the requested frames without an EOF packet means the trace was truncated.
+        if (actual_frames < num_frames)
+            m_ends_at_eof = true;
+
+        if (m_stream.is_empty())
+            return false;
+
+        replayer.compile_command_stream(m_stream);
+
+        vogl_printf("Compiled frames %u-%u into %u packets (%" PRIu64 " bytes), %u direct calls\n", start_frame, start_frame + actual_frames - 1,
+                    m_stream.get_num_packets(), m_total_bytes, m_stream.get_num_direct_calls());
+
+        return true;
+    }
+
+    bool is_empty() const
+    {
+        return m_stream.is_empty();
+    }
+
+    void rewind()
+    {
+        m_stream.rewind();
+    }
+
+    bool is_at_end() const
+    {
+        return m_stream.is_at_end();
+    }
+
+    // True if the loop covers the end of the trace.
+    bool ends_at_eof() const
+    {
+        return m_ends_at_eof;
+    }
+
+    vogl_gl_replayer::status_t process_next_packet(vogl_gl_replayer &replayer)
+    {
+        if (is_at_end())
+            return m_ends_at_eof ? vogl_gl_replayer::cStatusAtEOF : vogl_gl_replayer::cStatusNextFrame;
+
+        return replayer.process_next_command(m_stream);
+    }
+
+private:
+    vogl_gl_command_stream m_stream;
+    uint64_t m_total_bytes;
+    bool m_ends_at_eof;
+};
+
 //----------------------------------------------------------------------------------------------------------------------
 // tool_replay_mode
 //----------------------------------------------------------------------------------------------------------------------
@@ -411,6 +556,14 @@ static bool tool_replay_mode()
     // Disable all glGetError() calls in vogl_utils.cpp.
     vogl_disable_gl_get_error();
 
+    // Reading and decoding packets on a helper thread keeps the trace parsing out of the replay timings.
+    vogl_prefetching_trace_file_reader prefetching_trace_reader;
+    vogl_trace_file_reader *pReader = pTrace_reader.get();
+
+    uint prefetch_frames = g_command_line_params().get_value_as_uint("prefetch_frames", 0, vogl_prefetching_trace_file_reader::cDefaultMaxQueuedFrames);
+    if ((prefetch_frames) && (prefetching_trace_reader.init(pTrace_reader.get(), &replayer.get_trace_gl_ctypes(), prefetch_frames)))
+        pReader = &prefetching_trace_reader;
+
     XSelectInput(window.get_display(), window.get_xwindow(),
                  EnterWindowMask | LeaveWindowMask | ButtonPressMask | ButtonReleaseMask | PointerMotionMask | ExposureMask | FocusChangeMask | KeyPressMask | KeyReleaseMask | PropertyChangeMask | StructureNotifyMask | KeymapStateMask);
 
@@ -423,11 +576,17 @@ static bool tool_replay_mode()
     int64_t snapshot_loop_start_frame = -1;
     int64_t snapshot_loop_end_frame = -1;
 
+    // While looping, packets come from here instead of the trace reader (unless -loop_from_trace is used).
+    compiled_loop loop_packets;
+    bool replaying_compiled_loop = false;
+
     vogl::hash_map<uint64_t> keys_pressed, keys_down;
 
     int loop_frame = g_command_line_params().get_value_as_int("loop_frame", 0, -1);
     int loop_len = math::maximum<int>(g_command_line_params().get_value_as_int("loop_len", 0, 1), 1);
     int loop_count = math::maximum<int>(g_command_line_params().get_value_as_int("loop_count", 0, cINT32_MAX), 1);
+    bool loop_full_restore = g_command_line_params().get_value_as_bool("loop_full_restore");
+    bool loop_from_trace = g_command_line_params().get_value_as_bool("loop_from_trace");
     bool endless_mode = g_command_line_params().get_value_as_bool("endless");
 
     timer tm;
@@ -541,8 +700,19 @@ static bool tool_replay_mode()
                 {
                     vogl_printf("Snapshot succeeded\n");
 
-                    snapshot_loop_start_frame = pTrace_reader->get_cur_frame();
-                    snapshot_loop_end_frame = pTrace_reader->get_cur_frame() + loop_len;
+                    snapshot_loop_start_frame = pReader->get_cur_frame();
+                    snapshot_loop_end_frame = pReader->get_cur_frame() + loop_len;
+
+                    if (!loop_full_restore)
+                        replayer.begin_loop(pSnapshot);
+
+                    if (!loop_from_trace)
+                    {
+                        replaying_compiled_loop = loop_packets.compile(*pReader, replayer, static_cast<uint>(snapshot_loop_start_frame), loop_len);
+
+                        // Every pass replays exactly the same calls, so the loop only needs to be tracked once
+                        replayer.set_loop_repeats_exactly(replaying_compiled_loop);
+                    }
 
                     vogl_debug_printf("%s: Loop start: %" PRIi64 " Loop end: %" PRIi64 "\n", VOGL_FUNCTION_INFO_CSTR, snapshot_loop_start_frame, snapshot_loop_end_frame);
                 }
@@ -559,7 +729,7 @@ static bool tool_replay_mode()
         {
             for (;;)
             {
-                status = replayer.process_next_packet(*pTrace_reader);
+                status = replaying_compiled_loop ? loop_packets.process_next_packet(replayer) : replayer.process_next_packet(*pReader);
 
                 if ((status == vogl_gl_replayer::cStatusNextFrame) ||
                     (status == vogl_gl_replayer::cStatusResizeWindow) ||
@@ -579,22 +749,41 @@ static bool tool_replay_mode()
             vogl_message_printf("%s: At trace EOF, frame index %u\n", VOGL_FUNCTION_INFO_CSTR, replayer.get_frame_index());
         }
 
+        bool at_loop_end = replaying_compiled_loop ? loop_packets.is_at_end() : (pReader->get_cur_frame() == snapshot_loop_end_frame);
+
         if (replayer.get_at_frame_boundary() &&
                 pSnapshot && 
                 (loop_count > 0) &&
-                ((pTrace_reader->get_cur_frame() == snapshot_loop_end_frame) || (status == vogl_gl_replayer::cStatusAtEOF)))
+                (at_loop_end || (status == vogl_gl_replayer::cStatusAtEOF)))
         {
-            status = replayer.begin_applying_snapshot(pSnapshot, false);
+            status = replayer.is_looping() ? replayer.restore_loop_snapshot() : replayer.begin_applying_snapshot(pSnapshot, false);
             if ((status != vogl_gl_replayer::cStatusOK) && (status != vogl_gl_replayer::cStatusResizeWindow))
                 goto error_exit;
 
-            pTrace_reader->seek_to_frame(static_cast<uint>(snapshot_loop_start_frame));
+            if (replaying_compiled_loop)
+                loop_packets.rewind();
+            else
+                pReader->seek_to_frame(static_cast<uint>(snapshot_loop_start_frame));
 
             vogl_debug_printf("%s: Applying snapshot and seeking back to frame %" PRIi64 "\n", VOGL_FUNCTION_INFO_CSTR, snapshot_loop_start_frame);
             loop_count--;
         }
         else
         {
+            if ((replaying_compiled_loop) && (at_loop_end))
+            {
+                // Done looping, the trace reader is still at the loop's start so skip it past the loop.
+                replaying_compiled_loop = false;
+                loop_packets.clear();
+                replayer.set_loop_repeats_exactly(false);
+
+                if ((status != vogl_gl_replayer::cStatusAtEOF) && (!pReader->seek_to_frame(static_cast<uint>(snapshot_loop_end_frame))))
+                {
+                    vogl_error_printf("%s: Failed seeking trace reader to frame %" PRIi64 "\n", VOGL_FUNCTION_INFO_CSTR, snapshot_loop_end_frame);
+                    goto error_exit;
+                }
+            }
+
             bool print_progress = (status == vogl_gl_replayer::cStatusAtEOF) ||
                     ((replayer.get_at_frame_boundary()) && ((replayer.get_frame_index() % 100) == 0));
             if (print_progress)
@@ -603,11 +792,15 @@ static bool tool_replay_mode()
                 {
                     vogl_binary_trace_file_reader &binary_trace_reader = *static_cast<vogl_binary_trace_file_reader *>(pTrace_reader.get());
 
+                    // The helper thread is advancing the binary reader while prefetching, so ask the prefetching reader
+                    // where the replayer is.
+                    uint64_t cur_file_ofs = (pReader == &prefetching_trace_reader) ? prefetching_trace_reader.get_cur_file_ofs() : binary_trace_reader.get_cur_file_ofs();
+
                     vogl_printf("Replay now at frame index %u, trace file offet %" PRIu64 ", GL call counter %" PRIu64 ", %3.2f%% percent complete\n",
                                replayer.get_frame_index(),
-                               binary_trace_reader.get_cur_file_ofs(),
+                               cur_file_ofs,
                                replayer.get_last_parsed_call_counter(),
-                               binary_trace_reader.get_trace_file_size() ? (binary_trace_reader.get_cur_file_ofs() * 100.0f) / binary_trace_reader.get_trace_file_size() : 0);
+                               binary_trace_reader.get_trace_file_size() ? (cur_file_ofs * 100.0f) / binary_trace_reader.get_trace_file_size() : 0);
                 }
             }
 
@@ -625,7 +818,7 @@ static bool tool_replay_mode()
 
                 replayer.reset_state();
 
-                if (!pTrace_reader->seek_to_frame(0))
+                if (!pReader->seek_to_frame(0))
                 {
                     vogl_error_printf("%s: Failed rewinding trace reader!\n", VOGL_FUNCTION_INFO_CSTR);
                     goto error_exit;
@@ -34,11 +34,31 @@
 
 using namespace vogl;
 
+// Copies size bytes from the current position of src to dst, cStreamChunkSize bytes at a time.
+static bool vogl_copy_stream_data(data_stream &src, data_stream &dst, uint64_t size)
+{
+    VOGL_FUNC_TRACER
+
+    uint8_vec buf(static_cast<uint>(math::minimum<uint64_t>(size, vogl_blob_manager::cStreamChunkSize)));
+
+    while (size)
+    {
+        uint n = static_cast<uint>(math::minimum<uint64_t>(size, buf.size()));
+        if ((src.read(buf.get_ptr(), n) != n) || (dst.write(buf.get_ptr(), n) != n))
+            return false;
+
+        size -= n;
+    }
+
+    return true;
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 // vogl_blob_manager
 //----------------------------------------------------------------------------------------------------------------------
 vogl_blob_manager::vogl_blob_manager()
     : m_flags(0),
+      m_pChunk_source(NULL),
       m_initialized(false)
 {
     VOGL_FUNC_TRACER
@@ -51,23 +71,59 @@ vogl_blob_manager::~vogl_blob_manager()
     deinit();
 }
 
-dynamic_string vogl_blob_manager::compute_unique_id(const void *pData, uint size, const dynamic_string &prefix, const dynamic_string &ext, const uint64_t *pCRC64) const
+dynamic_string vogl_blob_manager::compute_unique_id(const void *pData, uint64_t size, const dynamic_string &prefix, const dynamic_string &ext, const uint64_t *pCRC64) const
 {
     VOGL_FUNC_TRACER
 
     VOGL_ASSERT(!prefix.contains('['));
     VOGL_ASSERT(!prefix.contains(']'));
 
-    uint64_t crc64 = pCRC64 ? *pCRC64 : calc_crc64(CRC64_INIT, static_cast<const uint8 *>(pData), size);
+    uint64_t crc64 = pCRC64 ? *pCRC64 : calc_crc64(CRC64_INIT, static_cast<const uint8 *>(pData), static_cast<size_t>(size));
 
     dynamic_string actual_ext(ext);
     if ((actual_ext.get_len() > 1) && (actual_ext[0] == '.'))
         actual_ext.right(1);
 
     if (prefix.get_len())
-        return dynamic_string(cVarArg, "[%s]_%" PRIX64 "_%u.radblob.%s", prefix.get_ptr(), crc64, size, actual_ext.get_len() ? actual_ext.get_ptr() : "raw");
+        return dynamic_string(cVarArg, "[%s]_%" PRIX64 "_%" PRIu64 ".radblob.%s", prefix.get_ptr(), crc64, size, actual_ext.get_len() ? actual_ext.get_ptr() : "raw");
+    else
+        return dynamic_string(cVarArg, "%" PRIX64 "_%" PRIu64 ".radblob.%s", crc64, size, actual_ext.get_len() ? actual_ext.get_ptr() : "raw");
+}
+
+dynamic_string vogl_blob_manager::compute_stream_unique_id(data_stream &stream, const dynamic_string &prefix, const dynamic_string &ext, const uint64_t *pCRC64) const
+{
+    VOGL_FUNC_TRACER
+
+    uint64_t size = stream.get_size();
+
+    uint64_t crc64 = CRC64_INIT;
+    if (pCRC64)
+    {
+        crc64 = *pCRC64;
+    }
     else
-        return dynamic_string(cVarArg, "%" PRIX64 "_%u.radblob.%s", crc64, size, actual_ext.get_len() ? actual_ext.get_ptr() : "raw");
+    {
+        if (!stream.seek(0, false))
+            return "";
+
+        uint8_vec buf(static_cast<uint>(math::minimum<uint64_t>(size, cStreamChunkSize)));
+
+        uint64_t bytes_remaining = size;
+        while (bytes_remaining)
+        {
+            uint n = static_cast<uint>(math::minimum<uint64_t>(bytes_remaining, buf.size()));
+            if (stream.read(buf.get_ptr(), n) != n)
+                return "";
+
+            crc64 = calc_crc64(crc64, buf.get_ptr(), n);
+            bytes_remaining -= n;
+        }
+
+        if (!stream.seek(0, false))
+            return "";
+    }
+
+    return compute_unique_id(NULL, size, prefix, ext, &crc64);
 }
 
 dynamic_string vogl_blob_manager::get_prefix(const dynamic_string &id) const
@@ -110,14 +166,14 @@ bool vogl_blob_manager::get(const dynamic_string &id, uint8_vec &data) const
         return false;
     }
 
-    // TODO
+    // uint8_vec can't hold more than this, larger blobs must be read with open() or get_to_stream().
     if (pStream->get_size() > static_cast<uint64_t>(cINT32_MAX))
     {
-        close(pStream);
+        uint64_t size = pStream->get_size();
 
-        VOGL_ASSERT_ALWAYS;
+        close(pStream);
 
-        vogl_error_printf("%s: Blob is too large: blob ID %s, size %" PRIu64 "\n", VOGL_FUNCTION_INFO_CSTR, id.get_ptr(), pStream->get_size());
+        vogl_error_printf("%s: Blob is too large to read into memory: blob ID %s, size %" PRIu64 "\n", VOGL_FUNCTION_INFO_CSTR, id.get_ptr(), size);
 
         return false;
     }
@@ -149,6 +205,31 @@ bool vogl_blob_manager::get(const dynamic_string &id, uint8_vec &data) const
     return true;
 }
 
+bool vogl_blob_manager::get_to_stream(const dynamic_string &id, data_stream &dst) const
+{
+    VOGL_FUNC_TRACER
+
+    if (!is_initialized())
+    {
+        VOGL_ASSERT(0);
+        return false;
+    }
+
+    data_stream *pStream = open(id);
+    if (!pStream)
+    {
+        vogl_error_printf("%s: Failed finding blob ID %s\n", VOGL_FUNCTION_INFO_CSTR, id.get_ptr());
+        return false;
+    }
+
+    bool success = vogl_copy_stream_data(*pStream, dst, pStream->get_size());
+    if (!success)
+        vogl_error_printf("%s: Failed copying blob ID %s, size %" PRIu64 "\n", VOGL_FUNCTION_INFO_CSTR, id.get_ptr(), pStream->get_size());
+
+    close(pStream);
+    return success;
+}
+
 bool vogl_blob_manager::populate(const vogl_blob_manager &other)
 {
     VOGL_FUNC_TRACER
@@ -205,46 +286,14 @@ dynamic_string vogl_blob_manager::add_stream_compute_unique_id(data_stream &stre
         return "";
     }
 
-    // TODO
-    if (stream.get_size() > static_cast<uint64_t>(cUINT32_MAX))
-    {
-        VOGL_VERIFY(0);
-        return "";
-    }
-
-    uint64_t size64 = stream.get_size();
-
-    // TODO
-    if ((size64 > static_cast<uint64_t>(VOGL_MAX_POSSIBLE_HEAP_BLOCK_SIZE)) || (size64 > cUINT32_MAX))
-    {
-        VOGL_VERIFY(0);
-        return "";
-    }
-
-    uint size = static_cast<uint>(size64);
-
-    void *pData = vogl_malloc(static_cast<size_t>(size));
-    if (!pData)
-        return "";
-
-    if (!stream.seek(0, false))
-    {
-        vogl_free(pData);
-        return "";
-    }
-
-    if (stream.read64(pData, size) != size)
+    dynamic_string id(compute_stream_unique_id(stream, prefix, ext, pCRC64));
+    if (id.is_empty())
     {
-        vogl_free(pData);
+        vogl_error_printf("%s: Failed reading stream \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, stream.get_name().get_ptr());
         return "";
     }
 
-    dynamic_string id(compute_unique_id(pData, size, prefix, ext, pCRC64));
-
-    dynamic_string actual_id(add_buf_using_id(pData, size, id));
-
-    vogl_free(pData);
-    return actual_id;
+    return add_stream_using_id(stream, id);
 }
 
 dynamic_string vogl_blob_manager::add_stream_using_id(data_stream &stream, const dynamic_string &id)
@@ -259,10 +308,10 @@ dynamic_string vogl_blob_manager::add_stream_using_id(data_stream &stream, const
 
     uint64_t size64 = stream.get_size();
 
-    // TODO
+    // Blob managers which don't stream go through add_buf_using_id(), which is limited to 32-bit sizes.
     if ((size64 > static_cast<uint64_t>(VOGL_MAX_POSSIBLE_HEAP_BLOCK_SIZE)) || (size64 > cUINT32_MAX))
     {
-        VOGL_VERIFY(0);
+        vogl_error_printf("%s: Stream \"%s\" is too large (%" PRIu64 " bytes) for this blob manager\n", VOGL_FUNCTION_INFO_CSTR, stream.get_name().get_ptr(), size64);
         return "";
     }
 
@@ -295,11 +344,15 @@ dynamic_string vogl_blob_manager::add_stream_using_id(data_stream &stream, const
 //----------------------------------------------------------------------------------------------------------------------
 vogl::dynamic_string vogl_blob_manager::copy_file(vogl_blob_manager &src_blob_manager, const vogl::dynamic_string &src_id, const vogl::dynamic_string &dst_id)
 {
-    uint8_vec data;
-    if (!src_blob_manager.get(src_id, data))
+    data_stream *pSrc_stream = src_blob_manager.open(src_id);
+    if (!pSrc_stream)
         return "";
 
-    return add_buf_using_id(data.get_ptr(), data.size(), dst_id);
+    dynamic_string id(add_stream_using_id(*pSrc_stream, dst_id));
+
+    src_blob_manager.close(pSrc_stream);
+
+    return id;
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -364,6 +417,48 @@ dynamic_string vogl_memory_blob_manager::add_buf_using_id(const void *pData, uin
     return actual_id;
 }
 
+dynamic_string vogl_memory_blob_manager::add_stream_using_id(data_stream &stream, const dynamic_string &id)
+{
+    VOGL_FUNC_TRACER
+
+    if (!is_initialized() || !is_writable())
+    {
+        VOGL_ASSERT(0);
+        return "";
+    }
+
+    uint64_t size = stream.get_size();
+    if (size > cUINT32_MAX)
+    {
+        vogl_error_printf("%s: Stream \"%s\" is too large (%" PRIu64 " bytes) for a memory blob\n", VOGL_FUNCTION_INFO_CSTR, stream.get_name().get_ptr(), size);
+        return "";
+    }
+
+    dynamic_string actual_id(id);
+    if (actual_id.is_empty())
+        actual_id = compute_stream_unique_id(stream);
+
+    if ((actual_id.is_empty()) || (!stream.seek(0, false)))
+        return "";
+
+    blob_map::insert_result insert_res(m_blobs.insert(actual_id));
+    if (!insert_res.second)
+        return (insert_res.first)->first;
+
+    // Read straight into the blob, instead of into a temporary buffer which is then copied.
+    blob &new_blob = (insert_res.first)->second;
+    new_blob.m_id = actual_id;
+    if ((!new_blob.m_blob.try_resize(static_cast<uint>(size))) || (stream.read64(new_blob.m_blob.get_ptr(), size) != size))
+    {
+        vogl_error_printf("%s: Failed reading stream \"%s\" into blob %s\n", VOGL_FUNCTION_INFO_CSTR, stream.get_name().get_ptr(), actual_id.get_ptr());
+
+        m_blobs.erase(actual_id);
+        return "";
+    }
+
+    return actual_id;
+}
+
 data_stream *vogl_memory_blob_manager::open(const dynamic_string &id) const
 {
     VOGL_FUNC_TRACER
@@ -482,7 +577,7 @@ dynamic_string vogl_loose_file_blob_manager::add_buf_using_id(const void *pData,
 
     dynamic_string filename(get_filename(actual_id));
 
-    if (does_exist(filename))
+    if (does_exist(actual_id))
     {
         uint64_t cur_size = get_size(actual_id);
         if (cur_size != size)
@@ -492,10 +587,12 @@ dynamic_string vogl_loose_file_blob_manager::add_buf_using_id(const void *pData,
         return actual_id;
     }
 
-    cfile_stream out_file(filename.get_ptr(), cDataStreamWritable);
+    dynamic_string temp_filename(get_temp_filename(filename));
+
+    cfile_stream out_file(temp_filename.get_ptr(), cDataStreamWritable);
     if (!out_file.is_opened())
     {
-        vogl_error_printf("%s: Failed creating file \"%s\"!\n", VOGL_FUNCTION_INFO_CSTR, filename.get_ptr());
+        vogl_error_printf("%s: Failed creating file \"%s\"!\n", VOGL_FUNCTION_INFO_CSTR, temp_filename.get_ptr());
         return "";
     }
 
@@ -504,9 +601,9 @@ dynamic_string vogl_loose_file_blob_manager::add_buf_using_id(const void *pData,
         VOGL_VERIFY(0);
 
         out_file.close();
-        file_utils::delete_file(filename.get_ptr());
+        file_utils::delete_file(temp_filename.get_ptr());
 
-        vogl_error_printf("%s: Failed writing to file \"%s\"!\n", VOGL_FUNCTION_INFO_CSTR, filename.get_ptr());
+        vogl_error_printf("%s: Failed writing to file \"%s\"!\n", VOGL_FUNCTION_INFO_CSTR, temp_filename.get_ptr());
 
         return "";
     }
@@ -515,16 +612,105 @@ dynamic_string vogl_loose_file_blob_manager::add_buf_using_id(const void *pData,
     {
         VOGL_VERIFY(0);
 
-        file_utils::delete_file(filename.get_ptr());
+        file_utils::delete_file(temp_filename.get_ptr());
+
+        vogl_error_printf("%s: Failed writing to file \"%s\"!\n", VOGL_FUNCTION_INFO_CSTR, temp_filename.get_ptr());
+
+        return "";
+    }
+
+    if (!commit_temp_file(temp_filename, filename, size))
+        return "";
+
+    return actual_id;
+}
+
+dynamic_string vogl_loose_file_blob_manager::add_stream_using_id(data_stream &stream, const dynamic_string &id)
+{
+    VOGL_FUNC_TRACER
+
+    if (!is_writable())
+    {
+        VOGL_ASSERT(0);
+        return "";
+    }
+
+    uint64_t size = stream.get_size();
+
+    dynamic_string actual_id(id);
+    if (actual_id.is_empty())
+        actual_id = compute_stream_unique_id(stream);
+
+    if ((actual_id.is_empty()) || (!stream.seek(0, false)))
+        return "";
+
+    dynamic_string filename(get_filename(actual_id));
+
+    if (does_exist(actual_id))
+    {
+        uint64_t cur_size = get_size(actual_id);
+        if (cur_size != size)
+            vogl_error_printf("%s: Not overwrite already existing blob %s desired size %" PRIu64 ", but it has the wrong size on disk (%" PRIu64 " bytes)!\n", VOGL_FUNCTION_INFO_CSTR, filename.get_ptr(), size, cur_size);
+        else
+            vogl_message_printf("%s: Not overwriting already existing blob %s size %" PRIu64 "\n", VOGL_FUNCTION_INFO_CSTR, filename.get_ptr(), size);
+        return actual_id;
+    }
+
+    dynamic_string temp_filename(get_temp_filename(filename));
+
+    cfile_stream out_file(temp_filename.get_ptr(), cDataStreamWritable);
+    if (!out_file.is_opened())
+    {
+        vogl_error_printf("%s: Failed creating file \"%s\"!\n", VOGL_FUNCTION_INFO_CSTR, temp_filename.get_ptr());
+        return "";
+    }
+
+    if ((!vogl_copy_stream_data(stream, out_file, size)) || (!out_file.close()))
+    {
+        out_file.close();
+        file_utils::delete_file(temp_filename.get_ptr());
 
-        vogl_error_printf("%s: Failed writing to file \"%s\"!\n", VOGL_FUNCTION_INFO_CSTR, filename.get_ptr());
+        vogl_error_printf("%s: Failed writing to file \"%s\"!\n", VOGL_FUNCTION_INFO_CSTR, temp_filename.get_ptr());
 
         return "";
     }
 
+    if (!commit_temp_file(temp_filename, filename, size))
+        return "";
+
     return actual_id;
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+// Blobs are written to a per-thread temporary file first and then renamed into place, so several threads (or tools)
+// adding the same blob to one directory never see, or leave behind, a partially written file.
+//----------------------------------------------------------------------------------------------------------------------
+dynamic_string vogl_loose_file_blob_manager::get_temp_filename(const dynamic_string &filename) const
+{
+    VOGL_FUNC_TRACER
+
+    return dynamic_string(cVarArg, "%s.%" PRIu64 ".tmp", filename.get_ptr(), static_cast<uint64_t>(vogl_get_current_thread_id()));
+}
+
+bool vogl_loose_file_blob_manager::commit_temp_file(const dynamic_string &temp_filename, const dynamic_string &filename, uint64_t size) const
+{
+    VOGL_FUNC_TRACER
+
+    if (rename(temp_filename.get_ptr(), filename.get_ptr()) == 0)
+        return true;
+
+    // Some platforms refuse to rename over an existing file - that's fine if another writer already stored this blob.
+    uint64_t cur_size = 0;
+    bool already_exists = file_utils::get_file_size(filename.get_ptr(), cur_size) && (cur_size == size);
+
+    file_utils::delete_file(temp_filename.get_ptr());
+
+    if (!already_exists)
+        vogl_error_printf("%s: Failed renaming file \"%s\" to \"%s\"!\n", VOGL_FUNCTION_INFO_CSTR, temp_filename.get_ptr(), filename.get_ptr());
+
+    return already_exists;
+}
+
 data_stream *vogl_loose_file_blob_manager::open(const dynamic_string &id) const
 {
     VOGL_FUNC_TRACER
@@ -574,7 +760,7 @@ uint64_t vogl_loose_file_blob_manager::get_size(const dynamic_string &id) const
         return false;
     }
 
-    uint32 file_size;
+    uint64_t file_size = 0;
     file_utils::get_file_size(get_filename(id).get_ptr(), file_size);
     return file_size;
 }
@@ -626,7 +812,11 @@ dynamic_string_array vogl_loose_file_blob_manager::enumerate() const
 // vogl_archive_blob_manager
 //----------------------------------------------------------------------------------------------------------------------
 vogl_archive_blob_manager::vogl_archive_blob_manager()
-    : vogl_blob_manager()
+    : vogl_blob_manager(),
+      m_level(MZ_BEST_SPEED),
+      m_num_threads(0),
+      m_pending_bytes(0),
+      m_pending_blobs_failed(false)
 {
     VOGL_FUNC_TRACER
 
@@ -709,6 +899,8 @@ void *vogl_archive_blob_manager::deinit_heap(size_t &size)
     if ((mz_zip_get_mode(&m_zip) == MZ_ZIP_MODE_INVALID) || (mz_zip_get_type(&m_zip) != MZ_ZIP_TYPE_HEAP))
         return NULL;
 
+    flush_pending_blobs();
+
     void *pBuf = NULL;
     if (!mz_zip_writer_finalize_heap_archive(&m_zip, &pBuf, &size))
     {
@@ -955,6 +1147,14 @@ bool vogl_archive_blob_manager::deinit()
     bool status = true;
     VOGL_NOTE_UNUSED(status);
 
+    if (!flush_pending_blobs())
+        status = false;
+
+    m_tasks.deinit();
+    m_num_threads = 0;
+
+    free_pending_blobs();
+
     if (mz_zip_get_mode(&m_zip) != MZ_ZIP_MODE_INVALID)
     {
         if ((mz_zip_get_type(&m_zip) == MZ_ZIP_TYPE_FILE) && (mz_zip_get_mode(&m_zip) == MZ_ZIP_MODE_WRITING))
@@ -1011,11 +1211,12 @@ vogl::dynamic_string vogl_archive_blob_manager::add_buf_using_id(const void *pDa
         return actual_id;
     }
 
+    if (m_num_threads)
+        return queue_pending_blob(pData, NULL, size, actual_id) ? actual_id : "";
+
     uint file_index = mz_zip_get_num_files(&m_zip);
 
-    // TODO: Allow caller to control whether files are compressed
-    if (!mz_zip_writer_add_mem(&m_zip, actual_id.get_ptr(), pData, size, MZ_BEST_SPEED))
-    //if (!mz_zip_writer_add_mem(&m_zip, actual_id.get_ptr(), pData, size, 0))
+    if (!mz_zip_writer_add_mem(&m_zip, actual_id.get_ptr(), pData, size, m_level))
     {
         mz_zip_error mz_err = mz_zip_get_last_error(&m_zip);
         vogl_error_printf("%s: mz_zip_writer_add_mem() failed adding blob \"%s\" size %u, error 0x%X (%s)\n", VOGL_FUNCTION_INFO_CSTR, id.get_ptr(), size, mz_err, mz_zip_get_error_string(mz_err));
@@ -1030,144 +1231,818 @@ vogl::dynamic_string vogl_archive_blob_manager::add_buf_using_id(const void *pDa
     return actual_id;
 }
 
-vogl::data_stream *vogl_archive_blob_manager::open(const vogl::dynamic_string &id) const
+bool vogl_archive_blob_manager::init_compression_threads(uint num_threads)
 {
     VOGL_FUNC_TRACER
 
-    if (!is_initialized() || !is_readable())
+    if (!is_initialized() || !is_writable())
     {
         VOGL_ASSERT(0);
-        return NULL;
+        return false;
     }
 
-    blob_map::const_iterator it = m_blobs.find(id);
-    if (it == m_blobs.end())
-        return NULL;
+    if (!flush_pending_blobs())
+        return false;
 
-    // TODO: Add some sort of streaming decompression support to miniz and this class.
+    m_tasks.deinit();
 
-    mz_zip_clear_last_error(&m_zip);
+    m_num_threads = math::minimum<uint>(num_threads, cMaxBlobsInFlight);
 
-    size_t size;
-    void *pBuf = mz_zip_extract_to_heap(&m_zip, it->second.m_file_index, &size, 0);
-    if (!pBuf)
+    if ((m_num_threads) && (!m_tasks.init(m_num_threads)))
     {
-        mz_zip_error mz_err = mz_zip_get_last_error(&m_zip);
-        vogl_error_printf("%s: mz_zip_extract_to_heap() failed opening blob \"%s\", error 0x%X (%s)\n", VOGL_FUNCTION_INFO_CSTR, id.get_ptr(), mz_err, mz_zip_get_error_string(mz_err));
-
-        return NULL;
+        vogl_warning_printf("%s: Failed creating compression threads, compressing on the calling thread\n", VOGL_FUNCTION_INFO_CSTR);
+        m_num_threads = 0;
+        return false;
     }
 
-    VOGL_VERIFY(size == it->second.m_size);
-
-    return vogl_new(vogl::buffer_stream, pBuf, size);
+    return true;
 }
 
-void vogl_archive_blob_manager::close(vogl::data_stream *pStream) const
+void vogl_archive_blob_manager::set_compression_level(int level)
 {
     VOGL_FUNC_TRACER
 
-    if (pStream)
-    {
-        void *pBuf = const_cast<void *>(pStream->get_ptr());
-
-        vogl_delete(pStream);
-
-        mz_free(pBuf);
-    }
+    m_level = math::clamp<int>(level, MZ_NO_COMPRESSION, MZ_UBER_COMPRESSION);
 }
 
-bool vogl_archive_blob_manager::does_exist(const vogl::dynamic_string &id) const
+bool vogl_archive_blob_manager::flush_pending_blobs()
 {
     VOGL_FUNC_TRACER
 
-    if (!is_initialized())
-    {
-        VOGL_ASSERT(0);
-        return false;
-    }
+    if (m_pending_blobs.size())
+        write_finished_blobs(true);
 
-    return m_blobs.contains(id);
+    return !m_pending_blobs_failed;
 }
 
-uint64_t vogl_archive_blob_manager::get_size(const vogl::dynamic_string &id) const
+// The blob's data comes from pData, or the start of pStream if pData is NULL.
+bool vogl_archive_blob_manager::queue_pending_blob(const void *pData, vogl::data_stream *pStream, uint size, const vogl::dynamic_string &id)
 {
     VOGL_FUNC_TRACER
 
-    if (!is_initialized())
+    // Don't let the compression threads get too far behind, or hold on to too many copies of the caller's data.
+    // (Failures writing earlier blobs have already been reported, and are returned by flush_pending_blobs().)
+    write_finished_blobs(false);
+    while ((m_pending_blobs.size() >= cMaxBlobsInFlight) || ((m_pending_blobs.size()) && ((m_pending_bytes + size) > cMaxBytesInFlight)))
     {
-        VOGL_ASSERT(0);
-        return false;
+        // Blobs are written in order, so block until the oldest one has been compressed.
+        is_blob_compressed(m_pending_blobs[0], true);
+        write_finished_blobs(false);
     }
 
-    blob_map::const_iterator it = m_blobs.find(id);
-    if (it == m_blobs.end())
-        return 0;
-
-    return it->second.m_size;
-}
-
-vogl::dynamic_string_array vogl_archive_blob_manager::enumerate() const
-{
-    VOGL_FUNC_TRACER
+    pending_blob *pBlob = vogl_new(pending_blob);
+    pBlob->m_id = id;
 
-    if (!is_initialized())
+    if (pData)
     {
-        VOGL_ASSERT(0);
-        return vogl::dynamic_string_array();
+        pBlob->m_uncomp_buf.append(static_cast<const uint8 *>(pData), size);
     }
+    else if ((!pBlob->m_uncomp_buf.try_resize(size)) || (!pStream->seek(0, false)) || (pStream->read64(pBlob->m_uncomp_buf.get_ptr(), size) != size))
+    {
+        vogl_error_printf("%s: Failed reading stream \"%s\" for blob \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, pStream->get_name().get_ptr(), id.get_ptr());
 
-    vogl::dynamic_string_array result(m_blobs.size());
+        vogl_delete(pBlob);
+        return false;
+    }
 
-    uint index = 0;
-    for (blob_map::const_iterator it = m_blobs.begin(); it != m_blobs.end(); ++it)
-        result[index++] = it->first;
+    pBlob->m_level = m_level;
+    pBlob->m_pComp_buf = NULL;
+    pBlob->m_comp_size = 0;
+    pBlob->m_crc32 = 0;
 
-    return result;
+    m_pending_blobs.push_back(pBlob);
+    m_pending_bytes += size;
+
+    bool inserted = m_blobs.insert(id, blob(id, cPendingFileIndex, size)).second;
+    VOGL_NOTE_UNUSED(inserted);
+    VOGL_ASSERT(inserted);
+
+    if (!m_tasks.queue_object_task(this, &vogl_archive_blob_manager::compress_pending_blob_task, 0, pBlob))
+        compress_pending_blob(pBlob);
+
+    return true;
 }
 
-uint64_t vogl_archive_blob_manager::get_archive_size() const
+void vogl_archive_blob_manager::compress_pending_blob(pending_blob *pBlob)
+{
+    VOGL_FUNC_TRACER
+
+    const uint8_vec &src = pBlob->m_uncomp_buf;
+
+    pBlob->m_crc32 = (mz_uint32)mz_crc32(MZ_CRC32_INIT, src.get_ptr(), src.size());
+
+    if ((pBlob->m_level != MZ_NO_COMPRESSION) && (src.size()))
+    {
+        size_t comp_size = 0;
+        void *pComp_buf = tdefl_compress_mem_to_heap(src.get_ptr(), src.size(), &comp_size, tdefl_create_comp_flags_from_zip_params(pBlob->m_level, -15, MZ_DEFAULT_STRATEGY));
+
+        // Incompressible data is stored.
+        if ((pComp_buf) && (comp_size < src.size()))
+        {
+            pBlob->m_pComp_buf = pComp_buf;
+            pBlob->m_comp_size = comp_size;
+        }
+        else
+        {
+            mz_free(pComp_buf);
+        }
+    }
+
+    pBlob->m_compressed.release();
+}
+
+void vogl_archive_blob_manager::compress_pending_blob_task(uint64_t data, void *pData_ptr)
+{
+    VOGL_NOTE_UNUSED(data);
+
+    compress_pending_blob(static_cast<pending_blob *>(pData_ptr));
+}
+
+bool vogl_archive_blob_manager::is_blob_compressed(pending_blob *pBlob, bool wait)
+{
+    VOGL_FUNC_TRACER
+
+    if ((!pBlob->m_done) && (pBlob->m_compressed.wait(wait ? cUINT32_MAX : 0)))
+        pBlob->m_done = true;
+
+    return pBlob->m_done;
+}
+
+// Appends the compressed blobs at the front of the pending list to the archive, in order.
+bool vogl_archive_blob_manager::write_finished_blobs(bool wait_for_all)
+{
+    VOGL_FUNC_TRACER
+
+    uint num_written = 0;
+    while (num_written < m_pending_blobs.size())
+    {
+        pending_blob *pBlob = m_pending_blobs[num_written];
+        if (!is_blob_compressed(pBlob, wait_for_all))
+            break;
+
+        uint file_index = mz_zip_get_num_files(&m_zip);
+        uint size = pBlob->m_uncomp_buf.size();
+
+        mz_bool added;
+        if (pBlob->m_pComp_buf)
+            added = mz_zip_writer_add_mem_ex(&m_zip, pBlob->m_id.get_ptr(), pBlob->m_pComp_buf, pBlob->m_comp_size, NULL, 0, pBlob->m_level | MZ_ZIP_FLAG_COMPRESSED_DATA, size, pBlob->m_crc32);
+        else
+            added = mz_zip_writer_add_mem(&m_zip, pBlob->m_id.get_ptr(), pBlob->m_uncomp_buf.get_ptr(), size, MZ_NO_COMPRESSION);
+
+        blob_map::iterator it = m_blobs.find(pBlob->m_id);
+        VOGL_ASSERT(it != m_blobs.end());
+
+        if (!added)
+        {
+            mz_zip_error mz_err = mz_zip_get_last_error(&m_zip);
+            vogl_error_printf("%s: mz_zip_writer_add_mem() failed adding blob \"%s\" size %u, error 0x%X (%s)\n", VOGL_FUNCTION_INFO_CSTR, pBlob->m_id.get_ptr(), size, mz_err, mz_zip_get_error_string(mz_err));
+
+            if (it != m_blobs.end())
+                m_blobs.erase(it);
+
+            m_pending_blobs_failed = true;
+        }
+        else if (it != m_blobs.end())
+        {
+            it->second.m_file_index = file_index;
+        }
+
+        m_pending_bytes -= size;
+
+        mz_free(pBlob->m_pComp_buf);
+        vogl_delete(pBlob);
+
+        num_written++;
+    }
+
+    if (num_written)
+        m_pending_blobs.erase(0U, num_written);
+
+    VOGL_ASSERT((!wait_for_all) || (m_pending_blobs.is_empty()));
+
+    return !m_pending_blobs_failed;
+}
+
+void vogl_archive_blob_manager::free_pending_blobs()
+{
+    VOGL_FUNC_TRACER
+
+    for (uint i = 0; i < m_pending_blobs.size(); i++)
+    {
+        mz_free(m_pending_blobs[i]->m_pComp_buf);
+        vogl_delete(m_pending_blobs[i]);
+    }
+    m_pending_blobs.clear();
+
+    m_pending_bytes = 0;
+    m_pending_blobs_failed = false;
+}
+
+// Reads the data for mz_zip_writer_add_read_buf_callback() sequentially from a data_stream.
+static size_t vogl_archive_read_stream_func(void *pOpaque, mz_uint64 file_ofs, void *pBuf, size_t n)
+{
+    VOGL_NOTE_UNUSED(file_ofs);
+
+    return static_cast<size_t>(static_cast<data_stream *>(pOpaque)->read64(pBuf, n));
+}
+
+// Writes the data decompressed by mz_zip_extract_to_callback() sequentially to a data_stream.
+static size_t vogl_archive_write_stream_func(void *pOpaque, mz_uint64 file_ofs, const void *pBuf, size_t n)
+{
+    VOGL_NOTE_UNUSED(file_ofs);
+
+    data_stream *pStream = static_cast<data_stream *>(pOpaque);
+
+    // Stored entries in memory archives are passed in one call, which can be larger than data_stream::write() accepts.
+    const uint8 *pSrc = static_cast<const uint8 *>(pBuf);
+    size_t bytes_left = n;
+    while (bytes_left)
+    {
+        uint chunk_size = static_cast<uint>(math::minimum<size_t>(bytes_left, vogl_blob_manager::cStreamChunkSize));
+        if (pStream->write(pSrc, chunk_size) != chunk_size)
+            return n - bytes_left;
+
+        pSrc += chunk_size;
+        bytes_left -= chunk_size;
+    }
+
+    return n;
+}
+
+vogl::dynamic_string vogl_archive_blob_manager::add_stream_using_id(vogl::data_stream &stream, const vogl::dynamic_string &id)
+{
+    VOGL_FUNC_TRACER
+
+    if (!is_initialized() || !is_writable())
+    {
+        VOGL_ASSERT(0);
+        return "";
+    }
+
+    if (mz_zip_get_mode(&m_zip) != MZ_ZIP_MODE_WRITING)
+        return "";
+
+    uint64_t size = stream.get_size();
+
+    dynamic_string actual_id(id);
+    if (actual_id.is_empty())
+        actual_id = compute_stream_unique_id(stream);
+
+    if (actual_id.is_empty())
+        return "";
+
+    if (m_blobs.contains(actual_id))
+    {
+        vogl_debug_printf("%s: Archive already contains blob id \"%s\"! Not replacing file.\n", VOGL_FUNCTION_INFO_CSTR, actual_id.get_ptr());
+        return actual_id;
+    }
+
+    // Blobs that fit in the compression queue go through it like buffers do, larger ones are streamed into the archive
+    // on this thread after the queued blobs, so the archive order still matches the order blobs were added in.
+    if ((m_num_threads) && (size <= cMaxBytesInFlight))
+        return queue_pending_blob(NULL, &stream, static_cast<uint>(size), actual_id) ? actual_id : "";
+
+    flush_pending_blobs();
+
+    if (!stream.seek(0, false))
+        return "";
+
+    uint file_index = mz_zip_get_num_files(&m_zip);
+
+    if (!mz_zip_writer_add_read_buf_callback(&m_zip, actual_id.get_ptr(), vogl_archive_read_stream_func, &stream, size, NULL, NULL, 0, m_level))
+    {
+        mz_zip_error mz_err = mz_zip_get_last_error(&m_zip);
+        vogl_error_printf("%s: mz_zip_writer_add_read_buf_callback() failed adding blob \"%s\" size %" PRIu64 ", error 0x%X (%s)\n", VOGL_FUNCTION_INFO_CSTR, actual_id.get_ptr(), size, mz_err, mz_zip_get_error_string(mz_err));
+
+        return "";
+    }
+
+    bool success = m_blobs.insert(actual_id, blob(actual_id, file_index, size)).second;
+    VOGL_NOTE_UNUSED(success);
+    VOGL_ASSERT(success);
+
+    return actual_id;
+}
+
+// Returns NULL if the blob doesn't exist, blobs which are still being compressed are written to the archive first.
+const vogl_archive_blob_manager::blob *vogl_archive_blob_manager::find_written_blob(const vogl::dynamic_string &id) const
+{
+    VOGL_FUNC_TRACER
+
+    const blob *pBlob = m_blobs.find_value(id);
+    if ((pBlob) && (pBlob->m_file_index == cPendingFileIndex))
+    {
+        flush_pending_blobs_for_read();
+
+        pBlob = m_blobs.find_value(id);
+    }
+
+    return pBlob;
+}
+
+bool vogl_archive_blob_manager::get(const dynamic_string &id, vogl::uint8_vec &data) const
+{
+    VOGL_FUNC_TRACER
+
+    if (!is_initialized() || !is_readable())
+    {
+        VOGL_ASSERT(0);
+        return false;
+    }
+
+    const blob *pBlob = find_written_blob(id);
+    if (!pBlob)
+    {
+        data.resize(0);
+        vogl_error_printf("%s: Failed finding blob ID %s\n", VOGL_FUNCTION_INFO_CSTR, id.get_ptr());
+        return false;
+    }
+
+    if (pBlob->m_size > static_cast<uint64_t>(cINT32_MAX))
+    {
+        vogl_error_printf("%s: Blob is too large to read into memory: blob ID %s, size %" PRIu64 "\n", VOGL_FUNCTION_INFO_CSTR, id.get_ptr(), pBlob->m_size);
+        return false;
+    }
+
+    uint size = static_cast<uint>(pBlob->m_size);
+    if (!data.try_resize(size))
+    {
+        vogl_error_printf("%s: Out of memory while trying to read blob ID %s, size %u\n", VOGL_FUNCTION_INFO_CSTR, id.get_ptr(), size);
+        return false;
+    }
+
+    mz_zip_clear_last_error(&m_zip);
+
+    if ((size) && (!mz_zip_extract_to_mem(&m_zip, pBlob->m_file_index, data.get_ptr(), size, 0)))
+    {
+        mz_zip_error mz_err = mz_zip_get_last_error(&m_zip);
+        vogl_error_printf("%s: mz_zip_extract_to_mem() failed reading blob \"%s\", error 0x%X (%s)\n", VOGL_FUNCTION_INFO_CSTR, id.get_ptr(), mz_err, mz_zip_get_error_string(mz_err));
+
+        data.clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool vogl_archive_blob_manager::get_to_stream(const dynamic_string &id, vogl::data_stream &dst) const
+{
+    VOGL_FUNC_TRACER
+
+    if (!is_initialized() || !is_readable())
+    {
+        VOGL_ASSERT(0);
+        return false;
+    }
+
+    const blob *pBlob = find_written_blob(id);
+    if (!pBlob)
+    {
+        vogl_error_printf("%s: Failed finding blob ID %s\n", VOGL_FUNCTION_INFO_CSTR, id.get_ptr());
+        return false;
+    }
+
+    mz_zip_clear_last_error(&m_zip);
+
+    if (!mz_zip_extract_to_callback(&m_zip, pBlob->m_file_index, vogl_archive_write_stream_func, &dst, 0))
+    {
+        mz_zip_error mz_err = mz_zip_get_last_error(&m_zip);
+        vogl_error_printf("%s: mz_zip_extract_to_callback() failed reading blob \"%s\", error 0x%X (%s)\n", VOGL_FUNCTION_INFO_CSTR, id.get_ptr(), mz_err, mz_zip_get_error_string(mz_err));
+
+        return false;
+    }
+
+    return true;
+}
+
+vogl::data_stream *vogl_archive_blob_manager::open(const vogl::dynamic_string &id) const
+{
+    VOGL_FUNC_TRACER
+
+    if (!is_initialized() || !is_readable())
+    {
+        VOGL_ASSERT(0);
+        return NULL;
+    }
+
+    const blob *pBlob = find_written_blob(id);
+    if (!pBlob)
+        return NULL;
+
+    // TODO: Add some sort of streaming decompression support to miniz and this class.
+
+    mz_zip_clear_last_error(&m_zip);
+
+    size_t size;
+    void *pBuf = mz_zip_extract_to_heap(&m_zip, pBlob->m_file_index, &size, 0);
+    if (!pBuf)
+    {
+        mz_zip_error mz_err = mz_zip_get_last_error(&m_zip);
+        vogl_error_printf("%s: mz_zip_extract_to_heap() failed opening blob \"%s\", error 0x%X (%s)\n", VOGL_FUNCTION_INFO_CSTR, id.get_ptr(), mz_err, mz_zip_get_error_string(mz_err));
+
+        return NULL;
+    }
+
+    VOGL_VERIFY(size == pBlob->m_size);
+
+    return vogl_new(vogl::buffer_stream, pBuf, size);
+}
+
+void vogl_archive_blob_manager::close(vogl::data_stream *pStream) const
+{
+    VOGL_FUNC_TRACER
+
+    if (pStream)
+    {
+        void *pBuf = const_cast<void *>(pStream->get_ptr());
+
+        vogl_delete(pStream);
+
+        mz_free(pBuf);
+    }
+}
+
+bool vogl_archive_blob_manager::does_exist(const vogl::dynamic_string &id) const
+{
+    VOGL_FUNC_TRACER
+
+    if (!is_initialized())
+    {
+        VOGL_ASSERT(0);
+        return false;
+    }
+
+    return m_blobs.contains(id);
+}
+
+uint64_t vogl_archive_blob_manager::get_size(const vogl::dynamic_string &id) const
+{
+    VOGL_FUNC_TRACER
+
+    if (!is_initialized())
+    {
+        VOGL_ASSERT(0);
+        return false;
+    }
+
+    blob_map::const_iterator it = m_blobs.find(id);
+    if (it == m_blobs.end())
+        return 0;
+
+    return it->second.m_size;
+}
+
+vogl::dynamic_string_array vogl_archive_blob_manager::enumerate() const
 {
     VOGL_FUNC_TRACER
 
     if (!is_initialized())
+    {
+        VOGL_ASSERT(0);
+        return vogl::dynamic_string_array();
+    }
+
+    vogl::dynamic_string_array result(m_blobs.size());
+
+    uint index = 0;
+    for (blob_map::const_iterator it = m_blobs.begin(); it != m_blobs.end(); ++it)
+        result[index++] = it->first;
+
+    return result;
+}
+
+uint64_t vogl_archive_blob_manager::get_archive_size() const
+{
+    VOGL_FUNC_TRACER
+
+    if (!is_initialized())
+        return false;
+
+    flush_pending_blobs_for_read();
+
+    return mz_zip_get_archive_size(&m_zip);
+}
+
+bool vogl_archive_blob_manager::write_archive_to_stream(vogl::data_stream &stream) const
+{
+    VOGL_FUNC_TRACER
+
+    if (!is_initialized())
+        return false;
+
+    flush_pending_blobs_for_read();
+
+    uint8_vec buf(64 * 1024);
+
+    uint64_t bytes_remaining = mz_zip_get_archive_size(&m_zip);
+    mz_uint64 src_file_ofs = 0;
+
+    while (bytes_remaining)
+    {
+        size_t n = static_cast<size_t>(math::minimum<uint64_t>(bytes_remaining, buf.size()));
+
+        if (mz_zip_read_archive_data(&m_zip, src_file_ofs, buf.get_ptr(), n) != n)
+        {
+            mz_zip_error mz_err = mz_zip_get_last_error(&m_zip);
+            vogl_error_printf("%s: mz_zip_read_archive_data() failed, error 0x%X (%s)\n", VOGL_FUNCTION_INFO_CSTR, mz_err, mz_zip_get_error_string(mz_err));
+
+            return false;
+        }
+
+        if (stream.write(buf.get_ptr(), static_cast<uint>(n)) != n)
+            return false;
+
+        src_file_ofs += n;
+        bytes_remaining -= n;
+    }
+
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_chunked_blob_stream
+// Read only, seekable view of a chunked blob. Only the chunk containing the current offset is held in memory.
+//----------------------------------------------------------------------------------------------------------------------
+class vogl_chunked_blob_stream : public data_stream
+{
+public:
+    vogl_chunked_blob_stream(const vogl_blob_manager &chunk_blob_manager, const char *pName)
+        : data_stream(pName, cDataStreamReadable | cDataStreamSeekable),
+          m_chunk_blob_manager(chunk_blob_manager),
+          m_size(0),
+          m_ofs(0),
+          m_cur_chunk(-1)
+    {
+        VOGL_FUNC_TRACER
+
+        m_opened = true;
+    }
+
+    virtual ~vogl_chunked_blob_stream()
+    {
+    }
+
+    void add_chunk(const dynamic_string &id, uint size)
+    {
+        m_chunk_ids.push_back(id);
+        m_chunk_ofs.push_back(m_size);
+        m_size += size;
+    }
+
+    virtual uint read(void *pBuf, uint len)
+    {
+        VOGL_FUNC_TRACER
+
+        if ((!m_opened) || (!len))
+            return 0;
+
+        uint8 *pDst = static_cast<uint8 *>(pBuf);
+        uint total_bytes_read = 0;
+
+        while ((len) && (m_ofs < m_size))
+        {
+            if (!load_chunk(m_ofs))
+            {
+                set_error();
+                break;
+            }
+
+            uint chunk_ofs = static_cast<uint>(m_ofs - m_chunk_ofs[m_cur_chunk]);
+            uint n = math::minimum<uint>(len, m_chunk_data.size() - chunk_ofs);
+
+            memcpy(pDst, m_chunk_data.get_ptr() + chunk_ofs, n);
+
+            pDst += n;
+            len -= n;
+            m_ofs += n;
+            total_bytes_read += n;
+        }
+
+        return total_bytes_read;
+    }
+
+    virtual uint peek(char *pBuf)
+    {
+        if ((!m_opened) || (m_ofs >= m_size))
+            return 0;
+
+        if (!load_chunk(m_ofs))
+        {
+            set_error();
+            return 0;
+        }
+
+        *pBuf = static_cast<char>(m_chunk_data[static_cast<uint>(m_ofs - m_chunk_ofs[m_cur_chunk])]);
+        return 1;
+    }
+
+    virtual uint write(const void *pBuf, uint len)
+    {
+        VOGL_NOTE_UNUSED(pBuf);
+        VOGL_NOTE_UNUSED(len);
+        return 0;
+    }
+
+    virtual bool flush()
+    {
+        return m_opened;
+    }
+
+    virtual uint64_t get_size() const
+    {
+        return m_size;
+    }
+
+    virtual uint64_t get_remaining() const
+    {
+        return m_size - m_ofs;
+    }
+
+    virtual uint64_t get_ofs() const
+    {
+        return m_ofs;
+    }
+
+    virtual bool seek(int64_t ofs, bool relative)
+    {
+        if (!m_opened)
+            return false;
+
+        int64_t new_ofs = relative ? (static_cast<int64_t>(m_ofs) + ofs) : ofs;
+        if ((new_ofs < 0) || (static_cast<uint64_t>(new_ofs) > m_size))
+            return false;
+
+        m_ofs = static_cast<uint64_t>(new_ofs);
+        return true;
+    }
+
+private:
+    const vogl_blob_manager &m_chunk_blob_manager;
+
+    dynamic_string_array m_chunk_ids;
+    vogl::vector<uint64_t> m_chunk_ofs;
+    uint64_t m_size;
+    uint64_t m_ofs;
+
+    int m_cur_chunk;
+    uint8_vec m_chunk_data;
+
+    bool load_chunk(uint64_t ofs)
+    {
+        VOGL_FUNC_TRACER
+
+        if ((m_cur_chunk >= 0) && (ofs >= m_chunk_ofs[m_cur_chunk]) && (ofs < m_chunk_ofs[m_cur_chunk] + m_chunk_data.size()))
+            return true;
+
+        // Find the last chunk starting at or before ofs.
+        uint l = 0, h = m_chunk_ofs.size();
+        while ((h - l) > 1)
+        {
+            uint m = (l + h) >> 1;
+            if (m_chunk_ofs[m] <= ofs)
+                l = m;
+            else
+                h = m;
+        }
+
+        m_cur_chunk = -1;
+
+        if (!m_chunk_blob_manager.get(m_chunk_ids[l], m_chunk_data))
+            return false;
+
+        uint64_t expected_size = ((l + 1) < m_chunk_ofs.size() ? m_chunk_ofs[l + 1] : m_size) - m_chunk_ofs[l];
+        if (m_chunk_data.size() != expected_size)
+        {
+            vogl_error_printf("%s: Chunk %s of blob \"%s\" is %u bytes, expected %" PRIu64 "\n", VOGL_FUNCTION_INFO_CSTR, m_chunk_ids[l].get_ptr(), m_name.get_ptr(), m_chunk_data.size(), expected_size);
+            return false;
+        }
+
+        m_cur_chunk = l;
+        return true;
+    }
+};
+
+static const char s_chunk_manifest_header[] = "VOGL_CHUNKED_BLOB 1\n";
+static const uint s_chunk_manifest_header_len = sizeof(s_chunk_manifest_header) - 1;
+
+// Reads the whole manifest in stream. The chunk arrays may be NULL if only the size is needed.
+static bool vogl_read_chunk_manifest(data_stream &stream, uint64_t &total_size, dynamic_string_array *pChunk_ids, uint_vec *pChunk_sizes)
+{
+    VOGL_FUNC_TRACER
+
+    total_size = 0;
+
+    uint64_t manifest_size = stream.get_size();
+    if ((manifest_size < s_chunk_manifest_header_len) || (manifest_size > vogl_chunked_blob_manager::cMaxManifestSize))
+        return false;
+
+    dynamic_string manifest;
+    manifest.set_len(static_cast<uint>(manifest_size));
+
+    if ((!stream.seek(0, false)) || (stream.read(manifest.get_ptr_raw(), static_cast<uint>(manifest_size)) != manifest_size))
+        return false;
+
+    if (memcmp(manifest.get_ptr(), s_chunk_manifest_header, s_chunk_manifest_header_len) != 0)
         return false;
 
-    return mz_zip_get_archive_size(&m_zip);
+    dynamic_string_array lines;
+    manifest.tokenize("\n", lines);
+
+    // Header, total size, then one "size id" line per chunk.
+    if (lines.size() < 2)
+        return false;
+
+    const char *pTotal_size = lines[1].get_ptr();
+    if (!string_ptr_to_uint64(pTotal_size, total_size))
+        return false;
+
+    uint64_t chunks_size = 0;
+    for (uint i = 2; i < lines.size(); i++)
+    {
+        const char *pLine = lines[i].get_ptr();
+
+        uint chunk_size = 0;
+        if ((!string_ptr_to_uint(pLine, chunk_size)) || (!chunk_size) || (*pLine != ' '))
+            return false;
+
+        dynamic_string chunk_id(pLine + 1);
+        if (chunk_id.is_empty())
+            return false;
+
+        chunks_size += chunk_size;
+
+        if (pChunk_ids)
+            pChunk_ids->push_back(chunk_id);
+        if (pChunk_sizes)
+            pChunk_sizes->push_back(chunk_size);
+    }
+
+    if (chunks_size != total_size)
+    {
+        vogl_error_printf("%s: Manifest \"%s\" is corrupt, its chunks add up to %" PRIu64 " bytes but the blob is %" PRIu64 " bytes\n", VOGL_FUNCTION_INFO_CSTR, stream.get_name().get_ptr(), chunks_size, total_size);
+        return false;
+    }
+
+    return true;
+}
+
+// Returns true if blob_manager holds the blob, either as-is or as a manifest.
+static bool vogl_does_chunked_blob_exist(const vogl_blob_manager &blob_manager, const dynamic_string &id)
+{
+    VOGL_FUNC_TRACER
+
+    if (blob_manager.does_exist(id))
+        return true;
+
+    return (!vogl_chunked_blob_manager::is_manifest_id(id)) && (blob_manager.does_exist(vogl_chunked_blob_manager::get_manifest_id(id)));
+}
+
+// Returns the size of a blob stored in blob_manager, reassembled if it was chunked. Only manifests are read.
+static uint64_t vogl_get_chunked_blob_size(const vogl_blob_manager &blob_manager, const dynamic_string &id)
+{
+    VOGL_FUNC_TRACER
+
+    if ((blob_manager.does_exist(id)) || (vogl_chunked_blob_manager::is_manifest_id(id)))
+        return blob_manager.get_size(id);
+
+    data_stream *pStream = blob_manager.open(vogl_chunked_blob_manager::get_manifest_id(id));
+    if (!pStream)
+        return 0;
+
+    uint64_t size;
+    if (!vogl_chunked_blob_manager::get_manifest_size(*pStream, size))
+        size = 0;
+
+    blob_manager.close(pStream);
+
+    return size;
 }
 
-bool vogl_archive_blob_manager::write_archive_to_stream(vogl::data_stream &stream) const
+// Opens a blob stored in blob_manager. Chunked blobs are reassembled from the chunks in chunk_blob_manager, the
+// returned stream must then be deleted with vogl_delete() instead of closed (see open_manifest()).
+static data_stream *vogl_open_chunked_blob(const vogl_blob_manager &blob_manager, const vogl_blob_manager &chunk_blob_manager, const dynamic_string &id, bool &reassembled)
 {
     VOGL_FUNC_TRACER
 
-    if (!is_initialized())
-        return false;
-
-    uint8_vec buf(64 * 1024);
-
-    uint64_t bytes_remaining = mz_zip_get_archive_size(&m_zip);
-    mz_uint64 src_file_ofs = 0;
+    reassembled = false;
 
-    while (bytes_remaining)
-    {
-        size_t n = static_cast<size_t>(math::minimum<uint64_t>(bytes_remaining, buf.size()));
+    if ((blob_manager.does_exist(id)) || (vogl_chunked_blob_manager::is_manifest_id(id)))
+        return blob_manager.open(id);
 
-        if (mz_zip_read_archive_data(&m_zip, src_file_ofs, buf.get_ptr(), n) != n)
-        {
-            mz_zip_error mz_err = mz_zip_get_last_error(&m_zip);
-            vogl_error_printf("%s: mz_zip_read_archive_data() failed, error 0x%X (%s)\n", VOGL_FUNCTION_INFO_CSTR, mz_err, mz_zip_get_error_string(mz_err));
+    dynamic_string manifest_id(vogl_chunked_blob_manager::get_manifest_id(id));
+    if (!blob_manager.does_exist(manifest_id))
+        return NULL;
 
-            return false;
-        }
+    data_stream *pManifest_stream = blob_manager.open(manifest_id);
+    if (!pManifest_stream)
+        return NULL;
 
-        if (stream.write(buf.get_ptr(), static_cast<uint>(n)) != n)
-            return false;
+    data_stream *pStream = vogl_chunked_blob_manager::open_manifest(*pManifest_stream, chunk_blob_manager, id);
 
-        src_file_ofs += n;
-        bytes_remaining -= n;
-    }
+    blob_manager.close(pManifest_stream);
 
-    return true;
+    reassembled = (pStream != NULL);
+    return pStream;
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -1263,13 +2138,21 @@ vogl::data_stream *vogl_multi_blob_manager::open(const dynamic_string &id) const
         if (!m_blob_managers[i]->is_initialized())
             continue;
 
-        vogl::data_stream *pStream = m_blob_managers[i]->open(id);
-        if (pStream)
+        // Chunked blobs are reassembled from the chunks in the chunk source of the blob manager holding the manifest.
+        bool reassembled;
+        vogl::data_stream *pStream = vogl_open_chunked_blob(*m_blob_managers[i], m_blob_managers[i]->get_chunk_source(), id, reassembled);
+        if (!pStream)
+            continue;
+
+        if (reassembled)
         {
-            VOGL_ASSERT(!pStream->get_user_data());
-            pStream->set_user_data(m_blob_managers[i]);
+            pStream->set_user_data(const_cast<vogl_multi_blob_manager *>(this));
             return pStream;
         }
+
+        VOGL_ASSERT(!pStream->get_user_data());
+        pStream->set_user_data(m_blob_managers[i]);
+        return pStream;
     }
 
     return NULL;
@@ -1284,7 +2167,12 @@ void vogl_multi_blob_manager::close(vogl::data_stream *pStream) const
         vogl_blob_manager *pBlob_manager = static_cast<vogl_blob_manager *>(pStream->get_user_data());
         VOGL_ASSERT(pBlob_manager);
 
-        if (pBlob_manager)
+        if (pBlob_manager == this)
+        {
+            // Reassembled chunked blob, see open().
+            vogl_delete(pStream);
+        }
+        else if (pBlob_manager)
         {
             pStream->set_user_data(NULL);
             pBlob_manager->close(pStream);
@@ -1301,7 +2189,7 @@ bool vogl_multi_blob_manager::does_exist(const vogl::dynamic_string &id) const
         if (!m_blob_managers[i]->is_initialized())
             continue;
 
-        if (m_blob_managers[i]->does_exist(id))
+        if (vogl_does_chunked_blob_exist(*m_blob_managers[i], id))
             return true;
     }
     return false;
@@ -1316,8 +2204,8 @@ uint64_t vogl_multi_blob_manager::get_size(const vogl::dynamic_string &id) const
         if (!m_blob_managers[i]->is_initialized())
             continue;
 
-        if (m_blob_managers[i]->does_exist(id))
-            return m_blob_managers[i]->get_size(id);
+        if (vogl_does_chunked_blob_exist(*m_blob_managers[i], id))
+            return vogl_get_chunked_blob_size(*m_blob_managers[i], id);
     }
     return 0;
 }
@@ -1333,8 +2221,7 @@ vogl::dynamic_string_array vogl_multi_blob_manager::enumerate() const
         if (!m_blob_managers[i]->is_initialized())
             continue;
 
-        vogl::dynamic_string_array files(m_blob_managers[i]->enumerate());
-        all_files.append(files);
+        all_files.append(vogl_chunked_blob_manager::enumerate_blobs(*m_blob_managers[i]));
     }
 
     all_files.sort();
@@ -1342,3 +2229,355 @@ vogl::dynamic_string_array vogl_multi_blob_manager::enumerate() const
 
     return all_files;
 }
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_chunked_blob_manager
+//----------------------------------------------------------------------------------------------------------------------
+vogl_chunked_blob_manager::vogl_chunked_blob_manager()
+    : vogl_blob_manager(),
+      m_pManifest_blob_manager(NULL),
+      m_pChunk_blob_manager(NULL),
+      m_total_chunked_bytes(0),
+      m_new_chunk_bytes(0)
+{
+    VOGL_FUNC_TRACER
+}
+
+vogl_chunked_blob_manager::~vogl_chunked_blob_manager()
+{
+    VOGL_FUNC_TRACER
+
+    deinit();
+}
+
+bool vogl_chunked_blob_manager::init(uint32 flags, vogl_blob_manager *pManifest_blob_manager, vogl_blob_manager *pChunk_blob_manager)
+{
+    VOGL_FUNC_TRACER
+
+    deinit();
+
+    if ((!pManifest_blob_manager) || (!pChunk_blob_manager) || (!pManifest_blob_manager->is_initialized()) || (!pChunk_blob_manager->is_initialized()))
+        return false;
+
+    if (!vogl_blob_manager::init(flags))
+        return false;
+
+    m_pManifest_blob_manager = pManifest_blob_manager;
+    m_pChunk_blob_manager = pChunk_blob_manager;
+
+    m_initialized = true;
+    return true;
+}
+
+bool vogl_chunked_blob_manager::deinit()
+{
+    VOGL_FUNC_TRACER
+
+    VOGL_ASSERT(m_reassembled_streams.is_empty());
+
+    for (uint i = 0; i < m_reassembled_streams.size(); i++)
+        vogl_delete(m_reassembled_streams[i]);
+    m_reassembled_streams.clear();
+
+    m_pManifest_blob_manager = NULL;
+    m_pChunk_blob_manager = NULL;
+    m_total_chunked_bytes = 0;
+    m_new_chunk_bytes = 0;
+
+    return vogl_blob_manager::deinit();
+}
+
+bool vogl_chunked_blob_manager::is_chunk_id(const dynamic_string &id)
+{
+    return id.begins_with("[chunk]_");
+}
+
+static const char s_manifest_id_prefix[] = "[manifest]_";
+static const uint s_manifest_id_prefix_len = sizeof(s_manifest_id_prefix) - 1;
+
+dynamic_string vogl_chunked_blob_manager::get_manifest_id(const dynamic_string &id)
+{
+    return dynamic_string(cVarArg, "%s%s", s_manifest_id_prefix, id.get_ptr());
+}
+
+bool vogl_chunked_blob_manager::is_manifest_id(const dynamic_string &id)
+{
+    return id.begins_with(s_manifest_id_prefix);
+}
+
+dynamic_string vogl_chunked_blob_manager::get_manifest_blob_id(const dynamic_string &manifest_id)
+{
+    VOGL_ASSERT(is_manifest_id(manifest_id));
+
+    return dynamic_string(manifest_id).right(s_manifest_id_prefix_len);
+}
+
+bool vogl_chunked_blob_manager::get_manifest_size(data_stream &stream, uint64_t &size)
+{
+    VOGL_FUNC_TRACER
+
+    return vogl_read_chunk_manifest(stream, size, NULL, NULL);
+}
+
+dynamic_string_array vogl_chunked_blob_manager::enumerate_blobs(const vogl_blob_manager &blob_manager)
+{
+    VOGL_FUNC_TRACER
+
+    dynamic_string_array ids;
+
+    dynamic_string_array all_ids(blob_manager.enumerate());
+    for (uint i = 0; i < all_ids.size(); i++)
+    {
+        if (is_manifest_id(all_ids[i]))
+            ids.push_back(get_manifest_blob_id(all_ids[i]));
+        else if (!is_chunk_id(all_ids[i]))
+            ids.push_back(all_ids[i]);
+    }
+
+    return ids;
+}
+
+data_stream *vogl_chunked_blob_manager::open_manifest(data_stream &manifest_stream, const vogl_blob_manager &chunk_blob_manager, const dynamic_string &id)
+{
+    VOGL_FUNC_TRACER
+
+    uint64_t total_size;
+    dynamic_string_array chunk_ids;
+    uint_vec chunk_sizes;
+    if (!vogl_read_chunk_manifest(manifest_stream, total_size, &chunk_ids, &chunk_sizes))
+    {
+        vogl_error_printf("%s: Failed reading chunk manifest of blob \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, id.get_ptr());
+        return NULL;
+    }
+
+    vogl_chunked_blob_stream *pStream = vogl_new(vogl_chunked_blob_stream, chunk_blob_manager, id.get_ptr());
+
+    for (uint i = 0; i < chunk_ids.size(); i++)
+        pStream->add_chunk(chunk_ids[i], chunk_sizes[i]);
+
+    return pStream;
+}
+
+dynamic_string vogl_chunked_blob_manager::add_chunk(const uint8 *pData, uint size)
+{
+    VOGL_FUNC_TRACER
+
+    dynamic_string chunk_id(compute_unique_id(pData, size, "chunk"));
+
+    m_total_chunked_bytes += size;
+
+    if (m_pChunk_blob_manager->does_exist(chunk_id))
+        return chunk_id;
+
+    m_new_chunk_bytes += size;
+
+    return m_pChunk_blob_manager->add_buf_using_id(pData, size, chunk_id);
+}
+
+dynamic_string vogl_chunked_blob_manager::add_manifest(const dynamic_string_array &chunk_ids, const uint_vec &chunk_sizes, uint64_t total_size, const dynamic_string &id)
+{
+    VOGL_FUNC_TRACER
+
+    dynamic_string manifest(s_chunk_manifest_header);
+    manifest.format_append("%" PRIu64 "\n", total_size);
+
+    for (uint i = 0; i < chunk_ids.size(); i++)
+        manifest.format_append("%u %s\n", chunk_sizes[i], chunk_ids[i].get_ptr());
+
+    if (manifest.get_len() > cMaxManifestSize)
+    {
+        vogl_error_printf("%s: Blob %s has too many chunks (%u)\n", VOGL_FUNCTION_INFO_CSTR, id.get_ptr(), chunk_ids.size());
+        return "";
+    }
+
+    if (m_pManifest_blob_manager->add_buf_using_id(manifest.get_ptr(), manifest.get_len(), get_manifest_id(id)).is_empty())
+        return "";
+
+    return id;
+}
+
+dynamic_string vogl_chunked_blob_manager::add_buf_using_id(const void *pData, uint size, const dynamic_string &id)
+{
+    VOGL_FUNC_TRACER
+
+    if (!is_initialized() || !is_writable())
+    {
+        VOGL_ASSERT(0);
+        return "";
+    }
+
+    dynamic_string actual_id(id);
+    if (actual_id.is_empty())
+        actual_id = compute_unique_id(pData, size);
+
+    if (size < cMinChunkedBlobSize)
+        return m_pManifest_blob_manager->add_buf_using_id(pData, size, actual_id);
+
+    dynamic_string_array chunk_ids;
+    uint_vec chunk_sizes;
+
+    const uint8 *pSrc = static_cast<const uint8 *>(pData);
+    uint bytes_remaining = size;
+
+    while (bytes_remaining)
+    {
+        uint chunk_size = find_content_chunk_size(pSrc, bytes_remaining, cMinChunkSize, cAvgChunkSize, cMaxChunkSize);
+
+        dynamic_string chunk_id(add_chunk(pSrc, chunk_size));
+        if (chunk_id.is_empty())
+        {
+            vogl_error_printf("%s: Failed adding chunk of blob %s\n", VOGL_FUNCTION_INFO_CSTR, actual_id.get_ptr());
+            return "";
+        }
+
+        chunk_ids.push_back(chunk_id);
+        chunk_sizes.push_back(chunk_size);
+
+        pSrc += chunk_size;
+        bytes_remaining -= chunk_size;
+    }
+
+    return add_manifest(chunk_ids, chunk_sizes, size, actual_id);
+}
+
+dynamic_string vogl_chunked_blob_manager::add_stream_using_id(data_stream &stream, const dynamic_string &id)
+{
+    VOGL_FUNC_TRACER
+
+    if (!is_initialized() || !is_writable())
+    {
+        VOGL_ASSERT(0);
+        return "";
+    }
+
+    uint64_t size = stream.get_size();
+
+    dynamic_string actual_id(id);
+    if (actual_id.is_empty())
+        actual_id = compute_stream_unique_id(stream);
+
+    if ((actual_id.is_empty()) || (!stream.seek(0, false)))
+        return "";
+
+    if (size < cMinChunkedBlobSize)
+        return m_pManifest_blob_manager->add_stream_using_id(stream, actual_id);
+
+    dynamic_string_array chunk_ids;
+    uint_vec chunk_sizes;
+
+    // A chunk never extends past cMaxChunkSize bytes, so a buffer that size finds the same boundaries add_buf_using_id() would.
+    uint8_vec buf(cMaxChunkSize);
+    uint buf_size = 0;
+    uint64_t bytes_remaining = size;
+
+    for (;;)
+    {
+        uint n = static_cast<uint>(math::minimum<uint64_t>(bytes_remaining, buf.size() - buf_size));
+        if (stream.read(buf.get_ptr() + buf_size, n) != n)
+        {
+            vogl_error_printf("%s: Failed reading stream \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, stream.get_name().get_ptr());
+            return "";
+        }
+
+        buf_size += n;
+        bytes_remaining -= n;
+
+        if (!buf_size)
+            break;
+
+        uint chunk_size = find_content_chunk_size(buf.get_ptr(), buf_size, cMinChunkSize, cAvgChunkSize, cMaxChunkSize);
+
+        dynamic_string chunk_id(add_chunk(buf.get_ptr(), chunk_size));
+        if (chunk_id.is_empty())
+        {
+            vogl_error_printf("%s: Failed adding chunk of blob %s\n", VOGL_FUNCTION_INFO_CSTR, actual_id.get_ptr());
+            return "";
+        }
+
+        chunk_ids.push_back(chunk_id);
+        chunk_sizes.push_back(chunk_size);
+
+        buf_size -= chunk_size;
+        if (buf_size)
+            memmove(buf.get_ptr(), buf.get_ptr() + chunk_size, buf_size);
+    }
+
+    return add_manifest(chunk_ids, chunk_sizes, size, actual_id);
+}
+
+data_stream *vogl_chunked_blob_manager::open(const dynamic_string &id) const
+{
+    VOGL_FUNC_TRACER
+
+    if (!is_initialized() || !is_readable())
+    {
+        VOGL_ASSERT(0);
+        return NULL;
+    }
+
+    bool reassembled;
+    data_stream *pStream = vogl_open_chunked_blob(*m_pManifest_blob_manager, *m_pChunk_blob_manager, id, reassembled);
+
+    if (reassembled)
+        m_reassembled_streams.push_back(pStream);
+
+    return pStream;
+}
+
+void vogl_chunked_blob_manager::close(data_stream *pStream) const
+{
+    VOGL_FUNC_TRACER
+
+    if (!pStream)
+        return;
+
+    int index = m_reassembled_streams.find(pStream);
+    if (index >= 0)
+    {
+        m_reassembled_streams.erase(index);
+        vogl_delete(pStream);
+    }
+    else if (m_pManifest_blob_manager)
+    {
+        m_pManifest_blob_manager->close(pStream);
+    }
+}
+
+bool vogl_chunked_blob_manager::does_exist(const dynamic_string &id) const
+{
+    VOGL_FUNC_TRACER
+
+    if (!is_initialized())
+    {
+        VOGL_ASSERT(0);
+        return false;
+    }
+
+    return vogl_does_chunked_blob_exist(*m_pManifest_blob_manager, id);
+}
+
+uint64_t vogl_chunked_blob_manager::get_size(const dynamic_string &id) const
+{
+    VOGL_FUNC_TRACER
+
+    if (!is_initialized())
+    {
+        VOGL_ASSERT(0);
+        return 0;
+    }
+
+    return vogl_get_chunked_blob_size(*m_pManifest_blob_manager, id);
+}
+
+dynamic_string_array vogl_chunked_blob_manager::enumerate() const
+{
+    VOGL_FUNC_TRACER
+
+    if (!is_initialized())
+    {
+        VOGL_ASSERT(0);
+        return dynamic_string_array();
+    }
+
+    return enumerate_blobs(*m_pManifest_blob_manager);
+}
@@ -30,6 +30,7 @@
 #include "vogl_map.h"
 #include "vogl_data_stream.h"
 #include "vogl_miniz_zip.h"
+#include "vogl_threading.h"
 
 enum vogl_blob_manager_type_t
 {
@@ -37,7 +38,8 @@ enum vogl_blob_manager_type_t
     cBMTFile,
     cBMTMemory,
     cBMTArchive,
-    cBMTMulti
+    cBMTMulti,
+    cBMTChunked
 };
 
 enum vogl_blob_manager_flags_t
@@ -74,15 +76,29 @@ public:
 
     virtual vogl_blob_manager_type_t get_type() const = 0;
 
-    vogl::dynamic_string compute_unique_id(const void *pData, uint size, const vogl::dynamic_string &prefix = "", const dynamic_string &ext = "", const uint64_t *pCRC64 = NULL) const;
+    enum
+    {
+        // Streamed blobs are copied through a buffer of this size, so they're never held in memory all at once.
+        cStreamChunkSize = 1024 * 1024
+    };
+
+    vogl::dynamic_string compute_unique_id(const void *pData, uint64_t size, const vogl::dynamic_string &prefix = "", const dynamic_string &ext = "", const uint64_t *pCRC64 = NULL) const;
+
+    // Same as compute_unique_id(), but reads the data from the start of stream in chunks. Returns an empty string if the stream can't be read.
+    vogl::dynamic_string compute_stream_unique_id(vogl::data_stream &stream, const vogl::dynamic_string &prefix = "", const dynamic_string &ext = "", const uint64_t *pCRC64 = NULL) const;
     vogl::dynamic_string get_prefix(const vogl::dynamic_string &id) const;
     vogl::dynamic_string get_extension(const vogl::dynamic_string &id) const;
 
     virtual bool get(const dynamic_string &id, vogl::uint8_vec &data) const;
 
+    // Copies a blob to dst in chunks. Unlike get() this works with blobs larger than 4GB.
+    virtual bool get_to_stream(const dynamic_string &id, vogl::data_stream &dst) const;
+
     virtual vogl::dynamic_string add_buf_compute_unique_id(const void *pData, uint size, const vogl::dynamic_string &prefix, const dynamic_string &ext, const uint64_t *pCRC64 = NULL);
     virtual vogl::dynamic_string add_stream_compute_unique_id(vogl::data_stream &stream, const vogl::dynamic_string &prefix, const dynamic_string &ext, const uint64_t *pCRC64 = NULL);
 
+    // The stream based methods read the stream from its start. The memory, loose file and archive blob managers copy it in
+    // chunks and support 64-bit sizes (the memory blob manager is still limited to 4GB per blob).
     virtual vogl::dynamic_string add_stream_using_id(vogl::data_stream &stream, const vogl::dynamic_string &id);
 
     virtual vogl::dynamic_string add_buf_using_id(const void *pData, uint size, const vogl::dynamic_string &id) = 0;
@@ -98,8 +114,20 @@ public:
 
     virtual vogl::dynamic_string copy_file(vogl_blob_manager &src_blob_manager, const vogl::dynamic_string &src_id, const vogl::dynamic_string &dst_id);
 
+    // The blob manager holding the chunks of any chunked blob manifests stored in this one (see
+    // vogl_chunked_blob_manager), by default this blob manager. Not owned.
+    void set_chunk_source(const vogl_blob_manager *pChunk_source)
+    {
+        m_pChunk_source = pChunk_source;
+    }
+    const vogl_blob_manager &get_chunk_source() const
+    {
+        return m_pChunk_source ? *m_pChunk_source : *this;
+    }
+
 protected:
     uint32 m_flags;
+    const vogl_blob_manager *m_pChunk_source;
 
     bool is_readable() const
     {
@@ -216,6 +244,7 @@ public:
     }
 
     virtual vogl::dynamic_string add_buf_using_id(const void *pData, uint size, const vogl::dynamic_string &id);
+    virtual vogl::dynamic_string add_stream_using_id(vogl::data_stream &stream, const vogl::dynamic_string &id);
 
     virtual vogl::data_stream *open(const dynamic_string &id) const;
     virtual void close(vogl::data_stream *pStream) const;
@@ -269,6 +298,7 @@ public:
     }
 
     virtual vogl::dynamic_string add_buf_using_id(const void *pData, uint size, const vogl::dynamic_string &id);
+    virtual vogl::dynamic_string add_stream_using_id(vogl::data_stream &stream, const vogl::dynamic_string &id);
 
     virtual vogl::data_stream *open(const vogl::dynamic_string &id) const;
     virtual void close(vogl::data_stream *pStream) const;
@@ -281,6 +311,8 @@ public:
 
 private:
     vogl::dynamic_string get_filename(const vogl::dynamic_string &id) const;
+    vogl::dynamic_string get_temp_filename(const vogl::dynamic_string &filename) const;
+    bool commit_temp_file(const vogl::dynamic_string &temp_filename, const vogl::dynamic_string &filename, uint64_t size) const;
 
     dynamic_string m_path;
 };
@@ -291,6 +323,15 @@ private:
 class vogl_archive_blob_manager : public vogl_blob_manager
 {
 public:
+    enum
+    {
+        // Keeps the number of queued compression tasks below the task pool's limit.
+        cMaxBlobsInFlight = 12,
+
+        // Blobs are copied when they're queued, this caps the total size of the copies waiting to be written.
+        cMaxBytesInFlight = 256 * 1024 * 1024
+    };
+
     vogl_archive_blob_manager();
     virtual ~vogl_archive_blob_manager();
 
@@ -316,6 +357,28 @@ public:
 
     // TODO: init_data_stream
 
+    // Compresses the blobs passed to add_buf_using_id() on num_threads worker threads, the finished blobs are appended
+    // to the archive in the order they were added. Must be called after one of the writable init_*() methods, 0
+    // compresses on the calling thread (the default).
+    bool init_compression_threads(uint num_threads);
+
+    inline uint get_num_compression_threads() const
+    {
+        return m_num_threads;
+    }
+
+    // MZ_NO_COMPRESSION stores blobs as-is, which is much faster for data that's already compressed.
+    void set_compression_level(int level);
+
+    inline int get_compression_level() const
+    {
+        return m_level;
+    }
+
+    // Waits for any blobs still being compressed and appends them to the archive. Returns false if any blob added
+    // since init couldn't be written.
+    bool flush_pending_blobs();
+
     virtual bool deinit();
 
     virtual vogl_blob_manager_type_t get_type() const
@@ -324,6 +387,11 @@ public:
     }
 
     virtual vogl::dynamic_string add_buf_using_id(const void *pData, uint size, const vogl::dynamic_string &id);
+    virtual vogl::dynamic_string add_stream_using_id(vogl::data_stream &stream, const vogl::dynamic_string &id);
+
+    // Decompresses straight into data or dst, without the intermediate heap copy open() needs.
+    virtual bool get(const dynamic_string &id, vogl::uint8_vec &data) const;
+    virtual bool get_to_stream(const dynamic_string &id, vogl::data_stream &dst) const;
 
     virtual vogl::data_stream *open(const vogl::dynamic_string &id) const;
     virtual void close(vogl::data_stream *pStream) const;
@@ -338,6 +406,9 @@ private:
     mutable mz_zip_archive m_zip;
     dynamic_string m_archive_filename;
 
+    // m_file_index of blobs which are still being compressed.
+    static const uint cPendingFileIndex = cUINT32_MAX;
+
     struct blob
     {
         vogl::dynamic_string m_id;
@@ -356,8 +427,58 @@ private:
     typedef vogl::map<vogl::dynamic_string, blob, vogl::dynamic_string_less_than_case_sensitive, vogl::dynamic_string_equal_to_case_sensitive> blob_map;
     blob_map m_blobs;
 
+    struct pending_blob
+    {
+        vogl::dynamic_string m_id;
+        vogl::uint8_vec m_uncomp_buf;
+        int m_level;
+
+        // Raw deflate data allocated by tdefl_compress_mem_to_heap(), or NULL to store m_uncomp_buf.
+        void *m_pComp_buf;
+        size_t m_comp_size;
+        mz_uint32 m_crc32;
+
+        // Released once by the compression task when the fields above are final. Only the thread which writes the
+        // archive waits on it, and then sets m_done.
+        semaphore m_compressed;
+        bool m_done;
+
+        pending_blob()
+            : m_compressed(0, 1), m_done(false)
+        {
+        }
+    };
+
+    int m_level;
+
+    task_pool m_tasks;
+    uint m_num_threads;
+
+    // Blobs being compressed, in the order they were added.
+    vogl::vector<pending_blob *> m_pending_blobs;
+    uint64_t m_pending_bytes;
+
+    // Set when a pending blob couldn't be added to the archive, cleared by deinit().
+    bool m_pending_blobs_failed;
+
     vogl::dynamic_string get_filename(const vogl::dynamic_string &id) const;
     bool populate_blob_map();
+
+    bool queue_pending_blob(const void *pData, vogl::data_stream *pStream, uint size, const vogl::dynamic_string &id);
+    void compress_pending_blob(pending_blob *pBlob);
+    void compress_pending_blob_task(uint64_t data, void *pData_ptr);
+    bool is_blob_compressed(pending_blob *pBlob, bool wait);
+    bool write_finished_blobs(bool wait_for_all);
+    void free_pending_blobs();
+
+    const blob *find_written_blob(const vogl::dynamic_string &id) const;
+
+    // The const read methods need pending blobs to be in the archive before they can read them back.
+    inline void flush_pending_blobs_for_read() const
+    {
+        if (m_pending_blobs.size())
+            const_cast<vogl_archive_blob_manager *>(this)->write_finished_blobs(true);
+    }
 };
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -410,4 +531,112 @@ private:
     vogl_blob_manager_ptr_vec m_blob_managers;
 };
 
+//----------------------------------------------------------------------------------------------------------------------
+// class vogl_chunked_blob_manager
+// Splits large blobs into content defined chunks (see find_content_chunk_size()), stores each chunk once in a chunk
+// blob manager, and writes a small manifest listing the chunks under get_manifest_id(id) in a manifest blob manager.
+// Blobs which are mostly identical (two keyframe snapshots of the same texture atlas, say) only cost the chunks that
+// differ. vogl_multi_blob_manager reassembles any manifests it finds (loading the chunks from the chunk source of the
+// blob manager holding the manifest), so readers don't have to know a blob was chunked.
+//----------------------------------------------------------------------------------------------------------------------
+class vogl_chunked_blob_manager : public vogl_blob_manager
+{
+public:
+    enum
+    {
+        cMinChunkSize = 64 * 1024,
+        cAvgChunkSize = 256 * 1024,
+        cMaxChunkSize = 1024 * 1024,
+
+        // Smaller blobs are stored as-is in the manifest blob manager.
+        cMinChunkedBlobSize = 1024 * 1024,
+
+        // Manifests hold a line per chunk, this is enough for blobs of more than 32GB.
+        cMaxManifestSize = 4 * 1024 * 1024
+    };
+
+    vogl_chunked_blob_manager();
+    virtual ~vogl_chunked_blob_manager();
+
+    // Neither blob manager is owned. They may be the same, and the chunk blob manager can be shared by several chunked
+    // blob managers (one per output trace) so chunks are also shared between them.
+    bool init(uint32 flags, vogl_blob_manager *pManifest_blob_manager, vogl_blob_manager *pChunk_blob_manager);
+
+    virtual bool deinit();
+
+    virtual vogl_blob_manager_type_t get_type() const
+    {
+        return cBMTChunked;
+    }
+
+    vogl_blob_manager *get_manifest_blob_manager() const
+    {
+        return m_pManifest_blob_manager;
+    }
+    vogl_blob_manager *get_chunk_blob_manager() const
+    {
+        return m_pChunk_blob_manager;
+    }
+
+    // Total size of the chunked blobs added since init(), and how much of it had to be written as new chunks.
+    uint64_t get_total_chunked_bytes() const
+    {
+        return m_total_chunked_bytes;
+    }
+    uint64_t get_new_chunk_bytes() const
+    {
+        return m_new_chunk_bytes;
+    }
+
+    virtual vogl::dynamic_string add_buf_using_id(const void *pData, uint size, const vogl::dynamic_string &id);
+    virtual vogl::dynamic_string add_stream_using_id(vogl::data_stream &stream, const vogl::dynamic_string &id);
+
+    virtual vogl::data_stream *open(const vogl::dynamic_string &id) const;
+    virtual void close(vogl::data_stream *pStream) const;
+
+    virtual bool does_exist(const vogl::dynamic_string &id) const;
+
+    virtual uint64_t get_size(const vogl::dynamic_string &id) const;
+
+    // Returns the ids of the logical blobs, not the chunks.
+    virtual vogl::dynamic_string_array enumerate() const;
+
+    // Returns true if the blob manager's id is a chunk (these are only useful to reassemble manifests).
+    static bool is_chunk_id(const vogl::dynamic_string &id);
+
+    // Manifests are stored under their blob's id with a prefix, so finding out whether a blob was chunked doesn't
+    // require reading it.
+    static vogl::dynamic_string get_manifest_id(const vogl::dynamic_string &id);
+    static bool is_manifest_id(const vogl::dynamic_string &id);
+
+    // Returns the id of the blob described by a manifest id.
+    static vogl::dynamic_string get_manifest_blob_id(const vogl::dynamic_string &manifest_id);
+
+    // Returns the ids of the blobs in blob_manager, with manifest ids mapped to the ids of the blobs they describe and
+    // chunk ids left out.
+    static vogl::dynamic_string_array enumerate_blobs(const vogl_blob_manager &blob_manager);
+
+    // Reads the reassembled size from a manifest, returns false if stream isn't a manifest.
+    static bool get_manifest_size(vogl::data_stream &stream, uint64_t &size);
+
+    // Returns a read only, seekable stream reassembling the blob described by the manifest, which loads its chunks from
+    // chunk_blob_manager as they're read. Delete it with vogl_delete() (after closing the manifest stream, which isn't
+    // needed once this returns).
+    static vogl::data_stream *open_manifest(vogl::data_stream &manifest_stream, const vogl_blob_manager &chunk_blob_manager, const vogl::dynamic_string &id);
+
+private:
+    vogl_blob_manager *m_pManifest_blob_manager;
+    vogl_blob_manager *m_pChunk_blob_manager;
+
+    uint64_t m_total_chunked_bytes;
+    uint64_t m_new_chunk_bytes;
+
+    // Streams returned by open() which reassemble manifests, everything else open() returns comes from the manifest
+    // blob manager.
+    mutable vogl::vector<vogl::data_stream *> m_reassembled_streams;
+
+    vogl::dynamic_string add_chunk(const uint8 *pData, uint size);
+    vogl::dynamic_string add_manifest(const vogl::dynamic_string_array &chunk_ids, const vogl::uint_vec &chunk_sizes, uint64_t total_size, const vogl::dynamic_string &id);
+};
+
 #endif // VOGL_BLOB_MANAGER_H
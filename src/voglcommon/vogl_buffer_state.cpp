@@ -27,6 +27,7 @@
 #include "vogl_common.h"
 #include "vogl_buffer_state.h"
 #include "vogl_gl_state_snapshot.h"
+#include "vogl_native_snapshot.h"
 
 vogl_buffer_state::vogl_buffer_state()
     : m_snapshot_handle(0),
@@ -254,30 +255,66 @@ void vogl_buffer_state::clear()
     m_is_mapped = false;
 }
 
-bool vogl_buffer_state::serialize(json_node &node, vogl_blob_manager &blob_manager) const
+bool vogl_buffer_state::add_buffer_data_blob(vogl_blob_manager &blob_manager, dynamic_string &blob_id) const
 {
     VOGL_FUNC_TRACER
 
-    if (!m_is_valid)
-        return false;
+    blob_id.clear();
 
-    dynamic_string blob_id;
+    if (!m_buffer_data.size())
+        return true;
 
-    if (m_buffer_data.size())
-    {
-        const char *pBuf_type = utils::map_value(static_cast<int>(m_target), "buf",
-                                                 GL_ARRAY_BUFFER, "buf_vertex",
-                                                 GL_ELEMENT_ARRAY_BUFFER, "buf_index",
-                                                 GL_UNIFORM_BUFFER, "buf_uniform");
+    const char *pBuf_type = utils::map_value(static_cast<int>(m_target), "buf",
+                                             GL_ARRAY_BUFFER, "buf_vertex",
+                                             GL_ELEMENT_ARRAY_BUFFER, "buf_index",
+                                             GL_UNIFORM_BUFFER, "buf_uniform");
+
+    dynamic_string prefix;
+    prefix.format("%s_0x%04X", pBuf_type, m_params.get_value<int>(GL_BUFFER_USAGE));
+
+    // Streamed straight from m_buffer_data, so the blob manager doesn't make its own copy of large buffers.
+    uint64_t crc64 = calc_crc64(CRC64_INIT, m_buffer_data.get_ptr(), m_buffer_data.size());
+
+    buffer_stream buf_stream(m_buffer_data.get_ptr(), m_buffer_data.size());
+    blob_id = blob_manager.add_stream_compute_unique_id(buf_stream, prefix.get_ptr(), "raw", &crc64);
+
+    return !blob_id.is_empty();
+}
 
-        dynamic_string prefix;
-        prefix.format("%s_0x%04X", pBuf_type, m_params.get_value<int>(GL_BUFFER_USAGE));
+// m_params must already be deserialized, the blob must hold exactly GL_BUFFER_SIZE bytes.
+bool vogl_buffer_state::get_buffer_data_blob(const vogl_blob_manager &blob_manager, const dynamic_string &blob_id)
+{
+    VOGL_FUNC_TRACER
+
+    int buf_size = m_params.get_value<int>(GL_BUFFER_SIZE);
 
-        blob_id = blob_manager.add_buf_compute_unique_id(m_buffer_data.get_ptr(), m_buffer_data.size(), prefix.get_ptr(), "raw");
-        if (blob_id.is_empty())
+    m_buffer_data.resize(0);
+
+    if (buf_size)
+    {
+        if ((blob_id.is_empty()) || (!m_buffer_data.try_resize(buf_size)))
+            return false;
+
+        // Streamed straight into m_buffer_data. Blobs larger than the buffer fail to write, smaller ones leave it short.
+        buffer_stream buf_stream(m_buffer_data.get_ptr(), m_buffer_data.size());
+        if ((!blob_manager.get_to_stream(blob_id, buf_stream)) || (buf_stream.get_ofs() != static_cast<uint64_t>(buf_size)))
             return false;
     }
 
+    return true;
+}
+
+bool vogl_buffer_state::serialize(json_node &node, vogl_blob_manager &blob_manager) const
+{
+    VOGL_FUNC_TRACER
+
+    if (!m_is_valid)
+        return false;
+
+    dynamic_string blob_id;
+    if (!add_buffer_data_blob(blob_manager, blob_id))
+        return false;
+
     node.add_key_value("handle", m_snapshot_handle);
     node.add_key_value("target", get_gl_enums().find_gl_name(m_target));
     node.add_key_value("buffer_data_blob_id", blob_id);
@@ -317,25 +354,7 @@ bool vogl_buffer_state::deserialize(const json_node &node, const vogl_blob_manag
             return false;
         }
 
-        int buf_size = m_params.get_value<int>(GL_BUFFER_SIZE);
-
-        if (buf_size)
-        {
-            dynamic_string blob_id(node.value_as_string_ptr("buffer_data_blob_id"));
-            if (blob_id.is_empty())
-            {
-                clear();
-                return false;
-            }
-
-            if (!blob_manager.get(blob_id, m_buffer_data))
-            {
-                clear();
-                return false;
-            }
-        }
-
-        if (buf_size != static_cast<int>(m_buffer_data.size()))
+        if (!get_buffer_data_blob(blob_manager, dynamic_string(node.value_as_string_ptr("buffer_data_blob_id"))))
         {
             clear();
             return false;
@@ -353,6 +372,80 @@ bool vogl_buffer_state::deserialize(const json_node &node, const vogl_blob_manag
     return true;
 }
 
+bool vogl_buffer_state::native_serialize(data_stream_serializer &serializer, vogl_blob_manager &blob_manager) const
+{
+    VOGL_FUNC_TRACER
+
+    if (!m_is_valid)
+        return false;
+
+    dynamic_string blob_id;
+    if (!add_buffer_data_blob(blob_manager, blob_id))
+        return false;
+
+    if ((!vogl_native_write_encoding(serializer, cNSRENative)) ||
+        (!serializer.write_value(static_cast<uint32>(m_snapshot_handle))) ||
+        (!serializer.write_value(static_cast<uint32>(m_target))) ||
+        (!serializer.write_string(blob_id)) ||
+        (!serializer.write_value(m_map_ofs)) ||
+        (!serializer.write_value(m_map_size)) ||
+        (!serializer.write_value(static_cast<uint32>(m_map_access))) ||
+        (!serializer.write_value(static_cast<uint8>(m_map_range))) ||
+        (!serializer.write_value(static_cast<uint8>(m_is_mapped))))
+    {
+        return false;
+    }
+
+    return m_params.native_serialize(serializer);
+}
+
+bool vogl_buffer_state::native_deserialize(data_stream_serializer &serializer, const vogl_blob_manager &blob_manager)
+{
+    VOGL_FUNC_TRACER
+
+    clear();
+
+    vogl_native_snapshot_record_encoding encoding;
+    if (!vogl_native_read_encoding(serializer, encoding))
+        return false;
+
+    if (encoding == cNSREJSON)
+        return vogl_native_read_json_obj_body(serializer, blob_manager, *this);
+
+    uint32 handle, target, map_access;
+    uint8 map_range, is_mapped;
+    dynamic_string blob_id;
+    if ((!serializer.read_object(handle)) ||
+        (!serializer.read_object(target)) ||
+        (!serializer.read_string(blob_id)) ||
+        (!serializer.read_object(m_map_ofs)) ||
+        (!serializer.read_object(m_map_size)) ||
+        (!serializer.read_object(map_access)) ||
+        (!serializer.read_object(map_range)) ||
+        (!serializer.read_object(is_mapped)) ||
+        (!m_params.native_deserialize(serializer)))
+    {
+        clear();
+        return false;
+    }
+
+    m_snapshot_handle = handle;
+    m_target = target;
+    m_map_access = map_access;
+    m_map_range = map_range != 0;
+    m_is_mapped = is_mapped != 0;
+
+    if ((m_target != GL_NONE) && (!get_buffer_data_blob(blob_manager, blob_id)))
+    {
+        clear();
+        return false;
+    }
+
+    m_is_valid = true;
+
+    return true;
+}
+
 // Content comparison, ignores handle.
 bool vogl_buffer_state::compare_restorable_state(const vogl_gl_object_state &rhs_obj) const
 {
@@ -69,6 +69,9 @@ public:
     virtual bool serialize(json_node &node, vogl_blob_manager &blob_manager) const;
     virtual bool deserialize(const json_node &node, const vogl_blob_manager &blob_manager);
 
+    virtual bool native_serialize(data_stream_serializer &serializer, vogl_blob_manager &blob_manager) const;
+    virtual bool native_deserialize(data_stream_serializer &serializer, const vogl_blob_manager &blob_manager);
+
     virtual GLuint64 get_snapshot_handle() const
     {
         return m_snapshot_handle;
@@ -113,6 +116,9 @@ private:
     bool m_is_mapped;
 
     bool m_is_valid;
+
+    bool add_buffer_data_blob(vogl_blob_manager &blob_manager, dynamic_string &blob_id) const;
+    bool get_buffer_data_blob(const vogl_blob_manager &blob_manager, const dynamic_string &blob_id);
 };
 
 namespace vogl
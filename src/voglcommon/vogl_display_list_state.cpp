@@ -100,10 +100,11 @@ bool vogl_display_list::serialize(json_node &node, vogl_blob_manager &blob_manag
         json_node &packets_array = node.add_array("packets");
         for (uint i = 0; i < m_packets.size(); i++)
         {
-            const uint8_vec &packet_buf = m_packets.get_packet_buf(i);
+            const uint8 *pPacket_buf = m_packets.get_packet_ptr(i);
+            const uint packet_buf_size = m_packets.get_packet_size(i);
 
             vogl_trace_packet packet(pCtypes);
-            if (!packet.deserialize(packet_buf.get_ptr(), packet_buf.size(), true))
+            if (!packet.deserialize(pPacket_buf, packet_buf_size, true))
                 return false;
 
             if (!packet.json_serialize(packets_array.add_object(), params))
@@ -141,8 +142,9 @@ bool vogl_display_list::deserialize(const json_node &node, const vogl_blob_manag
         }
 
         vogl_trace_packet packet(pCtypes);
+        uint8_vec packet_buf;
 
-        m_packets.resize(pPackets_array->size());
+        m_packets.reserve(pPackets_array->size());
         for (uint i = 0; i < pPackets_array->size(); i++)
         {
             if (!packet.json_deserialize(*pPackets_array->get_child(i), "<display_list>", &blob_manager))
@@ -151,11 +153,13 @@ bool vogl_display_list::deserialize(const json_node &node, const vogl_blob_manag
                 return false;
             }
 
-            if (!packet.serialize(m_packets.get_packet_buf(i)))
+            if (!packet.serialize(packet_buf))
             {
                 clear();
                 return false;
             }
+
+            m_packets.push_back(packet_buf);
         }
     }
 
@@ -443,7 +447,7 @@ bool vogl_display_list_state::parse_list_and_update_shadows(GLuint handle, pBind
                 continue;
         }
 
-        if (!trace_packet.deserialize(packets.get_packet_buf(packet_index), false))
+        if (!trace_packet.deserialize(packets.get_packet_ptr(packet_index), packets.get_packet_size(packet_index), false))
         {
             vogl_error_printf("%s: Failed parsing GL entrypoint packet in display list %u\n", VOGL_FUNCTION_INFO_CSTR, handle);
             VOGL_ASSERT_ALWAYS;
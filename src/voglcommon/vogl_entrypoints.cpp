@@ -82,11 +82,35 @@ void vogl_init_actual_gl_entrypoints(vogl_gl_get_proc_address_helper_func_ptr_t
 
     g_vogl_pGet_proc_address_helper_func = pGet_proc_address_helper_func;
 
+#define DEF_PROTO_UNIVERSAL(category, ret, ret_type, num_params, name, args, params)                 \
+    {                                                                                                \
+        vogl_void_func_ptr_t pFunc = g_vogl_pGet_proc_address_helper_func(#name);                    \
+        g_vogl_actual_gl_entrypoint_direct_func_ptrs[VOGL_ENTRYPOINT_##name] = pFunc;                \
+        g_vogl_actual_gl_entrypoints.m_##name##_direct = reinterpret_cast<name##_func_ptr_t>(pFunc); \
+    }
+
+#define DEF_PROTO_EXPORTED(category, ret, ret_type, num_params, name, args, params) DEF_PROTO_UNIVERSAL(category, ret, ret_type, num_params, name, arg, params)
+#define DEF_PROTO_EXPORTED_VOID(category, ret, ret_type, num_params, name, args, params) DEF_PROTO_UNIVERSAL(category, ret, ret_type, num_params, name, arg, params)
+
+#define DEF_PROTO_INTERNAL(category, ret, ret_type, num_params, name, args, params) DEF_PROTO_UNIVERSAL(category, ret, ret_type, num_params, name, arg, params)
+#define DEF_PROTO_INTERNAL_VOID(category, ret, ret_type, num_params, name, args, params) DEF_PROTO_UNIVERSAL(category, ret, ret_type, num_params, name, arg, params)
+
+#define DEF_PROTO(exported, category, ret, ret_type, num_params, name, args, params) exported(category, ret, ret_type, num_params, name, args, params)
+#define DEF_PROTO_VOID(exported, category, ret, ret_type, num_params, name, args, params) exported(category, ret, ret_type, num_params, name, args, params)
+#include "gl_glx_wgl_protos.inc"
+#undef DEF_PROTO_UNIVERSAL
+
+    vogl_set_gl_entrypoint_wrapping(wrap_all_gl_calls);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// Function vogl_set_gl_entrypoint_wrapping
+//----------------------------------------------------------------------------------------------------------------------
+void vogl_set_gl_entrypoint_wrapping(bool wrap_all_gl_calls)
+{
 #define DEF_PROTO_UNIVERSAL(category, ret, ret_type, num_params, name, args, params)                                                                          \
     {                                                                                                                                                         \
-        vogl_void_func_ptr_t pFunc = g_vogl_pGet_proc_address_helper_func(#name);                                                                             \
-        g_vogl_actual_gl_entrypoint_direct_func_ptrs[VOGL_ENTRYPOINT_##name] = pFunc;                                                                         \
-        g_vogl_actual_gl_entrypoints.m_##name##_direct = reinterpret_cast<name##_func_ptr_t>(pFunc);                                                          \
+        vogl_void_func_ptr_t pFunc = g_vogl_actual_gl_entrypoint_direct_func_ptrs[VOGL_ENTRYPOINT_##name];                                                    \
         if (pFunc)                                                                                                                                            \
         {                                                                                                                                                     \
             if (wrap_all_gl_calls)                                                                                                                            \
@@ -96,7 +120,7 @@ void vogl_init_actual_gl_entrypoints(vogl_gl_get_proc_address_helper_func_ptr_t
             }                                                                                                                                                 \
             else                                                                                                                                              \
             {                                                                                                                                                 \
-                g_vogl_actual_gl_entrypoint_func_ptrs[VOGL_ENTRYPOINT_##name] = reinterpret_cast<vogl_void_func_ptr_t>(pFunc);                                   \
+                g_vogl_actual_gl_entrypoint_func_ptrs[VOGL_ENTRYPOINT_##name] = pFunc;                                                                          \
                 g_vogl_actual_gl_entrypoints.m_##name = reinterpret_cast<name##_func_ptr_t>(pFunc);                                                            \
             }                                                                                                                                                 \
         }                                                                                                                                                     \
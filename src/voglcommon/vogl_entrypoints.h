@@ -192,6 +192,10 @@ typedef vogl_void_func_ptr_t (*vogl_gl_get_proc_address_helper_func_ptr_t)(const
 // pGet_proc_address_helper_func must be valid
 void vogl_init_actual_gl_entrypoints(vogl_gl_get_proc_address_helper_func_ptr_t pGet_proc_address_helper_func, bool wrap_all_gl_calls = true);
 
+// Points GL_ENTRYPOINT() at either the wrapper funcs (which call the prolog/epilog funcs below) or straight at the driver's
+// funcs, which saves two indirect calls per GL call. Don't call this while other threads may be making GL calls.
+void vogl_set_gl_entrypoint_wrapping(bool wrap_all_gl_calls);
+
 typedef void (*vogl_gl_func_prolog_epilog_func_t)(gl_entrypoint_id_t entrypoint_id, void *pUser_data, void **pStack_data);
 void vogl_set_direct_gl_func_prolog(vogl_gl_func_prolog_epilog_func_t pFunc, void *pUser_data);
 void vogl_set_direct_gl_func_epilog(vogl_gl_func_prolog_epilog_func_t pFunc, void *pUser_data);
@@ -39,6 +39,7 @@
 #include "vogl_sync_object.h"
 #include "vogl_gl_state_snapshot.h"
 #include "vogl_arb_program_state.h"
+#include "vogl_native_snapshot.h"
 
 void vogl_handle_remapper::delete_handle_and_object(vogl_namespace_t handle_namespace, uint64_t from_handle, uint64_t to_handle)
 {
@@ -267,6 +268,20 @@ void vogl_destroy_gl_object(vogl_gl_object_state_type type, GLuint64 handle)
     VOGL_CHECK_GL_ERROR;
 }
 
+bool vogl_gl_object_state::native_serialize(data_stream_serializer &serializer, vogl_blob_manager &blob_manager) const
+{
+    VOGL_FUNC_TRACER
+
+    return vogl_native_write_json_obj(serializer, blob_manager, *this);
+}
+
+bool vogl_gl_object_state::native_deserialize(data_stream_serializer &serializer, const vogl_blob_manager &blob_manager)
+{
+    VOGL_FUNC_TRACER
+
+    return vogl_native_read_json_obj(serializer, blob_manager, *this);
+}
+
 vogl_gl_object_state *vogl_gl_object_state_factory(vogl_gl_object_state_type type)
 {
     VOGL_FUNC_TRACER
@@ -28,6 +28,7 @@
 #define VOGL_GL_OBJECT_H
 
 #include "vogl_common.h"
+#include "vogl_data_stream_serializer.h"
 
 class vogl_blob_manager;
 
@@ -195,6 +196,11 @@ public:
     virtual bool serialize(json_node &node, vogl_blob_manager &blob_manager) const = 0;
     virtual bool deserialize(const json_node &node, const vogl_blob_manager &blob_manager) = 0;
 
+    // Native binary snapshot encoding (see vogl_native_snapshot.h). Each call writes one record. The default
+    // implementations embed the object's JSON serialization, types on the snapshot hot path override them.
+    virtual bool native_serialize(data_stream_serializer &serializer, vogl_blob_manager &blob_manager) const;
+    virtual bool native_deserialize(data_stream_serializer &serializer, const vogl_blob_manager &blob_manager);
+
     virtual bool compare_restorable_state(const vogl_gl_object_state &rhs) const = 0;
 
     virtual bool get_marked_for_deletion() const
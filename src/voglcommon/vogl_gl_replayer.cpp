@@ -28,6 +28,7 @@
 #include "vogl_general_context_state.h"
 #include "vogl_sync_object.h"
 #include "vogl_trace_file_writer.h"
+#include "vogl_native_snapshot.h"
 #include "vogl_texture_format.h"
 #include "gl_glx_wgl_replay_helper_macros.inc"
 #include "vogl_backtrace.h"
@@ -141,12 +142,23 @@ vogl_gl_replayer::vogl_gl_replayer()
       m_cur_trace_context(0),
       m_cur_replay_context(NULL),
       m_pCur_context_state(NULL),
+      m_backbuffer_capture_context(NULL),
+      m_backbuffer_job_slots(cMaxPendingBackbufferJobs, cMaxPendingBackbufferJobs),
+      m_pBackbuffer_hash_file(NULL),
       m_frame_draw_counter(0),
       m_frame_draw_counter_kill_threshold(cUINT64_MAX),
       m_is_valid(false),
       m_pBlob_manager(NULL),
       m_pPending_snapshot(NULL),
       m_delete_pending_snapshot_after_applying(false),
+      m_pLoop_snapshot(NULL),
+      m_loop_trace_context(0),
+      m_loop_general_state_valid(false),
+      m_loop_incremental(false),
+      m_loop_active_texture_unit(0),
+      m_loop_bindings_valid(false),
+      m_loop_repeats_exactly(false),
+      m_loop_tracking_complete(false),
       m_replay_to_trace_remapper(*this)
 {
     VOGL_FUNC_TRACER
@@ -243,6 +255,7 @@ void vogl_gl_replayer::deinit()
 {
     VOGL_FUNC_TRACER
 
+    end_loop();
     destroy_pending_snapshot();
     destroy_contexts();
 
@@ -363,7 +376,19 @@ vogl_gl_replayer::status_t vogl_gl_replayer::process_next_packet(vogl_trace_file
         }
         case cTSPTGLEntrypoint:
         {
-            if (!m_temp_gl_packet.deserialize(trace_reader.get_packet_buf().get_ptr(), trace_reader.get_packet_buf().size(), false))
+            // Prefetching readers have already deserialized the packet on their own thread.
+            const vogl_trace_packet *pDecoded_packet = trace_reader.get_decoded_gl_packet();
+            if ((pDecoded_packet) && (pDecoded_packet->get_ctypes() == &m_trace_gl_ctypes))
+            {
+                status = process_next_packet(*pDecoded_packet);
+                break;
+            }
+
+            // The key/value map is only decoded if the packet's handler asks for it (the reader's packet data stays valid
+            // until the next read).
+            vogl_trace_packet_view packet_view(&m_trace_gl_ctypes);
+            if ((!packet_view.init(trace_reader.get_packet_ptr(), trace_reader.get_packet_size(), false)) ||
+                (!m_temp_gl_packet.deserialize(packet_view, true)))
             {
                 vogl_error_printf("Failed deserializing GL entrypoint packet\n");
                 status = cStatusHardFailure;
@@ -372,6 +397,9 @@ vogl_gl_replayer::status_t vogl_gl_replayer::process_next_packet(vogl_trace_file
 
             status = process_next_packet(m_temp_gl_packet);
 
+            // Don't let the packet refer to the reader's packet data once it's been processed.
+            m_temp_gl_packet.reset();
+
             break;
         }
         case cTSPTEOF:
@@ -682,6 +710,8 @@ void vogl_gl_replayer::destroy_contexts()
 {
     VOGL_FUNC_TRACER
 
+    finish_backbuffer_captures();
+
     if ((m_contexts.size()) && (m_pWindow->get_display()) && (GL_ENTRYPOINT(glXMakeCurrent)) && (GL_ENTRYPOINT(glXDestroyContext)))
     {
         GL_ENTRYPOINT(glXMakeCurrent)(m_pWindow->get_display(), (GLXDrawable)NULL, NULL);
@@ -1456,6 +1486,8 @@ vogl_gl_replayer::status_t vogl_gl_replayer::switch_contexts(vogl_trace_context_
         const Display *dpy = m_pWindow->get_display();
         GLXDrawable drawable = replay_context ? m_pWindow->get_xwindow() : (GLXDrawable)NULL;
 
+        release_backbuffer_capturer(replay_context);
+
         Bool result = GL_ENTRYPOINT(glXMakeCurrent)(dpy, drawable, replay_context);
     #else
         VOGL_VERIFY(!"impl vogl_gl_replayer::switch_contexts for Windows");
@@ -1864,6 +1896,7 @@ vogl_gl_replayer::status_t vogl_gl_replayer::process_pending_make_current()
     #if (VOGL_PLATFORM_HAS_GLX)
         const Display *dpy = m_pWindow->get_display();
         GLXDrawable drawable = replay_context ? m_pWindow->get_xwindow() : (GLXDrawable)NULL;
+        release_backbuffer_capturer(replay_context);
         Bool result = GL_ENTRYPOINT(glXMakeCurrent)(dpy, drawable, replay_context);
     #elif (VOGL_PLATFORM_HAS_WGL)
         VOGL_VERIFY(!"impl vogl_gl_replayer::process_pending_make_current on Windows");
@@ -2022,10 +2055,10 @@ vogl_gl_replayer::status_t vogl_gl_replayer::process_internal_trace_command(cons
             if (cmd_type == "state_snapshot")
             {
                 dynamic_string text_id(kvm.get_string("id"));
-                dynamic_string binary_id(kvm.get_string("binary_id"));
+                dynamic_string binary_id(vogl_gl_state_snapshot::get_blob_id(kvm));
                 if (text_id.is_empty() && binary_id.is_empty())
                 {
-                    process_entrypoint_error("%s: Missing id and binary_id fields in glInternalTraceCommandRAD key_value_map command type: \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, cmd_type.get_ptr());
+                    process_entrypoint_error("%s: Missing id, native_id and binary_id fields in glInternalTraceCommandRAD key_value_map command type: \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, cmd_type.get_ptr());
                     return cStatusHardFailure;
                 }
 
@@ -2072,21 +2105,30 @@ vogl_gl_replayer::status_t vogl_gl_replayer::process_internal_trace_command(cons
 
                     vogl_message_printf("%s: Deserializing state snapshot \"%s\", %u bytes\n", VOGL_FUNCTION_INFO_CSTR, id_to_use.get_ptr(), snapshot_data.size());
 
-                    json_document doc;
+                    pSnapshot = vogl_new(vogl_gl_state_snapshot);
 
                     bool success;
                     if (id_to_use == text_id)
-                        success = doc.deserialize(reinterpret_cast<const char *>(snapshot_data.get_ptr()), snapshot_data.size());
+                    {
+                        json_document doc;
+                        if ((!doc.deserialize(reinterpret_cast<const char *>(snapshot_data.get_ptr()), snapshot_data.size())) || (!doc.get_root()))
+                        {
+                            vogl_delete(pSnapshot);
+                            pSnapshot = NULL;
+
+                            process_entrypoint_error("%s: Failed deserializing JSON snapshot blob data \"%s\"!\n", VOGL_FUNCTION_INFO_CSTR, id_to_use.get_ptr());
+                            return cStatusHardFailure;
+                        }
+
+                        success = pSnapshot->deserialize(*doc.get_root(), *m_pBlob_manager, &m_trace_gl_ctypes);
+                    }
                     else
-                        success = doc.binary_deserialize(snapshot_data);
-                    if (!success || (!doc.get_root()))
                     {
-                        process_entrypoint_error("%s: Failed deserializing JSON snapshot blob data \"%s\"!\n", VOGL_FUNCTION_INFO_CSTR, id_to_use.get_ptr());
-                        return cStatusHardFailure;
+                        // Native or UBJ snapshot
+                        success = pSnapshot->deserialize_blob(snapshot_data, *m_pBlob_manager, &m_trace_gl_ctypes);
                     }
 
-                    pSnapshot = vogl_new(vogl_gl_state_snapshot);
-                    if (!pSnapshot->deserialize(*doc.get_root(), *m_pBlob_manager, &m_trace_gl_ctypes))
+                    if (!success)
                     {
                         vogl_delete(pSnapshot);
                         pSnapshot = NULL;
@@ -2959,9 +3001,7 @@ bool vogl_gl_replayer::dump_framebuffer(
     uint trace_read_framebuffer = 0;
     if (read_framebuffer)
     {
-        gl_handle_hash_map::const_iterator it = get_context_state()->m_framebuffers.search_table_for_value(read_framebuffer);
-        if (it != get_context_state()->m_framebuffers.end())
-            trace_read_framebuffer = it->second;
+        get_context_state()->m_framebuffers.find_key(read_framebuffer, trace_read_framebuffer);
     }
 
     uint trace_texture = replay_texture;
@@ -3627,6 +3667,9 @@ vogl_gl_replayer::status_t vogl_gl_replayer::process_gl_entrypoint_packet(vogl_t
 
     m_last_parsed_call_counter = entrypoint_packet.m_call_counter;
 
+    if ((m_pLoop_snapshot) && (m_loop_incremental) && (!m_loop_tracking_complete))
+        loop_track_packet(trace_packet);
+
     status = process_gl_entrypoint_packet_internal(trace_packet);
 
     if (status != cStatusResizeWindow)
@@ -3692,6 +3735,8 @@ vogl_gl_replayer::status_t vogl_gl_replayer::process_gl_entrypoint_packet_intern
                 process_entrypoint_warning("%s: glXDestroyContext() called while trace context 0x%" PRIx64 " is still current, forcing it to not be current\n",
                                            VOGL_FUNCTION_INFO_CSTR, (uint64_t)trace_context);
 
+                release_backbuffer_capturer(NULL);
+
                 m_cur_trace_context = 0;
                 m_cur_replay_context = 0;
                 m_pCur_context_state = NULL;
@@ -3755,6 +3800,7 @@ vogl_gl_replayer::status_t vogl_gl_replayer::process_gl_entrypoint_packet_intern
                 #if (VOGL_PLATFORM_HAS_GLX)
                     const Display *dpy = m_pWindow->get_display();
                     GLXDrawable drawable = replay_context ? m_pWindow->get_xwindow() : (GLXDrawable)NULL;
+                    release_backbuffer_capturer(replay_context);
                     Bool result = GL_ENTRYPOINT(glXMakeCurrent)(dpy, drawable, replay_context);
                 #elif (VOGL_PLATFORM_HAS_WGL)
                     bool result = true;
@@ -4186,7 +4232,7 @@ vogl_gl_replayer::status_t vogl_gl_replayer::process_gl_entrypoint_packet_intern
 #undef VOGL_SIMPLE_REPLAY_FUNC_PARAM_VALUE
 #undef VOGL_SIMPLE_REPLAY_FUNC_PARAM_SEPERATOR
 #undef VOGL_SIMPLE_REPLAY_FUNC_PARAM_CLIENT_MEMORY
-#undef VOGL_SIMPLE_REPLAY_FUNC_PARAM_END
+#undef VOGL_SIMPLE_REPLAY_FUNC_END
         // -----
         case VOGL_ENTRYPOINT_glXUseXFont:
         {
@@ -7325,6 +7371,10 @@ vogl_gl_replayer::status_t vogl_gl_replayer::process_gl_entrypoint_packet_intern
             GLbitfield access = trace_packet.get_param_value<GLbitfield>(3);
             vogl_trace_ptr_value trace_result_ptr_value = trace_packet.get_return_ptr_value();
 
+            // Sparse maps only carry the blocks that changed, so the rest of the range must keep its contents.
+            if (trace_packet.get_key_value_map().get_bool(string_hash("sparse_map")))
+                access &= ~(GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+
             if (offset != static_cast<uintptr_t>(offset))
             {
                 process_entrypoint_error("%s: offset parameter is too large (%" PRIu64 ")\n", VOGL_FUNCTION_INFO_CSTR, static_cast<uint64_t>(offset));
@@ -7421,7 +7471,32 @@ vogl_gl_replayer::status_t vogl_gl_replayer::process_gl_entrypoint_packet_intern
                 {
                     const key_value_map &unmap_data = trace_packet.get_key_value_map();
 
-                    if (explicit_bit)
+                    int num_sparse_ranges = 0;
+                    if (unmap_data.get_int_if_found(string_hash("sparse_ranges"), num_sparse_ranges))
+                    {
+                        for (int i = 0; i < num_sparse_ranges; i++)
+                        {
+                            int64_t ofs = unmap_data.get_int64(i * 4 + 0);
+                            const uint8_vec *pData = unmap_data.get_blob(i * 4 + 2);
+                            if (!pData)
+                            {
+                                process_entrypoint_error("%s: Failed finding sparse range data in key value map\n", VOGL_FUNCTION_INFO_CSTR);
+                                return cStatusHardFailure;
+                            }
+
+                            if ((ofs < 0) || ((static_cast<uint64_t>(ofs) + pData->size()) > map_desc.m_length))
+                            {
+                                process_entrypoint_error("%s: Sparse range (ofs: %" PRIi64 " size: %u) is outside of the mapped range\n", VOGL_FUNCTION_INFO_CSTR, ofs, pData->size());
+                                return cStatusHardFailure;
+                            }
+
+                            memcpy(static_cast<uint8 *>(map_desc.m_pPtr) + ofs, pData->get_ptr(), pData->size());
+
+                            if (explicit_bit)
+                                GL_ENTRYPOINT(glFlushMappedBufferRange)(target, static_cast<GLintptr>(ofs), pData->size());
+                        }
+                    }
+                    else if (explicit_bit)
                     {
                         int num_flushed_ranges = unmap_data.get_int(string_hash("flushed_ranges"));
 
@@ -9573,58 +9648,221 @@ void vogl_gl_replayer::snapshot_backbuffer()
     VOGL_NOTE_UNUSED(recorded_width);
     VOGL_NOTE_UNUSED(recorded_height);
 
-    m_screenshot_buffer.resize(width * height * 3);
+    if (!m_backbuffer_capturer.is_initialized())
+    {
+        if (!m_backbuffer_tasks.get_num_threads())
+            m_backbuffer_tasks.init(math::clamp<uint>(g_number_of_processors - 1, 1, cMaxPendingBackbufferJobs));
 
-    bool success = vogl_copy_buffer_to_image(m_screenshot_buffer.get_ptr(), m_screenshot_buffer.size(), width, height, GL_RGB, GL_UNSIGNED_BYTE, false, 0, GL_BACK);
-    if (!success)
+        if (!m_backbuffer_capturer.init(cBackbufferCaptureBufs, backbuffer_capture_callback, this, GL_RGB, GL_UNSIGNED_BYTE))
+        {
+            process_entrypoint_error("%s: Failed initializing backbuffer capturer\n", VOGL_FUNCTION_INFO_CSTR);
+            return;
+        }
+
+        m_backbuffer_capture_context = m_cur_replay_context;
+    }
+
+    if (((m_flags & cGLReplayerDumpBackbufferHashes) || (m_flags & cGLReplayerHashBackbuffer)) && (m_backbuffer_hash_filename.has_content()) && (!m_pBackbuffer_hash_file))
+    {
+        m_pBackbuffer_hash_file = vogl_fopen(m_backbuffer_hash_filename.get_ptr(), "a");
+        if (!m_pBackbuffer_hash_file)
+            vogl_error_printf("Failed writing to backbuffer hash file %s\n", m_backbuffer_hash_filename.get_ptr());
+    }
+
+    // The frame index goes in the high dword, so the callback can name and label the output.
+    if (!m_backbuffer_capturer.capture(width, height, 0, GL_BACK, (static_cast<uint64_t>(m_frame_index) << 32) | m_total_swaps))
     {
         process_entrypoint_error("%s: Failed calling glReadPixels() to take screenshot\n", VOGL_FUNCTION_INFO_CSTR);
     }
+}
 
-    if (m_flags & cGLReplayerDumpScreenshots)
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_gl_replayer::backbuffer_capture_callback
+// Called by m_backbuffer_capturer with the PBO mapped, on the replay thread.
+//----------------------------------------------------------------------------------------------------------------------
+bool vogl_gl_replayer::backbuffer_capture_callback(uint width, uint height, uint pitch, size_t size, GLenum pixel_format, GLenum pixel_type, const void *pImage, void *pOpaque, uint64_t frame_index)
+{
+    VOGL_FUNC_TRACER
+
+    VOGL_NOTE_UNUSED(pitch);
+    VOGL_NOTE_UNUSED(pixel_format);
+    VOGL_NOTE_UNUSED(pixel_type);
+
+    vogl_gl_replayer *pReplayer = static_cast<vogl_gl_replayer *>(pOpaque);
+
+    return pReplayer->queue_backbuffer_job(width, height, pImage, size, frame_index);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_gl_replayer::queue_backbuffer_job
+//----------------------------------------------------------------------------------------------------------------------
+bool vogl_gl_replayer::queue_backbuffer_job(uint width, uint height, const void *pImage, size_t size, uint64_t frame_index)
+{
+    VOGL_FUNC_TRACER
+
+    if (size != static_cast<size_t>(width) * height * 3)
     {
-        size_t png_size = 0;
-        void *pPNG_data = tdefl_write_image_to_png_file_in_memory_ex(m_screenshot_buffer.get_ptr(), width, height, 3, &png_size, 1, true);
+        vogl_error_printf("%s: Unexpected backbuffer image size %" PRIu64 "\n", VOGL_FUNCTION_INFO_CSTR, cast_val_to_uint64(size));
+        return false;
+    }
 
-        dynamic_string screenshot_filename(cVarArg, "%s_%07u.png", m_screenshot_prefix.get_ptr(), m_total_swaps);
-        if (!file_utils::write_buf_to_file(screenshot_filename.get_ptr(), pPNG_data, png_size))
-        {
-            process_entrypoint_error("Failed writing PNG screenshot to file %s\n", screenshot_filename.get_ptr());
-        }
-        else
-        {
-            vogl_message_printf("Wrote screenshot to file %s\n", screenshot_filename.get_ptr());
-        }
+    // Bounds how many frames can be waiting to be encoded, each one holds a copy of the backbuffer.
+    m_backbuffer_job_slots.wait();
+
+    backbuffer_capture_job *pJob = vogl_new(backbuffer_capture_job);
+    pJob->m_frame_index = static_cast<uint>(frame_index >> 32);
+    pJob->m_swap_index = static_cast<uint>(frame_index);
+    pJob->m_width = width;
+    pJob->m_height = height;
+    pJob->m_flags = m_flags;
+    pJob->m_pPNG_data = NULL;
+    pJob->m_png_size = 0;
+    pJob->m_hash = 0;
+    pJob->m_complete = false;
+
+    pJob->m_pixels.resize(static_cast<uint>(size));
+    memcpy(pJob->m_pixels.get_ptr(), pImage, size);
+
+    if (m_flags & cGLReplayerDumpScreenshots)
+        pJob->m_screenshot_filename.format("%s_%07u.png", m_screenshot_prefix.get_ptr(), pJob->m_swap_index);
 
-        mz_free(pPNG_data);
+    {
+        scoped_mutex lock(m_backbuffer_job_mutex);
+        m_backbuffer_jobs.push_back(pJob);
     }
 
-    if ((m_flags & cGLReplayerDumpBackbufferHashes) || (m_flags & cGLReplayerHashBackbuffer))
+    if (!m_backbuffer_tasks.queue_object_task(this, &vogl_gl_replayer::process_backbuffer_job, 0, pJob))
+        process_backbuffer_job(0, pJob);
+
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_gl_replayer::process_backbuffer_job
+// Runs on m_backbuffer_tasks.
+//----------------------------------------------------------------------------------------------------------------------
+void vogl_gl_replayer::process_backbuffer_job(uint64_t data, void *pData_ptr)
+{
+    VOGL_FUNC_TRACER
+
+    VOGL_NOTE_UNUSED(data);
+
+    backbuffer_capture_job *pJob = static_cast<backbuffer_capture_job *>(pData_ptr);
+
+    if (pJob->m_flags & cGLReplayerDumpScreenshots)
     {
-        uint64_t backbuffer_crc64;
+        pJob->m_pPNG_data = tdefl_write_image_to_png_file_in_memory_ex(pJob->m_pixels.get_ptr(), pJob->m_width, pJob->m_height, 3, &pJob->m_png_size, 1, true);
+    }
 
-        if (m_flags & cGLReplayerSumHashing)
+    if ((pJob->m_flags & cGLReplayerDumpBackbufferHashes) || (pJob->m_flags & cGLReplayerHashBackbuffer))
+    {
+        if (pJob->m_flags & cGLReplayerSumHashing)
         {
-            backbuffer_crc64 = calc_sum64(m_screenshot_buffer.get_ptr(), m_screenshot_buffer.size());
+            pJob->m_hash = calc_sum64(pJob->m_pixels.get_ptr(), pJob->m_pixels.size());
         }
         else
         {
-            backbuffer_crc64 = calc_crc64(CRC64_INIT, m_screenshot_buffer.get_ptr(), m_screenshot_buffer.size());
+            pJob->m_hash = calc_crc64(CRC64_INIT, pJob->m_pixels.get_ptr(), pJob->m_pixels.size());
         }
+    }
+
+    pJob->m_pixels.clear();
+
+    scoped_mutex lock(m_backbuffer_job_mutex);
+
+    pJob->m_complete = true;
+
+    write_completed_backbuffer_jobs();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_gl_replayer::write_completed_backbuffer_jobs
+// Caller must hold m_backbuffer_job_mutex.
+//----------------------------------------------------------------------------------------------------------------------
+void vogl_gl_replayer::write_completed_backbuffer_jobs()
+{
+    VOGL_FUNC_TRACER
 
-        vogl_printf("Frame %u hash: 0x%016" PRIX64 "\n", m_frame_index, backbuffer_crc64);
+    while ((m_backbuffer_jobs.size()) && (m_backbuffer_jobs[0]->m_complete))
+    {
+        backbuffer_capture_job *pJob = m_backbuffer_jobs[0];
+        m_backbuffer_jobs.erase(0U);
 
-        if (m_backbuffer_hash_filename.has_content())
+        if (pJob->m_flags & cGLReplayerDumpScreenshots)
         {
-            FILE *pFile = vogl_fopen(m_backbuffer_hash_filename.get_ptr(), "a");
-            if (!pFile)
-                vogl_error_printf("Failed writing to backbuffer hash file %s\n", m_backbuffer_hash_filename.get_ptr());
+            if ((!pJob->m_pPNG_data) || (!file_utils::write_buf_to_file(pJob->m_screenshot_filename.get_ptr(), pJob->m_pPNG_data, pJob->m_png_size)))
+            {
+                vogl_error_printf("Failed writing PNG screenshot to file %s\n", pJob->m_screenshot_filename.get_ptr());
+            }
             else
             {
-                vogl_fprintf(pFile, "0x%016" PRIX64 "\n", cast_val_to_uint64(backbuffer_crc64));
-                vogl_fclose(pFile);
+                vogl_message_printf("Wrote screenshot to file %s\n", pJob->m_screenshot_filename.get_ptr());
             }
+
+            mz_free(pJob->m_pPNG_data);
+        }
+
+        if ((pJob->m_flags & cGLReplayerDumpBackbufferHashes) || (pJob->m_flags & cGLReplayerHashBackbuffer))
+        {
+            vogl_printf("Frame %u hash: 0x%016" PRIX64 "\n", pJob->m_frame_index, pJob->m_hash);
+
+            if (m_pBackbuffer_hash_file)
+                vogl_fprintf(m_pBackbuffer_hash_file, "0x%016" PRIX64 "\n", cast_val_to_uint64(pJob->m_hash));
         }
+
+        vogl_delete(pJob);
+
+        m_backbuffer_job_slots.release();
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_gl_replayer::release_backbuffer_capturer
+// Must be called before switching away from the context the PBO's were created in. They can only be read back while
+// it's still current.
+//----------------------------------------------------------------------------------------------------------------------
+void vogl_gl_replayer::release_backbuffer_capturer(GLXContext next_replay_context)
+{
+    VOGL_FUNC_TRACER
+
+    if (!m_backbuffer_capturer.is_initialized())
+        return;
+
+    if ((next_replay_context) && (next_replay_context == m_backbuffer_capture_context))
+        return;
+
+    bool capture_context_is_current = (m_cur_replay_context) && (m_cur_replay_context == m_backbuffer_capture_context);
+    if ((!capture_context_is_current) && (m_backbuffer_capturer.get_num_busy_buffers()))
+    {
+        vogl_warning_printf("%s: Backbuffer capture context is no longer current, dropping %u pending screenshot(s)\n", VOGL_FUNCTION_INFO_CSTR, m_backbuffer_capturer.get_num_busy_buffers());
+    }
+
+    m_backbuffer_capturer.deinit(capture_context_is_current);
+    m_backbuffer_capture_context = NULL;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_gl_replayer::finish_backbuffer_captures
+// Reads back any pending PBO's, and waits until every screenshot and hash has been written.
+//----------------------------------------------------------------------------------------------------------------------
+void vogl_gl_replayer::finish_backbuffer_captures()
+{
+    VOGL_FUNC_TRACER
+
+    release_backbuffer_capturer(NULL);
+
+    m_backbuffer_tasks.join();
+
+    {
+        scoped_mutex lock(m_backbuffer_job_mutex);
+        VOGL_ASSERT(m_backbuffer_jobs.is_empty());
+        write_completed_backbuffer_jobs();
+    }
+
+    if (m_pBackbuffer_hash_file)
+    {
+        vogl_fclose(m_pBackbuffer_hash_file);
+        m_pBackbuffer_hash_file = NULL;
     }
 }
 
@@ -9645,12 +9883,12 @@ bool vogl_gl_replayer::replay_to_trace_handle_remapper::is_valid_handle(vogl_nam
         case VOGL_NAMESPACE_VERTEX_ARRAYS:
         {
             VOGL_ASSERT(replay_handle32 == replay_handle);
-            return (m_replayer.get_context_state()->m_vertex_array_objects.search_table_for_value_get_count(replay_handle32) != 0);
+            return m_replayer.get_context_state()->m_vertex_array_objects.contains_value(replay_handle32);
         }
         case VOGL_NAMESPACE_FRAMEBUFFERS:
         {
             VOGL_ASSERT(replay_handle32 == replay_handle);
-            return (m_replayer.get_context_state()->m_framebuffers.search_table_for_value_get_count(replay_handle32) != 0);
+            return m_replayer.get_context_state()->m_framebuffers.contains_value(replay_handle32);
         }
         case VOGL_NAMESPACE_TEXTURES:
         {
@@ -9665,12 +9903,12 @@ bool vogl_gl_replayer::replay_to_trace_handle_remapper::is_valid_handle(vogl_nam
         case VOGL_NAMESPACE_QUERIES:
         {
             VOGL_ASSERT(replay_handle32 == replay_handle);
-            return (m_replayer.get_shared_state()->m_queries.search_table_for_value_get_count(replay_handle32) != 0);
+            return m_replayer.get_shared_state()->m_queries.contains_value(replay_handle32);
         }
         case VOGL_NAMESPACE_SAMPLERS:
         {
             VOGL_ASSERT(replay_handle32 == replay_handle);
-            return (m_replayer.get_shared_state()->m_sampler_objects.search_table_for_value_get_count(replay_handle32) != 0);
+            return m_replayer.get_shared_state()->m_sampler_objects.contains_value(replay_handle32);
         }
         case VOGL_NAMESPACE_PROGRAMS:
         {
@@ -9685,7 +9923,7 @@ bool vogl_gl_replayer::replay_to_trace_handle_remapper::is_valid_handle(vogl_nam
         case VOGL_NAMESPACE_BUFFERS:
         {
             VOGL_ASSERT(replay_handle32 == replay_handle);
-            return m_replayer.get_shared_state()->m_buffers.search_table_for_value_get_count(replay_handle32);
+            return m_replayer.get_shared_state()->m_buffers.contains_value(replay_handle32);
         }
         case VOGL_NAMESPACE_SYNCS:
         {
@@ -9695,7 +9933,7 @@ bool vogl_gl_replayer::replay_to_trace_handle_remapper::is_valid_handle(vogl_nam
         case VOGL_NAMESPACE_PROGRAM_ARB:
         {
             VOGL_ASSERT(replay_handle32 == replay_handle);
-            return m_replayer.get_shared_state()->m_arb_programs.search_table_for_value_get_count(replay_handle32) != 0;
+            return m_replayer.get_shared_state()->m_arb_programs.contains_value(replay_handle32);
         }
         default:
             break;
@@ -9948,10 +10186,11 @@ bool vogl_gl_replayer::determine_used_program_handles(const vogl_trace_packet_ar
         if (trim_packets.get_packet_type(packet_index) != cTSPTGLEntrypoint)
             continue;
 
-        const uint8_vec &packet_buf = trim_packets.get_packet_buf(packet_index);
+        const uint8 *pPacket_buf = trim_packets.get_packet_ptr(packet_index);
+        const uint packet_buf_size = trim_packets.get_packet_size(packet_index);
 
         // Important note: This purposesly doesn't process ctype packets, because they don't really do anything and I'm going to be redesigning the ctype/entrypoint stuff anyway so they are always processed after SOF.
-        if (!m_temp2_gl_packet.deserialize(packet_buf.get_ptr(), packet_buf.size(), true))
+        if (!m_temp2_gl_packet.deserialize(pPacket_buf, packet_buf_size, true))
             return false;
 
         GLuint trace_handle = 0;
@@ -9983,13 +10222,13 @@ bool vogl_gl_replayer::determine_used_program_handles(const vogl_trace_packet_ar
 //----------------------------------------------------------------------------------------------------------------------
 // vogl_replayer::fill_replay_handle_hash_set
 //----------------------------------------------------------------------------------------------------------------------
-void vogl_gl_replayer::fill_replay_handle_hash_set(vogl_handle_hash_set &replay_handle_hash, const gl_handle_hash_map &trace_to_replay_hash)
+void vogl_gl_replayer::fill_replay_handle_hash_set(vogl_handle_hash_set &replay_handle_hash, const gl_handle_bimap &trace_to_replay_map)
 {
     VOGL_FUNC_TRACER
 
     replay_handle_hash.reset();
-    replay_handle_hash.reserve(trace_to_replay_hash.size());
-    for (gl_handle_hash_map::const_iterator it = trace_to_replay_hash.begin(); it != trace_to_replay_hash.end(); ++it)
+    replay_handle_hash.reserve(trace_to_replay_map.size());
+    for (gl_handle_bimap::const_iterator it = trace_to_replay_map.begin(); it != trace_to_replay_map.end(); ++it)
     {
         // Insert replay handles into destination hash table
         bool success = replay_handle_hash.insert(it->second).second;
@@ -10252,6 +10491,12 @@ void vogl_gl_replayer::reset_state()
     destroy_pending_snapshot();
     destroy_contexts();
 
+    // Every replay handle the loop tracker knows about is gone, so the next loop restore must be a full one.
+    clear_loop_tracking();
+    m_loop_general_state_valid = false;
+    m_loop_incremental = false;
+    m_loop_tracking_complete = false;
+
     m_pending_make_current_packet.clear();
     m_pending_window_resize_width = 0;
     m_pending_window_resize_height = 0;
@@ -10790,6 +11035,100 @@ bool vogl_gl_replayer::trace_to_replay_handle_remapper::determine_to_object_targ
     return false;
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_replayer::restore_object
+// Restores a single snapshot object into restore_handle (creating a new GL object if restore_handle is 0).
+//----------------------------------------------------------------------------------------------------------------------
+vogl_gl_replayer::status_t vogl_gl_replayer::restore_object(vogl_handle_remapper &trace_to_replay_remapper, const vogl_gl_object_state *pState_obj, GLuint64 &restore_handle)
+{
+    VOGL_FUNC_TRACER
+
+    if (!pState_obj->restore(m_pCur_context_state->m_context_info, trace_to_replay_remapper, restore_handle))
+    {
+        vogl_error_printf("%s: Failed restoring object type %s trace handle 0x%" PRIX64 " restore handle 0x%" PRIX64 "\n", VOGL_FUNCTION_INFO_CSTR, get_gl_object_state_type_str(pState_obj->get_type()), (uint64_t)pState_obj->get_snapshot_handle(), (uint64_t)restore_handle);
+        return cStatusHardFailure;
+    }
+
+    VOGL_ASSERT(trace_to_replay_remapper.remap_handle(pState_obj->get_handle_namespace(), pState_obj->get_snapshot_handle()) == restore_handle);
+
+    switch (pState_obj->get_type())
+    {
+        case cGLSTQuery:
+        {
+            const vogl_query_state *pQuery = static_cast<const vogl_query_state *>(pState_obj);
+
+            VOGL_ASSERT(restore_handle <= cUINT32_MAX);
+            get_shared_state()->m_query_targets[static_cast<GLuint>(restore_handle)] = pQuery->get_target();
+
+            break;
+        }
+        case cGLSTProgram:
+        {
+            const vogl_program_state *pProg = static_cast<const vogl_program_state *>(pState_obj);
+
+            if (pProg->has_link_time_snapshot())
+            {
+                vogl_program_state link_snapshot(*pProg->get_link_time_snapshot());
+                if (!link_snapshot.remap_handles(trace_to_replay_remapper))
+                {
+                    vogl_error_printf("%s: Failed remapping handles in program link time snapshot, trace handle 0x%" PRIX64 " restore handle 0x%" PRIX64 "\n", VOGL_FUNCTION_INFO_CSTR, (uint64_t)pState_obj->get_snapshot_handle(), (uint64_t)restore_handle);
+                }
+                else
+                {
+                    get_shared_state()->m_shadow_state.m_linked_programs.add_snapshot(static_cast<uint32>(restore_handle), link_snapshot);
+                }
+            }
+
+            break;
+        }
+        case cGLSTBuffer:
+        {
+            const vogl_buffer_state *pBuf = static_cast<const vogl_buffer_state *>(pState_obj);
+
+            // Check if the buffer was mapped during the snapshot, if so remap it and record the ptr in the replayer's context shadow.
+            if (pBuf->get_is_mapped())
+            {
+                vogl_mapped_buffer_desc map_desc;
+                map_desc.m_buffer = static_cast<GLuint>(restore_handle);
+                map_desc.m_target = pBuf->get_target();
+                map_desc.m_offset = pBuf->get_map_ofs();
+                map_desc.m_length = pBuf->get_map_size();
+                map_desc.m_access = pBuf->get_map_access();
+                map_desc.m_range = pBuf->get_is_map_range();
+
+                GLuint prev_handle = vogl_get_bound_gl_buffer(map_desc.m_target);
+
+                GL_ENTRYPOINT(glBindBuffer)(map_desc.m_target, map_desc.m_buffer);
+                VOGL_CHECK_GL_ERROR;
+
+                uint access = map_desc.m_access & ~(GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+                if (map_desc.m_range)
+                {
+                    map_desc.m_pPtr = GL_ENTRYPOINT(glMapBufferRange)(map_desc.m_target, static_cast<GLintptr>(map_desc.m_offset), static_cast<GLintptr>(map_desc.m_length), access);
+                    VOGL_CHECK_GL_ERROR;
+                }
+                else
+                {
+                    map_desc.m_pPtr = GL_ENTRYPOINT(glMapBuffer)(map_desc.m_target, access);
+                    VOGL_CHECK_GL_ERROR;
+                }
+
+                GL_ENTRYPOINT(glBindBuffer)(map_desc.m_target, prev_handle);
+                VOGL_CHECK_GL_ERROR;
+
+                vogl_mapped_buffer_desc_vec &mapped_bufs = get_shared_state()->m_shadow_state.m_mapped_buffers;
+                mapped_bufs.push_back(map_desc);
+            }
+
+            break;
+        }
+        default:
+            break;
+    }
+
+    return cStatusOK;
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 // vogl_replayer::restore_objects
 //----------------------------------------------------------------------------------------------------------------------
@@ -10820,11 +11159,9 @@ vogl_gl_replayer::status_t vogl_gl_replayer::restore_objects(
             continue;
 
         GLuint64 restore_handle = 0;
-        if (!pState_obj->restore(m_pCur_context_state->m_context_info, trace_to_replay_remapper, restore_handle))
-        {
-            vogl_error_printf("%s: Failed restoring object type %s object index %u trace handle 0x%" PRIX64 " restore handle 0x%" PRIX64 "\n", VOGL_FUNCTION_INFO_CSTR, get_gl_object_state_type_str(state_type), i, (uint64_t)pState_obj->get_snapshot_handle(), (uint64_t)restore_handle);
-            return cStatusHardFailure;
-        }
+        status_t status = restore_object(trace_to_replay_remapper, pState_obj, restore_handle);
+        if (status != cStatusOK)
+            return status;
         n++;
 
         if (pState_obj->get_marked_for_deletion())
@@ -10832,87 +11169,10 @@ vogl_gl_replayer::status_t vogl_gl_replayer::restore_objects(
             objects_to_delete.push_back(pState_obj);
         }
 
-        VOGL_ASSERT(trace_to_replay_remapper.remap_handle(pState_obj->get_handle_namespace(), pState_obj->get_snapshot_handle()) == restore_handle);
-
-        switch (pState_obj->get_type())
+        if ((state_type == cGLSTProgram) && (m_flags & cGLReplayerVerboseMode))
         {
-            case cGLSTQuery:
-            {
-                const vogl_query_state *pQuery = static_cast<const vogl_query_state *>(pState_obj);
-
-                VOGL_ASSERT(restore_handle <= cUINT32_MAX);
-                get_shared_state()->m_query_targets[static_cast<GLuint>(restore_handle)] = pQuery->get_target();
-
-                break;
-            }
-            case cGLSTProgram:
-            {
-                const vogl_program_state *pProg = static_cast<const vogl_program_state *>(pState_obj);
-
-                if (pProg->has_link_time_snapshot())
-                {
-                    vogl_program_state link_snapshot(*pProg->get_link_time_snapshot());
-                    if (!link_snapshot.remap_handles(trace_to_replay_remapper))
-                    {
-                        vogl_error_printf("%s: Failed remapping handles in program link time snapshot, object index %u trace handle 0x%" PRIX64 " restore handle 0x%" PRIX64 "\n", VOGL_FUNCTION_INFO_CSTR, i, (uint64_t)pState_obj->get_snapshot_handle(), (uint64_t)restore_handle);
-                    }
-                    else
-                    {
-                        get_shared_state()->m_shadow_state.m_linked_programs.add_snapshot(static_cast<uint32>(restore_handle), link_snapshot);
-                    }
-                }
-
-                if (m_flags & cGLReplayerVerboseMode)
-                {
-                    if ((n & 255) == 255)
-                        vogl_printf("%s: Restored %u programs\n", VOGL_FUNCTION_INFO_CSTR, n);
-                }
-
-                break;
-            }
-            case cGLSTBuffer:
-            {
-                const vogl_buffer_state *pBuf = static_cast<const vogl_buffer_state *>(pState_obj);
-
-                // Check if the buffer was mapped during the snapshot, if so remap it and record the ptr in the replayer's context shadow.
-                if (pBuf->get_is_mapped())
-                {
-                    vogl_mapped_buffer_desc map_desc;
-                    map_desc.m_buffer = static_cast<GLuint>(restore_handle);
-                    map_desc.m_target = pBuf->get_target();
-                    map_desc.m_offset = pBuf->get_map_ofs();
-                    map_desc.m_length = pBuf->get_map_size();
-                    map_desc.m_access = pBuf->get_map_access();
-                    map_desc.m_range = pBuf->get_is_map_range();
-
-                    GLuint prev_handle = vogl_get_bound_gl_buffer(map_desc.m_target);
-
-                    GL_ENTRYPOINT(glBindBuffer)(map_desc.m_target, map_desc.m_buffer);
-                    VOGL_CHECK_GL_ERROR;
-
-                    uint access = map_desc.m_access & ~(GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
-                    if (map_desc.m_range)
-                    {
-                        map_desc.m_pPtr = GL_ENTRYPOINT(glMapBufferRange)(map_desc.m_target, static_cast<GLintptr>(map_desc.m_offset), static_cast<GLintptr>(map_desc.m_length), access);
-                        VOGL_CHECK_GL_ERROR;
-                    }
-                    else
-                    {
-                        map_desc.m_pPtr = GL_ENTRYPOINT(glMapBuffer)(map_desc.m_target, access);
-                        VOGL_CHECK_GL_ERROR;
-                    }
-
-                    GL_ENTRYPOINT(glBindBuffer)(map_desc.m_target, prev_handle);
-                    VOGL_CHECK_GL_ERROR;
-
-                    vogl_mapped_buffer_desc_vec &mapped_bufs = get_shared_state()->m_shadow_state.m_mapped_buffers;
-                    mapped_bufs.push_back(map_desc);
-                }
-
-                break;
-            }
-            default:
-                break;
+            if ((n & 255) == 255)
+                vogl_printf("%s: Restored %u programs\n", VOGL_FUNCTION_INFO_CSTR, n);
         }
     }
 
@@ -11068,9 +11328,10 @@ vogl_gl_replayer::status_t vogl_gl_replayer::restore_display_lists(vogl_handle_r
                         continue;
                     }
 
-                    const uint8_vec &packet_buf = packets.get_packet_buf(packet_index);
+                    const uint8 *pPacket_buf = packets.get_packet_ptr(packet_index);
+                    const uint packet_buf_size = packets.get_packet_size(packet_index);
 
-                    if (!m_temp2_gl_packet.deserialize(packet_buf, true))
+                    if (!m_temp2_gl_packet.deserialize(pPacket_buf, packet_buf_size, true))
                     {
                         vogl_error_printf("%s: Failed deserializing display list at packet index %u, can't fully recreate trace display list %u!\n", VOGL_FUNCTION_INFO_CSTR, packet_index, trace_handle);
                         continue;
@@ -11139,18 +11400,22 @@ handle_failure:
 
 //----------------------------------------------------------------------------------------------------------------------
 // vogl_replayer::restore_general_state
+// restore_state_vector may be false when the caller knows the context's general state vector already matches the snapshot.
 //----------------------------------------------------------------------------------------------------------------------
-vogl_gl_replayer::status_t vogl_gl_replayer::restore_general_state(vogl_handle_remapper &trace_to_replay_remapper, const vogl_gl_state_snapshot &snapshot, const vogl_context_snapshot &context_snapshot)
+vogl_gl_replayer::status_t vogl_gl_replayer::restore_general_state(vogl_handle_remapper &trace_to_replay_remapper, const vogl_gl_state_snapshot &snapshot, const vogl_context_snapshot &context_snapshot, bool restore_state_vector)
 {
     VOGL_FUNC_TRACER
 
     VOGL_NOTE_UNUSED(snapshot);
 
-    vogl_general_context_state::vogl_persistent_restore_state persistent_restore_state;
-    persistent_restore_state.m_pSelect_buffer = &m_pCur_context_state->m_select_buffer;
+    if (restore_state_vector)
+    {
+        vogl_general_context_state::vogl_persistent_restore_state persistent_restore_state;
+        persistent_restore_state.m_pSelect_buffer = &m_pCur_context_state->m_select_buffer;
 
-    if (!context_snapshot.get_general_state().restore(m_pCur_context_state->m_context_info, trace_to_replay_remapper, persistent_restore_state))
-        return cStatusHardFailure;
+        if (!context_snapshot.get_general_state().restore(m_pCur_context_state->m_context_info, trace_to_replay_remapper, persistent_restore_state))
+            return cStatusHardFailure;
+    }
 
     if (!m_pCur_context_state->m_context_info.is_core_profile())
     {
@@ -11492,6 +11757,7 @@ vogl_gl_replayer::status_t vogl_gl_replayer::restore_context(vogl_handle_remappe
 
         #if (VOGL_PLATFORM_HAS_GLX)
             GLXDrawable drawable = m_pWindow->get_xwindow();
+            release_backbuffer_capturer(replay_context);
             Bool result = GL_ENTRYPOINT(glXMakeCurrent)(dpy, drawable, replay_context);
         #elif (VOGL_PLATFORM_HAS_WGL)
             bool result = false;
@@ -11698,11 +11964,1697 @@ handle_error:
 }
 
 //----------------------------------------------------------------------------------------------------------------------
-// vogl_gl_replayer::write_trim_file_internal
+// Loop replay helpers
 //----------------------------------------------------------------------------------------------------------------------
-bool vogl_gl_replayer::write_trim_file_internal(vogl_trace_packet_array &trim_packets, const dynamic_string &trim_filename, vogl_trace_file_reader &trace_reader, bool optimize_snapshot, dynamic_string *pSnapshot_id)
+enum
 {
-    // Open the output trace
+    cLoopEPBind = 1,              // names objects without writing them (glBind*, glUseProgram, glCallList(s))
+    cLoopEPReadOnly = 2,          // doesn't modify any object (glGet*, glIs*, most window system calls)
+    cLoopEPUnsupported = 4,       // switches or creates contexts, or creates display lists through the window system
+    cLoopEPWritesUniforms = 8,    // writes the uniforms of the current (or named) program
+    cLoopEPWritesCurVAO = 16,     // writes the currently bound vertex array object
+    cLoopEPWritesPackBuffer = 32, // writes the currently bound pixel pack buffer
+    cLoopEPUpdatesBindings = 64   // changes the bindings loop_touch_bound_object() looks up, see loop_track_bindings()
+};
+
+static uint8 g_loop_entrypoint_flags[VOGL_NUM_ENTRYPOINTS];
+static int8 g_loop_entrypoint_target_param[VOGL_NUM_ENTRYPOINTS];
+static bool g_loop_entrypoint_tables_initialized;
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_loop_get_entrypoint_flags
+// Classifies an entrypoint for the loop replay tracker. The calls whose signature doesn't say what they do are listed
+// explicitly, the rest are classified from their descriptors: calls which return data are queries, and calls taking a
+// uniform location write uniforms. Anything else is assumed to write the objects named by its params, and the object
+// bound to its "target" param.
+//----------------------------------------------------------------------------------------------------------------------
+static uint vogl_loop_get_entrypoint_flags(gl_entrypoint_id_t id)
+{
+    switch (id)
+    {
+        // These create, destroy or share contexts or display lists
+        case VOGL_ENTRYPOINT_glXCreateContext:
+        case VOGL_ENTRYPOINT_glXCreateNewContext:
+        case VOGL_ENTRYPOINT_glXCreateContextAttribsARB:
+        case VOGL_ENTRYPOINT_glXDestroyContext:
+        case VOGL_ENTRYPOINT_glXCopyContext:
+        case VOGL_ENTRYPOINT_glXImportContextEXT:
+        case VOGL_ENTRYPOINT_glXFreeContextEXT:
+        case VOGL_ENTRYPOINT_glXUseXFont:
+        case VOGL_ENTRYPOINT_wglCreateContext:
+        case VOGL_ENTRYPOINT_wglCreateLayerContext:
+        case VOGL_ENTRYPOINT_wglCreateContextAttribsARB:
+        case VOGL_ENTRYPOINT_wglCreateAssociatedContextAMD:
+        case VOGL_ENTRYPOINT_wglCreateAssociatedContextAttribsAMD:
+        case VOGL_ENTRYPOINT_wglDeleteContext:
+        case VOGL_ENTRYPOINT_wglDeleteAssociatedContextAMD:
+        case VOGL_ENTRYPOINT_wglCopyContext:
+        case VOGL_ENTRYPOINT_wglBlitContextFramebufferAMD:
+        case VOGL_ENTRYPOINT_wglShareLists:
+        case VOGL_ENTRYPOINT_wglUseFontBitmapsA:
+        case VOGL_ENTRYPOINT_wglUseFontBitmapsW:
+        case VOGL_ENTRYPOINT_glNewList:
+            return cLoopEPUnsupported;
+
+        case VOGL_ENTRYPOINT_glBindTexture:
+        case VOGL_ENTRYPOINT_glBindTextureEXT:
+        case VOGL_ENTRYPOINT_glBindBuffer:
+        case VOGL_ENTRYPOINT_glBindBufferARB:
+        case VOGL_ENTRYPOINT_glBindBufferBase:
+        case VOGL_ENTRYPOINT_glBindBufferBaseEXT:
+        case VOGL_ENTRYPOINT_glBindBufferBaseNV:
+        case VOGL_ENTRYPOINT_glBindBufferRange:
+        case VOGL_ENTRYPOINT_glBindBufferRangeEXT:
+        case VOGL_ENTRYPOINT_glBindBufferRangeNV:
+        case VOGL_ENTRYPOINT_glBindBufferOffsetEXT:
+        case VOGL_ENTRYPOINT_glBindBufferOffsetNV:
+        case VOGL_ENTRYPOINT_glBindFramebuffer:
+        case VOGL_ENTRYPOINT_glBindFramebufferEXT:
+        case VOGL_ENTRYPOINT_glBindRenderbuffer:
+        case VOGL_ENTRYPOINT_glBindRenderbufferEXT:
+        case VOGL_ENTRYPOINT_glBindVertexArray:
+        case VOGL_ENTRYPOINT_glBindVertexArrayAPPLE:
+        // Display lists may bind objects too
+        case VOGL_ENTRYPOINT_glCallList:
+        case VOGL_ENTRYPOINT_glCallLists:
+            return cLoopEPBind | cLoopEPUpdatesBindings;
+
+        case VOGL_ENTRYPOINT_glUseProgram:
+        case VOGL_ENTRYPOINT_glUseProgramObjectARB:
+        case VOGL_ENTRYPOINT_glUseProgramStages:
+        case VOGL_ENTRYPOINT_glBindProgramPipeline:
+        case VOGL_ENTRYPOINT_glBindProgramARB:
+        case VOGL_ENTRYPOINT_glBindProgramNV:
+        case VOGL_ENTRYPOINT_glBindSampler:
+        case VOGL_ENTRYPOINT_glBindTransformFeedback:
+        case VOGL_ENTRYPOINT_glBindTransformFeedbackNV:
+            return cLoopEPBind;
+
+        case VOGL_ENTRYPOINT_glActiveTexture:
+        case VOGL_ENTRYPOINT_glActiveTextureARB:
+        case VOGL_ENTRYPOINT_glPopAttrib:
+        case VOGL_ENTRYPOINT_glPopClientAttrib:
+            return cLoopEPUpdatesBindings;
+
+        // Writes to mapped buffers are replayed when they're unmapped
+        case VOGL_ENTRYPOINT_glUnmapBuffer:
+        case VOGL_ENTRYPOINT_glUnmapBufferARB:
+        case VOGL_ENTRYPOINT_glUnmapNamedBufferEXT:
+            return 0;
+
+        case VOGL_ENTRYPOINT_glWaitSync:
+            return cLoopEPReadOnly;
+
+        case VOGL_ENTRYPOINT_glReadPixels:
+        case VOGL_ENTRYPOINT_glReadnPixelsARB:
+        case VOGL_ENTRYPOINT_glGetTexImage:
+        case VOGL_ENTRYPOINT_glGetnTexImageARB:
+        case VOGL_ENTRYPOINT_glGetCompressedTexImage:
+        case VOGL_ENTRYPOINT_glGetCompressedTexImageARB:
+        case VOGL_ENTRYPOINT_glGetnCompressedTexImageARB:
+            return cLoopEPReadOnly | cLoopEPWritesPackBuffer;
+
+        case VOGL_ENTRYPOINT_glVertexPointer:
+        case VOGL_ENTRYPOINT_glVertexPointerEXT:
+        case VOGL_ENTRYPOINT_glNormalPointer:
+        case VOGL_ENTRYPOINT_glNormalPointerEXT:
+        case VOGL_ENTRYPOINT_glColorPointer:
+        case VOGL_ENTRYPOINT_glColorPointerEXT:
+        case VOGL_ENTRYPOINT_glSecondaryColorPointer:
+        case VOGL_ENTRYPOINT_glSecondaryColorPointerEXT:
+        case VOGL_ENTRYPOINT_glIndexPointer:
+        case VOGL_ENTRYPOINT_glIndexPointerEXT:
+        case VOGL_ENTRYPOINT_glEdgeFlagPointer:
+        case VOGL_ENTRYPOINT_glEdgeFlagPointerEXT:
+        case VOGL_ENTRYPOINT_glFogCoordPointer:
+        case VOGL_ENTRYPOINT_glFogCoordPointerEXT:
+        case VOGL_ENTRYPOINT_glTexCoordPointer:
+        case VOGL_ENTRYPOINT_glTexCoordPointerEXT:
+        case VOGL_ENTRYPOINT_glInterleavedArrays:
+        case VOGL_ENTRYPOINT_glEnableClientState:
+        case VOGL_ENTRYPOINT_glDisableClientState:
+        case VOGL_ENTRYPOINT_glEnableClientStateIndexedEXT:
+        case VOGL_ENTRYPOINT_glDisableClientStateIndexedEXT:
+        case VOGL_ENTRYPOINT_glVertexAttribPointer:
+        case VOGL_ENTRYPOINT_glVertexAttribPointerARB:
+        case VOGL_ENTRYPOINT_glVertexAttribPointerNV:
+        case VOGL_ENTRYPOINT_glVertexAttribIPointer:
+        case VOGL_ENTRYPOINT_glVertexAttribIPointerEXT:
+        case VOGL_ENTRYPOINT_glVertexAttribLPointer:
+        case VOGL_ENTRYPOINT_glVertexAttribLPointerEXT:
+        case VOGL_ENTRYPOINT_glEnableVertexAttribArray:
+        case VOGL_ENTRYPOINT_glEnableVertexAttribArrayARB:
+        case VOGL_ENTRYPOINT_glDisableVertexAttribArray:
+        case VOGL_ENTRYPOINT_glDisableVertexAttribArrayARB:
+        case VOGL_ENTRYPOINT_glVertexAttribDivisor:
+        case VOGL_ENTRYPOINT_glVertexAttribDivisorARB:
+        case VOGL_ENTRYPOINT_glVertexAttribFormat:
+        case VOGL_ENTRYPOINT_glVertexAttribIFormat:
+        case VOGL_ENTRYPOINT_glVertexAttribLFormat:
+        case VOGL_ENTRYPOINT_glVertexAttribBinding:
+        case VOGL_ENTRYPOINT_glVertexBindingDivisor:
+        case VOGL_ENTRYPOINT_glBindVertexBuffer:
+            return cLoopEPWritesCurVAO;
+
+        default:
+            break;
+    }
+
+    const gl_entrypoint_desc_t &desc = g_vogl_entrypoint_descs[id];
+
+    // The remaining window system calls query things or make contexts current, which loop_track_packet() checks itself
+    if (strcmp(desc.m_pAPI_prefix, "GL") != 0)
+        return cLoopEPReadOnly;
+
+    bool returns_data = false;
+    bool names_texture_unit = false;
+    bool takes_location = false;
+
+    for (uint i = 0; i < desc.m_num_params; i++)
+    {
+        const gl_entrypoint_param_desc_t &param_desc = g_vogl_entrypoint_param_descs[id][i];
+
+        // Handles returned through params are created (glGen*), anything else returned is a query result
+        if ((!param_desc.m_input) && (param_desc.m_namespace < 0))
+            returns_data = true;
+
+        if (param_desc.m_input)
+        {
+            if (param_desc.m_namespace == VOGL_NAMESPACE_LOCATIONS)
+                takes_location = true;
+            else if ((param_desc.m_class == VOGL_VALUE_PARAM) && (!strcmp(param_desc.m_pName, "texunit")))
+                names_texture_unit = true;
+        }
+    }
+
+    // Mapped pointers are written through later (glMapBuffer*), returned objects are created (glCreate*, glFenceSync)
+    if ((desc.m_return_ctype != VOGL_VOID) && (!get_vogl_process_gl_ctypes().is_pointer(desc.m_return_ctype)) &&
+        ((desc.m_return_namespace < 0) || (desc.m_return_namespace == VOGL_NAMESPACE_LOCATIONS)))
+    {
+        returns_data = true;
+    }
+
+    if (returns_data)
+        return cLoopEPReadOnly;
+
+    // EXT_direct_state_access calls naming a texture unit other than the current one
+    if (names_texture_unit)
+        return cLoopEPUnsupported;
+
+    return takes_location ? cLoopEPWritesUniforms : 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_init_loop_entrypoint_tables
+//----------------------------------------------------------------------------------------------------------------------
+static void vogl_init_loop_entrypoint_tables()
+{
+    if (g_loop_entrypoint_tables_initialized)
+        return;
+
+    for (uint id = 0; id < VOGL_NUM_ENTRYPOINTS; id++)
+    {
+        const gl_entrypoint_desc_t &desc = g_vogl_entrypoint_descs[id];
+
+        int target_param = -1;
+        for (uint i = 0; i < desc.m_num_params; i++)
+        {
+            const gl_entrypoint_param_desc_t &param_desc = g_vogl_entrypoint_param_descs[id][i];
+            if ((param_desc.m_class == VOGL_VALUE_PARAM) &&
+                ((!strcmp(param_desc.m_pName, "target")) || (!vogl_stricmp(param_desc.m_pName, "writeTarget"))))
+            {
+                target_param = i;
+                break;
+            }
+        }
+
+        g_loop_entrypoint_flags[id] = static_cast<uint8>(vogl_loop_get_entrypoint_flags(static_cast<gl_entrypoint_id_t>(id)));
+        g_loop_entrypoint_target_param[id] = static_cast<int8>(target_param);
+    }
+
+    g_loop_entrypoint_tables_initialized = true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_loop_namespace_is_restorable
+// Namespaces restore_loop_objects() can restore, delete or recreate individually.
+//----------------------------------------------------------------------------------------------------------------------
+static bool vogl_loop_namespace_is_restorable(vogl_namespace_t handle_namespace)
+{
+    switch (handle_namespace)
+    {
+        case VOGL_NAMESPACE_VERTEX_ARRAYS:
+        case VOGL_NAMESPACE_TEXTURES:
+        case VOGL_NAMESPACE_SAMPLERS:
+        case VOGL_NAMESPACE_BUFFERS:
+        case VOGL_NAMESPACE_SHADERS:
+        case VOGL_NAMESPACE_PROGRAMS:
+        case VOGL_NAMESPACE_FRAMEBUFFERS:
+        case VOGL_NAMESPACE_RENDER_BUFFERS:
+        case VOGL_NAMESPACE_QUERIES:
+        case VOGL_NAMESPACE_SYNCS:
+        case VOGL_NAMESPACE_PROGRAM_ARB:
+            return true;
+        default:
+            break;
+    }
+
+    return false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_loop_get_binding_category
+// Returns the object category of a binding loop replay tracks, or GL_NONE.
+//----------------------------------------------------------------------------------------------------------------------
+static GLenum vogl_loop_get_binding_category(GLenum binding)
+{
+    switch (binding)
+    {
+#define DEFINE_BINDING(c, t, b) \
+    case b:                     \
+        return c;
+#include "gl_buffer_bindings.inc"
+#undef DEFINE_BINDING
+
+        default:
+            return GL_NONE;
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_loop_get_target_binding
+// Returns the binding to query for the object an entrypoint's "target" param writes, or GL_NONE.
+//----------------------------------------------------------------------------------------------------------------------
+static GLenum vogl_loop_get_target_binding(GLenum target, vogl_namespace_t &handle_namespace)
+{
+    GLenum category = GL_NONE;
+    GLenum binding = GL_NONE;
+
+    switch (target)
+    {
+#define DEFINE_BINDING(c, t, b) \
+    case t:                     \
+        category = c;           \
+        binding = b;            \
+        break;
+#include "gl_buffer_bindings.inc"
+#undef DEFINE_BINDING
+
+        case GL_FRAMEBUFFER:
+            category = GL_FRAMEBUFFER;
+            binding = GL_DRAW_FRAMEBUFFER_BINDING;
+            break;
+        case GL_TEXTURE_CUBE_MAP_POSITIVE_X:
+        case GL_TEXTURE_CUBE_MAP_NEGATIVE_X:
+        case GL_TEXTURE_CUBE_MAP_POSITIVE_Y:
+        case GL_TEXTURE_CUBE_MAP_NEGATIVE_Y:
+        case GL_TEXTURE_CUBE_MAP_POSITIVE_Z:
+        case GL_TEXTURE_CUBE_MAP_NEGATIVE_Z:
+            category = GL_TEXTURE;
+            binding = GL_TEXTURE_BINDING_CUBE_MAP;
+            break;
+        default:
+            break;
+    }
+
+    switch (category)
+    {
+        case GL_TEXTURE:
+            handle_namespace = VOGL_NAMESPACE_TEXTURES;
+            break;
+        case GL_BUFFER:
+            handle_namespace = VOGL_NAMESPACE_BUFFERS;
+            break;
+        case GL_FRAMEBUFFER:
+            handle_namespace = VOGL_NAMESPACE_FRAMEBUFFERS;
+            break;
+        case GL_RENDERBUFFER:
+            handle_namespace = VOGL_NAMESPACE_RENDER_BUFFERS;
+            break;
+        case GL_SAMPLER:
+            handle_namespace = VOGL_NAMESPACE_SAMPLERS;
+            break;
+        case GL_VERTEX_ARRAY:
+            handle_namespace = VOGL_NAMESPACE_VERTEX_ARRAYS;
+            break;
+        default:
+            handle_namespace = VOGL_NAMESPACE_INVALID;
+            return GL_NONE;
+    }
+
+    return binding;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_loop_bind_target_writes
+// True if objects bound to this target are written by later draws or dispatches.
+//----------------------------------------------------------------------------------------------------------------------
+static bool vogl_loop_bind_target_writes(GLenum target)
+{
+    switch (target)
+    {
+        case GL_FRAMEBUFFER:
+        case GL_DRAW_FRAMEBUFFER:
+        case GL_TRANSFORM_FEEDBACK_BUFFER:
+        case GL_SHADER_STORAGE_BUFFER:
+        case GL_ATOMIC_COUNTER_BUFFER:
+            return true;
+        default:
+            break;
+    }
+
+    return false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_replayer::begin_loop
+//----------------------------------------------------------------------------------------------------------------------
+void vogl_gl_replayer::begin_loop(const vogl_gl_state_snapshot *pSnapshot)
+{
+    VOGL_FUNC_TRACER
+
+    end_loop();
+
+    if ((!pSnapshot) || (!pSnapshot->is_valid()))
+        return;
+
+    vogl_init_loop_entrypoint_tables();
+
+    m_pLoop_snapshot = pSnapshot;
+    m_loop_trace_context = 0;
+
+    // Only single context snapshots taken from the current context can be restored incrementally
+    const vogl_context_snapshot_ptr_vec &context_ptrs = pSnapshot->get_contexts();
+    if ((context_ptrs.size() == 1) && (context_ptrs[0]->get_context_info().is_valid()) &&
+        (context_ptrs[0]->get_context_desc().get_trace_context() == m_cur_trace_context) && (m_cur_trace_context))
+    {
+        m_loop_trace_context = m_cur_trace_context;
+
+        const vogl_gl_object_state_ptr_vec &objects = context_ptrs[0]->get_objects();
+        for (uint i = 0; i < objects.size(); i++)
+        {
+            const vogl_gl_object_state *pObj = objects[i];
+            vogl_namespace_t handle_namespace = pObj->get_handle_namespace();
+
+            if ((!vogl_loop_namespace_is_restorable(handle_namespace)) || (pObj->get_marked_for_deletion()) ||
+                ((pObj->get_type() == cGLSTBuffer) && (static_cast<const vogl_buffer_state *>(pObj)->get_is_mapped())))
+            {
+                vogl_debug_printf("%s: Snapshot contains a %s object that can't be restored in place, loop restores will apply the full snapshot\n", VOGL_FUNCTION_INFO_CSTR, get_gl_object_state_type_str(pObj->get_type()));
+                m_loop_trace_context = 0;
+                break;
+            }
+
+            m_loop_snapshot_objects[handle_namespace].insert(pObj->get_snapshot_handle(), pObj);
+        }
+    }
+
+    if (!m_loop_trace_context)
+    {
+        for (uint i = 0; i < VOGL_TOTAL_NAMESPACES; i++)
+            m_loop_snapshot_objects[i].clear();
+    }
+
+    m_loop_incremental = (m_loop_trace_context != 0);
+    m_loop_general_state_valid = false;
+    m_loop_tracking_complete = false;
+
+    clear_loop_tracking();
+
+    if (m_loop_incremental)
+        loop_init_snapshot_bindings();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_replayer::end_loop
+//----------------------------------------------------------------------------------------------------------------------
+void vogl_gl_replayer::end_loop()
+{
+    VOGL_FUNC_TRACER
+
+    for (uint i = 0; i < VOGL_TOTAL_NAMESPACES; i++)
+        m_loop_snapshot_objects[i].clear();
+
+    clear_loop_tracking();
+
+    m_loop_general_state.clear();
+    m_loop_general_state_valid = false;
+    m_loop_incremental = false;
+    m_loop_tracking_complete = false;
+    m_loop_trace_context = 0;
+    m_pLoop_snapshot = NULL;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_replayer::clear_loop_tracking
+//----------------------------------------------------------------------------------------------------------------------
+void vogl_gl_replayer::clear_loop_tracking()
+{
+    VOGL_FUNC_TRACER
+
+    for (uint i = 0; i < VOGL_TOTAL_NAMESPACES; i++)
+        m_loop_touched_handles[i].reset();
+
+    m_loop_bindings.reset();
+    m_loop_active_texture_unit = 0;
+    m_loop_bindings_valid = false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_replayer::loop_touch_handle
+//----------------------------------------------------------------------------------------------------------------------
+void vogl_gl_replayer::loop_touch_handle(vogl_namespace_t handle_namespace, uint64_t trace_handle, loop_access_t access)
+{
+    if (!trace_handle)
+        return;
+
+    loop_handle_hash_map::insert_result result(m_loop_touched_handles[handle_namespace].insert(trace_handle, access));
+    if ((!result.second) && (result.first->second < access))
+        result.first->second = access;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_replayer::loop_get_binding_key
+// Texture bindings are per texture unit, and the element array buffer binding is part of the current vertex array.
+//----------------------------------------------------------------------------------------------------------------------
+uint64_t vogl_gl_replayer::loop_get_binding_key(GLenum binding) const
+{
+    uint64_t index = 0;
+
+    if (binding == GL_ELEMENT_ARRAY_BUFFER_BINDING)
+    {
+        const uint64_t *pVAO = m_loop_bindings.find_value(GL_VERTEX_ARRAY_BINDING);
+        index = pVAO ? *pVAO : 0;
+    }
+    else if (vogl_loop_get_binding_category(binding) == GL_TEXTURE)
+    {
+        index = m_loop_active_texture_unit;
+    }
+
+    return (index << 32) | binding;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_replayer::loop_touch_bound_object
+// Marks the object currently bound to target as written.
+//----------------------------------------------------------------------------------------------------------------------
+void vogl_gl_replayer::loop_touch_bound_object(GLenum target)
+{
+    VOGL_FUNC_TRACER
+
+    vogl_namespace_t handle_namespace;
+    GLenum binding = vogl_loop_get_target_binding(target, handle_namespace);
+    if (binding == GL_NONE)
+        return;
+
+    // Objects created by the loop are deleted wholesale, so only snapshot objects need restoring
+    if (m_loop_snapshot_objects[handle_namespace].is_empty())
+        return;
+
+    if (!m_loop_bindings_valid)
+    {
+        m_loop_incremental = false;
+        return;
+    }
+
+    const uint64_t *pTrace_handle = m_loop_bindings.find_value(loop_get_binding_key(binding));
+    if (!pTrace_handle)
+    {
+        // The snapshot doesn't record the default vertex array's element array buffer while another one is bound
+        m_loop_incremental = false;
+        return;
+    }
+
+    loop_touch_handle(handle_namespace, *pTrace_handle, cLoopAccessWritten);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_replayer::loop_track_bindings
+// Updates the tracked bindings for a bind call about to be replayed.
+//----------------------------------------------------------------------------------------------------------------------
+void vogl_gl_replayer::loop_track_bindings(const vogl_trace_packet &trace_packet, GLenum target)
+{
+    VOGL_FUNC_TRACER
+
+    vogl_namespace_t handle_namespace;
+    const GLenum binding = vogl_loop_get_target_binding(target, handle_namespace);
+
+    switch (trace_packet.get_entrypoint_id())
+    {
+        case VOGL_ENTRYPOINT_glActiveTexture:
+        case VOGL_ENTRYPOINT_glActiveTextureARB:
+        {
+            m_loop_active_texture_unit = static_cast<GLenum>(trace_packet.get_param_data(0)) - GL_TEXTURE0;
+            break;
+        }
+        case VOGL_ENTRYPOINT_glBindTexture:
+        case VOGL_ENTRYPOINT_glBindTextureEXT:
+        case VOGL_ENTRYPOINT_glBindBuffer:
+        case VOGL_ENTRYPOINT_glBindBufferARB:
+        case VOGL_ENTRYPOINT_glBindRenderbuffer:
+        case VOGL_ENTRYPOINT_glBindRenderbufferEXT:
+        {
+            if (binding != GL_NONE)
+                m_loop_bindings[loop_get_binding_key(binding)] = trace_packet.get_param_data(1);
+            break;
+        }
+        case VOGL_ENTRYPOINT_glBindBufferBase:
+        case VOGL_ENTRYPOINT_glBindBufferBaseEXT:
+        case VOGL_ENTRYPOINT_glBindBufferBaseNV:
+        case VOGL_ENTRYPOINT_glBindBufferRange:
+        case VOGL_ENTRYPOINT_glBindBufferRangeEXT:
+        case VOGL_ENTRYPOINT_glBindBufferRangeNV:
+        case VOGL_ENTRYPOINT_glBindBufferOffsetEXT:
+        case VOGL_ENTRYPOINT_glBindBufferOffsetNV:
+        {
+            // Binding to an indexed target also binds to the generic one
+            if (binding != GL_NONE)
+                m_loop_bindings[loop_get_binding_key(binding)] = trace_packet.get_param_data(2);
+            break;
+        }
+        case VOGL_ENTRYPOINT_glBindFramebuffer:
+        case VOGL_ENTRYPOINT_glBindFramebufferEXT:
+        {
+            const uint64_t trace_handle = trace_packet.get_param_data(1);
+            if ((target == GL_FRAMEBUFFER) || (target == GL_DRAW_FRAMEBUFFER))
+                m_loop_bindings[loop_get_binding_key(GL_DRAW_FRAMEBUFFER_BINDING)] = trace_handle;
+            if ((target == GL_FRAMEBUFFER) || (target == GL_READ_FRAMEBUFFER))
+                m_loop_bindings[loop_get_binding_key(GL_READ_FRAMEBUFFER_BINDING)] = trace_handle;
+            break;
+        }
+        case VOGL_ENTRYPOINT_glBindVertexArray:
+        case VOGL_ENTRYPOINT_glBindVertexArrayAPPLE:
+        {
+            const uint64_t trace_handle = trace_packet.get_param_data(0);
+            m_loop_bindings[loop_get_binding_key(GL_VERTEX_ARRAY_BINDING)] = trace_handle;
+
+            // Vertex arrays created by the loop start out without an element array buffer
+            if (!m_loop_snapshot_objects[VOGL_NAMESPACE_VERTEX_ARRAYS].contains(trace_handle))
+                m_loop_bindings.insert(loop_get_binding_key(GL_ELEMENT_ARRAY_BUFFER_BINDING), 0);
+            break;
+        }
+        default:
+        {
+            // Display lists and attribute stacks can change any binding
+            m_loop_bindings_valid = false;
+            break;
+        }
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_replayer::loop_init_snapshot_bindings
+// Starts tracking bindings from the snapshot's. Objects bound for writing at the start of the loop may be written by
+// draws and dispatches without ever being named, so they're touched right away.
+//----------------------------------------------------------------------------------------------------------------------
+void vogl_gl_replayer::loop_init_snapshot_bindings()
+{
+    VOGL_FUNC_TRACER
+
+    const vogl_general_context_state &general_state = m_pLoop_snapshot->get_contexts()[0]->get_general_state();
+
+    m_loop_bindings.reset();
+    m_loop_active_texture_unit = 0;
+    m_loop_bindings_valid = true;
+
+    GLint active_texture = GL_TEXTURE0;
+    if (general_state.get(GL_ACTIVE_TEXTURE, 0, &active_texture, 1, false))
+        m_loop_active_texture_unit = active_texture - GL_TEXTURE0;
+
+    GLint vertex_array = 0;
+    general_state.get(GL_VERTEX_ARRAY_BINDING, 0, &vertex_array, 1, false);
+
+    for (vogl_state_vector::const_iterator it = general_state.begin(); it != general_state.end(); ++it)
+    {
+        const vogl_state_data &state = it->second;
+        const GLenum binding = state.get_enum_val();
+
+        GLint trace_handle = 0;
+        if (!general_state.get(binding, state.get_index(), &trace_handle, 1, state.get_indexed_variant()))
+            continue;
+
+        if (!state.get_indexed_variant())
+        {
+            switch (vogl_loop_get_binding_category(binding))
+            {
+                case GL_TEXTURE:
+                    m_loop_bindings[(static_cast<uint64_t>(state.get_index()) << 32) | binding] = static_cast<GLuint>(trace_handle);
+                    break;
+                case GL_BUFFER:
+                    if (binding == GL_ELEMENT_ARRAY_BUFFER_BINDING)
+                        m_loop_bindings[(static_cast<uint64_t>(static_cast<GLuint>(vertex_array)) << 32) | binding] = static_cast<GLuint>(trace_handle);
+                    else
+                        m_loop_bindings[binding] = static_cast<GLuint>(trace_handle);
+                    break;
+                case GL_FRAMEBUFFER:
+                case GL_RENDERBUFFER:
+                case GL_VERTEX_ARRAY:
+                    m_loop_bindings[binding] = static_cast<GLuint>(trace_handle);
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        vogl_namespace_t handle_namespace;
+        switch (binding)
+        {
+            case GL_DRAW_FRAMEBUFFER_BINDING:
+                handle_namespace = VOGL_NAMESPACE_FRAMEBUFFERS;
+                break;
+            case GL_TRANSFORM_FEEDBACK_BUFFER_BINDING:
+            case GL_SHADER_STORAGE_BUFFER_BINDING:
+            case GL_ATOMIC_COUNTER_BUFFER_BINDING:
+                handle_namespace = VOGL_NAMESPACE_BUFFERS;
+                break;
+            case GL_IMAGE_BINDING_NAME:
+                handle_namespace = VOGL_NAMESPACE_TEXTURES;
+                break;
+            default:
+                continue;
+        }
+
+        loop_touch_handle(handle_namespace, static_cast<GLuint>(trace_handle), cLoopAccessWritten);
+    }
+
+    // The element array buffers of the vertex arrays that aren't bound
+    for (loop_object_hash_map::const_iterator it = m_loop_snapshot_objects[VOGL_NAMESPACE_VERTEX_ARRAYS].begin(); it != m_loop_snapshot_objects[VOGL_NAMESPACE_VERTEX_ARRAYS].end(); ++it)
+    {
+        const vogl_vao_state *pVAO = static_cast<const vogl_vao_state *>(it->second);
+        m_loop_bindings.insert((it->first << 32) | GL_ELEMENT_ARRAY_BUFFER_BINDING, pVAO->get_element_array_binding());
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_replayer::loop_track_packet
+// Records the objects a call about to be replayed creates, deletes or writes.
+//----------------------------------------------------------------------------------------------------------------------
+void vogl_gl_replayer::loop_track_packet(const vogl_trace_packet &trace_packet)
+{
+    VOGL_FUNC_TRACER
+
+    // Display lists replayed while applying a snapshot aren't part of the loop
+    if (m_pPending_snapshot)
+        return;
+
+    const gl_entrypoint_id_t entrypoint_id = trace_packet.get_entrypoint_id();
+    if (entrypoint_id == VOGL_ENTRYPOINT_glInternalTraceCommandRAD)
+        return;
+
+    const uint flags = g_loop_entrypoint_flags[entrypoint_id];
+
+    if ((flags & cLoopEPUnsupported) || (trace_packet.get_context_handle() != m_loop_trace_context) || (m_cur_trace_context != m_loop_trace_context))
+    {
+        m_loop_incremental = false;
+        return;
+    }
+
+    // The state to diff against at the end of the loop is the state before the loop's first call
+    if (!m_loop_general_state_valid)
+    {
+        if ((!m_pCur_context_state) || (!m_loop_general_state.snapshot(m_pCur_context_state->m_context_info)))
+        {
+            m_loop_incremental = false;
+            return;
+        }
+
+        m_loop_general_state_valid = true;
+    }
+
+    if (flags & cLoopEPWritesPackBuffer)
+        loop_touch_bound_object(GL_PIXEL_PACK_BUFFER);
+
+    if (flags & cLoopEPReadOnly)
+        return;
+
+    const int target_param = g_loop_entrypoint_target_param[entrypoint_id];
+    const GLenum target = (target_param >= 0) ? static_cast<GLenum>(trace_packet.get_param_data(target_param)) : GL_NONE;
+
+    loop_access_t param_access = cLoopAccessWritten;
+    if (flags & cLoopEPBind)
+        param_access = vogl_loop_bind_target_writes(target) ? cLoopAccessWritten : cLoopAccessReferenced;
+    else if (flags & cLoopEPWritesUniforms)
+        param_access = cLoopAccessUniforms;
+
+    for (uint i = 0; i < trace_packet.total_params(); i++)
+    {
+        const gl_entrypoint_param_desc_t &param_desc = trace_packet.get_param_desc(i);
+        const vogl_namespace_t handle_namespace = param_desc.m_namespace;
+
+        if ((handle_namespace < 0) || (handle_namespace == VOGL_NAMESPACE_LOCATIONS))
+            continue;
+
+        if (!vogl_loop_namespace_is_restorable(handle_namespace))
+        {
+            // Calling lists is fine, anything else that names a list, pipeline, transform feedback object etc. isn't undoable
+            if ((handle_namespace == VOGL_NAMESPACE_LISTS) && (flags & cLoopEPBind))
+                continue;
+
+            m_loop_incremental = false;
+            return;
+        }
+
+        if (param_desc.m_class == VOGL_VALUE_PARAM)
+        {
+            loop_touch_handle(handle_namespace, trace_packet.get_param_data(i), param_access);
+            continue;
+        }
+
+        const void *pHandles = trace_packet.get_param_client_memory_ptr(i);
+        if (!pHandles)
+            continue;
+
+        const uint handle_size = trace_packet.get_param_client_memory_ctype_desc(i).m_size;
+        const uint total_handles = handle_size ? (trace_packet.get_param_client_memory_data_size(i) / handle_size) : 0;
+
+        if (handle_size == sizeof(GLuint))
+        {
+            for (uint j = 0; j < total_handles; j++)
+                loop_touch_handle(handle_namespace, static_cast<const GLuint *>(pHandles)[j], param_access);
+        }
+        else if (handle_size == sizeof(uint64_t))
+        {
+            for (uint j = 0; j < total_handles; j++)
+                loop_touch_handle(handle_namespace, static_cast<const uint64_t *>(pHandles)[j], param_access);
+        }
+        else
+        {
+            m_loop_incremental = false;
+            return;
+        }
+    }
+
+    if (trace_packet.has_return_value())
+    {
+        const vogl_namespace_t handle_namespace = trace_packet.get_entrypoint_desc().m_return_namespace;
+
+        if ((handle_namespace >= 0) && (handle_namespace != VOGL_NAMESPACE_LOCATIONS))
+        {
+            if (!vogl_loop_namespace_is_restorable(handle_namespace))
+            {
+                m_loop_incremental = false;
+                return;
+            }
+
+            loop_touch_handle(handle_namespace, trace_packet.get_return_value_data(), cLoopAccessReferenced);
+        }
+    }
+
+    // glBindBuffer(GL_ELEMENT_ARRAY_BUFFER) is part of the current vertex array's state
+    if (((flags & cLoopEPWritesCurVAO) || ((flags & cLoopEPBind) && (target == GL_ELEMENT_ARRAY_BUFFER))) && (m_pCur_context_state))
+        loop_touch_bound_object(GL_VERTEX_ARRAY);
+
+    if ((flags & cLoopEPWritesUniforms) && (m_pCur_context_state) && (m_pCur_context_state->m_cur_trace_program))
+        loop_touch_handle(VOGL_NAMESPACE_PROGRAMS, m_pCur_context_state->m_cur_trace_program, cLoopAccessUniforms);
+
+    if ((!(flags & (cLoopEPBind | cLoopEPWritesUniforms))) && (target != GL_NONE))
+        loop_touch_bound_object(target);
+
+    if (flags & cLoopEPUpdatesBindings)
+        loop_track_bindings(trace_packet, target);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_replayer::loop_can_restore_incrementally
+//----------------------------------------------------------------------------------------------------------------------
+bool vogl_gl_replayer::loop_can_restore_incrementally()
+{
+    VOGL_FUNC_TRACER
+
+    if ((!m_loop_trace_context) || (!m_loop_incremental) || (!m_loop_general_state_valid))
+        return false;
+
+    if ((m_pPending_snapshot) || (m_pending_make_current_packet.is_valid()) || (m_pending_window_resize_width))
+        return false;
+
+    if ((m_contexts.size() != 1) || (m_cur_trace_context != m_loop_trace_context) || (!m_pCur_context_state))
+        return false;
+
+    // Restoring a buffer's data would implicitly unmap it
+    if (get_shared_state()->m_shadow_state.m_mapped_buffers.size())
+        return false;
+
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_replayer::restore_loop_objects
+// Deletes the objects the loop created, and restores the snapshot objects it deleted or wrote. Returns cStatusSoftFailure
+// (without restoring anything else) if the touched set can only be restored by applying the full snapshot.
+//----------------------------------------------------------------------------------------------------------------------
+vogl_gl_replayer::status_t vogl_gl_replayer::restore_loop_objects(trace_to_replay_handle_remapper &trace_to_replay_remapper, bool &recreated_objects)
+{
+    VOGL_FUNC_TRACER
+
+    recreated_objects = false;
+
+    // Programs reference shaders by handle, so a shader can't be recreated or recompiled behind their back
+    for (loop_handle_hash_map::const_iterator it = m_loop_touched_handles[VOGL_NAMESPACE_SHADERS].begin(); it != m_loop_touched_handles[VOGL_NAMESPACE_SHADERS].end(); ++it)
+    {
+        if ((it->second != cLoopAccessReferenced) && (m_loop_snapshot_objects[VOGL_NAMESPACE_SHADERS].contains(it->first)))
+            return cStatusSoftFailure;
+    }
+
+    // Anything rendered into a framebuffer object was written through its attachments
+    for (loop_handle_hash_map::const_iterator it = m_loop_touched_handles[VOGL_NAMESPACE_FRAMEBUFFERS].begin(); it != m_loop_touched_handles[VOGL_NAMESPACE_FRAMEBUFFERS].end(); ++it)
+    {
+        const vogl_gl_object_state *const *ppState_obj = m_loop_snapshot_objects[VOGL_NAMESPACE_FRAMEBUFFERS].find_value(it->first);
+        if ((!ppState_obj) || (it->second == cLoopAccessReferenced))
+            continue;
+
+        const vogl_framebuffer_state::GLenum_to_attachment_map &attachments = static_cast<const vogl_framebuffer_state *>(*ppState_obj)->get_attachments();
+        for (vogl_framebuffer_state::GLenum_to_attachment_map::const_iterator attach_it = attachments.begin(); attach_it != attachments.end(); ++attach_it)
+        {
+            const vogl_framebuffer_attachment &attachment = attach_it->second;
+
+            if (attachment.get_type() == GL_TEXTURE)
+                loop_touch_handle(VOGL_NAMESPACE_TEXTURES, attachment.get_handle(), cLoopAccessWritten);
+            else if (attachment.get_type() == GL_RENDERBUFFER)
+                loop_touch_handle(VOGL_NAMESPACE_RENDER_BUFFERS, attachment.get_handle(), cLoopAccessWritten);
+        }
+    }
+
+    // Same order as process_applying_pending_snapshot(): leaf objects first
+    static const vogl_namespace_t s_namespace_restore_order[] =
+        {
+            VOGL_NAMESPACE_BUFFERS, VOGL_NAMESPACE_SAMPLERS, VOGL_NAMESPACE_QUERIES, VOGL_NAMESPACE_RENDER_BUFFERS, VOGL_NAMESPACE_TEXTURES,
+            VOGL_NAMESPACE_FRAMEBUFFERS, VOGL_NAMESPACE_VERTEX_ARRAYS, VOGL_NAMESPACE_SHADERS, VOGL_NAMESPACE_PROGRAMS, VOGL_NAMESPACE_SYNCS,
+            VOGL_NAMESPACE_PROGRAM_ARB
+        };
+
+    bool recreated_attachments = false;
+
+    for (uint i = 0; i < VOGL_ARRAY_SIZE(s_namespace_restore_order); i++)
+    {
+        const vogl_namespace_t handle_namespace = s_namespace_restore_order[i];
+
+        // Recreated objects have new replay handles, so everything referring to them must be restored too
+        if ((handle_namespace == VOGL_NAMESPACE_FRAMEBUFFERS) && (recreated_attachments))
+        {
+            for (loop_object_hash_map::const_iterator it = m_loop_snapshot_objects[VOGL_NAMESPACE_FRAMEBUFFERS].begin(); it != m_loop_snapshot_objects[VOGL_NAMESPACE_FRAMEBUFFERS].end(); ++it)
+                loop_touch_handle(VOGL_NAMESPACE_FRAMEBUFFERS, it->first, cLoopAccessWritten);
+        }
+
+        loop_handle_hash_map &touched_handles = m_loop_touched_handles[handle_namespace];
+
+        for (loop_handle_hash_map::const_iterator it = touched_handles.begin(); it != touched_handles.end(); ++it)
+        {
+            const uint64_t trace_handle = it->first;
+            const loop_access_t access = it->second;
+
+            bool exists = trace_to_replay_remapper.is_valid_handle(handle_namespace, trace_handle);
+
+            const vogl_gl_object_state *const *ppState_obj = m_loop_snapshot_objects[handle_namespace].find_value(trace_handle);
+            if (!ppState_obj)
+            {
+                // Created by the loop
+                if (exists)
+                    trace_to_replay_remapper.delete_handle_and_object(handle_namespace, trace_handle, trace_to_replay_remapper.remap_handle(handle_namespace, trace_handle));
+                continue;
+            }
+
+            if ((exists) && (access == cLoopAccessReferenced))
+                continue;
+
+            const vogl_gl_object_state *pState_obj = *ppState_obj;
+            GLuint64 restore_handle = exists ? trace_to_replay_remapper.remap_handle(handle_namespace, trace_handle) : 0;
+
+            if ((exists) && (handle_namespace == VOGL_NAMESPACE_PROGRAMS))
+            {
+                if (access == cLoopAccessUniforms)
+                {
+                    if (!static_cast<const vogl_program_state *>(pState_obj)->restore_uniform_state(m_pCur_context_state->m_context_info, trace_to_replay_remapper, restore_handle))
+                        return cStatusHardFailure;
+                    continue;
+                }
+
+                // vogl_program_state::restore() can't relink a program that already has shaders attached, so recreate it
+                if (m_pCur_context_state->m_cur_replay_program == restore_handle)
+                {
+                    GL_ENTRYPOINT(glUseProgram)(0);
+                    check_gl_error();
+                    m_pCur_context_state->m_cur_replay_program = 0;
+                    m_pCur_context_state->m_cur_trace_program = 0;
+                }
+
+                trace_to_replay_remapper.delete_handle_and_object(handle_namespace, trace_handle, restore_handle);
+
+                exists = false;
+                restore_handle = 0;
+            }
+
+            status_t status = restore_object(trace_to_replay_remapper, pState_obj, restore_handle);
+            if (status != cStatusOK)
+                return status;
+
+            if (exists)
+                continue;
+
+            recreated_objects = true;
+
+            if ((handle_namespace == VOGL_NAMESPACE_TEXTURES) || (handle_namespace == VOGL_NAMESPACE_RENDER_BUFFERS))
+                recreated_attachments = true;
+            else if (handle_namespace == VOGL_NAMESPACE_BUFFERS)
+            {
+                // Vertex arrays and buffer textures refer to buffers by handle
+                for (loop_object_hash_map::const_iterator obj_it = m_loop_snapshot_objects[VOGL_NAMESPACE_VERTEX_ARRAYS].begin(); obj_it != m_loop_snapshot_objects[VOGL_NAMESPACE_VERTEX_ARRAYS].end(); ++obj_it)
+                    loop_touch_handle(VOGL_NAMESPACE_VERTEX_ARRAYS, obj_it->first, cLoopAccessWritten);
+
+                for (loop_object_hash_map::const_iterator obj_it = m_loop_snapshot_objects[VOGL_NAMESPACE_TEXTURES].begin(); obj_it != m_loop_snapshot_objects[VOGL_NAMESPACE_TEXTURES].end(); ++obj_it)
+                {
+                    if (static_cast<const vogl_texture_state *>(obj_it->second)->get_target() == GL_TEXTURE_BUFFER)
+                        loop_touch_handle(VOGL_NAMESPACE_TEXTURES, obj_it->first, cLoopAccessWritten);
+                }
+            }
+        }
+    }
+
+    return cStatusOK;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_replayer::restore_loop_snapshot
+// Returns the replayer to the state begin_loop() was called with, restoring only what the loop touched when possible.
+//----------------------------------------------------------------------------------------------------------------------
+vogl_gl_replayer::status_t vogl_gl_replayer::restore_loop_snapshot()
+{
+    VOGL_FUNC_TRACER
+
+    if (!m_pLoop_snapshot)
+        return cStatusHardFailure;
+
+    const vogl_gl_state_snapshot &snapshot = *m_pLoop_snapshot;
+
+    if (loop_can_restore_incrementally())
+    {
+        timed_scope ts(VOGL_FUNCTION_INFO_CSTR);
+
+        const vogl_context_snapshot &context_snapshot = *snapshot.get_contexts()[0];
+
+        // Diff the general state against the state at the start of the loop before restoring any objects (which rebinds things)
+        vogl_general_context_state cur_general_state;
+        bool general_state_changed = (!cur_general_state.snapshot(m_pCur_context_state->m_context_info)) || (!(cur_general_state == m_loop_general_state));
+
+        trace_to_replay_handle_remapper trace_to_replay_remapper(*this);
+
+        bool recreated_objects = false;
+        status_t status = restore_loop_objects(trace_to_replay_remapper, recreated_objects);
+
+        if (status == cStatusOK)
+        {
+            if ((snapshot.get_default_framebuffer().is_valid()) && (!snapshot.get_default_framebuffer().restore(m_pCur_context_state->m_context_info, (m_flags & cGLReplayerDisableRestoreFrontBuffer) == 0)))
+            {
+                vogl_warning_printf("%s: Failed restoring default framebuffer!\n", VOGL_FUNCTION_INFO_CSTR);
+            }
+
+            status = restore_general_state(trace_to_replay_remapper, snapshot, context_snapshot, general_state_changed || recreated_objects);
+            if (status == cStatusOK)
+                status = update_context_shadows(trace_to_replay_remapper, snapshot, context_snapshot);
+        }
+
+        if (status == cStatusOK)
+        {
+            m_frame_index = snapshot.get_frame_index();
+            m_last_parsed_call_counter = snapshot.get_gl_call_counter();
+            m_last_processed_call_counter = snapshot.get_gl_call_counter();
+            m_at_frame_boundary = snapshot.get_at_frame_boundary();
+
+            // Recreated objects have new replay handles, so the state must be captured again on the next iteration
+            if (recreated_objects)
+                m_loop_general_state_valid = false;
+
+            if ((m_loop_repeats_exactly) && (m_loop_incremental))
+            {
+                // The next iteration touches the same objects, so keep what this one touched and stop tracking. The state
+                // can't be captured by the next iteration's first call anymore, but it's the same as right now.
+                if (!m_loop_general_state_valid)
+                    m_loop_general_state_valid = m_loop_general_state.snapshot(m_pCur_context_state->m_context_info);
+
+                m_loop_tracking_complete = m_loop_general_state_valid;
+            }
+
+            if (!m_loop_tracking_complete)
+            {
+                clear_loop_tracking();
+                loop_init_snapshot_bindings();
+            }
+
+            return cStatusOK;
+        }
+
+        if (status == cStatusSoftFailure)
+            vogl_debug_printf("%s: Loop touched objects that can't be restored in place, applying the full loop snapshot\n", VOGL_FUNCTION_INFO_CSTR);
+        else
+            vogl_warning_printf("%s: Incremental loop restore failed, applying the full loop snapshot\n", VOGL_FUNCTION_INFO_CSTR);
+    }
+
+    // begin_applying_snapshot() resets the replayer, which also clears the loop tracking
+    status_t status = begin_applying_snapshot(m_pLoop_snapshot, false);
+    if ((status != cStatusOK) && (status != cStatusResizeWindow))
+        return status;
+
+    m_loop_incremental = (m_loop_trace_context != 0);
+    if (m_loop_incremental)
+        loop_init_snapshot_bindings();
+
+    return status;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_gl_command_stream::vogl_gl_command_stream
+//----------------------------------------------------------------------------------------------------------------------
+vogl_gl_command_stream::vogl_gl_command_stream()
+    : m_trace_context(0),
+      m_cur_command(0),
+      m_num_direct_calls(0),
+      m_slots_resolved(false)
+{
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_gl_command_stream::~vogl_gl_command_stream
+//----------------------------------------------------------------------------------------------------------------------
+vogl_gl_command_stream::~vogl_gl_command_stream()
+{
+    clear();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_gl_command_stream::clear
+//----------------------------------------------------------------------------------------------------------------------
+void vogl_gl_command_stream::clear()
+{
+    for (uint i = 0; i < m_packets.size(); i++)
+        vogl_delete(m_packets[i]);
+    m_packets.clear();
+
+    m_commands.clear();
+    m_params.clear();
+    m_slots.clear();
+    m_handle_slots.clear();
+    m_location_slots.clear();
+
+    m_trace_context = 0;
+    m_cur_command = 0;
+    m_num_direct_calls = 0;
+    m_slots_resolved = false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_gl_command_stream::add_packet
+//----------------------------------------------------------------------------------------------------------------------
+vogl_trace_packet *vogl_gl_command_stream::add_packet(const vogl_ctypes *pCtypes)
+{
+    vogl_trace_packet *pPacket = vogl_new(vogl_trace_packet, pCtypes);
+    m_packets.push_back(pPacket);
+    return pPacket;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_has_actual_gl_entrypoint
+//----------------------------------------------------------------------------------------------------------------------
+static bool vogl_has_actual_gl_entrypoint(gl_entrypoint_id_t entrypoint_id)
+{
+    switch (entrypoint_id)
+    {
+#define DEF_PROTO(exported, category, ret, ret_type, num_params, name, args, params) \
+    case VOGL_ENTRYPOINT_##name:                                                     \
+        return GL_ENTRYPOINT(name) != NULL;
+#define DEF_PROTO_VOID DEF_PROTO
+#include "gl_glx_wgl_protos.inc"
+#undef DEF_PROTO
+#undef DEF_PROTO_VOID
+        default:
+            break;
+    }
+
+    return false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_is_simple_replay_func
+// True for the entrypoints process_gl_entrypoint_packet_internal() replays straight from their params.
+//----------------------------------------------------------------------------------------------------------------------
+static bool vogl_is_simple_replay_func(gl_entrypoint_id_t entrypoint_id)
+{
+    switch (entrypoint_id)
+    {
+#define VOGL_SIMPLE_REPLAY_FUNC_BEGIN(name, num_params) \
+    case VOGL_ENTRYPOINT_##name:                        \
+        return true;
+#define VOGL_SIMPLE_REPLAY_FUNC_PARAM_VALUE(type, index)
+#define VOGL_SIMPLE_REPLAY_FUNC_PARAM_SEPERATOR
+#define VOGL_SIMPLE_REPLAY_FUNC_PARAM_CLIENT_MEMORY(type, index)
+#define VOGL_SIMPLE_REPLAY_FUNC_END(name)
+#include "gl_glx_wgl_simple_replay_funcs.inc"
+#undef VOGL_SIMPLE_REPLAY_FUNC_BEGIN
+#undef VOGL_SIMPLE_REPLAY_FUNC_PARAM_VALUE
+#undef VOGL_SIMPLE_REPLAY_FUNC_PARAM_SEPERATOR
+#undef VOGL_SIMPLE_REPLAY_FUNC_PARAM_CLIENT_MEMORY
+#undef VOGL_SIMPLE_REPLAY_FUNC_END
+        default:
+            break;
+    }
+
+    return false;
+}
+
+// The glUniform*() entrypoints compile_direct_call() handles, all of them take the location as their first param
+#define VOGL_COMMAND_STREAM_UNIFORM_CASES                                                                                          \
+    case VOGL_ENTRYPOINT_glUniform1f:                                                                                               \
+    case VOGL_ENTRYPOINT_glUniform2f:                                                                                               \
+    case VOGL_ENTRYPOINT_glUniform3f:                                                                                               \
+    case VOGL_ENTRYPOINT_glUniform4f:                                                                                               \
+    case VOGL_ENTRYPOINT_glUniform1i:                                                                                               \
+    case VOGL_ENTRYPOINT_glUniform2i:                                                                                               \
+    case VOGL_ENTRYPOINT_glUniform3i:                                                                                               \
+    case VOGL_ENTRYPOINT_glUniform4i:                                                                                               \
+    case VOGL_ENTRYPOINT_glUniform1ui:                                                                                              \
+    case VOGL_ENTRYPOINT_glUniform2ui:                                                                                              \
+    case VOGL_ENTRYPOINT_glUniform3ui:                                                                                              \
+    case VOGL_ENTRYPOINT_glUniform4ui:                                                                                              \
+    case VOGL_ENTRYPOINT_glUniform1fv:                                                                                              \
+    case VOGL_ENTRYPOINT_glUniform2fv:                                                                                              \
+    case VOGL_ENTRYPOINT_glUniform3fv:                                                                                              \
+    case VOGL_ENTRYPOINT_glUniform4fv:                                                                                              \
+    case VOGL_ENTRYPOINT_glUniform1iv:                                                                                              \
+    case VOGL_ENTRYPOINT_glUniform2iv:                                                                                              \
+    case VOGL_ENTRYPOINT_glUniform3iv:                                                                                              \
+    case VOGL_ENTRYPOINT_glUniform4iv:                                                                                              \
+    case VOGL_ENTRYPOINT_glUniform1uiv:                                                                                             \
+    case VOGL_ENTRYPOINT_glUniform2uiv:                                                                                             \
+    case VOGL_ENTRYPOINT_glUniform3uiv:                                                                                             \
+    case VOGL_ENTRYPOINT_glUniform4uiv:                                                                                             \
+    case VOGL_ENTRYPOINT_glUniformMatrix2fv:                                                                                        \
+    case VOGL_ENTRYPOINT_glUniformMatrix3fv:                                                                                        \
+    case VOGL_ENTRYPOINT_glUniformMatrix4fv
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_gl_replayer::compile_command_stream
+//----------------------------------------------------------------------------------------------------------------------
+void vogl_gl_replayer::compile_command_stream(vogl_gl_command_stream &stream)
+{
+    VOGL_FUNC_TRACER
+
+    stream.m_commands.resize(0);
+    stream.m_params.resize(0);
+    stream.m_slots.resize(0);
+    stream.m_handle_slots.reset();
+    stream.m_location_slots.reset();
+    stream.m_trace_context = m_cur_trace_context;
+    stream.m_num_direct_calls = 0;
+    stream.rewind();
+
+    // Direct calls skip GL error checking and everything the dumping and debug flags do per call
+    const bool allow_direct_calls = benchmark_mode() && (m_pCur_context_state) &&
+                                    ((m_flags & (cGLReplayerDumpAllPackets | cGLReplayerDebugMode | cGLReplayerLowLevelDebugMode | cGLReplayerDumpShadersOnDraw | cGLReplayerDumpFramebufferOnDraws)) == 0);
+
+    // Uniform locations are per program, so follow the stream's glUseProgram() calls
+    GLuint cur_trace_program = m_pCur_context_state ? m_pCur_context_state->m_cur_trace_program : 0;
+
+    stream.m_commands.reserve(stream.m_packets.size());
+
+    for (uint i = 0; i < stream.m_packets.size(); i++)
+    {
+        vogl_trace_packet &trace_packet = *stream.m_packets[i];
+        const gl_entrypoint_id_t entrypoint_id = trace_packet.get_entrypoint_id();
+
+        vogl_gl_command_stream::command &cmd = *stream.m_commands.enlarge(1);
+        cmd.m_pPacket = &trace_packet;
+        cmd.m_entrypoint_id = entrypoint_id;
+        cmd.m_first_param = cUINT32_MAX;
+        cmd.m_slot = cUINT32_MAX;
+        cmd.m_is_draw = vogl_is_draw_entrypoint(entrypoint_id);
+        cmd.m_changes_handles = false;
+
+        const bool same_context = (trace_packet.get_context_handle() == stream.m_trace_context);
+
+        if ((allow_direct_calls) && (same_context) && (compile_direct_call(stream, trace_packet, cur_trace_program, cmd)))
+        {
+            stream.m_num_direct_calls++;
+            continue;
+        }
+
+        if ((same_context) && ((entrypoint_id == VOGL_ENTRYPOINT_glUseProgram) || (entrypoint_id == VOGL_ENTRYPOINT_glUseProgramObjectARB)))
+            cur_trace_program = trace_packet.get_param_value<GLuint>(0);
+
+        // Anything that creates, deletes or relinks objects may change what the slots resolve to
+        switch (entrypoint_id)
+        {
+            case VOGL_ENTRYPOINT_glLinkProgram:
+            case VOGL_ENTRYPOINT_glLinkProgramARB:
+            case VOGL_ENTRYPOINT_glProgramBinary:
+            case VOGL_ENTRYPOINT_glDeleteProgram:
+            case VOGL_ENTRYPOINT_glDeleteObjectARB:
+                cmd.m_changes_handles = true;
+                break;
+            default:
+                break;
+        }
+
+        if (trace_packet.has_return_value() && (trace_packet.get_entrypoint_desc().m_return_namespace >= 0))
+            cmd.m_changes_handles = true;
+
+        for (uint j = 0; (j < trace_packet.total_params()) && (!cmd.m_changes_handles); j++)
+        {
+            const gl_entrypoint_param_desc_t &param_desc = trace_packet.get_param_desc(j);
+            if ((param_desc.m_class != VOGL_VALUE_PARAM) && (param_desc.m_namespace >= 0))
+                cmd.m_changes_handles = true;
+        }
+    }
+
+    stream.m_handle_slots.clear();
+    stream.m_location_slots.clear();
+
+    vogl_printf("Compiled %u packets into %u direct calls referring to %u handles and uniform locations\n", stream.m_packets.size(), stream.m_num_direct_calls, stream.m_slots.size());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_gl_replayer::compile_direct_call
+// Unpacks the packet's params into the stream if process_next_command() can call it directly. Client memory params
+// become pointers into the packet, and the handle or uniform location the call names becomes a slot.
+//----------------------------------------------------------------------------------------------------------------------
+bool vogl_gl_replayer::compile_direct_call(vogl_gl_command_stream &stream, vogl_trace_packet &trace_packet, GLuint cur_trace_program, vogl_gl_command_stream::command &cmd)
+{
+    VOGL_FUNC_TRACER
+
+    const gl_entrypoint_id_t entrypoint_id = trace_packet.get_entrypoint_id();
+
+    if ((entrypoint_id == VOGL_ENTRYPOINT_glInternalTraceCommandRAD) || (!vogl_has_actual_gl_entrypoint(entrypoint_id)))
+        return false;
+
+    uint slot = cUINT32_MAX;
+
+    switch (entrypoint_id)
+    {
+        case VOGL_ENTRYPOINT_glBindTexture:
+            slot = add_command_stream_slot(stream, VOGL_NAMESPACE_TEXTURES, trace_packet.get_param_value<GLuint>(1));
+            break;
+        case VOGL_ENTRYPOINT_glBindBuffer:
+            slot = add_command_stream_slot(stream, VOGL_NAMESPACE_BUFFERS, trace_packet.get_param_value<GLuint>(1));
+            break;
+        case VOGL_ENTRYPOINT_glBindFramebuffer:
+            slot = add_command_stream_slot(stream, VOGL_NAMESPACE_FRAMEBUFFERS, trace_packet.get_param_value<GLuint>(1));
+            break;
+        case VOGL_ENTRYPOINT_glBindRenderbuffer:
+            slot = add_command_stream_slot(stream, VOGL_NAMESPACE_RENDER_BUFFERS, trace_packet.get_param_value<GLuint>(1));
+            break;
+        case VOGL_ENTRYPOINT_glBindSampler:
+            slot = add_command_stream_slot(stream, VOGL_NAMESPACE_SAMPLERS, trace_packet.get_param_value<GLuint>(1));
+            break;
+        case VOGL_ENTRYPOINT_glBindVertexArray:
+            slot = add_command_stream_slot(stream, VOGL_NAMESPACE_VERTEX_ARRAYS, trace_packet.get_param_value<GLuint>(0));
+            break;
+        VOGL_COMMAND_STREAM_UNIFORM_CASES:
+        {
+            if (!cur_trace_program)
+                return false;
+            slot = add_command_stream_slot(stream, VOGL_NAMESPACE_LOCATIONS, cur_trace_program, trace_packet.get_param_value<GLint>(0));
+            break;
+        }
+        case VOGL_ENTRYPOINT_glDrawArrays:
+        case VOGL_ENTRYPOINT_glDrawArraysInstanced:
+        case VOGL_ENTRYPOINT_glDrawElements:
+        case VOGL_ENTRYPOINT_glDrawElementsInstanced:
+        case VOGL_ENTRYPOINT_glDrawElementsBaseVertex:
+        case VOGL_ENTRYPOINT_glDrawRangeElements:
+        {
+            // Client side arrays and indices come from the packet's key value map. Without any, the tracer saw an element
+            // array buffer bound, so the indices param is an offset into it.
+            if (trace_packet.get_key_value_map().size())
+                return false;
+            break;
+        }
+        default:
+        {
+            if (!vogl_is_simple_replay_func(entrypoint_id))
+                return false;
+            break;
+        }
+    }
+
+    cmd.m_first_param = stream.m_params.size();
+    cmd.m_slot = slot;
+
+    uint64_t *pParams = stream.m_params.enlarge(trace_packet.total_params());
+    for (uint i = 0; i < trace_packet.total_params(); i++)
+    {
+        if (trace_packet.get_param_desc(i).m_class == VOGL_VALUE_PARAM)
+            pParams[i] = trace_packet.get_param_data(i);
+        else
+            pParams[i] = reinterpret_cast<uintptr_t>(trace_packet.get_param_client_memory_ptr(i));
+    }
+
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_gl_replayer::add_command_stream_slot
+// Returns the stream's slot for the handle (or the program's uniform location), adding it if it's new.
+//----------------------------------------------------------------------------------------------------------------------
+uint vogl_gl_replayer::add_command_stream_slot(vogl_gl_command_stream &stream, vogl_namespace_t handle_namespace, GLuint trace_handle, GLint trace_location)
+{
+    VOGL_FUNC_TRACER
+
+    uint64_t key;
+    vogl_gl_command_stream::slot_hash_map *pSlot_map;
+
+    if (handle_namespace == VOGL_NAMESPACE_LOCATIONS)
+    {
+        key = (static_cast<uint64_t>(trace_handle) << 32) | static_cast<uint32>(trace_location);
+        pSlot_map = &stream.m_location_slots;
+    }
+    else
+    {
+        key = (static_cast<uint64_t>(handle_namespace) << 32) | trace_handle;
+        pSlot_map = &stream.m_handle_slots;
+    }
+
+    vogl_gl_command_stream::slot_hash_map::insert_result result(pSlot_map->insert(key, stream.m_slots.size()));
+    if (!result.second)
+        return result.first->second;
+
+    vogl_gl_command_stream::slot &slot = *stream.m_slots.enlarge(1);
+    slot.m_namespace = handle_namespace;
+    slot.m_trace_handle = trace_handle;
+    slot.m_trace_location = trace_location;
+    slot.m_replay_value = 0;
+    slot.m_resolved = false;
+
+    return result.first->second;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_gl_replayer::resolve_command_stream_slot
+// Looks up the slot's replay handle or location. Slots that don't resolve yet (objects the stream hasn't created, or
+// textures and buffers that haven't been bound for the first time) are left to the packet's usual handler.
+//----------------------------------------------------------------------------------------------------------------------
+void vogl_gl_replayer::resolve_command_stream_slot(vogl_gl_command_stream::slot &slot)
+{
+    VOGL_FUNC_TRACER
+
+    slot.m_resolved = false;
+    slot.m_replay_value = 0;
+
+    if ((!slot.m_trace_handle) && (slot.m_namespace != VOGL_NAMESPACE_LOCATIONS))
+    {
+        slot.m_resolved = true;
+        return;
+    }
+
+    GLuint replay_handle = 0;
+
+    switch (slot.m_namespace)
+    {
+        case VOGL_NAMESPACE_TEXTURES:
+        {
+            vogl_handle_tracker &textures = get_shared_state()->m_shadow_state.m_textures;
+            slot.m_resolved = textures.map_handle_to_inv_handle(slot.m_trace_handle, replay_handle) && (textures.get_target(slot.m_trace_handle) != GL_NONE);
+            break;
+        }
+        case VOGL_NAMESPACE_BUFFERS:
+        {
+            const GLuint *pTarget = get_shared_state()->m_buffer_targets.find_value(slot.m_trace_handle);
+            slot.m_resolved = get_shared_state()->m_buffers.find_value(slot.m_trace_handle, replay_handle) && (pTarget) && (*pTarget != GL_NONE);
+            break;
+        }
+        case VOGL_NAMESPACE_RENDER_BUFFERS:
+            slot.m_resolved = get_shared_state()->m_shadow_state.m_rbos.map_handle_to_inv_handle(slot.m_trace_handle, replay_handle);
+            break;
+        case VOGL_NAMESPACE_SAMPLERS:
+            slot.m_resolved = get_shared_state()->m_sampler_objects.find_value(slot.m_trace_handle, replay_handle);
+            break;
+        case VOGL_NAMESPACE_FRAMEBUFFERS:
+            slot.m_resolved = get_context_state()->m_framebuffers.find_value(slot.m_trace_handle, replay_handle);
+            break;
+        case VOGL_NAMESPACE_VERTEX_ARRAYS:
+            slot.m_resolved = get_context_state()->m_vertex_array_objects.find_value(slot.m_trace_handle, replay_handle);
+            break;
+        case VOGL_NAMESPACE_LOCATIONS:
+        {
+            glsl_program_hash_map::const_iterator it = get_shared_state()->m_glsl_program_hash_map.find(slot.m_trace_handle);
+            if (it == get_shared_state()->m_glsl_program_hash_map.end())
+                break;
+
+            uniform_location_hash_map::const_iterator loc_it = it->second.m_uniform_locations.find(slot.m_trace_location);
+            if (loc_it == it->second.m_uniform_locations.end())
+                break;
+
+            slot.m_replay_value = static_cast<uint32>(loc_it->second);
+            slot.m_resolved = true;
+            return;
+        }
+        default:
+            VOGL_ASSERT_ALWAYS;
+            break;
+    }
+
+    slot.m_replay_value = replay_handle;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_gl_replayer::process_next_command
+// Replays the stream's next command. Direct calls go straight to the driver with the params unpacked by
+// compile_command_stream() and the handle or location from their slot, everything else through
+// process_gl_entrypoint_packet().
+//----------------------------------------------------------------------------------------------------------------------
+vogl_gl_replayer::status_t vogl_gl_replayer::process_next_command(vogl_gl_command_stream &stream)
+{
+    VOGL_ASSERT(!stream.is_at_end());
+
+    const vogl_gl_command_stream::command &cmd = stream.m_commands[stream.m_cur_command++];
+
+    bool direct = (cmd.m_first_param != cUINT32_MAX) && (!m_pPending_snapshot) && (!m_pending_make_current_packet.is_valid()) &&
+                  (m_cur_trace_context == stream.m_trace_context) && (m_pCur_context_state) && (!m_pCur_context_state->is_composing_display_list());
+
+    vogl_gl_command_stream::slot *pSlot = NULL;
+
+    if (direct)
+    {
+        if (!stream.m_slots_resolved)
+        {
+            for (uint i = 0; i < stream.m_slots.size(); i++)
+                resolve_command_stream_slot(stream.m_slots[i]);
+            stream.m_slots_resolved = true;
+        }
+
+        if (cmd.m_slot != cUINT32_MAX)
+        {
+            pSlot = &stream.m_slots[cmd.m_slot];
+
+            // Uniform locations belong to the program the stream had current when it was compiled
+            if ((!pSlot->m_resolved) || ((pSlot->m_namespace == VOGL_NAMESPACE_LOCATIONS) && (pSlot->m_trace_handle != m_pCur_context_state->m_cur_trace_program)))
+                direct = false;
+        }
+    }
+
+    if (direct)
+    {
+        // Indexed draws were compiled assuming an element array buffer is bound, so their indices param is an offset.
+        // If the replay binding differs it's a trace process address, so let the packet handler reject it.
+        uint indices_param = cUINT32_MAX;
+        switch (cmd.m_entrypoint_id)
+        {
+            case VOGL_ENTRYPOINT_glDrawElements:
+            case VOGL_ENTRYPOINT_glDrawElementsInstanced:
+            case VOGL_ENTRYPOINT_glDrawElementsBaseVertex:
+                indices_param = 3;
+                break;
+            case VOGL_ENTRYPOINT_glDrawRangeElements:
+                indices_param = 5;
+                break;
+            default:
+                break;
+        }
+
+        if ((indices_param != cUINT32_MAX) && (stream.m_params[cmd.m_first_param + indices_param]) && (!vogl_get_bound_gl_buffer(GL_ELEMENT_ARRAY_BUFFER)))
+            direct = false;
+    }
+
+    if (!direct)
+    {
+        const context_state *pPrev_context_state = m_pCur_context_state;
+        const bool had_pending_state = (m_pPending_snapshot != NULL) || (m_pending_make_current_packet.is_valid());
+
+        status_t status = process_gl_entrypoint_packet(*cmd.m_pPacket);
+
+        if ((cmd.m_changes_handles) || (had_pending_state) || (m_pCur_context_state != pPrev_context_state))
+            stream.m_slots_resolved = false;
+        else if ((pSlot) && (pSlot->m_namespace != VOGL_NAMESPACE_LOCATIONS))
+            resolve_command_stream_slot(*pSlot); // the first bind of a texture or buffer gives it its target
+
+        return status;
+    }
+
+    vogl_trace_packet &trace_packet = *cmd.m_pPacket;
+    m_pCur_gl_packet = &trace_packet;
+
+    m_last_parsed_call_counter = trace_packet.get_call_counter();
+
+    if ((m_pLoop_snapshot) && (m_loop_incremental) && (!m_loop_tracking_complete))
+        loop_track_packet(trace_packet);
+
+    m_at_frame_boundary = false;
+    m_pCur_context_state->m_last_call_counter = m_last_parsed_call_counter;
+
+    const uint64_t *pParams = &stream.m_params[cmd.m_first_param];
+    const uint64_t slot_value = pSlot ? pSlot->m_replay_value : 0;
+
+#define VOGL_COMMAND_PARAM(type, index) (*reinterpret_cast<const type *>(&pParams[index]))
+#define VOGL_COMMAND_CLIENT_MEMORY(type, index) reinterpret_cast<type *>(static_cast<uintptr_t>(pParams[index]))
+#define VOGL_COMMAND_LOCATION static_cast<GLint>(slot_value)
+
+    switch (cmd.m_entrypoint_id)
+    {
+#define VOGL_SIMPLE_REPLAY_FUNC_BEGIN(name, num_params) \
+    case VOGL_ENTRYPOINT_##name:                        \
+        GL_ENTRYPOINT(name)(
+#define VOGL_SIMPLE_REPLAY_FUNC_PARAM_VALUE(type, index) VOGL_COMMAND_PARAM(type, index)
+#define VOGL_SIMPLE_REPLAY_FUNC_PARAM_SEPERATOR ,
+#define VOGL_SIMPLE_REPLAY_FUNC_PARAM_CLIENT_MEMORY(type, index) VOGL_COMMAND_CLIENT_MEMORY(type, index)
+#define VOGL_SIMPLE_REPLAY_FUNC_END(name) ); \
+    break;
+#include "gl_glx_wgl_simple_replay_funcs.inc"
+#undef VOGL_SIMPLE_REPLAY_FUNC_BEGIN
+#undef VOGL_SIMPLE_REPLAY_FUNC_PARAM_VALUE
+#undef VOGL_SIMPLE_REPLAY_FUNC_PARAM_SEPERATOR
+#undef VOGL_SIMPLE_REPLAY_FUNC_PARAM_CLIENT_MEMORY
+#undef VOGL_SIMPLE_REPLAY_FUNC_END
+
+        case VOGL_ENTRYPOINT_glBindTexture:
+            GL_ENTRYPOINT(glBindTexture)(VOGL_COMMAND_PARAM(GLenum, 0), static_cast<GLuint>(slot_value));
+            break;
+        case VOGL_ENTRYPOINT_glBindBuffer:
+            GL_ENTRYPOINT(glBindBuffer)(VOGL_COMMAND_PARAM(GLenum, 0), static_cast<GLuint>(slot_value));
+            break;
+        case VOGL_ENTRYPOINT_glBindFramebuffer:
+            GL_ENTRYPOINT(glBindFramebuffer)(VOGL_COMMAND_PARAM(GLenum, 0), static_cast<GLuint>(slot_value));
+            break;
+        case VOGL_ENTRYPOINT_glBindRenderbuffer:
+            GL_ENTRYPOINT(glBindRenderbuffer)(VOGL_COMMAND_PARAM(GLenum, 0), static_cast<GLuint>(slot_value));
+            break;
+        case VOGL_ENTRYPOINT_glBindSampler:
+            GL_ENTRYPOINT(glBindSampler)(VOGL_COMMAND_PARAM(GLuint, 0), static_cast<GLuint>(slot_value));
+            break;
+        case VOGL_ENTRYPOINT_glBindVertexArray:
+            GL_ENTRYPOINT(glBindVertexArray)(static_cast<GLuint>(slot_value));
+            break;
+
+        case VOGL_ENTRYPOINT_glUniform1f:
+            GL_ENTRYPOINT(glUniform1f)(VOGL_COMMAND_LOCATION, VOGL_COMMAND_PARAM(GLfloat, 1));
+            break;
+        case VOGL_ENTRYPOINT_glUniform2f:
+            GL_ENTRYPOINT(glUniform2f)(VOGL_COMMAND_LOCATION, VOGL_COMMAND_PARAM(GLfloat, 1), VOGL_COMMAND_PARAM(GLfloat, 2));
+            break;
+        case VOGL_ENTRYPOINT_glUniform3f:
+            GL_ENTRYPOINT(glUniform3f)(VOGL_COMMAND_LOCATION, VOGL_COMMAND_PARAM(GLfloat, 1), VOGL_COMMAND_PARAM(GLfloat, 2), VOGL_COMMAND_PARAM(GLfloat, 3));
+            break;
+        case VOGL_ENTRYPOINT_glUniform4f:
+            GL_ENTRYPOINT(glUniform4f)(VOGL_COMMAND_LOCATION, VOGL_COMMAND_PARAM(GLfloat, 1), VOGL_COMMAND_PARAM(GLfloat, 2), VOGL_COMMAND_PARAM(GLfloat, 3), VOGL_COMMAND_PARAM(GLfloat, 4));
+            break;
+        case VOGL_ENTRYPOINT_glUniform1i:
+            GL_ENTRYPOINT(glUniform1i)(VOGL_COMMAND_LOCATION, VOGL_COMMAND_PARAM(GLint, 1));
+            break;
+        case VOGL_ENTRYPOINT_glUniform2i:
+            GL_ENTRYPOINT(glUniform2i)(VOGL_COMMAND_LOCATION, VOGL_COMMAND_PARAM(GLint, 1), VOGL_COMMAND_PARAM(GLint, 2));
+            break;
+        case VOGL_ENTRYPOINT_glUniform3i:
+            GL_ENTRYPOINT(glUniform3i)(VOGL_COMMAND_LOCATION, VOGL_COMMAND_PARAM(GLint, 1), VOGL_COMMAND_PARAM(GLint, 2), VOGL_COMMAND_PARAM(GLint, 3));
+            break;
+        case VOGL_ENTRYPOINT_glUniform4i:
+            GL_ENTRYPOINT(glUniform4i)(VOGL_COMMAND_LOCATION, VOGL_COMMAND_PARAM(GLint, 1), VOGL_COMMAND_PARAM(GLint, 2), VOGL_COMMAND_PARAM(GLint, 3), VOGL_COMMAND_PARAM(GLint, 4));
+            break;
+        case VOGL_ENTRYPOINT_glUniform1ui:
+            GL_ENTRYPOINT(glUniform1ui)(VOGL_COMMAND_LOCATION, VOGL_COMMAND_PARAM(GLuint, 1));
+            break;
+        case VOGL_ENTRYPOINT_glUniform2ui:
+            GL_ENTRYPOINT(glUniform2ui)(VOGL_COMMAND_LOCATION, VOGL_COMMAND_PARAM(GLuint, 1), VOGL_COMMAND_PARAM(GLuint, 2));
+            break;
+        case VOGL_ENTRYPOINT_glUniform3ui:
+            GL_ENTRYPOINT(glUniform3ui)(VOGL_COMMAND_LOCATION, VOGL_COMMAND_PARAM(GLuint, 1), VOGL_COMMAND_PARAM(GLuint, 2), VOGL_COMMAND_PARAM(GLuint, 3));
+            break;
+        case VOGL_ENTRYPOINT_glUniform4ui:
+            GL_ENTRYPOINT(glUniform4ui)(VOGL_COMMAND_LOCATION, VOGL_COMMAND_PARAM(GLuint, 1), VOGL_COMMAND_PARAM(GLuint, 2), VOGL_COMMAND_PARAM(GLuint, 3), VOGL_COMMAND_PARAM(GLuint, 4));
+            break;
+
+#define VOGL_COMMAND_UNIFORMV_CASE(name, type) \
+    case VOGL_ENTRYPOINT_##name:               \
+        GL_ENTRYPOINT(name)(VOGL_COMMAND_LOCATION, VOGL_COMMAND_PARAM(GLsizei, 1), VOGL_COMMAND_CLIENT_MEMORY(const type, 2)); \
+        break;
+            VOGL_COMMAND_UNIFORMV_CASE(glUniform1fv, GLfloat)
+            VOGL_COMMAND_UNIFORMV_CASE(glUniform2fv, GLfloat)
+            VOGL_COMMAND_UNIFORMV_CASE(glUniform3fv, GLfloat)
+            VOGL_COMMAND_UNIFORMV_CASE(glUniform4fv, GLfloat)
+            VOGL_COMMAND_UNIFORMV_CASE(glUniform1iv, GLint)
+            VOGL_COMMAND_UNIFORMV_CASE(glUniform2iv, GLint)
+            VOGL_COMMAND_UNIFORMV_CASE(glUniform3iv, GLint)
+            VOGL_COMMAND_UNIFORMV_CASE(glUniform4iv, GLint)
+            VOGL_COMMAND_UNIFORMV_CASE(glUniform1uiv, GLuint)
+            VOGL_COMMAND_UNIFORMV_CASE(glUniform2uiv, GLuint)
+            VOGL_COMMAND_UNIFORMV_CASE(glUniform3uiv, GLuint)
+            VOGL_COMMAND_UNIFORMV_CASE(glUniform4uiv, GLuint)
+#undef VOGL_COMMAND_UNIFORMV_CASE
+
+#define VOGL_COMMAND_UNIFORM_MATRIXV_CASE(name) \
+    case VOGL_ENTRYPOINT_##name:                \
+        GL_ENTRYPOINT(name)(VOGL_COMMAND_LOCATION, VOGL_COMMAND_PARAM(GLsizei, 1), VOGL_COMMAND_PARAM(GLboolean, 2), VOGL_COMMAND_CLIENT_MEMORY(const GLfloat, 3)); \
+        break;
+            VOGL_COMMAND_UNIFORM_MATRIXV_CASE(glUniformMatrix2fv)
+            VOGL_COMMAND_UNIFORM_MATRIXV_CASE(glUniformMatrix3fv)
+            VOGL_COMMAND_UNIFORM_MATRIXV_CASE(glUniformMatrix4fv)
+#undef VOGL_COMMAND_UNIFORM_MATRIXV_CASE
+
+        // Same as process_gl_entrypoint_packet_internal(), draws past the kill threshold are skipped but still counted
+        case VOGL_ENTRYPOINT_glDrawArrays:
+            if (m_frame_draw_counter < m_frame_draw_counter_kill_threshold)
+                GL_ENTRYPOINT(glDrawArrays)(VOGL_COMMAND_PARAM(GLenum, 0), VOGL_COMMAND_PARAM(GLint, 1), VOGL_COMMAND_PARAM(GLsizei, 2));
+            break;
+        case VOGL_ENTRYPOINT_glDrawArraysInstanced:
+            GL_ENTRYPOINT(glDrawArraysInstanced)(VOGL_COMMAND_PARAM(GLenum, 0), VOGL_COMMAND_PARAM(GLint, 1), VOGL_COMMAND_PARAM(GLsizei, 2), VOGL_COMMAND_PARAM(GLsizei, 3));
+            break;
+        case VOGL_ENTRYPOINT_glDrawElements:
+            if (m_frame_draw_counter < m_frame_draw_counter_kill_threshold)
+                GL_ENTRYPOINT(glDrawElements)(VOGL_COMMAND_PARAM(GLenum, 0), VOGL_COMMAND_PARAM(GLsizei, 1), VOGL_COMMAND_PARAM(GLenum, 2), reinterpret_cast<const GLvoid *>(static_cast<uintptr_t>(pParams[3])));
+            break;
+        case VOGL_ENTRYPOINT_glDrawElementsInstanced:
+            if (m_frame_draw_counter < m_frame_draw_counter_kill_threshold)
+                GL_ENTRYPOINT(glDrawElementsInstanced)(VOGL_COMMAND_PARAM(GLenum, 0), VOGL_COMMAND_PARAM(GLsizei, 1), VOGL_COMMAND_PARAM(GLenum, 2), reinterpret_cast<const GLvoid *>(static_cast<uintptr_t>(pParams[3])), VOGL_COMMAND_PARAM(GLsizei, 4));
+            break;
+        case VOGL_ENTRYPOINT_glDrawElementsBaseVertex:
+            if (m_frame_draw_counter < m_frame_draw_counter_kill_threshold)
+                GL_ENTRYPOINT(glDrawElementsBaseVertex)(VOGL_COMMAND_PARAM(GLenum, 0), VOGL_COMMAND_PARAM(GLsizei, 1), VOGL_COMMAND_PARAM(GLenum, 2), reinterpret_cast<const GLvoid *>(static_cast<uintptr_t>(pParams[3])), VOGL_COMMAND_PARAM(GLint, 4));
+            break;
+        case VOGL_ENTRYPOINT_glDrawRangeElements:
+            if (m_frame_draw_counter < m_frame_draw_counter_kill_threshold)
+                GL_ENTRYPOINT(glDrawRangeElements)(VOGL_COMMAND_PARAM(GLenum, 0), VOGL_COMMAND_PARAM(GLuint, 1), VOGL_COMMAND_PARAM(GLuint, 2), VOGL_COMMAND_PARAM(GLsizei, 3), VOGL_COMMAND_PARAM(GLenum, 4), reinterpret_cast<const GLvoid *>(static_cast<uintptr_t>(pParams[5])));
+            break;
+
+        default:
+            VOGL_ASSERT_ALWAYS;
+            break;
+    }
+
+#undef VOGL_COMMAND_PARAM
+#undef VOGL_COMMAND_CLIENT_MEMORY
+#undef VOGL_COMMAND_LOCATION
+
+    m_last_processed_call_counter = m_last_parsed_call_counter;
+
+    if (!m_pCur_context_state->m_inside_gl_begin)
+        m_frame_draw_counter += cmd.m_is_draw;
+
+    m_pCur_gl_packet = NULL;
+
+    return cStatusOK;
+}
+
+#undef VOGL_COMMAND_STREAM_UNIFORM_CASES
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_gl_replayer::write_trim_file_internal
+//----------------------------------------------------------------------------------------------------------------------
+bool vogl_gl_replayer::write_trim_file_internal(vogl_trace_packet_array &trim_packets, const dynamic_string &trim_filename, vogl_trace_file_reader &trace_reader, bool optimize_snapshot, bool chunk_blobs, dynamic_string *pSnapshot_id)
+{
+    // Open the output trace
     // TODO: This pretty much ignores the ctypes packet, and uses the one based off the ptr size in the header. The ctypes stuff needs to be refactored, storing it in an explicit packet is bad.
     const vogl_ctypes &trace_gl_ctypes = get_trace_gl_ctypes();
 
@@ -11723,13 +13675,14 @@ bool vogl_gl_replayer::write_trim_file_internal(vogl_trace_packet_array &trim_pa
         if (packet_type != cTSPTGLEntrypoint)
             continue;
 
-        const uint8_vec &packet_buf = trim_packets.get_packet_buf(packet_index);
+        const uint8 *pPacket_buf = trim_packets.get_packet_ptr(packet_index);
+        const uint packet_buf_size = trim_packets.get_packet_size(packet_index);
 
         const vogl_trace_gl_entrypoint_packet *pGL_packet = &trim_packets.get_packet<vogl_trace_gl_entrypoint_packet>(packet_index);
         if (pGL_packet->m_entrypoint_id != VOGL_ENTRYPOINT_glInternalTraceCommandRAD)
             continue;
 
-        if (!trace_packet.deserialize(packet_buf.get_ptr(), packet_buf.size(), true))
+        if (!trace_packet.deserialize(pPacket_buf, packet_buf_size, true))
         {
             console::error("%s: Failed parsing glInternalTraceCommandRAD packet\n", VOGL_FUNCTION_INFO_CSTR);
             return false;
@@ -11765,12 +13718,36 @@ bool vogl_gl_replayer::write_trim_file_internal(vogl_trace_packet_array &trim_pa
         return false;
     }
 
+    // Snapshot blobs go into the output trace's archive, or through a chunked blob manager which leaves manifests in the
+    // archive and writes the chunks as loose files next to the trim file (the trace reader's archive chunk source).
+    vogl_blob_manager *pBlob_manager = trace_writer.get_trace_archive();
+
+    vogl_loose_file_blob_manager chunk_blob_manager;
+    vogl_chunked_blob_manager chunked_blob_manager;
+    if (chunk_blobs)
+    {
+        dynamic_string trim_path, trim_fname;
+        if (!file_utils::split_path(trim_filename.get_ptr(), trim_path, trim_fname))
+            trim_path = ".";
+
+        if ((!chunk_blob_manager.init(cBMFReadWrite, trim_path.get_ptr())) || (!chunked_blob_manager.init(cBMFReadWrite, trace_writer.get_trace_archive(), &chunk_blob_manager)))
+        {
+            console::error("%s: Failed creating chunked blob manager for trim file \"%s\"!\n", VOGL_FUNCTION_INFO_CSTR, trim_filename.get_ptr());
+            trace_writer.close();
+            file_utils::delete_file(trim_filename.get_ptr());
+            return false;
+        }
+
+        pBlob_manager = &chunked_blob_manager;
+    }
+
     if (found_state_snapshot)
     {
-        // Copy over the source trace's archive (it contains the snapshot, along with any files it refers to).
+        // Copy over the source trace's archive (it contains the snapshot, along with any files it refers to). Blobs are read
+        // through the multi blob manager, which reassembles any that were chunked.
         if (trace_reader.get_archive_blob_manager().is_initialized())
         {
-            dynamic_string_array blob_files(trace_reader.get_archive_blob_manager().enumerate());
+            dynamic_string_array blob_files(vogl_chunked_blob_manager::enumerate_blobs(trace_reader.get_archive_blob_manager()));
             for (uint i = 0; i < blob_files.size(); i++)
             {
                 if ((blob_files[i].is_empty()) || (blob_files[i] == VOGL_TRACE_ARCHIVE_FRAME_FILE_OFFSETS_FILENAME))
@@ -11778,7 +13755,7 @@ bool vogl_gl_replayer::write_trim_file_internal(vogl_trace_packet_array &trim_pa
 
                 vogl_message_printf("Adding blob file %s to output trace archive\n", blob_files[i].get_ptr());
 
-                if (!trace_writer.get_trace_archive()->copy_file(trace_reader.get_archive_blob_manager(), blob_files[i], blob_files[i]).has_content())
+                if (!pBlob_manager->copy_file(trace_reader.get_multi_blob_manager(), blob_files[i], blob_files[i]).has_content())
                 {
                     vogl_error_printf("%s: Failed copying blob data for file \"%s\" to output trace archive!\n", VOGL_FUNCTION_INFO_CSTR, blob_files[i].get_ptr());
                     return false;
@@ -11812,7 +13789,7 @@ bool vogl_gl_replayer::write_trim_file_internal(vogl_trace_packet_array &trim_pa
         pTrim_snapshot->set_frame_index(0);
 
         json_document doc;
-        if (!pTrim_snapshot->serialize(*doc.get_root(), *trace_writer.get_trace_archive(), &trace_gl_ctypes))
+        if (!pTrim_snapshot->serialize(*doc.get_root(), *pBlob_manager, &trace_gl_ctypes))
         {
             console::error("%s: Failed serializing GL state snapshot!\n", VOGL_FUNCTION_INFO_CSTR);
             trace_writer.close();
@@ -11823,13 +13800,21 @@ bool vogl_gl_replayer::write_trim_file_internal(vogl_trace_packet_array &trim_pa
         vogl::vector<char> snapshot_data;
         doc.serialize(snapshot_data, true, 0, false);
 
-        uint8_vec binary_snapshot_data;
-        doc.binary_serialize(binary_snapshot_data);
+        doc.clear();
+
+        uint8_vec native_snapshot_data;
+        if (!pTrim_snapshot->native_serialize(native_snapshot_data, *pBlob_manager, &trace_gl_ctypes))
+        {
+            console::error("%s: Failed serializing native GL state snapshot!\n", VOGL_FUNCTION_INFO_CSTR);
+            trace_writer.close();
+            file_utils::delete_file(trim_filename.get_ptr());
+            return false;
+        }
 
         pTrim_snapshot.reset();
 
         // Write the state_snapshot file to the trace archive
-        dynamic_string snapshot_id(trace_writer.get_trace_archive()->add_buf_compute_unique_id(snapshot_data.get_ptr(), snapshot_data.size(), "state_snapshot", VOGL_TEXT_JSON_EXTENSION));
+        dynamic_string snapshot_id(pBlob_manager->add_buf_compute_unique_id(snapshot_data.get_ptr(), snapshot_data.size(), "state_snapshot", VOGL_TEXT_JSON_EXTENSION));
         if (snapshot_id.is_empty())
         {
             console::error("%s: Failed adding GL snapshot file to output blob manager!\n", VOGL_FUNCTION_INFO_CSTR);
@@ -11843,22 +13828,22 @@ bool vogl_gl_replayer::write_trim_file_internal(vogl_trace_packet_array &trim_pa
 
         snapshot_data.clear();
 
-        // Write the binary_state_snapshot file to the trace archive
-        dynamic_string binary_id(trace_writer.get_trace_archive()->add_buf_compute_unique_id(binary_snapshot_data.get_ptr(), binary_snapshot_data.size(), "binary_state_snapshot", VOGL_BINARY_JSON_EXTENSION));
-        if (binary_id.is_empty())
+        // Write the native_state_snapshot file to the trace archive
+        dynamic_string native_id(pBlob_manager->add_buf_compute_unique_id(native_snapshot_data.get_ptr(), native_snapshot_data.size(), "native_state_snapshot", VOGL_NATIVE_SNAPSHOT_EXTENSION));
+        if (native_id.is_empty())
         {
-            console::error("%s: Failed adding binary GL snapshot file to output blob manager!\n", VOGL_FUNCTION_INFO_CSTR);
+            console::error("%s: Failed adding native GL snapshot file to output blob manager!\n", VOGL_FUNCTION_INFO_CSTR);
             trace_writer.close();
             file_utils::delete_file(trim_filename.get_ptr());
             return false;
         }
 
-        binary_snapshot_data.clear();
+        native_snapshot_data.clear();
 
         key_value_map snapshot_key_value_map;
         snapshot_key_value_map.insert("command_type", "state_snapshot");
         snapshot_key_value_map.insert("id", snapshot_id);
-        snapshot_key_value_map.insert("binary_id", binary_id);
+        snapshot_key_value_map.insert("native_id", native_id);
 
         dynamic_stream snapshot_stream(0);
         if (!vogl_write_glInternalTraceCommandRAD(snapshot_stream, &trace_gl_ctypes, cITCRKeyValueMap, sizeof(snapshot_key_value_map), reinterpret_cast<const GLubyte *>(&snapshot_key_value_map)))
@@ -11887,7 +13872,8 @@ bool vogl_gl_replayer::write_trim_file_internal(vogl_trace_packet_array &trim_pa
 
     for (uint packet_index = 0; packet_index < trim_packets.size(); packet_index++)
     {
-        const uint8_vec &packet_buf = trim_packets.get_packet_buf(packet_index);
+        const uint8 *pPacket_buf = trim_packets.get_packet_ptr(packet_index);
+        const uint packet_buf_size = trim_packets.get_packet_size(packet_index);
 
         const bool is_swap = trim_packets.is_swap_buffers_packet(packet_index);
 
@@ -11899,7 +13885,7 @@ bool vogl_gl_replayer::write_trim_file_internal(vogl_trace_packet_array &trim_pa
             VOGL_ASSERT_ALWAYS;
         }
 
-        if (!trace_writer.write_packet(packet_buf.get_ptr(), packet_buf.size(), is_swap))
+        if (!trace_writer.write_packet(pPacket_buf, packet_buf_size, is_swap))
         {
             console::error("%s: Failed writing trace packet to output trace file \"%s\"!\n", VOGL_FUNCTION_INFO_CSTR, trim_filename.get_ptr());
             trace_writer.close();
@@ -11908,6 +13894,12 @@ bool vogl_gl_replayer::write_trim_file_internal(vogl_trace_packet_array &trim_pa
         }
     }
 
+    if (chunked_blob_manager.is_initialized())
+    {
+        console::message("%s: Wrote %s of %s bytes of chunked blob data as new chunks\n", VOGL_FUNCTION_INFO_CSTR,
+                         uint64_to_string_with_commas(chunked_blob_manager.get_new_chunk_bytes()).get_ptr(), uint64_to_string_with_commas(chunked_blob_manager.get_total_chunked_bytes()).get_ptr());
+    }
+
     bool success = trace_writer.close();
     if (!success)
         console::error("%s: Failed closing wrote trim trace file \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, trim_filename.get_ptr());
@@ -11981,13 +13973,14 @@ bool vogl_gl_replayer::write_trim_file(uint flags, const dynamic_string &trim_fi
                     if (packet_type != cTSPTGLEntrypoint)
                         break;
 
-                    const uint8_vec &packet_buf = trim_packets.get_packet_buf(packet_index);
+                    const uint8 *pPacket_buf = trim_packets.get_packet_ptr(packet_index);
+                    const uint packet_buf_size = trim_packets.get_packet_size(packet_index);
 
                     const vogl_trace_gl_entrypoint_packet *pGL_packet = &trim_packets.get_packet<vogl_trace_gl_entrypoint_packet>(packet_index);
                     if (pGL_packet->m_entrypoint_id != VOGL_ENTRYPOINT_glInternalTraceCommandRAD)
                         break;
 
-                    if (!trace_packet.deserialize(packet_buf.get_ptr(), packet_buf.size(), true))
+                    if (!trace_packet.deserialize(pPacket_buf, packet_buf_size, true))
                     {
                         console::error("%s: Failed parsing glInternalTraceCommandRAD packet\n", VOGL_FUNCTION_INFO_CSTR);
                         return false;
@@ -11995,7 +13988,7 @@ bool vogl_gl_replayer::write_trim_file(uint flags, const dynamic_string &trim_fi
 
                     GLuint cmd = trace_packet.get_param_value<GLuint>(0);
 
-                    new_trim_packets.push_back(packet_buf);
+                    new_trim_packets.push_back(pPacket_buf, packet_buf_size);
 
                     if (cmd == cITCRDemarcation)
                         break;
@@ -12010,27 +14003,28 @@ bool vogl_gl_replayer::write_trim_file(uint flags, const dynamic_string &trim_fi
             uint total_erased_packets = 0;
 
             // Remove any calls before the current one.
-            for (int64_t packet_index = 0; packet_index < trim_packets.size(); packet_index++)
+            vogl::vector<bool> erase_flags(orig_num_packets);
+            for (uint packet_index = 0; packet_index < orig_num_packets; packet_index++)
             {
-                if (trim_packets.get_packet_type(static_cast<uint>(packet_index)) != cTSPTGLEntrypoint)
+                if (trim_packets.get_packet_type(packet_index) != cTSPTGLEntrypoint)
                     continue;
 
-                const vogl_trace_gl_entrypoint_packet *pGL_packet = &trim_packets.get_packet<vogl_trace_gl_entrypoint_packet>(static_cast<uint>(packet_index));
+                const vogl_trace_gl_entrypoint_packet *pGL_packet = &trim_packets.get_packet<vogl_trace_gl_entrypoint_packet>(packet_index);
 
                 if (static_cast<int64_t>(pGL_packet->m_call_counter) <= trim_call_counter)
                 {
-                    trim_packets.erase(static_cast<uint>(packet_index));
-                    packet_index--;
-
+                    erase_flags[packet_index] = true;
                     total_erased_packets++;
                 }
             }
 
+            trim_packets.erase(erase_flags);
+
             console::message("%s: Read %u packets from frame %u, erased %u packets before call counter %" PRIu64 ", storing %u trim packets from source trace file\n", VOGL_FUNCTION_INFO_CSTR, orig_num_packets, trim_frame, total_erased_packets, trim_call_counter, trim_packets.size());
         }
     }
 
-    if (!write_trim_file_internal(trim_packets, trim_filename, trace_reader, (flags & cWriteTrimFileOptimizeSnapshot) != 0, pSnapshot_id))
+    if (!write_trim_file_internal(trim_packets, trim_filename, trace_reader, (flags & cWriteTrimFileOptimizeSnapshot) != 0, (flags & cWriteTrimFileChunkBlobs) != 0, pSnapshot_id))
     {
         console::warning("%s: Trim file write failed, deleting invalid trim trace file %s\n", VOGL_FUNCTION_INFO_CSTR, trim_filename.get_ptr());
 
@@ -28,6 +28,7 @@
 #define VOGL_GL_REPLAYER_H
 
 #include "vogl_unique_ptr.h"
+#include "vogl_hash_bimap.h"
 
 #include "vogl_common.h"
 #include "vogl_trace_stream_types.h"
@@ -38,6 +39,7 @@
 #include "vogl_replay_window.h"
 #include "vogl_gl_state_snapshot.h"
 #include "vogl_blob_manager.h"
+#include "vogl_framebuffer_capturer.h"
 
 // TODO: Make this a command line param
 #define VOGL_MAX_CLIENT_SIDE_VERTEX_ARRAY_SIZE (8U * 1024U * 1024U)
@@ -69,6 +71,90 @@ enum vogl_gl_replayer_flags
     cGLReplayerDisableRestoreFrontBuffer = 0x00020000
 };
 
+//----------------------------------------------------------------------------------------------------------------------
+// class vogl_gl_command_stream
+// GL entrypoint packets compiled by vogl_gl_replayer::compile_command_stream(), for replaying the same calls over and
+// over (voglbench's loops). The calls the replayer can make directly have their params unpacked up front, client memory
+// params point straight into the packets, and handles and uniform locations refer to dense slots which are resolved
+// once per pass instead of on every call. Everything else is replayed from its packet as usual.
+//----------------------------------------------------------------------------------------------------------------------
+class vogl_gl_command_stream
+{
+    VOGL_NO_COPY_OR_ASSIGNMENT_OP(vogl_gl_command_stream);
+
+    friend class vogl_gl_replayer;
+
+public:
+    vogl_gl_command_stream();
+    ~vogl_gl_command_stream();
+
+    void clear();
+
+    // Returns a new empty packet at the end of the stream, deserialize into it before compiling.
+    vogl_trace_packet *add_packet(const vogl_ctypes *pCtypes);
+
+    uint get_num_packets() const
+    {
+        return m_packets.size();
+    }
+    bool is_empty() const
+    {
+        return m_packets.is_empty();
+    }
+
+    // How many of the packets compile_command_stream() made direct calls of.
+    uint get_num_direct_calls() const
+    {
+        return m_num_direct_calls;
+    }
+
+    // Starts the next pass, the slots are resolved again before its first direct call.
+    void rewind()
+    {
+        m_cur_command = 0;
+        m_slots_resolved = false;
+    }
+    bool is_at_end() const
+    {
+        return m_cur_command >= m_commands.size();
+    }
+
+private:
+    struct command
+    {
+        vogl_trace_packet *m_pPacket;
+        gl_entrypoint_id_t m_entrypoint_id;
+        uint m_first_param; // into m_params, or cUINT32_MAX if the packet is replayed as usual
+        uint m_slot;        // cUINT32_MAX if the call names no handle or uniform location
+        bool m_is_draw;
+        bool m_changes_handles; // replayed as usual, and may create, delete or relink objects the slots refer to
+    };
+
+    struct slot
+    {
+        vogl_namespace_t m_namespace; // VOGL_NAMESPACE_LOCATIONS for uniform locations
+        GLuint m_trace_handle;        // the program, for uniform locations
+        GLint m_trace_location;
+        uint64_t m_replay_value;
+        bool m_resolved;
+    };
+
+    vogl::vector<vogl_trace_packet *> m_packets;
+    vogl::vector<command> m_commands;
+    vogl::vector<uint64_t> m_params;
+    vogl::vector<slot> m_slots;
+
+    // (namespace, trace handle) and (trace program, trace location) -> slot index, only used while compiling
+    typedef vogl::hash_map<uint64_t, uint> slot_hash_map;
+    slot_hash_map m_handle_slots;
+    slot_hash_map m_location_slots;
+
+    vogl_trace_ptr_value m_trace_context;
+    uint m_cur_command;
+    uint m_num_direct_calls;
+    bool m_slots_resolved;
+};
+
 //----------------------------------------------------------------------------------------------------------------------
 // class vogl_replayer
 //----------------------------------------------------------------------------------------------------------------------
@@ -249,6 +335,34 @@ public:
         return m_pPending_snapshot;
     }
 
+    // Loop replay: call begin_loop() right after snapshot_state() at the loop's first frame, while the GL state still matches pSnapshot.
+    // From then on the replayer records which objects the replayed calls create, delete or write, and restore_loop_snapshot() only
+    // restores that set (plus the context's general state, if it changed). It falls back to begin_applying_snapshot() whenever the
+    // touched set can't be restored in place (context changes, display lists, mapped buffers, shader edits, etc.).
+    // The snapshot is NOT owned by the replayer, call end_loop() before deleting it.
+    void begin_loop(const vogl_gl_state_snapshot *pSnapshot);
+    status_t restore_loop_snapshot();
+    void end_loop();
+    bool is_looping() const
+    {
+        return m_pLoop_snapshot != NULL;
+    }
+
+    // Loops which replay exactly the same calls on every iteration (see compile_command_stream()) touch the same objects
+    // every time, so what the first iteration touched is kept across incremental restores instead of being tracked again.
+    void set_loop_repeats_exactly(bool repeats_exactly)
+    {
+        m_loop_repeats_exactly = repeats_exactly;
+    }
+
+    // Compiles the stream's packets for process_next_command(). Call with the replayer at the point the first packet is
+    // replayed from (uniform locations are looked up in the program current at that point). Calls are only made directly
+    // in benchmark mode, without any of the dumping or debug flags.
+    void compile_command_stream(vogl_gl_command_stream &stream);
+
+    // Replays the stream's next command, the stream must not be at its end.
+    status_t process_next_command(vogl_gl_command_stream &stream);
+
     void set_frame_draw_counter_kill_threshold(uint64_t thresh)
     {
         m_frame_draw_counter_kill_threshold = thresh;
@@ -280,7 +394,10 @@ public:
     enum write_trim_file_flags
     {
         cWriteTrimFileFromStartOfFrame = 1,
-        cWriteTrimFileOptimizeSnapshot = 2
+        cWriteTrimFileOptimizeSnapshot = 2,
+        // Splits large snapshot blobs into chunks stored once as loose files in the trim file's directory, so trim files
+        // written next to each other (multitrim, keyframes) share the data their snapshots have in common.
+        cWriteTrimFileChunkBlobs = 4
     };
 
     bool write_trim_file(uint flags, const dynamic_string &trim_filename, uint trim_len, vogl_trace_file_reader &trace_reader, dynamic_string *pSnapshot_id = NULL);
@@ -339,6 +456,9 @@ private:
     typedef vogl::hash_map<GLuint, GLuint> gl_handle_hash_map;
     typedef vogl::hash_map<vogl_sync_ptr_value, GLsync, bit_hasher<vogl_sync_ptr_value> > gl_sync_hash_map;
 
+    // Maps trace to replay handles, with an inverse map so replay to trace remapping is O(1).
+    typedef vogl::hash_bimap<GLuint, GLuint> gl_handle_bimap;
+
     typedef vogl::hash_map<GLint, GLint> uniform_location_hash_map;
     struct glsl_program_state
     {
@@ -410,14 +530,14 @@ private:
         GLXContext m_replay_context;
 
         // maps trace to replay handles
-        gl_handle_hash_map m_framebuffers;
-        gl_handle_hash_map m_queries;
-        gl_handle_hash_map m_sampler_objects;
-        gl_handle_hash_map m_buffers;
+        gl_handle_bimap m_framebuffers;
+        gl_handle_bimap m_queries;
+        gl_handle_bimap m_sampler_objects;
+        gl_handle_bimap m_buffers;
         gl_handle_hash_map m_buffer_targets; // maps trace handles to buffer targets
-        gl_handle_hash_map m_vertex_array_objects;
+        gl_handle_bimap m_vertex_array_objects;
 
-        gl_handle_hash_map m_lists;
+        gl_handle_bimap m_lists;
 
         gl_sync_hash_map m_syncs;
 
@@ -427,7 +547,7 @@ private:
         // maps replay query handles to the last active begin target
         vogl_handle_hash_map m_query_targets;
 
-        gl_handle_hash_map m_arb_programs;        // ARB_vertex_program/ARB_fragment_program, maps trace to replay handles
+        gl_handle_bimap m_arb_programs;           // ARB_vertex_program/ARB_fragment_program, maps trace to replay handles
         gl_handle_hash_map m_arb_program_targets; // maps trace programs to targets
 
         GLuint m_cur_replay_program;
@@ -471,6 +591,38 @@ private:
     uint8_vec m_screenshot_buffer;
     uint8_vec m_screenshot_buffer2;
 
+    // Backbuffer screenshots and hashes are read back through a ring of PBO's in the context that was current at
+    // the swap, then encoded and hashed on m_backbuffer_tasks. Jobs complete in any order, but are written out in
+    // swap order.
+    enum
+    {
+        cBackbufferCaptureBufs = 3,
+        cMaxPendingBackbufferJobs = 8
+    };
+
+    struct backbuffer_capture_job
+    {
+        uint m_frame_index;
+        uint m_swap_index;
+        uint m_width;
+        uint m_height;
+        uint m_flags;
+        uint8_vec m_pixels;
+        dynamic_string m_screenshot_filename;
+        void *m_pPNG_data;
+        size_t m_png_size;
+        uint64_t m_hash;
+        bool m_complete;
+    };
+
+    vogl_framebuffer_capturer m_backbuffer_capturer;
+    GLXContext m_backbuffer_capture_context;
+    task_pool m_backbuffer_tasks;
+    mutex m_backbuffer_job_mutex;
+    semaphore m_backbuffer_job_slots;
+    vogl::vector<backbuffer_capture_job *> m_backbuffer_jobs;
+    FILE *m_pBackbuffer_hash_file;
+
     vogl::vector<uint8> m_index_data;
 
     uint64_t m_frame_draw_counter;
@@ -483,6 +635,35 @@ private:
     const vogl_gl_state_snapshot *m_pPending_snapshot;
     bool m_delete_pending_snapshot_after_applying;
 
+    // Loop replay tracking, see begin_loop()
+    enum loop_access_t
+    {
+        cLoopAccessReferenced,
+        cLoopAccessUniforms, // only the program's uniforms were written, so it can be restored without relinking
+        cLoopAccessWritten
+    };
+
+    typedef vogl::hash_map<uint64_t, const vogl_gl_object_state *> loop_object_hash_map;
+    typedef vogl::hash_map<uint64_t, loop_access_t> loop_handle_hash_map; // trace handle -> strongest access by the loop
+    typedef vogl::hash_map<uint64_t, uint64_t> loop_binding_hash_map;     // see loop_get_binding_key() -> trace handle
+
+    const vogl_gl_state_snapshot *m_pLoop_snapshot;
+    vogl_trace_context_ptr_value m_loop_trace_context; // 0 if the snapshot can't be restored incrementally
+    loop_object_hash_map m_loop_snapshot_objects[VOGL_TOTAL_NAMESPACES];
+    loop_handle_hash_map m_loop_touched_handles[VOGL_TOTAL_NAMESPACES];
+    vogl_general_context_state m_loop_general_state; // replay handles, captured when the loop's first call is replayed
+    bool m_loop_general_state_valid;
+    bool m_loop_incremental; // false once the current iteration did something restore_loop_snapshot() can't undo in place
+
+    // The objects bound in the loop's context, tracked from the replayed bind calls so finding the object a call writes
+    // through a binding never has to query GL. Starts out as the snapshot's bindings on every iteration.
+    loop_binding_hash_map m_loop_bindings;
+    uint m_loop_active_texture_unit;
+    bool m_loop_bindings_valid; // false after calls that change bindings in ways that aren't tracked (glPopAttrib etc.)
+
+    bool m_loop_repeats_exactly;
+    bool m_loop_tracking_complete; // set once an iteration has been tracked and restored in place, see set_loop_repeats_exactly()
+
     // TODO: Make a 1st class snapshot cache class
     struct snapshot_cache_entry
     {
@@ -519,19 +700,9 @@ private:
     {
         vogl_gl_replayer &m_replayer;
 
-        // TODO: This searches the entire hash map! Slow!
-        bool remap_replay_to_trace_handle(const gl_handle_hash_map &hash_map, GLuint &handle) const
+        bool remap_replay_to_trace_handle(const gl_handle_bimap &handle_map, GLuint &handle) const
         {
-            VOGL_ASSERT(hash_map.search_table_for_value_get_count(handle) <= 1);
-
-            gl_handle_hash_map::const_iterator it(hash_map.search_table_for_value(handle));
-            if (it != hash_map.end())
-            {
-                VOGL_ASSERT(it->second == handle);
-                handle = it->first;
-                return true;
-            }
-            return false;
+            return handle_map.find_key(handle, handle);
         }
 
     public:
@@ -609,7 +780,7 @@ private:
         virtual bool determine_to_object_target(vogl_namespace_t handle_namespace, uint64_t replay_handle, GLenum &target);
     };
 
-    inline bool gen_handle(gl_handle_hash_map &handle_hash_map, GLuint trace_handle, GLuint replay_handle)
+    inline bool gen_handle(gl_handle_bimap &handle_map, GLuint trace_handle, GLuint replay_handle)
     {
         VOGL_FUNC_TRACER
 
@@ -624,23 +795,16 @@ private:
             process_entrypoint_error("%s: Handle gen failed during replay, but succeeded during trace! Trace handle: %u\n", VOGL_FUNCTION_INFO_CSTR, trace_handle);
             return false;
         }
-        else
+        else if (!handle_map.insert(trace_handle, replay_handle))
         {
-            gl_handle_hash_map::insert_result result(handle_hash_map.insert(trace_handle, replay_handle));
-            if (!result.second)
-            {
-                process_entrypoint_error("%s: Replacing genned GL handle %u trace handle %u in handle hash map (this indicates a handle shadowing error)\n", VOGL_FUNCTION_INFO_CSTR, replay_handle, trace_handle);
-
-                gl_handle_hash_map::iterator it = result.first;
-                it->second = replay_handle;
-            }
+            process_entrypoint_error("%s: Replacing genned GL handle %u trace handle %u in handle hash map (this indicates a handle shadowing error)\n", VOGL_FUNCTION_INFO_CSTR, replay_handle, trace_handle);
         }
 
         return true;
     }
 
     template <typename T>
-    inline bool gen_handles(gl_handle_hash_map &handle_hash_map, GLsizei n, const GLuint *pTrace_ids, T gl_gen_function, GLuint *pReplay_handles)
+    inline bool gen_handles(gl_handle_bimap &handle_map, GLsizei n, const GLuint *pTrace_ids, T gl_gen_function, GLuint *pReplay_handles)
     {
         VOGL_FUNC_TRACER
 
@@ -664,13 +828,9 @@ private:
             if (pReplay_handles)
                 pReplay_handles[i] = replay_id;
 
-            gl_handle_hash_map::insert_result result(handle_hash_map.insert(pTrace_ids[i], replay_id));
-            if (!result.second)
+            if (!handle_map.insert(pTrace_ids[i], replay_id))
             {
                 process_entrypoint_error("%s: TODO: Replacing genned GL handle %u trace handle %u in handle hash map (this indicates a handle shadowing error)\n", VOGL_FUNCTION_INFO_CSTR, replay_id, pTrace_ids[i]);
-
-                gl_handle_hash_map::iterator it = result.first;
-                it->second = replay_id;
             }
         }
 
@@ -678,7 +838,7 @@ private:
     }
 
     template <typename T>
-    inline void delete_handles(gl_handle_hash_map &handle_hash_map, GLsizei trace_n, const GLuint *pTrace_ids, T gl_delete_function)
+    inline void delete_handles(gl_handle_bimap &handle_map, GLsizei trace_n, const GLuint *pTrace_ids, T gl_delete_function)
     {
         VOGL_FUNC_TRACER
 
@@ -691,13 +851,12 @@ private:
             if (!trace_id)
                 continue;
 
-            gl_handle_hash_map::const_iterator it(handle_hash_map.find(trace_id));
-
-            if (it != handle_hash_map.end())
+            GLuint replay_id = 0;
+            if (handle_map.find_value(trace_id, replay_id))
             {
-                replay_ids.push_back(it->second);
+                replay_ids.push_back(replay_id);
 
-                handle_hash_map.erase(pTrace_ids[i]);
+                handle_map.erase(trace_id);
             }
             else
             {
@@ -712,11 +871,11 @@ private:
     }
 
     template <typename T>
-    inline void delete_handle(gl_handle_hash_map &handle_hash_map, GLuint trace_id, T gl_delete_function)
+    inline void delete_handle(gl_handle_bimap &handle_map, GLuint trace_id, T gl_delete_function)
     {
         VOGL_FUNC_TRACER
 
-        delete_handles(handle_hash_map, 1, &trace_id, gl_delete_function);
+        delete_handles(handle_map, 1, &trace_id, gl_delete_function);
     }
 
     template <typename T>
@@ -827,25 +986,25 @@ private:
     }
 
     // TODO: Closely examine each object type and set insert_if_not_found to true for the ones that don't really need to be genned (textures is already done)
-    inline GLuint map_handle(gl_handle_hash_map &handle_hash_map, GLuint trace_handle, bool insert_if_not_found = false)
+    inline GLuint map_handle(gl_handle_bimap &handle_map, GLuint trace_handle, bool insert_if_not_found = false)
     {
         VOGL_FUNC_TRACER
 
         if (!trace_handle)
             return 0;
 
-        gl_handle_hash_map::const_iterator it = handle_hash_map.find(trace_handle);
-        if (it == handle_hash_map.end())
+        GLuint replay_handle = 0;
+        if (!handle_map.find_value(trace_handle, replay_handle))
         {
             process_entrypoint_warning("%s: Couldn't map trace GL handle %u to GL handle, using trace handle instead (handle may not have been genned)\n", VOGL_FUNCTION_INFO_CSTR, trace_handle);
 
             if (insert_if_not_found)
-                handle_hash_map.insert(trace_handle, trace_handle);
+                handle_map.insert(trace_handle, trace_handle);
 
             return trace_handle;
         }
 
-        return it->second;
+        return replay_handle;
     }
 
     inline bool map_handle(vogl_handle_tracker &handle_tracker, GLuint trace_handle, GLuint &replay_handle)
@@ -1304,6 +1463,12 @@ private:
     status_t process_internal_trace_command(const vogl_trace_gl_entrypoint_packet &gl_packet);
 
     void snapshot_backbuffer();
+    static bool backbuffer_capture_callback(uint width, uint height, uint pitch, size_t size, GLenum pixel_format, GLenum pixel_type, const void *pImage, void *pOpaque, uint64_t frame_index);
+    bool queue_backbuffer_job(uint width, uint height, const void *pImage, size_t size, uint64_t frame_index);
+    void process_backbuffer_job(uint64_t data, void *pData_ptr);
+    void write_completed_backbuffer_jobs();
+    void release_backbuffer_capturer(GLXContext next_replay_context);
+    void finish_backbuffer_captures();
 
     bool check_program_binding_shadow();
     void handle_use_program(GLuint trace_handle, gl_entrypoint_id_t entrypoint_id);
@@ -1318,19 +1483,35 @@ private:
     status_t restore_context(vogl_handle_remapper &trace_to_replay_remapper, const vogl_gl_state_snapshot &snapshot, const vogl_context_snapshot &context_snapshot);
     status_t restore_objects(vogl_handle_remapper &trace_to_replay_remapper, const vogl_gl_state_snapshot &snapshot, const vogl_context_snapshot &context_state, vogl_gl_object_state_type state_type, vogl_const_gl_object_state_ptr_vec &objects_to_delete);
     vogl_gl_replayer::status_t restore_display_lists(vogl_handle_remapper &trace_to_replay_remapper, const vogl_gl_state_snapshot &snapshot, const vogl_context_snapshot &context_snapshot);
-    status_t restore_general_state(vogl_handle_remapper &trace_to_replay_remapper, const vogl_gl_state_snapshot &snapshot, const vogl_context_snapshot &context_snapshot);
+    status_t restore_object(vogl_handle_remapper &trace_to_replay_remapper, const vogl_gl_object_state *pState_obj, GLuint64 &restore_handle);
+    status_t restore_general_state(vogl_handle_remapper &trace_to_replay_remapper, const vogl_gl_state_snapshot &snapshot, const vogl_context_snapshot &context_snapshot, bool restore_state_vector = true);
     status_t update_context_shadows(vogl_handle_remapper &trace_to_replay_remapper, const vogl_gl_state_snapshot &snapshot, const vogl_context_snapshot &context_snapshot);
     void handle_marked_for_deleted_objects(vogl_const_gl_object_state_ptr_vec &objects_to_delete, trace_to_replay_handle_remapper &trace_to_replay_remapper);
     bool determine_used_program_handles(const vogl_trace_packet_array &trim_packets, vogl_handle_hash_set &replay_program_handles);
 
     vogl_gl_replayer::status_t process_applying_pending_snapshot();
+
+    void clear_loop_tracking();
+    void loop_touch_handle(vogl_namespace_t handle_namespace, uint64_t trace_handle, loop_access_t access);
+    void loop_touch_bound_object(GLenum target);
+    uint64_t loop_get_binding_key(GLenum binding) const;
+    void loop_track_bindings(const vogl_trace_packet &trace_packet, GLenum target);
+    void loop_init_snapshot_bindings();
+    void loop_track_packet(const vogl_trace_packet &trace_packet);
+    bool loop_can_restore_incrementally();
+    status_t restore_loop_objects(trace_to_replay_handle_remapper &trace_to_replay_remapper, bool &recreated_objects);
+
+    bool compile_direct_call(vogl_gl_command_stream &stream, vogl_trace_packet &trace_packet, GLuint cur_trace_program, vogl_gl_command_stream::command &cmd);
+    uint add_command_stream_slot(vogl_gl_command_stream &stream, vogl_namespace_t handle_namespace, GLuint trace_handle, GLint trace_location = 0);
+    void resolve_command_stream_slot(vogl_gl_command_stream::slot &slot);
+
     bool validate_program_and_shader_handle_tables();
     bool validate_textures();
 
-    void fill_replay_handle_hash_set(vogl_handle_hash_set &replay_handle_hash, const gl_handle_hash_map &trace_to_replay_hash);
+    void fill_replay_handle_hash_set(vogl_handle_hash_set &replay_handle_hash, const gl_handle_bimap &trace_to_replay_map);
 
     // write_trim_file_internal() may modify trim_packets
-    bool write_trim_file_internal(vogl_trace_packet_array &trim_packets, const dynamic_string &trim_filename, vogl_trace_file_reader &trace_reader, bool optimize_snapshot, dynamic_string *pSnapshot_id);
+    bool write_trim_file_internal(vogl_trace_packet_array &trim_packets, const dynamic_string &trim_filename, vogl_trace_file_reader &trace_reader, bool optimize_snapshot, bool chunk_blobs, dynamic_string *pSnapshot_id);
 
     bool dump_frontbuffer_to_file(const dynamic_string &filename);
 
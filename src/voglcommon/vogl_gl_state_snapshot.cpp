@@ -26,6 +26,9 @@
 // File: vogl_gl_state_snapshot.cpp
 #include "vogl_gl_state_snapshot.h"
 #include "vogl_uuid.h"
+#include "vogl_native_snapshot.h"
+#include "vogl_dynamic_stream.h"
+#include "vogl_buffer_stream.h"
 
 vogl_context_snapshot::vogl_context_snapshot()
     : m_is_valid(false)
@@ -613,6 +616,175 @@ bool vogl_context_snapshot::deserialize(const json_node &node, const vogl_blob_m
     return true;
 }
 
+bool vogl_context_snapshot::native_serialize(data_stream_serializer &serializer, vogl_blob_manager &blob_manager, const vogl_ctypes *pCtypes) const
+{
+    VOGL_FUNC_TRACER
+
+    if (!m_is_valid)
+        return false;
+
+    // Record order and the JSON/native choice for each member is fixed by cNativeSnapshotVersion.
+    if (!vogl_native_write_json_obj(serializer, blob_manager, m_context_desc))
+        return false;
+
+    if (!vogl_native_write_optional_json_obj(serializer, blob_manager, m_context_info))
+        return false;
+
+    if ((!vogl_native_write_encoding(serializer, cNSRENative)) || (!m_general_state.native_serialize(serializer)))
+        return false;
+
+    json_document display_list_doc;
+    if (!m_display_list_state.serialize(display_list_doc.get_root()->add_object("value"), blob_manager, pCtypes))
+        return false;
+    if (!vogl_native_write_json(serializer, display_list_doc))
+        return false;
+
+    if ((!vogl_native_write_optional_json_obj(serializer, blob_manager, m_texenv_state)) ||
+        (!vogl_native_write_optional_json_obj(serializer, blob_manager, m_material_state)) ||
+        (!vogl_native_write_optional_json_obj(serializer, blob_manager, m_light_state)) ||
+        (!vogl_native_write_optional_json_obj(serializer, blob_manager, m_matrix_state, true)) ||
+        (!vogl_native_write_optional_json_obj(serializer, blob_manager, m_polygon_stipple_state)) ||
+        (!vogl_native_write_optional_json_obj(serializer, blob_manager, m_current_vertex_attrib_state, true)) ||
+        (!vogl_native_write_optional_json_obj(serializer, blob_manager, m_arb_program_environment_state)))
+    {
+        return false;
+    }
+
+    // Objects are grouped by type like the JSON "state_objects" node, types are written by name.
+    uint num_types = 0;
+    for (vogl_gl_object_state_type state_type = static_cast<vogl_gl_object_state_type>(0); state_type < cGLSTTotalTypes; state_type = static_cast<vogl_gl_object_state_type>(state_type + 1))
+    {
+        for (uint i = 0; i < m_object_ptrs.size(); i++)
+        {
+            if (m_object_ptrs[i]->get_type() == state_type)
+            {
+                num_types++;
+                break;
+            }
+        }
+    }
+
+    if (!serializer.write_uint_vlc(num_types))
+        return false;
+
+    vogl_gl_object_state_ptr_vec obj_ptrs;
+
+    for (vogl_gl_object_state_type state_type = static_cast<vogl_gl_object_state_type>(0); state_type < cGLSTTotalTypes; state_type = static_cast<vogl_gl_object_state_type>(state_type + 1))
+    {
+        get_all_objects_of_category(state_type, obj_ptrs);
+        if (obj_ptrs.is_empty())
+            continue;
+
+        if ((!serializer.write_c_str(get_gl_object_state_type_str(state_type))) || (!serializer.write_uint_vlc(obj_ptrs.size())))
+            return false;
+
+        for (uint i = 0; i < obj_ptrs.size(); i++)
+        {
+            if (!obj_ptrs[i]->native_serialize(serializer, blob_manager))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+bool vogl_context_snapshot::native_deserialize(data_stream_serializer &serializer, const vogl_blob_manager &blob_manager, const vogl_ctypes *pCtypes)
+{
+    VOGL_FUNC_TRACER
+
+    clear();
+
+    if ((!vogl_native_read_json_obj(serializer, blob_manager, m_context_desc)) ||
+        (!vogl_native_read_optional_json_obj(serializer, blob_manager, m_context_info)))
+    {
+        clear();
+        return false;
+    }
+
+    vogl_native_snapshot_record_encoding encoding;
+    if ((!vogl_native_read_encoding(serializer, encoding)) || (encoding != cNSRENative) || (!m_general_state.native_deserialize(serializer)))
+    {
+        clear();
+        return false;
+    }
+
+    {
+        json_document display_list_doc;
+        const json_node *pDisplay_lists_node = NULL;
+        if (vogl_native_read_json(serializer, display_list_doc))
+            pDisplay_lists_node = display_list_doc.get_root()->find_child_object("value");
+
+        if ((!pDisplay_lists_node) || (!m_display_list_state.deserialize(*pDisplay_lists_node, blob_manager, pCtypes)))
+        {
+            clear();
+            return false;
+        }
+    }
+
+    if ((!vogl_native_read_optional_json_obj(serializer, blob_manager, m_texenv_state)) ||
+        (!vogl_native_read_optional_json_obj(serializer, blob_manager, m_material_state)) ||
+        (!vogl_native_read_optional_json_obj(serializer, blob_manager, m_light_state)) ||
+        (!vogl_native_read_optional_json_obj(serializer, blob_manager, m_matrix_state)) ||
+        (!vogl_native_read_optional_json_obj(serializer, blob_manager, m_polygon_stipple_state)) ||
+        (!vogl_native_read_optional_json_obj(serializer, blob_manager, m_current_vertex_attrib_state)) ||
+        (!vogl_native_read_optional_json_obj(serializer, blob_manager, m_arb_program_environment_state)))
+    {
+        clear();
+        return false;
+    }
+
+    uint num_types;
+    if (!serializer.read_uint_vlc(num_types))
+    {
+        clear();
+        return false;
+    }
+
+    for (uint type_iter = 0; type_iter < num_types; type_iter++)
+    {
+        char type_str[128];
+        uint num_objects;
+        if ((!serializer.read_c_str(type_str, sizeof(type_str))) || (!serializer.read_uint_vlc(num_objects)))
+        {
+            clear();
+            return false;
+        }
+
+        // Unlike the JSON path unknown types can't be skipped, records aren't length prefixed.
+        vogl_gl_object_state_type state_type = determine_gl_object_state_type_from_str(type_str);
+        if (state_type == cGLSTInvalid)
+        {
+            vogl_error_printf("%s: Unknown object state type \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, type_str);
+            clear();
+            return false;
+        }
+
+        for (uint i = 0; i < num_objects; i++)
+        {
+            vogl_gl_object_state *pState_obj = vogl_gl_object_state_factory(state_type);
+            if (!pState_obj)
+            {
+                clear();
+                return false;
+            }
+
+            if (!pState_obj->native_deserialize(serializer, blob_manager))
+            {
+                vogl_delete(pState_obj);
+
+                clear();
+                return false;
+            }
+
+            m_object_ptrs.push_back(pState_obj);
+        }
+    }
+
+    m_is_valid = true;
+
+    return true;
+}
+
 vogl_gl_state_snapshot::vogl_gl_state_snapshot()
     : m_window_width(0),
       m_window_height(0),
@@ -831,22 +1003,187 @@ bool vogl_gl_state_snapshot::deserialize(const json_node &node, const vogl_blob_
     return true;
 }
 
+bool vogl_gl_state_snapshot::native_serialize(data_stream_serializer &serializer, vogl_blob_manager &blob_manager, const vogl_ctypes *pCtypes) const
+{
+    VOGL_FUNC_TRACER
+
+    if (!m_is_valid)
+        return false;
+
+    if (!vogl_native_write_header(serializer))
+        return false;
+
+    for (uint i = 0; i < 4; i++)
+        if (!serializer.write_value(m_uuid[i]))
+            return false;
+
+    if ((!serializer.write_value(static_cast<uint32>(m_window_width))) ||
+        (!serializer.write_value(static_cast<uint32>(m_window_height))) ||
+        (!serializer.write_value(static_cast<uint64_t>(m_cur_trace_context))) ||
+        (!serializer.write_value(static_cast<uint32>(m_frame_index))) ||
+        (!serializer.write_value(m_gl_call_counter)) ||
+        (!serializer.write_value(static_cast<uint8>(m_at_frame_boundary))) ||
+        (!serializer.write_value(static_cast<uint8>(m_is_restorable))))
+    {
+        return false;
+    }
+
+    json_document client_side_arrays_doc;
+    if ((!vogl_json_serialize_vec(*client_side_arrays_doc.get_root(), blob_manager, "client_side_vertex_attrib_ptrs", m_client_side_vertex_attrib_ptrs)) ||
+        (!vogl_json_serialize_vec(*client_side_arrays_doc.get_root(), blob_manager, "client_side_array_ptrs", m_client_side_array_ptrs)) ||
+        (!vogl_json_serialize_vec(*client_side_arrays_doc.get_root(), blob_manager, "client_side_texcoord_ptrs", m_client_side_texcoord_ptrs)) ||
+        (!vogl_native_write_json(serializer, client_side_arrays_doc)))
+    {
+        return false;
+    }
+
+    if (!serializer.write_uint_vlc(m_context_ptrs.size()))
+        return false;
+
+    for (uint i = 0; i < m_context_ptrs.size(); i++)
+    {
+        // NULL entries are written as empty objects by the JSON path, keep them distinguishable here too.
+        if (!serializer.write_value(static_cast<uint8>(m_context_ptrs[i] != NULL)))
+            return false;
+
+        if ((m_context_ptrs[i]) && (!m_context_ptrs[i]->native_serialize(serializer, blob_manager, pCtypes)))
+            return false;
+    }
+
+    return vogl_native_write_optional_json_obj(serializer, blob_manager, m_default_framebuffer);
+}
+
+bool vogl_gl_state_snapshot::native_deserialize(data_stream_serializer &serializer, const vogl_blob_manager &blob_manager, const vogl_ctypes *pCtypes)
+{
+    VOGL_FUNC_TRACER
+
+    clear();
+
+    if (!vogl_native_read_header(serializer))
+        return false;
+
+    for (uint i = 0; i < 4; i++)
+    {
+        if (!serializer.read_object(m_uuid[i]))
+        {
+            clear();
+            return false;
+        }
+    }
 
+    uint32 window_width, window_height, frame_index;
+    uint64_t cur_trace_context;
+    uint8 at_frame_boundary, is_restorable;
+    if ((!serializer.read_object(window_width)) ||
+        (!serializer.read_object(window_height)) ||
+        (!serializer.read_object(cur_trace_context)) ||
+        (!serializer.read_object(frame_index)) ||
+        (!serializer.read_object(m_gl_call_counter)) ||
+        (!serializer.read_object(at_frame_boundary)) ||
+        (!serializer.read_object(is_restorable)) ||
+        (!window_width) || (!window_height))
+    {
+        clear();
+        return false;
+    }
 
+    m_window_width = window_width;
+    m_window_height = window_height;
+    m_cur_trace_context = static_cast<vogl_trace_ptr_value>(cur_trace_context);
+    m_frame_index = frame_index;
+    m_at_frame_boundary = at_frame_boundary != 0;
+    m_is_restorable = is_restorable != 0;
 
+    {
+        json_document client_side_arrays_doc;
+        if ((!vogl_native_read_json(serializer, client_side_arrays_doc)) ||
+            (!vogl_json_deserialize_vec(*client_side_arrays_doc.get_root(), blob_manager, "client_side_vertex_attrib_ptrs", m_client_side_vertex_attrib_ptrs)) ||
+            (!vogl_json_deserialize_vec(*client_side_arrays_doc.get_root(), blob_manager, "client_side_array_ptrs", m_client_side_array_ptrs)) ||
+            (!vogl_json_deserialize_vec(*client_side_arrays_doc.get_root(), blob_manager, "client_side_texcoord_ptrs", m_client_side_texcoord_ptrs)))
+        {
+            clear();
+            return false;
+        }
+    }
 
+    uint num_contexts;
+    if (!serializer.read_uint_vlc(num_contexts))
+    {
+        clear();
+        return false;
+    }
 
+    for (uint i = 0; i < num_contexts; i++)
+    {
+        uint8 present;
+        if (!serializer.read_object(present))
+        {
+            clear();
+            return false;
+        }
 
+        // Matches vogl_json_deserialize_ptr_vec(), which creates a (possibly invalid) snapshot for every entry.
+        vogl_context_snapshot *pContext = vogl_new(vogl_context_snapshot);
+        if ((present) && (!pContext->native_deserialize(serializer, blob_manager, pCtypes)))
+        {
+            vogl_delete(pContext);
+            clear();
+            return false;
+        }
 
+        m_context_ptrs.push_back(pContext);
+    }
 
+    if (!vogl_native_read_optional_json_obj(serializer, blob_manager, m_default_framebuffer))
+    {
+        clear();
+        return false;
+    }
 
+    m_is_valid = true;
 
+    return true;
+}
 
+bool vogl_gl_state_snapshot::native_serialize(uint8_vec &buf, vogl_blob_manager &blob_manager, const vogl_ctypes *pCtypes) const
+{
+    VOGL_FUNC_TRACER
 
+    dynamic_stream dyn_stream;
+    data_stream_serializer serializer(dyn_stream);
+    if (!native_serialize(serializer, blob_manager, pCtypes))
+        return false;
 
+    buf.swap(dyn_stream.get_buf());
 
+    return true;
+}
 
+bool vogl_gl_state_snapshot::deserialize_blob(const uint8_vec &blob_data, const vogl_blob_manager &blob_manager, const vogl_ctypes *pCtypes)
+{
+    VOGL_FUNC_TRACER
 
+    if (vogl_is_native_snapshot(blob_data.get_ptr(), blob_data.size()))
+    {
+        buffer_stream buf_stream(blob_data.get_ptr(), blob_data.size());
+        data_stream_serializer serializer(buf_stream);
+        return native_deserialize(serializer, blob_manager, pCtypes);
+    }
 
+    json_document doc;
+    if ((!doc.binary_deserialize(blob_data)) || (!doc.get_root()))
+    {
+        vogl_error_printf("%s: Failed deserializing JSON snapshot blob data\n", VOGL_FUNCTION_INFO_CSTR);
+        return false;
+    }
 
+    return deserialize(*doc.get_root(), blob_manager, pCtypes);
+}
 
+dynamic_string vogl_gl_state_snapshot::get_blob_id(const key_value_map &kvm)
+{
+    dynamic_string id(kvm.get_string("native_id"));
+    if (id.is_empty())
+        id = kvm.get_string("binary_id");
+    return id;
+}
@@ -30,6 +30,7 @@
 #include "vogl_core.h"
 #include "vogl_sparse_vector.h"
 #include "vogl_md5.h"
+#include "vogl_value.h"
 
 #include "vogl_common.h"
 #include "vogl_general_context_state.h"
@@ -298,6 +299,9 @@ public:
     bool serialize(json_node &node, vogl_blob_manager &blob_manager, const vogl_ctypes *pCtypes) const;
     bool deserialize(const json_node &node, const vogl_blob_manager &blob_manager, const vogl_ctypes *pCtypes);
 
+    bool native_serialize(data_stream_serializer &serializer, vogl_blob_manager &blob_manager, const vogl_ctypes *pCtypes) const;
+    bool native_deserialize(data_stream_serializer &serializer, const vogl_blob_manager &blob_manager, const vogl_ctypes *pCtypes);
+
 private:
     vogl_context_desc m_context_desc;
     vogl_context_info m_context_info;
@@ -402,6 +406,18 @@ public:
     bool serialize(json_node &node, vogl_blob_manager &blob_manager, const vogl_ctypes *pCtypes) const;
     bool deserialize(const json_node &node, const vogl_blob_manager &blob_manager, const vogl_ctypes *pCtypes);
 
+    // Native binary snapshot encoding (see vogl_native_snapshot.h). Writes and reads the state directly instead of going
+    // through a json_node tree, JSON remains available through serialize()/deserialize() for export.
+    bool native_serialize(data_stream_serializer &serializer, vogl_blob_manager &blob_manager, const vogl_ctypes *pCtypes) const;
+    bool native_deserialize(data_stream_serializer &serializer, const vogl_blob_manager &blob_manager, const vogl_ctypes *pCtypes);
+    bool native_serialize(uint8_vec &buf, vogl_blob_manager &blob_manager, const vogl_ctypes *pCtypes) const;
+
+    // Deserializes a "state_snapshot" blob from a trace archive, in either the native encoding or UBJ.
+    bool deserialize_blob(const uint8_vec &blob_data, const vogl_blob_manager &blob_manager, const vogl_ctypes *pCtypes);
+
+    // Blob id of the snapshot referenced by a "state_snapshot" key value map, the native encoding ("native_id") is preferred over UBJ ("binary_id").
+    static dynamic_string get_blob_id(const key_value_map &kvm);
+
     md5_hash get_uuid() const
     {
         return m_uuid;
@@ -0,0 +1,206 @@
+/**************************************************************************
+ *
+ * Copyright 2013-2014 RAD Game Tools and Valve Software
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+// File: vogl_native_snapshot.cpp
+#include "vogl_native_snapshot.h"
+
+// Upper bound on a single embedded JSON record, anything larger means the stream is corrupt.
+#define VOGL_NATIVE_SNAPSHOT_MAX_JSON_RECORD_SIZE (1024U * 1024U * 1024U)
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_is_native_snapshot
+//----------------------------------------------------------------------------------------------------------------------
+bool vogl_is_native_snapshot(const uint8 *pData, uint data_size)
+{
+    if ((!pData) || (data_size < sizeof(vogl_native_snapshot_header)))
+        return false;
+
+    uint32 magic = static_cast<uint32>(pData[0]) | (static_cast<uint32>(pData[1]) << 8) | (static_cast<uint32>(pData[2]) << 16) | (static_cast<uint32>(pData[3]) << 24);
+    return magic == cNativeSnapshotMagic;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_native_write_header
+//----------------------------------------------------------------------------------------------------------------------
+bool vogl_native_write_header(data_stream_serializer &serializer)
+{
+    VOGL_FUNC_TRACER
+
+    return serializer.write_value(static_cast<uint32>(cNativeSnapshotMagic)) &&
+           serializer.write_value(static_cast<uint16>(cNativeSnapshotVersion)) &&
+           serializer.write_value(static_cast<uint16>(sizeof(vogl_native_snapshot_header)));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_native_read_header
+//----------------------------------------------------------------------------------------------------------------------
+bool vogl_native_read_header(data_stream_serializer &serializer)
+{
+    VOGL_FUNC_TRACER
+
+    vogl_native_snapshot_header hdr;
+    if ((!serializer.read_object(hdr.m_magic)) || (!serializer.read_object(hdr.m_version)) || (!serializer.read_object(hdr.m_header_size)))
+        return false;
+
+    if (hdr.m_magic != cNativeSnapshotMagic)
+    {
+        vogl_error_printf("%s: Not a native state snapshot\n", VOGL_FUNCTION_INFO_CSTR);
+        return false;
+    }
+
+    if (hdr.m_version > cNativeSnapshotVersion)
+    {
+        vogl_error_printf("%s: Native state snapshot version %u is newer than the supported version %u\n", VOGL_FUNCTION_INFO_CSTR, hdr.m_version, cNativeSnapshotVersion);
+        return false;
+    }
+
+    if (hdr.m_header_size < sizeof(vogl_native_snapshot_header))
+        return false;
+
+    // Later versions may append fields to the header.
+    uint extra_size = hdr.m_header_size - sizeof(vogl_native_snapshot_header);
+    if ((extra_size) && (!serializer.skip(extra_size)))
+        return false;
+
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_native_write_json
+//----------------------------------------------------------------------------------------------------------------------
+bool vogl_native_write_json(data_stream_serializer &serializer, const json_document &doc)
+{
+    VOGL_FUNC_TRACER
+
+    uint8_vec ubj_data;
+    doc.binary_serialize(ubj_data);
+
+    if (!vogl_native_write_encoding(serializer, cNSREJSON))
+        return false;
+    if (!serializer.write_value(static_cast<uint32>(ubj_data.size())))
+        return false;
+
+    return serializer.write(ubj_data.get_ptr(), ubj_data.size());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_native_read_json
+//----------------------------------------------------------------------------------------------------------------------
+bool vogl_native_read_json(data_stream_serializer &serializer, json_document &doc)
+{
+    VOGL_FUNC_TRACER
+
+    vogl_native_snapshot_record_encoding encoding;
+    if ((!vogl_native_read_encoding(serializer, encoding)) || (encoding != cNSREJSON))
+        return false;
+
+    return vogl_native_read_json_body(serializer, doc);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_native_read_json_body
+//----------------------------------------------------------------------------------------------------------------------
+bool vogl_native_read_json_body(data_stream_serializer &serializer, json_document &doc)
+{
+    VOGL_FUNC_TRACER
+
+    uint32 size;
+    if ((!serializer.read_object(size)) || (size > VOGL_NATIVE_SNAPSHOT_MAX_JSON_RECORD_SIZE))
+        return false;
+
+    uint8_vec ubj_data(size);
+    if ((size) && (!serializer.read(ubj_data.get_ptr(), size)))
+        return false;
+
+    return doc.binary_deserialize(ubj_data) && (doc.get_root() != NULL);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_native_write_elements
+//----------------------------------------------------------------------------------------------------------------------
+bool vogl_native_write_elements(data_stream_serializer &serializer, const void *pElements, uint num_elements, uint element_size)
+{
+    if ((c_vogl_little_endian_platform) || (element_size == 1))
+        return serializer.write(pElements, num_elements * element_size);
+
+    const uint8 *pSrc = static_cast<const uint8 *>(pElements);
+    for (uint i = 0; i < num_elements; i++, pSrc += element_size)
+    {
+        bool success;
+        switch (element_size)
+        {
+            case sizeof(uint16):
+                success = serializer.write_value(*reinterpret_cast<const uint16 *>(pSrc));
+                break;
+            case sizeof(uint32):
+                success = serializer.write_value(*reinterpret_cast<const uint32 *>(pSrc));
+                break;
+            case sizeof(uint64_t):
+                success = serializer.write_value(*reinterpret_cast<const uint64_t *>(pSrc));
+                break;
+            default:
+                VOGL_ASSERT_ALWAYS;
+                return false;
+        }
+        if (!success)
+            return false;
+    }
+
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_native_read_elements
+//----------------------------------------------------------------------------------------------------------------------
+bool vogl_native_read_elements(data_stream_serializer &serializer, void *pElements, uint num_elements, uint element_size)
+{
+    if ((c_vogl_little_endian_platform) || (element_size == 1))
+        return serializer.read(pElements, num_elements * element_size);
+
+    uint8 *pDst = static_cast<uint8 *>(pElements);
+    for (uint i = 0; i < num_elements; i++, pDst += element_size)
+    {
+        bool success;
+        switch (element_size)
+        {
+            case sizeof(uint16):
+                success = serializer.read_object(*reinterpret_cast<uint16 *>(pDst));
+                break;
+            case sizeof(uint32):
+                success = serializer.read_object(*reinterpret_cast<uint32 *>(pDst));
+                break;
+            case sizeof(uint64_t):
+                success = serializer.read_object(*reinterpret_cast<uint64_t *>(pDst));
+                break;
+            default:
+                VOGL_ASSERT_ALWAYS;
+                return false;
+        }
+        if (!success)
+            return false;
+    }
+
+    return true;
+}
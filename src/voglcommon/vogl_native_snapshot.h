@@ -0,0 +1,163 @@
+/**************************************************************************
+ *
+ * Copyright 2013-2014 RAD Game Tools and Valve Software
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+// File: vogl_native_snapshot.h
+//
+// Native binary encoding for GL state snapshots. The JSON path builds a json_node tree for the whole
+// snapshot and then packs it to UBJ; the native path writes the same state straight to a little endian
+// data_stream_serializer with no intermediate tree. JSON stays the export/interchange format.
+//
+// Layout: a vogl_native_snapshot_header, followed by records. Each record starts with a
+// vogl_native_snapshot_record_encoding byte, so readers handle state types that only have a JSON
+// encoding (written as a length prefixed UBJ document) and types with a native encoding equally.
+#ifndef VOGL_NATIVE_SNAPSHOT_H
+#define VOGL_NATIVE_SNAPSHOT_H
+
+#include "vogl_common.h"
+#include "vogl_json.h"
+#include "vogl_data_stream_serializer.h"
+#include "vogl_blob_manager.h"
+
+#define VOGL_NATIVE_SNAPSHOT_EXTENSION "vsnap"
+
+enum
+{
+    cNativeSnapshotMagic = 0x50414E53, // "SNAP"
+
+    // Bump when the layout of any native record changes. Readers reject newer versions.
+    cNativeSnapshotVersion = 1
+};
+
+enum vogl_native_snapshot_record_encoding
+{
+    cNSREJSON = 'J',
+    cNSRENative = 'N'
+};
+
+#pragma pack(push, 1)
+struct vogl_native_snapshot_header
+{
+    uint32 m_magic;
+    uint16 m_version;
+    uint16 m_header_size;
+};
+#pragma pack(pop)
+
+bool vogl_is_native_snapshot(const uint8 *pData, uint data_size);
+
+bool vogl_native_write_header(data_stream_serializer &serializer);
+bool vogl_native_read_header(data_stream_serializer &serializer);
+
+// Record encoding byte helpers.
+inline bool vogl_native_write_encoding(data_stream_serializer &serializer, vogl_native_snapshot_record_encoding encoding)
+{
+    return serializer.write_value(static_cast<uint8>(encoding));
+}
+
+inline bool vogl_native_read_encoding(data_stream_serializer &serializer, vogl_native_snapshot_record_encoding &encoding)
+{
+    uint8 val;
+    if (!serializer.read_object(val))
+        return false;
+    if ((val != cNSREJSON) && (val != cNSRENative))
+        return false;
+    encoding = static_cast<vogl_native_snapshot_record_encoding>(val);
+    return true;
+}
+
+// Writes/reads a JSON record (encoding byte, then the document as length prefixed UBJ). The _body variants
+// are for readers which have already consumed the encoding byte.
+bool vogl_native_write_json(data_stream_serializer &serializer, const json_document &doc);
+bool vogl_native_read_json(data_stream_serializer &serializer, json_document &doc);
+bool vogl_native_read_json_body(data_stream_serializer &serializer, json_document &doc);
+
+// JSON fallback records for state classes with the usual serialize(json_node &, vogl_blob_manager &) interface.
+// The object is serialized into a child named "value" of the record's root, as an array node if as_array is true.
+template <typename T>
+inline bool vogl_native_write_json_obj(data_stream_serializer &serializer, vogl_blob_manager &blob_manager, const T &obj, bool as_array = false)
+{
+    VOGL_FUNC_TRACER
+
+    json_document doc;
+    json_node &node = as_array ? doc.get_root()->add_array("value") : doc.get_root()->add_object("value");
+    if (!obj.serialize(node, blob_manager))
+        return false;
+
+    return vogl_native_write_json(serializer, doc);
+}
+
+template <typename T>
+inline bool vogl_native_read_json_obj_body(data_stream_serializer &serializer, const vogl_blob_manager &blob_manager, T &obj)
+{
+    VOGL_FUNC_TRACER
+
+    json_document doc;
+    if (!vogl_native_read_json_body(serializer, doc))
+        return false;
+
+    const json_node *pNode = doc.get_root()->find_child("value");
+    if (!pNode)
+        return false;
+
+    return obj.deserialize(*pNode, blob_manager);
+}
+
+template <typename T>
+inline bool vogl_native_read_json_obj(data_stream_serializer &serializer, const vogl_blob_manager &blob_manager, T &obj)
+{
+    vogl_native_snapshot_record_encoding encoding;
+    if ((!vogl_native_read_encoding(serializer, encoding)) || (encoding != cNSREJSON))
+        return false;
+
+    return vogl_native_read_json_obj_body(serializer, blob_manager, obj);
+}
+
+// Optional records are preceded by a presence byte.
+template <typename T>
+inline bool vogl_native_write_optional_json_obj(data_stream_serializer &serializer, vogl_blob_manager &blob_manager, const T &obj, bool as_array = false)
+{
+    if (!serializer.write_value(static_cast<uint8>(obj.is_valid())))
+        return false;
+    if (!obj.is_valid())
+        return true;
+    return vogl_native_write_json_obj(serializer, blob_manager, obj, as_array);
+}
+
+template <typename T>
+inline bool vogl_native_read_optional_json_obj(data_stream_serializer &serializer, const vogl_blob_manager &blob_manager, T &obj)
+{
+    uint8 present;
+    if (!serializer.read_object(present))
+        return false;
+    if (!present)
+        return true;
+    return vogl_native_read_json_obj(serializer, blob_manager, obj);
+}
+
+// Raw arrays of little endian elements, bulk copied on little endian platforms.
+bool vogl_native_write_elements(data_stream_serializer &serializer, const void *pElements, uint num_elements, uint element_size);
+bool vogl_native_read_elements(data_stream_serializer &serializer, void *pElements, uint num_elements, uint element_size);
+
+#endif // VOGL_NATIVE_SNAPSHOT_H
@@ -1546,6 +1546,46 @@ handle_error:
     return false;
 }
 
+bool vogl_program_state::restore_uniform_state(const vogl_context_info &context_info, vogl_handle_remapper &remapper, GLuint64 handle) const
+{
+    VOGL_FUNC_TRACER
+
+    VOGL_CHECK_GL_ERROR;
+
+    if ((!m_is_valid) || (!handle))
+        return false;
+
+    VOGL_ASSERT(handle <= cUINT32_MAX);
+    GLuint handle32 = static_cast<GLuint>(handle);
+
+    // An unlinked program has no uniforms to restore
+    if (!get_program_bool(handle32, GL_LINK_STATUS))
+        return true;
+
+    vogl_scoped_binding_state orig_binding(GL_PROGRAM);
+
+    GL_ENTRYPOINT(glUseProgram)(handle32);
+    if (vogl_check_gl_error())
+        return false;
+
+    bool any_gl_errors = false;
+    bool any_restore_warnings = false;
+
+    if ((!restore_uniforms(handle32, context_info, remapper, any_restore_warnings, any_gl_errors)) ||
+        (!restore_uniform_blocks(handle32, context_info, remapper, any_restore_warnings, any_gl_errors)))
+    {
+        vogl_error_printf("%s: Failed restoring uniforms of trace program %u GL program %u\n", VOGL_FUNCTION_INFO_CSTR, m_snapshot_handle, handle32);
+        return false;
+    }
+
+    if ((any_gl_errors) || (any_restore_warnings))
+    {
+        vogl_warning_printf("%s: One or more GL errors or restore warnings occurred while attempting to restore the uniforms of trace program %u GL program %u, the replay may diverge.\n", VOGL_FUNCTION_INFO_CSTR, m_snapshot_handle, handle32);
+    }
+
+    return true;
+}
+
 bool vogl_program_state::remap_handles(vogl_handle_remapper &remapper)
 {
     VOGL_FUNC_TRACER
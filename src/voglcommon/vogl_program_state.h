@@ -206,6 +206,9 @@ public:
 
     virtual bool restore(const vogl_context_info &context_info, vogl_handle_remapper &remapper, GLuint64 &handle) const;
 
+    // Restores only the uniforms and uniform block bindings of a program previously created by restore(), without relinking it.
+    bool restore_uniform_state(const vogl_context_info &context_info, vogl_handle_remapper &remapper, GLuint64 handle) const;
+
     virtual bool remap_handles(vogl_handle_remapper &remapper);
 
     virtual void clear();
@@ -26,6 +26,7 @@
 // File: vogl_sampler_state.cpp
 #include "vogl_common.h"
 #include "vogl_sampler_state.h"
+#include "vogl_native_snapshot.h"
 
 vogl_sampler_state::vogl_sampler_state()
     : m_is_valid(false)
@@ -269,6 +270,47 @@ bool vogl_sampler_state::deserialize(const json_node &node, const vogl_blob_mana
     return true;
 }
 
+bool vogl_sampler_state::native_serialize(data_stream_serializer &serializer, vogl_blob_manager &blob_manager) const
+{
+    VOGL_FUNC_TRACER
+
+    VOGL_NOTE_UNUSED(blob_manager);
+
+    if (!m_is_valid)
+        return false;
+
+    if ((!vogl_native_write_encoding(serializer, cNSRENative)) || (!serializer.write_value(static_cast<uint32>(m_snapshot_handle))))
+        return false;
+
+    return m_params.native_serialize(serializer);
+}
+
+bool vogl_sampler_state::native_deserialize(data_stream_serializer &serializer, const vogl_blob_manager &blob_manager)
+{
+    VOGL_FUNC_TRACER
+
+    clear();
+
+    vogl_native_snapshot_record_encoding encoding;
+    if (!vogl_native_read_encoding(serializer, encoding))
+        return false;
+
+    if (encoding == cNSREJSON)
+        return vogl_native_read_json_obj_body(serializer, blob_manager, *this);
+
+    uint32 handle;
+    if ((!serializer.read_object(handle)) || (!m_params.native_deserialize(serializer)))
+    {
+        clear();
+        return false;
+    }
+
+    m_snapshot_handle = handle;
+    m_is_valid = true;
+
+    return true;
+}
+
 bool vogl_sampler_state::compare_restorable_state(const vogl_gl_object_state &rhs_obj) const
 {
     VOGL_FUNC_TRACER
@@ -60,6 +60,9 @@ public:
     virtual bool serialize(json_node &node, vogl_blob_manager &blob_manager) const;
     virtual bool deserialize(const json_node &node, const vogl_blob_manager &blob_manager);
 
+    virtual bool native_serialize(data_stream_serializer &serializer, vogl_blob_manager &blob_manager) const;
+    virtual bool native_deserialize(data_stream_serializer &serializer, const vogl_blob_manager &blob_manager);
+
     virtual GLuint64 get_snapshot_handle() const
     {
         return m_snapshot_handle;
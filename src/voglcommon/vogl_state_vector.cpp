@@ -30,6 +30,7 @@
 #include "vogl_growable_array.h"
 
 #include "vogl_blob_manager.h"
+#include "vogl_native_snapshot.h"
 
 
 #define VOGL_CONTEXT_STATE_DEBUG 0
@@ -38,6 +39,12 @@
 #pragma message("VOGL_CONTEXT_STATE_DEBUG enabled")
 #endif
 
+// Sanity limit on the element count of a single state read from a native snapshot.
+enum
+{
+    cMaxNativeStateElements = 64 * 1024
+};
+
 //----------------------------------------------------------------------------------------------------------------------
 // vogl_get_state_type_name
 //----------------------------------------------------------------------------------------------------------------------
@@ -1115,6 +1122,62 @@ bool vogl_state_data::deserialize(const json_node &node)
     return true;
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_state_data::native_serialize
+//----------------------------------------------------------------------------------------------------------------------
+bool vogl_state_data::native_serialize(data_stream_serializer &serializer) const
+{
+    VOGL_FUNC_TRACER
+
+    VOGL_ASSERT(m_data.size_in_bytes() >= m_num_elements * get_data_type_size());
+
+    if (!serializer.write_value(static_cast<uint32>(m_id.m_enum_val)) ||
+        !serializer.write_value(static_cast<uint32>(m_id.m_index)) ||
+        !serializer.write_value(static_cast<uint8>(m_id.m_indexed_variant)) ||
+        !serializer.write_value(static_cast<uint8>(m_data_type)) ||
+        !serializer.write_uint_vlc(m_num_elements))
+    {
+        return false;
+    }
+
+    return vogl_native_write_elements(serializer, m_data.get_ptr(), m_num_elements, get_data_type_size());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_state_data::native_deserialize
+//----------------------------------------------------------------------------------------------------------------------
+bool vogl_state_data::native_deserialize(data_stream_serializer &serializer)
+{
+    VOGL_FUNC_TRACER
+
+    uint32 enum_val, index;
+    uint8 indexed_variant, data_type;
+    uint num_elements;
+    if (!serializer.read_object(enum_val) || !serializer.read_object(index) ||
+        !serializer.read_object(indexed_variant) || !serializer.read_object(data_type) ||
+        !serializer.read_uint_vlc(num_elements))
+    {
+        return false;
+    }
+
+    vogl_state_type state_type = static_cast<vogl_state_type>(data_type);
+    if ((!utils::is_in_set<int, int>(state_type, cSTGLboolean, cSTGLenum, cSTInt32, cSTUInt32, cSTInt64, cSTUInt64, cSTFloat, cSTDouble, cSTPointer)) ||
+        (num_elements > cMaxNativeStateElements))
+    {
+        vogl_warning_printf("%s: Invalid state type or element count for GL enum 0x%X\n", VOGL_FUNCTION_INFO_CSTR, enum_val);
+        return false;
+    }
+
+    init(static_cast<GLenum>(enum_val), index, num_elements, state_type, indexed_variant != 0);
+
+    if (!vogl_native_read_elements(serializer, m_data.get_ptr(), num_elements, get_data_type_size()))
+        return false;
+
+    debug_check();
+
+    return true;
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 // vogl_state_vector::vogl_state_vector
 //----------------------------------------------------------------------------------------------------------------------
@@ -1277,3 +1340,50 @@ bool vogl_state_vector::insert(const vogl_state_data &state_data)
 
     return m_states.insert(state_data.get_id(), state_data).second;
 }
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_state_vector::native_serialize
+//----------------------------------------------------------------------------------------------------------------------
+bool vogl_state_vector::native_serialize(data_stream_serializer &serializer) const
+{
+    VOGL_FUNC_TRACER
+
+    if (!serializer.write_uint_vlc(m_states.size()))
+        return false;
+
+    for (state_map::const_iterator it = m_states.begin(); it != m_states.end(); ++it)
+    {
+        if (!it->second.native_serialize(serializer))
+            return false;
+    }
+
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_state_vector::native_deserialize
+//----------------------------------------------------------------------------------------------------------------------
+bool vogl_state_vector::native_deserialize(data_stream_serializer &serializer)
+{
+    VOGL_FUNC_TRACER
+
+    clear();
+
+    uint num_states;
+    if (!serializer.read_uint_vlc(num_states))
+        return false;
+
+    vogl_state_data state;
+    for (uint i = 0; i < num_states; i++)
+    {
+        if (!state.native_deserialize(serializer))
+            return false;
+
+        if (!insert(state))
+        {
+            vogl_warning_printf("%s: Ignoring duplicate state 0x%X index %u\n", VOGL_FUNCTION_INFO_CSTR, state.get_enum_val(), state.get_index());
+        }
+    }
+
+    return true;
+}
@@ -30,6 +30,7 @@
 #include "vogl_common.h"
 #include "vogl_json.h"
 #include "vogl_map.h"
+#include "vogl_data_stream_serializer.h"
 
 class vogl_snapshot_context_info;
 class vogl_state_vector;
@@ -222,6 +223,10 @@ public:
     bool serialize(json_node &node) const;
     bool deserialize(const json_node &node);
 
+    // Native binary snapshot encoding, see vogl_native_snapshot.h.
+    bool native_serialize(data_stream_serializer &serializer) const;
+    bool native_deserialize(data_stream_serializer &serializer);
+
 private:
     vogl_state_id m_id;
 
@@ -284,6 +289,9 @@ public:
     bool deserialize(const json_node &node, const vogl_blob_manager &blob_manager);
     bool deserialize(const char *pChild_name, const json_node &parent_node, const vogl_blob_manager &blob_manager);
 
+    bool native_serialize(data_stream_serializer &serializer) const;
+    bool native_deserialize(data_stream_serializer &serializer);
+
     bool operator==(const vogl_state_vector &rhs) const;
     bool operator!=(const vogl_state_vector &rhs) const
     {
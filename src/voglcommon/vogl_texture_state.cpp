@@ -34,6 +34,7 @@
 #include "vogl_texture_format.h"
 #include "vogl_shader_utils.h"
 #include "vogl_msaa_texture.h"
+#include "vogl_native_snapshot.h"
 
 #define VOGL_SERIALIZED_TEXTURE_STATE_VERSION 0x101
 
@@ -1653,6 +1654,99 @@ void vogl_texture_state::clear()
     m_is_valid = false;
 }
 
+bool vogl_texture_state::add_texture_data_blob(uint sample_index, vogl_blob_manager &blob_manager, dynamic_string &blob_id) const
+{
+    VOGL_FUNC_TRACER
+
+    blob_id.clear();
+
+    const ktx_texture &tex = m_textures[sample_index];
+
+    const char *pTex_type = utils::map_value(static_cast<int>(m_target), "tex",
+                                             GL_TEXTURE_1D, "tex_1d",
+                                             GL_TEXTURE_2D, "tex_2d",
+                                             GL_TEXTURE_3D, "tex_3d",
+                                             GL_TEXTURE_CUBE_MAP, "tex_cube",
+                                             GL_TEXTURE_RECTANGLE, "tex_rect",
+                                             GL_TEXTURE_2D_ARRAY, "tex_2d_array",
+                                             GL_TEXTURE_1D_ARRAY, "tex_1d_array",
+                                             GL_TEXTURE_BUFFER, "tex_buffer",
+                                             GL_TEXTURE_2D_MULTISAMPLE, "tex_2d_multisample",
+                                             GL_TEXTURE_2D_MULTISAMPLE_ARRAY, "tex_2d_multisample_array",
+                                             GL_TEXTURE_CUBE_MAP_ARRAY, "tex_cube_array");
+
+    uint actual_mip_levels = m_params.get_value<GLint>(GL_TEXTURE_MAX_LEVEL) + 1;
+    if (tex.is_valid())
+        actual_mip_levels = math::minimum(actual_mip_levels, tex.get_num_mips());
+
+    dynamic_string prefix;
+    switch (m_target)
+    {
+        case GL_TEXTURE_1D:
+            prefix.format("%s_%u_levels_%u_%s", pTex_type, tex.get_width(), actual_mip_levels, get_gl_enums().find_gl_name(tex.get_ogl_internal_fmt()));
+            break;
+        case GL_TEXTURE_RECTANGLE:
+        case GL_TEXTURE_2D:
+            prefix.format("%s_%ux%u_levels_%u_%s", pTex_type, tex.get_width(), tex.get_height(), actual_mip_levels, get_gl_enums().find_gl_image_format_name(tex.get_ogl_internal_fmt()));
+            break;
+        case GL_TEXTURE_3D:
+            prefix.format("%s_%ux%ux%u_levels_%u_%s", pTex_type, tex.get_width(), tex.get_height(), tex.get_depth(), actual_mip_levels, get_gl_enums().find_gl_image_format_name(tex.get_ogl_internal_fmt()));
+            break;
+        case GL_TEXTURE_1D_ARRAY:
+            prefix.format("%s_%u_levels_%u_arraysize_%u_%s", pTex_type, tex.get_width(), actual_mip_levels, tex.get_array_size(), get_gl_enums().find_gl_name(tex.get_ogl_internal_fmt()));
+            break;
+        case GL_TEXTURE_2D_ARRAY:
+            prefix.format("%s_%ux%u_levels_%u_arraysize_%u_%s", pTex_type, tex.get_width(), tex.get_height(), actual_mip_levels, tex.get_array_size(), get_gl_enums().find_gl_image_format_name(tex.get_ogl_internal_fmt()));
+            break;
+        case GL_TEXTURE_2D_MULTISAMPLE:
+            prefix.format("%s_%ux%u_levels_%u_sample_%u_of_%u_%s", pTex_type, tex.get_width(), tex.get_height(), actual_mip_levels, sample_index, m_num_samples, get_gl_enums().find_gl_image_format_name(tex.get_ogl_internal_fmt()));
+            break;
+        case GL_TEXTURE_2D_MULTISAMPLE_ARRAY:
+            prefix.format("%s_%ux%u_levels_%u_sample_%u_of_%u_arraysize_%u_%s", pTex_type, tex.get_width(), tex.get_height(), actual_mip_levels, sample_index, m_num_samples, tex.get_array_size(), get_gl_enums().find_gl_image_format_name(tex.get_ogl_internal_fmt()));
+            break;
+        case GL_TEXTURE_CUBE_MAP:
+            prefix.format("%s_%ux%u_levels_%u_%s", pTex_type, tex.get_width(), tex.get_height(), actual_mip_levels, get_gl_enums().find_gl_image_format_name(tex.get_ogl_internal_fmt()));
+            break;
+        case GL_TEXTURE_CUBE_MAP_ARRAY:
+            prefix.format("%s_%ux%u_levels_%u_arraysize_%u_%s", pTex_type, tex.get_width(), tex.get_height(), actual_mip_levels, tex.get_array_size(), get_gl_enums().find_gl_image_format_name(tex.get_ogl_internal_fmt()));
+            break;
+        default:
+            VOGL_ASSERT_ALWAYS;
+            return false;
+    }
+
+    dynamic_stream dyn_stream;
+    data_stream_serializer serializer(dyn_stream);
+    if (!tex.write_to_stream(serializer))
+        return false;
+
+    dyn_stream.seek(0, false);
+
+    blob_id = blob_manager.add_stream_compute_unique_id(dyn_stream, prefix.get_ptr(), "ktx");
+
+    return !blob_id.is_empty();
+}
+
+bool vogl_texture_state::get_texture_data_blob(uint sample_index, const vogl_blob_manager &blob_manager, const dynamic_string &blob_id)
+{
+    VOGL_FUNC_TRACER
+
+    if (blob_id.is_empty())
+        return false;
+
+    // Read the KTX data straight from the blob's stream, instead of copying the whole blob into memory first.
+    data_stream *pTex_stream = blob_manager.open(blob_id);
+    if (!pTex_stream)
+        return false;
+
+    data_stream_serializer serializer(pTex_stream);
+    bool success = m_textures[sample_index].read_from_stream(serializer);
+
+    blob_manager.close(pTex_stream);
+
+    return success;
+}
+
 bool vogl_texture_state::serialize(json_node &node, vogl_blob_manager &blob_manager) const
 {
     VOGL_FUNC_TRACER
@@ -1681,74 +1775,10 @@ bool vogl_texture_state::serialize(json_node &node, vogl_blob_manager &blob_mana
             {
                 json_node &texture_node = textures_array_node.add_object();
 
-                const ktx_texture &tex = m_textures[sample_index];
-
-                const char *pTex_type = utils::map_value(static_cast<int>(m_target), "tex",
-                                                         GL_TEXTURE_1D, "tex_1d",
-                                                         GL_TEXTURE_2D, "tex_2d",
-                                                         GL_TEXTURE_3D, "tex_3d",
-                                                         GL_TEXTURE_CUBE_MAP, "tex_cube",
-                                                         GL_TEXTURE_RECTANGLE, "tex_rect",
-                                                         GL_TEXTURE_2D_ARRAY, "tex_2d_array",
-                                                         GL_TEXTURE_1D_ARRAY, "tex_1d_array",
-                                                         GL_TEXTURE_BUFFER, "tex_buffer",
-                                                         GL_TEXTURE_2D_MULTISAMPLE, "tex_2d_multisample",
-                                                         GL_TEXTURE_2D_MULTISAMPLE_ARRAY, "tex_2d_multisample_array",
-                                                         GL_TEXTURE_CUBE_MAP_ARRAY, "tex_cube_array");
-
-                uint actual_mip_levels = m_params.get_value<GLint>(GL_TEXTURE_MAX_LEVEL) + 1;
-                if (tex.is_valid())
-                    actual_mip_levels = math::minimum(actual_mip_levels, tex.get_num_mips());
-
-                dynamic_string prefix;
-                switch (m_target)
-                {
-                    case GL_TEXTURE_1D:
-                        prefix.format("%s_%u_levels_%u_%s", pTex_type, tex.get_width(), actual_mip_levels, get_gl_enums().find_gl_name(tex.get_ogl_internal_fmt()));
-                        break;
-                    case GL_TEXTURE_RECTANGLE:
-                    case GL_TEXTURE_2D:
-                        prefix.format("%s_%ux%u_levels_%u_%s", pTex_type, tex.get_width(), tex.get_height(), actual_mip_levels, get_gl_enums().find_gl_image_format_name(tex.get_ogl_internal_fmt()));
-                        break;
-                    case GL_TEXTURE_3D:
-                        prefix.format("%s_%ux%ux%u_levels_%u_%s", pTex_type, tex.get_width(), tex.get_height(), tex.get_depth(), actual_mip_levels, get_gl_enums().find_gl_image_format_name(tex.get_ogl_internal_fmt()));
-                        break;
-                    case GL_TEXTURE_1D_ARRAY:
-                        prefix.format("%s_%u_levels_%u_arraysize_%u_%s", pTex_type, tex.get_width(), actual_mip_levels, tex.get_array_size(), get_gl_enums().find_gl_name(tex.get_ogl_internal_fmt()));
-                        break;
-                    case GL_TEXTURE_2D_ARRAY:
-                        prefix.format("%s_%ux%u_levels_%u_arraysize_%u_%s", pTex_type, tex.get_width(), tex.get_height(), actual_mip_levels, tex.get_array_size(), get_gl_enums().find_gl_image_format_name(tex.get_ogl_internal_fmt()));
-                        break;
-                    case GL_TEXTURE_2D_MULTISAMPLE:
-                        prefix.format("%s_%ux%u_levels_%u_sample_%u_of_%u_%s", pTex_type, tex.get_width(), tex.get_height(), actual_mip_levels, sample_index, m_num_samples, get_gl_enums().find_gl_image_format_name(tex.get_ogl_internal_fmt()));
-                        break;
-                    case GL_TEXTURE_2D_MULTISAMPLE_ARRAY:
-                        prefix.format("%s_%ux%u_levels_%u_sample_%u_of_%u_arraysize_%u_%s", pTex_type, tex.get_width(), tex.get_height(), actual_mip_levels, sample_index, m_num_samples, tex.get_array_size(), get_gl_enums().find_gl_image_format_name(tex.get_ogl_internal_fmt()));
-                        break;
-                    case GL_TEXTURE_CUBE_MAP:
-                        prefix.format("%s_%ux%u_levels_%u_%s", pTex_type, tex.get_width(), tex.get_height(), actual_mip_levels, get_gl_enums().find_gl_image_format_name(tex.get_ogl_internal_fmt()));
-                        break;
-                    case GL_TEXTURE_CUBE_MAP_ARRAY:
-                        prefix.format("%s_%ux%u_levels_%u_arraysize_%u_%s", pTex_type, tex.get_width(), tex.get_height(), actual_mip_levels, tex.get_array_size(), get_gl_enums().find_gl_image_format_name(tex.get_ogl_internal_fmt()));
-                        break;
-                    default:
-                        VOGL_ASSERT_ALWAYS;
-                        return false;
-                }
-
-                dynamic_stream dyn_stream;
-                data_stream_serializer serializer(dyn_stream);
-                if (!tex.write_to_stream(serializer))
+                dynamic_string blob_id;
+                if (!add_texture_data_blob(sample_index, blob_manager, blob_id))
                     return false;
 
-                dyn_stream.seek(0, false);
-
-                dynamic_string blob_id(blob_manager.add_stream_compute_unique_id(dyn_stream, prefix.get_ptr(), "ktx"));
-                if (blob_id.is_empty())
-                    return false;
-
-                dyn_stream.close();
-
                 texture_node.add_key_value("texture_data_blob_id", blob_id);
             }
 
@@ -1809,16 +1839,7 @@ bool vogl_texture_state::deserialize(const json_node &node, const vogl_blob_mana
             if (m_num_samples != 1)
                 return false;
 
-            dynamic_string blob_id(node.value_as_string_ptr("texture_data_blob_id"));
-            if (blob_id.is_empty())
-                return false;
-
-            dynamic_stream tex_data;
-            if (!blob_manager.get(blob_id, tex_data.get_buf()))
-                return false;
-
-            data_stream_serializer serializer(&tex_data);
-            if (!m_textures[0].read_from_stream(serializer))
+            if (!get_texture_data_blob(0, blob_manager, dynamic_string(node.value_as_string_ptr("texture_data_blob_id"))))
                 return false;
         }
         else if (node.has_array("textures"))
@@ -1833,16 +1854,7 @@ bool vogl_texture_state::deserialize(const json_node &node, const vogl_blob_mana
                 if (!pTexture_node)
                     return false;
 
-                dynamic_string blob_id(pTexture_node->value_as_string_ptr("texture_data_blob_id"));
-                if (blob_id.is_empty())
-                    return false;
-
-                dynamic_stream tex_data;
-                if (!blob_manager.get(blob_id, tex_data.get_buf()))
-                    return false;
-
-                data_stream_serializer serializer(&tex_data);
-                if (!m_textures[i].read_from_stream(serializer))
+                if (!get_texture_data_blob(i, blob_manager, dynamic_string(pTexture_node->value_as_string_ptr("texture_data_blob_id"))))
                     return false;
             }
         }
@@ -1890,6 +1902,142 @@ bool vogl_texture_state::deserialize(const json_node &node, const vogl_blob_mana
     return true;
 }
 
+bool vogl_texture_state::native_serialize(data_stream_serializer &serializer, vogl_blob_manager &blob_manager) const
+{
+    VOGL_FUNC_TRACER
+
+    if (!m_is_valid)
+        return false;
+
+    if ((!vogl_native_write_encoding(serializer, cNSRENative)) ||
+        (!serializer.write_value(static_cast<uint32>(m_snapshot_handle))) ||
+        (!serializer.write_value(static_cast<uint32>(m_target))) ||
+        (!serializer.write_value(static_cast<uint8>(m_is_unquerable))) ||
+        (!serializer.write_value(static_cast<uint32>(m_buffer))) ||
+        (!serializer.write_uint_vlc(m_num_samples)))
+    {
+        return false;
+    }
+
+    if ((m_is_unquerable) || (m_target == GL_NONE))
+        return true;
+
+    if (!m_params.native_serialize(serializer))
+        return false;
+
+    if ((m_target == GL_TEXTURE_BUFFER) || (!m_num_samples))
+        return true;
+
+    for (uint sample_index = 0; sample_index < m_num_samples; sample_index++)
+    {
+        dynamic_string blob_id;
+        if ((!add_texture_data_blob(sample_index, blob_manager, blob_id)) || (!serializer.write_string(blob_id)))
+            return false;
+    }
+
+    const uint num_faces = m_textures[0].get_num_faces();
+    const uint num_mips = m_textures[0].get_num_mips();
+    if ((!serializer.write_uint_vlc(num_faces)) || (!serializer.write_uint_vlc(num_mips)))
+        return false;
+
+    for (uint face = 0; face < num_faces; face++)
+        for (uint level = 0; level < num_mips; level++)
+            if (!m_level_params[face][level].native_serialize(serializer))
+                return false;
+
+    return true;
+}
+
+bool vogl_texture_state::native_deserialize(data_stream_serializer &serializer, const vogl_blob_manager &blob_manager)
+{
+    VOGL_FUNC_TRACER
+
+    clear();
+
+    vogl_native_snapshot_record_encoding encoding;
+    if (!vogl_native_read_encoding(serializer, encoding))
+        return false;
+
+    if (encoding == cNSREJSON)
+        return vogl_native_read_json_obj_body(serializer, blob_manager, *this);
+
+    uint32 handle, target, buffer;
+    uint8 is_unquerable;
+    uint num_samples;
+    if ((!serializer.read_object(handle)) ||
+        (!serializer.read_object(target)) ||
+        (!serializer.read_object(is_unquerable)) ||
+        (!serializer.read_object(buffer)) ||
+        (!serializer.read_uint_vlc(num_samples)))
+    {
+        return false;
+    }
+
+    m_snapshot_handle = handle;
+    m_target = target;
+    m_is_unquerable = is_unquerable != 0;
+    m_buffer = buffer;
+    m_num_samples = num_samples;
+
+    // Same sanity checks as the JSON path.
+    if ((!utils::is_in_set(static_cast<int>(m_target), GL_NONE, GL_TEXTURE_1D, GL_TEXTURE_2D, GL_TEXTURE_3D, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_CUBE_MAP_ARRAY,
+        GL_TEXTURE_1D_ARRAY, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_RECTANGLE, GL_TEXTURE_BUFFER, GL_TEXTURE_2D_MULTISAMPLE, GL_TEXTURE_2D_MULTISAMPLE_ARRAY)) ||
+        (m_num_samples > cMaxSamples))
+    {
+        clear();
+        return false;
+    }
+
+    if ((!m_is_unquerable) && (m_target != GL_NONE))
+    {
+        if (!m_params.native_deserialize(serializer))
+        {
+            clear();
+            return false;
+        }
+
+        if ((m_target != GL_TEXTURE_BUFFER) && (m_num_samples))
+        {
+            for (uint sample_index = 0; sample_index < m_num_samples; sample_index++)
+            {
+                dynamic_string blob_id;
+                if ((!serializer.read_string(blob_id)) || (!get_texture_data_blob(sample_index, blob_manager, blob_id)))
+                {
+                    clear();
+                    return false;
+                }
+            }
+
+            uint num_faces, num_mips;
+            // obviously crazy level counts are rejected, like the JSON path does
+            if ((!serializer.read_uint_vlc(num_faces)) || (!serializer.read_uint_vlc(num_mips)) ||
+                (num_faces > cCubeMapFaces) || (num_mips > 21) || ((num_faces > 1) && (m_target != GL_TEXTURE_CUBE_MAP)))
+            {
+                clear();
+                return false;
+            }
+
+            for (uint face = 0; face < num_faces; face++)
+            {
+                m_level_params[face].resize(num_mips);
+
+                for (uint level = 0; level < num_mips; level++)
+                {
+                    if (!m_level_params[face][level].native_deserialize(serializer))
+                    {
+                        clear();
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+
+    m_is_valid = true;
+
+    return true;
+}
+
 bool vogl_texture_state::compare_restorable_state(const vogl_gl_object_state &rhs_obj) const
 {
     VOGL_FUNC_TRACER
@@ -67,6 +67,9 @@ public:
     virtual bool serialize(json_node &node, vogl_blob_manager &blob_manager) const;
     virtual bool deserialize(const json_node &node, const vogl_blob_manager &blob_manager);
 
+    virtual bool native_serialize(data_stream_serializer &serializer, vogl_blob_manager &blob_manager) const;
+    virtual bool native_deserialize(data_stream_serializer &serializer, const vogl_blob_manager &blob_manager);
+
     virtual GLuint64 get_snapshot_handle() const
     {
         return m_snapshot_handle;
@@ -142,6 +145,9 @@ private:
     bool m_is_valid;
 
     bool set_tex_parameter(GLenum pname) const;
+
+    bool add_texture_data_blob(uint sample_index, vogl_blob_manager &blob_manager, dynamic_string &blob_id) const;
+    bool get_texture_data_blob(uint sample_index, const vogl_blob_manager &blob_manager, const dynamic_string &blob_id);
 };
 
 namespace vogl
@@ -0,0 +1,526 @@
+/**************************************************************************
+ *
+ * Copyright 2013-2014 RAD Game Tools and Valve Software
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+//----------------------------------------------------------------------------------------------------------------------
+// File: vogl_trace_block_stream.cpp
+//----------------------------------------------------------------------------------------------------------------------
+#include "vogl_trace_block_stream.h"
+
+static const uint cMinBlockSize = 64 * 1024;
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_trace_block_writer_stream
+//----------------------------------------------------------------------------------------------------------------------
+vogl_trace_block_writer_stream::vogl_trace_block_writer_stream()
+    : data_stream(),
+      m_pDst(NULL),
+      m_block_size(cDefaultBlockSize),
+      m_level(MZ_BEST_SPEED),
+      m_num_threads(0),
+      m_next_block_file_ofs(0),
+      m_total_uncomp_bytes(0),
+      m_total_comp_bytes(0)
+{
+    VOGL_FUNC_TRACER
+}
+
+vogl_trace_block_writer_stream::~vogl_trace_block_writer_stream()
+{
+    VOGL_FUNC_TRACER
+
+    close();
+}
+
+bool vogl_trace_block_writer_stream::open(data_stream *pDst, uint block_size, uint num_threads, int level)
+{
+    VOGL_FUNC_TRACER
+
+    close();
+
+    if ((!pDst) || (!pDst->is_opened()) || (!pDst->is_writable()))
+        return false;
+
+    m_pDst = pDst;
+    m_block_size = math::clamp<uint>(block_size, cMinBlockSize, vogl_trace_stream_block_header::cMaxUncompSize);
+    m_level = math::clamp<int>(level, MZ_BEST_SPEED, MZ_UBER_COMPRESSION);
+    m_num_threads = math::minimum<uint>(num_threads, cMaxBlocksInFlight);
+
+    if ((m_num_threads) && (!m_tasks.init(m_num_threads)))
+    {
+        vogl_warning_printf("%s: Failed creating compression threads, compressing on the calling thread\n", VOGL_FUNCTION_INFO_CSTR);
+        m_num_threads = 0;
+    }
+
+    m_cur_block.reserve(m_block_size);
+    m_cur_block.resize(0);
+
+    m_block_file_offsets.resize(0);
+    m_next_block_file_ofs = pDst->get_ofs();
+
+    m_total_uncomp_bytes = 0;
+    m_total_comp_bytes = 0;
+
+    m_name = pDst->get_name();
+    m_attribs = cDataStreamWritable;
+    m_opened = true;
+    m_error = false;
+
+    return true;
+}
+
+bool vogl_trace_block_writer_stream::close()
+{
+    VOGL_FUNC_TRACER
+
+    if (!m_opened)
+        return true;
+
+    bool success = end_block() && write_finished_blocks(true);
+
+    m_tasks.deinit();
+    free_blocks();
+
+    m_cur_block.clear();
+
+    m_pDst = NULL;
+
+    data_stream::close();
+
+    return success;
+}
+
+uint vogl_trace_block_writer_stream::write(const void *pBuf, uint len)
+{
+    VOGL_FUNC_TRACER
+
+    if ((!m_opened) || (m_error))
+        return 0;
+
+    const uint8 *pSrc = static_cast<const uint8 *>(pBuf);
+    uint bytes_left = len;
+
+    while (bytes_left)
+    {
+        uint n = math::minimum<uint>(bytes_left, m_block_size - m_cur_block.size());
+        m_cur_block.append(pSrc, n);
+
+        pSrc += n;
+        bytes_left -= n;
+        m_total_uncomp_bytes += n;
+
+        if ((m_cur_block.size() == m_block_size) && (!end_block()))
+            return len - bytes_left;
+    }
+
+    return len;
+}
+
+bool vogl_trace_block_writer_stream::flush()
+{
+    VOGL_FUNC_TRACER
+
+    if ((!m_opened) || (m_error))
+        return false;
+
+    // The tracer can flush after every glGetError(), ending the block here would produce lots of tiny blocks.
+    if (!write_finished_blocks(false))
+        return false;
+
+    return m_pDst->flush();
+}
+
+bool vogl_trace_block_writer_stream::end_block()
+{
+    VOGL_FUNC_TRACER
+
+    if ((!m_opened) || (m_error))
+        return false;
+
+    if (m_cur_block.is_empty())
+        return true;
+
+    // Don't let the compression threads get too far behind.
+    if ((m_pending_blocks.size() >= cMaxBlocksInFlight) && (!write_finished_blocks(false)))
+        return false;
+    while (m_pending_blocks.size() >= cMaxBlocksInFlight)
+    {
+        vogl_sleep(1);
+        if (!write_finished_blocks(false))
+            return false;
+    }
+
+    block *pBlock;
+    if (m_free_blocks.size())
+    {
+        pBlock = m_free_blocks.back();
+        m_free_blocks.pop_back();
+    }
+    else
+    {
+        pBlock = vogl_new(block);
+    }
+
+    pBlock->m_uncomp_buf.swap(m_cur_block);
+    pBlock->m_done = 0;
+
+    m_cur_block.reserve(m_block_size);
+    m_cur_block.resize(0);
+
+    m_pending_blocks.push_back(pBlock);
+
+    if ((!m_num_threads) || (!m_tasks.queue_object_task(this, &vogl_trace_block_writer_stream::compress_block_task, 0, pBlock)))
+        compress_block(pBlock);
+
+    return write_finished_blocks(false);
+}
+
+uint64_t vogl_trace_block_writer_stream::get_block_file_ofs(uint block_index) const
+{
+    if (block_index >= m_block_file_offsets.size())
+    {
+        VOGL_ASSERT(block_index == m_block_file_offsets.size());
+        return m_next_block_file_ofs;
+    }
+
+    return m_block_file_offsets[block_index];
+}
+
+void vogl_trace_block_writer_stream::compress_block(block *pBlock)
+{
+    VOGL_FUNC_TRACER
+
+    const uint8_vec &src = pBlock->m_uncomp_buf;
+    uint32 uncomp_crc = (uint32)mz_crc32(MZ_CRC32_INIT, src.get_ptr(), src.size());
+
+    mz_ulong comp_size = mz_compressBound(src.size());
+    pBlock->m_comp_buf.resize(static_cast<uint>(comp_size));
+
+    // Incompressible data is stored.
+    if ((mz_compress2(pBlock->m_comp_buf.get_ptr(), &comp_size, src.get_ptr(), src.size(), m_level) == MZ_OK) && (comp_size < src.size()))
+    {
+        pBlock->m_comp_buf.resize(static_cast<uint>(comp_size));
+        pBlock->m_header.init(cTSBCDeflate, static_cast<uint32>(comp_size), src.size(), uncomp_crc);
+    }
+    else
+    {
+        pBlock->m_comp_buf.resize(0);
+        pBlock->m_header.init(cTSBCStored, src.size(), src.size(), uncomp_crc);
+    }
+    pBlock->m_header.finalize();
+
+    atomic_exchange32(&pBlock->m_done, 1);
+}
+
+void vogl_trace_block_writer_stream::compress_block_task(uint64_t data, void *pData_ptr)
+{
+    VOGL_NOTE_UNUSED(data);
+
+    compress_block(static_cast<block *>(pData_ptr));
+}
+
+// Writes the compressed blocks at the front of the pending list, in order.
+bool vogl_trace_block_writer_stream::write_finished_blocks(bool wait_for_all)
+{
+    VOGL_FUNC_TRACER
+
+    if (wait_for_all)
+        m_tasks.join();
+
+    uint num_written = 0;
+    while (num_written < m_pending_blocks.size())
+    {
+        block *pBlock = m_pending_blocks[num_written];
+        if (!pBlock->m_done)
+            break;
+
+        const uint8_vec &data = (pBlock->m_header.m_codec == cTSBCStored) ? pBlock->m_uncomp_buf : pBlock->m_comp_buf;
+
+        if ((!m_error) &&
+            ((m_pDst->write(&pBlock->m_header, sizeof(pBlock->m_header)) != sizeof(pBlock->m_header)) ||
+             (m_pDst->write(data.get_ptr(), data.size()) != data.size())))
+        {
+            vogl_error_printf("%s: Failed writing compressed block to stream \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, m_name.get_ptr());
+            set_error();
+        }
+
+        m_block_file_offsets.push_back(m_next_block_file_ofs);
+        m_next_block_file_ofs += sizeof(pBlock->m_header) + data.size();
+        m_total_comp_bytes += sizeof(pBlock->m_header) + data.size();
+
+        m_free_blocks.push_back(pBlock);
+        num_written++;
+    }
+
+    if (num_written)
+        m_pending_blocks.erase(0U, num_written);
+
+    VOGL_ASSERT((!wait_for_all) || (m_pending_blocks.is_empty()));
+
+    return !m_error;
+}
+
+void vogl_trace_block_writer_stream::free_blocks()
+{
+    VOGL_FUNC_TRACER
+
+    for (uint i = 0; i < m_pending_blocks.size(); i++)
+        vogl_delete(m_pending_blocks[i]);
+    m_pending_blocks.clear();
+
+    for (uint i = 0; i < m_free_blocks.size(); i++)
+        vogl_delete(m_free_blocks[i]);
+    m_free_blocks.clear();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_trace_block_reader_stream
+//----------------------------------------------------------------------------------------------------------------------
+vogl_trace_block_reader_stream::vogl_trace_block_reader_stream()
+    : data_stream(),
+      m_pSrc(NULL),
+      m_first_block_file_ofs(0),
+      m_end_file_ofs(0),
+      m_cur_block_file_ofs(0),
+      m_next_block_file_ofs(0),
+      m_block_ofs(0)
+{
+    VOGL_FUNC_TRACER
+}
+
+vogl_trace_block_reader_stream::~vogl_trace_block_reader_stream()
+{
+    VOGL_FUNC_TRACER
+}
+
+bool vogl_trace_block_reader_stream::open(data_stream *pSrc, uint64_t first_block_file_ofs, uint64_t end_file_ofs)
+{
+    VOGL_FUNC_TRACER
+
+    close();
+
+    if ((!pSrc) || (!pSrc->is_opened()) || (!pSrc->is_readable()) || (!pSrc->is_seekable()))
+        return false;
+
+    if ((first_block_file_ofs > end_file_ofs) || ((end_file_ofs >> (64 - VOGL_TRACE_BLOCK_OFS_SHIFT)) != 0))
+        return false;
+
+    m_pSrc = pSrc;
+    m_first_block_file_ofs = first_block_file_ofs;
+    m_end_file_ofs = end_file_ofs;
+
+    m_cur_block_file_ofs = first_block_file_ofs;
+    m_next_block_file_ofs = first_block_file_ofs;
+    m_block_buf.resize(0);
+    m_block_ofs = 0;
+
+    m_name = pSrc->get_name();
+    m_attribs = cDataStreamReadable | cDataStreamSeekable;
+    m_opened = true;
+    m_error = false;
+
+    return true;
+}
+
+bool vogl_trace_block_reader_stream::close()
+{
+    VOGL_FUNC_TRACER
+
+    m_pSrc = NULL;
+    m_first_block_file_ofs = 0;
+    m_end_file_ofs = 0;
+    m_cur_block_file_ofs = 0;
+    m_next_block_file_ofs = 0;
+    m_comp_buf.clear();
+    m_block_buf.clear();
+    m_block_ofs = 0;
+
+    return data_stream::close();
+}
+
+bool vogl_trace_block_reader_stream::load_block(uint64_t block_file_ofs)
+{
+    VOGL_FUNC_TRACER
+
+    m_block_buf.resize(0);
+    m_block_ofs = 0;
+    m_cur_block_file_ofs = block_file_ofs;
+    m_next_block_file_ofs = block_file_ofs;
+
+    vogl_trace_stream_block_header header;
+    if ((block_file_ofs + sizeof(header) > m_end_file_ofs) || (!m_pSrc->seek(block_file_ofs, false)) ||
+        (m_pSrc->read(&header, sizeof(header)) != sizeof(header)))
+    {
+        vogl_error_printf("%s: Failed reading block header at file offset %" PRIu64 "\n", VOGL_FUNCTION_INFO_CSTR, block_file_ofs);
+        return false;
+    }
+
+    if ((!header.full_validation()) || (block_file_ofs + sizeof(header) + header.m_comp_size > m_end_file_ofs))
+    {
+        vogl_error_printf("%s: Bad trace file - block at file offset %" PRIu64 " failed validation!\n", VOGL_FUNCTION_INFO_CSTR, block_file_ofs);
+        return false;
+    }
+
+    uint8_vec &dst_buf = (header.m_codec == cTSBCStored) ? m_block_buf : m_comp_buf;
+    dst_buf.resize(header.m_comp_size);
+    if (m_pSrc->read(dst_buf.get_ptr(), header.m_comp_size) != header.m_comp_size)
+    {
+        vogl_error_printf("%s: Failed reading block data at file offset %" PRIu64 "\n", VOGL_FUNCTION_INFO_CSTR, block_file_ofs);
+        m_block_buf.resize(0);
+        return false;
+    }
+
+    if (header.m_codec == cTSBCDeflate)
+    {
+        m_block_buf.resize(header.m_uncomp_size);
+
+        mz_ulong uncomp_size = header.m_uncomp_size;
+        if ((mz_uncompress(m_block_buf.get_ptr(), &uncomp_size, m_comp_buf.get_ptr(), m_comp_buf.size()) != MZ_OK) || (uncomp_size != header.m_uncomp_size))
+        {
+            vogl_error_printf("%s: Bad trace file - failed decompressing block at file offset %" PRIu64 "\n", VOGL_FUNCTION_INFO_CSTR, block_file_ofs);
+            m_block_buf.resize(0);
+            return false;
+        }
+    }
+
+    if ((uint32)mz_crc32(MZ_CRC32_INIT, m_block_buf.get_ptr(), m_block_buf.size()) != header.m_uncomp_crc)
+    {
+        vogl_error_printf("%s: Bad trace file - block at file offset %" PRIu64 " failed CRC check!\n", VOGL_FUNCTION_INFO_CSTR, block_file_ofs);
+        m_block_buf.resize(0);
+        return false;
+    }
+
+    m_next_block_file_ofs = block_file_ofs + sizeof(header) + header.m_comp_size;
+
+    return true;
+}
+
+uint vogl_trace_block_reader_stream::read(void *pBuf, uint len)
+{
+    VOGL_FUNC_TRACER
+
+    if ((!m_opened) || (m_error))
+        return 0;
+
+    uint8 *pDst = static_cast<uint8 *>(pBuf);
+    uint total_read = 0;
+
+    while (total_read < len)
+    {
+        if (m_block_ofs == m_block_buf.size())
+        {
+            if (m_next_block_file_ofs >= m_end_file_ofs)
+                break;
+
+            if (!load_block(m_next_block_file_ofs))
+            {
+                set_error();
+                break;
+            }
+        }
+
+        uint n = math::minimum<uint>(len - total_read, m_block_buf.size() - m_block_ofs);
+        memcpy(pDst + total_read, m_block_buf.get_ptr() + m_block_ofs, n);
+
+        m_block_ofs += n;
+        total_read += n;
+    }
+
+    return total_read;
+}
+
+uint64_t vogl_trace_block_reader_stream::get_remaining() const
+{
+    if (!m_opened)
+        return 0;
+
+    if (m_next_block_file_ofs < m_end_file_ofs)
+        return DATA_STREAM_SIZE_UNKNOWN;
+
+    return m_block_buf.size() - m_block_ofs;
+}
+
+uint64_t vogl_trace_block_reader_stream::get_ofs() const
+{
+    if (!m_opened)
+        return 0;
+
+    // The end of a block is the same location as the start of the next one, always report the latter so offsets
+    // recorded while reading match the frame offsets written by vogl_trace_file_writer.
+    if ((m_block_ofs == m_block_buf.size()) && (m_next_block_file_ofs != m_cur_block_file_ofs))
+        return vogl_trace_block_make_packet_ofs(m_next_block_file_ofs, 0);
+
+    return vogl_trace_block_make_packet_ofs(m_cur_block_file_ofs, m_block_ofs);
+}
+
+bool vogl_trace_block_reader_stream::seek(int64_t ofs, bool relative)
+{
+    VOGL_FUNC_TRACER
+
+    if (!m_opened)
+        return false;
+
+    if (relative)
+    {
+        if (ofs < 0)
+            return false;
+        return skip(ofs) == static_cast<uint64_t>(ofs);
+    }
+
+    uint64_t block_file_ofs = static_cast<uint64_t>(ofs) >> VOGL_TRACE_BLOCK_OFS_SHIFT;
+    uint ofs_in_block = static_cast<uint>(ofs & ((1ULL << VOGL_TRACE_BLOCK_OFS_SHIFT) - 1));
+
+    if ((block_file_ofs < m_first_block_file_ofs) || (block_file_ofs > m_end_file_ofs))
+        return false;
+
+    clear_error();
+
+    if (block_file_ofs == m_end_file_ofs)
+    {
+        // Seeking to the very end of the packet data.
+        if (ofs_in_block)
+            return false;
+
+        m_block_buf.resize(0);
+        m_block_ofs = 0;
+        m_cur_block_file_ofs = block_file_ofs;
+        m_next_block_file_ofs = block_file_ofs;
+        return true;
+    }
+
+    if ((block_file_ofs != m_cur_block_file_ofs) || (m_next_block_file_ofs == m_cur_block_file_ofs))
+    {
+        if (!load_block(block_file_ofs))
+        {
+            set_error();
+            return false;
+        }
+    }
+
+    if (ofs_in_block > m_block_buf.size())
+        return false;
+
+    m_block_ofs = ofs_in_block;
+    return true;
+}
@@ -0,0 +1,237 @@
+/**************************************************************************
+ *
+ * Copyright 2013-2014 RAD Game Tools and Valve Software
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+//----------------------------------------------------------------------------------------------------------------------
+// File: vogl_trace_block_stream.h
+// Compressed packet block container used by trace files with cTSFCompressedPacketBlocks set.
+//----------------------------------------------------------------------------------------------------------------------
+#ifndef VOGL_TRACE_BLOCK_STREAM_H
+#define VOGL_TRACE_BLOCK_STREAM_H
+
+#include "vogl_common.h"
+#include "vogl_trace_stream_types.h"
+#include "vogl_data_stream.h"
+#include "vogl_threading.h"
+
+// Packet offsets in compressed traces (frame file offsets, reader locations) are the file offset of the block
+// shifted left by this many bits, or'd with the offset of the packet within the block's uncompressed data.
+#define VOGL_TRACE_BLOCK_OFS_SHIFT 24
+
+inline uint64_t vogl_trace_block_make_packet_ofs(uint64_t block_file_ofs, uint ofs_in_block)
+{
+    return (block_file_ofs << VOGL_TRACE_BLOCK_OFS_SHIFT) | ofs_in_block;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// class vogl_trace_block_writer_stream
+// Buffers everything written to it into blocks, compresses them on a task pool, and writes the finished blocks to the
+// destination stream in order. Not thread safe.
+//----------------------------------------------------------------------------------------------------------------------
+class vogl_trace_block_writer_stream : public data_stream
+{
+    VOGL_NO_COPY_OR_ASSIGNMENT_OP(vogl_trace_block_writer_stream);
+
+public:
+    enum
+    {
+        cDefaultBlockSize = 1024 * 1024,
+
+        // Keeps the number of queued compression tasks below the task pool's limit.
+        cMaxBlocksInFlight = 12
+    };
+
+    vogl_trace_block_writer_stream();
+    virtual ~vogl_trace_block_writer_stream();
+
+    // pDst must stay open until close(). If num_threads is 0 blocks are compressed on the calling thread.
+    bool open(data_stream *pDst, uint block_size = cDefaultBlockSize, uint num_threads = 2, int level = MZ_BEST_SPEED);
+
+    // Finishes all blocks and writes them to the destination stream (which is not closed).
+    virtual bool close();
+
+    virtual uint read(void *pBuf, uint len)
+    {
+        VOGL_NOTE_UNUSED(pBuf);
+        VOGL_NOTE_UNUSED(len);
+        return 0;
+    }
+
+    virtual uint write(const void *pBuf, uint len);
+
+    // Writes the blocks that have already been compressed to the destination stream and flushes it. Never waits on the
+    // compression threads, and leaves the current block open - blocks only end when they're full or on close().
+    virtual bool flush();
+
+    virtual uint64_t get_size() const
+    {
+        return m_total_uncomp_bytes;
+    }
+    virtual uint64_t get_remaining() const
+    {
+        return 0;
+    }
+
+    // Returns the total number of uncompressed bytes written so far. (The real offset of the current position isn't
+    // known until all the blocks before it have been compressed - use get_cur_block_index() instead.)
+    virtual uint64_t get_ofs() const
+    {
+        return m_total_uncomp_bytes;
+    }
+    virtual bool seek(int64_t ofs, bool relative)
+    {
+        VOGL_NOTE_UNUSED(ofs);
+        VOGL_NOTE_UNUSED(relative);
+        return false;
+    }
+
+    // Ends the current block (if it isn't empty), so whatever is written next starts a new block.
+    bool end_block();
+
+    // Index of the block the next written byte will land in.
+    inline uint get_cur_block_index() const
+    {
+        return m_block_file_offsets.size() + m_pending_blocks.size();
+    }
+
+    // Only valid for blocks that have already been written, index may be get_total_blocks_written() to retrieve the
+    // offset just past the last written block.
+    uint64_t get_block_file_ofs(uint block_index) const;
+
+    inline uint get_total_blocks_written() const
+    {
+        return m_block_file_offsets.size();
+    }
+
+    inline uint64_t get_total_uncomp_bytes() const
+    {
+        return m_total_uncomp_bytes;
+    }
+    inline uint64_t get_total_comp_bytes() const
+    {
+        return m_total_comp_bytes;
+    }
+
+private:
+    struct block
+    {
+        uint8_vec m_uncomp_buf;
+        uint8_vec m_comp_buf;
+        vogl_trace_stream_block_header m_header;
+        atomic32_t m_done;
+    };
+
+    data_stream *m_pDst;
+    uint m_block_size;
+    int m_level;
+
+    task_pool m_tasks;
+    uint m_num_threads;
+
+    uint8_vec m_cur_block;
+
+    // Blocks being compressed, in file order.
+    vogl::vector<block *> m_pending_blocks;
+    vogl::vector<block *> m_free_blocks;
+
+    vogl::vector<uint64_t> m_block_file_offsets;
+    uint64_t m_next_block_file_ofs;
+
+    uint64_t m_total_uncomp_bytes;
+    uint64_t m_total_comp_bytes;
+
+    void compress_block(block *pBlock);
+    void compress_block_task(uint64_t data, void *pData_ptr);
+    bool write_finished_blocks(bool wait_for_all);
+    void free_blocks();
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+// class vogl_trace_block_reader_stream
+// Read only view of the uncompressed packet data stored in a sequence of compressed blocks. Offsets (get_ofs()/seek())
+// are packet offsets as returned by vogl_trace_block_make_packet_ofs().
+//----------------------------------------------------------------------------------------------------------------------
+class vogl_trace_block_reader_stream : public data_stream
+{
+    VOGL_NO_COPY_OR_ASSIGNMENT_OP(vogl_trace_block_reader_stream);
+
+public:
+    vogl_trace_block_reader_stream();
+    virtual ~vogl_trace_block_reader_stream();
+
+    // Blocks start at first_block_file_ofs and end at end_file_ofs. pSrc must stay open until close().
+    bool open(data_stream *pSrc, uint64_t first_block_file_ofs, uint64_t end_file_ofs);
+
+    virtual bool close();
+
+    virtual uint read(void *pBuf, uint len);
+
+    virtual uint write(const void *pBuf, uint len)
+    {
+        VOGL_NOTE_UNUSED(pBuf);
+        VOGL_NOTE_UNUSED(len);
+        return 0;
+    }
+    virtual bool flush()
+    {
+        return true;
+    }
+
+    virtual bool is_size_known() const
+    {
+        return false;
+    }
+    virtual uint64_t get_size() const
+    {
+        return DATA_STREAM_SIZE_UNKNOWN;
+    }
+
+    // Returns DATA_STREAM_SIZE_UNKNOWN if there are more blocks after the current one.
+    virtual uint64_t get_remaining() const;
+
+    virtual uint64_t get_ofs() const;
+    virtual bool seek(int64_t ofs, bool relative);
+
+    // File offset of the current block.
+    inline uint64_t get_cur_block_file_ofs() const
+    {
+        return m_cur_block_file_ofs;
+    }
+
+private:
+    data_stream *m_pSrc;
+    uint64_t m_first_block_file_ofs;
+    uint64_t m_end_file_ofs;
+
+    uint64_t m_cur_block_file_ofs;
+    uint64_t m_next_block_file_ofs;
+
+    uint8_vec m_comp_buf;
+    uint8_vec m_block_buf;
+    uint m_block_ofs;
+
+    bool load_block(uint64_t block_file_ofs);
+};
+
+#endif // VOGL_TRACE_BLOCK_STREAM_H
@@ -27,7 +27,70 @@
 #include "vogl_trace_file_reader.h"
 #include "vogl_console.h"
 #include "vogl_file_utils.h"
+#include "vogl_md5.h"
 
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_trace_packet_array::alloc_packet
+//----------------------------------------------------------------------------------------------------------------------
+vogl_trace_packet_array::packet_desc vogl_trace_packet_array::alloc_packet(const uint8 *pPacket, uint packet_size)
+{
+    VOGL_FUNC_TRACER
+
+    packet_desc desc;
+    if (!packet_size)
+        return desc;
+
+    uint ofs = 0;
+    if (m_slabs.size())
+        ofs = math::align_up_value(m_slabs.back().size(), cPacketAlignment);
+
+    if ((!m_slabs.size()) || ((static_cast<uint64_t>(ofs) + packet_size) > m_slabs.back().capacity()))
+    {
+        // Start a new slab, twice as big as the last one (unless the packet needs more).
+        uint slab_size = m_slabs.size() ? math::minimum<uint>(m_slabs.back().capacity() * 2U, cMaxSlabSize) : static_cast<uint>(cMinSlabSize);
+        slab_size = math::maximum(slab_size, packet_size);
+
+        m_slabs.enlarge(1)->reserve(slab_size);
+        ofs = 0;
+    }
+
+    uint8_vec &slab = m_slabs.back();
+    slab.resize(ofs);
+    slab.append(pPacket, packet_size);
+
+    desc.m_slab = m_slabs.size() - 1;
+    desc.m_ofs = ofs;
+    desc.m_size = packet_size;
+
+    m_total_packet_bytes += packet_size;
+
+    return desc;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_trace_packet_array::erase
+//----------------------------------------------------------------------------------------------------------------------
+void vogl_trace_packet_array::erase(const vogl::vector<bool> &erase_flags)
+{
+    VOGL_FUNC_TRACER
+
+    VOGL_ASSERT(erase_flags.size() == m_index.size());
+
+    uint dst_index = 0;
+    for (uint src_index = 0; src_index < m_index.size(); src_index++)
+    {
+        if (erase_flags[src_index])
+            m_total_packet_bytes -= m_index[src_index].m_size;
+        else
+            m_index[dst_index++] = m_index[src_index];
+    }
+
+    m_index.resize(dst_index);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_trace_file_reader::read_frame_packets
+//----------------------------------------------------------------------------------------------------------------------
 vogl_trace_file_reader::trace_file_reader_status_t vogl_trace_file_reader::read_frame_packets(uint frame_index, uint num_frames, vogl_trace_packet_array &packets, uint &actual_frames_read)
 {
     VOGL_FUNC_TRACER
@@ -71,7 +134,7 @@ vogl_trace_file_reader::trace_file_reader_status_t vogl_trace_file_reader::read_
             break;
         }
 
-        packets.push_back(get_packet_buf());
+        packets.push_back(get_packet_ptr(), get_packet_size());
 
         if (is_eof_packet())
             break;
@@ -95,6 +158,7 @@ void vogl_trace_file_reader::create_eof_packet()
     vogl_trace_stream_packet_base eof_packet;
     eof_packet.init(cTSPTEOF, sizeof(vogl_trace_stream_packet_base));
     eof_packet.finalize();
+    m_pPacket_data = NULL;
     m_packet_buf.resize(0);
     m_packet_buf.append(reinterpret_cast<uint8 *>(&eof_packet), sizeof(eof_packet));
 }
@@ -126,9 +190,53 @@ bool vogl_trace_file_reader::init_loose_file_blob_manager(const char *pTrace_fil
     return true;
 }
 
+bool vogl_trace_file_reader::init_archive_chunk_blob_manager()
+{
+    VOGL_FUNC_TRACER
+
+    dynamic_string archive_path, archive_fname;
+    if (!file_utils::split_path(m_archive_blob_manager.get_archive_filename().get_ptr(), archive_path, archive_fname))
+        archive_path = ".";
+
+    return m_archive_chunk_blob_manager.init(cBMFReadable, archive_path.get_ptr());
+}
+
+bool vogl_trace_file_reader::open_index_file()
+{
+    VOGL_FUNC_TRACER
+
+    vogl_trace_index_trace_id trace_id;
+    get_index_trace_id(trace_id);
+
+    return m_index.open(get_index_filename().get_ptr(), trace_id);
+}
+
+bool vogl_trace_file_reader::build_index(bool write_index_file)
+{
+    VOGL_FUNC_TRACER
+
+    vogl_trace_index_trace_id trace_id;
+    get_index_trace_id(trace_id);
+
+    if (!m_index.build(*this, trace_id))
+        return false;
+
+    if (write_index_file)
+    {
+        dynamic_string index_filename(get_index_filename());
+        if (!m_index.write(index_filename.get_ptr()))
+            return false;
+
+        vogl_debug_printf("%s: Wrote trace index file \"%s\", %u frames\n", VOGL_FUNCTION_INFO_CSTR, index_filename.get_ptr(), m_index.get_num_frames());
+    }
+
+    return true;
+}
+
 vogl_binary_trace_file_reader::vogl_binary_trace_file_reader()
     : vogl_trace_file_reader(),
       m_trace_file_size(0),
+      m_pPacket_stream(&m_trace_stream),
       m_cur_frame_index(0),
       m_max_frame_index(-1),
       m_found_frame_file_offsets_packet(0)
@@ -208,7 +316,7 @@ bool vogl_binary_trace_file_reader::open(const char *pFilename, const char *pLoo
         return false;
     }
 
-    if (m_sof_packet.m_version < static_cast<uint16>(VOGL_TRACE_FILE_VERSION))
+    if (m_sof_packet.m_version < static_cast<uint16>(VOGL_TRACE_FILE_MINIMUM_COMPATIBLE_VERSION))
     {
         vogl_error_printf("%s: Trace file version is not supported, found version 0x%04X, expected version 0x%04X!\n", VOGL_FUNCTION_INFO_CSTR, m_sof_packet.m_version, VOGL_TRACE_FILE_VERSION);
         return false;
@@ -226,21 +334,85 @@ bool vogl_binary_trace_file_reader::open(const char *pFilename, const char *pLoo
             vogl_error_printf("%s: Failed reading in-trace archive!\n", VOGL_FUNCTION_INFO_CSTR);
             return false;
         }
+
+        if (!init_archive_chunk_blob_manager())
+            return false;
     }
 
     m_packet_buf.reserve(512 * 1024);
 
-    m_trace_stream.seek(m_sof_packet.m_first_packet_offset, false);
+    if (m_sof_packet.m_flags & cTSFCompressedPacketBlocks)
+    {
+        uint64_t end_of_blocks_ofs = m_sof_packet.m_archive_size ? m_sof_packet.m_archive_offset : m_trace_file_size;
+
+        if (!m_block_stream.open(&m_trace_stream, m_sof_packet.m_first_packet_offset, end_of_blocks_ofs))
+        {
+            vogl_error_printf("%s: Failed opening compressed packet stream!\n", VOGL_FUNCTION_INFO_CSTR);
+            close();
+            return false;
+        }
+
+        m_pPacket_stream = &m_block_stream;
+    }
+    else
+    {
+        m_trace_stream.seek(m_sof_packet.m_first_packet_offset, false);
+    }
+
+    bool found_frame_file_offsets = read_frame_file_offsets();
 
-    if (!read_frame_file_offsets())
+    if (open_index_file())
+    {
+        if (!found_frame_file_offsets)
+            found_frame_file_offsets = use_index_frame_offsets();
+    }
+
+    if (!found_frame_file_offsets)
     {
         // Keep this in sync with the offset pushed in vogl_init_tracefile()!
-        m_frame_file_offsets.push_back(get_cur_file_ofs());
+        m_frame_file_offsets.push_back(get_cur_packet_ofs());
     }
 
     return true;
 }
 
+dynamic_string vogl_binary_trace_file_reader::get_index_filename() const
+{
+    VOGL_FUNC_TRACER
+
+    return dynamic_string(cVarArg, "%s%s", m_trace_stream.get_name().get_ptr(), VOGL_TRACE_INDEX_FILE_EXTENSION);
+}
+
+void vogl_binary_trace_file_reader::get_index_trace_id(vogl_trace_index_trace_id &trace_id) const
+{
+    VOGL_FUNC_TRACER
+
+    utils::zero_object(trace_id);
+    memcpy(trace_id.m_uuid, m_sof_packet.m_uuid, sizeof(trace_id.m_uuid));
+    trace_id.m_file_size = m_trace_file_size;
+    trace_id.m_first_packet_offset = m_sof_packet.m_first_packet_offset;
+}
+
+// Takes the frame offsets from the index, for traces without a frame offsets file in their archive.
+bool vogl_binary_trace_file_reader::use_index_frame_offsets()
+{
+    VOGL_FUNC_TRACER
+
+    if ((!m_index.is_valid()) || (!m_index.has_packet_offsets()))
+        return false;
+
+    const uint num_frames = m_index.get_num_frames();
+
+    m_frame_file_offsets.resize(num_frames);
+    for (uint i = 0; i < num_frames; i++)
+        m_frame_file_offsets[i] = m_index.get_frame(i).m_packet_ofs;
+
+    m_max_frame_index = num_frames - 1;
+    m_found_frame_file_offsets_packet = true;
+
+    return true;
+}
+
 bool vogl_binary_trace_file_reader::is_opened()
 {
     VOGL_FUNC_TRACER
@@ -261,6 +433,9 @@ void vogl_binary_trace_file_reader::close()
 
     vogl_trace_file_reader::close();
 
+    m_block_stream.close();
+    m_pPacket_stream = &m_trace_stream;
+
     m_trace_stream.close();
     m_trace_file_size = 0;
 
@@ -277,7 +452,7 @@ bool vogl_binary_trace_file_reader::is_at_eof()
 {
     VOGL_FUNC_TRACER
 
-    return (m_trace_stream.get_remaining() < sizeof(vogl_trace_stream_packet_base));
+    return (m_pPacket_stream->get_remaining() < sizeof(vogl_trace_stream_packet_base));
 }
 
 bool vogl_binary_trace_file_reader::seek_to_frame(uint frame_index)
@@ -339,11 +514,12 @@ int64_t vogl_binary_trace_file_reader::get_max_frame_index()
 
     if (m_max_frame_index < 0)
     {
-        push_location();
+        // We have to read the whole trace anyway, so build the index while we're at it. Unlike a plain scan this also
+        // finds the last frame of truncated traces. It's only kept in memory, index files are written by -index mode.
+        vogl_warning_printf("%s: Trace has no frame offsets or index file, scanning it to build the index\n", VOGL_FUNCTION_INFO_CSTR);
 
-        seek_to_frame(0xFFFFFFFF);
-
-        pop_location();
+        build_index(false);
+        use_index_frame_offsets();
     }
 
     if (m_max_frame_index >= 0)
@@ -360,7 +536,7 @@ vogl_trace_file_reader::trace_file_reader_status_t vogl_binary_trace_file_reader
 
     {
         vogl_trace_stream_packet_base &packet_base = *reinterpret_cast<vogl_trace_stream_packet_base *>(m_packet_buf.get_ptr());
-        uint bytes_actually_read = m_trace_stream.read(&packet_base, sizeof(packet_base));
+        uint bytes_actually_read = m_pPacket_stream->read(&packet_base, sizeof(packet_base));
         if (bytes_actually_read != sizeof(packet_base))
         {
             // Jam in a fake EOF packet in case the caller doesn't get the message that something is wrong
@@ -395,7 +571,7 @@ vogl_trace_file_reader::trace_file_reader_status_t vogl_binary_trace_file_reader
     uint num_bytes_remaining = packet_base.m_size - sizeof(vogl_trace_stream_packet_base);
     if (num_bytes_remaining)
     {
-        uint actual_bytes_read = m_trace_stream.read(m_packet_buf.get_ptr() + sizeof(vogl_trace_stream_packet_base), num_bytes_remaining);
+        uint actual_bytes_read = m_pPacket_stream->read(m_packet_buf.get_ptr() + sizeof(vogl_trace_stream_packet_base), num_bytes_remaining);
         if (actual_bytes_read != num_bytes_remaining)
         {
             console::error("%s: Failed reading variable size trace packet data (wanted %u bytes, got %u bytes), trace file is probably corrupted/invalid\n", VOGL_FUNCTION_INFO_CSTR, num_bytes_remaining, actual_bytes_read);
@@ -412,6 +588,16 @@ vogl_trace_file_reader::trace_file_reader_status_t vogl_binary_trace_file_reader
         return cFailed;
     }
 
+    update_frame_state();
+
+    return cOK;
+}
+
+// Updates the current frame index and the frame offset table after a packet has been read.
+void vogl_binary_trace_file_reader::update_frame_state()
+{
+    VOGL_FUNC_TRACER
+
     if (is_eof_packet())
     {
         if (m_max_frame_index < 0)
@@ -426,15 +612,13 @@ vogl_trace_file_reader::trace_file_reader_status_t vogl_binary_trace_file_reader
         if (m_cur_frame_index >= m_frame_file_offsets.size())
         {
             m_frame_file_offsets.resize(math::maximum(m_frame_file_offsets.size(), m_cur_frame_index + 1));
-            m_frame_file_offsets[m_cur_frame_index] = get_cur_file_ofs();
+            m_frame_file_offsets[m_cur_frame_index] = get_cur_packet_ofs();
         }
         else
         {
-            VOGL_ASSERT(m_frame_file_offsets[m_cur_frame_index] == get_cur_file_ofs());
+            VOGL_ASSERT(m_frame_file_offsets[m_cur_frame_index] == get_cur_packet_ofs());
         }
     }
-
-    return cOK;
 }
 
 bool vogl_binary_trace_file_reader::push_location()
@@ -446,7 +630,7 @@ bool vogl_binary_trace_file_reader::push_location()
 
     saved_location *p = m_saved_location_stack.enlarge(1);
     p->m_cur_frame_index = m_cur_frame_index;
-    p->m_cur_ofs = m_trace_stream.get_ofs();
+    p->m_cur_ofs = get_cur_packet_ofs();
 
     return true;
 }
@@ -462,7 +646,7 @@ bool vogl_binary_trace_file_reader::pop_location()
 
     bool success = true;
 
-    if (!m_trace_stream.seek(loc.m_cur_ofs, false))
+    if (!seek(loc.m_cur_ofs))
         success = false;
     else
         m_cur_frame_index = loc.m_cur_frame_index;
@@ -472,6 +656,149 @@ bool vogl_binary_trace_file_reader::pop_location()
     return success;
 }
 
+//-----------------------------------------------------------------------------
+// vogl_mmap_trace_file_reader::vogl_mmap_trace_file_reader
+//-----------------------------------------------------------------------------
+vogl_mmap_trace_file_reader::vogl_mmap_trace_file_reader()
+    : vogl_binary_trace_file_reader(),
+      m_pMapping(NULL),
+      m_mapping_size(0)
+{
+    VOGL_FUNC_TRACER
+}
+
+vogl_mmap_trace_file_reader::~vogl_mmap_trace_file_reader()
+{
+    VOGL_FUNC_TRACER
+
+    close();
+}
+
+bool vogl_mmap_trace_file_reader::open(const char *pFilename, const char *pLoose_file_path)
+{
+    VOGL_FUNC_TRACER
+
+    close();
+
+    if (!vogl_binary_trace_file_reader::open(pFilename, pLoose_file_path))
+        return false;
+
+    // The packets in compressed traces have to be decompressed anyway.
+    if (is_compressed())
+        return true;
+
+    uint64_t end_of_packets_ofs = m_sof_packet.m_archive_size ? m_sof_packet.m_archive_offset : m_trace_file_size;
+
+    m_pMapping = plat_map_file_read_only(pFilename, &m_mapping_size);
+    if (!m_pMapping)
+    {
+        vogl_warning_printf("%s: Unable to map trace file \"%s\", falling back to regular file reads\n", VOGL_FUNCTION_INFO_CSTR, pFilename);
+        return true;
+    }
+
+    if ((m_mapping_size < end_of_packets_ofs) || (!m_mapped_stream.open(static_cast<const void *>(m_pMapping), static_cast<size_t>(end_of_packets_ofs))) ||
+        (!m_mapped_stream.seek(m_trace_stream.get_ofs(), false)))
+    {
+        vogl_warning_printf("%s: Trace file \"%s\" changed size while opening it, falling back to regular file reads\n", VOGL_FUNCTION_INFO_CSTR, pFilename);
+
+        m_mapped_stream.close();
+        plat_unmap_file(m_pMapping, m_mapping_size);
+        m_pMapping = NULL;
+        m_mapping_size = 0;
+        return true;
+    }
+
+    m_pPacket_stream = &m_mapped_stream;
+
+    return true;
+}
+
+void vogl_mmap_trace_file_reader::close()
+{
+    VOGL_FUNC_TRACER
+
+    vogl_binary_trace_file_reader::close();
+
+    m_mapped_stream.close();
+
+    if (m_pMapping)
+    {
+        plat_unmap_file(m_pMapping, m_mapping_size);
+        m_pMapping = NULL;
+        m_mapping_size = 0;
+    }
+}
+
+vogl_trace_file_reader::trace_file_reader_status_t vogl_mmap_trace_file_reader::read_next_packet()
+{
+    VOGL_FUNC_TRACER
+
+    if (!is_mapped())
+        return vogl_binary_trace_file_reader::read_next_packet();
+
+    m_pPacket_data = NULL;
+
+    const uint64_t cur_ofs = m_mapped_stream.get_ofs();
+    const uint64_t bytes_left = m_mapped_stream.get_remaining();
+
+    if (bytes_left < sizeof(vogl_trace_stream_packet_base))
+    {
+        // Jam in a fake EOF packet in case the caller doesn't get the message that something is wrong
+        create_eof_packet();
+
+        // The could happen if the file was truncated, or the last packet didn't get entirely written.
+        if (bytes_left)
+            return cFailed;
+
+        if (m_max_frame_index < 0)
+            m_max_frame_index = m_cur_frame_index;
+        else
+            VOGL_ASSERT(m_max_frame_index == m_cur_frame_index);
+
+        return cEOF;
+    }
+
+    const uint8 *pPacket = static_cast<const uint8 *>(m_mapped_stream.get_ptr()) + cur_ofs;
+    const vogl_trace_stream_packet_base &packet_base = *reinterpret_cast<const vogl_trace_stream_packet_base *>(pPacket);
+
+    if ((!packet_base.basic_validation()) || (packet_base.m_size >= 0x7FFFFFFFULL))
+    {
+        console::error("%s: Bad trace file - packet failed basic validation tests!\n", VOGL_FUNCTION_INFO_CSTR);
+
+        create_eof_packet();
+
+        return cFailed;
+    }
+
+    if (packet_base.m_size > bytes_left)
+    {
+        console::error("%s: Failed reading variable size trace packet data (wanted %u bytes, got %u bytes), trace file is probably corrupted/invalid\n", VOGL_FUNCTION_INFO_CSTR,
+                       packet_base.m_size, static_cast<uint>(bytes_left));
+
+        create_eof_packet();
+
+        return cFailed;
+    }
+
+    if (!packet_base.check_crc(packet_base.m_size))
+    {
+        console::error("%s: Bad trace file - packet CRC32 is bad!\n", VOGL_FUNCTION_INFO_CSTR);
+
+        create_eof_packet();
+
+        return cFailed;
+    }
+
+    m_pPacket_data = pPacket;
+    m_packet_data_size = packet_base.m_size;
+
+    m_mapped_stream.seek(cur_ofs + packet_base.m_size, false);
+
+    update_frame_state();
+
+    return cOK;
+}
+
 //-----------------------------------------------------------------------------
 // vogl_json_trace_file_reader::vogl_json_trace_file_reader
 //-----------------------------------------------------------------------------
@@ -481,7 +808,10 @@ vogl_json_trace_file_reader::vogl_json_trace_file_reader()
       m_filename_is_in_multiframe_form(false),
       m_cur_frame_index(0), m_max_frame_index(0), m_cur_packet_node_index(0), m_packet_node_size(0), m_doc_eof_key_value(false),
       m_at_eof(false),
-      m_trace_packet(&m_trace_ctypes)
+      m_trace_packet(&m_trace_ctypes),
+      m_prefetched_bytes(0),
+      m_max_prefetch_bytes(cDefaultMaxPrefetchBytes),
+      m_prefetch_threads(0)
 {
     VOGL_FUNC_TRACER
 }
@@ -529,26 +859,19 @@ bool vogl_json_trace_file_reader::open(const char *pFilename, const char *pLoose
     }
     else
     {
-        uint i;
-        for (i = 0; i < 99999999; i++)
-        {
-            dynamic_string trial_base_name(m_fname);
-            if (m_filename_is_in_multiframe_form)
-                trial_base_name.shorten(7);
+        dynamic_string trial_base_name(m_fname);
+        if (m_filename_is_in_multiframe_form)
+            trial_base_name.shorten(7);
 
-            if (!i)
-                file_utils::combine_path(m_base_filename, m_drive.get_ptr(), m_dir.get_ptr(), trial_base_name.get_ptr());
+        file_utils::combine_path(m_base_filename, m_drive.get_ptr(), m_dir.get_ptr(), trial_base_name.get_ptr());
 
-            dynamic_string trial_name(cVarArg, "%s_%06u", trial_base_name.get_ptr(), i);
+        m_cur_frame_filename = compose_frame_filename(0);
 
-            dynamic_string trial_filename;
-            file_utils::combine_path_and_extension(trial_filename, m_drive.get_ptr(), m_dir.get_ptr(), trial_name.get_ptr(), m_ext.get_ptr());
-
-            if (!file_utils::does_file_exist(trial_filename.get_ptr()))
+        uint i;
+        for (i = 0; i < 99999999; i++)
+        {
+            if (!file_utils::does_file_exist(compose_frame_filename(i).get_ptr()))
                 break;
-
-            if (!i)
-                m_cur_frame_filename = trial_filename;
         }
 
         if (!i)
@@ -559,6 +882,13 @@ bool vogl_json_trace_file_reader::open(const char *pFilename, const char *pLoose
         }
 
         m_max_frame_index = i - 1;
+
+        // The index's trace ID covers every frame file, so it can only be checked once they've all been found.
+        if ((open_index_file()) && (m_index.get_num_frames() != i))
+        {
+            vogl_warning_printf("%s: Trace index file doesn't match the trace's frame files, ignoring it\n", VOGL_FUNCTION_INFO_CSTR);
+            m_index.clear();
+        }
     }
 
     if (!open_first_document())
@@ -631,6 +961,10 @@ bool vogl_json_trace_file_reader::open_first_document()
             // Don't immediately exit in case they have manually deleted the archive and want everything to read from loose files.
             //return false;
         }
+        else if (!init_archive_chunk_blob_manager())
+        {
+            return false;
+        }
     }
 
     uint64_t trace_version = pSOF_node->value_as_uint64("version");
@@ -659,34 +993,24 @@ bool vogl_json_trace_file_reader::open_first_document()
     return true;
 }
 
-bool vogl_json_trace_file_reader::read_document(const dynamic_string &filename)
+bool vogl_json_trace_file_reader::load_document(const dynamic_string &filename, json_document &doc, bool report_errors) const
 {
     VOGL_FUNC_TRACER
 
-    m_cur_frame_filename = filename;
-
-    m_cur_packet_node_index = 0;
-    m_packet_node_size = 0;
-    m_doc_eof_key_value = 0;
-    m_pPackets_array = NULL;
-    m_cur_doc.clear();
-
     bool deserialize_status = false;
 
     // HACK HACK: to work around another app writing to the file as we try to read it in -endless mode
     const uint cMaxRetries = 5;
     for (uint tries = 0; tries < cMaxRetries; tries++)
     {
-        if (!m_trace_stream.open(m_cur_frame_filename.get_ptr(), cDataStreamReadable, true))
+        if (!file_utils::does_file_exist(filename.get_ptr()))
         {
-            console::error("%s: Could not open JSON trace file \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, m_cur_frame_filename.get_ptr());
+            if (report_errors)
+                console::error("%s: Could not open JSON trace file \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, filename.get_ptr());
             return false;
         }
 
-        deserialize_status = m_cur_doc.deserialize_file(m_cur_frame_filename.get_ptr());
-
-        m_trace_stream.close();
-
+        deserialize_status = doc.deserialize_file(filename.get_ptr());
         if (deserialize_status)
             break;
 
@@ -696,48 +1020,53 @@ bool vogl_json_trace_file_reader::read_document(const dynamic_string &filename)
 
     if (!deserialize_status)
     {
-        if (m_cur_doc.get_error_msg().has_content())
-            vogl_error_printf("%s: Failed deserializing JSON file \"%s\"!\nError: %s Line: %u\n", VOGL_FUNCTION_INFO_CSTR, m_cur_frame_filename.get_ptr(), m_cur_doc.get_error_msg().get_ptr(), m_cur_doc.get_error_line());
-        else
-            vogl_error_printf("%s: Failed deserializing JSON file \"%s\"!\n", VOGL_FUNCTION_INFO_CSTR, m_cur_frame_filename.get_ptr());
+        if (report_errors)
+        {
+            if (doc.get_error_msg().has_content())
+                vogl_error_printf("%s: Failed deserializing JSON file \"%s\"!\nError: %s Line: %u\n", VOGL_FUNCTION_INFO_CSTR, filename.get_ptr(), doc.get_error_msg().get_ptr(), doc.get_error_line());
+            else
+                vogl_error_printf("%s: Failed deserializing JSON file \"%s\"!\n", VOGL_FUNCTION_INFO_CSTR, filename.get_ptr());
+        }
 
-        m_cur_doc.clear();
+        doc.clear();
         return false;
     }
 
-    vogl_message_printf("Processing JSON file \"%s\"\n", m_cur_frame_filename.get_ptr());
+    return true;
+}
 
-    const json_node *pRoot_node = m_cur_doc.get_root();
+bool vogl_json_trace_file_reader::validate_document(const json_document &doc, const dynamic_string &filename, uint frame_index, const json_node *&pPackets_array, int &eof_key_value) const
+{
+    VOGL_FUNC_TRACER
+
+    pPackets_array = NULL;
+    eof_key_value = 0;
+
+    const json_node *pRoot_node = doc.get_root();
     if (!pRoot_node)
     {
-        vogl_error_printf("%s: Couldn't find root node in JSON file \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, m_cur_frame_filename.get_ptr());
-        m_cur_doc.clear();
+        vogl_error_printf("%s: Couldn't find root node in JSON file \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, filename.get_ptr());
         return false;
     }
 
     const json_node *pMeta_node = pRoot_node->find_child("meta");
     if (!pMeta_node)
     {
-        vogl_error_printf("%s: Couldn't find meta node in JSON file \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, m_cur_frame_filename.get_ptr());
-        m_cur_doc.clear();
+        vogl_error_printf("%s: Couldn't find meta node in JSON file \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, filename.get_ptr());
         return false;
     }
 
     int64_t meta_frame_index = pMeta_node->value_as_int64("cur_frame", -1);
-    if (meta_frame_index != m_cur_frame_index)
+    if (meta_frame_index != frame_index)
     {
-        vogl_error_printf("%s: Invalid meta frame index in JSON file \"%s\" (expected %lli, got %lli)\n", VOGL_FUNCTION_INFO_CSTR, m_cur_frame_filename.get_ptr(), static_cast<long long int>(m_cur_frame_index), static_cast<long long int>(meta_frame_index));
-        m_cur_doc.clear();
+        vogl_error_printf("%s: Invalid meta frame index in JSON file \"%s\" (expected %lli, got %lli)\n", VOGL_FUNCTION_INFO_CSTR, filename.get_ptr(), static_cast<long long int>(frame_index), static_cast<long long int>(meta_frame_index));
         return false;
     }
 
-    m_doc_eof_key_value = pMeta_node->value_as_int("eof", 0);
-
-    m_pPackets_array = pRoot_node->find_child_array("packets");
-    if (!m_pPackets_array)
+    const json_node *pPackets_node = pRoot_node->find_child_array("packets");
+    if (!pPackets_node)
     {
-        vogl_error_printf("%s: Couldn't find packets node in JSON file \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, m_cur_frame_filename.get_ptr());
-        m_cur_doc.clear();
+        vogl_error_printf("%s: Couldn't find packets node in JSON file \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, filename.get_ptr());
         return false;
     }
 
@@ -760,30 +1089,343 @@ bool vogl_json_trace_file_reader::read_document(const dynamic_string &filename)
         }
     }
 
-    m_packet_node_size = m_pPackets_array->size();
+    pPackets_array = pPackets_node;
+    eof_key_value = pMeta_node->value_as_int("eof", 0);
 
     return true;
 }
 
-void vogl_json_trace_file_reader::close()
+bool vogl_json_trace_file_reader::read_document(const dynamic_string &filename)
 {
     VOGL_FUNC_TRACER
 
-    vogl_trace_file_reader::close();
+    m_cur_frame_filename = filename;
 
-    m_filename.clear();
-    m_base_filename.clear();
-    m_filename_exists = false;
-    m_filename_is_in_multiframe_form = false;
+    m_cur_packet_node_index = 0;
+    m_packet_node_size = 0;
+    m_doc_eof_key_value = 0;
+    m_pPackets_array = NULL;
+    m_cur_doc.clear();
 
-    m_drive.clear();
-    m_dir.clear();
-    m_fname.clear();
-    m_ext.clear();
+    if ((!take_prefetched_document(m_cur_frame_index, m_cur_doc)) && (!load_document(m_cur_frame_filename, m_cur_doc, true)))
+        return false;
 
-    m_cur_frame_filename.clear();
+    vogl_message_printf("Processing JSON file \"%s\"\n", m_cur_frame_filename.get_ptr());
 
-    m_trace_stream.close();
+    if (!validate_document(m_cur_doc, m_cur_frame_filename, m_cur_frame_index, m_pPackets_array, m_doc_eof_key_value))
+    {
+        m_cur_doc.clear();
+        m_pPackets_array = NULL;
+        m_doc_eof_key_value = 0;
+        return false;
+    }
+
+    m_packet_node_size = m_pPackets_array->size();
+
+    queue_prefetches();
+
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_json_trace_file_reader::init_prefetch
+//----------------------------------------------------------------------------------------------------------------------
+bool vogl_json_trace_file_reader::init_prefetch(uint num_threads, uint64_t max_prefetch_bytes)
+{
+    VOGL_FUNC_TRACER
+
+    flush_prefetches();
+
+    m_prefetch_tasks.deinit();
+    m_prefetch_threads = 0;
+    m_max_prefetch_bytes = max_prefetch_bytes;
+
+    if (!num_threads)
+        return true;
+
+    if (!m_prefetch_tasks.init(num_threads))
+    {
+        vogl_error_printf("%s: Failed starting JSON prefetch threads\n", VOGL_FUNCTION_INFO_CSTR);
+        m_prefetch_tasks.deinit();
+        return false;
+    }
+
+    m_prefetch_threads = num_threads;
+
+    if (m_pPackets_array)
+        queue_prefetches();
+
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_json_trace_file_reader::take_prefetched_document
+// Only the oldest prefetched document can be taken, anything else (seeking) throws all of them away.
+//----------------------------------------------------------------------------------------------------------------------
+bool vogl_json_trace_file_reader::take_prefetched_document(uint frame_index, json_document &doc)
+{
+    VOGL_FUNC_TRACER
+
+    if (m_prefetched_docs.is_empty())
+        return false;
+
+    prefetched_document *pPrefetched_doc = m_prefetched_docs[0];
+    if (pPrefetched_doc->m_frame_index != frame_index)
+    {
+        flush_prefetches();
+        return false;
+    }
+
+    pPrefetched_doc->m_done.wait();
+
+    m_prefetched_docs.erase(0U);
+    m_prefetched_bytes -= pPrefetched_doc->m_file_size;
+
+    bool status = pPrefetched_doc->m_status;
+    if (status)
+        doc.swap(pPrefetched_doc->m_doc);
+
+    vogl_delete(pPrefetched_doc);
+
+    // Failures are retried (and reported) by the caller.
+    return status;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_json_trace_file_reader::queue_prefetches
+//----------------------------------------------------------------------------------------------------------------------
+void vogl_json_trace_file_reader::queue_prefetches()
+{
+    VOGL_FUNC_TRACER
+
+    if ((!m_prefetch_threads) || (m_doc_eof_key_value > 0))
+        return;
+
+    // Don't bother queueing more documents than the threads can work on for a while.
+    const uint max_docs = m_prefetch_threads * 4;
+
+    uint frame_index = m_prefetched_docs.size() ? (m_prefetched_docs.back()->m_frame_index + 1) : (m_cur_frame_index + 1);
+
+    for (; (frame_index <= m_max_frame_index) && (m_prefetched_docs.size() < max_docs); frame_index++)
+    {
+        dynamic_string filename(compose_frame_filename(frame_index));
+
+        uint64_t file_size = 0;
+        if (!file_utils::get_file_size(filename.get_ptr(), file_size))
+            break;
+
+        if ((m_prefetched_docs.size()) && ((m_prefetched_bytes + file_size) > m_max_prefetch_bytes))
+            break;
+
+        prefetched_document *pPrefetched_doc = vogl_new(prefetched_document);
+        pPrefetched_doc->m_frame_index = frame_index;
+        pPrefetched_doc->m_filename = filename;
+        pPrefetched_doc->m_file_size = file_size;
+
+        m_prefetched_docs.push_back(pPrefetched_doc);
+        m_prefetched_bytes += file_size;
+
+        if (!m_prefetch_tasks.queue_object_task(this, &vogl_json_trace_file_reader::prefetch_document_task, 0, pPrefetched_doc))
+            prefetch_document_task(0, pPrefetched_doc);
+    }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_json_trace_file_reader::flush_prefetches
+//----------------------------------------------------------------------------------------------------------------------
+void vogl_json_trace_file_reader::flush_prefetches()
+{
+    VOGL_FUNC_TRACER
+
+    if (m_prefetched_docs.is_empty())
+        return;
+
+    m_prefetch_tasks.join();
+
+    for (uint i = 0; i < m_prefetched_docs.size(); i++)
+        vogl_delete(m_prefetched_docs[i]);
+    m_prefetched_docs.clear();
+
+    m_prefetched_bytes = 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_json_trace_file_reader::prefetch_document_task
+//----------------------------------------------------------------------------------------------------------------------
+void vogl_json_trace_file_reader::prefetch_document_task(uint64_t data, void *pData_ptr)
+{
+    VOGL_NOTE_UNUSED(data);
+
+    prefetched_document *pPrefetched_doc = static_cast<prefetched_document *>(pData_ptr);
+
+    pPrefetched_doc->m_status = load_document(pPrefetched_doc->m_filename, pPrefetched_doc->m_doc, false);
+
+    pPrefetched_doc->m_done.release();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// class vogl_locked_blob_manager
+// Serializes all access to another blob manager (the archive and multi blob managers aren't thread safe). get() and
+// get_to_stream() hold the lock for the entire read, and open() reads the whole blob into memory under the lock (chunked
+// blobs are read lazily, so the other blob manager's streams can't be read after it's released).
+//----------------------------------------------------------------------------------------------------------------------
+class vogl_locked_blob_manager : public vogl_blob_manager
+{
+    VOGL_NO_COPY_OR_ASSIGNMENT_OP(vogl_locked_blob_manager);
+
+public:
+    vogl_locked_blob_manager(const vogl_blob_manager &blob_manager, mutex &blob_mutex)
+        : m_blob_manager(blob_manager),
+          m_blob_mutex(blob_mutex)
+    {
+        m_flags = cBMFReadable;
+        m_initialized = blob_manager.is_initialized();
+    }
+
+    virtual vogl_blob_manager_type_t get_type() const
+    {
+        return m_blob_manager.get_type();
+    }
+
+    virtual bool get(const dynamic_string &id, uint8_vec &data) const
+    {
+        scoped_mutex lock(m_blob_mutex);
+        return m_blob_manager.get(id, data);
+    }
+
+    virtual bool get_to_stream(const dynamic_string &id, data_stream &dst) const
+    {
+        scoped_mutex lock(m_blob_mutex);
+        return m_blob_manager.get_to_stream(id, dst);
+    }
+
+    // Read only.
+    virtual dynamic_string add_buf_using_id(const void *pData, uint size, const dynamic_string &id)
+    {
+        VOGL_NOTE_UNUSED(pData);
+        VOGL_NOTE_UNUSED(size);
+        VOGL_NOTE_UNUSED(id);
+        return dynamic_string();
+    }
+
+    virtual data_stream *open(const dynamic_string &id) const
+    {
+        uint8_vec data;
+        if (!get(id, data))
+            return NULL;
+
+        dynamic_stream *pStream = vogl_new(dynamic_stream, 0U, id.get_ptr(), cDataStreamSeekable | cDataStreamReadable);
+        pStream->get_buf().swap(data);
+        return pStream;
+    }
+
+    virtual void close(data_stream *pStream) const
+    {
+        vogl_delete(pStream);
+    }
+
+    virtual bool does_exist(const dynamic_string &id) const
+    {
+        scoped_mutex lock(m_blob_mutex);
+        return m_blob_manager.does_exist(id);
+    }
+
+    virtual uint64_t get_size(const dynamic_string &id) const
+    {
+        scoped_mutex lock(m_blob_mutex);
+        return m_blob_manager.get_size(id);
+    }
+
+    virtual dynamic_string_array enumerate() const
+    {
+        scoped_mutex lock(m_blob_mutex);
+        return m_blob_manager.enumerate();
+    }
+
+private:
+    const vogl_blob_manager &m_blob_manager;
+    mutex &m_blob_mutex;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_json_trace_file_reader::convert_frame
+//----------------------------------------------------------------------------------------------------------------------
+bool vogl_json_trace_file_reader::convert_frame(uint frame_index, vogl_trace_packet_array &packets, bool &is_last_frame) const
+{
+    VOGL_FUNC_TRACER
+
+    is_last_frame = false;
+
+    if ((!m_pPackets_array) || (frame_index > m_max_frame_index))
+        return false;
+
+    dynamic_string filename(compose_frame_filename(frame_index));
+
+    json_document doc;
+    if (!load_document(filename, doc, true))
+        return false;
+
+    const json_node *pPackets_array = NULL;
+    int eof_key_value = 0;
+    if (!validate_document(doc, filename, frame_index, pPackets_array, eof_key_value))
+        return false;
+
+    is_last_frame = (eof_key_value > 0);
+
+    vogl_locked_blob_manager blob_manager(m_multi_blob_manager, m_blob_mutex);
+
+    vogl_trace_packet trace_packet(&m_trace_ctypes);
+    dynamic_stream dyn_stream;
+
+    packets.reserve(packets.size() + pPackets_array->size());
+
+    for (uint i = 0; i < pPackets_array->size(); i++)
+    {
+        const json_node *pGL_node = pPackets_array->get_value_as_object(i);
+        if (!pGL_node)
+        {
+            vogl_warning_printf("%s: Ignoring invalid JSON key %s, file \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, pPackets_array->get_path_to_item(i).get_ptr(), filename.get_ptr());
+            continue;
+        }
+
+        if (!trace_packet.json_deserialize(*pGL_node, filename.get_ptr(), &blob_manager))
+        {
+            vogl_error_printf("%s: Failed deserializing JSON file \"%s\"!\n", VOGL_FUNCTION_INFO_CSTR, filename.get_ptr());
+            return false;
+        }
+
+        dyn_stream.reset();
+        dyn_stream.open();
+
+        if (!trace_packet.serialize(dyn_stream))
+        {
+            vogl_error_printf("%s: Failed serializing binary trace packet data while processing JSON file \"%s\"!\n", VOGL_FUNCTION_INFO_CSTR, filename.get_ptr());
+            return false;
+        }
+
+        packets.push_back(dyn_stream.get_buf());
+    }
+
+    return true;
+}
+
+void vogl_json_trace_file_reader::close()
+{
+    VOGL_FUNC_TRACER
+
+    vogl_trace_file_reader::close();
+
+    m_filename.clear();
+    m_base_filename.clear();
+    m_filename_exists = false;
+    m_filename_is_in_multiframe_form = false;
+
+    m_drive.clear();
+    m_dir.clear();
+    m_fname.clear();
+    m_ext.clear();
+
+    m_cur_frame_filename.clear();
 
     m_cur_frame_index = 0;
     m_max_frame_index = 0;
@@ -797,6 +1439,8 @@ void vogl_json_trace_file_reader::close()
     m_at_eof = false;
 
     m_saved_location_stack.clear();
+
+    flush_prefetches();
 }
 
 bool vogl_json_trace_file_reader::is_at_eof()
@@ -811,7 +1455,14 @@ bool vogl_json_trace_file_reader::is_at_eof()
            ((m_doc_eof_key_value > 0) && (m_cur_packet_node_index >= m_packet_node_size));
 }
 
-dynamic_string vogl_json_trace_file_reader::compose_frame_filename()
+dynamic_string vogl_json_trace_file_reader::compose_frame_filename() const
+{
+    VOGL_FUNC_TRACER
+
+    return compose_frame_filename(m_cur_frame_index);
+}
+
+dynamic_string vogl_json_trace_file_reader::compose_frame_filename(uint frame_index) const
 {
     VOGL_FUNC_TRACER
 
@@ -822,7 +1473,7 @@ dynamic_string vogl_json_trace_file_reader::compose_frame_filename()
     if (m_filename_is_in_multiframe_form)
         trial_base_name.shorten(7);
 
-    dynamic_string trial_name(cVarArg, "%s_%06u", trial_base_name.get_ptr(), m_cur_frame_index);
+    dynamic_string trial_name(cVarArg, "%s_%06u", trial_base_name.get_ptr(), frame_index);
 
     dynamic_string trial_filename;
     file_utils::combine_path_and_extension(trial_filename, m_drive.get_ptr(), m_dir.get_ptr(), trial_name.get_ptr(), m_ext.get_ptr());
@@ -830,6 +1481,40 @@ dynamic_string vogl_json_trace_file_reader::compose_frame_filename()
     return trial_filename;
 }
 
+dynamic_string vogl_json_trace_file_reader::get_index_filename() const
+{
+    VOGL_FUNC_TRACER
+
+    return dynamic_string(cVarArg, "%s%s", m_base_filename.get_ptr(), VOGL_TRACE_INDEX_FILE_EXTENSION);
+}
+
+// JSON traces don't have a UUID in a fixed place, so they're identified by the sizes and modification times of all
+// their frame files. Editing any frame invalidates the index. m_first_packet_offset holds the number of frame files.
+void vogl_json_trace_file_reader::get_index_trace_id(vogl_trace_index_trace_id &trace_id) const
+{
+    VOGL_FUNC_TRACER
+
+    utils::zero_object(trace_id);
+
+    md5_hash_gen frames_hash;
+    for (uint i = 0; i <= m_max_frame_index; i++)
+    {
+        uint64_t file_size = 0, modified_time = 0;
+        file_utils::get_file_size_and_modified_time(compose_frame_filename(i).get_ptr(), file_size, modified_time);
+
+        frames_hash.update(file_size);
+        frames_hash.update(modified_time);
+
+        trace_id.m_file_size += file_size;
+    }
+
+    md5_hash hash(frames_hash.finalize());
+    for (uint i = 0; i < VOGL_ARRAY_SIZE(trace_id.m_uuid); i++)
+        trace_id.m_uuid[i] = hash[i];
+
+    trace_id.m_first_packet_offset = m_max_frame_index + 1;
+}
+
 bool vogl_json_trace_file_reader::seek_to_frame(uint frame_index)
 {
     VOGL_FUNC_TRACER
@@ -944,6 +1629,578 @@ vogl_trace_file_reader::trace_file_reader_status_t vogl_json_trace_file_reader::
     return m_at_eof ? cEOF : cOK;
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_prefetching_trace_file_reader::vogl_prefetching_trace_file_reader
+//----------------------------------------------------------------------------------------------------------------------
+vogl_prefetching_trace_file_reader::vogl_prefetching_trace_file_reader()
+    : vogl_trace_file_reader(),
+      m_pReader(NULL),
+      m_pCtypes(NULL),
+      m_max_queued_frames(cDefaultMaxQueuedFrames),
+      m_max_queued_bytes(cDefaultMaxQueuedBytes),
+      m_cur_frame_index(0),
+      m_cur_frame_packets_read(0),
+      m_pCur_packet(NULL),
+      m_queue_head(0),
+      m_queued_frames(0),
+      m_queued_bytes(0),
+      m_packets_available(0, 1),
+      m_space_available(0, 1),
+      m_consumer_waiting(false),
+      m_producer_waiting(false),
+      m_prefetching(false),
+      m_exit_flag(0)
+{
+    VOGL_FUNC_TRACER
+}
+
+vogl_prefetching_trace_file_reader::~vogl_prefetching_trace_file_reader()
+{
+    VOGL_FUNC_TRACER
+
+    close();
+}
+
+bool vogl_prefetching_trace_file_reader::init(vogl_trace_file_reader *pReader, const vogl_ctypes *pCtypes, uint max_queued_frames, uint64_t max_queued_bytes)
+{
+    VOGL_FUNC_TRACER
+
+    close();
+
+    if ((!pReader) || (!pCtypes) || (!pReader->is_opened()))
+        return false;
+
+    // The JSON reader loads blobs through its multi blob manager while it reads packets, which would race with the
+    // caller's blob reads.
+    if (pReader->get_type() != cBINARY_TRACE_FILE_READER)
+    {
+        vogl_warning_printf("%s: Only binary traces can be prefetched\n", VOGL_FUNCTION_INFO_CSTR);
+        return false;
+    }
+
+    m_pReader = pReader;
+    m_pCtypes = pCtypes;
+    m_max_queued_frames = math::maximum(max_queued_frames, 1U);
+    m_max_queued_bytes = math::maximum<uint64_t>(max_queued_bytes, 1);
+
+    m_cur_frame_index = pReader->get_cur_frame();
+    m_cur_frame_packets_read = 0;
+
+    // The multi blob manager only holds pointers, so it can be pointed at the wrapped reader's blob managers.
+    m_multi_blob_manager.get_blob_managers().clear();
+    m_multi_blob_manager.add_blob_manager(&pReader->get_loose_file_blob_manager());
+    m_multi_blob_manager.add_blob_manager(&pReader->get_archive_blob_manager());
+
+    return true;
+}
+
+bool vogl_prefetching_trace_file_reader::open(const char *pFilename, const char *pLoose_file_path)
+{
+    VOGL_FUNC_TRACER
+
+    VOGL_NOTE_UNUSED(pFilename);
+    VOGL_NOTE_UNUSED(pLoose_file_path);
+
+    VOGL_ASSERT_ALWAYS;
+    return false;
+}
+
+bool vogl_prefetching_trace_file_reader::is_opened()
+{
+    VOGL_FUNC_TRACER
+
+    return m_pReader && m_pReader->is_opened();
+}
+
+const char *vogl_prefetching_trace_file_reader::get_filename()
+{
+    VOGL_FUNC_TRACER
+
+    return m_pReader ? m_pReader->get_filename() : "";
+}
+
+void vogl_prefetching_trace_file_reader::close()
+{
+    VOGL_FUNC_TRACER
+
+    stop_prefetch_thread();
+    flush_queue();
+
+    if (m_pCur_packet)
+    {
+        free_packet(m_pCur_packet);
+        m_pCur_packet = NULL;
+    }
+
+    for (uint i = 0; i < m_free_packets.size(); i++)
+        vogl_delete(m_free_packets[i]);
+    m_free_packets.clear();
+
+    m_saved_location_stack.clear();
+
+    m_multi_blob_manager.get_blob_managers().clear();
+
+    m_pReader = NULL;
+    m_pCtypes = NULL;
+    m_cur_frame_index = 0;
+    m_cur_frame_packets_read = 0;
+
+    vogl_trace_file_reader::close();
+}
+
+const vogl_trace_stream_start_of_file_packet &vogl_prefetching_trace_file_reader::get_sof_packet() const
+{
+    VOGL_FUNC_TRACER
+
+    return m_pReader ? m_pReader->get_sof_packet() : m_sof_packet;
+}
+
+bool vogl_prefetching_trace_file_reader::can_quickly_seek_forward() const
+{
+    VOGL_FUNC_TRACER
+
+    return m_pReader && m_pReader->can_quickly_seek_forward();
+}
+
+dynamic_string vogl_prefetching_trace_file_reader::get_index_filename() const
+{
+    VOGL_FUNC_TRACER
+
+    return m_pReader ? m_pReader->get_index_filename() : dynamic_string();
+}
+
+void vogl_prefetching_trace_file_reader::get_index_trace_id(vogl_trace_index_trace_id &trace_id) const
+{
+    VOGL_FUNC_TRACER
+
+    if (m_pReader)
+        m_pReader->get_index_trace_id(trace_id);
+    else
+        utils::zero_object(trace_id);
+}
+
+vogl_prefetching_trace_file_reader::queued_packet *vogl_prefetching_trace_file_reader::alloc_packet()
+{
+    VOGL_FUNC_TRACER
+
+    {
+        scoped_mutex lock(m_queue_mutex);
+        if (m_free_packets.size())
+        {
+            queued_packet *pPacket = m_free_packets.back();
+            m_free_packets.pop_back();
+            return pPacket;
+        }
+    }
+
+    return vogl_new(queued_packet, m_pCtypes);
+}
+
+void vogl_prefetching_trace_file_reader::free_packet(queued_packet *pPacket)
+{
+    VOGL_FUNC_TRACER
+
+    // The packet refers to m_data, so reset it before the data can be reused.
+    pPacket->m_gl_packet.reset();
+    pPacket->m_data.resize(0);
+    pPacket->m_is_decoded = false;
+    pPacket->m_is_swap = false;
+
+    scoped_mutex lock(m_queue_mutex);
+    m_free_packets.push_back(pPacket);
+}
+
+void vogl_prefetching_trace_file_reader::flush_queue()
+{
+    VOGL_FUNC_TRACER
+
+    VOGL_ASSERT(!m_prefetching);
+
+    vogl::vector<queued_packet *> queue;
+    {
+        scoped_mutex lock(m_queue_mutex);
+        queue.swap(m_queue);
+        m_queue_head = 0;
+        m_queued_frames = 0;
+        m_queued_bytes = 0;
+    }
+
+    for (uint i = 0; i < queue.size(); i++)
+        if (queue[i])
+            free_packet(queue[i]);
+}
+
+bool vogl_prefetching_trace_file_reader::start_prefetch_thread()
+{
+    VOGL_FUNC_TRACER
+
+    // The previous helper thread may have stopped by itself at EOF.
+    m_prefetch_thread.deinit();
+
+    m_exit_flag = 0;
+    m_prefetching = true;
+
+    if ((!m_prefetch_thread.init(1)) || (!m_prefetch_thread.queue_object_task(this, &vogl_prefetching_trace_file_reader::prefetch_thread_func)))
+    {
+        vogl_error_printf("%s: Failed starting trace prefetch thread\n", VOGL_FUNCTION_INFO_CSTR);
+
+        m_prefetch_thread.deinit();
+        m_prefetching = false;
+        return false;
+    }
+
+    return true;
+}
+
+void vogl_prefetching_trace_file_reader::stop_prefetch_thread()
+{
+    VOGL_FUNC_TRACER
+
+    {
+        scoped_mutex lock(m_queue_mutex);
+
+        atomic_exchange32(&m_exit_flag, 1);
+
+        if (m_producer_waiting)
+        {
+            m_producer_waiting = false;
+            m_space_available.release();
+        }
+    }
+
+    m_prefetch_thread.deinit();
+
+    m_prefetching = false;
+}
+
+void vogl_prefetching_trace_file_reader::prefetch_thread_func(uint64_t data, void *pData_ptr)
+{
+    VOGL_FUNC_TRACER
+
+    VOGL_NOTE_UNUSED(data);
+    VOGL_NOTE_UNUSED(pData_ptr);
+
+    for (;;)
+    {
+        // Wait until there's room in the queue.
+        for (;;)
+        {
+            {
+                scoped_mutex lock(m_queue_mutex);
+
+                if (m_exit_flag)
+                    return;
+
+                if ((m_queued_frames < m_max_queued_frames) && (m_queued_bytes < m_max_queued_bytes))
+                    break;
+
+                m_producer_waiting = true;
+            }
+
+            m_space_available.wait();
+        }
+
+        queued_packet *pPacket = alloc_packet();
+
+        pPacket->m_status = m_pReader->read_next_packet();
+        pPacket->m_frame_index = m_pReader->get_cur_frame();
+        pPacket->m_file_ofs = (m_pReader->get_type() == cBINARY_TRACE_FILE_READER) ? static_cast<vogl_binary_trace_file_reader *>(m_pReader)->get_cur_file_ofs() : 0;
+
+        bool done = (pPacket->m_status != cOK);
+
+        if ((pPacket->m_status != cFailed) && (m_pReader->get_packet_size() >= sizeof(vogl_trace_stream_packet_base)))
+        {
+            pPacket->m_data.append(m_pReader->get_packet_ptr(), m_pReader->get_packet_size());
+
+            if (m_pReader->is_eof_packet())
+            {
+                done = true;
+            }
+            else if (m_pReader->get_packet_type() == cTSPTGLEntrypoint)
+            {
+                pPacket->m_is_swap = m_pReader->is_swap_buffers_packet();
+
+                // Failures are left for the replayer to report, it decodes packets which aren't decoded here itself.
+                vogl_trace_packet_view packet_view(m_pCtypes);
+                pPacket->m_is_decoded = packet_view.init(pPacket->m_data.get_ptr(), pPacket->m_data.size(), false) && pPacket->m_gl_packet.deserialize(packet_view, true);
+                if (!pPacket->m_is_decoded)
+                    pPacket->m_gl_packet.reset();
+            }
+        }
+
+        {
+            scoped_mutex lock(m_queue_mutex);
+
+            m_queue.push_back(pPacket);
+            m_queued_frames += pPacket->m_is_swap;
+            m_queued_bytes += pPacket->m_data.size();
+
+            if (done)
+                m_prefetching = false;
+
+            if (m_consumer_waiting)
+            {
+                m_consumer_waiting = false;
+                m_packets_available.release();
+            }
+        }
+
+        if (done)
+            return;
+    }
+}
+
+vogl_trace_file_reader::trace_file_reader_status_t vogl_prefetching_trace_file_reader::read_next_packet()
+{
+    VOGL_FUNC_TRACER
+
+    if (!m_pReader)
+        return cFailed;
+
+    if (m_pCur_packet)
+    {
+        free_packet(m_pCur_packet);
+        m_pCur_packet = NULL;
+    }
+
+    m_pPacket_data = NULL;
+    m_packet_data_size = 0;
+
+    queued_packet *pPacket = NULL;
+
+    for (;;)
+    {
+        bool restart = false;
+        {
+            scoped_mutex lock(m_queue_mutex);
+
+            if (m_queue_head < m_queue.size())
+            {
+                pPacket = m_queue[m_queue_head];
+                m_queue[m_queue_head++] = NULL;
+
+                m_queued_frames -= pPacket->m_is_swap;
+                m_queued_bytes -= pPacket->m_data.size();
+
+                if (m_queue_head == m_queue.size())
+                {
+                    m_queue.resize(0);
+                    m_queue_head = 0;
+                }
+
+                if ((m_producer_waiting) && (m_queued_frames < m_max_queued_frames) && (m_queued_bytes < m_max_queued_bytes))
+                {
+                    m_producer_waiting = false;
+                    m_space_available.release();
+                }
+            }
+            else if (!m_prefetching)
+            {
+                restart = true;
+            }
+            else
+            {
+                m_consumer_waiting = true;
+            }
+        }
+
+        if (pPacket)
+            break;
+
+        if (restart)
+        {
+            if (!start_prefetch_thread())
+                return cFailed;
+            continue;
+        }
+
+        m_packets_available.wait();
+    }
+
+    m_pCur_packet = pPacket;
+
+    if (pPacket->m_status == cFailed)
+        return cFailed;
+
+    if (pPacket->m_data.size())
+    {
+        m_pPacket_data = pPacket->m_data.get_ptr();
+        m_packet_data_size = pPacket->m_data.size();
+    }
+    else
+    {
+        create_eof_packet();
+    }
+
+    if (pPacket->m_frame_index != m_cur_frame_index)
+    {
+        m_cur_frame_index = pPacket->m_frame_index;
+        m_cur_frame_packets_read = 0;
+    }
+    else
+    {
+        m_cur_frame_packets_read++;
+    }
+
+    return pPacket->m_status;
+}
+
+const vogl_trace_packet *vogl_prefetching_trace_file_reader::get_decoded_gl_packet() const
+{
+    VOGL_FUNC_TRACER
+
+    return (m_pCur_packet && m_pCur_packet->m_is_decoded) ? &m_pCur_packet->m_gl_packet : NULL;
+}
+
+uint64_t vogl_prefetching_trace_file_reader::get_cur_file_ofs() const
+{
+    VOGL_FUNC_TRACER
+
+    return m_pCur_packet ? m_pCur_packet->m_file_ofs : 0;
+}
+
+bool vogl_prefetching_trace_file_reader::sync_reader()
+{
+    VOGL_FUNC_TRACER
+
+    if (!m_pReader)
+        return false;
+
+    stop_prefetch_thread();
+
+    bool read_ahead;
+    {
+        scoped_mutex lock(m_queue_mutex);
+        read_ahead = (m_queue_head < m_queue.size());
+    }
+
+    flush_queue();
+
+    if (!read_ahead)
+        return true;
+
+    // Nothing records where each packet started, so seek to the start of the caller's frame and skip the packets it
+    // has already read.
+    if (!m_pReader->seek_to_frame(m_cur_frame_index))
+    {
+        vogl_error_printf("%s: Failed seeking back to frame %u\n", VOGL_FUNCTION_INFO_CSTR, m_cur_frame_index);
+        return false;
+    }
+
+    for (uint i = 0; i < m_cur_frame_packets_read; i++)
+    {
+        if (m_pReader->read_next_packet() != cOK)
+        {
+            vogl_error_printf("%s: Failed skipping to packet %u of frame %u\n", VOGL_FUNCTION_INFO_CSTR, m_cur_frame_packets_read, m_cur_frame_index);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool vogl_prefetching_trace_file_reader::is_at_eof()
+{
+    VOGL_FUNC_TRACER
+
+    if (!m_pReader)
+        return true;
+
+    for (;;)
+    {
+        {
+            scoped_mutex lock(m_queue_mutex);
+
+            if (m_queue_head < m_queue.size())
+                return m_queue[m_queue_head]->m_status == cEOF;
+
+            if (!m_prefetching)
+                break;
+
+            m_consumer_waiting = true;
+        }
+
+        m_packets_available.wait();
+    }
+
+    return m_pReader->is_at_eof();
+}
+
+bool vogl_prefetching_trace_file_reader::seek_to_frame(uint frame_index)
+{
+    VOGL_FUNC_TRACER
+
+    if (!m_pReader)
+        return false;
+
+    stop_prefetch_thread();
+    flush_queue();
+
+    bool success = m_pReader->seek_to_frame(frame_index);
+
+    m_cur_frame_index = m_pReader->get_cur_frame();
+    m_cur_frame_packets_read = 0;
+
+    return success;
+}
+
+int64_t vogl_prefetching_trace_file_reader::get_max_frame_index()
+{
+    VOGL_FUNC_TRACER
+
+    if (!sync_reader())
+        return -1;
+
+    return m_pReader->get_max_frame_index();
+}
+
+bool vogl_prefetching_trace_file_reader::push_location()
+{
+    VOGL_FUNC_TRACER
+
+    if ((!sync_reader()) || (!m_pReader->push_location()))
+        return false;
+
+    saved_location *p = m_saved_location_stack.enlarge(1);
+    p->m_cur_frame_index = m_cur_frame_index;
+    p->m_cur_frame_packets_read = m_cur_frame_packets_read;
+
+    return true;
+}
+
+bool vogl_prefetching_trace_file_reader::pop_location()
+{
+    VOGL_FUNC_TRACER
+
+    if ((!m_pReader) || (m_saved_location_stack.is_empty()))
+        return false;
+
+    stop_prefetch_thread();
+    flush_queue();
+
+    bool success = m_pReader->pop_location();
+
+    saved_location &loc = m_saved_location_stack.back();
+    m_cur_frame_index = loc.m_cur_frame_index;
+    m_cur_frame_packets_read = loc.m_cur_frame_packets_read;
+    m_saved_location_stack.pop_back();
+
+    return success;
+}
+
+vogl_trace_file_reader::trace_file_reader_status_t vogl_prefetching_trace_file_reader::read_frame_packets(uint frame_index, uint num_frames, vogl_trace_packet_array &packets, uint &actual_frames_read)
+{
+    VOGL_FUNC_TRACER
+
+    actual_frames_read = 0;
+
+    // The wrapped reader restores its location afterwards, so it just has to be at the caller's position first.
+    if (!sync_reader())
+        return cFailed;
+
+    return m_pReader->read_frame_packets(frame_index, num_frames, packets, actual_frames_read);
+}
+
 bool vogl_is_multiframe_json_trace_filename(const char *pFilename)
 {
     VOGL_FUNC_TRACER
@@ -1104,7 +2361,7 @@ vogl_trace_file_reader *vogl_create_trace_file_reader(vogl_trace_file_reader_typ
     switch (trace_type)
     {
         case cBINARY_TRACE_FILE_READER:
-            return vogl_new(vogl_binary_trace_file_reader);
+            return vogl_new(vogl_mmap_trace_file_reader);
             break;
         case cJSON_TRACE_FILE_READER:
             return vogl_new(vogl_json_trace_file_reader);
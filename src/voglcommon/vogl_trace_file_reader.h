@@ -30,88 +30,126 @@
 #include "vogl_common.h"
 #include "vogl_trace_stream_types.h"
 #include "vogl_trace_packet.h"
+#include "vogl_trace_block_stream.h"
+#include "vogl_trace_index.h"
 #include "vogl_cfile_stream.h"
+#include "vogl_buffer_stream.h"
 #include "vogl_dynamic_stream.h"
 #include "vogl_json.h"
 
 //----------------------------------------------------------------------------------------------------------------------
 // class vogl_trace_packet_array
 //----------------------------------------------------------------------------------------------------------------------
-typedef vogl::vector<uint8_vec> vogl_packet_buf_vec;
-
+// Packets are stored back to back in a list of slabs, with an index of slab/offset/size entries. Slabs grow
+// geometrically (up to cMaxSlabSize) so small arrays (display lists) stay small while trimming a heavy frame only costs
+// a handful of allocations. insert()/erase() only rebuild the index - the data of erased packets is released by clear().
 class vogl_trace_packet_array
 {
 public:
+    enum
+    {
+        cMinSlabSize = 4096,
+        cMaxSlabSize = 4 * 1024 * 1024,
+        cPacketAlignment = 8
+    };
+
     vogl_trace_packet_array()
+        : m_total_packet_bytes(0)
     {
     }
 
     void clear()
     {
-        m_packets.clear();
+        m_index.clear();
+        m_slabs.clear();
+        m_total_packet_bytes = 0;
     }
 
+    // Grows by adding empty packets, or shrinks by dropping packets from the end.
     void resize(uint new_size)
     {
-        m_packets.resize(new_size);
+        if (new_size < m_index.size())
+        {
+            for (uint i = new_size; i < m_index.size(); i++)
+                m_total_packet_bytes -= m_index[i].m_size;
+        }
+
+        m_index.resize(new_size);
     }
     void reserve(uint new_capacity)
     {
-        m_packets.reserve(new_capacity);
+        m_index.reserve(new_capacity);
     }
 
     uint size() const
     {
-        return m_packets.size();
+        return m_index.size();
     }
     bool is_empty() const
     {
-        return m_packets.is_empty();
+        return m_index.is_empty();
     }
 
     void push_back(const uint8_vec &packet)
     {
-        m_packets.push_back(packet);
+        push_back(packet.get_ptr(), packet.size());
+    }
+
+    void push_back(const uint8 *pPacket, uint packet_size)
+    {
+        m_index.push_back(alloc_packet(pPacket, packet_size));
     }
 
     void insert(uint index, const uint8_vec &packet)
     {
-        m_packets.insert(index, packet);
+        insert(index, packet.get_ptr(), packet.size());
     }
 
-    void erase(uint index)
+    void insert(uint index, const uint8 *pPacket, uint packet_size)
     {
-        m_packets.erase(index);
+        m_index.insert(index, alloc_packet(pPacket, packet_size));
     }
 
-    void swap(vogl_trace_packet_array &other)
+    void erase(uint index)
     {
-        m_packets.swap(other.m_packets);
+        m_total_packet_bytes -= m_index[index].m_size;
+        m_index.erase(index);
     }
 
-    const vogl_packet_buf_vec &get_vec() const
+    // Removes every packet whose entry in erase_flags (which must have size() entries) is true, in a single pass.
+    void erase(const vogl::vector<bool> &erase_flags);
+
+    void swap(vogl_trace_packet_array &other)
     {
-        return m_packets;
+        m_index.swap(other.m_index);
+        m_slabs.swap(other.m_slabs);
+        utils::swap(m_total_packet_bytes, other.m_total_packet_bytes);
     }
-    vogl_packet_buf_vec &get_vec()
+
+    // Total size of all the packets currently in the array.
+    uint64_t get_total_packet_bytes() const
     {
-        return m_packets;
+        return m_total_packet_bytes;
     }
 
-    const uint8_vec &get_packet_buf(uint index) const
+    // Pointers are stable until clear() or swap().
+    inline const uint8 *get_packet_ptr(uint index) const
     {
-        return m_packets[index];
+        const packet_desc &desc = m_index[index];
+        return desc.m_size ? (m_slabs[desc.m_slab].get_ptr() + desc.m_ofs) : NULL;
     }
-    uint8_vec &get_packet_buf(uint index)
+
+    void get_packet_buf(uint index, uint8_vec &buf) const
     {
-        return m_packets[index];
+        buf.resize(0);
+        buf.append(get_packet_ptr(index), get_packet_size(index));
     }
 
     template <typename T>
     inline const T &get_packet(uint index) const
     {
-        VOGL_ASSERT(m_packets[index].size() >= sizeof(T));
-        return *reinterpret_cast<const T *>(m_packets[index].get_ptr());
+        VOGL_ASSERT(m_index[index].m_size >= sizeof(T));
+        return *reinterpret_cast<const T *>(get_packet_ptr(index));
     }
 
     inline const vogl_trace_stream_packet_base &get_base_packet(uint index) const
@@ -125,7 +163,7 @@ public:
     }
     inline uint get_packet_size(uint index) const
     {
-        return m_packets[index].size();
+        return m_index[index].m_size;
     }
 
     inline bool is_eof_packet(uint index) const
@@ -148,7 +186,23 @@ public:
     }
 
 private:
-    vogl_packet_buf_vec m_packets;
+    struct packet_desc
+    {
+        packet_desc()
+            : m_slab(0), m_ofs(0), m_size(0)
+        {
+        }
+
+        uint m_slab;
+        uint m_ofs;
+        uint m_size;
+    };
+
+    vogl::vector<packet_desc> m_index;
+    vogl::vector<uint8_vec> m_slabs;
+    uint64_t m_total_packet_bytes;
+
+    packet_desc alloc_packet(const uint8 *pPacket, uint packet_size);
 };
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -159,6 +213,7 @@ enum vogl_trace_file_reader_type_t
     cINVALID_TRACE_FILE_READER,
     cBINARY_TRACE_FILE_READER,
     cJSON_TRACE_FILE_READER,
+    cPREFETCHING_TRACE_FILE_READER,
     cTOTAL_TRACE_FILE_READERS
 };
 
@@ -171,6 +226,8 @@ class vogl_trace_file_reader
 
 public:
     vogl_trace_file_reader()
+        : m_pPacket_data(NULL),
+          m_packet_data_size(0)
     {
         VOGL_FUNC_TRACER
 
@@ -180,6 +237,8 @@ public:
 
         m_multi_blob_manager.add_blob_manager(&m_loose_file_blob_manager);
         m_multi_blob_manager.add_blob_manager(&m_archive_blob_manager);
+
+        m_archive_blob_manager.set_chunk_source(&m_archive_chunk_blob_manager);
     }
 
     virtual ~vogl_trace_file_reader()
@@ -196,9 +255,13 @@ public:
         VOGL_FUNC_TRACER
 
         utils::zero_object(m_sof_packet);
+        m_pPacket_data = NULL;
+        m_packet_data_size = 0;
         m_packet_buf.clear();
         m_loose_file_blob_manager.deinit();
         m_archive_blob_manager.deinit();
+        m_archive_chunk_blob_manager.deinit();
+        m_index.clear();
     }
 
     virtual vogl_trace_file_reader_type_t get_type() const = 0;
@@ -239,18 +302,52 @@ public:
 
     virtual trace_file_reader_status_t read_frame_packets(uint frame_index, uint num_frames, vogl_trace_packet_array &packets, uint &actual_frames_read);
 
+    // The current packet already deserialized (with a deferred key value map), or NULL if it's only available as packet
+    // data. Only readers which decode ahead of the caller return it, it's valid until the next read_next_packet() call.
+    virtual const vogl_trace_packet *get_decoded_gl_packet() const
+    {
+        return NULL;
+    }
+
+    // The per-frame packet index, loaded from get_index_filename() when the trace is opened if it matches this trace.
+    const vogl_trace_index &get_index() const
+    {
+        return m_index;
+    }
+
+    // Where the index file for this trace lives (next to the trace).
+    virtual dynamic_string get_index_filename() const = 0;
+
+    // Reads the whole trace to (re)build the index, and optionally writes it to get_index_filename(). The current
+    // location is preserved.
+    bool build_index(bool write_index_file);
+
     // packet helpers
 
+    // The current packet's data, only valid until the next read_next_packet() call. Zero copy readers return a pointer
+    // directly into the trace file's mapping.
+    inline const uint8 *get_packet_ptr() const
+    {
+        return m_pPacket_data ? m_pPacket_data : m_packet_buf.get_ptr();
+    }
+
+    // Zero copy readers have to copy the packet into a buffer first, prefer get_packet_ptr()/get_packet_size().
     const uint8_vec &get_packet_buf() const
     {
+        if (m_pPacket_data)
+        {
+            m_packet_buf.resize(m_packet_data_size);
+            memcpy(m_packet_buf.get_ptr(), m_pPacket_data, m_packet_data_size);
+            m_pPacket_data = NULL;
+        }
         return m_packet_buf;
     }
 
     template <typename T>
     inline const T &get_packet() const
     {
-        VOGL_ASSERT(m_packet_buf.size() >= sizeof(T));
-        return *reinterpret_cast<const T *>(m_packet_buf.get_ptr());
+        VOGL_ASSERT(get_packet_size() >= sizeof(T));
+        return *reinterpret_cast<const T *>(get_packet_ptr());
     }
 
     inline const vogl_trace_stream_packet_base &get_base_packet() const
@@ -264,7 +361,7 @@ public:
     }
     inline uint get_packet_size() const
     {
-        return m_packet_buf.size();
+        return m_pPacket_data ? m_packet_data_size : m_packet_buf.size();
     }
 
     inline bool is_eof_packet() const
@@ -316,14 +413,29 @@ public:
 protected:
     vogl_trace_stream_start_of_file_packet m_sof_packet;
 
-    uint8_vec m_packet_buf;
+    // When m_pPacket_data isn't NULL the current packet lives there instead of in m_packet_buf.
+    mutable const uint8 *m_pPacket_data;
+    mutable uint m_packet_data_size;
+    mutable uint8_vec m_packet_buf;
 
     vogl_loose_file_blob_manager m_loose_file_blob_manager;
     vogl_archive_blob_manager m_archive_blob_manager;
     vogl_multi_blob_manager m_multi_blob_manager;
 
+    // Chunked blobs (see vogl_chunked_blob_manager) in the archive are reassembled from chunks stored as loose files
+    // next to the archive, whatever the loose file path is.
+    vogl_loose_file_blob_manager m_archive_chunk_blob_manager;
+
+    vogl_trace_index m_index;
+
     void create_eof_packet();
     bool init_loose_file_blob_manager(const char *pTrace_filename, const char *pLoose_file_path);
+    bool init_archive_chunk_blob_manager();
+
+    virtual void get_index_trace_id(vogl_trace_index_trace_id &trace_id) const = 0;
+    bool open_index_file();
+
+    friend class vogl_prefetching_trace_file_reader;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -355,6 +467,7 @@ class vogl_binary_trace_file_reader : public vogl_trace_file_reader
 public:
     vogl_binary_trace_file_reader();
 
+    // The underlying trace file stream (which contains compressed blocks, not packets, if is_compressed()).
     const data_stream &get_stream() const
     {
         return m_trace_stream;
@@ -401,21 +514,41 @@ public:
     {
         return m_trace_file_size;
     }
+
+    inline bool is_compressed() const
+    {
+        return m_pPacket_stream == &m_block_stream;
+    }
+
+    // Physical file offset of the next packet (or the block containing it), for progress reporting.
     inline uint64_t get_cur_file_ofs()
     {
-        return m_trace_stream.get_ofs();
+        return is_compressed() ? m_block_stream.get_cur_block_file_ofs() : m_pPacket_stream->get_ofs();
+    }
+
+    // Packet offsets are only meaningful to seek(), in compressed traces they aren't file offsets.
+    inline uint64_t get_cur_packet_ofs()
+    {
+        return m_pPacket_stream->get_ofs();
     }
     inline bool seek(uint64_t new_ofs)
     {
-        return m_trace_stream.seek(new_ofs, false);
+        return m_pPacket_stream->seek(new_ofs, false);
     }
 
     virtual trace_file_reader_status_t read_next_packet();
 
-private:
+    virtual dynamic_string get_index_filename() const;
+
+protected:
     cfile_stream m_trace_stream;
     uint64_t m_trace_file_size;
 
+    vogl_trace_block_reader_stream m_block_stream;
+
+    // Either m_trace_stream, or m_block_stream if the trace is compressed.
+    data_stream *m_pPacket_stream;
+
     uint m_cur_frame_index;
     int64_t m_max_frame_index;
     vogl::vector<uint64_t> m_frame_file_offsets;
@@ -430,7 +563,46 @@ private:
 
     bool read_frame_file_offsets();
 
+    // Set if the frame offsets came from the trace archive or the index file.
     bool m_found_frame_file_offsets_packet;
+
+    void update_frame_state();
+
+    virtual void get_index_trace_id(vogl_trace_index_trace_id &trace_id) const;
+    bool use_index_frame_offsets();
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+// class vogl_mmap_trace_file_reader
+// Maps the whole trace file into memory, packets are returned in place (see get_packet_ptr()) instead of being read
+// into the packet buffer. Falls back to vogl_binary_trace_file_reader's stream reading if the file can't be mapped, or
+// if the trace is compressed.
+//----------------------------------------------------------------------------------------------------------------------
+class vogl_mmap_trace_file_reader : public vogl_binary_trace_file_reader
+{
+    VOGL_NO_COPY_OR_ASSIGNMENT_OP(vogl_mmap_trace_file_reader);
+
+public:
+    vogl_mmap_trace_file_reader();
+    virtual ~vogl_mmap_trace_file_reader();
+
+    virtual bool open(const char *pFilename, const char *pLoose_file_path);
+
+    virtual void close();
+
+    virtual trace_file_reader_status_t read_next_packet();
+
+    inline bool is_mapped() const
+    {
+        return m_pMapping != NULL;
+    }
+
+private:
+    void *m_pMapping;
+    uint64_t m_mapping_size;
+
+    // Covers the mapped packet data, up to the start of the trace archive.
+    buffer_stream m_mapped_stream;
 };
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -441,6 +613,11 @@ class vogl_json_trace_file_reader : public vogl_trace_file_reader
     VOGL_NO_COPY_OR_ASSIGNMENT_OP(vogl_json_trace_file_reader);
 
 public:
+    enum
+    {
+        cDefaultMaxPrefetchBytes = 256 * 1024 * 1024
+    };
+
     vogl_json_trace_file_reader();
 
     virtual ~vogl_json_trace_file_reader();
@@ -481,6 +658,18 @@ public:
     virtual bool push_location();
     virtual bool pop_location();
 
+    virtual dynamic_string get_index_filename() const;
+
+    // Parses the JSON files of the frames following the current one on num_threads helper threads, so moving on to the
+    // next frame doesn't have to wait for the parser. Frames are parsed ahead while their files fit in
+    // max_prefetch_bytes (at least one frame always is). num_threads of 0 disables prefetching.
+    bool init_prefetch(uint num_threads, uint64_t max_prefetch_bytes = cDefaultMaxPrefetchBytes);
+
+    // Parses frame_index's JSON file and converts all its packets to binary packets, without changing the reader's
+    // position. is_last_frame is set if the file has a non-zero eof meta key. Several threads may convert frames at once,
+    // as long as nothing else uses the reader meanwhile.
+    bool convert_frame(uint frame_index, vogl_trace_packet_array &packets, bool &is_last_frame) const;
+
 private:
     dynamic_string m_filename;
     dynamic_string m_base_filename;
@@ -494,8 +683,6 @@ private:
 
     dynamic_string m_cur_frame_filename;
 
-    cfile_stream m_trace_stream;
-
     uint m_cur_frame_index;
     uint m_max_frame_index;
 
@@ -521,9 +708,207 @@ private:
 
     vogl::vector<saved_location> m_saved_location_stack;
 
-    dynamic_string compose_frame_filename();
+    struct prefetched_document
+    {
+        prefetched_document()
+            : m_frame_index(0),
+              m_file_size(0),
+              m_status(false),
+              m_done(0, 1)
+        {
+        }
+
+        uint m_frame_index;
+        dynamic_string m_filename;
+        uint64_t m_file_size;
+        json_document m_doc;
+        bool m_status;
+        semaphore m_done; // released by prefetch_document_task() once m_doc and m_status are set
+    };
+
+    // In frame order, starting after the current frame.
+    vogl::vector<prefetched_document *> m_prefetched_docs;
+    uint64_t m_prefetched_bytes;
+    uint64_t m_max_prefetch_bytes;
+    uint m_prefetch_threads;
+    task_pool m_prefetch_tasks;
+
+    // Serializes blob reads while converting frames on several threads.
+    mutable mutex m_blob_mutex;
+
+    dynamic_string compose_frame_filename() const;
+    dynamic_string compose_frame_filename(uint frame_index) const;
+    bool load_document(const dynamic_string &filename, json_document &doc, bool report_errors) const;
+    bool validate_document(const json_document &doc, const dynamic_string &filename, uint frame_index, const json_node *&pPackets_array, int &eof_key_value) const;
     bool read_document(const dynamic_string &filename);
     bool open_first_document();
+
+    bool take_prefetched_document(uint frame_index, json_document &doc);
+    void queue_prefetches();
+    void flush_prefetches();
+    void prefetch_document_task(uint64_t data, void *pData_ptr);
+
+    virtual void get_index_trace_id(vogl_trace_index_trace_id &trace_id) const;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+// class vogl_prefetching_trace_file_reader
+// Wraps another reader, and reads and deserializes its packets up to a few frames ahead on a helper thread so the
+// caller (the replayer's GL thread) only has to pick up decoded packets, see get_decoded_gl_packet(). seek_to_frame()
+// and pop_location() flush the queued packets, push_location() (and anything else which needs the wrapped reader at the
+// caller's position) stops the helper thread and rewinds the wrapped reader first.
+// Only the multi blob manager refers to the wrapped reader's blob managers, use get_reader() for the others.
+//----------------------------------------------------------------------------------------------------------------------
+class vogl_prefetching_trace_file_reader : public vogl_trace_file_reader
+{
+    VOGL_NO_COPY_OR_ASSIGNMENT_OP(vogl_prefetching_trace_file_reader);
+
+public:
+    enum
+    {
+        cDefaultMaxQueuedFrames = 4,
+        cDefaultMaxQueuedBytes = 256 * 1024 * 1024
+    };
+
+    vogl_prefetching_trace_file_reader();
+    virtual ~vogl_prefetching_trace_file_reader();
+
+    // pReader must already be opened and outlive this reader (or until close()). GL entrypoint packets are deserialized
+    // with pCtypes, which should be the replayer's trace ctypes (see vogl_gl_replayer::get_trace_gl_ctypes()).
+    // The queue holds at most max_queued_frames frames or max_queued_bytes bytes of packet data, whichever is hit first.
+    bool init(vogl_trace_file_reader *pReader, const vogl_ctypes *pCtypes, uint max_queued_frames = cDefaultMaxQueuedFrames, uint64_t max_queued_bytes = cDefaultMaxQueuedBytes);
+
+    vogl_trace_file_reader *get_reader() const
+    {
+        return m_pReader;
+    }
+
+    // Not supported, use init().
+    virtual bool open(const char *pFilename, const char *pLoose_file_path);
+
+    virtual bool is_opened();
+    virtual const char *get_filename();
+
+    // Stops the helper thread and detaches from the wrapped reader, which isn't closed.
+    virtual void close();
+
+    virtual vogl_trace_file_reader_type_t get_type() const
+    {
+        return cPREFETCHING_TRACE_FILE_READER;
+    }
+
+    virtual const vogl_trace_stream_start_of_file_packet &get_sof_packet() const;
+
+    virtual bool is_at_eof();
+
+    virtual bool can_quickly_seek_forward() const;
+
+    virtual uint get_cur_frame() const
+    {
+        return m_cur_frame_index;
+    }
+
+    virtual bool seek_to_frame(uint frame_index);
+
+    virtual int64_t get_max_frame_index();
+
+    virtual bool push_location();
+    virtual bool pop_location();
+
+    virtual trace_file_reader_status_t read_next_packet();
+
+    virtual trace_file_reader_status_t read_frame_packets(uint frame_index, uint num_frames, vogl_trace_packet_array &packets, uint &actual_frames_read);
+
+    virtual const vogl_trace_packet *get_decoded_gl_packet() const;
+
+    // The wrapped (binary) reader's file offset just after the packet last returned by read_next_packet(), or 0. Unlike
+    // the wrapped reader's own offset this follows the caller, not the helper thread.
+    uint64_t get_cur_file_ofs() const;
+
+    virtual dynamic_string get_index_filename() const;
+
+private:
+    struct queued_packet
+    {
+        queued_packet(const vogl_ctypes *pCtypes)
+            : m_gl_packet(pCtypes),
+              m_status(cOK),
+              m_frame_index(0),
+              m_file_ofs(0),
+              m_is_decoded(false),
+              m_is_swap(false)
+        {
+        }
+
+        uint8_vec m_data;
+
+        // Refers to m_data.
+        vogl_trace_packet m_gl_packet;
+
+        trace_file_reader_status_t m_status;
+
+        // The wrapped reader's frame index after reading the packet.
+        uint m_frame_index;
+
+        // The wrapped reader's file offset after reading the packet, 0 unless it's a binary reader.
+        uint64_t m_file_ofs;
+
+        bool m_is_decoded;
+        bool m_is_swap;
+    };
+
+    vogl_trace_file_reader *m_pReader;
+    const vogl_ctypes *m_pCtypes;
+
+    uint m_max_queued_frames;
+    uint64_t m_max_queued_bytes;
+
+    // The caller's position: the frame index, and how many packets it has read since the start of that frame.
+    uint m_cur_frame_index;
+    uint m_cur_frame_packets_read;
+
+    struct saved_location
+    {
+        uint m_cur_frame_index;
+        uint m_cur_frame_packets_read;
+    };
+    vogl::vector<saved_location> m_saved_location_stack;
+
+    // The packet last returned by read_next_packet().
+    queued_packet *m_pCur_packet;
+
+    // Everything below m_queue_mutex is shared with the helper thread.
+    mutex m_queue_mutex;
+    vogl::vector<queued_packet *> m_queue;
+    uint m_queue_head;
+    uint m_queued_frames;
+    uint64_t m_queued_bytes;
+    vogl::vector<queued_packet *> m_free_packets;
+
+    // Each is released once, by the other thread, for every wait: only while the waiting thread's flag below is set.
+    semaphore m_packets_available;
+    semaphore m_space_available;
+    bool m_consumer_waiting;
+    bool m_producer_waiting;
+
+    // Cleared by the helper thread when it stops by itself after queuing an EOF or failed read.
+    bool m_prefetching;
+
+    task_pool m_prefetch_thread;
+    atomic32_t m_exit_flag;
+
+    bool start_prefetch_thread();
+    void stop_prefetch_thread();
+    void prefetch_thread_func(uint64_t data, void *pData_ptr);
+
+    queued_packet *alloc_packet();
+    void free_packet(queued_packet *pPacket);
+    void flush_queue();
+
+    // Stops prefetching and puts the wrapped reader back at the caller's position.
+    bool sync_reader();
+
+    virtual void get_index_trace_id(vogl_trace_index_trace_id &trace_id) const;
 };
 
 bool vogl_is_multiframe_json_trace_filename(const char *pFilename);
@@ -31,14 +31,61 @@
 #include "vogl_file_utils.h"
 #include "vogl_uuid.h"
 
+// Slot buffers larger than this are freed after they're written, so one huge packet doesn't pin its memory forever.
+static const uint cMaxRetainedQueueSlotBufSize = 1024 * 1024;
+
+// How long the async writer thread sleeps when it's got nothing to do and nobody wakes it.
+static const uint cAsyncWriterIdleWaitMS = 100;
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_trace_packet_queue
+//----------------------------------------------------------------------------------------------------------------------
+vogl_trace_packet_queue::vogl_trace_packet_queue(uint num_slots)
+    : m_slot_mask(num_slots - 1),
+      m_head(0),
+      m_tail(0),
+      m_busy(0),
+      m_released(0)
+{
+    VOGL_FUNC_TRACER
+
+    VOGL_ASSERT(math::is_power_of_2(num_slots));
+
+    m_slots.resize(num_slots);
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 // vogl_trace_file_writer
 //----------------------------------------------------------------------------------------------------------------------
 vogl_trace_file_writer::vogl_trace_file_writer(const vogl_ctypes *pCTypes)
     : m_gl_call_counter(0),
       m_pCTypes(pCTypes),
+      m_compress_enabled(false),
+      m_compress_block_size(vogl_trace_block_writer_stream::cDefaultBlockSize),
+      m_compress_threads(0),
+      m_compress_level(MZ_BEST_SPEED),
+      m_pPacket_stream(&m_stream),
       m_pTrace_archive(NULL),
-      m_delete_archive(false)
+      m_delete_archive(false),
+      m_archive_threads(0),
+      m_archive_level(MZ_BEST_SPEED),
+      m_async_enabled(false),
+      m_async_flush_after_each_swap(false),
+      m_async_queue_full_policy(cTWQueueFullBlock),
+      m_async_queue_slots(0),
+      m_async_max_queued_bytes(0),
+      m_async_accepting(0),
+      m_async_exit_flag(0),
+      m_async_failed(0),
+      m_async_writer_waiting(0),
+      m_async_space_waiters(0),
+      m_async_flush_requested(0),
+      m_async_queued_bytes(0),
+      m_async_next_seq(0),
+      m_async_next_write_seq(0),
+      m_async_total_dropped(0),
+      m_async_packets_available(0, 32767),
+      m_async_space_available(0, 32767)
 {
     VOGL_FUNC_TRACER
 }
@@ -48,6 +95,44 @@ vogl_trace_file_writer::~vogl_trace_file_writer()
     VOGL_FUNC_TRACER
 
     close();
+
+    for (uint i = 0; i < m_async_queues.size(); i++)
+        vogl_delete(m_async_queues[i]);
+    m_async_queues.clear();
+}
+
+bool vogl_trace_file_writer::init_compression(uint block_size, uint num_threads, int level)
+{
+    VOGL_FUNC_TRACER
+
+    if (is_opened())
+    {
+        vogl_error_printf("%s: Can't enable compression while a trace file is open\n", VOGL_FUNCTION_INFO_CSTR);
+        return false;
+    }
+
+    m_compress_enabled = true;
+    m_compress_block_size = block_size;
+    m_compress_threads = num_threads;
+    m_compress_level = level;
+
+    return true;
+}
+
+bool vogl_trace_file_writer::init_archive_compression(uint num_threads, int level)
+{
+    VOGL_FUNC_TRACER
+
+    if (is_opened())
+    {
+        vogl_error_printf("%s: Can't change archive compression while a trace file is open\n", VOGL_FUNCTION_INFO_CSTR);
+        return false;
+    }
+
+    m_archive_threads = num_threads;
+    m_archive_level = level;
+
+    return true;
 }
 
 // pTrace_archive may be NULL. Takes ownership of pTrace_archive.
@@ -73,6 +158,8 @@ bool vogl_trace_file_writer::open(const char *pFilename, vogl_archive_blob_manag
     m_sof_packet.init();
     m_sof_packet.m_pointer_sizes = pointer_sizes;
     m_sof_packet.m_first_packet_offset = sizeof(m_sof_packet);
+    if (m_compress_enabled)
+        m_sof_packet.m_flags |= cTSFCompressedPacketBlocks;
 
     md5_hash h(gen_uuid());
     VOGL_ASSUME(sizeof(h) == sizeof(m_sof_packet.m_uuid));
@@ -87,6 +174,16 @@ bool vogl_trace_file_writer::open(const char *pFilename, vogl_archive_blob_manag
         return false;
     }
 
+    if (m_compress_enabled)
+    {
+        if (!m_block_stream.open(&m_stream, m_compress_block_size, m_compress_threads, m_compress_level))
+        {
+            vogl_error_printf("%s: Failed initializing compressed block stream for trace file \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, pFilename);
+            return false;
+        }
+        m_pPacket_stream = &m_block_stream;
+    }
+
     if (pTrace_archive)
     {
         m_pTrace_archive.reset(pTrace_archive);
@@ -105,12 +202,20 @@ bool vogl_trace_file_writer::open(const char *pFilename, vogl_archive_blob_manag
 
             return false;
         }
+
+        m_pTrace_archive->set_compression_level(m_archive_level);
+
+        if (m_archive_threads)
+            m_pTrace_archive->init_compression_threads(m_archive_threads);
     }
 
     // TODO: The trace reader records the first offset right after SOF, I would like to do this after the demarcation packet.
     m_frame_file_offsets.reserve(10000);
     m_frame_file_offsets.resize(0);
-    m_frame_file_offsets.push_back(m_stream.get_ofs());
+    if (m_pPacket_stream == &m_block_stream)
+        m_frame_file_offsets.push_back(m_block_stream.get_cur_block_index());
+    else
+        m_frame_file_offsets.push_back(m_stream.get_ofs());
 
     write_ctypes_packet();
 
@@ -118,7 +223,7 @@ bool vogl_trace_file_writer::open(const char *pFilename, vogl_archive_blob_manag
 
     if (write_demarcation_packet)
     {
-        vogl_write_glInternalTraceCommandRAD(m_stream, m_pCTypes, cITCRDemarcation, 0, NULL);
+        vogl_write_glInternalTraceCommandRAD(*m_pPacket_stream, m_pCTypes, cITCRDemarcation, 0, NULL);
     }
 
     vogl_message_printf("%s: Finished opening trace file \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, pFilename);
@@ -135,13 +240,32 @@ bool vogl_trace_file_writer::close()
     if (!m_stream.is_opened())
         return false;
 
+    stop_async_writer();
+
     vogl_message_printf("%s: Flushing trace file %s (this could take some time), %u total frame file offsets\n", VOGL_FUNCTION_INFO_CSTR, m_filename.get_ptr(), m_frame_file_offsets.size());
 
     bool success = true;
 
     dynamic_string trace_archive_filename;
 
-    if (!write_eof_packet())
+    bool wrote_packets = write_eof_packet();
+
+    if (m_pPacket_stream == &m_block_stream)
+    {
+        if (!m_block_stream.close())
+            wrote_packets = false;
+
+        resolve_frame_block_offsets();
+
+        vogl_message_printf("%s: Compressed %s packet bytes to %s bytes in %u blocks\n", VOGL_FUNCTION_INFO_CSTR,
+                            uint64_to_string_with_commas(m_block_stream.get_total_uncomp_bytes()).get_ptr(),
+                            uint64_to_string_with_commas(m_block_stream.get_total_comp_bytes()).get_ptr(),
+                            m_block_stream.get_total_blocks_written());
+
+        m_pPacket_stream = &m_stream;
+    }
+
+    if (!wrote_packets)
     {
         vogl_error_printf("%s: Failed writing to trace file \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, m_filename.get_ptr());
         success = false;
@@ -233,7 +357,7 @@ void vogl_trace_file_writer::write_ctypes_packet()
         typemap_key_values.insert(base_index++, desc.m_is_pointer_diff);
         typemap_key_values.insert(base_index++, desc.m_is_opaque_type);
     }
-    vogl_write_glInternalTraceCommandRAD(m_stream, m_pCTypes, cITCRKeyValueMap, sizeof(typemap_key_values), reinterpret_cast<const GLubyte *>(&typemap_key_values));
+    vogl_write_glInternalTraceCommandRAD(*m_pPacket_stream, m_pCTypes, cITCRKeyValueMap, sizeof(typemap_key_values), reinterpret_cast<const GLubyte *>(&typemap_key_values));
 }
 
 void vogl_trace_file_writer::write_entrypoints_packet()
@@ -249,7 +373,7 @@ void vogl_trace_file_writer::write_entrypoints_packet()
         entrypoint_key_values.insert(func_iter, desc.m_pName);
     }
 
-    vogl_write_glInternalTraceCommandRAD(m_stream, m_pCTypes, cITCRKeyValueMap, sizeof(entrypoint_key_values), reinterpret_cast<const GLubyte *>(&entrypoint_key_values));
+    vogl_write_glInternalTraceCommandRAD(*m_pPacket_stream, m_pCTypes, cITCRKeyValueMap, sizeof(entrypoint_key_values), reinterpret_cast<const GLubyte *>(&entrypoint_key_values));
 }
 
 bool vogl_trace_file_writer::write_eof_packet()
@@ -259,7 +383,39 @@ bool vogl_trace_file_writer::write_eof_packet()
     vogl_trace_stream_packet_base eof_packet;
     eof_packet.init(cTSPTEOF, sizeof(vogl_trace_stream_packet_base));
     eof_packet.finalize();
-    return m_stream.write(&eof_packet, sizeof(eof_packet));
+    return m_pPacket_stream->write(&eof_packet, sizeof(eof_packet)) == sizeof(eof_packet);
+}
+
+bool vogl_trace_file_writer::begin_frame()
+{
+    VOGL_FUNC_TRACER
+
+    if (m_pPacket_stream == &m_block_stream)
+    {
+        // Each frame starts a new block, so seeking to a frame only ever decompresses the frame's own blocks.
+        if (!m_block_stream.end_block())
+            return false;
+
+        m_frame_file_offsets.push_back(m_block_stream.get_cur_block_index());
+    }
+    else
+    {
+        m_frame_file_offsets.push_back(m_stream.get_ofs());
+    }
+
+    return true;
+}
+
+// Converts the block indices recorded by begin_frame() to packet offsets, once all the blocks have been written.
+void vogl_trace_file_writer::resolve_frame_block_offsets()
+{
+    VOGL_FUNC_TRACER
+
+    for (uint i = 0; i < m_frame_file_offsets.size(); i++)
+    {
+        uint block_index = math::minimum<uint>(static_cast<uint>(m_frame_file_offsets[i]), m_block_stream.get_total_blocks_written());
+        m_frame_file_offsets[i] = vogl_trace_block_make_packet_ofs(m_block_stream.get_block_file_ofs(block_index), 0);
+    }
 }
 
 bool vogl_trace_file_writer::write_frame_file_offsets_to_archive()
@@ -275,6 +431,397 @@ bool vogl_trace_file_writer::write_frame_file_offsets_to_archive()
     return m_pTrace_archive->add_buf_using_id(m_frame_file_offsets.get_ptr(), m_frame_file_offsets.size_in_bytes(), VOGL_TRACE_ARCHIVE_FRAME_FILE_OFFSETS_FILENAME).has_content();
 }
 
+bool vogl_trace_file_writer::init_async_writer(uint max_queued_packets_per_thread, uint64_t max_queued_bytes, vogl_trace_writer_queue_full_policy queue_full_policy, bool flush_after_each_swap)
+{
+    VOGL_FUNC_TRACER
+
+    if (is_async_writer_running())
+    {
+        vogl_error_printf("%s: Can't change async writer settings while the async writer is running\n", VOGL_FUNCTION_INFO_CSTR);
+        return false;
+    }
+
+    m_async_enabled = true;
+    m_async_queue_slots = math::next_pow2(math::clamp<uint>(max_queued_packets_per_thread, 2U, 65536U));
+    m_async_max_queued_bytes = max_queued_bytes;
+    m_async_queue_full_policy = queue_full_policy;
+    m_async_flush_after_each_swap = flush_after_each_swap;
+
+    vogl_message_printf("%s: Async trace writer enabled, %u packets per thread, %" PRIu64 " max queued bytes, %s when full\n", VOGL_FUNCTION_INFO_CSTR,
+                        m_async_queue_slots, m_async_max_queued_bytes, (queue_full_policy == cTWQueueFullDrop) ? "drop" : "block");
+
+    return true;
+}
+
+bool vogl_trace_file_writer::start_async_writer()
+{
+    VOGL_FUNC_TRACER
+
+    if ((!m_async_enabled) || (!m_stream.is_opened()))
+        return false;
+
+    if (is_async_writer_running())
+        return true;
+
+    m_async_exit_flag = 0;
+    m_async_failed = 0;
+    m_async_writer_waiting = 0;
+    m_async_space_waiters = 0;
+    m_async_flush_requested = 0;
+    m_async_queued_bytes = 0;
+    m_async_next_seq = 0;
+    m_async_next_write_seq = 0;
+    m_async_total_dropped = 0;
+
+    if ((!m_async_thread.init(1)) || (!m_async_thread.queue_object_task(this, &vogl_trace_file_writer::async_writer_thread_func)))
+    {
+        vogl_error_printf("%s: Failed starting async writer thread, falling back to synchronous writes\n", VOGL_FUNCTION_INFO_CSTR);
+        m_async_thread.deinit();
+        return false;
+    }
+
+    atomic_exchange32(&m_async_accepting, 1);
+
+    return true;
+}
+
+void vogl_trace_file_writer::stop_async_writer()
+{
+    VOGL_FUNC_TRACER
+
+    if (!is_async_writer_running())
+        return;
+
+    atomic_exchange32(&m_async_accepting, 0);
+
+    // Any producer still inside queue_packet() will either finish queuing its packet or see the cleared accepting flag.
+    for (;;)
+    {
+        bool any_busy = false;
+        {
+            scoped_mutex lock(m_async_queues_mutex);
+            for (uint i = 0; i < m_async_queues.size(); i++)
+                any_busy = any_busy || (m_async_queues[i]->m_busy != 0);
+        }
+        if (!any_busy)
+            break;
+        wake_async_writer();
+        release_async_space_waiters();
+        vogl_sleep(1);
+    }
+
+    // The writer thread drains everything that was queued before it exits.
+    atomic_exchange32(&m_async_exit_flag, 1);
+    m_async_packets_available.release();
+    m_async_thread.deinit();
+
+    if (m_async_total_dropped)
+        vogl_warning_printf("%s: %" PRIu64 " packets were dropped because the async writer queues were full\n", VOGL_FUNCTION_INFO_CSTR, static_cast<uint64_t>(m_async_total_dropped));
+}
+
+bool vogl_trace_file_writer::flush_async_writer()
+{
+    VOGL_FUNC_TRACER
+
+    // The writer thread flushes the stream once it has written everything queued so far, the caller never waits.
+    atomic_exchange32(&m_async_flush_requested, 1);
+    wake_async_writer();
+
+    return !m_async_failed;
+}
+
+// Whoever flips m_async_writer_waiting from 1 to 0 owns the wakeup: either a producer releasing the semaphore, or the
+// writer thread itself taking back its announcement. So every release is matched by exactly one wait.
+void vogl_trace_file_writer::wake_async_writer()
+{
+    if ((m_async_writer_waiting) && (atomic_compare_exchange32(&m_async_writer_waiting, 0, 1) == 1))
+        m_async_packets_available.release();
+}
+
+void vogl_trace_file_writer::wait_for_async_writer()
+{
+    atomic_exchange32(&m_async_writer_waiting, 1);
+
+    // Recheck after announcing we're about to sleep, otherwise a wakeup could get lost.
+    if ((!has_queued_packets()) && (!m_async_exit_flag) && (!m_async_flush_requested))
+    {
+        if (m_async_packets_available.wait(cAsyncWriterIdleWaitMS))
+            return;
+    }
+
+    // If a producer already claimed the wakeup its release is on the way, consume it.
+    if (atomic_compare_exchange32(&m_async_writer_waiting, 0, 1) != 1)
+        m_async_packets_available.wait();
+}
+
+// Blocks a producer until the writer thread has freed up some queue space. Like the writer's own wakeups, each
+// registered waiter either takes its registration back or consumes exactly one release from the writer thread.
+// Returns false if the writer stopped accepting packets or failed.
+bool vogl_trace_file_writer::wait_for_async_space(vogl_trace_packet_queue *pQueue)
+{
+    atomic_increment32(&m_async_space_waiters);
+
+    wake_async_writer();
+
+    for (;;)
+    {
+        bool still_full = (pQueue->is_full()) || (static_cast<uint64_t>(m_async_queued_bytes) > m_async_max_queued_bytes);
+        if ((still_full) && (m_async_accepting) && (!m_async_failed))
+        {
+            if (m_async_space_available.wait(cAsyncWriterIdleWaitMS))
+                break;
+            still_full = (pQueue->is_full()) || (static_cast<uint64_t>(m_async_queued_bytes) > m_async_max_queued_bytes);
+            if ((still_full) && (m_async_accepting) && (!m_async_failed))
+                continue;
+        }
+
+        // Try to take back our registration, if the writer thread already claimed it a release is on the way.
+        atomic32_t num_waiters = m_async_space_waiters;
+        while ((num_waiters > 0) && (atomic_compare_exchange32(&m_async_space_waiters, num_waiters - 1, num_waiters) != num_waiters))
+            num_waiters = m_async_space_waiters;
+
+        if (num_waiters <= 0)
+            m_async_space_available.wait();
+        break;
+    }
+
+    return (m_async_accepting) && (!m_async_failed);
+}
+
+void vogl_trace_file_writer::release_async_space_waiters()
+{
+    if (!m_async_space_waiters)
+        return;
+
+    atomic32_t num_waiters = atomic_exchange32(&m_async_space_waiters, 0);
+    if (num_waiters > 0)
+        m_async_space_available.release(num_waiters);
+}
+
+vogl_trace_packet_queue *vogl_trace_file_writer::create_packet_queue()
+{
+    VOGL_FUNC_TRACER
+
+    if (!m_async_enabled)
+        return NULL;
+
+    vogl_trace_packet_queue *pQueue = vogl_new(vogl_trace_packet_queue, m_async_queue_slots);
+
+    scoped_mutex lock(m_async_queues_mutex);
+    m_async_queues.push_back(pQueue);
+
+    return pQueue;
+}
+
+void vogl_trace_file_writer::release_packet_queue(vogl_trace_packet_queue *pQueue)
+{
+    VOGL_FUNC_TRACER
+
+    if (!pQueue)
+        return;
+
+    scoped_mutex lock(m_async_queues_mutex);
+
+    if ((!is_async_writer_running()) && (pQueue->is_empty()))
+    {
+        int index = m_async_queues.find(pQueue);
+        VOGL_ASSERT(index >= 0);
+        if (index >= 0)
+            m_async_queues.erase_unordered(index);
+
+        vogl_delete(pQueue);
+    }
+    else
+    {
+        // The writer thread will delete it once it's been drained.
+        atomic_exchange32(&pQueue->m_released, 1);
+    }
+}
+
+bool vogl_trace_file_writer::queue_packet(vogl_trace_packet_queue *pQueue, const vogl_trace_packet &packet)
+{
+    VOGL_FUNC_TRACER
+
+    if (!pQueue)
+        return false;
+
+    atomic_exchange32(&pQueue->m_busy, 1);
+
+    if (!m_async_accepting)
+    {
+        atomic_exchange32(&pQueue->m_busy, 0);
+        return false;
+    }
+
+    // Wait for a free slot, or drop the packet.
+    while ((pQueue->is_full()) || (static_cast<uint64_t>(m_async_queued_bytes) > m_async_max_queued_bytes))
+    {
+        if (m_async_queue_full_policy == cTWQueueFullDrop)
+        {
+            if (!atomic_exchange_add64(&m_async_total_dropped, 1))
+                vogl_warning_printf("%s: Async writer queue is full, dropping packets - this trace will not replay correctly!\n", VOGL_FUNCTION_INFO_CSTR);
+
+            atomic_exchange32(&pQueue->m_busy, 0);
+            return true;
+        }
+
+        if (!wait_for_async_space(pQueue))
+        {
+            atomic_exchange32(&pQueue->m_busy, 0);
+            return m_async_failed != 0;
+        }
+    }
+
+    vogl_trace_packet_queue::slot &slot = pQueue->m_slots[static_cast<uint>(pQueue->m_tail)];
+
+    if (!packet.serialize(slot.m_buf))
+    {
+        vogl_error_printf("%s: Failed serializing packet!\n", VOGL_FUNCTION_INFO_CSTR);
+
+        atomic_exchange32(&m_async_failed, 1);
+        atomic_exchange32(&pQueue->m_busy, 0);
+        return true;
+    }
+
+    slot.m_is_swap = vogl_is_swap_buffers_entrypoint(packet.get_entrypoint_id());
+
+    atomic_exchange_add64(&m_async_queued_bytes, slot.m_buf.size());
+
+    // The sequence number is taken right before the slot is published, so the writer thread never waits long on a gap.
+    slot.m_seq = atomic_exchange_add64(&m_async_next_seq, 1);
+
+    atomic_exchange32(&pQueue->m_tail, (static_cast<uint>(pQueue->m_tail) + 1) & pQueue->m_slot_mask);
+    atomic_exchange32(&pQueue->m_busy, 0);
+
+    wake_async_writer();
+
+    return true;
+}
+
+bool vogl_trace_file_writer::has_queued_packets()
+{
+    scoped_mutex lock(m_async_queues_mutex);
+
+    for (uint i = 0; i < m_async_queues.size(); i++)
+        if (!m_async_queues[i]->is_empty())
+            return true;
+
+    return false;
+}
+
+// Writes all queued packets that are next in sequence, returns the number of packets written.
+uint vogl_trace_file_writer::write_queued_packets()
+{
+    VOGL_FUNC_TRACER
+
+    uint total_written = 0;
+
+    scoped_mutex queues_lock(m_async_queues_mutex);
+    scoped_mutex stream_lock(m_async_stream_mutex);
+
+    for (;;)
+    {
+        bool found_next = false;
+
+        for (uint queue_index = 0; queue_index < m_async_queues.size(); queue_index++)
+        {
+            vogl_trace_packet_queue *pQueue = m_async_queues[queue_index];
+
+            // Packets in a single queue are always in sequence order.
+            while (!pQueue->is_empty())
+            {
+                vogl_trace_packet_queue::slot &slot = pQueue->m_slots[static_cast<uint>(pQueue->m_head)];
+                if (slot.m_seq != static_cast<uint64_t>(m_async_next_write_seq))
+                    break;
+
+                if ((!m_async_failed) && (!write_packet(slot.m_buf.get_ptr(), slot.m_buf.size(), slot.m_is_swap)))
+                {
+                    vogl_error_printf("%s: Failed writing to trace file \"%s\"!\n", VOGL_FUNCTION_INFO_CSTR, m_filename.get_ptr());
+                    atomic_exchange32(&m_async_failed, 1);
+                }
+
+                if ((slot.m_is_swap) && (m_async_flush_after_each_swap))
+                    m_pPacket_stream->flush();
+
+                atomic_exchange_add64(&m_async_queued_bytes, -static_cast<int64_t>(slot.m_buf.size()));
+
+                if (slot.m_buf.capacity() > cMaxRetainedQueueSlotBufSize)
+                    slot.m_buf.clear();
+
+                atomic_exchange_add64(&m_async_next_write_seq, 1);
+                atomic_exchange32(&pQueue->m_head, (static_cast<uint>(pQueue->m_head) + 1) & pQueue->m_slot_mask);
+
+                found_next = true;
+                total_written++;
+            }
+        }
+
+        if (!found_next)
+            break;
+    }
+
+    // Free the queues of threads that have exited.
+    for (int queue_index = m_async_queues.size() - 1; queue_index >= 0; queue_index--)
+    {
+        vogl_trace_packet_queue *pQueue = m_async_queues[queue_index];
+        if ((pQueue->m_released) && (pQueue->is_empty()))
+        {
+            m_async_queues.erase_unordered(queue_index);
+            vogl_delete(pQueue);
+        }
+    }
+
+    return total_written;
+}
+
+void vogl_trace_file_writer::async_writer_thread_func(uint64_t data, void *pData_ptr)
+{
+    VOGL_FUNC_TRACER
+
+    VOGL_NOTE_UNUSED(data);
+    VOGL_NOTE_UNUSED(pData_ptr);
+
+    for (;;)
+    {
+        if (write_queued_packets())
+        {
+            release_async_space_waiters();
+            continue;
+        }
+
+        if (m_async_exit_flag)
+        {
+            // stop_async_writer() guarantees nothing else will be queued, but a packet may have been published
+            // after we last looked.
+            while (has_queued_packets())
+            {
+                if (write_queued_packets())
+                    release_async_space_waiters();
+                else
+                    vogl_yield_processor();
+            }
+            release_async_space_waiters();
+            break;
+        }
+
+        // A producer may be in between taking its sequence number and publishing its slot.
+        if (has_queued_packets())
+        {
+            vogl_yield_processor();
+            continue;
+        }
+
+        // Everything queued so far has been written, so this is the point a flush() asked for.
+        if (atomic_exchange32(&m_async_flush_requested, 0))
+        {
+            scoped_mutex stream_lock(m_async_stream_mutex);
+            m_pPacket_stream->flush();
+        }
+
+        wait_for_async_writer();
+    }
+}
+
 void vogl_trace_file_writer::close_archive(const char *pArchive_filename)
 {
     VOGL_FUNC_TRACER
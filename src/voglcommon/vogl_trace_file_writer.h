@@ -32,11 +32,67 @@
 #include "vogl_common.h"
 #include "vogl_trace_stream_types.h"
 #include "vogl_trace_packet.h"
+#include "vogl_trace_block_stream.h"
 #include "vogl_cfile_stream.h"
 #include "vogl_dynamic_stream.h"
 #include "vogl_json.h"
 #include "vogl_unique_ptr.h"
 
+//----------------------------------------------------------------------------------------------------------------------
+// enum vogl_trace_writer_queue_full_policy
+//----------------------------------------------------------------------------------------------------------------------
+enum vogl_trace_writer_queue_full_policy
+{
+    cTWQueueFullBlock, // app threads wait for the writer thread to catch up
+    cTWQueueFullDrop   // packets are discarded (the trace will not be replayable, but the app never stalls)
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_trace_packet_queue
+// Per-thread single producer/single consumer ring of serialized packets, drained by the async writer thread.
+// Created by vogl_trace_file_writer::create_packet_queue(), the producing thread must hand it back to
+// vogl_trace_file_writer::release_packet_queue() before it exits.
+//----------------------------------------------------------------------------------------------------------------------
+class vogl_trace_packet_queue
+{
+    VOGL_NO_COPY_OR_ASSIGNMENT_OP(vogl_trace_packet_queue);
+
+    friend class vogl_trace_file_writer;
+
+public:
+    vogl_trace_packet_queue(uint num_slots);
+
+private:
+    struct slot
+    {
+        uint8_vec m_buf;
+        uint64_t m_seq;
+        bool m_is_swap;
+    };
+
+    vogl::vector<slot> m_slots;
+    uint m_slot_mask;
+
+    // Slot indices, m_head is only written by the writer thread and m_tail by the producer.
+    atomic32_t m_head;
+    atomic32_t m_tail;
+
+    // Set while the producer is inside vogl_trace_file_writer::queue_packet().
+    atomic32_t m_busy;
+
+    // Set once the producing thread is gone, the writer thread deletes the queue after it's drained.
+    atomic32_t m_released;
+
+    inline bool is_empty() const
+    {
+        return m_head == m_tail;
+    }
+    inline bool is_full() const
+    {
+        return ((static_cast<uint>(m_tail) + 1) & m_slot_mask) == static_cast<uint>(m_head);
+    }
+};
+
 //----------------------------------------------------------------------------------------------------------------------
 // vogl_trace_file_writer
 //----------------------------------------------------------------------------------------------------------------------
@@ -55,9 +111,10 @@ public:
         return m_filename;
     }
 
+    // The stream packets should be written to (the compressed block stream if compression is enabled).
     inline data_stream &get_stream()
     {
-        return m_stream;
+        return *m_pPacket_stream;
     }
 
     inline vogl_archive_blob_manager *get_trace_archive()
@@ -65,6 +122,19 @@ public:
         return m_pTrace_archive.get();
     }
 
+    // Compressed traces store the packets in independently compressed blocks of up to block_size bytes, which are
+    // compressed by num_threads worker threads. Must be called before open().
+    bool init_compression(uint block_size, uint num_threads, int level = MZ_BEST_SPEED);
+
+    inline bool is_compression_enabled() const
+    {
+        return m_compress_enabled;
+    }
+
+    // Blobs added to the trace archive open() creates are compressed by num_threads worker threads (0 compresses them
+    // on the calling thread), at the given level (MZ_NO_COMPRESSION stores them). Must be called before open().
+    bool init_archive_compression(uint num_threads, int level = MZ_BEST_SPEED);
+
     // pTrace_archive may be NULL. Takes ownership of pTrace_archive.
     // TODO: Get rid of the demarcation packet, etc. Make the initial sequence of packets more explicit.
     bool open(const char *pFilename, vogl_archive_blob_manager *pTrace_archive = NULL, bool delete_archive = true, bool write_demarcation_packet = true, uint pointer_sizes = sizeof(void *));
@@ -96,11 +166,11 @@ public:
         if (!m_stream.is_opened())
             return false;
 
-        if (!packet.serialize(m_stream))
+        if (!packet.serialize(*m_pPacket_stream))
             return false;
 
         if (vogl_is_swap_buffers_entrypoint(packet.get_entrypoint_id()))
-            m_frame_file_offsets.push_back(m_stream.get_ofs());
+            return begin_frame();
 
         return true;
     }
@@ -112,24 +182,66 @@ public:
         if (!m_stream.is_opened())
             return false;
 
-        if (m_stream.write(pPacket, packet_size) != packet_size)
+        if (m_pPacket_stream->write(pPacket, packet_size) != packet_size)
             return false;
 
         if (is_swap)
-            m_frame_file_offsets.push_back(m_stream.get_ofs());
+            return begin_frame();
 
         return true;
     }
 
+    // While the async writer is running this only asks the writer thread to flush once it's caught up, it never waits
+    // for the queues to drain (close() does that).
     inline bool flush()
     {
         VOGL_FUNC_TRACER
 
-        return m_stream.flush();
+        if (is_async_writer_running())
+            return flush_async_writer();
+
+        return m_pPacket_stream->flush();
     }
 
     bool close();
 
+    // Async writer: app threads serialize packets into their own vogl_trace_packet_queue and a dedicated thread writes
+    // them to the stream, in the same order they where queued. Packets go straight to the stream (write_packet(), or
+    // get_stream() directly) until start_async_writer() is called, so a snapshot and the other initial packets can be
+    // written first. close() stops the writer thread.
+    bool init_async_writer(uint max_queued_packets_per_thread, uint64_t max_queued_bytes, vogl_trace_writer_queue_full_policy queue_full_policy, bool flush_after_each_swap);
+
+    inline bool is_async_writer_enabled() const
+    {
+        return m_async_enabled;
+    }
+    inline bool is_async_writer_running() const
+    {
+        return m_async_accepting != 0;
+    }
+
+    // Caller must serialize calls to start_async_writer() with open()/close().
+    bool start_async_writer();
+
+    // Thread safe, never blocks on other producers. Returns false (without queuing anything) if the async writer isn't
+    // running, in which case the caller should fall back to write_packet() while holding whatever lock it uses to
+    // serialize open()/close().
+    bool queue_packet(vogl_trace_packet_queue *pQueue, const vogl_trace_packet &packet);
+
+    vogl_trace_packet_queue *create_packet_queue();
+    void release_packet_queue(vogl_trace_packet_queue *pQueue);
+
+    // Set if the writer thread failed to serialize or write a packet - the trace file is not usable after this.
+    inline bool get_async_writer_failed() const
+    {
+        return m_async_failed != 0;
+    }
+
+    inline uint64_t get_total_dropped_packets() const
+    {
+        return m_async_total_dropped;
+    }
+
 private:
     atomic64_t m_gl_call_counter;
 
@@ -137,13 +249,66 @@ private:
     dynamic_string m_filename;
     cfile_stream m_stream;
 
+    bool m_compress_enabled;
+    uint m_compress_block_size;
+    uint m_compress_threads;
+    int m_compress_level;
+    vogl_trace_block_writer_stream m_block_stream;
+
+    // Either m_stream, or m_block_stream when writing a compressed trace.
+    data_stream *m_pPacket_stream;
+
     vogl_unique_ptr<vogl_archive_blob_manager> m_pTrace_archive;
     bool m_delete_archive;
+    uint m_archive_threads;
+    int m_archive_level;
 
     vogl_trace_stream_start_of_file_packet m_sof_packet;
 
+    // Block indices instead of offsets while writing a compressed trace, see resolve_frame_block_offsets().
     vogl::vector<uint64_t> m_frame_file_offsets;
 
+    bool m_async_enabled;
+    bool m_async_flush_after_each_swap;
+    vogl_trace_writer_queue_full_policy m_async_queue_full_policy;
+    uint m_async_queue_slots;
+    uint64_t m_async_max_queued_bytes;
+
+    atomic32_t m_async_accepting;
+    atomic32_t m_async_exit_flag;
+    atomic32_t m_async_failed;
+    atomic32_t m_async_writer_waiting;
+    atomic32_t m_async_space_waiters;
+    atomic32_t m_async_flush_requested;
+
+    atomic64_t m_async_queued_bytes;
+    atomic64_t m_async_next_seq;
+    atomic64_t m_async_next_write_seq;
+    atomic64_t m_async_total_dropped;
+
+    mutex m_async_queues_mutex;
+    vogl::vector<vogl_trace_packet_queue *> m_async_queues;
+
+    // Held by the writer thread while it's writing to m_stream.
+    mutex m_async_stream_mutex;
+
+    semaphore m_async_packets_available;
+    semaphore m_async_space_available;
+    task_pool m_async_thread;
+
+    void stop_async_writer();
+    bool flush_async_writer();
+    void wake_async_writer();
+    void wait_for_async_writer();
+    bool wait_for_async_space(vogl_trace_packet_queue *pQueue);
+    void release_async_space_waiters();
+    bool has_queued_packets();
+    uint write_queued_packets();
+    void async_writer_thread_func(uint64_t data, void *pData_ptr);
+
+    bool begin_frame();
+    void resolve_frame_block_offsets();
+
     void write_ctypes_packet();
 
     void write_entrypoints_packet();
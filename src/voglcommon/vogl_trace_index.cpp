@@ -0,0 +1,258 @@
+/**************************************************************************
+ *
+ * Copyright 2013-2014 RAD Game Tools and Valve Software
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+//----------------------------------------------------------------------------------------------------------------------
+// File: vogl_trace_index.cpp
+//----------------------------------------------------------------------------------------------------------------------
+#include "vogl_trace_index.h"
+#include "vogl_trace_file_reader.h"
+#include "vogl_file_utils.h"
+
+#include "vogl_port.h"
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_trace_index
+//----------------------------------------------------------------------------------------------------------------------
+vogl_trace_index::vogl_trace_index()
+    : m_pHeader(NULL),
+      m_pFrames(NULL),
+      m_pMapping(NULL),
+      m_mapping_size(0)
+{
+    VOGL_FUNC_TRACER
+}
+
+vogl_trace_index::~vogl_trace_index()
+{
+    VOGL_FUNC_TRACER
+
+    clear();
+}
+
+void vogl_trace_index::clear()
+{
+    VOGL_FUNC_TRACER
+
+    m_pHeader = NULL;
+    m_pFrames = NULL;
+
+    if (m_pMapping)
+    {
+        plat_unmap_file(m_pMapping, m_mapping_size);
+        m_pMapping = NULL;
+        m_mapping_size = 0;
+    }
+
+    m_buf.clear();
+}
+
+bool vogl_trace_index::build(vogl_trace_file_reader &reader, const vogl_trace_index_trace_id &trace_id)
+{
+    VOGL_FUNC_TRACER
+
+    clear();
+
+    vogl_binary_trace_file_reader *pBinary_reader = NULL;
+    if (reader.get_type() == cBINARY_TRACE_FILE_READER)
+        pBinary_reader = static_cast<vogl_binary_trace_file_reader *>(&reader);
+
+    vogl_scoped_location_saver saved_loc(reader);
+
+    if (!reader.seek_to_frame(0))
+    {
+        vogl_error_printf("%s: Failed seeking to the first frame\n", VOGL_FUNCTION_INFO_CSTR);
+        return false;
+    }
+
+    vogl::vector<vogl_trace_index_frame> frames;
+    frames.reserve(1024);
+
+    vogl_trace_index_frame *pCur_frame = frames.enlarge(1);
+    utils::zero_object(*pCur_frame);
+    pCur_frame->m_first_call_counter = cUINT64_MAX;
+    pCur_frame->m_packet_ofs = pBinary_reader ? pBinary_reader->get_cur_packet_ofs() : 0;
+
+    uint64_t last_call_counter = 0;
+    bool complete = false;
+
+    for (;;)
+    {
+        vogl_trace_file_reader::trace_file_reader_status_t status = reader.read_next_packet();
+        if (status == vogl_trace_file_reader::cFailed)
+        {
+            vogl_warning_printf("%s: Failed reading packet in frame %u, the index will stop at this frame\n", VOGL_FUNCTION_INFO_CSTR, frames.size() - 1);
+            break;
+        }
+        else if (status == vogl_trace_file_reader::cEOF)
+        {
+            complete = true;
+            break;
+        }
+
+        pCur_frame->m_num_packets++;
+        pCur_frame->m_total_bytes += reader.get_packet_size();
+
+        if (reader.is_eof_packet())
+        {
+            complete = true;
+            break;
+        }
+
+        if (reader.get_packet_type() != cTSPTGLEntrypoint)
+            continue;
+
+        const vogl_trace_gl_entrypoint_packet &gl_packet = reader.get_packet<vogl_trace_gl_entrypoint_packet>();
+
+        if (pCur_frame->m_first_call_counter == cUINT64_MAX)
+            pCur_frame->m_first_call_counter = gl_packet.m_call_counter;
+        last_call_counter = math::maximum(last_call_counter, gl_packet.m_call_counter);
+        pCur_frame->m_last_call_counter = last_call_counter;
+
+        gl_entrypoint_id_t entrypoint_id = static_cast<gl_entrypoint_id_t>(gl_packet.m_entrypoint_id);
+        if (vogl_is_draw_entrypoint(entrypoint_id))
+            pCur_frame->m_num_draws++;
+
+        if (vogl_is_swap_buffers_entrypoint(entrypoint_id))
+        {
+            pCur_frame = frames.enlarge(1);
+            utils::zero_object(*pCur_frame);
+            pCur_frame->m_first_call_counter = cUINT64_MAX;
+            pCur_frame->m_last_call_counter = last_call_counter;
+            pCur_frame->m_packet_ofs = pBinary_reader ? pBinary_reader->get_cur_packet_ofs() : 0;
+        }
+    }
+
+    m_buf.resize(sizeof(vogl_trace_index_header) + frames.size_in_bytes());
+
+    vogl_trace_index_header &hdr = *reinterpret_cast<vogl_trace_index_header *>(m_buf.get_ptr());
+    hdr.m_sig = vogl_trace_index_header::cSig;
+    hdr.m_version = vogl_trace_index_header::cVersion;
+    hdr.m_header_size = sizeof(vogl_trace_index_header);
+    hdr.m_frame_size = sizeof(vogl_trace_index_frame);
+    hdr.m_flags = (complete ? cTIFComplete : 0) | (pBinary_reader ? cTIFHasPacketOffsets : 0);
+    hdr.m_trace_id = trace_id;
+    hdr.m_num_frames = frames.size();
+
+    memcpy(m_buf.get_ptr() + sizeof(vogl_trace_index_header), frames.get_ptr(), frames.size_in_bytes());
+    hdr.m_frames_crc = (uint32)mz_crc32(MZ_CRC32_INIT, m_buf.get_ptr() + sizeof(vogl_trace_index_header), frames.size_in_bytes());
+
+    m_pHeader = &hdr;
+    m_pFrames = reinterpret_cast<const vogl_trace_index_frame *>(m_buf.get_ptr() + sizeof(vogl_trace_index_header));
+
+    return true;
+}
+
+bool vogl_trace_index::write(const char *pFilename) const
+{
+    VOGL_FUNC_TRACER
+
+    if (!m_pHeader)
+        return false;
+
+    size_t total_size = sizeof(vogl_trace_index_header) + m_pHeader->m_num_frames * sizeof(vogl_trace_index_frame);
+    if (!file_utils::write_buf_to_file(pFilename, m_pHeader, total_size))
+    {
+        vogl_error_printf("%s: Failed writing trace index file \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, pFilename);
+        return false;
+    }
+
+    return true;
+}
+
+bool vogl_trace_index::open(const char *pFilename, const vogl_trace_index_trace_id &trace_id)
+{
+    VOGL_FUNC_TRACER
+
+    clear();
+
+    if (!file_utils::does_file_exist(pFilename))
+        return false;
+
+    m_pMapping = plat_map_file_read_only(pFilename, &m_mapping_size);
+    if (!m_pMapping)
+    {
+        vogl_warning_printf("%s: Failed mapping trace index file \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, pFilename);
+        return false;
+    }
+
+    const vogl_trace_index_header *pHeader = static_cast<const vogl_trace_index_header *>(m_pMapping);
+    const uint8 *pFrame_data = static_cast<const uint8 *>(m_pMapping) + sizeof(vogl_trace_index_header);
+
+    if ((m_mapping_size < sizeof(vogl_trace_index_header)) ||
+        (pHeader->m_sig != static_cast<uint32>(vogl_trace_index_header::cSig)) ||
+        (pHeader->m_version != static_cast<uint16>(vogl_trace_index_header::cVersion)) ||
+        (pHeader->m_header_size != sizeof(vogl_trace_index_header)) ||
+        (pHeader->m_frame_size != sizeof(vogl_trace_index_frame)) ||
+        (m_mapping_size != sizeof(vogl_trace_index_header) + static_cast<uint64_t>(pHeader->m_num_frames) * sizeof(vogl_trace_index_frame)) ||
+        (!pHeader->m_num_frames))
+    {
+        vogl_warning_printf("%s: Trace index file \"%s\" is invalid, ignoring it\n", VOGL_FUNCTION_INFO_CSTR, pFilename);
+        clear();
+        return false;
+    }
+
+    if (memcmp(&pHeader->m_trace_id, &trace_id, sizeof(trace_id)) != 0)
+    {
+        vogl_warning_printf("%s: Trace index file \"%s\" was built from a different trace, ignoring it\n", VOGL_FUNCTION_INFO_CSTR, pFilename);
+        clear();
+        return false;
+    }
+
+    if ((uint32)mz_crc32(MZ_CRC32_INIT, pFrame_data, static_cast<size_t>(m_mapping_size - sizeof(vogl_trace_index_header))) != pHeader->m_frames_crc)
+    {
+        vogl_warning_printf("%s: Trace index file \"%s\" failed CRC check, ignoring it\n", VOGL_FUNCTION_INFO_CSTR, pFilename);
+        clear();
+        return false;
+    }
+
+    m_pHeader = pHeader;
+    m_pFrames = reinterpret_cast<const vogl_trace_index_frame *>(pFrame_data);
+
+    vogl_debug_printf("%s: Opened trace index file \"%s\", %u frames\n", VOGL_FUNCTION_INFO_CSTR, pFilename, m_pHeader->m_num_frames);
+
+    return true;
+}
+
+int vogl_trace_index::find_frame_by_call_counter(uint64_t call_counter) const
+{
+    VOGL_FUNC_TRACER
+
+    // Frames without any GL calls carry the previous frame's m_last_call_counter, so this is sorted.
+    uint lo = 0, hi = get_num_frames();
+    while (lo < hi)
+    {
+        uint mid = lo + (hi - lo) / 2;
+        if (m_pFrames[mid].m_last_call_counter < call_counter)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if ((lo >= get_num_frames()) || (m_pFrames[lo].m_first_call_counter > call_counter))
+        return -1;
+
+    return static_cast<int>(lo);
+}
@@ -0,0 +1,161 @@
+/**************************************************************************
+ *
+ * Copyright 2013-2014 RAD Game Tools and Valve Software
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+//----------------------------------------------------------------------------------------------------------------------
+// File: vogl_trace_index.h
+// Per-frame packet index, stored in a sidecar file next to the trace so readers can seek without scanning.
+//----------------------------------------------------------------------------------------------------------------------
+#ifndef VOGL_TRACE_INDEX_H
+#define VOGL_TRACE_INDEX_H
+
+#include "vogl_common.h"
+
+class vogl_trace_file_reader;
+
+#define VOGL_TRACE_INDEX_FILE_EXTENSION ".idx"
+
+#pragma pack(push, 1)
+
+// Identifies the trace an index was built from, so stale index files can be ignored.
+struct vogl_trace_index_trace_id
+{
+    uint32 m_uuid[4];
+    uint64_t m_file_size;
+    uint64_t m_first_packet_offset;
+};
+
+enum vogl_trace_index_flags_t
+{
+    // The scan reached the end of the trace (it wasn't truncated or corrupted).
+    cTIFComplete = 1,
+
+    // m_packet_ofs is valid (binary traces only - JSON traces are stored one frame per file).
+    cTIFHasPacketOffsets = 2
+};
+
+struct vogl_trace_index_header
+{
+    enum
+    {
+        cSig = 0x58444956, // 'VIDX'
+        cVersion = 0x0001
+    };
+
+    uint32 m_sig;
+    uint16 m_version;
+    uint16 m_header_size;
+    uint32 m_frame_size;
+    uint32 m_flags; // vogl_trace_index_flags_t
+
+    vogl_trace_index_trace_id m_trace_id;
+
+    uint32 m_num_frames;
+    uint32 m_frames_crc; // CRC32 of the frame records following the header
+};
+
+struct vogl_trace_index_frame
+{
+    // Offset passed to vogl_binary_trace_file_reader::seek() to get to the first packet of this frame.
+    uint64_t m_packet_ofs;
+
+    // Range of GL entrypoint call counters in this frame, m_first_call_counter is cUINT64_MAX if there are none.
+    uint64_t m_first_call_counter;
+    uint64_t m_last_call_counter;
+
+    uint64_t m_total_bytes;
+    uint32 m_num_packets;
+    uint32 m_num_draws;
+};
+
+#pragma pack(pop)
+
+//----------------------------------------------------------------------------------------------------------------------
+// class vogl_trace_index
+// Frame i covers the packets starting at frame i's offset up to and including the swap that ends it, the last frame
+// runs to the end of the trace. Index files are memory mapped when opened.
+//----------------------------------------------------------------------------------------------------------------------
+class vogl_trace_index
+{
+    VOGL_NO_COPY_OR_ASSIGNMENT_OP(vogl_trace_index);
+
+public:
+    vogl_trace_index();
+    ~vogl_trace_index();
+
+    void clear();
+
+    // Reads every packet in the trace, the reader's location is preserved.
+    bool build(vogl_trace_file_reader &reader, const vogl_trace_index_trace_id &trace_id);
+
+    bool write(const char *pFilename) const;
+
+    // Fails if the file is missing, invalid, or wasn't built from the trace identified by trace_id.
+    bool open(const char *pFilename, const vogl_trace_index_trace_id &trace_id);
+
+    inline bool is_valid() const
+    {
+        return m_pHeader != NULL;
+    }
+
+    inline uint get_flags() const
+    {
+        return m_pHeader ? m_pHeader->m_flags : 0;
+    }
+    inline bool is_complete() const
+    {
+        return (get_flags() & cTIFComplete) != 0;
+    }
+    inline bool has_packet_offsets() const
+    {
+        return (get_flags() & cTIFHasPacketOffsets) != 0;
+    }
+
+    inline uint get_num_frames() const
+    {
+        return m_pHeader ? m_pHeader->m_num_frames : 0;
+    }
+
+    inline const vogl_trace_index_frame &get_frame(uint frame_index) const
+    {
+        VOGL_ASSERT(frame_index < get_num_frames());
+        return m_pFrames[frame_index];
+    }
+
+    // Index of the frame containing the specified GL call, or -1 if it isn't in the trace.
+    int find_frame_by_call_counter(uint64_t call_counter) const;
+
+private:
+    // Either points into m_pMapping, or into m_buf after build().
+    const vogl_trace_index_header *m_pHeader;
+    const vogl_trace_index_frame *m_pFrames;
+
+    void *m_pMapping;
+    uint64_t m_mapping_size;
+
+    uint8_vec m_buf;
+};
+
+#endif // VOGL_TRACE_INDEX_H
@@ -121,7 +121,7 @@ bool vogl_trace_packet::compare(const vogl_trace_packet &other, bool deep) const
         }
     }
 
-    if (m_key_value_map != other.m_key_value_map)
+    if (get_key_value_map() != other.get_key_value_map())
         return false;
 
     return true;
@@ -244,13 +244,16 @@ bool vogl_trace_packet::check() const
 }
 
 //----------------------------------------------------------------------------------------------------------------------
-// vogl_trace_packet::deserialize
+// vogl_trace_packet_view::init
 //----------------------------------------------------------------------------------------------------------------------
-bool vogl_trace_packet::deserialize(const uint8 *pPacket_data, uint packet_data_buf_size, bool check_crc)
+bool vogl_trace_packet_view::init(const uint8 *pPacket_data, uint packet_data_buf_size, bool check_crc)
 {
     VOGL_FUNC_TRACER
 
-    reset();
+    clear();
+
+    if (packet_data_buf_size < sizeof(vogl_trace_gl_entrypoint_packet))
+        return false;
 
     const vogl_trace_gl_entrypoint_packet *pTrace_gl_entrypoint_packet = reinterpret_cast<const vogl_trace_gl_entrypoint_packet *>(pPacket_data);
 
@@ -271,91 +274,247 @@ bool vogl_trace_packet::deserialize(const uint8 *pPacket_data, uint packet_data_
         }
     }
 
-    m_packet = *reinterpret_cast<const vogl_trace_gl_entrypoint_packet *>(pTrace_gl_entrypoint_packet);
+    const vogl_trace_gl_entrypoint_packet &packet = *pTrace_gl_entrypoint_packet;
 
-    VOGL_ASSERT(m_packet.m_type == cTSPTGLEntrypoint);
+    VOGL_ASSERT(packet.m_type == cTSPTGLEntrypoint);
 
-    if (m_packet.m_size < sizeof(vogl_trace_gl_entrypoint_packet))
+    if ((packet.m_size < sizeof(vogl_trace_gl_entrypoint_packet)) || (packet.m_size > packet_data_buf_size))
         return false;
 
-    if (m_packet.m_entrypoint_id >= VOGL_NUM_ENTRYPOINTS)
+    if (packet.m_entrypoint_id >= VOGL_NUM_ENTRYPOINTS)
         return false;
 
-    uint entrypoint_index = m_packet.m_entrypoint_id;
+    uint entrypoint_index = packet.m_entrypoint_id;
     const gl_entrypoint_desc_t &entrypoint_desc = g_vogl_entrypoint_descs[entrypoint_index];
     const gl_entrypoint_param_desc_t *pParam_desc = &g_vogl_entrypoint_param_descs[entrypoint_index][0];
 
-    m_total_params = entrypoint_desc.m_num_params;
-    m_has_return_value = (entrypoint_desc.m_return_ctype != VOGL_VOID);
+    uint total_params = entrypoint_desc.m_num_params;
+    bool has_return_value = (entrypoint_desc.m_return_ctype != VOGL_VOID);
 
-    const uint total_params_to_deserialize = m_total_params + m_has_return_value;
+    const uint total_params_to_deserialize = total_params + has_return_value;
+    if (total_params_to_deserialize > cMaxParams)
+        return false;
 
     const uint8 *pExtra_packet_data = pPacket_data + sizeof(vogl_trace_gl_entrypoint_packet);
-    uint num_bytes_remaining = m_packet.m_size - sizeof(vogl_trace_gl_entrypoint_packet);
+    uint num_bytes_remaining = static_cast<uint>(packet.m_size - sizeof(vogl_trace_gl_entrypoint_packet));
 
-    if (m_packet.m_param_size)
+    if (packet.m_param_size)
     {
-        if (m_packet.m_param_size > num_bytes_remaining)
+        if (packet.m_param_size > num_bytes_remaining)
             return false;
 
+        m_pParam_data = pExtra_packet_data;
+
+        uint param_ofs = 0;
         for (uint param_index = 0; param_index < total_params_to_deserialize; ++param_index, ++pParam_desc)
         {
-            vogl_ctype_t param_ctype = (param_index >= m_total_params) ? entrypoint_desc.m_return_ctype : pParam_desc->m_ctype;
+            vogl_ctype_t param_ctype = (param_index >= total_params) ? entrypoint_desc.m_return_ctype : pParam_desc->m_ctype;
             uint param_size = (*m_pCTypes)[param_ctype].m_size;
 
             if (num_bytes_remaining < param_size)
                 return false;
 
-            m_param_ctype[param_index] = param_ctype;
-            VOGL_ASSERT(param_size <= cUINT8_MAX);
-            m_param_size[param_index] = param_size;
-
-            m_param_data[param_index] = 0;
-            memcpy(&m_param_data[param_index], pExtra_packet_data, param_size);
+            VOGL_ASSERT(param_size <= sizeof(uint64_t));
+            m_param_ofs[param_index] = static_cast<uint16>(param_ofs);
 
+            param_ofs += param_size;
             pExtra_packet_data += param_size;
             num_bytes_remaining -= param_size;
         }
     }
 
-    if (m_packet.m_client_memory_size)
+    if (packet.m_client_memory_size)
     {
-        if (m_packet.m_client_memory_size > num_bytes_remaining)
+        if (packet.m_client_memory_size > num_bytes_remaining)
             return false;
 
-        uint client_memory_descs_size = (total_params_to_deserialize * sizeof(client_memory_desc_t));
+        uint client_memory_descs_size = (total_params_to_deserialize * sizeof(vogl_trace_packet_client_memory_desc));
         if (num_bytes_remaining < client_memory_descs_size)
             return false;
 
-        memcpy(m_client_memory_descs, pExtra_packet_data, client_memory_descs_size);
+        m_pClient_memory_descs = pExtra_packet_data;
         pExtra_packet_data += client_memory_descs_size;
         num_bytes_remaining -= client_memory_descs_size;
 
-        if (client_memory_descs_size > m_packet.m_client_memory_size)
+        if (client_memory_descs_size > packet.m_client_memory_size)
             return false;
 
-        uint client_memory_vec_size = m_packet.m_client_memory_size - client_memory_descs_size;
+        uint client_memory_vec_size = packet.m_client_memory_size - client_memory_descs_size;
 
-        m_client_memory.append(pExtra_packet_data, client_memory_vec_size);
+        m_pClient_memory = pExtra_packet_data;
+        m_client_memory_size = client_memory_vec_size;
         pExtra_packet_data += client_memory_vec_size;
         num_bytes_remaining -= client_memory_vec_size;
+
+        for (uint param_index = 0; param_index < total_params_to_deserialize; ++param_index)
+        {
+            vogl_trace_packet_client_memory_desc desc;
+            memcpy(&desc, m_pClient_memory_descs + param_index * sizeof(desc), sizeof(desc));
+            if ((desc.m_vec_ofs >= 0) && ((static_cast<uint64_t>(desc.m_vec_ofs) + desc.m_data_size) > client_memory_vec_size))
+                return false;
+        }
     }
 
-    if (m_packet.m_name_value_map_size)
+    if (packet.m_name_value_map_size)
     {
-        if (m_packet.m_name_value_map_size > num_bytes_remaining)
+        if (packet.m_name_value_map_size > num_bytes_remaining)
             return false;
 
-        if (!m_key_value_map.deserialize_from_buffer(pExtra_packet_data, num_bytes_remaining, true, false))
-            return false;
+        m_pKey_value_map_data = pExtra_packet_data;
+        m_key_value_map_size = packet.m_name_value_map_size;
 
-        pExtra_packet_data += m_packet.m_name_value_map_size;
-        num_bytes_remaining -= m_packet.m_name_value_map_size;
+        pExtra_packet_data += packet.m_name_value_map_size;
+        num_bytes_remaining -= packet.m_name_value_map_size;
     }
 
     if (num_bytes_remaining)
+    {
+        m_pParam_data = NULL;
+        m_pClient_memory_descs = NULL;
+        m_pClient_memory = NULL;
+        m_client_memory_size = 0;
+        m_pKey_value_map_data = NULL;
+        m_key_value_map_size = 0;
+        return false;
+    }
+
+    m_pPacket = pTrace_gl_entrypoint_packet;
+    m_total_params = total_params;
+    m_has_return_value = has_return_value;
+
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_trace_packet_view::decode_key_value_map
+//----------------------------------------------------------------------------------------------------------------------
+bool vogl_trace_packet_view::decode_key_value_map(key_value_map &kvm) const
+{
+    VOGL_FUNC_TRACER
+
+    kvm.reset();
+
+    if (!m_key_value_map_size)
+        return true;
+
+    return kvm.deserialize_from_buffer(m_pKey_value_map_data, m_key_value_map_size, true, false) >= 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_trace_packet::vogl_trace_packet
+//----------------------------------------------------------------------------------------------------------------------
+vogl_trace_packet::vogl_trace_packet(const vogl_trace_packet &other)
+    : m_pCTypes(other.m_pCTypes),
+      m_total_params(0),
+      m_has_return_value(false),
+      m_is_valid(false),
+      m_pPending_key_value_map_data(NULL),
+      m_pending_key_value_map_size(0)
+{
+    VOGL_FUNC_TRACER
+
+    utils::zero_object(m_packet);
+
+    *this = other;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_trace_packet::operator=
+//----------------------------------------------------------------------------------------------------------------------
+vogl_trace_packet &vogl_trace_packet::operator=(const vogl_trace_packet &other)
+{
+    VOGL_FUNC_TRACER
+
+    if (this == &other)
+        return *this;
+
+    m_pCTypes = other.m_pCTypes;
+    m_packet = other.m_packet;
+    m_total_params = other.m_total_params;
+    m_has_return_value = other.m_has_return_value;
+    m_is_valid = other.m_is_valid;
+
+    memcpy(m_param_data, other.m_param_data, sizeof(m_param_data));
+    memcpy(m_param_size, other.m_param_size, sizeof(m_param_size));
+    memcpy(m_param_ctype, other.m_param_ctype, sizeof(m_param_ctype));
+    memcpy(m_client_memory_descs, other.m_client_memory_descs, sizeof(m_client_memory_descs));
+
+    m_client_memory = other.m_client_memory;
+    m_key_value_map = other.get_key_value_map();
+
+    m_pPending_key_value_map_data = NULL;
+    m_pending_key_value_map_size = 0;
+
+    return *this;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_trace_packet::deserialize
+//----------------------------------------------------------------------------------------------------------------------
+bool vogl_trace_packet::deserialize(const uint8 *pPacket_data, uint packet_data_buf_size, bool check_crc)
+{
+    VOGL_FUNC_TRACER
+
+    vogl_trace_packet_view view(m_pCTypes);
+    if (!view.init(pPacket_data, packet_data_buf_size, check_crc))
+    {
+        reset();
+        return false;
+    }
+
+    return deserialize(view, false);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_trace_packet::deserialize
+//----------------------------------------------------------------------------------------------------------------------
+bool vogl_trace_packet::deserialize(const vogl_trace_packet_view &view, bool defer_key_value_map)
+{
+    VOGL_FUNC_TRACER
+
+    reset();
+
+    if (!view.is_valid())
         return false;
 
+    m_packet = view.get_entrypoint_packet();
+
+    m_total_params = view.total_params();
+    m_has_return_value = view.has_return_value();
+
+    const uint total_params_to_deserialize = m_total_params + m_has_return_value;
+
+    if (m_packet.m_param_size)
+    {
+        for (uint param_index = 0; param_index < total_params_to_deserialize; ++param_index)
+        {
+            m_param_ctype[param_index] = view.get_param_ctype(param_index);
+            m_param_size[param_index] = static_cast<uint8>(view.get_param_size(param_index));
+            m_param_data[param_index] = view.get_param_data(param_index);
+        }
+    }
+
+    if (m_packet.m_client_memory_size)
+    {
+        for (uint param_index = 0; param_index < total_params_to_deserialize; ++param_index)
+            m_client_memory_descs[param_index] = view.get_client_memory_desc(param_index);
+
+        m_client_memory.append(view.get_client_memory(), view.get_client_memory_size());
+    }
+
+    if (view.has_key_value_map())
+    {
+        if (defer_key_value_map)
+        {
+            m_pPending_key_value_map_data = view.get_key_value_map_data();
+            m_pending_key_value_map_size = view.get_key_value_map_size();
+        }
+        else if (!view.decode_key_value_map(m_key_value_map))
+        {
+            return false;
+        }
+    }
+
     m_is_valid = true;
 
 //    VOGL_ASSERT(check());
@@ -363,6 +522,27 @@ bool vogl_trace_packet::deserialize(const uint8 *pPacket_data, uint packet_data_
     return true;
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_trace_packet::decode_pending_key_value_map
+//----------------------------------------------------------------------------------------------------------------------
+void vogl_trace_packet::decode_pending_key_value_map() const
+{
+    VOGL_FUNC_TRACER
+
+    const uint8 *pData = m_pPending_key_value_map_data;
+    uint data_size = m_pending_key_value_map_size;
+
+    m_pPending_key_value_map_data = NULL;
+    m_pending_key_value_map_size = 0;
+
+    m_key_value_map.reset();
+    if (m_key_value_map.deserialize_from_buffer(pData, data_size, true, false) < 0)
+    {
+        vogl_error_printf("%s: Failed deserializing key value map of call counter %" PRIu64 "\n", VOGL_FUNCTION_INFO_CSTR, m_packet.m_call_counter);
+        m_key_value_map.reset();
+    }
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 // vogl_trace_packet::deserialize
 //----------------------------------------------------------------------------------------------------------------------
@@ -380,6 +560,38 @@ bool vogl_trace_packet::serialize(data_stream &stream) const
 {
     VOGL_FUNC_TRACER
 
+    if (!serialize_to_packet_buf())
+        return false;
+
+    uint n = stream.write(m_packet_buf.get_ptr(), m_packet_buf.size());
+    if (n != m_packet_buf.size())
+        return false;
+
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_trace_packet::serialize
+// Swaps the serialized packet into buf, so buf's previous allocation gets reused as scratch space by the next call.
+//----------------------------------------------------------------------------------------------------------------------
+bool vogl_trace_packet::serialize(uint8_vec &buf) const
+{
+    VOGL_FUNC_TRACER
+
+    if (!serialize_to_packet_buf())
+        return false;
+
+    buf.swap(m_packet_buf);
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_trace_packet::serialize_to_packet_buf
+//----------------------------------------------------------------------------------------------------------------------
+bool vogl_trace_packet::serialize_to_packet_buf() const
+{
+    VOGL_FUNC_TRACER
+
     if (!m_is_valid)
         return false;
 
@@ -407,7 +619,7 @@ bool vogl_trace_packet::serialize(data_stream &stream) const
     uint client_memory_descs_size = (total_params_to_serialize * sizeof(client_memory_desc_t));
     packet.m_client_memory_size = client_memory_descs_size + m_client_memory.size();
 
-    uint64_t kvm_serialize_size = m_key_value_map.get_num_key_values() ? m_key_value_map.get_serialize_size(false) : 0;
+    uint64_t kvm_serialize_size = get_key_value_map().get_num_key_values() ? get_key_value_map().get_serialize_size(false) : 0;
     if (kvm_serialize_size > cUINT32_MAX)
         return false;
     packet.m_name_value_map_size = static_cast<uint32>(kvm_serialize_size);
@@ -444,7 +656,7 @@ bool vogl_trace_packet::serialize(data_stream &stream) const
         APPEND_TO_DST_BUF(m_client_memory.get_ptr(), m_client_memory.size());
     }
 
-    if (m_key_value_map.get_num_key_values())
+    if (get_key_value_map().get_num_key_values())
     {
         if (pDst_buf >= m_packet_buf.end())
         {
@@ -453,7 +665,7 @@ bool vogl_trace_packet::serialize(data_stream &stream) const
         }
 
         uint buf_remaining = static_cast<uint>(m_packet_buf.end() - pDst_buf);
-        int result = m_key_value_map.serialize_to_buffer(pDst_buf, buf_remaining, true, false);
+        int result = get_key_value_map().serialize_to_buffer(pDst_buf, buf_remaining, true, false);
         if (result != static_cast<int>(packet.m_name_value_map_size))
             return false;
 
@@ -470,26 +682,6 @@ bool vogl_trace_packet::serialize(data_stream &stream) const
 
     VOGL_ASSERT(pBuf_packet->full_validation(m_packet_buf.size()));
 
-    uint n = stream.write(pBuf_packet, m_packet_buf.size());
-    if (n != m_packet_buf.size())
-        return false;
-
-    return true;
-}
-
-//----------------------------------------------------------------------------------------------------------------------
-// vogl_trace_packet::serialize
-//----------------------------------------------------------------------------------------------------------------------
-bool vogl_trace_packet::serialize(uint8_vec &buf) const
-{
-    VOGL_FUNC_TRACER
-
-    dynamic_stream dyn_stream;
-    if (!dyn_stream.open(128))
-        return false;
-    if (!serialize(dyn_stream))
-        return false;
-    buf.swap(dyn_stream.get_buf());
     return true;
 }
 
@@ -549,7 +741,7 @@ bool vogl_trace_packet::json_serialize(json_node &node, const json_serialize_par
 
         dynamic_string key_str, value_str;
 
-        for (key_value_map::const_iterator it = m_key_value_map.begin(); it != m_key_value_map.end(); ++it)
+        for (key_value_map::const_iterator it = get_key_value_map().begin(); it != get_key_value_map().end(); ++it)
         {
             const value &key = it->first;
             const value &val = it->second;
@@ -2138,8 +2330,8 @@ bool vogl_trace_packet::fixup_manually_edited_params(gl_entrypoint_id_t gl_entry
             {
                 for (GLsizei i = 0; i < count; i++)
                 {
-                    key_value_map::const_iterator it = m_key_value_map.find(i);
-                    if (it == m_key_value_map.end())
+                    key_value_map::const_iterator it = get_key_value_map().find(i);
+                    if (it == get_key_value_map().end())
                     {
                         vogl_error_printf("GL func %s call counter %" PRIu64 ": Failed finding shader source blob string in GL key value map\n", pGL_func_name, cur_call_counter);
                         return false;
@@ -107,6 +107,275 @@ public:
     uint m_num_elements;
 };
 
+//----------------------------------------------------------------------------------------------------------------------
+// struct vogl_trace_packet_client_memory_desc
+// Serialized after the param data of GL entrypoint packets, one per param (plus the return value).
+//----------------------------------------------------------------------------------------------------------------------
+#pragma pack(push)
+#pragma pack(1)
+struct vogl_trace_packet_client_memory_desc
+{
+    int32 m_vec_ofs;
+    uint32 m_data_size;
+    uint8 m_pointee_ctype; // vogl_ctype_t
+
+    inline void clear()
+    {
+        m_vec_ofs = -1;
+        m_data_size = 0;
+        m_pointee_ctype = VOGL_VOID;
+    }
+};
+#pragma pack(pop)
+
+//----------------------------------------------------------------------------------------------------------------------
+// class vogl_trace_packet_view
+// Non-owning view of a serialized GL entrypoint packet. init() only validates the packet and locates its params, client
+// memory and key/value map, nothing is copied and no memory is allocated. The packet data must stay valid (and unchanged)
+// while the view is used.
+//----------------------------------------------------------------------------------------------------------------------
+class vogl_trace_packet_view
+{
+public:
+    enum
+    {
+        cMaxParams = 32
+    };
+
+    inline vogl_trace_packet_view(const vogl_ctypes *pCtypes)
+        : m_pCTypes(pCtypes)
+    {
+        VOGL_FUNC_TRACER
+
+        clear();
+    }
+
+    inline void clear()
+    {
+        m_pPacket = NULL;
+        m_pParam_data = NULL;
+        m_pClient_memory_descs = NULL;
+        m_pClient_memory = NULL;
+        m_client_memory_size = 0;
+        m_pKey_value_map_data = NULL;
+        m_key_value_map_size = 0;
+        m_total_params = 0;
+        m_has_return_value = false;
+    }
+
+    void set_ctypes(const vogl_ctypes *pCtypes)
+    {
+        m_pCTypes = pCtypes;
+    }
+
+    const vogl_ctypes *get_ctypes() const
+    {
+        return m_pCTypes;
+    }
+
+    bool init(const uint8 *pPacket_data, uint packet_data_buf_size, bool check_crc);
+
+    inline bool is_valid() const
+    {
+        return m_pPacket != NULL;
+    }
+
+    inline const vogl_trace_gl_entrypoint_packet &get_entrypoint_packet() const
+    {
+        VOGL_ASSERT(m_pPacket);
+        return *m_pPacket;
+    }
+
+    inline gl_entrypoint_id_t get_entrypoint_id() const
+    {
+        return static_cast<gl_entrypoint_id_t>(m_pPacket->m_entrypoint_id);
+    }
+    inline const gl_entrypoint_desc_t &get_entrypoint_desc() const
+    {
+        return g_vogl_entrypoint_descs[m_pPacket->m_entrypoint_id];
+    }
+
+    inline uint64_t get_context_handle() const
+    {
+        return m_pPacket->m_context_handle;
+    }
+    inline uint64_t get_call_counter() const
+    {
+        return m_pPacket->m_call_counter;
+    }
+    inline uint64_t get_thread_id() const
+    {
+        return m_pPacket->m_thread_id;
+    }
+
+    inline uint total_params() const
+    {
+        return m_total_params;
+    }
+    inline bool has_return_value() const
+    {
+        return m_has_return_value;
+    }
+
+    // param accessors - param_index may be total_params() to access the return value
+    inline vogl_ctype_t get_param_ctype(uint param_index) const
+    {
+        VOGL_ASSERT(param_index < m_total_params + m_has_return_value);
+        return (param_index >= m_total_params) ? get_entrypoint_desc().m_return_ctype : g_vogl_entrypoint_param_descs[m_pPacket->m_entrypoint_id][param_index].m_ctype;
+    }
+    inline const vogl_ctype_desc_t &get_param_ctype_desc(uint param_index) const
+    {
+        return (*m_pCTypes)[get_param_ctype(param_index)];
+    }
+    inline uint get_param_size(uint param_index) const
+    {
+        return get_param_ctype_desc(param_index).m_size;
+    }
+    inline const gl_entrypoint_param_desc_t &get_param_desc(uint param_index) const
+    {
+        VOGL_ASSERT(param_index < m_total_params);
+        return g_vogl_entrypoint_param_descs[m_pPacket->m_entrypoint_id][param_index];
+    }
+    inline vogl_namespace_t get_param_namespace(uint param_index) const
+    {
+        return get_param_desc(param_index).m_namespace;
+    }
+
+    // Returns the param's value zero extended to 64-bits (or 0 if the packet has no param data).
+    inline uint64_t get_param_data(uint param_index) const
+    {
+        VOGL_ASSERT(param_index < m_total_params + m_has_return_value);
+
+        uint64_t data = 0;
+        if (m_pParam_data)
+            memcpy(&data, m_pParam_data + m_param_ofs[param_index], get_param_size(param_index));
+        return data;
+    }
+
+    template <typename T>
+    inline T get_param_value(uint param_index) const
+    {
+        VOGL_ASSERT(sizeof(T) <= sizeof(uint64_t));
+        VOGL_ASSUME(!Loki::type_is_ptr<T>::result);
+        VOGL_ASSERT(!get_param_ctype_desc(param_index).m_is_pointer);
+
+        uint64_t data = get_param_data(param_index);
+        return *reinterpret_cast<const T *>(&data);
+    }
+
+    inline uint64_t get_return_value_data() const
+    {
+        VOGL_ASSERT(m_has_return_value);
+        return get_param_data(m_total_params);
+    }
+    inline vogl_ctype_t get_return_value_ctype() const
+    {
+        VOGL_ASSERT(m_has_return_value);
+        return get_entrypoint_desc().m_return_ctype;
+    }
+    inline vogl_namespace_t get_return_value_namespace() const
+    {
+        return get_entrypoint_desc().m_return_namespace;
+    }
+
+    // client memory accessors - param_index may be total_params() to access the return value's client memory
+    inline vogl_trace_packet_client_memory_desc get_client_memory_desc(uint param_index) const
+    {
+        VOGL_ASSERT(param_index < m_total_params + m_has_return_value);
+
+        vogl_trace_packet_client_memory_desc desc;
+        if (m_pClient_memory_descs)
+            memcpy(&desc, m_pClient_memory_descs + param_index * sizeof(vogl_trace_packet_client_memory_desc), sizeof(desc));
+        else
+            desc.clear();
+        return desc;
+    }
+
+    inline bool has_param_client_memory(uint param_index) const
+    {
+        return get_client_memory_desc(param_index).m_vec_ofs >= 0;
+    }
+    inline const void *get_param_client_memory_ptr(uint param_index) const
+    {
+        int ofs = get_client_memory_desc(param_index).m_vec_ofs;
+        return (ofs < 0) ? NULL : (m_pClient_memory + ofs);
+    }
+    inline uint get_param_client_memory_data_size(uint param_index) const
+    {
+        return get_client_memory_desc(param_index).m_data_size;
+    }
+    inline vogl_ctype_t get_param_client_memory_ctype(uint param_index) const
+    {
+        return static_cast<vogl_ctype_t>(get_client_memory_desc(param_index).m_pointee_ctype);
+    }
+
+    template <typename T>
+    inline const T *get_param_client_memory(uint param_index) const
+    {
+        VOGL_ASSUME(!Loki::type_is_ptr<T>::result);
+        return static_cast<const T *>(get_param_client_memory_ptr(param_index));
+    }
+
+    inline const vogl_client_memory_array get_param_client_memory_array(uint param_index) const
+    {
+        vogl_trace_packet_client_memory_desc desc(get_client_memory_desc(param_index));
+
+        vogl_ctype_t ctype = static_cast<vogl_ctype_t>(desc.m_pointee_ctype);
+        const void *pPtr = (desc.m_vec_ofs < 0) ? NULL : (m_pClient_memory + desc.m_vec_ofs);
+        uint element_size = (*m_pCTypes)[ctype].m_size;
+        if (element_size <= 0)
+            return vogl_client_memory_array(ctype, pPtr, desc.m_data_size, 1);
+
+        VOGL_ASSERT((desc.m_data_size % element_size) == 0);
+        return vogl_client_memory_array(ctype, pPtr, element_size, desc.m_data_size / element_size);
+    }
+
+    // All client memory blocks, in the order they were serialized.
+    inline const uint8 *get_client_memory() const
+    {
+        return m_pClient_memory;
+    }
+    inline uint get_client_memory_size() const
+    {
+        return m_client_memory_size;
+    }
+
+    // key/value map accessors - the map is only decoded on request
+    inline bool has_key_value_map() const
+    {
+        return m_key_value_map_size != 0;
+    }
+    inline const uint8 *get_key_value_map_data() const
+    {
+        return m_pKey_value_map_data;
+    }
+    inline uint get_key_value_map_size() const
+    {
+        return m_key_value_map_size;
+    }
+
+    // Resets kvm and decodes the packet's key/value map (if any) into it.
+    bool decode_key_value_map(key_value_map &kvm) const;
+
+private:
+    const vogl_ctypes *m_pCTypes;
+
+    const vogl_trace_gl_entrypoint_packet *m_pPacket;
+
+    const uint8 *m_pParam_data;
+    uint16 m_param_ofs[cMaxParams];
+
+    const uint8 *m_pClient_memory_descs;
+    const uint8 *m_pClient_memory;
+    uint m_client_memory_size;
+
+    const uint8 *m_pKey_value_map_data;
+    uint m_key_value_map_size;
+
+    uint m_total_params;
+    bool m_has_return_value;
+};
+
 //----------------------------------------------------------------------------------------------------------------------
 // class vogl_trace_packet
 // Keep this in sync with class vogl_entrypoint_serializer
@@ -119,7 +388,9 @@ public:
         : m_pCTypes(pCtypes),
           m_total_params(0),
           m_has_return_value(false),
-          m_is_valid(false)
+          m_is_valid(false),
+          m_pPending_key_value_map_data(NULL),
+          m_pending_key_value_map_size(0)
     {
         VOGL_FUNC_TRACER
 
@@ -128,6 +399,10 @@ public:
         utils::zero_object(m_packet);
     }
 
+    // Copies resolve any key/value map deferred by deserialize(), so the copy never refers to the source's packet data.
+    vogl_trace_packet(const vogl_trace_packet &other);
+    vogl_trace_packet &operator=(const vogl_trace_packet &other);
+
     inline void clear()
     {
         VOGL_FUNC_TRACER
@@ -157,6 +432,9 @@ public:
 
         m_client_memory.resize(0);
         m_key_value_map.reset();
+
+        m_pPending_key_value_map_data = NULL;
+        m_pending_key_value_map_size = 0;
     }
 
     void set_ctypes(const vogl_ctypes *pCtypes)
@@ -186,6 +464,11 @@ public:
     bool deserialize(const uint8 *pPacket_data, uint packet_data_buf_size, bool check_crc);
     bool deserialize(const uint8_vec &packet_buf, bool check_crc);
 
+    // Copies the params and client memory out of view (reusing this packet's buffers). If defer_key_value_map is true
+    // the key/value map isn't decoded until get_key_value_map() is first called, so the view's packet data must stay
+    // valid until then (or until the packet is reset or deserialized again).
+    bool deserialize(const vogl_trace_packet_view &view, bool defer_key_value_map);
+
     class json_serialize_params
     {
     public:
@@ -265,10 +548,14 @@ public:
 
     inline const key_value_map &get_key_value_map() const
     {
+        if (m_pPending_key_value_map_data)
+            decode_pending_key_value_map();
         return m_key_value_map;
     }
     inline key_value_map &get_key_value_map()
     {
+        if (m_pPending_key_value_map_data)
+            decode_pending_key_value_map();
         return m_key_value_map;
     }
 
@@ -291,6 +578,8 @@ public:
 
         m_client_memory.resize(0);
         m_key_value_map.reset();
+        m_pPending_key_value_map_data = NULL;
+        m_pending_key_value_map_size = 0;
 
         m_packet.init();
         m_packet.init_rnd();
@@ -440,7 +729,7 @@ public:
         VOGL_FUNC_TRACER
 
         VOGL_ASSERT(m_is_valid);
-        return m_key_value_map.insert(key, value).second;
+        return get_key_value_map().insert(key, value).second;
     }
 
     // ownership of blob's buffer is taken
@@ -449,7 +738,7 @@ public:
         VOGL_FUNC_TRACER
 
         VOGL_ASSERT(m_is_valid);
-        value_to_value_hash_map::insert_result res(m_key_value_map.insert(key, value()));
+        value_to_value_hash_map::insert_result res(get_key_value_map().insert(key, value()));
         (res.first)->second.set_blob_take_ownership(blob);
         return res.second;
     }
@@ -459,7 +748,7 @@ public:
         VOGL_FUNC_TRACER
 
         VOGL_ASSERT(m_is_valid);
-        value_to_value_hash_map::insert_result res(m_key_value_map.insert(key, value()));
+        value_to_value_hash_map::insert_result res(get_key_value_map().insert(key, value()));
         (res.first)->second.set_blob(static_cast<const uint8 *>(pData), data_size);
         return res.second;
     }
@@ -469,7 +758,7 @@ public:
         VOGL_FUNC_TRACER
 
         VOGL_ASSERT(m_is_valid);
-        value_to_value_hash_map::insert_result res(m_key_value_map.insert(key, value()));
+        value_to_value_hash_map::insert_result res(get_key_value_map().insert(key, value()));
         (res.first)->second.set_json_document(doc);
         return res.second;
     }
@@ -757,29 +1046,22 @@ private:
 
     uint8_vec m_client_memory;
 
-    key_value_map m_key_value_map;
+    mutable key_value_map m_key_value_map;
 
-#pragma pack(push)
-#pragma pack(1)
-    struct client_memory_desc_t
-    {
-        int32 m_vec_ofs;
-        uint32 m_data_size;
-        uint8 m_pointee_ctype; // vogl_ctype_t
+    // Serialized key/value map not decoded yet by deserialize(view, true), points into the caller's packet data.
+    mutable const uint8 *m_pPending_key_value_map_data;
+    mutable uint m_pending_key_value_map_size;
 
-        inline void clear()
-        {
-            m_vec_ofs = -1;
-            m_data_size = 0;
-            m_pointee_ctype = VOGL_VOID;
-        }
-    };
-#pragma pack(pop)
+    typedef vogl_trace_packet_client_memory_desc client_memory_desc_t;
 
     client_memory_desc_t m_client_memory_descs[cMaxParams];
 
     mutable uint8_vec m_packet_buf;
 
+    bool serialize_to_packet_buf() const;
+
+    void decode_pending_key_value_map() const;
+
     bool validate_value_conversion(uint dest_type_size, uint dest_type_loki_type_flags, int param_index) const;
 
     static bool should_always_write_as_blob_file(const char *pFunc_name);
@@ -29,7 +29,7 @@
 #include "vogl_miniz.h"
 #include "vogl_port.h"
 
-#define VOGL_TRACE_FILE_VERSION 0x0106
+#define VOGL_TRACE_FILE_VERSION 0x0107
 #define VOGL_TRACE_FILE_MINIMUM_COMPATIBLE_VERSION 0x0106
 
 #define VOGL_TRACE_LINK_PROGRAM_UNIFORM_DESC_KEY_OFS 0xF0000
@@ -141,6 +141,12 @@ struct vogl_trace_stream_packet_base
     }
 };
 
+enum vogl_trace_stream_sof_flags_t
+{
+    // The packets following the SOF packet are stored in vogl_trace_stream_block_header blocks.
+    cTSFCompressedPacketBlocks = 1
+};
+
 struct vogl_trace_stream_start_of_file_packet
 {
     enum
@@ -153,7 +159,7 @@ struct vogl_trace_stream_start_of_file_packet
 
     uint16 m_version; // must immediately follow m_crc!
     uint8 m_pointer_sizes;
-    uint8 m_unused;
+    uint8 m_flags; // vogl_trace_stream_sof_flags_t, was unused (always 0) before version 0x0107
 
     enum
     {
@@ -222,6 +228,74 @@ struct vogl_trace_stream_start_of_file_packet
     }
 };
 
+enum vogl_trace_stream_block_codec_t
+{
+    cTSBCStored = 0,
+    cTSBCDeflate = 1,
+    cTSBCTotalCodecs
+};
+
+// In compressed trace files the packet stream is split into independently compressed blocks, each one immediately
+// followed by m_comp_size bytes of data which decompress to m_uncomp_size bytes of packet data. Packets may straddle
+// blocks, but the writer always starts a new block after a swap, so every frame begins at the start of a block.
+struct vogl_trace_stream_block_header
+{
+    enum
+    {
+        cBlockPrefix = 0xD1C71603,
+
+        // Limited by the packet offset encoding used by vogl_trace_block_reader_stream.
+        cMaxUncompSize = 16 * 1024 * 1024
+    };
+
+    uint32 m_prefix;
+    uint32 m_crc; // CRC32 of all header data following this member
+
+    uint8 m_codec; // must immediately follow m_crc!
+    uint8 m_unused[3];
+    uint32 m_comp_size;
+    uint32 m_uncomp_size;
+    uint32 m_uncomp_crc; // CRC32 of the uncompressed data
+
+    inline void init(uint8 codec, uint32 comp_size, uint32 uncomp_size, uint32 uncomp_crc)
+    {
+        memset(this, 0, sizeof(*this));
+
+        m_prefix = cBlockPrefix;
+        m_codec = codec;
+        m_comp_size = comp_size;
+        m_uncomp_size = uncomp_size;
+        m_uncomp_crc = uncomp_crc;
+    }
+
+    uint32 compute_crc() const
+    {
+        return (uint32)mz_crc32(MZ_CRC32_INIT, reinterpret_cast<const uint8 *>(this) + (uint32)VOGL_OFFSETOF(vogl_trace_stream_block_header, m_codec), sizeof(*this) - (uint32)VOGL_OFFSETOF(vogl_trace_stream_block_header, m_codec));
+    }
+
+    inline void finalize()
+    {
+        m_crc = compute_crc();
+    }
+
+    inline bool full_validation() const
+    {
+        if (m_prefix != cBlockPrefix)
+            return false;
+
+        if (m_codec >= cTSBCTotalCodecs)
+            return false;
+
+        if ((!m_uncomp_size) || (m_uncomp_size > static_cast<uint32>(cMaxUncompSize)))
+            return false;
+
+        if ((m_codec == cTSBCStored) && (m_comp_size != m_uncomp_size))
+            return false;
+
+        return compute_crc() == m_crc;
+    }
+};
+
 #define VOGL_RETURN_PARAM_INDEX 255
 
 // GL entrypoint packets contain a fixed size struct vogl_trace_gl_entrypoint_packet, immediately
@@ -114,6 +114,13 @@ namespace vogl
         VOGL_ASSERT((reinterpret_cast<ptr_bits_t>(pDest) & 3) == 0);
         return InterlockedExchangeAdd(pDest, val);
     }
+
+    // Returns the original value.
+    inline atomic64_t atomic_exchange_add64(atomic64_t volatile *pDest, atomic64_t val)
+    {
+        VOGL_ASSERT((reinterpret_cast<ptr_bits_t>(pDest) & 7) == 0);
+        return InterlockedExchangeAdd64(pDest, val);
+    }
 #elif VOGL_USE_GCC_ATOMIC_BUILTINS
     typedef volatile long atomic32_t;
     typedef long nonvolatile_atomic32_t;
@@ -168,6 +175,13 @@ namespace vogl
         VOGL_ASSERT((reinterpret_cast<ptr_bits_t>(pDest) & 3) == 0);
         return __sync_fetch_and_add(pDest, val);
     }
+
+    // Returns the original value.
+    inline nonvolatile_atomic64_t atomic_exchange_add64(atomic64_t volatile *pDest, atomic64_t val)
+    {
+        VOGL_ASSERT((reinterpret_cast<ptr_bits_t>(pDest) & 7) == 0);
+        return __sync_fetch_and_add(pDest, val);
+    }
 #else
 #define VOGL_NO_ATOMICS 1
 
@@ -226,6 +240,14 @@ namespace vogl
         *pDest += val;
         return cur;
     }
+
+    inline atomic64_t atomic_exchange_add64(atomic64_t volatile *pDest, atomic64_t val)
+    {
+        VOGL_ASSERT((reinterpret_cast<ptr_bits_t>(pDest) & 7) == 0);
+        atomic64_t cur = *pDest;
+        *pDest += val;
+        return cur;
+    }
 #endif
 
 } // namespace vogl
@@ -134,6 +134,25 @@ namespace vogl
 
         return true;
     }
+
+    bool file_utils::get_file_size_and_modified_time(const char *pFilename, uint64_t &file_size, uint64_t &modified_time)
+    {
+        file_size = 0;
+        modified_time = 0;
+
+        WIN32_FILE_ATTRIBUTE_DATA attr;
+
+        if (0 == GetFileAttributesExA(pFilename, GetFileExInfoStandard, &attr))
+            return false;
+
+        if (attr.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+            return false;
+
+        file_size = static_cast<uint64_t>(attr.nFileSizeLow) | (static_cast<uint64_t>(attr.nFileSizeHigh) << 32U);
+        modified_time = static_cast<uint64_t>(attr.ftLastWriteTime.dwLowDateTime) | (static_cast<uint64_t>(attr.ftLastWriteTime.dwHighDateTime) << 32U);
+
+        return true;
+    }
 #elif defined(COMPILER_GCCLIKE)
     bool file_utils::is_read_only(const char *pFilename)
     {
@@ -193,6 +212,21 @@ namespace vogl
         file_size = stat_buf.st_size;
         return true;
     }
+
+    bool file_utils::get_file_size_and_modified_time(const char *pFilename, uint64_t &file_size, uint64_t &modified_time)
+    {
+        file_size = 0;
+        modified_time = 0;
+        struct stat64 stat_buf;
+        int result = stat64(pFilename, &stat_buf);
+        if (result)
+            return false;
+        if (!S_ISREG(stat_buf.st_mode))
+            return false;
+        file_size = stat_buf.st_size;
+        modified_time = static_cast<uint64_t>(stat_buf.st_mtim.tv_sec) * 1000000000ULL + stat_buf.st_mtim.tv_nsec;
+        return true;
+    }
 #else
     bool file_utils::is_read_only(const char *pFilename)
     {
@@ -237,6 +271,12 @@ namespace vogl
         vogl_fclose(pFile);
         return true;
     }
+
+    bool file_utils::get_file_size_and_modified_time(const char *pFilename, uint64_t &file_size, uint64_t &modified_time)
+    {
+        modified_time = 0;
+        return get_file_size(pFilename, file_size);
+    }
 #endif
 
     bool file_utils::get_file_size(const char *pFilename, uint32 &file_size)
@@ -45,6 +45,8 @@ namespace vogl
         static bool does_dir_exist(const char *pDir);
         static bool get_file_size(const char *pFilename, uint64_t &file_size);
         static bool get_file_size(const char *pFilename, uint32 &file_size);
+        // modified_time is only meaningful for comparing against other values returned by this function.
+        static bool get_file_size_and_modified_time(const char *pFilename, uint64_t &file_size, uint64_t &modified_time);
         static void delete_file(const char *pFilename);
 
         static bool is_path_separator(char c);
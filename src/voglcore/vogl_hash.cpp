@@ -29,6 +29,17 @@
 // Also see http://www.concentric.net/~Ttwang/tech/inthash.htm,
 // http://burtleburtle.net/bob/hash/integer.html
 #include "vogl_core.h"
+#include "vogl_rand.h"
+#include "vogl_timer.h"
+#include "vogl_threading.h"
+
+#if defined(COMPILER_GCCLIKE) && (defined(__x86_64__) || defined(__i386__))
+#define VOGL_HASH_X86_KERNELS 1
+#include <cpuid.h>
+#include <immintrin.h>
+#else
+#define VOGL_HASH_X86_KERNELS 0
+#endif
 
 #undef get16bits
 #if (defined(COMPILER_GCCLIKE) && defined(__i386__)) || defined(__WATCOMC__) || defined(COMPILER_MSVC) || defined(__BORLANDC__) || defined(__TURBOC__)
@@ -67,6 +78,9 @@ namespace vogl
             DEFINE_WELL_KNOWN_STRING_HASH("flushed_ranges"),
             DEFINE_WELL_KNOWN_STRING_HASH("explicit_flush"),
             DEFINE_WELL_KNOWN_STRING_HASH("writable_map"),
+            DEFINE_WELL_KNOWN_STRING_HASH("sparse_map"),
+            DEFINE_WELL_KNOWN_STRING_HASH("sparse_ranges"),
+            DEFINE_WELL_KNOWN_STRING_HASH("sparse_bytes"),
             DEFINE_WELL_KNOWN_STRING_HASH("start"),
             DEFINE_WELL_KNOWN_STRING_HASH("end"),
             DEFINE_WELL_KNOWN_STRING_HASH("first_vertex_ofs"),
@@ -141,44 +155,321 @@ namespace vogl
     // Public domain code originally from http://svn.r-project.org/R/trunk/src/extra/xz/check/crc64_small.c
     uint64_t g_crc64_table[256];
 
-    void crc64_init()
+    // g_crc64_table extended for slicing-by-8: s_crc64_slice_table[k][b] is the CRC of byte b followed by k zero bytes.
+    static uint64_t s_crc64_slice_table[8][256];
+
+    // PCLMULQDQ folding constants, see crc64_init().
+    static uint64_t s_crc64_fold_128[2];
+    static uint64_t s_crc64_fold_512[2];
+
+    static crc64_kernel_t s_crc64_kernel = cCRC64KernelBytewise;
+    static sum64_kernel_t s_sum64_kernel = cSum64KernelScalar;
+
+    static const uint64_t g_crc64_poly64 = 0xC96C5795D7870F42ULL;
+
+    static uint64_t crc64_reverse_bits(uint64_t v)
+    {
+        uint64_t r = 0;
+        for (uint i = 0; i < 64; i++, v >>= 1)
+            r = (r << 1) | (v & 1);
+        return r;
+    }
+
+    // Returns x^n mod P, bit reflected like the CRC register (bit i holds the coefficient of x^(63-i)).
+    static uint64_t crc64_reflected_xpow_mod(uint n)
+    {
+        // Work unreflected, then reverse the bits.
+        const uint64_t poly = crc64_reverse_bits(g_crc64_poly64);
+
+        uint64_t r = 1;
+        for (uint i = 0; i < n; i++)
+            r = (r << 1) ^ ((r >> 63) ? poly : 0);
+
+        return crc64_reverse_bits(r);
+    }
+
+#if VOGL_HASH_X86_KERNELS
+    static void get_x86_cpu_features(bool &has_pclmul, bool &has_avx2)
     {
-        static const uint64_t poly64 = 0xC96C5795D7870F42ULL;
+        has_pclmul = false;
+        has_avx2 = false;
+
+        uint eax = 0, ebx = 0, ecx = 0, edx = 0;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+            return;
 
+        has_pclmul = ((ecx & bit_PCLMUL) != 0) && ((edx & bit_SSE2) != 0);
+
+        // AVX2 also needs the OS to save the YMM registers.
+        bool has_osxsave = (ecx & bit_OSXSAVE) != 0;
+        bool has_avx = (ecx & bit_AVX) != 0;
+        if ((!has_osxsave) || (!has_avx) || (__get_cpuid_max(0, NULL) < 7))
+            return;
+
+        uint xcr0_lo = 0, xcr0_hi = 0;
+        __asm__ __volatile__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+        if ((xcr0_lo & 6) != 6)
+            return;
+
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        has_avx2 = (ebx & bit_AVX2) != 0;
+    }
+#endif
+
+    static void crc64_init_tables()
+    {
         for (size_t b = 0; b < 256; ++b)
         {
             uint64_t r = b;
             for (size_t i = 0; i < 8; ++i)
             {
                 if (r & 1)
-                    r = (r >> 1) ^ poly64;
+                    r = (r >> 1) ^ g_crc64_poly64;
                 else
                     r >>= 1;
             }
 
             g_crc64_table[b] = r;
+            s_crc64_slice_table[0][b] = r;
         }
 
-        return;
+        for (uint k = 1; k < 8; k++)
+            for (uint b = 0; b < 256; b++)
+                s_crc64_slice_table[k][b] = (s_crc64_slice_table[k - 1][b] >> 8) ^ g_crc64_table[s_crc64_slice_table[k - 1][b] & 0xFF];
+
+        // Folding a 128-bit block hi:lo forward by D bits multiplies hi by x^(D+64) and lo by x^D. Carry-less multiplies
+        // of reflected values come out multiplied by an extra x, so the constants are one power lower.
+        s_crc64_fold_128[0] = crc64_reflected_xpow_mod(128 + 64 - 1);
+        s_crc64_fold_128[1] = crc64_reflected_xpow_mod(128 - 1);
+        s_crc64_fold_512[0] = crc64_reflected_xpow_mod(512 + 64 - 1);
+        s_crc64_fold_512[1] = crc64_reflected_xpow_mod(512 - 1);
+
+        s_crc64_kernel = is_crc64_kernel_supported(cCRC64KernelPCLMUL) ? cCRC64KernelPCLMUL : cCRC64KernelSlicing8;
     }
 
-    uint64_t calc_crc64(uint64_t crc, const uint8 *buf, size_t size)
+    static void sum64_init()
     {
-        if (!g_crc64_table[0])
-            crc64_init();
+        if (is_sum64_kernel_supported(cSum64KernelAVX2))
+            s_sum64_kernel = cSum64KernelAVX2;
+        else if (is_sum64_kernel_supported(cSum64KernelSSE2))
+            s_sum64_kernel = cSum64KernelSSE2;
+        else
+            s_sum64_kernel = cSum64KernelScalar;
+    }
 
-        crc = ~crc;
+    static void gear_table_init();
+
+    static void hash_tables_initialize()
+    {
+        crc64_init_tables();
+        sum64_init();
+        gear_table_init();
+    }
 
+    // The tables are used from worker threads (blob compression, parallel dumps), so they're set up exactly once
+    // the same way vogl_core_init() is.
+    static void hash_tables_init()
+    {
+#ifndef _MSC_VER
+        static pthread_once_t s_hash_tables_once = PTHREAD_ONCE_INIT;
+        pthread_once(&s_hash_tables_once, hash_tables_initialize);
+#else
+        static atomic32_t s_hash_tables_init;
+        if (s_hash_tables_init == 2)
+            return;
+
+        atomic32_t val = atomic_compare_exchange32(&s_hash_tables_init, 1, 0);
+        if (0 == val)
+        {
+            hash_tables_initialize();
+            atomic_increment32(&s_hash_tables_init);
+        }
+        else
+        {
+            while (2 != atomic_compare_exchange32(&s_hash_tables_init, 2, 2))
+                ;
+        }
+#endif
+    }
+
+    void crc64_init()
+    {
+        hash_tables_init();
+    }
+
+    // Raw kernels: the CRC is passed in and returned inverted, and size can be anything.
+    static uint64_t crc64_bytewise(uint64_t crc, const uint8 *buf, size_t size)
+    {
         while (size != 0)
         {
             crc = g_crc64_table[*buf++ ^ (crc & 0xFF)] ^ (crc >> 8);
             --size;
         }
 
+        return crc;
+    }
+
+    static uint64_t crc64_slicing8(uint64_t crc, const uint8 *buf, size_t size)
+    {
+#if VOGL_LITTLE_ENDIAN_CPU
+        while ((size) && (reinterpret_cast<uintptr_t>(buf) & 7))
+        {
+            crc = g_crc64_table[*buf++ ^ (crc & 0xFF)] ^ (crc >> 8);
+            --size;
+        }
+
+        while (size >= 8)
+        {
+            uint64_t v;
+            memcpy(&v, buf, sizeof(v));
+            crc ^= v;
+
+            crc = s_crc64_slice_table[7][crc & 0xFF] ^
+                  s_crc64_slice_table[6][(crc >> 8) & 0xFF] ^
+                  s_crc64_slice_table[5][(crc >> 16) & 0xFF] ^
+                  s_crc64_slice_table[4][(crc >> 24) & 0xFF] ^
+                  s_crc64_slice_table[3][(crc >> 32) & 0xFF] ^
+                  s_crc64_slice_table[2][(crc >> 40) & 0xFF] ^
+                  s_crc64_slice_table[1][(crc >> 48) & 0xFF] ^
+                  s_crc64_slice_table[0][crc >> 56];
+
+            buf += 8;
+            size -= 8;
+        }
+#endif
+
+        return crc64_bytewise(crc, buf, size);
+    }
+
+#if VOGL_HASH_X86_KERNELS
+    __attribute__((target("sse2,pclmul")))
+    static inline __m128i crc64_fold(__m128i x, __m128i k)
+    {
+        return _mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00), _mm_clmulepi64_si128(x, k, 0x11));
+    }
+
+    // Folds 64 bytes at a time into four 128-bit lanes, then the lanes into one, then lets the table kernel reduce the
+    // last 16 bytes (the CRC of a block with a zero CRC is the block mod P).
+    __attribute__((target("sse2,pclmul")))
+    static uint64_t crc64_pclmul(uint64_t crc, const uint8 *buf, size_t size)
+    {
+        if (size < 128)
+            return crc64_slicing8(crc, buf, size);
+
+        const __m128i k128 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s_crc64_fold_128));
+        const __m128i k512 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s_crc64_fold_512));
+
+        __m128i x0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf));
+        __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf + 16));
+        __m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf + 32));
+        __m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf + 48));
+        x0 = _mm_xor_si128(x0, _mm_loadl_epi64(reinterpret_cast<const __m128i *>(&crc)));
+        buf += 64;
+        size -= 64;
+
+        while (size >= 64)
+        {
+            x0 = _mm_xor_si128(crc64_fold(x0, k512), _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf)));
+            x1 = _mm_xor_si128(crc64_fold(x1, k512), _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf + 16)));
+            x2 = _mm_xor_si128(crc64_fold(x2, k512), _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf + 32)));
+            x3 = _mm_xor_si128(crc64_fold(x3, k512), _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf + 48)));
+            buf += 64;
+            size -= 64;
+        }
+
+        __m128i x = _mm_xor_si128(crc64_fold(x0, k128), x1);
+        x = _mm_xor_si128(crc64_fold(x, k128), x2);
+        x = _mm_xor_si128(crc64_fold(x, k128), x3);
+
+        while (size >= 16)
+        {
+            x = _mm_xor_si128(crc64_fold(x, k128), _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf)));
+            buf += 16;
+            size -= 16;
+        }
+
+        uint8 last_block[16];
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(last_block), x);
+
+        crc = crc64_slicing8(0, last_block, sizeof(last_block));
+
+        return crc64_slicing8(crc, buf, size);
+    }
+#endif
+
+    bool is_crc64_kernel_supported(crc64_kernel_t kernel)
+    {
+        switch (kernel)
+        {
+            case cCRC64KernelBytewise:
+                return true;
+            case cCRC64KernelSlicing8:
+#if VOGL_LITTLE_ENDIAN_CPU
+                return true;
+#else
+                return false;
+#endif
+            case cCRC64KernelPCLMUL:
+            {
+#if VOGL_HASH_X86_KERNELS
+                bool has_pclmul, has_avx2;
+                get_x86_cpu_features(has_pclmul, has_avx2);
+                return has_pclmul;
+#else
+                return false;
+#endif
+            }
+            default:
+                break;
+        }
+        return false;
+    }
+
+    const char *get_crc64_kernel_name(crc64_kernel_t kernel)
+    {
+        static const char *s_names[cCRC64KernelTotal] = { "bytewise", "slicing8", "pclmul" };
+        return (kernel < cCRC64KernelTotal) ? s_names[kernel] : "?";
+    }
+
+    crc64_kernel_t get_crc64_kernel()
+    {
+        hash_tables_init();
+
+        return s_crc64_kernel;
+    }
+
+    uint64_t calc_crc64(crc64_kernel_t kernel, uint64_t crc, const uint8 *buf, size_t size)
+    {
+        hash_tables_init();
+
+        crc = ~crc;
+
+        switch (kernel)
+        {
+#if VOGL_HASH_X86_KERNELS
+            case cCRC64KernelPCLMUL:
+                crc = crc64_pclmul(crc, buf, size);
+                break;
+#endif
+            case cCRC64KernelSlicing8:
+                crc = crc64_slicing8(crc, buf, size);
+                break;
+            default:
+                crc = crc64_bytewise(crc, buf, size);
+                break;
+        }
+
         return ~crc;
     }
 
-    uint64_t calc_sum64(const uint8 *buf, size_t size, uint shift_amount)
+    uint64_t calc_crc64(uint64_t crc, const uint8 *buf, size_t size)
+    {
+        hash_tables_init();
+
+        return calc_crc64(s_crc64_kernel, crc, buf, size);
+    }
+
+    static uint64_t sum64_scalar(const uint8 *buf, size_t size, uint shift_amount)
     {
         uint64_t sum = 0;
 
@@ -193,4 +484,347 @@ namespace vogl
         return sum;
     }
 
+#if VOGL_HASH_X86_KERNELS
+    // psadbw against zero sums each group of 8 bytes into a 64-bit lane. There's no 8-bit shift, so shift 16-bit lanes
+    // and mask off the bits that crossed into the neighbouring byte.
+    __attribute__((target("sse2")))
+    static uint64_t sum64_sse2(const uint8 *buf, size_t size, uint shift_amount)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i mask = _mm_set1_epi8(static_cast<char>(0xFF >> shift_amount));
+        const __m128i shift = _mm_cvtsi32_si128(shift_amount);
+
+        __m128i sums = _mm_setzero_si128();
+
+        while (size >= 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf));
+            v = _mm_and_si128(_mm_srl_epi16(v, shift), mask);
+            sums = _mm_add_epi64(sums, _mm_sad_epu8(v, zero));
+            buf += 16;
+            size -= 16;
+        }
+
+        uint64_t lanes[2];
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), sums);
+
+        return lanes[0] + lanes[1] + sum64_scalar(buf, size, shift_amount);
+    }
+
+    __attribute__((target("avx2")))
+    static uint64_t sum64_avx2(const uint8 *buf, size_t size, uint shift_amount)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i mask = _mm256_set1_epi8(static_cast<char>(0xFF >> shift_amount));
+        const __m128i shift = _mm_cvtsi32_si128(shift_amount);
+
+        __m256i sums0 = _mm256_setzero_si256();
+        __m256i sums1 = _mm256_setzero_si256();
+
+        while (size >= 64)
+        {
+            __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(buf));
+            __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(buf + 32));
+            v0 = _mm256_and_si256(_mm256_srl_epi16(v0, shift), mask);
+            v1 = _mm256_and_si256(_mm256_srl_epi16(v1, shift), mask);
+            sums0 = _mm256_add_epi64(sums0, _mm256_sad_epu8(v0, zero));
+            sums1 = _mm256_add_epi64(sums1, _mm256_sad_epu8(v1, zero));
+            buf += 64;
+            size -= 64;
+        }
+
+        uint64_t lanes[4];
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), _mm256_add_epi64(sums0, sums1));
+
+        return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sum64_sse2(buf, size, shift_amount);
+    }
+#endif
+
+    bool is_sum64_kernel_supported(sum64_kernel_t kernel)
+    {
+        switch (kernel)
+        {
+            case cSum64KernelScalar:
+                return true;
+#if VOGL_HASH_X86_KERNELS
+            case cSum64KernelSSE2:
+                return __builtin_cpu_supports("sse2");
+            case cSum64KernelAVX2:
+            {
+                bool has_pclmul, has_avx2;
+                get_x86_cpu_features(has_pclmul, has_avx2);
+                return has_avx2;
+            }
+#endif
+            default:
+                break;
+        }
+        return false;
+    }
+
+    const char *get_sum64_kernel_name(sum64_kernel_t kernel)
+    {
+        static const char *s_names[cSum64KernelTotal] = { "scalar", "sse2", "avx2" };
+        return (kernel < cSum64KernelTotal) ? s_names[kernel] : "?";
+    }
+
+    sum64_kernel_t get_sum64_kernel()
+    {
+        hash_tables_init();
+
+        return s_sum64_kernel;
+    }
+
+    uint64_t calc_sum64(sum64_kernel_t kernel, const uint8 *buf, size_t size, uint shift_amount)
+    {
+        if (shift_amount > 7)
+            return 0;
+
+        switch (kernel)
+        {
+#if VOGL_HASH_X86_KERNELS
+            case cSum64KernelAVX2:
+                return sum64_avx2(buf, size, shift_amount);
+            case cSum64KernelSSE2:
+                return sum64_sse2(buf, size, shift_amount);
+#endif
+            default:
+                break;
+        }
+
+        return sum64_scalar(buf, size, shift_amount);
+    }
+
+    uint64_t calc_sum64(const uint8 *buf, size_t size, uint shift_amount)
+    {
+        hash_tables_init();
+
+        return calc_sum64(s_sum64_kernel, buf, size, shift_amount);
+    }
+
+    // Gear hash table for find_content_chunk_size(). Generated with splitmix64 from a fixed seed, the chunk boundaries
+    // (and so the chunk ids stored on disk) depend on it never changing.
+    static uint64_t s_gear_table[256];
+
+    static void gear_table_init()
+    {
+        uint64_t x = 0;
+        for (uint i = 0; i < 256; i++)
+        {
+            uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            s_gear_table[i] = z ^ (z >> 31);
+        }
+    }
+
+    uint find_content_chunk_size(const uint8 *pData, uint64_t size, uint min_size, uint avg_size, uint max_size)
+    {
+        VOGL_ASSERT(math::is_power_of_2(avg_size));
+        VOGL_ASSERT((min_size <= avg_size) && (avg_size <= max_size));
+
+        if (size <= min_size)
+            return static_cast<uint>(size);
+
+        hash_tables_init();
+
+        const uint n = static_cast<uint>(math::minimum<uint64_t>(size, max_size));
+        const uint normal_size = math::minimum(avg_size, n);
+
+        // The hash is shifted left each byte, so only its top bits depend on the whole 64 byte window. Normalized
+        // chunking: a stricter mask below avg_size and a looser one above it keeps the chunk sizes close to avg_size.
+        const uint avg_bits = math::floor_log2i(avg_size);
+        const uint64_t strict_mask = cUINT64_MAX << (64 - math::minimum(avg_bits + 1U, 63U));
+        const uint64_t loose_mask = cUINT64_MAX << (64 - math::maximum(avg_bits, 2U) + 1);
+
+        uint64_t h = 0;
+        uint i = min_size;
+
+        for (; i < normal_size; i++)
+        {
+            h = (h << 1) + s_gear_table[pData[i]];
+            if (!(h & strict_mask))
+                return i + 1;
+        }
+
+        for (; i < n; i++)
+        {
+            h = (h << 1) + s_gear_table[pData[i]];
+            if (!(h & loose_mask))
+                return i + 1;
+        }
+
+        return n;
+    }
+
+#define VOGL_HASH_VERIFY(x) \
+    if (!(x))               \
+        return false;
+
+    bool hash_test()
+    {
+        // CRC-64/XZ check value
+        static const char s_check_str[] = "123456789";
+        for (uint k = 0; k < cCRC64KernelTotal; k++)
+        {
+            if (!is_crc64_kernel_supported(static_cast<crc64_kernel_t>(k)))
+            {
+                printf("hash_test: Skipping unsupported CRC64 kernel %s\n", get_crc64_kernel_name(static_cast<crc64_kernel_t>(k)));
+                continue;
+            }
+
+            VOGL_HASH_VERIFY(calc_crc64(static_cast<crc64_kernel_t>(k), CRC64_INIT, reinterpret_cast<const uint8 *>(s_check_str), 9) == 0x995DC9BBDF1939FAULL);
+        }
+
+        random r;
+
+        uint8_vec buf(70000);
+        for (uint i = 0; i < buf.size(); i++)
+            buf[i] = static_cast<uint8>(r.urand32());
+
+        // Every size around the kernels' block sizes, at every alignment, chained from a random CRC.
+        for (uint t = 0; t < 2000; t++)
+        {
+            uint ofs = r.irand(0, 64);
+            uint size = (t < 600) ? (t / 3) : r.irand(0, buf.size() - ofs);
+            uint64_t seed = (t & 1) ? r.urand64() : CRC64_INIT;
+            uint shift = r.irand(0, 8);
+
+            uint64_t expected_crc = calc_crc64(cCRC64KernelBytewise, seed, buf.get_ptr() + ofs, size);
+            uint64_t expected_sum = calc_sum64(cSum64KernelScalar, buf.get_ptr() + ofs, size, shift);
+
+            for (uint k = 0; k < cCRC64KernelTotal; k++)
+            {
+                if (is_crc64_kernel_supported(static_cast<crc64_kernel_t>(k)))
+                    VOGL_HASH_VERIFY(calc_crc64(static_cast<crc64_kernel_t>(k), seed, buf.get_ptr() + ofs, size) == expected_crc);
+            }
+
+            for (uint k = 0; k < cSum64KernelTotal; k++)
+            {
+                if (is_sum64_kernel_supported(static_cast<sum64_kernel_t>(k)))
+                    VOGL_HASH_VERIFY(calc_sum64(static_cast<sum64_kernel_t>(k), buf.get_ptr() + ofs, size, shift) == expected_sum);
+            }
+
+            // Splitting the buffer anywhere must not change the CRC.
+            uint split = r.irand_inclusive(0, size);
+            uint64_t crc = calc_crc64(seed, buf.get_ptr() + ofs, split);
+            VOGL_HASH_VERIFY(calc_crc64(crc, buf.get_ptr() + ofs + split, size - split) == expected_crc);
+        }
+
+        return true;
+    }
+
+    // Throughput of each kernel on a 1920x1080 RGB framebuffer, the common case for backbuffer hashing.
+    bool hash_perf_test()
+    {
+        const uint width = 1920, height = 1080;
+        const uint num_iters = 20;
+
+        uint8_vec buf(width * height * 3);
+        random r;
+        for (uint i = 0; i < buf.size(); i++)
+            buf[i] = static_cast<uint8>(r.urand32());
+
+        const double total_gb = static_cast<double>(buf.size()) * num_iters / (1024.0 * 1024.0 * 1024.0);
+
+        printf("hash_perf_test: %ux%u RGB, %u MB, %u iterations\n", width, height, buf.size() / (1024 * 1024), num_iters);
+
+        // Each iteration feeds the previous CRC forward (and the sums use a different shift), so the calls can't be hoisted
+        // out of the timed loops.
+        uint64_t expected_crc = CRC64_INIT;
+        for (uint i = 0; i < num_iters; i++)
+            expected_crc = calc_crc64(cCRC64KernelBytewise, expected_crc, buf.get_ptr(), buf.size());
+
+        for (uint k = 0; k < cCRC64KernelTotal; k++)
+        {
+            crc64_kernel_t kernel = static_cast<crc64_kernel_t>(k);
+            if (!is_crc64_kernel_supported(kernel))
+                continue;
+
+            uint64_t crc = CRC64_INIT;
+            timer tm;
+            tm.start();
+            for (uint i = 0; i < num_iters; i++)
+                crc = calc_crc64(kernel, crc, buf.get_ptr(), buf.size());
+            double secs = tm.get_elapsed_secs();
+
+            printf("calc_crc64 %-9s %3.3f secs, %3.3f GB/sec%s\n", get_crc64_kernel_name(kernel), secs, total_gb / math::maximum(secs, 1e-9),
+                   (kernel == get_crc64_kernel()) ? " (default)" : "");
+
+            VOGL_HASH_VERIFY(crc == expected_crc);
+        }
+
+        uint64_t expected_sum = 0;
+        for (uint i = 0; i < num_iters; i++)
+            expected_sum += calc_sum64(cSum64KernelScalar, buf.get_ptr(), buf.size(), i & 7);
+
+        for (uint k = 0; k < cSum64KernelTotal; k++)
+        {
+            sum64_kernel_t kernel = static_cast<sum64_kernel_t>(k);
+            if (!is_sum64_kernel_supported(kernel))
+                continue;
+
+            uint64_t sum = 0;
+            timer tm;
+            tm.start();
+            for (uint i = 0; i < num_iters; i++)
+                sum += calc_sum64(kernel, buf.get_ptr(), buf.size(), i & 7);
+            double secs = tm.get_elapsed_secs();
+
+            printf("calc_sum64 %-9s %3.3f secs, %3.3f GB/sec%s\n", get_sum64_kernel_name(kernel), secs, total_gb / math::maximum(secs, 1e-9),
+                   (kernel == get_sum64_kernel()) ? " (default)" : "");
+
+            VOGL_HASH_VERIFY(sum == expected_sum);
+        }
+
+        return true;
+    }
+
+    // Splits random data into chunks, then checks that an insertion only changes the chunks around it.
+    bool content_chunk_test()
+    {
+        const uint min_size = 2048, avg_size = 8192, max_size = 32768;
+
+        random r;
+
+        uint8_vec buf(4 * 1024 * 1024);
+        for (uint i = 0; i < buf.size(); i++)
+            buf[i] = static_cast<uint8>(r.urand32());
+
+        vogl::vector<uint64_t> chunk_crcs;
+        for (uint ofs = 0; ofs < buf.size();)
+        {
+            uint n = find_content_chunk_size(buf.get_ptr() + ofs, buf.size() - ofs, min_size, avg_size, max_size);
+            VOGL_HASH_VERIFY((n > 0) && (n <= max_size));
+            VOGL_HASH_VERIFY((n >= min_size) || (ofs + n == buf.size()));
+
+            chunk_crcs.push_back(calc_crc64(CRC64_INIT, buf.get_ptr() + ofs, n) ^ n);
+            ofs += n;
+        }
+
+        const uint avg_chunk_size = buf.size() / chunk_crcs.size();
+        printf("content_chunk_test: %u chunks, %u bytes average\n", chunk_crcs.size(), avg_chunk_size);
+        VOGL_HASH_VERIFY((avg_chunk_size >= avg_size / 2) && (avg_chunk_size <= avg_size * 2));
+
+        uint8_vec edited(buf);
+        edited.insert(buf.size() / 3, buf.get_ptr(), 100);
+
+        uint total_chunks = 0, total_shared = 0;
+        for (uint ofs = 0; ofs < edited.size(); total_chunks++)
+        {
+            uint n = find_content_chunk_size(edited.get_ptr() + ofs, edited.size() - ofs, min_size, avg_size, max_size);
+            uint64_t crc = calc_crc64(CRC64_INIT, edited.get_ptr() + ofs, n) ^ n;
+            if (chunk_crcs.find(crc) >= 0)
+                total_shared++;
+            ofs += n;
+        }
+
+        printf("content_chunk_test: %u of %u chunks unchanged after an insertion\n", total_shared, total_chunks);
+        VOGL_HASH_VERIFY(total_shared + 4 >= total_chunks);
+
+        return true;
+    }
+
+#undef VOGL_HASH_VERIFY
+
 } // namespace vogl
@@ -33,12 +33,49 @@ namespace vogl
 {
     extern uint64_t g_crc64_table[256];
 
+    // calc_crc64() and calc_sum64() pick the fastest kernel the CPU supports the first time they're called. The
+    // other kernels are exposed for testing and benchmarking, they all return identical results.
+    enum crc64_kernel_t
+    {
+        cCRC64KernelBytewise,
+        cCRC64KernelSlicing8,
+        cCRC64KernelPCLMUL,
+        cCRC64KernelTotal
+    };
+
+    enum sum64_kernel_t
+    {
+        cSum64KernelScalar,
+        cSum64KernelSSE2,
+        cSum64KernelAVX2,
+        cSum64KernelTotal
+    };
+
     const uint64_t CRC64_INIT = 0;
     void crc64_init();
     uint64_t calc_crc64(uint64_t crc, const uint8 *buf, size_t size);
 
+    bool is_crc64_kernel_supported(crc64_kernel_t kernel);
+    const char *get_crc64_kernel_name(crc64_kernel_t kernel);
+    crc64_kernel_t get_crc64_kernel();
+    uint64_t calc_crc64(crc64_kernel_t kernel, uint64_t crc, const uint8 *buf, size_t size);
+
     uint64_t calc_sum64(const uint8 *buf, size_t size, uint shift_amount = 0);
 
+    bool is_sum64_kernel_supported(sum64_kernel_t kernel);
+    const char *get_sum64_kernel_name(sum64_kernel_t kernel);
+    sum64_kernel_t get_sum64_kernel();
+    uint64_t calc_sum64(sum64_kernel_t kernel, const uint8 *buf, size_t size, uint shift_amount = 0);
+
+    // Content-defined chunking: returns the size of the chunk starting at pData, at least min_size and at most max_size
+    // bytes (unless size is smaller). Boundaries are picked by a gear rolling hash of the preceding bytes, so after an
+    // insertion or deletion they realign and the chunks that follow are unchanged. avg_size must be a power of 2.
+    uint find_content_chunk_size(const uint8 *pData, uint64_t size, uint min_size, uint avg_size, uint max_size);
+
+    bool hash_test();
+    bool hash_perf_test();
+    bool content_chunk_test();
+
     uint32 fast_hash(const void *p, int len);
 
     template <typename T>
@@ -0,0 +1,178 @@
+/**************************************************************************
+ *
+ * Copyright 2013-2014 RAD Game Tools and Valve Software
+ * Copyright 2010-2014 Rich Geldreich and Tenacious Software LLC
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+// File: vogl_hash_bimap.cpp
+#include "vogl_core.h"
+#include "vogl_hash_bimap.h"
+#include "vogl_rand.h"
+#include "vogl_timer.h"
+
+namespace vogl
+{
+#define VOGL_HASHBIMAP_VERIFY(x) \
+    if (!(x))                    \
+        return false;
+
+    bool hash_bimap_test()
+    {
+        random r;
+
+        typedef hash_bimap<uint, uint> uint_bimap;
+
+        for (uint t = 0; t < 50; t++)
+        {
+            uint_bimap m;
+            hash_map<uint, uint> ref;
+            hash_map<uint, bool> used_vals;
+
+            const uint n = r.irand(1, 20000);
+            for (uint i = 0; i < n; i++)
+            {
+                uint key = r.irand(1, n * 2);
+                uint val = r.urand32() | 1;
+
+                // Keep the reference map one to one so the inverse lookups are well defined.
+                if (!used_vals.insert(val, true).second)
+                    continue;
+
+                bool inserted = m.insert(key, val);
+                VOGL_HASHBIMAP_VERIFY(inserted == !ref.contains(key));
+                ref[key] = val;
+
+                if (r.irand(0, 4) == 0)
+                {
+                    uint erase_key = r.irand(1, n * 2);
+                    VOGL_HASHBIMAP_VERIFY(m.erase(erase_key) == ref.erase(erase_key));
+                }
+            }
+
+            VOGL_HASHBIMAP_VERIFY(m.size() == ref.size());
+            VOGL_HASHBIMAP_VERIFY(m.get_value_to_key_map().size() == ref.size());
+
+            for (hash_map<uint, uint>::const_iterator it = ref.begin(); it != ref.end(); ++it)
+            {
+                uint val = 0, key = 0;
+                VOGL_HASHBIMAP_VERIFY(m.find_value(it->first, val) && (val == it->second));
+                VOGL_HASHBIMAP_VERIFY(m.find_key(it->second, key) && (key == it->first));
+                VOGL_HASHBIMAP_VERIFY(m.contains_value(it->second));
+            }
+
+            for (uint_bimap::const_iterator it = m.begin(); it != m.end(); ++it)
+                VOGL_HASHBIMAP_VERIFY(ref.value(it->first) == it->second);
+        }
+
+        // Keys sharing a value: the inverse map follows the last insert, and survives erasing any of the keys.
+        uint_bimap m;
+        m.insert(1, 100);
+        m.insert(2, 100);
+        m.insert(3, 100);
+        uint key = 0;
+        VOGL_HASHBIMAP_VERIFY(m.find_key(100, key) && (key == 3));
+        m.erase(1);
+        VOGL_HASHBIMAP_VERIFY(m.find_key(100, key) && (key == 3));
+        m.erase(3);
+        VOGL_HASHBIMAP_VERIFY(m.find_key(100, key) && (key == 2));
+        VOGL_HASHBIMAP_VERIFY(!m.insert(2, 100) && m.find_key(100, key) && (key == 2));
+        m.erase(2);
+        VOGL_HASHBIMAP_VERIFY(!m.contains_value(100) && m.is_empty());
+
+        // Moving one of several keys to a new value keeps the others findable.
+        m.insert(4, 400);
+        m.insert(5, 400);
+        VOGL_HASHBIMAP_VERIFY(!m.insert(5, 500));
+        VOGL_HASHBIMAP_VERIFY(m.find_key(400, key) && (key == 4) && m.find_key(500, key) && (key == 5));
+        m.clear();
+
+        // Replacing a key's value drops the old inverse entry.
+        m.insert(3, 200);
+        VOGL_HASHBIMAP_VERIFY(!m.insert(3, 300));
+        VOGL_HASHBIMAP_VERIFY(!m.contains_value(200) && m.find_key(300, key) && (key == 3));
+
+        return true;
+    }
+
+    // Models remapping every replay handle of a snapshot with a large object count back to its trace handle.
+    bool hash_bimap_perf_test()
+    {
+        const uint num_objects = 50000;
+
+        printf("hash_bimap_perf_test objects: %u\n", num_objects);
+
+        typedef hash_bimap<uint, uint> uint_bimap;
+
+        uint_bimap m;
+        hash_map<uint, uint> trace_to_replay;
+
+        random r;
+        vogl::vector<uint> replay_handles(num_objects);
+        for (uint i = 0; i < num_objects; i++)
+        {
+            uint trace_handle = i + 1;
+            uint replay_handle = num_objects * 2 + i * 3 + 1;
+            replay_handles[i] = replay_handle;
+
+            m.insert(trace_handle, replay_handle);
+            trace_to_replay.insert(trace_handle, replay_handle);
+        }
+        replay_handles.shuffle(r);
+
+        uint64_t bimap_sum = 0;
+        double bimap_time;
+        {
+            timed_scope ts("hash_bimap::find_key");
+            for (uint i = 0; i < num_objects; i++)
+            {
+                uint trace_handle = 0;
+                VOGL_HASHBIMAP_VERIFY(m.find_key(replay_handles[i], trace_handle));
+                bimap_sum += trace_handle;
+            }
+            bimap_time = ts.get_elapsed_secs();
+        }
+
+        // A full linear scan per handle is quadratic, so only time a sample of them and extrapolate.
+        const uint num_scanned = math::minimum<uint>(num_objects, 2000);
+        uint64_t scan_sum = 0;
+        double scan_time;
+        {
+            timed_scope ts("hash_map::search_table_for_value");
+            for (uint i = 0; i < num_scanned; i++)
+            {
+                hash_map<uint, uint>::const_iterator it(trace_to_replay.search_table_for_value(replay_handles[i]));
+                VOGL_HASHBIMAP_VERIFY(it != trace_to_replay.end());
+                scan_sum += it->first;
+            }
+            scan_time = ts.get_elapsed_secs();
+        }
+
+        printf("Inverse lookups: %3.6f secs for %u, search_table_for_value: %3.6f secs for %u (~%3.3f secs for %u)\n",
+               bimap_time, num_objects, scan_time, num_scanned, scan_time * num_objects / math::maximum<uint>(num_scanned, 1), num_objects);
+
+        return (bimap_sum == (static_cast<uint64_t>(num_objects) * (num_objects + 1)) / 2) && (scan_sum != 0);
+    }
+
+#undef VOGL_HASHBIMAP_VERIFY
+
+} // namespace vogl
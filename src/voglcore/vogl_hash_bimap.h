@@ -0,0 +1,220 @@
+/**************************************************************************
+ *
+ * Copyright 2013-2014 RAD Game Tools and Valve Software
+ * Copyright 2010-2014 Rich Geldreich and Tenacious Software LLC
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ **************************************************************************/
+
+// File: vogl_hash_bimap.h
+//
+// Notes:
+// One to one hash map which also maintains the inverse (value to key) map, so lookups in either direction are O(1)
+// instead of requiring a linear search_table_for_value() scan.
+// Several keys may share a value: the inverse map counts them and returns the key inserted last, and when that key is
+// erased it falls back to one of the remaining keys (found with a scan, so this case isn't O(1)).
+#pragma once
+
+#include "vogl_core.h"
+#include "vogl_hash_map.h"
+
+namespace vogl
+{
+    template <typename Key, typename Value, typename KeyHasher = hasher<Key>, typename ValueHasher = hasher<Value> >
+    class hash_bimap
+    {
+    public:
+        struct inverse_entry
+        {
+            inline inverse_entry()
+                : m_key(), m_count(0)
+            {
+            }
+
+            Key m_key;
+            uint m_count; // number of keys mapping to this value
+        };
+
+        typedef hash_map<Key, Value, KeyHasher> key_to_value_map;
+        typedef hash_map<Value, inverse_entry, ValueHasher> value_to_key_map;
+        typedef typename key_to_value_map::const_iterator const_iterator;
+
+        inline hash_bimap()
+        {
+        }
+
+        inline void clear()
+        {
+            m_key_to_value.clear();
+            m_value_to_key.clear();
+        }
+
+        inline void reset()
+        {
+            m_key_to_value.reset();
+            m_value_to_key.reset();
+        }
+
+        inline void reserve(uint new_capacity)
+        {
+            m_key_to_value.reserve(new_capacity);
+            m_value_to_key.reserve(new_capacity);
+        }
+
+        inline uint size() const
+        {
+            return m_key_to_value.size();
+        }
+        inline bool is_empty() const
+        {
+            return m_key_to_value.is_empty();
+        }
+
+        inline const_iterator begin() const
+        {
+            return m_key_to_value.begin();
+        }
+        inline const_iterator end() const
+        {
+            return m_key_to_value.end();
+        }
+
+        inline const_iterator find(const Key &key) const
+        {
+            return m_key_to_value.find(key);
+        }
+
+        inline bool contains(const Key &key) const
+        {
+            return m_key_to_value.contains(key);
+        }
+        inline bool contains_value(const Value &val) const
+        {
+            return m_value_to_key.contains(val);
+        }
+
+        // Returns def if key isn't present.
+        inline const Value &value(const Key &key, const Value &def = Value()) const
+        {
+            return m_key_to_value.value(key, def);
+        }
+
+        inline bool find_value(const Key &key, Value &val) const
+        {
+            const Value *pVal = m_key_to_value.find_value(key);
+            if (!pVal)
+                return false;
+            val = *pVal;
+            return true;
+        }
+
+        inline bool find_key(const Value &val, Key &key) const
+        {
+            const inverse_entry *pEntry = m_value_to_key.find_value(val);
+            if (!pEntry)
+                return false;
+            key = pEntry->m_key;
+            return true;
+        }
+
+        // Returns false (and replaces the existing key's value) if key was already present.
+        inline bool insert(const Key &key, const Value &val)
+        {
+            typename key_to_value_map::insert_result result(m_key_to_value.insert(key, val));
+            if (!result.second)
+            {
+                erase_inv(result.first->second, key);
+                result.first->second = val;
+            }
+
+            inverse_entry &entry = m_value_to_key[val];
+            entry.m_key = key;
+            entry.m_count++;
+
+            return result.second;
+        }
+
+        inline bool erase(const Key &key)
+        {
+            const Value *pVal = m_key_to_value.find_value(key);
+            if (!pVal)
+                return false;
+
+            erase_inv(*pVal, key);
+            m_key_to_value.erase(key);
+            return true;
+        }
+
+        inline void swap(hash_bimap &other)
+        {
+            m_key_to_value.swap(other.m_key_to_value);
+            m_value_to_key.swap(other.m_value_to_key);
+        }
+
+        inline const key_to_value_map &get_key_to_value_map() const
+        {
+            return m_key_to_value;
+        }
+        inline const value_to_key_map &get_value_to_key_map() const
+        {
+            return m_value_to_key;
+        }
+
+    private:
+        key_to_value_map m_key_to_value;
+        value_to_key_map m_value_to_key;
+
+        // key must still be in m_key_to_value (mapping to val), it's skipped when looking for another key.
+        inline void erase_inv(const Value &val, const Key &key)
+        {
+            inverse_entry *pEntry = m_value_to_key.find_value(val);
+            VOGL_ASSERT(pEntry);
+            if (!pEntry)
+                return;
+
+            if (--pEntry->m_count == 0)
+            {
+                m_value_to_key.erase(val);
+                return;
+            }
+
+            if (!(pEntry->m_key == key))
+                return;
+
+            for (const_iterator it = m_key_to_value.begin(); it != m_key_to_value.end(); ++it)
+            {
+                if ((it->second == val) && (!(it->first == key)))
+                {
+                    pEntry->m_key = it->first;
+                    return;
+                }
+            }
+
+            VOGL_ASSERT_ALWAYS;
+        }
+    };
+
+    bool hash_bimap_test();
+
+    // Times inverse lookups against hash_map::search_table_for_value() on a map with 50k entries.
+    bool hash_bimap_perf_test();
+
+} // namespace vogl
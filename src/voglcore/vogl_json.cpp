@@ -31,6 +31,8 @@
 #include "vogl_growable_array.h"
 #include "vogl_hash_map.h"
 #include "vogl_map.h"
+#include "vogl_rand.h"
+#include "vogl_timer.h"
 
 namespace vogl
 {
@@ -1174,6 +1176,9 @@ namespace vogl
                     ++idx;
                 }
 
+                // The keys were set through get_key(), which drops the index.
+                pNode->update_key_index();
+
                 break;
             }
             case 's':
@@ -1412,6 +1417,9 @@ namespace vogl
             return false;
         }
 
+        // The keys were set through get_key(), which drops the index.
+        pNode->update_key_index();
+
         return true;
     }
 
@@ -1953,6 +1961,8 @@ namespace vogl
             //VOGL_ASSERT(m_values[i].validate(this));
         }
 
+        update_key_index();
+
         m_line = rhs.m_line;
 
         return *this;
@@ -1966,12 +1976,82 @@ namespace vogl
 
     int json_node::find_key(const char *pKey) const
     {
-        for (uint i = 0; i < m_keys.size(); i++)
-            if (m_keys[i] == pKey)
-                return i;
+        if (!m_key_index.size())
+        {
+            for (uint i = 0; i < m_keys.size(); i++)
+                if (m_keys[i] == pKey)
+                    return i;
+            return cInvalidIndex;
+        }
+
+        const uint mask = m_key_index.size() - 1;
+        for (uint slot = hash_key(pKey) & mask; m_key_index[slot]; slot = (slot + 1) & mask)
+        {
+            uint index = m_key_index[slot] - 1;
+            if (m_keys[index] == pKey)
+                return index;
+        }
         return cInvalidIndex;
     }
 
+    // FNV-1a of the lowercased key, so keys which compare equal case insensitively land in the same slot.
+    uint json_node::hash_key(const char *pKey)
+    {
+        uint hash = 2166136261U;
+        for (const uint8 *p = reinterpret_cast<const uint8 *>(pKey); *p; ++p)
+            hash = (hash ^ static_cast<uint>(vogl_tolower(*p))) * 16777619U;
+        return hash;
+    }
+
+    void json_node::build_key_index()
+    {
+        m_key_index.resize(0);
+        m_key_index.resize(math::maximum<uint>(math::next_pow2(m_keys.size() * 2U), cKeyIndexThreshold * 2U));
+
+        for (uint i = 0; i < m_keys.size(); i++)
+            add_to_key_index(i);
+    }
+
+    // Called once the keys have been changed (or parsed), small objects don't need an index.
+    void json_node::update_key_index()
+    {
+        if (m_keys.size() < cKeyIndexThreshold)
+            invalidate_key_index();
+        else
+            build_key_index();
+    }
+
+    void json_node::add_to_key_index(uint index)
+    {
+        if (!m_key_index.size())
+        {
+            // The object just got large enough (or its index was dropped by get_key()).
+            if (m_keys.size() >= cKeyIndexThreshold)
+                build_key_index();
+            return;
+        }
+
+        // Keep the table at most half full, rebuilding it also picks up the new key.
+        if ((m_keys.size() * 2U) > m_key_index.size())
+        {
+            build_key_index();
+            return;
+        }
+
+        const dynamic_string &key = m_keys[index];
+
+        const uint mask = m_key_index.size() - 1;
+        uint slot = hash_key(key.get_ptr()) & mask;
+        for (; m_key_index[slot]; slot = (slot + 1) & mask)
+        {
+            // Duplicate keys: find_key() must keep returning the first one.
+            if (m_keys[m_key_index[slot] - 1] == key)
+                return;
+        }
+
+        m_key_index[slot] = index + 1;
+    }
+
     int json_node::find_child(const json_node *pNode) const
     {
         for (uint i = 0; i < m_values.size(); i++)
@@ -2254,6 +2334,7 @@ namespace vogl
 
     void json_node::clear()
     {
+        invalidate_key_index();
         m_keys.clear();
         m_values.clear();
         m_is_object = false;
@@ -2262,9 +2343,18 @@ namespace vogl
 
     void json_node::resize(uint new_size)
     {
+        const bool shrinking = new_size < size();
+
         if (m_is_object)
             m_keys.resize(new_size, true);
         m_values.resize(new_size, true);
+
+        // Growing only adds empty keys, which get set through get_key() (dropping the index anyway), and the parsers
+        // grow objects one key at a time before calling update_key_index() once at the end, so don't rebuild here.
+        if (shrinking)
+            update_key_index();
+        else
+            invalidate_key_index();
     }
 
     void json_node::reserve(uint new_capacity)
@@ -2283,6 +2373,7 @@ namespace vogl
         else
             m_keys.clear();
         m_is_object = is_object;
+        update_key_index();
     }
 
     void json_node::ensure_is_object()
@@ -2291,6 +2382,7 @@ namespace vogl
         {
             m_is_object = true;
             m_keys.resize(m_values.size());
+            update_key_index();
         }
     }
 
@@ -2301,6 +2393,7 @@ namespace vogl
         uint new_index = m_values.size();
 
         m_keys.push_back(pKey);
+        add_to_key_index(m_keys.size() - 1);
 
         m_values.push_back(val);
         if (val.is_node())
@@ -2312,7 +2405,10 @@ namespace vogl
     json_value &json_node::add_value()
     {
         if (m_is_object)
+        {
             m_keys.enlarge(1);
+            add_to_key_index(m_keys.size() - 1);
+        }
         return *m_values.enlarge(1);
     }
 
@@ -2321,7 +2417,10 @@ namespace vogl
         uint new_index = m_values.size();
 
         if (m_is_object)
+        {
             m_keys.enlarge(1);
+            add_to_key_index(m_keys.size() - 1);
+        }
 
         m_values.push_back(val);
         if (val.is_node())
@@ -2339,6 +2438,7 @@ namespace vogl
         ensure_is_object();
 
         m_keys.push_back(pKey);
+        add_to_key_index(m_keys.size() - 1);
 
         json_value *p = m_values.enlarge(1);
         val.release_ownership(*p);
@@ -2355,7 +2455,10 @@ namespace vogl
             return false;
 
         if (m_is_object)
+        {
             m_keys.enlarge(1);
+            add_to_key_index(m_keys.size() - 1);
+        }
 
         json_value *p = m_values.enlarge(1);
         val.release_ownership(*p);
@@ -2372,6 +2475,10 @@ namespace vogl
             VOGL_ASSERT_ALWAYS;
             return get_empty_dynamic_string();
         }
+
+        // The caller may change the key through the returned reference, so lookups go back to linear scans until the
+        // node's keys are modified through one of the other methods.
+        invalidate_key_index();
         return m_keys[index];
     }
 
@@ -2379,6 +2486,7 @@ namespace vogl
     {
         ensure_is_object();
         m_keys[index].set(pKey);
+        update_key_index();
 
         m_values[index] = val;
         if (m_values[index].is_node())
@@ -2389,6 +2497,7 @@ namespace vogl
     {
         ensure_is_object();
         m_keys[index].set(pKey);
+        update_key_index();
     }
 
     void json_node::set_value(uint index, const json_value &val)
@@ -2411,7 +2520,10 @@ namespace vogl
     void json_node::add_value_assume_ownership(json_value &val)
     {
         if (m_is_object)
+        {
             m_keys.enlarge(1);
+            add_to_key_index(m_keys.size() - 1);
+        }
         uint new_index = m_values.size();
         m_values.enlarge(1);
         set_value_assume_ownership(new_index, val);
@@ -2421,6 +2533,7 @@ namespace vogl
     {
         ensure_is_object();
         m_keys.push_back(pKey);
+        add_to_key_index(m_keys.size() - 1);
 
         uint new_index = m_values.size();
         m_values.enlarge(1);
@@ -2435,6 +2548,7 @@ namespace vogl
 
         ensure_is_object();
         m_keys.push_back(pKey);
+        add_to_key_index(m_keys.size() - 1);
         return *m_values.enlarge(1);
     }
 
@@ -2442,6 +2556,7 @@ namespace vogl
     {
         ensure_is_object();
         m_keys.push_back(pKey);
+        add_to_key_index(m_keys.size() - 1);
         return *m_values.enlarge(1);
     }
 
@@ -2449,6 +2564,7 @@ namespace vogl
     {
         ensure_is_object();
         m_keys.push_back(pKey);
+        add_to_key_index(m_keys.size() - 1);
 
         json_node *pNode = get_json_node_pool()->alloc(this, true);
         m_values.enlarge(1);
@@ -2460,6 +2576,7 @@ namespace vogl
     {
         ensure_is_object();
         m_keys.push_back(pKey);
+        add_to_key_index(m_keys.size() - 1);
 
         json_node *pNode = get_json_node_pool()->alloc(this, false);
         m_values.enlarge(1)->set_value_assume_ownership(pNode);
@@ -2469,7 +2586,10 @@ namespace vogl
     json_node &json_node::add_object()
     {
         if (m_is_object)
+        {
             m_keys.enlarge(1);
+            add_to_key_index(m_keys.size() - 1);
+        }
         json_node *pNode = get_json_node_pool()->alloc(this, true);
         m_values.enlarge(1)->set_value_assume_ownership(pNode);
         return *pNode;
@@ -2478,7 +2598,10 @@ namespace vogl
     json_node &json_node::add_array()
     {
         if (m_is_object)
+        {
             m_keys.enlarge(1);
+            add_to_key_index(m_keys.size() - 1);
+        }
         json_node *pNode = get_json_node_pool()->alloc(this, false);
         m_values.enlarge(1)->set_value_assume_ownership(pNode);
         return *pNode;
@@ -2500,6 +2623,7 @@ namespace vogl
         if (m_is_object)
             m_keys.erase(index);
         m_values.erase(index);
+        update_key_index();
     }
 
     bool json_node::basic_validation(const json_node *pParent) const
@@ -3159,4 +3283,230 @@ namespace vogl
         return true;
     }
 
+#define VOGL_JSON_KEY_INDEX_VERIFY(x) \
+    if (!(x))                         \
+        return false;
+
+    static int json_linear_find_key(const json_node &node, const char *pKey)
+    {
+        for (uint i = 0; i < node.size(); i++)
+            if (node.get_key(i) == pKey)
+                return i;
+        return cInvalidIndex;
+    }
+
+    static bool json_check_key_index(const json_node &node, random &r, uint num_lookups)
+    {
+        for (uint i = 0; i < num_lookups; i++)
+        {
+            dynamic_string key(cVarArg, "Key%u", r.irand(0, 1000));
+            if (r.irand(0, 2) == 0)
+                key.toupper();
+            else if (r.irand(0, 2) == 0)
+                key.tolower();
+
+            if (node.find_key(key.get_ptr()) != json_linear_find_key(node, key.get_ptr()))
+                return false;
+        }
+
+        for (uint i = 0; i < node.size(); i++)
+            if (node.find_key(node.get_key(i).get_ptr()) != json_linear_find_key(node, node.get_key(i).get_ptr()))
+                return false;
+
+        return true;
+    }
+
+    bool json_key_index_test()
+    {
+        random r;
+
+        for (uint t = 0; t < 40; t++)
+        {
+            json_node node;
+            node.init_object();
+
+            const uint n = r.irand(0, 800);
+            for (uint i = 0; i < n; i++)
+            {
+                // Mixed case and duplicate keys on purpose, find_key() must match the case insensitive linear scan.
+                dynamic_string key(cVarArg, r.irand(0, 2) ? "key%u" : "KEY%u", r.irand(0, 1000));
+
+                switch (r.irand(0, 6))
+                {
+                    case 0:
+                        node.add_object(key.get_ptr());
+                        break;
+                    case 1:
+                        node.add_value(i);
+                        break;
+                    case 2:
+                        node.get_or_add(key.get_ptr()) = i;
+                        break;
+                    default:
+                        node.add_key_value(key.get_ptr(), i);
+                        break;
+                }
+
+                if ((i & 63) == 0)
+                    VOGL_JSON_KEY_INDEX_VERIFY(json_check_key_index(node, r, 50));
+            }
+
+            VOGL_JSON_KEY_INDEX_VERIFY(json_check_key_index(node, r, 500));
+
+            for (uint i = 0; (i < 20) && (node.size()); i++)
+            {
+                uint index = r.irand(0, node.size());
+                switch (r.irand(0, 3))
+                {
+                    case 0:
+                        node.erase(index);
+                        break;
+                    case 1:
+                        node.set_key(index, dynamic_string(cVarArg, "Key%u", r.irand(0, 1000)).get_ptr());
+                        break;
+                    default:
+                        node.get_key(index).set(dynamic_string(cVarArg, "kEy%u", r.irand(0, 1000)).get_ptr());
+                        break;
+                }
+
+                VOGL_JSON_KEY_INDEX_VERIFY(json_check_key_index(node, r, 100));
+            }
+
+            json_node copy(node);
+            VOGL_JSON_KEY_INDEX_VERIFY(copy.size() == node.size());
+            VOGL_JSON_KEY_INDEX_VERIFY(json_check_key_index(copy, r, 100));
+
+            // Parsed objects get their index while they're parsed.
+            dynamic_string text;
+            node.serialize(text, false);
+
+            json_document text_doc;
+            VOGL_JSON_KEY_INDEX_VERIFY(text_doc.deserialize(text));
+            VOGL_JSON_KEY_INDEX_VERIFY((text_doc.get_root()) && (text_doc.get_root()->size() == node.size()));
+            VOGL_JSON_KEY_INDEX_VERIFY(json_check_key_index(*text_doc.get_root(), r, 100));
+
+            vogl::vector<uint8> binary;
+            node.binary_serialize(binary);
+
+            json_value binary_val;
+            VOGL_JSON_KEY_INDEX_VERIFY(binary_val.binary_deserialize(binary));
+            VOGL_JSON_KEY_INDEX_VERIFY((binary_val.get_node_ptr()) && (binary_val.get_node_ptr()->size() == node.size()));
+            VOGL_JSON_KEY_INDEX_VERIFY(json_check_key_index(*binary_val.get_node_ptr(), r, 100));
+
+            node.resize(node.size() / 2);
+            VOGL_JSON_KEY_INDEX_VERIFY(json_check_key_index(node, r, 100));
+        }
+
+        return true;
+    }
+
+    // Parses a flat object with num_keys keys from text and binary, returning the time each parse took.
+    static bool json_time_large_object_parse(uint num_keys, double &text_time, double &binary_time)
+    {
+        json_node node;
+        node.init_object();
+        for (uint i = 0; i < num_keys; i++)
+            node.add_key_value(dynamic_string(cVarArg, "GL_STATE_%u", i).get_ptr(), i);
+
+        dynamic_string text;
+        node.serialize(text, false);
+
+        vogl::vector<uint8> binary;
+        node.binary_serialize(binary);
+
+        const char *pLast_key = "gl_state_0";
+        dynamic_string last_key(cVarArg, "gl_state_%u", num_keys - 1);
+
+        json_document text_doc;
+        {
+            timed_scope ts("json_document::deserialize");
+            if (!text_doc.deserialize(text))
+                return false;
+            text_time = ts.get_elapsed_secs();
+        }
+        const json_node *pText_root = text_doc.get_root();
+        if ((!pText_root) || (pText_root->size() != num_keys) || (pText_root->find_key(pLast_key) != 0) || (pText_root->find_key(last_key.get_ptr()) != static_cast<int>(num_keys - 1)))
+            return false;
+
+        json_value binary_val;
+        {
+            timed_scope ts("json_value::binary_deserialize");
+            if (!binary_val.binary_deserialize(binary))
+                return false;
+            binary_time = ts.get_elapsed_secs();
+        }
+        const json_node *pBinary_root = binary_val.get_node_ptr();
+        if ((!pBinary_root) || (pBinary_root->size() != num_keys) || (pBinary_root->find_key(pLast_key) != 0) || (pBinary_root->find_key(last_key.get_ptr()) != static_cast<int>(num_keys - 1)))
+            return false;
+
+        return true;
+    }
+
+    // Models the lookups done while deserializing a snapshot with a large per-object array or GL state vector.
+    bool json_key_index_perf_test()
+    {
+        const uint num_keys = 20000;
+
+        printf("json_key_index_perf_test keys: %u\n", num_keys);
+
+        json_node node;
+        node.init_object();
+        for (uint i = 0; i < num_keys; i++)
+            node.add_key_value(dynamic_string(cVarArg, "GL_STATE_%u", i).get_ptr(), i);
+
+        dynamic_string_array keys(num_keys);
+        for (uint i = 0; i < num_keys; i++)
+            keys[i].format("gl_state_%u", i);
+
+        random r;
+        keys.shuffle(r);
+
+        uint64_t index_sum = 0;
+        double index_time;
+        {
+            timed_scope ts("json_node::find_key");
+            for (uint i = 0; i < num_keys; i++)
+                index_sum += node.find_key(keys[i].get_ptr());
+            index_time = ts.get_elapsed_secs();
+        }
+
+        // The linear scan is quadratic over all the keys, so only time a sample of them and extrapolate.
+        const uint num_scanned = math::minimum<uint>(num_keys, 1000);
+        uint64_t scan_sum = 0;
+        double scan_time;
+        {
+            timed_scope ts("linear scan");
+            for (uint i = 0; i < num_scanned; i++)
+                scan_sum += json_linear_find_key(node, keys[i].get_ptr());
+            scan_time = ts.get_elapsed_secs();
+        }
+
+        printf("Key lookups: %3.6f secs for %u, linear scan: %3.6f secs for %u (~%3.3f secs for %u)\n",
+               index_time, num_keys, scan_time, num_scanned, scan_time * num_keys / math::maximum<uint>(num_scanned, 1), num_keys);
+
+        if ((index_sum != (static_cast<uint64_t>(num_keys) * (num_keys - 1)) / 2) || (!scan_sum))
+            return false;
+
+        // Parsing must stay linear in the number of keys: 4x the keys should take roughly 4x as long, where
+        // maintaining the index per parsed key would take ~16x. Allow generous slack for timer noise.
+        double small_text_time = 0, small_binary_time = 0, large_text_time = 0, large_binary_time = 0;
+        if (!json_time_large_object_parse(num_keys, small_text_time, small_binary_time))
+            return false;
+        if (!json_time_large_object_parse(num_keys * 4, large_text_time, large_binary_time))
+            return false;
+
+        printf("Object parse: text %3.6f secs for %u keys, %3.6f secs for %u keys; binary %3.6f secs for %u keys, %3.6f secs for %u keys\n",
+               small_text_time, num_keys, large_text_time, num_keys * 4, small_binary_time, num_keys, large_binary_time, num_keys * 4);
+
+        const double cSlackSecs = .05;
+        if (large_text_time > (small_text_time * 10.0 + cSlackSecs))
+            return false;
+        if (large_binary_time > (small_binary_time * 10.0 + cSlackSecs))
+            return false;
+
+        return true;
+    }
+
+#undef VOGL_JSON_KEY_INDEX_VERIFY
+
 } // namespace vogl
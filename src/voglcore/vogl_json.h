@@ -410,6 +410,8 @@ namespace vogl
         // Key retrieval/finding
 
         // Returns cInvalidIndex (-1) if key was not found. Search is case insensitive.
+        // Uses the node's key hash index when present, otherwise falls back to a linear scan. Never modifies the node,
+        // so concurrent const lookups are safe.
         int find_key(const char *pKey) const;
 
         int find_child(const json_node *pNode) const;
@@ -626,17 +628,37 @@ namespace vogl
         template <typename T>
         bool get_map(const char *pKey, T &hash_map) const;
 
+        enum
+        {
+            cKeyIndexThreshold = 16
+        };
+
     private:
         const json_node *m_pParent;
 
         dynamic_string_array m_keys;
         json_value_array m_values;
 
+        // Open addressing table of key indices plus one (0 is an empty slot), kept up to date by the methods which modify
+        // large objects and built when they're parsed. find_key() falls back to a linear scan while it's empty (e.g. after
+        // the non-const get_key()), it never builds it so const lookups are safe from several threads.
+        // Holds the first occurrence of each key, so lookups return the same index as a linear scan.
+        vogl::vector<uint> m_key_index;
+
         uint m_line;
 
         bool m_is_object;
 
         void ensure_is_object();
+
+        static uint hash_key(const char *pKey);
+        void build_key_index();
+        void update_key_index();
+        void add_to_key_index(uint index);
+        inline void invalidate_key_index()
+        {
+            m_key_index.clear();
+        }
         void serialize(json_growable_char_buf &buf, bool formatted, uint cur_index, uint max_line_len = CMaxLineLenDefault) const;
     };
 
@@ -697,6 +719,8 @@ namespace vogl
     };
 
     bool json_test();
+    bool json_key_index_test();
+    bool json_key_index_perf_test();
 
 } // namespace vogl
 
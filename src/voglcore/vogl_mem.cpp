@@ -31,6 +31,8 @@
 #include "vogl_port.h"
 #include "vogl_threading.h"
 #include "vogl_strutils.h"
+#include "vogl_rand.h"
+#include "vogl_timer.h"
 #include <malloc.h>
 
 // Set to 1 to enable stb_malloc, otherwise voglcore uses plain malloc/free/realloc
@@ -46,6 +48,17 @@
 #define VOGL_SCRUB_FREED_MEMORY 0
 #endif
 
+// Set to 1 to give each thread a small cache of free blocks, so most small allocs/frees don't take the heap mutex.
+// Only used with stb_malloc, and never when malloc debugging is enabled (rmalloc must see every block).
+#ifndef VOGL_USE_THREAD_HEAP_CACHE
+#define VOGL_USE_THREAD_HEAP_CACHE 1
+#endif
+
+#if !VOGL_USE_STB_MALLOC || VOGL_MALLOC_DEBUGGING || !defined(COMPILER_GCCLIKE)
+#undef VOGL_USE_THREAD_HEAP_CACHE
+#define VOGL_USE_THREAD_HEAP_CACHE 0
+#endif
+
 #if VOGL_RAND_FILL_ALLLOCATED_MEMORY || VOGL_SCRUB_FREED_MEMORY
 #pragma message("VOGL_RAND_FILL_ALLLOCATED_MEMORY and/or VOGL_SCRUB_FREED_MEMORY is enabled.")
 #endif
@@ -138,6 +151,10 @@ static void *rmalloc_realloc_callback(void *ptr, size_t size, void *pUser)
 }
 #endif
 
+#if VOGL_USE_THREAD_HEAP_CACHE
+static void init_thread_cache();
+#endif
+
 static void init_heap()
 {
     if (g_pHeap)
@@ -159,6 +176,10 @@ static void init_heap()
 #if VOGL_MALLOC_DEBUGGING
     Rmalloc_set_callbacks(rmalloc_malloc_callback, rmalloc_free_callback, rmalloc_realloc_callback, NULL);
 #endif
+
+#if VOGL_USE_THREAD_HEAP_CACHE
+    init_thread_cache();
+#endif
 }
 
 static void lock_heap()
@@ -187,12 +208,279 @@ static void unlock_heap()
 #endif
 }
 
+#if VOGL_USE_THREAD_HEAP_CACHE
+//----------------------------------------------------------------------------------------------------------------------
+// Per-thread block cache
+// Each thread keeps singly linked lists of free heap blocks, one per size class. Allocs pop from the list and frees push
+// onto it without locking. Lists are refilled from, and trimmed back to, the shared heap in batches under a single lock.
+// Cached blocks are still allocated as far as stb_malloc is concerned, so msize and realloc work on them unchanged.
+//----------------------------------------------------------------------------------------------------------------------
+enum
+{
+    cThreadCacheNumClasses = 28,
+    cThreadCacheMaxBlockSize = 2048,
+    cThreadCacheMaxClassBytes = 32 * 1024,
+    cThreadCacheMaxBytes = 512 * 1024
+};
+
+static const uint16_t g_thread_cache_class_sizes[cThreadCacheNumClasses] =
+{
+    16, 32, 48, 64, 80, 96, 112, 128, 144, 160, 176, 192, 208, 224, 240, 256,
+    320, 384, 448, 512, 640, 768, 896, 1024, 1280, 1536, 1792, 2048
+};
+
+// Maps (size + 15) / 16 to the smallest class that can hold size bytes.
+static uint8_t g_thread_cache_size_to_class[cThreadCacheMaxBlockSize / 16 + 1];
+static uint16_t g_thread_cache_class_max_blocks[cThreadCacheNumClasses];
+
+static pthread_key_t g_thread_cache_key;
+static bool g_thread_cache_key_valid;
+static bool g_thread_cache_enabled;
+
+struct thread_heap_cache
+{
+    void *m_pHeads[cThreadCacheNumClasses];
+    uint m_counts[cThreadCacheNumClasses];
+    size_t m_total_bytes;
+
+    // Set while the cache is being modified, so an alloc from a signal handler falls back to the locked heap.
+    bool m_busy;
+};
+
+static __thread thread_heap_cache *g_pThread_cache;
+static __thread bool g_thread_cache_unavailable;
+
+static inline void *&thread_cache_next(void *p)
+{
+    return *static_cast<void **>(p);
+}
+
+static void thread_cache_refill(thread_heap_cache *pCache, uint c)
+{
+    const uint block_size = g_thread_cache_class_sizes[c];
+    const uint num_blocks = g_thread_cache_class_max_blocks[c] / 2;
+
+    lock_heap();
+
+    for (uint i = 0; i < num_blocks; i++)
+    {
+        void *p = stbm_alloc(NULL, g_pHeap, block_size, 0);
+        if (!p)
+            break;
+
+        thread_cache_next(p) = pCache->m_pHeads[c];
+        pCache->m_pHeads[c] = p;
+        pCache->m_counts[c]++;
+        pCache->m_total_bytes += block_size;
+    }
+
+    unlock_heap();
+}
+
+// Caller must hold the heap lock.
+static void thread_cache_release_locked(thread_heap_cache *pCache, uint c, uint num_blocks)
+{
+    const uint block_size = g_thread_cache_class_sizes[c];
+
+    while ((num_blocks--) && (pCache->m_pHeads[c]))
+    {
+        void *p = pCache->m_pHeads[c];
+        pCache->m_pHeads[c] = thread_cache_next(p);
+        pCache->m_counts[c]--;
+        pCache->m_total_bytes -= block_size;
+
+        stbm_free(NULL, g_pHeap, p);
+    }
+}
+
+static void thread_cache_trim(thread_heap_cache *pCache, uint c)
+{
+    lock_heap();
+
+    if (pCache->m_total_bytes > cThreadCacheMaxBytes)
+    {
+        // Over the per-thread budget, so give back half of every list.
+        for (uint i = 0; i < cThreadCacheNumClasses; i++)
+            thread_cache_release_locked(pCache, i, (pCache->m_counts[i] + 1) / 2);
+    }
+    else
+    {
+        thread_cache_release_locked(pCache, c, pCache->m_counts[c] / 2);
+    }
+
+    unlock_heap();
+}
+
+static void thread_cache_flush(thread_heap_cache *pCache)
+{
+    lock_heap();
+
+    for (uint i = 0; i < cThreadCacheNumClasses; i++)
+        thread_cache_release_locked(pCache, i, pCache->m_counts[i]);
+
+    unlock_heap();
+}
+
+// Called by pthreads when a thread that used the cache exits.
+static void thread_cache_destroy(void *pData)
+{
+    thread_heap_cache *pCache = static_cast<thread_heap_cache *>(pData);
+    if (!pCache)
+        return;
+
+    // Anything allocated by later TLS destructors on this thread goes straight to the heap.
+    g_pThread_cache = NULL;
+    g_thread_cache_unavailable = true;
+
+    thread_cache_flush(pCache);
+
+    lock_heap();
+    stbm_free(NULL, g_pHeap, pCache);
+    unlock_heap();
+}
+
+static void init_thread_cache()
+{
+    uint c = 0;
+    for (uint i = 0; i < VOGL_ARRAY_SIZE(g_thread_cache_size_to_class); i++)
+    {
+        while (g_thread_cache_class_sizes[c] < i * 16)
+            c++;
+        g_thread_cache_size_to_class[i] = static_cast<uint8_t>(c);
+    }
+
+    for (uint i = 0; i < cThreadCacheNumClasses; i++)
+        g_thread_cache_class_max_blocks[i] = static_cast<uint16_t>(vogl::math::clamp<uint>(cThreadCacheMaxClassBytes / g_thread_cache_class_sizes[i], 8, 256));
+
+    if (pthread_key_create(&g_thread_cache_key, thread_cache_destroy) == 0)
+    {
+        g_thread_cache_key_valid = true;
+        g_thread_cache_enabled = true;
+    }
+}
+
+static thread_heap_cache *get_thread_cache()
+{
+    thread_heap_cache *pCache = g_pThread_cache;
+    if (pCache)
+        return pCache->m_busy ? NULL : pCache;
+
+    if ((!g_thread_cache_key_valid) || (g_thread_cache_unavailable))
+        return NULL;
+
+    lock_heap();
+    pCache = static_cast<thread_heap_cache *>(stbm_alloc(NULL, g_pHeap, sizeof(thread_heap_cache), 0));
+    unlock_heap();
+
+    if (!pCache)
+        return NULL;
+
+    memset(pCache, 0, sizeof(thread_heap_cache));
+
+    if (pthread_setspecific(g_thread_cache_key, pCache) != 0)
+    {
+        lock_heap();
+        stbm_free(NULL, g_pHeap, pCache);
+        unlock_heap();
+
+        g_thread_cache_unavailable = true;
+        return NULL;
+    }
+
+    g_pThread_cache = pCache;
+    return pCache;
+}
+
+static void *thread_cache_alloc(size_t size)
+{
+    if ((size > cThreadCacheMaxBlockSize) || (!g_thread_cache_enabled))
+        return NULL;
+
+    thread_heap_cache *pCache = get_thread_cache();
+    if (!pCache)
+        return NULL;
+
+    const uint c = g_thread_cache_size_to_class[(size + 15) >> 4];
+
+    pCache->m_busy = true;
+
+    if (!pCache->m_pHeads[c])
+        thread_cache_refill(pCache, c);
+
+    void *p = pCache->m_pHeads[c];
+    if (p)
+    {
+        pCache->m_pHeads[c] = thread_cache_next(p);
+        pCache->m_counts[c]--;
+        pCache->m_total_bytes -= g_thread_cache_class_sizes[c];
+    }
+
+    pCache->m_busy = false;
+
+    return p;
+}
+
+static bool thread_cache_free(void *p)
+{
+    if (!g_thread_cache_enabled)
+        return false;
+
+    // Only reads p's own header, which doesn't change while p is allocated.
+    const size_t size = stbm_get_allocation_size(p);
+    if ((size < g_thread_cache_class_sizes[0]) || (size > cThreadCacheMaxBlockSize))
+        return false;
+
+    thread_heap_cache *pCache = get_thread_cache();
+    if (!pCache)
+        return false;
+
+    // Blocks that didn't come from the cache (realloc'd, or bigger than their class) go into the largest class they can hold.
+    uint c = g_thread_cache_size_to_class[(size + 15) >> 4];
+    if (g_thread_cache_class_sizes[c] > size)
+        c--;
+
+    pCache->m_busy = true;
+
+    thread_cache_next(p) = pCache->m_pHeads[c];
+    pCache->m_pHeads[c] = p;
+    pCache->m_counts[c]++;
+    pCache->m_total_bytes += g_thread_cache_class_sizes[c];
+
+    if ((pCache->m_counts[c] > g_thread_cache_class_max_blocks[c]) || (pCache->m_total_bytes > cThreadCacheMaxBytes))
+        thread_cache_trim(pCache, c);
+
+    pCache->m_busy = false;
+
+    return true;
+}
+
+static bool set_thread_cache_enabled(bool enabled)
+{
+    bool prev_enabled = g_thread_cache_enabled;
+    g_thread_cache_enabled = enabled && g_thread_cache_key_valid;
+    return prev_enabled;
+}
+
+static void flush_thread_cache()
+{
+    thread_heap_cache *pCache = g_pThread_cache;
+    if ((pCache) && (!pCache->m_busy))
+        thread_cache_flush(pCache);
+}
+#endif // VOGL_USE_THREAD_HEAP_CACHE
+
 static void *malloc_block(size_t size, const char *pFile_line)
 {
     // If you hit this assert, it's most likely because vogl_core_init()
     //  (which calls vogl_init_heap) hasn't been called.
     VOGL_ASSERT(g_pHeap);
 
+#if VOGL_USE_THREAD_HEAP_CACHE
+    void *pCached = thread_cache_alloc(size);
+    if (pCached)
+        return pCached;
+#endif
+
     lock_heap();
 
 #if VOGL_MALLOC_DEBUGGING
@@ -207,10 +495,36 @@ static void *malloc_block(size_t size, const char *pFile_line)
     return p;
 }
 
+static void free_block(void *p, const char *pFile_line);
+
 static void *realloc_block(void *p, size_t size, const char *pFile_line)
 {
     VOGL_ASSERT(g_pHeap);
 
+#if VOGL_USE_THREAD_HEAP_CACHE
+    // Same policy as stbm_realloc(), but routed through malloc_block()/free_block() so small blocks use the thread cache.
+    if (!p)
+        return malloc_block(size, pFile_line);
+
+    if (!size)
+    {
+        free_block(p, pFile_line);
+        return NULL;
+    }
+
+    size_t old_size = stbm_get_allocation_size(p);
+    if ((size <= old_size) && (old_size <= size * 2))
+        return p;
+
+    void *q = malloc_block(size, pFile_line);
+    if (q)
+    {
+        memcpy(q, p, vogl::math::minimum(old_size, size));
+        free_block(p, pFile_line);
+    }
+
+    return q;
+#else
     lock_heap();
 
 #if VOGL_MALLOC_DEBUGGING
@@ -223,12 +537,18 @@ static void *realloc_block(void *p, size_t size, const char *pFile_line)
     unlock_heap();
 
     return q;
+#endif // VOGL_USE_THREAD_HEAP_CACHE
 }
 
 static void free_block(void *p, const char *pFile_line)
 {
     VOGL_ASSERT(g_pHeap);
 
+#if VOGL_USE_THREAD_HEAP_CACHE
+    if (thread_cache_free(p))
+        return;
+#endif
+
     lock_heap();
 
 #if VOGL_MALLOC_DEBUGGING
@@ -245,6 +565,11 @@ static size_t msize_block(void *p, const char *pFile_line)
 {
     VOGL_ASSERT(g_pHeap);
 
+#if VOGL_USE_THREAD_HEAP_CACHE
+    // The size lives in the block's own header, so this doesn't need the heap lock.
+    VOGL_NOTE_UNUSED(pFile_line);
+    return stbm_get_allocation_size(p);
+#else
     lock_heap();
 
 #if VOGL_MALLOC_DEBUGGING
@@ -257,6 +582,7 @@ static size_t msize_block(void *p, const char *pFile_line)
     unlock_heap();
 
     return n;
+#endif
 }
 
 static void print_stats(const char *pFile_line)
@@ -610,6 +936,23 @@ size_t vogl_msize(void *p)
     return msize_block(p, VOGL_FILE_POS_STRING);
 }
 
+bool vogl_set_thread_heap_cache_enabled(bool enabled)
+{
+#if VOGL_USE_THREAD_HEAP_CACHE
+    return set_thread_cache_enabled(enabled);
+#else
+    VOGL_NOTE_UNUSED(enabled);
+    return false;
+#endif
+}
+
+void vogl_flush_thread_heap_cache()
+{
+#if VOGL_USE_THREAD_HEAP_CACHE
+    flush_thread_cache();
+#endif
+}
+
 void vogl_tracked_print_stats(const char *pFile_line)
 {
     print_stats(pFile_line);
@@ -631,6 +974,110 @@ void vogl_tracked_check_heap(const char *pFile_line)
 #endif
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+// malloc_perf_test
+// Measures vogl_malloc/vogl_free throughput for 1-8 threads, with and without the per-thread heap caches.
+//----------------------------------------------------------------------------------------------------------------------
+struct malloc_perf_task_state
+{
+    uint32 m_seed;
+    uint m_num_iters;
+    bool m_failed;
+};
+
+static void malloc_perf_task(uint64_t data, void *pData_ptr)
+{
+    VOGL_NOTE_UNUSED(data);
+
+    malloc_perf_task_state *pState = static_cast<malloc_perf_task_state *>(pData_ptr);
+
+    const uint cNumSlots = 256;
+    uint8 *ptrs[cNumSlots];
+    uint sizes[cNumSlots];
+    memset(ptrs, 0, sizeof(ptrs));
+    memset(sizes, 0, sizeof(sizes));
+
+    random r;
+    r.seed(pState->m_seed);
+
+    for (uint i = 0; i < pState->m_num_iters; i++)
+    {
+        const uint slot = r.urand32() & (cNumSlots - 1);
+
+        if (ptrs[slot])
+        {
+            if ((ptrs[slot][0] != static_cast<uint8>(slot)) || (ptrs[slot][sizes[slot] - 1] != static_cast<uint8>(slot)))
+                pState->m_failed = true;
+
+            vogl_tracked_free(VOGL_FILE_POS_STRING, ptrs[slot]);
+        }
+
+        // Mostly packet/string sized blocks, with the occasional larger one.
+        uint size = (r.urand32() & 15) ? r.irand(1, 512) : r.irand(512, 8192);
+
+        ptrs[slot] = static_cast<uint8 *>(vogl_tracked_malloc(VOGL_FILE_POS_STRING, size));
+        sizes[slot] = size;
+
+        ptrs[slot][0] = static_cast<uint8>(slot);
+        ptrs[slot][size - 1] = static_cast<uint8>(slot);
+    }
+
+    for (uint i = 0; i < cNumSlots; i++)
+        vogl_tracked_free(VOGL_FILE_POS_STRING, ptrs[i]);
+}
+
+bool malloc_perf_test()
+{
+    const uint cNumIters = 500000;
+
+    bool success = true;
+
+    for (uint cache_enabled = 0; cache_enabled < 2; cache_enabled++)
+    {
+        bool prev_enabled = vogl_set_thread_heap_cache_enabled(cache_enabled != 0);
+
+        for (uint num_threads = 1; num_threads <= 8; num_threads *= 2)
+        {
+            malloc_perf_task_state states[8];
+            for (uint i = 0; i < num_threads; i++)
+            {
+                states[i].m_seed = 1000 + i;
+                states[i].m_num_iters = cNumIters;
+                states[i].m_failed = false;
+            }
+
+            task_pool pool;
+            pool.init(num_threads - 1);
+
+            timer tm;
+            tm.start();
+
+            for (uint i = 1; i < num_threads; i++)
+                pool.queue_task(malloc_perf_task, 0, &states[i]);
+
+            malloc_perf_task(0, &states[0]);
+
+            pool.join();
+
+            double secs = tm.get_elapsed_secs();
+
+            pool.deinit();
+            vogl_flush_thread_heap_cache();
+
+            for (uint i = 0; i < num_threads; i++)
+                success = success && !states[i].m_failed;
+
+            double total_ops = static_cast<double>(cNumIters) * num_threads;
+            printf("thread cache %s, threads: %u, %.3f secs, %.2f million alloc/free pairs per sec\n",
+                   cache_enabled ? "on" : "off", num_threads, secs, total_ops / math::maximum(secs, .000001) / 1000000.0);
+        }
+
+        vogl_set_thread_heap_cache_enabled(prev_enabled);
+    }
+
+    return success;
+}
+
 VOGL_NAMESPACE_END(vogl)
 
 extern "C" void *vogl_realloc(const char *pFile_line, void *p, size_t new_size)
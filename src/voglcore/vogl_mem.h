@@ -87,6 +87,15 @@ namespace vogl
 
     size_t vogl_msize(void *p);
 
+    // Small allocs/frees are served from a per-thread cache of free blocks when the heap is built with it (see
+    // VOGL_USE_THREAD_HEAP_CACHE in vogl_mem.cpp). Returns the previous enabled state, or false if it isn't compiled in.
+    bool vogl_set_thread_heap_cache_enabled(bool enabled);
+
+    // Returns all blocks cached by the calling thread to the shared heap. Threads flush their caches when they exit.
+    void vogl_flush_thread_heap_cache();
+
+    bool malloc_perf_test();
+
 	VOGL_NORETURN void vogl_mem_error(const char *pMsg, const char *pFile_line);
 
     // C++ new/delete wrappers that automatically pass in the file/line
@@ -71,6 +71,10 @@ vogl::int32 plat_get_virtual_page_size();
 void* plat_virtual_alloc(size_t size_requested, vogl::uint32 access_flags, size_t* out_size_provided);
 void plat_virtual_free(void* free_addr, size_t size);
 
+// Maps an entire file read only. Returns NULL on failure (including files too large for the address space).
+void* plat_map_file_read_only(const char* pFilename, uint64_t* out_size);
+void plat_unmap_file(void* map_addr, uint64_t size);
+
 #if VOGL_USE_PTHREADS_API
     int plat_sem_post(sem_t* sem, vogl::uint32 release_count);
     void plat_try_sem_post(sem_t* sem, vogl::uint32 release_count);
@@ -35,6 +35,7 @@
 #include <fcntl.h>
 #include <paths.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/syscall.h>
 #include <sys/time.h>
 
@@ -225,6 +226,43 @@ void plat_virtual_free(void* free_addr, size_t size)
     }
 }
 
+void* plat_map_file_read_only(const char* pFilename, uint64_t* out_size)
+{
+    *out_size = 0;
+
+    int fd = open(pFilename, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    struct stat st;
+    if ((fstat(fd, &st) != 0) || (st.st_size <= 0) || (static_cast<uint64_t>(st.st_size) != static_cast<size_t>(st.st_size)))
+    {
+        close(fd);
+        return NULL;
+    }
+
+    void *p = mmap(NULL, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping keeps its own reference to the file.
+    close(fd);
+
+    if (p == MAP_FAILED)
+        return NULL;
+
+    // Traces are mostly read front to back.
+    madvise(p, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+
+    *out_size = st.st_size;
+
+    return p;
+}
+
+void plat_unmap_file(void* map_addr, uint64_t size)
+{
+    if (map_addr)
+        munmap(map_addr, static_cast<size_t>(size));
+}
+
 #if VOGL_USE_PTHREADS_API
     int plat_sem_post(sem_t* sem, vogl::uint32 release_count)
     {
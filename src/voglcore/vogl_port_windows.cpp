@@ -209,6 +209,45 @@ void plat_virtual_free(void* free_addr, size_t size)
     }
 }
 
+void* plat_map_file_read_only(const char* pFilename, uint64_t* out_size)
+{
+    *out_size = 0;
+
+    HANDLE hFile = CreateFileA(pFilename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    LARGE_INTEGER file_size;
+    if ((!GetFileSizeEx(hFile, &file_size)) || (file_size.QuadPart <= 0) || (static_cast<uint64_t>(file_size.QuadPart) != static_cast<SIZE_T>(file_size.QuadPart)))
+    {
+        CloseHandle(hFile);
+        return NULL;
+    }
+
+    HANDLE hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(hFile);
+    if (!hMapping)
+        return NULL;
+
+    // The view keeps its own reference to the mapping object.
+    void* p = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(hMapping);
+    if (!p)
+        return NULL;
+
+    *out_size = file_size.QuadPart;
+
+    return p;
+}
+
+void plat_unmap_file(void* map_addr, uint64_t size)
+{
+    VOGL_NOTE_UNUSED(size);
+
+    if (map_addr)
+        UnmapViewOfFile(map_addr);
+}
+
 #if VOGL_USE_PTHREADS_API
     int plat_sem_post(sem_t* sem, vogl::uint32 release_count)
     {
@@ -365,6 +365,9 @@ void VoglEditor::playCurrentTraceFile()
     m_pPlayButton->setEnabled(false);
     m_pTrimButton->setEnabled(false);
 
+    // the whole trace gets replayed
+    m_pApiCallTreeModel->wait_for_load();
+
     m_traceReplayer.replay(m_pTraceReader, m_pApiCallTreeModel->root(), NULL, 0, true);
 
     m_pPlayButton->setEnabled(true);
@@ -566,6 +569,8 @@ void VoglEditor::on_actionExport_API_Calls_triggered()
 
         FILE* pFile = vogl_fopen(filename.c_str(), "w");
         vogleditor_QApiCallTreeModel* pModel = static_cast<vogleditor_QApiCallTreeModel*>(ui->treeView->model());
+        pModel->wait_for_load();
+
         vogleditor_apiCallTreeItem* pRoot = pModel->root();
         for (int i = 0; i < pRoot->childCount(); i++)
         {
@@ -995,7 +1000,7 @@ vogl_gl_state_snapshot* VoglEditor::read_state_snapshot_from_trace(vogl_trace_fi
       if (pTrace_reader->get_packet_type() != cTSPTGLEntrypoint)
          continue;
 
-      if (!keyframe_trace_packet.deserialize(pTrace_reader->get_packet_buf().get_ptr(), pTrace_reader->get_packet_buf().size(), false))
+      if (!keyframe_trace_packet.deserialize(pTrace_reader->get_packet_ptr(), pTrace_reader->get_packet_size(), false))
       {
          vogl_error_printf("%s: Failed parsing GL entrypoint packet in keyframe file\n", VOGL_FUNCTION_INFO_CSTR);
          return NULL;
@@ -1024,10 +1029,10 @@ vogl_gl_state_snapshot* VoglEditor::read_state_snapshot_from_trace(vogl_trace_fi
                dynamic_string cmd_type(kvm.get_string("command_type"));
                if (cmd_type == "state_snapshot")
                {
-                  dynamic_string id(kvm.get_string("binary_id"));
+                  dynamic_string id(vogl_gl_state_snapshot::get_blob_id(kvm));
                   if (id.is_empty())
                   {
-                     vogl_error_printf("%s: Missing binary_id field in glInternalTraceCommandRAD key_valye_map command type: \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, cmd_type.get_ptr());
+                     vogl_error_printf("%s: Missing native_id/binary_id field in glInternalTraceCommandRAD key_valye_map command type: \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, cmd_type.get_ptr());
                      return NULL;
                   }
 
@@ -1043,20 +1048,10 @@ vogl_gl_state_snapshot* VoglEditor::read_state_snapshot_from_trace(vogl_trace_fi
 
                   vogl_message_printf("%s: Deserializing state snapshot \"%s\", %u bytes\n", VOGL_FUNCTION_INFO_CSTR, id.get_ptr(), snapshot_data.size());
 
-                  json_document doc;
-                  {
-                     timed_scope ts("doc.binary_deserialize");
-                     if (!doc.binary_deserialize(snapshot_data) || (!doc.get_root()))
-                     {
-                        vogl_error_printf("%s: Failed deserializing JSON snapshot blob data \"%s\"!\n", VOGL_FUNCTION_INFO_CSTR, id.get_ptr());
-                        return NULL;
-                     }
-                  }
-
                   pSnapshot = vogl_new(vogl_gl_state_snapshot);
 
-                  timed_scope ts("pSnapshot->deserialize");
-                  if (!pSnapshot->deserialize(*doc.get_root(), pTrace_reader->get_multi_blob_manager(), &trace_gl_ctypes))
+                  timed_scope ts("pSnapshot->deserialize_blob");
+                  if (!pSnapshot->deserialize_blob(snapshot_data, pTrace_reader->get_multi_blob_manager(), &trace_gl_ctypes))
                   {
                      vogl_delete(pSnapshot);
                      pSnapshot = NULL;
@@ -1162,6 +1157,9 @@ bool VoglEditor::open_trace_file(dynamic_string filename)
       return false;
    }
 
+   // the rest of the frames are added to the tree as they load
+   connect(m_pApiCallTreeModel, SIGNAL(loadFinished(bool)), this, SLOT(slot_apiCallTreeModel_loadFinished(bool)));
+
    ui->treeView->setModel(m_pApiCallTreeModel);
 
    if (ui->treeView->selectionModel() != NULL)
@@ -1271,6 +1269,21 @@ bool VoglEditor::open_trace_file(dynamic_string filename)
    return true;
 }
 
+void VoglEditor::slot_apiCallTreeModel_loadFinished(bool bSuccess)
+{
+   if (!bSuccess)
+   {
+      vogleditor_output_error("The API calls within the trace could not be parsed properly, only the frames that were read are shown.");
+   }
+
+   // the timeline was created with the frames that were loaded at the time
+   if (m_pTimelineModel != NULL)
+   {
+      m_pTimelineModel->refresh();
+      m_timeline->repaint();
+   }
+}
+
 void VoglEditor::displayMachineInfoHelper(QString prefix, const QString& sectionKeyStr, const vogl::json_value& value, QString& rMachineInfoStr)
 {
     if (value.is_array())
@@ -2109,6 +2122,7 @@ void VoglEditor::slot_program_edited(vogl_arb_program_state* pNewProgramState)
 
     // update all the snapshot flags
     bool bFoundEditedSnapshot = false;
+    m_pApiCallTreeModel->wait_for_load();
     recursive_update_snapshot_flags(m_pApiCallTreeModel->root(), bFoundEditedSnapshot);
 
     // give the tree view focus so that it redraws. This is something of a hack, we don't really want to be changing around which control has focus,
@@ -2126,6 +2140,7 @@ void VoglEditor::slot_program_edited(vogl_program_state* pNewProgramState)
 
     // update all the snapshot flags
     bool bFoundEditedSnapshot = false;
+    m_pApiCallTreeModel->wait_for_load();
     recursive_update_snapshot_flags(m_pApiCallTreeModel->root(), bFoundEditedSnapshot);
 
     // give the tree view focus so that it redraws. This is something of a hack, we don't really want to be changing around which control has focus,
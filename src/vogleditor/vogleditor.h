@@ -74,6 +74,8 @@ private slots:
 
    void slot_treeView_currentChanged(const QModelIndex & current, const QModelIndex & previous);
 
+   void slot_apiCallTreeModel_loadFinished(bool bSuccess);
+
    void on_treeView_clicked(const QModelIndex& index);
 
    void playCurrentTraceFile();
@@ -32,19 +32,21 @@
 
 // predeclared classes
 class vogleditor_frameItem;
-class vogl_trace_packet;
 
+// Compact record of a single api call. The deserialized vogl_trace_packet isn't kept here, it's reloaded
+// from the trace on demand through vogleditor_QApiCallTreeModel::get_trace_packet() using the packet location.
 class vogleditor_apiCallItem : public vogleditor_snapshotItem
 {
 public:
-   vogleditor_apiCallItem(vogleditor_frameItem* pFrame, vogl_trace_packet* pTracePacket, const vogl_trace_gl_entrypoint_packet& glPacket)
+   vogleditor_apiCallItem(vogleditor_frameItem* pFrame, const vogl_trace_gl_entrypoint_packet& glPacket, uint64_t packetLocation)
        : m_pParentFrame(pFrame),
-        m_glPacket(glPacket),
-        m_pTracePacket(pTracePacket),
+        m_packetLocation(packetLocation),
         m_globalCallIndex(glPacket.m_call_counter),
         m_begin_rdtsc(glPacket.m_packet_begin_rdtsc),
         m_end_rdtsc(glPacket.m_packet_end_rdtsc),
-        m_backtrace_hash_index(glPacket.m_backtrace_hash_index)
+        m_context_handle(glPacket.m_context_handle),
+        m_backtrace_hash_index(glPacket.m_backtrace_hash_index),
+        m_entrypoint_id(glPacket.m_entrypoint_id)
    {
       if (m_end_rdtsc < m_begin_rdtsc)
       {
@@ -52,18 +54,15 @@ public:
       }
    }
 
-   ~vogleditor_apiCallItem()
+   inline vogleditor_frameItem* frame() const
    {
-       if (m_pTracePacket != NULL)
-       {
-           vogl_delete(m_pTracePacket);
-           m_pTracePacket = NULL;
-       }
+      return m_pParentFrame;
    }
 
-   inline vogleditor_frameItem* frame() const
+   // Where the call's packet lives in the trace, see vogleditor_QApiCallTreeModel::get_trace_packet().
+   inline uint64_t packetLocation() const
    {
-      return m_pParentFrame;
+      return m_packetLocation;
    }
 
    inline uint64_t globalCallIndex() const
@@ -86,14 +85,14 @@ public:
       return endTime() - startTime();
    }
 
-   const vogl_trace_gl_entrypoint_packet* getGLPacket() const
+   inline uint64_t contextHandle() const
    {
-      return &m_glPacket;
+      return m_context_handle;
    }
 
-   vogl_trace_packet* getTracePacket()
+   inline gl_entrypoint_id_t entrypointId() const
    {
-      return m_pTracePacket;
+      return static_cast<gl_entrypoint_id_t>(m_entrypoint_id);
    }
 
    inline uint64_t backtraceHashIndex() const
@@ -103,13 +102,14 @@ public:
 
 private:
    vogleditor_frameItem* m_pParentFrame;
-   const vogl_trace_gl_entrypoint_packet m_glPacket;
-   vogl_trace_packet* m_pTracePacket;
+   uint64_t m_packetLocation;
 
    uint64_t m_globalCallIndex;
    uint64_t m_begin_rdtsc;
    uint64_t m_end_rdtsc;
-   uint64_t m_backtrace_hash_index;
+   uint64_t m_context_handle;
+   uint32 m_backtrace_hash_index;
+   uint16 m_entrypoint_id;
 };
 
 #endif // VOGLEDITOR_APICALLITEM_H
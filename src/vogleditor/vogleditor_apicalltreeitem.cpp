@@ -40,15 +40,9 @@ vogleditor_apiCallTreeItem::vogleditor_apiCallTreeItem(vogleditor_QApiCallTreeMo
    m_pApiCallItem(NULL),
    m_pFrameItem(NULL),
    m_pModel(pModel),
-   m_localRowIndex(0)
+   m_localRowIndex(0),
+   m_flatIndex(0)
 {
-    m_columnData[VOGL_ACTC_APICALL] = "API Call";
-    m_columnData[VOGL_ACTC_INDEX] = "Index";
-    m_columnData[VOGL_ACTC_FLAGS] = "";
-    m_columnData[VOGL_ACTC_GLCONTEXT] = "GL Context";
-    //m_ColumnTitles[VOGL_ACTC_BEGINTIME] = "Begin Time";
-    //m_ColumnTitles[VOGL_ACTC_ENDTIME] = "End Time";
-    m_columnData[VOGL_ACTC_DURATION] = "Duration (ns)";
 }
 
 // Constructor for frame nodes
@@ -57,15 +51,9 @@ vogleditor_apiCallTreeItem::vogleditor_apiCallTreeItem(vogleditor_frameItem* fra
    m_pApiCallItem(NULL),
    m_pFrameItem(frameItem),
    m_pModel(NULL),
-   m_localRowIndex(0)
+   m_localRowIndex(0),
+   m_flatIndex(0)
 {
-   if (frameItem != NULL)
-   {
-      QString tmp;
-      tmp.sprintf("Frame %" PRIu64, frameItem->frameNumber());
-      m_columnData[VOGL_ACTC_APICALL] = tmp;
-   }
-
    if (m_parentItem != NULL)
    {
       m_pModel = m_parentItem->m_pModel;
@@ -73,26 +61,14 @@ vogleditor_apiCallTreeItem::vogleditor_apiCallTreeItem(vogleditor_frameItem* fra
 }
 
 // Constructor for apiCall nodes
-vogleditor_apiCallTreeItem::vogleditor_apiCallTreeItem(QString nodeText, vogleditor_apiCallItem* apiCallItem, vogleditor_apiCallTreeItem* parent)
+vogleditor_apiCallTreeItem::vogleditor_apiCallTreeItem(vogleditor_apiCallItem* apiCallItem, vogleditor_apiCallTreeItem* parent)
  : m_parentItem(parent),
    m_pApiCallItem(apiCallItem),
    m_pFrameItem(NULL),
    m_pModel(NULL),
-   m_localRowIndex(0)
+   m_localRowIndex(0),
+   m_flatIndex(0)
 {
-   m_columnData[VOGL_ACTC_APICALL] = nodeText;
-
-   if (apiCallItem != NULL)
-   {
-      m_columnData[VOGL_ACTC_INDEX] = (qulonglong)apiCallItem->globalCallIndex();
-      m_columnData[VOGL_ACTC_FLAGS] = "";
-      dynamic_string strContext;
-      m_columnData[VOGL_ACTC_GLCONTEXT] = strContext.format("0x%" PRIx64, apiCallItem->getGLPacket()->m_context_handle).c_str();
-      //m_columnData[VOGL_ACTC_BEGINTIME] = apiCallItem->startTime();
-      //m_columnData[VOGL_ACTC_ENDTIME] = apiCallItem->endTime();
-      m_columnData[VOGL_ACTC_DURATION] = (qulonglong)apiCallItem->duration();
-   }
-
    if (m_parentItem != NULL)
    {
       m_pModel = m_parentItem->m_pModel;
@@ -251,7 +227,51 @@ QVariant vogleditor_apiCallTreeItem::columnData(int column, int role) const
 
    if (role == Qt::DisplayRole)
    {
-       return m_columnData[column];
+       if (m_parentItem == NULL)
+       {
+           // the root node holds the column titles
+           switch (column)
+           {
+           case VOGL_ACTC_APICALL: return "API Call";
+           case VOGL_ACTC_INDEX: return "Index";
+           case VOGL_ACTC_GLCONTEXT: return "GL Context";
+           //case VOGL_ACTC_BEGINTIME: return "Begin Time";
+           //case VOGL_ACTC_ENDTIME: return "End Time";
+           case VOGL_ACTC_DURATION: return "Duration (ns)";
+           default: return "";
+           }
+       }
+
+       if (m_pFrameItem != NULL)
+       {
+           if (column == VOGL_ACTC_APICALL)
+           {
+               QString tmp;
+               tmp.sprintf("Frame %" PRIu64, m_pFrameItem->frameNumber());
+               return tmp;
+           }
+       }
+       else if (m_pApiCallItem != NULL)
+       {
+           switch (column)
+           {
+           case VOGL_ACTC_APICALL:
+               return m_pModel->get_api_call_string(m_pApiCallItem);
+           case VOGL_ACTC_INDEX:
+               return (qulonglong)m_pApiCallItem->globalCallIndex();
+           case VOGL_ACTC_GLCONTEXT:
+           {
+               dynamic_string strContext;
+               return strContext.format("0x%" PRIx64, m_pApiCallItem->contextHandle()).c_str();
+           }
+           //case VOGL_ACTC_BEGINTIME: return (qulonglong)m_pApiCallItem->startTime();
+           //case VOGL_ACTC_ENDTIME: return (qulonglong)m_pApiCallItem->endTime();
+           case VOGL_ACTC_DURATION:
+               return (qulonglong)m_pApiCallItem->duration();
+           default:
+               return "";
+           }
+       }
    }
 
    return QVariant();
@@ -59,13 +59,18 @@ public:
    // Constructor for frame nodes
    vogleditor_apiCallTreeItem(vogleditor_frameItem* frameItem, vogleditor_apiCallTreeItem* parent);
 
-   // Constructor for apiCall nodes
-   vogleditor_apiCallTreeItem(QString nodeText, vogleditor_apiCallItem* apiCallItem, vogleditor_apiCallTreeItem* parent);
+   // Constructor for apiCall nodes, the api call text is formatted by the model when the row is displayed
+   vogleditor_apiCallTreeItem(vogleditor_apiCallItem* apiCallItem, vogleditor_apiCallTreeItem* parent);
 
    ~vogleditor_apiCallTreeItem();
 
    vogleditor_apiCallTreeItem* parent() const;
 
+   vogleditor_QApiCallTreeModel* model() const
+   {
+      return m_pModel;
+   }
+
    void appendChild(vogleditor_apiCallTreeItem* pChild);
 
    int childCount() const;
@@ -88,14 +93,25 @@ public:
 
    int row() const;
 
+   // position of the item in the model's flattened list of items
+   inline uint flatIndex() const
+   {
+      return m_flatIndex;
+   }
+
+   inline void setFlatIndex(uint index)
+   {
+      m_flatIndex = index;
+   }
+
 private:
    QList<vogleditor_apiCallTreeItem*> m_childItems;
-   QVariant m_columnData[VOGL_MAX_ACTC];
    vogleditor_apiCallTreeItem* m_parentItem;
    vogleditor_apiCallItem* m_pApiCallItem;
    vogleditor_frameItem* m_pFrameItem;
    vogleditor_QApiCallTreeModel* m_pModel;
    int m_localRowIndex;
+   uint m_flatIndex;
 };
 
 #endif // VOGLEDITOR_APICALLTREEITEM_H
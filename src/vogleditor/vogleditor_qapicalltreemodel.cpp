@@ -36,14 +36,72 @@
 #include "vogleditor_apicalltreeitem.h"
 #include "vogleditor_output.h"
 
+struct vogleditor_QApiCallTreeModel::cached_frame
+{
+   uint m_frame_index;
+   vogl_trace_packet_array m_packets;
+};
+
 vogleditor_QApiCallTreeModel::vogleditor_QApiCallTreeModel(QObject *parent)
-    : QAbstractItemModel(parent)
+    : QAbstractItemModel(parent),
+      m_pTrace_reader(NULL),
+      m_cache_head(-1),
+      m_cache_tail(-1),
+      m_pLoader_reader(NULL),
+      m_cancel_load(false),
+      m_loader_done(false),
+      m_loading(false),
+      m_load_succeeded(false),
+      m_total_swaps(0),
+      m_json_packet_index(0),
+      m_pPendingSnapshot(NULL)
 {
     m_rootItem = vogl_new(vogleditor_apiCallTreeItem, this);
+
+    connect(&m_append_timer, SIGNAL(timeout()), this, SLOT(slot_append_loaded_frames()));
 }
 
 vogleditor_QApiCallTreeModel::~vogleditor_QApiCallTreeModel()
 {
+   m_append_timer.stop();
+
+   m_cancel_load = true;
+   m_loader_pool.deinit();
+
+   // frames the loader finished but which were never added to the tree
+   for (uint i = 0; i < m_loaded_frames.size(); i++)
+   {
+      vogl_delete(m_loaded_frames[i]);
+   }
+   m_loaded_frames.clear();
+   m_loaded_items.clear();
+
+   if (m_pPendingSnapshot != NULL)
+   {
+      vogl_delete(m_pPendingSnapshot);
+      m_pPendingSnapshot = NULL;
+   }
+
+   if (m_pLoader_reader != NULL)
+   {
+      m_pLoader_reader->close();
+      vogl_delete(m_pLoader_reader);
+      m_pLoader_reader = NULL;
+   }
+
+   for (uint i = 0; i < m_packet_cache.size(); i++)
+   {
+      vogl_delete(m_packet_cache[i].m_pPacket);
+   }
+   m_packet_cache.clear();
+   m_packet_cache_map.clear();
+
+   for (uint i = 0; i < m_frame_cache.size(); i++)
+   {
+      vogl_delete(m_frame_cache[i]);
+   }
+   m_frame_cache.clear();
+
    if (m_rootItem != NULL)
    {
       vogl_delete(m_rootItem);
@@ -55,219 +113,556 @@ vogleditor_QApiCallTreeModel::~vogleditor_QApiCallTreeModel()
 
 bool vogleditor_QApiCallTreeModel::init(vogl_trace_file_reader* pTrace_reader)
 {
-   vogleditor_apiCallTreeItem* parent = m_rootItem;
-   const vogl_trace_stream_start_of_file_packet &sof_packet = pTrace_reader->get_sof_packet();
-   VOGL_NOTE_UNUSED(sof_packet);
+   m_pTrace_reader = pTrace_reader;
+
+   m_trace_ctypes.init(pTrace_reader->get_sof_packet().m_pointer_sizes);
+
+   // The loader gets its own reader, pTrace_reader stays on the UI thread for reloading packets.
+   m_pLoader_reader = vogl_create_trace_file_reader(pTrace_reader->get_type());
+   if ((m_pLoader_reader == NULL) || (!m_pLoader_reader->open(pTrace_reader->get_filename(), NULL)))
+   {
+      vogleditor_output_error("Failed opening the trace file for reading the API calls.");
+      return false;
+   }
+
+   // read the first frame right away so there is something to show
+   load_status_t status = load_frame();
+   append_loaded_frames();
+
+   if (status == cLoadFailed)
+   {
+      return false;
+   }
+   else if (status == cLoadDone)
+   {
+      return m_load_succeeded;
+   }
+
+   // load the rest in the background
+   m_loading = true;
+   m_loader_pool.init(1);
+   m_loader_pool.queue_object_task(this, &vogleditor_QApiCallTreeModel::load_task);
+
+   m_append_timer.start(100);
+
+   return true;
+}
+
+bool vogleditor_QApiCallTreeModel::wait_for_load()
+{
+   if (m_loading)
+   {
+      m_loader_pool.join();
+      slot_append_loaded_frames();
+   }
+
+   return m_load_succeeded;
+}
+
+void vogleditor_QApiCallTreeModel::load_task(uint64_t data, void* pData_ptr)
+{
+   VOGL_NOTE_UNUSED(data);
+   VOGL_NOTE_UNUSED(pData_ptr);
+
+   while (!m_cancel_load)
+   {
+      if (load_frame() != cLoadOK)
+         break;
+   }
+
+   scoped_mutex lock(m_loaded_frames_mutex);
+   m_loader_done = true;
+}
+
+void vogleditor_QApiCallTreeModel::slot_append_loaded_frames()
+{
+   if (!m_loading)
+      return;
+
+   bool bDone;
+   {
+      scoped_mutex lock(m_loaded_frames_mutex);
+      bDone = m_loader_done;
+   }
+
+   if (bDone)
+   {
+      m_loader_pool.join();
+   }
+
+   append_loaded_frames();
+
+   if (bDone)
+   {
+      m_loading = false;
+      m_append_timer.stop();
+
+      vogl_printf("Loaded %u frames, %u tree items\n", m_rootItem->childCount(), m_itemList.size());
+
+      emit loadFinished(m_load_succeeded);
+   }
+}
+
+void vogleditor_QApiCallTreeModel::append_loaded_frames()
+{
+   vogl::vector<vogleditor_apiCallTreeItem*> frames;
+   vogl::vector<vogleditor_apiCallTreeItem*> items;
+   {
+      scoped_mutex lock(m_loaded_frames_mutex);
+      frames.swap(m_loaded_frames);
+      items.swap(m_loaded_items);
+   }
+
+   if (frames.is_empty())
+      return;
+
+   int firstRow = m_rootItem->childCount();
+   beginInsertRows(QModelIndex(), firstRow, firstRow + frames.size() - 1);
+
+   for (uint i = 0; i < frames.size(); i++)
+   {
+      m_rootItem->appendChild(frames[i]);
+   }
+
+   m_itemList.reserve(m_itemList.size() + items.size());
+   for (uint i = 0; i < items.size(); i++)
+   {
+      items[i]->setFlatIndex(m_itemList.size());
+      m_itemList.push_back(items[i]);
+   }
+
+   endInsertRows();
+}
+
+bool vogleditor_QApiCallTreeModel::read_snapshot(vogl_trace_file_reader* pTrace_reader)
+{
+   vogl_trace_packet trace_packet(&m_trace_ctypes);
+   if (!trace_packet.deserialize(pTrace_reader->get_packet_ptr(), pTrace_reader->get_packet_size(), false))
+   {
+      vogl_warning_printf("%s: Failed parsing glInternalTraceCommandRAD packet\n", VOGL_FUNCTION_INFO_CSTR);
+      return false;
+   }
+
+   // Check if this is a state snapshot.
+   // This is entirely optional since the client is designed to dynamically get new snapshots
+   // if they don't exist.
+   GLuint cmd = trace_packet.get_param_value<GLuint>(0);
+   GLuint size = trace_packet.get_param_value<GLuint>(1); VOGL_NOTE_UNUSED(size);
+
+   if (cmd != cITCRKeyValueMap)
+      return true;
+
+   key_value_map &kvm = trace_packet.get_key_value_map();
+
+   dynamic_string cmd_type(kvm.get_string("command_type"));
+   if (cmd_type != "state_snapshot")
+      return true;
+
+   dynamic_string id(vogl_gl_state_snapshot::get_blob_id(kvm));
+   if (id.is_empty())
+   {
+      vogl_warning_printf("%s: Missing native_id/binary_id field in glInternalTraceCommandRAD key_value_map command type: \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, cmd_type.get_ptr());
+      return false;
+   }
+
+   uint8_vec snapshot_data;
+   {
+      timed_scope ts("get_multi_blob_manager().get");
+      if (!pTrace_reader->get_multi_blob_manager().get(id, snapshot_data) || (snapshot_data.is_empty()))
+      {
+         vogl_warning_printf("%s: Failed reading snapshot blob data \"%s\"!\n", VOGL_FUNCTION_INFO_CSTR, id.get_ptr());
+         return false;
+      }
+   }
+
+   if (m_pPendingSnapshot != NULL)
+   {
+      vogl_delete(m_pPendingSnapshot);
+      m_pPendingSnapshot = NULL;
+   }
+
+   vogl_gl_state_snapshot* pGLSnapshot = vogl_new(vogl_gl_state_snapshot);
+   m_pPendingSnapshot = vogl_new(vogleditor_gl_state_snapshot, pGLSnapshot);
+
+   timed_scope ts("pPendingSnapshot->deserialize_blob");
+   if (!m_pPendingSnapshot->get_snapshot()->deserialize_blob(snapshot_data, pTrace_reader->get_multi_blob_manager(), &m_trace_ctypes))
+   {
+      vogl_delete(m_pPendingSnapshot);
+      m_pPendingSnapshot = NULL;
 
-   uint64_t total_swaps = 0;
-   bool found_eof_packet = false;
+      vogl_warning_printf("%s: Failed deserializing snapshot blob data \"%s\"!\n", VOGL_FUNCTION_INFO_CSTR, id.get_ptr());
+      return false;
+   }
+
+   return true;
+}
+
+// Reads the api calls of the next frame with the loader's reader. The frame's items are detached from the tree
+// until append_loaded_frames() adds them, so this may run on the loader thread.
+vogleditor_QApiCallTreeModel::load_status_t vogleditor_QApiCallTreeModel::load_frame()
+{
+   vogl_trace_file_reader* pTrace_reader = m_pLoader_reader;
+   vogl_binary_trace_file_reader* pBinary_reader = NULL;
+   if (pTrace_reader->get_type() == cBINARY_TRACE_FILE_READER)
+      pBinary_reader = static_cast<vogl_binary_trace_file_reader*>(pTrace_reader);
 
    // make a PendingFrame node to hold the api calls
    // this will remain in the pending state until the first
-   // api call is seen, then it will be made the CurFrame and
-   // appended to the parent
+   // api call is seen, then it will be made the CurFrame
    vogleditor_frameItem* pCurFrame = NULL;
-   vogleditor_apiCallTreeItem* pCurParent = parent;
+   vogleditor_apiCallTreeItem* pFrameNode = NULL;
+   vogleditor_apiCallTreeItem* pCurParent = NULL;
+   vogl::vector<vogleditor_apiCallTreeItem*> items;
 
-   // Make a PendingSnapshot that may or may not be populated when reading the trace.
-   // This snapshot will be assigned to the next API call that occurs.
-   vogleditor_gl_state_snapshot* pPendingSnapshot = NULL;
-
-   m_trace_ctypes.init(pTrace_reader->get_sof_packet().m_pointer_sizes);
+   load_status_t status = cLoadOK;
 
    for ( ; ; )
    {
+      if (m_cancel_load)
+      {
+         status = cLoadFailed;
+         break;
+      }
+
+      // Binary packets are reloaded by seeking to their offset, JSON packets by their frame and index within the frame.
+      uint64_t packet_location = 0;
+      if (pBinary_reader != NULL)
+         packet_location = pBinary_reader->get_cur_packet_ofs();
+
+      uint prev_reader_frame = pTrace_reader->get_cur_frame();
+
       vogl_trace_file_reader::trace_file_reader_status_t read_status = pTrace_reader->read_next_packet();
 
       if ((read_status != vogl_trace_file_reader::cOK) && (read_status != vogl_trace_file_reader::cEOF))
       {
-         vogleditor_output_error("Failed reading from trace file!");
-         return false;
+         vogl_error_printf("%s: Failed reading from trace file!\n", VOGL_FUNCTION_INFO_CSTR);
+         status = cLoadFailed;
+         break;
       }
 
       if (read_status == vogl_trace_file_reader::cEOF)
       {
-         vogl_printf("At trace file EOF on swap %" PRIu64 "\n", total_swaps);
-         return false;
+         vogl_printf("At trace file EOF on swap %" PRIu64 "\n", m_total_swaps);
+         status = cLoadDone;
+         break;
       }
 
-      const vogl::vector<uint8> &packet_buf = pTrace_reader->get_packet_buf(); VOGL_NOTE_UNUSED(packet_buf);
+      if (pBinary_reader == NULL)
+      {
+         if (pTrace_reader->get_cur_frame() != prev_reader_frame)
+            m_json_packet_index = 0;
 
-      const vogl_trace_stream_packet_base &base_packet = pTrace_reader->get_base_packet(); VOGL_NOTE_UNUSED(base_packet);
-      const vogl_trace_gl_entrypoint_packet *pGL_packet = NULL;
+         packet_location = (static_cast<uint64_t>(pTrace_reader->get_cur_frame()) << 32U) | m_json_packet_index;
+         m_json_packet_index++;
+      }
 
-      if (pTrace_reader->get_packet_type() == cTSPTGLEntrypoint)
+      if (pTrace_reader->get_packet_type() == cTSPTEOF)
       {
-         vogl_trace_packet* pTrace_packet = vogl_new(vogl_trace_packet, &m_trace_ctypes);
+         m_load_succeeded = true;
+         vogl_printf("Found trace file EOF packet on swap %" PRIu64 "\n", m_total_swaps);
+         status = cLoadDone;
+         break;
+      }
 
-         if (!pTrace_packet->deserialize(pTrace_reader->get_packet_buf().get_ptr(), pTrace_reader->get_packet_buf().size(), false))
-         {
-             vogleditor_output_error("Failed parsing GL entrypoint packet.");
-             return false;
-         }
+      if (pTrace_reader->get_packet_type() != cTSPTGLEntrypoint)
+         continue;
 
-         if (!pTrace_packet->check())
+      const vogl_trace_gl_entrypoint_packet &gl_packet = pTrace_reader->get_packet<vogl_trace_gl_entrypoint_packet>();
+      gl_entrypoint_id_t entrypoint_id = static_cast<gl_entrypoint_id_t>(gl_packet.m_entrypoint_id);
+
+      if (entrypoint_id >= VOGL_NUM_ENTRYPOINTS)
+      {
+         vogl_error_printf("%s: Invalid entrypoint ID %u in GL entrypoint packet\n", VOGL_FUNCTION_INFO_CSTR, entrypoint_id);
+         status = cLoadFailed;
+         break;
+      }
+
+      if (entrypoint_id == VOGL_ENTRYPOINT_glInternalTraceCommandRAD)
+      {
+         read_snapshot(pTrace_reader);
+         continue;
+      }
+
+      // if we don't have a current frame, make a new frame node
+      if (pCurFrame == NULL)
+      {
+         pCurFrame = vogl_new(vogleditor_frameItem, m_total_swaps);
+         pFrameNode = vogl_new(vogleditor_apiCallTreeItem, pCurFrame, m_rootItem);
+         items.push_back(pFrameNode);
+
+         if (m_pPendingSnapshot != NULL)
          {
-             vogleditor_output_error("GL entrypoint packet failed consistency check. Please make sure the trace was made with the most recent version of VOGL.");
-             return false;
+            pCurFrame->set_snapshot(m_pPendingSnapshot);
+            m_pPendingSnapshot = NULL;
          }
 
-         pGL_packet = &pTrace_reader->get_packet<vogl_trace_gl_entrypoint_packet>();
-         gl_entrypoint_id_t entrypoint_id = static_cast<gl_entrypoint_id_t>(pGL_packet->m_entrypoint_id);
+         // update current parent
+         pCurParent = pFrameNode;
+      }
 
-         if (entrypoint_id == VOGL_ENTRYPOINT_glInternalTraceCommandRAD)
-         {
-            // Check if this is a state snapshot.
-            // This is entirely optional since the client is designed to dynamically get new snapshots
-            // if they don't exist.
-            GLuint cmd = pTrace_packet->get_param_value<GLuint>(0);
-            GLuint size = pTrace_packet->get_param_value<GLuint>(1); VOGL_NOTE_UNUSED(size);
+      // make item and node for the api call
+      vogleditor_apiCallItem* pCallItem = vogl_new(vogleditor_apiCallItem, pCurFrame, gl_packet, packet_location);
+      pCurFrame->appendCall(pCallItem);
 
-            if (cmd == cITCRKeyValueMap)
-            {
-               key_value_map &kvm = pTrace_packet->get_key_value_map();
-
-               dynamic_string cmd_type(kvm.get_string("command_type"));
-               if (cmd_type == "state_snapshot")
-               {
-                  dynamic_string id(kvm.get_string("binary_id"));
-                  if (id.is_empty())
-                  {
-                     vogl_warning_printf("%s: Missing binary_id field in glInternalTraceCommandRAD key_value_map command type: \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, cmd_type.get_ptr());
-                     continue;
-                  }
-
-                  uint8_vec snapshot_data;
-                  {
-                     timed_scope ts("get_multi_blob_manager().get");
-                     if (!pTrace_reader->get_multi_blob_manager().get(id, snapshot_data) || (snapshot_data.is_empty()))
-                     {
-                        vogl_warning_printf("%s: Failed reading snapshot blob data \"%s\"!\n", VOGL_FUNCTION_INFO_CSTR, id.get_ptr());
-                        continue;
-                     }
-                  }
-
-                  json_document doc;
-                  {
-                     timed_scope ts("doc.binary_deserialize");
-                     if (!doc.binary_deserialize(snapshot_data) || (!doc.get_root()))
-                     {
-                        vogl_warning_printf("%s: Failed deserializing JSON snapshot blob data \"%s\"!\n", VOGL_FUNCTION_INFO_CSTR, id.get_ptr());
-                        continue;
-                     }
-                  }
-
-                  vogl_gl_state_snapshot* pGLSnapshot = vogl_new(vogl_gl_state_snapshot);
-                  pPendingSnapshot = vogl_new(vogleditor_gl_state_snapshot, pGLSnapshot);
-
-                  timed_scope ts("pPendingSnapshot->deserialize");
-                  if (!pPendingSnapshot->get_snapshot()->deserialize(*doc.get_root(), pTrace_reader->get_multi_blob_manager(), &m_trace_ctypes))
-                  {
-                     vogl_delete(pPendingSnapshot);
-                     pPendingSnapshot = NULL;
-
-                     vogl_warning_printf("%s: Failed deserializing snapshot blob data \"%s\"!\n", VOGL_FUNCTION_INFO_CSTR, id.get_ptr());
-                  }
-               }
-            }
+      if (m_pPendingSnapshot != NULL)
+      {
+         pCallItem->set_snapshot(m_pPendingSnapshot);
+         m_pPendingSnapshot = NULL;
+      }
 
-            continue;
-         }
+      vogleditor_apiCallTreeItem* item = vogl_new(vogleditor_apiCallTreeItem, pCallItem, pCurParent);
+      pCurParent->appendChild(item);
+      items.push_back(item);
 
-         const gl_entrypoint_desc_t &entrypoint_desc = g_vogl_entrypoint_descs[entrypoint_id];
+      if (vogl_is_swap_buffers_entrypoint(entrypoint_id))
+      {
+         m_total_swaps++;
 
-         QString funcCall = entrypoint_desc.m_pName;
+         // the next api call will start a new frame
+         break;
+      }
+      else if (vogl_is_start_nested_entrypoint(entrypoint_id))
+      {
+          // Nest logically paired blocks of gl calls including terminating
+          // nest call
+          pCurParent = item;
+      }
+      else if (vogl_is_end_nested_entrypoint(entrypoint_id))
+      {
+          // move the parent back one level of the hierarchy, to its own parent
+          // (but not past Frame parent [e.g., unpaired "end" operation])
+          if (pCurParent != pFrameNode)
+              pCurParent = pCurParent->parent();
+      }
+   }
 
-         // format parameters
-         funcCall.append("( ");
-         dynamic_string paramStr;
-         for (uint param_index = 0; param_index < pTrace_packet->total_params(); param_index++)
-         {
-            if (param_index != 0)
-               funcCall.append(", ");
+   if (pFrameNode != NULL)
+   {
+      if (status == cLoadFailed)
+      {
+         vogl_delete(pFrameNode);
+      }
+      else
+      {
+         scoped_mutex lock(m_loaded_frames_mutex);
+         m_loaded_frames.push_back(pFrameNode);
+         m_loaded_items.append(items);
+      }
+   }
 
-            paramStr.clear();
-            pTrace_packet->pretty_print_param(paramStr, param_index, false);
+   return status;
+}
 
-            funcCall.append(paramStr.c_str());
-         }
-         funcCall.append(" )");
+void vogleditor_QApiCallTreeModel::touch_cached_packet(int index)
+{
+   cached_packet& entry = m_packet_cache[index];
+
+   // unlink
+   if (entry.m_prev >= 0)
+      m_packet_cache[entry.m_prev].m_next = entry.m_next;
+   else if (m_cache_head == index)
+      m_cache_head = entry.m_next;
+
+   if (entry.m_next >= 0)
+      m_packet_cache[entry.m_next].m_prev = entry.m_prev;
+   else if (m_cache_tail == index)
+      m_cache_tail = entry.m_prev;
+
+   // relink at the head
+   entry.m_prev = -1;
+   entry.m_next = m_cache_head;
+   if (m_cache_head >= 0)
+      m_packet_cache[m_cache_head].m_prev = index;
+   m_cache_head = index;
+
+   if (m_cache_tail < 0)
+      m_cache_tail = index;
+}
 
-         if (pTrace_packet->has_return_value())
-         {
-            funcCall.append(" = ");
-            paramStr.clear();
-            pTrace_packet->pretty_print_return_value(paramStr, false);
-            funcCall.append(paramStr.c_str());
-         }
+const vogl_trace_packet_array* vogleditor_QApiCallTreeModel::get_cached_frame(uint frame_index)
+{
+   for (uint i = 0; i < m_frame_cache.size(); i++)
+   {
+      if (m_frame_cache[i]->m_frame_index == frame_index)
+      {
+         // move it to the front
+         cached_frame* pFrame = m_frame_cache[i];
+         m_frame_cache.erase(i);
+         m_frame_cache.insert(0, pFrame);
+         return &pFrame->m_packets;
+      }
+   }
 
-         // if we don't have a current frame, make a new frame node
-         // and append it to the parent
-         if (pCurFrame == NULL)
-         {
-            pCurFrame = vogl_new(vogleditor_frameItem, total_swaps);
-            vogleditor_apiCallTreeItem* pNewFrameNode = vogl_new(vogleditor_apiCallTreeItem, pCurFrame, pCurParent);
-            pCurParent->appendChild(pNewFrameNode);
-            m_itemList.append(pNewFrameNode);
+   // take a new entry, or recycle the least recently used one
+   cached_frame* pFrame = NULL;
+   if (m_frame_cache.size() < cFrameCacheSize)
+   {
+      pFrame = vogl_new(cached_frame);
+   }
+   else
+   {
+      pFrame = m_frame_cache.back();
+      m_frame_cache.pop_back();
+      pFrame->m_packets.clear();
+   }
 
-            if (pPendingSnapshot != NULL)
-            {
-               pCurFrame->set_snapshot(pPendingSnapshot);
-               pPendingSnapshot = NULL;
-            }
+   // convert_frame() parses the frame's file on its own, it doesn't move the reader.
+   bool is_last_frame = false;
+   if (!static_cast<vogl_json_trace_file_reader*>(m_pTrace_reader)->convert_frame(frame_index, pFrame->m_packets, is_last_frame))
+   {
+      vogl_delete(pFrame);
+      return NULL;
+   }
 
-            // update current parent
-            pCurParent = pNewFrameNode;
-         }
+   pFrame->m_frame_index = frame_index;
+   m_frame_cache.insert(0, pFrame);
 
-         // make item and node for the api call
-         vogleditor_apiCallItem* pCallItem = vogl_new(vogleditor_apiCallItem, pCurFrame, pTrace_packet, *pGL_packet);
-         pCurFrame->appendCall(pCallItem);
+   return &pFrame->m_packets;
+}
 
-         if (pPendingSnapshot != NULL)
-         {
-            pCallItem->set_snapshot(pPendingSnapshot);
-            pPendingSnapshot = NULL;
-         }
+bool vogleditor_QApiCallTreeModel::read_trace_packet(const vogleditor_apiCallItem* pItem, vogl_trace_packet& packet)
+{
+   if (m_pTrace_reader == NULL)
+      return false;
 
-         vogleditor_apiCallTreeItem* item = vogl_new(vogleditor_apiCallTreeItem, funcCall, pCallItem, pCurParent);
-         pCurParent->appendChild(item);
-         m_itemList.append(item);
+   // Packets are read by their absolute location, so nothing relies on where the reader was left.
+   if (m_pTrace_reader->get_type() == cBINARY_TRACE_FILE_READER)
+   {
+      vogl_binary_trace_file_reader* pBinary_reader = static_cast<vogl_binary_trace_file_reader*>(m_pTrace_reader);
+      if ((!pBinary_reader->seek(pItem->packetLocation())) || (pBinary_reader->read_next_packet() != vogl_trace_file_reader::cOK))
+         return false;
 
-         if (vogl_is_swap_buffers_entrypoint(entrypoint_id))
-         {
-            total_swaps++;
+      if (pBinary_reader->get_packet_type() != cTSPTGLEntrypoint)
+         return false;
+
+      if (!packet.deserialize(pBinary_reader->get_packet_ptr(), pBinary_reader->get_packet_size(), false))
+         return false;
+   }
+   else
+   {
+      uint frame_index = static_cast<uint>(pItem->packetLocation() >> 32U);
+      uint packet_index = static_cast<uint>(pItem->packetLocation());
 
-            // reset the CurParent back to the original parent so that the next frame will be at the root level
-            pCurParent = parent;
+      const vogl_trace_packet_array* pPackets = get_cached_frame(frame_index);
+      if ((pPackets == NULL) || (packet_index >= pPackets->size()))
+         return false;
 
-            // reset the CurFrame so that a new frame node will be created on the next api call
-            pCurFrame = NULL;
-         }
-         else if (vogl_is_start_nested_entrypoint(entrypoint_id))
-         {
-             // Nest logically paired blocks of gl calls including terminating
-             // nest call
-             pCurParent = item;
-         }
-         else if (vogl_is_end_nested_entrypoint(entrypoint_id))
-         {
-             // move the parent back one level of the hierarchy, to its own parent
-             // (but not past Frame parent [e.g., unpaired "end" operation])
-             if (pCurParent->parent() != parent)
-                 pCurParent = pCurParent->parent();
-         }
-      }
+      if (pPackets->get_packet_type(packet_index) != cTSPTGLEntrypoint)
+         return false;
 
-      if (pTrace_reader->get_packet_type() == cTSPTEOF)
-      {
-          found_eof_packet = true;
-          vogl_printf("Found trace file EOF packet on swap %" PRIu64 "\n", total_swaps);
-          break;
-      }
+      if (!packet.deserialize(pPackets->get_packet_ptr(packet_index), pPackets->get_packet_size(packet_index), false))
+         return false;
+   }
+
+   if (!packet.check())
+   {
+      vogl_warning_printf("%s: GL entrypoint packet of call %" PRIu64 " failed consistency check\n", VOGL_FUNCTION_INFO_CSTR, pItem->globalCallIndex());
+      return false;
+   }
+
+   return packet.get_call_counter() == pItem->globalCallIndex();
+}
+
+vogleditor_QApiCallTreeModel::cached_packet* vogleditor_QApiCallTreeModel::get_cached_packet(const vogleditor_apiCallItem* pItem)
+{
+   vogl::hash_map<uint64_t, int>::iterator it(m_packet_cache_map.find(pItem->globalCallIndex()));
+   if (it != m_packet_cache_map.end())
+   {
+      touch_cached_packet(it->second);
+      return &m_packet_cache[it->second];
+   }
+
+   // take a new entry, or recycle the least recently used one
+   int index;
+   if (m_packet_cache.size() < cPacketCacheSize)
+   {
+      index = m_packet_cache.size();
+
+      cached_packet* pEntry = m_packet_cache.enlarge(1);
+      pEntry->m_call_index = cUINT64_MAX;
+      pEntry->m_pPacket = vogl_new(vogl_trace_packet, &m_trace_ctypes);
+      pEntry->m_prev = -1;
+      pEntry->m_next = -1;
+   }
+   else
+   {
+      index = m_cache_tail;
+      m_packet_cache_map.erase(m_packet_cache[index].m_call_index);
+      m_packet_cache[index].m_call_index = cUINT64_MAX;
+   }
+
+   touch_cached_packet(index);
+
+   cached_packet& entry = m_packet_cache[index];
+   entry.m_string.clear();
+
+   if (!read_trace_packet(pItem, *entry.m_pPacket))
+   {
+      vogl_warning_printf("%s: Failed reading the packet of call %" PRIu64 " from the trace\n", VOGL_FUNCTION_INFO_CSTR, pItem->globalCallIndex());
+      return NULL;
+   }
+
+   entry.m_call_index = pItem->globalCallIndex();
+   m_packet_cache_map.insert(entry.m_call_index, index);
+
+   const vogl_trace_packet* pTrace_packet = entry.m_pPacket;
+   const gl_entrypoint_desc_t &entrypoint_desc = g_vogl_entrypoint_descs[pItem->entrypointId()];
+
+   QString funcCall = entrypoint_desc.m_pName;
+
+   // format parameters
+   funcCall.append("( ");
+   dynamic_string paramStr;
+   for (uint param_index = 0; param_index < pTrace_packet->total_params(); param_index++)
+   {
+      if (param_index != 0)
+         funcCall.append(", ");
+
+      paramStr.clear();
+      pTrace_packet->pretty_print_param(paramStr, param_index, false);
+
+      funcCall.append(paramStr.c_str());
+   }
+   funcCall.append(" )");
+
+   if (pTrace_packet->has_return_value())
+   {
+      funcCall.append(" = ");
+      paramStr.clear();
+      pTrace_packet->pretty_print_return_value(paramStr, false);
+      funcCall.append(paramStr.c_str());
+   }
+
+   entry.m_string = funcCall;
+
+   return &entry;
+}
+
+vogl_trace_packet* vogleditor_QApiCallTreeModel::get_trace_packet(const vogleditor_apiCallItem* pItem)
+{
+   cached_packet* pEntry = get_cached_packet(pItem);
+   return (pEntry != NULL) ? pEntry->m_pPacket : NULL;
+}
+
+QString vogleditor_QApiCallTreeModel::get_api_call_string(const vogleditor_apiCallItem* pItem)
+{
+   cached_packet* pEntry = get_cached_packet(pItem);
+   if (pEntry == NULL)
+   {
+      // still show which entrypoint it was
+      return QString(g_vogl_entrypoint_descs[pItem->entrypointId()].m_pName);
    }
 
-   return found_eof_packet;
+   return pEntry->m_string;
+}
+
+vogleditor_apiCallTreeItem* vogleditor_QApiCallTreeModel::item_at(uint index)
+{
+   // searches running past the loaded items wait for the rest of the trace
+   if ((index >= m_itemList.size()) && m_loading)
+      wait_for_load();
+
+   return (index < m_itemList.size()) ? m_itemList[index] : NULL;
 }
 
 QModelIndex vogleditor_QApiCallTreeModel::index(int row, int column, const QModelIndex &parent) const
@@ -377,273 +772,179 @@ void vogleditor_QApiCallTreeModel::set_highlight_search_string(const QString sea
     m_searchString = searchString;
 }
 
-QModelIndex vogleditor_QApiCallTreeModel::find_prev_search_result(vogleditor_apiCallTreeItem* start, const QString searchText)
+// Returns true if the item is an api call that shows up in the draw call navigation.
+static bool is_drawcall_item(const vogleditor_apiCallTreeItem* pItem)
 {
-    QLinkedListIterator<vogleditor_apiCallTreeItem*> iter(m_itemList);
+    if (pItem->apiCallItem() == NULL)
+        return false;
+
+    gl_entrypoint_id_t entrypointId = pItem->apiCallItem()->entrypointId();
+    return vogl_is_draw_entrypoint(entrypointId) ||
+           vogl_is_clear_entrypoint(entrypointId) ||
+           (entrypointId == VOGL_ENTRYPOINT_glBitmap) ||
+           (entrypointId == VOGL_ENTRYPOINT_glEnd);
+}
 
-    if (start != NULL)
+bool vogleditor_QApiCallTreeModel::get_search_start(vogleditor_apiCallTreeItem* start, bool backwards, uint& index)
+{
+    if (start == NULL)
     {
-        if (iter.findNext(start) == false)
+        if (backwards)
+        {
+            // searching starts from the end of the trace
+            wait_for_load();
+            index = m_itemList.size();
+        }
+        else
         {
-            // the object wasn't found in the list, so return a default (invalid) item
-            return QModelIndex();
+            index = 0;
         }
+        return true;
+    }
 
-        // need to back up past the current item
-        iter.previous();
+    if ((start->flatIndex() >= m_itemList.size()) || (m_itemList[start->flatIndex()] != start))
+    {
+        // the object wasn't found in the list
+        return false;
     }
-    else
+
+    // the search doesn't include the start item itself
+    index = backwards ? start->flatIndex() : (start->flatIndex() + 1);
+    return true;
+}
+
+QModelIndex vogleditor_QApiCallTreeModel::find_prev_search_result(vogleditor_apiCallTreeItem* start, const QString searchText)
+{
+    uint index;
+    if (!get_search_start(start, true, index))
     {
-        // set the iterator to the back so that searching starts from the end of the list
-        iter.toBack();
+        // the object wasn't found in the list, so return a default (invalid) item
+        return QModelIndex();
     }
 
-    // now the iterator is pointing to the desired start object in the list,
-    // continually check the prev item and find one with a snapshot
-    vogleditor_apiCallTreeItem* pFound = NULL;
-    while (iter.hasPrevious())
+    while (index > 0)
     {
-        vogleditor_apiCallTreeItem* pItem = iter.peekPrevious();
+        vogleditor_apiCallTreeItem* pItem = m_itemList[--index];
         QVariant data = pItem->columnData(VOGL_ACTC_APICALL, Qt::DisplayRole);
         QString string = data.toString();
         if (string.contains(searchText, Qt::CaseInsensitive))
         {
-            pFound = pItem;
-            break;
+            return indexOf(pItem);
         }
-
-        iter.previous();
     }
 
-    return indexOf(pFound);
+    return QModelIndex();
 }
 
 QModelIndex vogleditor_QApiCallTreeModel::find_next_search_result(vogleditor_apiCallTreeItem* start, const QString searchText)
 {
-    QLinkedListIterator<vogleditor_apiCallTreeItem*> iter(m_itemList);
-
-    if (start != NULL)
+    uint index;
+    if (!get_search_start(start, false, index))
     {
-        if (iter.findNext(start) == false)
-        {
-            // the object wasn't found in the list, so return a default (invalid) item
-            return QModelIndex();
-        }
+        // the object wasn't found in the list, so return a default (invalid) item
+        return QModelIndex();
     }
 
-    // now the iterator is pointing to the desired start object in the list,
-    // continually check the next item and find one with a snapshot
-    vogleditor_apiCallTreeItem* pFound = NULL;
-    while (iter.hasNext())
+    while (vogleditor_apiCallTreeItem* pItem = item_at(index++))
     {
-        vogleditor_apiCallTreeItem* pItem = iter.peekNext();
         QVariant data = pItem->columnData(VOGL_ACTC_APICALL, Qt::DisplayRole);
         QString string = data.toString();
         if (string.contains(searchText, Qt::CaseInsensitive))
         {
-            pFound = pItem;
-            break;
+            return indexOf(pItem);
         }
-
-        iter.next();
     }
 
-    return indexOf(pFound);
+    return QModelIndex();
 }
 
 vogleditor_apiCallTreeItem* vogleditor_QApiCallTreeModel::find_prev_snapshot(vogleditor_apiCallTreeItem* start)
 {
-    QLinkedListIterator<vogleditor_apiCallTreeItem*> iter(m_itemList);
-
-    if (start != NULL)
-    {
-        if (iter.findNext(start) == false)
-        {
-            // the object wasn't found in the list
-            return NULL;
-        }
-
-        // need to back up past the current item
-        iter.previous();
-    }
-    else
-    {
-        // set the iterator to the back so that searching starts from the end of the list
-        iter.toBack();
-    }
+    uint index;
+    if (!get_search_start(start, true, index))
+        return NULL;
 
-    // now the iterator is pointing to the desired start object in the list,
-    // continually check the prev item and find one with a snapshot
-    vogleditor_apiCallTreeItem* pFound = NULL;
-    while (iter.hasPrevious())
+    while (index > 0)
     {
-        if (iter.peekPrevious()->has_snapshot())
-        {
-            pFound = iter.peekPrevious();
-            break;
-        }
-
-        iter.previous();
+        vogleditor_apiCallTreeItem* pItem = m_itemList[--index];
+        if (pItem->has_snapshot())
+            return pItem;
     }
 
-    return pFound;
+    return NULL;
 }
 
 vogleditor_apiCallTreeItem* vogleditor_QApiCallTreeModel::find_next_snapshot(vogleditor_apiCallTreeItem* start)
 {
-    QLinkedListIterator<vogleditor_apiCallTreeItem*> iter(m_itemList);
-
     // if start is NULL, then search will begin from top, otherwise it will begin from the start item and search onwards
-    if (start != NULL)
-    {
-        if (iter.findNext(start) == false)
-        {
-            // the object wasn't found in the list
-            return NULL;
-        }
-    }
+    uint index;
+    if (!get_search_start(start, false, index))
+        return NULL;
 
-    // now the iterator is pointing to the desired start object in the list,
-    // continually check the next item and find one with a snapshot
-    vogleditor_apiCallTreeItem* pFound = NULL;
-    while (iter.hasNext())
+    while (vogleditor_apiCallTreeItem* pItem = item_at(index++))
     {
-        if (iter.peekNext()->has_snapshot())
-        {
-            pFound = iter.peekNext();
-            break;
-        }
-
-        iter.next();
+        if (pItem->has_snapshot())
+            return pItem;
     }
 
-    return pFound;
+    return NULL;
 }
 
-
 vogleditor_apiCallTreeItem *vogleditor_QApiCallTreeModel::find_prev_drawcall(vogleditor_apiCallTreeItem* start)
 {
-    QLinkedListIterator<vogleditor_apiCallTreeItem*> iter(m_itemList);
-
-    if (start != NULL)
-    {
-        if (iter.findNext(start) == false)
-        {
-            // the object wasn't found in the list
-            return NULL;
-        }
-
-        // need to back up past the current item
-        iter.previous();
-    }
-    else
-    {
-        // set the iterator to the back so that searching starts from the end of the list
-        iter.toBack();
-    }
+    uint index;
+    if (!get_search_start(start, true, index))
+        return NULL;
 
-    // now the iterator is pointing to the desired start object in the list,
-    // continually check the prev item and find one with a snapshot
-    vogleditor_apiCallTreeItem* pFound = NULL;
-    while (iter.hasPrevious())
+    while (index > 0)
     {
-        vogleditor_apiCallTreeItem* pItem = iter.peekPrevious();
-        if (pItem->apiCallItem() != NULL)
-        {
-            gl_entrypoint_id_t entrypointId = static_cast<gl_entrypoint_id_t>(pItem->apiCallItem()->getGLPacket()->m_entrypoint_id);
-            if (vogl_is_draw_entrypoint(entrypointId) ||
-                vogl_is_clear_entrypoint(entrypointId) ||
-                (entrypointId == VOGL_ENTRYPOINT_glBitmap) ||
-                (entrypointId == VOGL_ENTRYPOINT_glEnd))
-            {
-                pFound = iter.peekPrevious();
-                break;
-            }
-        }
-
-        iter.previous();
+        vogleditor_apiCallTreeItem* pItem = m_itemList[--index];
+        if (is_drawcall_item(pItem))
+            return pItem;
     }
 
-    return pFound;
+    return NULL;
 }
 
 vogleditor_apiCallTreeItem *vogleditor_QApiCallTreeModel::find_next_drawcall(vogleditor_apiCallTreeItem* start)
 {
-    QLinkedListIterator<vogleditor_apiCallTreeItem*> iter(m_itemList);
-
-    if (iter.findNext(start) == false)
-    {
-        // the object wasn't found in the list
+    uint index;
+    if ((start == NULL) || (!get_search_start(start, false, index)))
         return NULL;
-    }
 
-    // now the iterator is pointing to the desired start object in the list,
-    // continually check the next item and find one with a snapshot
-    vogleditor_apiCallTreeItem* pFound = NULL;
-    while (iter.hasNext())
+    while (vogleditor_apiCallTreeItem* pItem = item_at(index++))
     {
-        vogleditor_apiCallTreeItem* pItem = iter.peekNext();
-        if (pItem->apiCallItem() != NULL)
-        {
-            gl_entrypoint_id_t entrypointId = static_cast<gl_entrypoint_id_t>(pItem->apiCallItem()->getGLPacket()->m_entrypoint_id);
-            if (vogl_is_draw_entrypoint(entrypointId) ||
-                vogl_is_clear_entrypoint(entrypointId) ||
-                (entrypointId == VOGL_ENTRYPOINT_glBitmap) ||
-                (entrypointId == VOGL_ENTRYPOINT_glEnd))
-            {
-                pFound = iter.peekNext();
-                break;
-            }
-        }
-
-        iter.next();
+        if (is_drawcall_item(pItem))
+            return pItem;
     }
 
-    return pFound;
+    return NULL;
 }
 
 vogleditor_apiCallTreeItem* vogleditor_QApiCallTreeModel::find_call_number(uint64_t callNumber)
 {
-    QLinkedListIterator<vogleditor_apiCallTreeItem*> iter(m_itemList);
-
-    vogleditor_apiCallTreeItem* pFound = NULL;
-    while (iter.hasNext())
+    uint index = 0;
+    while (vogleditor_apiCallTreeItem* pItem = item_at(index++))
     {
-        vogleditor_apiCallTreeItem* pItem = iter.peekNext();
-        if (pItem->apiCallItem() != NULL)
-        {
-            if (pItem->apiCallItem()->globalCallIndex() == callNumber)
-            {
-                pFound = iter.peekNext();
-                break;
-            }
-        }
-
-        iter.next();
+        if ((pItem->apiCallItem() != NULL) && (pItem->apiCallItem()->globalCallIndex() == callNumber))
+            return pItem;
     }
 
-    return pFound;
+    return NULL;
 }
 
 vogleditor_apiCallTreeItem* vogleditor_QApiCallTreeModel::find_frame_number(uint64_t frameNumber)
 {
-    QLinkedListIterator<vogleditor_apiCallTreeItem*> iter(m_itemList);
+    // frames are the top level items, in order
+    if ((frameNumber >= static_cast<uint64_t>(m_rootItem->childCount())) && m_loading)
+        wait_for_load();
 
-    vogleditor_apiCallTreeItem* pFound = NULL;
-    while (iter.hasNext())
+    for (int i = 0; i < m_rootItem->childCount(); i++)
     {
-        vogleditor_apiCallTreeItem* pItem = iter.peekNext();
-        if (pItem->frameItem() != NULL)
-        {
-            if (pItem->frameItem()->frameNumber() == frameNumber)
-            {
-                pFound = iter.peekNext();
-                break;
-            }
-        }
-
-        iter.next();
+        vogleditor_apiCallTreeItem* pItem = m_rootItem->child(i);
+        if ((pItem->frameItem() != NULL) && (pItem->frameItem()->frameNumber() == frameNumber))
+            return pItem;
     }
 
-    return pFound;
+    return NULL;
 }
@@ -27,15 +27,26 @@
 #define VOGLEDITOR_QAPICALLTREEMODEL_H
 
 #include <QAbstractItemModel>
-#include <QLinkedList>
+#include <QTimer>
 
 #include "vogl_common.h"
+#include "vogl_threading.h"
+#include "vogl_hash_map.h"
 
 class QVariant;
 class vogleditor_apiCallTreeItem;
+class vogleditor_apiCallItem;
+class vogleditor_frameItem;
+class vogleditor_gl_state_snapshot;
 class vogl_trace_file_reader;
+class vogl_trace_packet;
+class vogl_trace_packet_array;
 struct vogl_trace_gl_entrypoint_packet;
 
+// The model only keeps a compact vogleditor_apiCallItem per call. Packets are deserialized when a row is
+// displayed (or replayed) and kept in a bounded LRU cache. The frames are read on a background thread and
+// appended to the tree as they complete, so large traces can be browsed while they are still loading.
+
 class vogleditor_QApiCallTreeModel : public QAbstractItemModel
 {
    Q_OBJECT
@@ -44,8 +55,25 @@ public:
    vogleditor_QApiCallTreeModel(QObject* parent = 0);
    ~vogleditor_QApiCallTreeModel();
 
+   // Reads the first frame, then starts loading the rest of the trace in the background.
+   // pTrace_reader is used to reload packets on demand, the background thread opens its own reader.
    bool init(vogl_trace_file_reader* pTrace_reader);
 
+   bool is_loading() const
+   {
+      return m_loading;
+   }
+
+   // Blocks until the background load is done. Returns false if the trace couldn't be fully read.
+   bool wait_for_load();
+
+   // Returns the deserialized packet of the api call, or NULL on failure.
+   // The packet is owned by the cache and is only valid until the next call.
+   vogl_trace_packet* get_trace_packet(const vogleditor_apiCallItem* pItem);
+
+   // Returns the formatted call with its parameters and return value.
+   QString get_api_call_string(const vogleditor_apiCallItem* pItem);
+
    virtual QVariant data(const QModelIndex &index, int role) const;
    virtual Qt::ItemFlags flags(const QModelIndex &index) const;
    virtual QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
@@ -75,14 +103,86 @@ public:
    vogleditor_apiCallTreeItem* find_frame_number(uint64_t frameNumber);
 
 signals:
+   void loadFinished(bool bSuccess);
 
 public slots:
 
+private slots:
+   void slot_append_loaded_frames();
+
 private:
    vogleditor_apiCallTreeItem* m_rootItem;
    vogl_ctypes m_trace_ctypes;
-   QLinkedList<vogleditor_apiCallTreeItem*> m_itemList;
+   vogl::vector<vogleditor_apiCallTreeItem*> m_itemList;
    QString m_searchString;
+
+   // Reader used to reload packets, owned by the caller of init().
+   vogl_trace_file_reader* m_pTrace_reader;
+
+   enum
+   {
+      cPacketCacheSize = 4096,
+      cFrameCacheSize = 4
+   };
+
+   struct cached_packet
+   {
+      uint64_t m_call_index;
+      vogl_trace_packet* m_pPacket;
+      QString m_string;
+      int m_prev;
+      int m_next;
+   };
+
+   // LRU list threaded through m_packet_cache, m_cache_head is the most recently used entry.
+   vogl::vector<cached_packet> m_packet_cache;
+   vogl::hash_map<uint64_t, int> m_packet_cache_map;
+   int m_cache_head;
+   int m_cache_tail;
+
+   // JSON traces are reloaded a frame at a time, parsing the frame's document is far more expensive than
+   // reading one of its packets. Most recently used frame first.
+   struct cached_frame;
+   vogl::vector<cached_frame*> m_frame_cache;
+
+   cached_packet* get_cached_packet(const vogleditor_apiCallItem* pItem);
+   const vogl_trace_packet_array* get_cached_frame(uint frame_index);
+   bool read_trace_packet(const vogleditor_apiCallItem* pItem, vogl_trace_packet& packet);
+   void touch_cached_packet(int index);
+
+   // Background loading. The loader owns its reader and the items it creates until
+   // slot_append_loaded_frames() moves the completed frames into the tree on the UI thread.
+   vogl_trace_file_reader* m_pLoader_reader;
+   vogl::task_pool m_loader_pool;
+   vogl::mutex m_loaded_frames_mutex;
+   vogl::vector<vogleditor_apiCallTreeItem*> m_loaded_frames;
+   vogl::vector<vogleditor_apiCallTreeItem*> m_loaded_items;
+   QTimer m_append_timer;
+   volatile bool m_cancel_load;
+   volatile bool m_loader_done;
+   bool m_loading;
+   bool m_load_succeeded;
+
+   // Loader state carried between frames
+   uint64_t m_total_swaps;
+   uint m_json_packet_index;
+   vogleditor_gl_state_snapshot* m_pPendingSnapshot;
+
+   enum load_status_t
+   {
+      cLoadFailed = -1,
+      cLoadOK,
+      cLoadDone
+   };
+
+   load_status_t load_frame();
+   void load_task(uint64_t data, void* pData_ptr);
+   void append_loaded_frames();
+   bool read_snapshot(vogl_trace_file_reader* pTrace_reader);
+
+   // Returns the item at the index of m_itemList, waiting for the load if it's past the loaded items.
+   vogleditor_apiCallTreeItem* item_at(uint index);
+   bool get_search_start(vogleditor_apiCallTreeItem* start, bool backwards, uint& index);
 };
 
 #endif // VOGLEDITOR_QAPICALLTREEMODEL_H
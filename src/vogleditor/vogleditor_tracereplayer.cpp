@@ -1,6 +1,7 @@
 
 #include "vogleditor_apicalltreeitem.h"
 #include "vogleditor_apicallitem.h"
+#include "vogleditor_qapicalltreemodel.h"
 
 #include "vogleditor_tracereplayer.h"
 
@@ -137,7 +138,13 @@ vogleditor_tracereplayer_result vogleditor_traceReplayer::recursive_replay_apica
     vogleditor_apiCallItem* pApiCall = pItem->apiCallItem();
     if (pApiCall != NULL)
     {
-        vogl_trace_packet* pTrace_packet = pApiCall->getTracePacket();
+        vogl_trace_packet* pTrace_packet = pItem->model()->get_trace_packet(pApiCall);
+        if (pTrace_packet == NULL)
+        {
+            dynamic_string info;
+            vogleditor_output_error(info.format("Unable to read gl entrypoint at call %" PRIu64 " from the trace", pApiCall->globalCallIndex()).c_str());
+            return VOGLEDITOR_TRR_ERROR;
+        }
 
         vogl_gl_replayer::status_t status = vogl_gl_replayer::cStatusOK;
 
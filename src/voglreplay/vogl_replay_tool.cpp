@@ -78,6 +78,7 @@ static command_line_param_desc g_command_line_param_descs[] =
         { "pack_json", 0, false, "Pack JSON to UBJ mode: Pack textual JSON to UBJ, must specify input and output filenames" },
         { "find", 0, false, "Find all calls with parameters containing a specific value, combine with -find_param, -find_func, find_namespace, etc. params" },
         { "compare_hash_files", 0, false, "Compare two files containing CRC's or per-component sums (presumably written using dump_backbuffer_hashes)" },
+        { "index", 0, false, "Index mode: Scan a trace file and write its per-frame packet index file, which makes seeking and frame counting instant on later opens" },
 
         // replay specific
         { "width", 1, false, "Replay: Set replay window's initial width (default is 1024)" },
@@ -90,6 +91,7 @@ static command_line_param_desc g_command_line_param_descs[] =
         { "multitrim", 0, false, "Replay trimming: Trim each frame to a different file" },
         { "multitrim_interval", 1, false, "Replay trimming: Set the # of frames between each multitrimmed frame (default is 1)" },
         { "no_trim_optimization", 0, false, "Replay trimming: If specified, do not remove unused programs, shaders, etc. from trim file" },
+        { "chunk_trim_blobs", 0, false, "Replay trimming: Store large snapshot blobs as chunks shared by the trim files written to the same directory (multitrim, keyframes)" },
         { "trim_call", 1, false, "Replay: Call counter index to begin trim" },
         { "write_snapshot_call", 1, false, "Replay: Write JSON snapshot at the specified call counter index" },
         { "write_snapshot_file", 1, false, "Replay: Write JSON snapshot to specified filename, must also specify --write_snapshot_call" },
@@ -121,10 +123,14 @@ static command_line_param_desc g_command_line_param_descs[] =
         { "keyframe_base_filename", 1, false, "Replay: Set base filename of trimmed replay keyframes, used for fast seeking" },
 #ifdef USE_TELEMETRY
         { "telemetry_level", 1, false, "Set Telemetry level." },
+#elif defined(USE_VOGL_PROFILER)
+        { "telemetry_level", 1, false, "Record profiler zones up to this level (0-3), written out at exit" },
+        { "telemetry_file", 1, false, "Profiler output file, Chrome trace event JSON if it ends in .json, binary otherwise" },
 #endif
         { "loop_frame", 1, false, "Replay: loop mode's start frame" },
         { "loop_len", 1, false, "Replay: loop mode's loop length" },
         { "loop_count", 1, false, "Replay: loop mode's loop count" },
+        { "loop_full_restore", 0, false, "Replay: loop mode applies the full snapshot at each loop start, instead of only restoring what the loop touched" },
         { "draw_kill_max_thresh", 1, false, "Replay: Enable draw kill mode during looping to visualize order of draws, sets the max # of draws before counter resets to 0" },
         { "disable_frontbuffer_restore", 0, false, "Replay: Do not restore the front buffer's contents when restoring a state snapshot" },
 
@@ -149,6 +155,9 @@ static command_line_param_desc g_command_line_param_descs[] =
         { "verify", 0, false, "Dump: Fully round-trip verify all JSON objects vs. the original packet's" },
         { "no_blobs", 0, false, "Dump: Don't write binary blob files" },
         { "write_debug_info", 0, false, "Dump: Write extra debug info to output JSON trace files" },
+        { "dump_threads", 1, false, "Dump: Dump frame ranges of binary traces with frame offsets on this many threads (default is the number of helper threads + 1, 0 or 1 dumps serially)" },
+        { "compress_trace", 0, false, "Parse: Write the binary trace's packets in compressed blocks" },
+        { "json_prefetch_mb", 1, false, "Parse upcoming JSON frame files on a helper thread while replaying, holding at most this many MB of them (default is 256, 0 disables)" },
         { "loose_file_path", 1, false, "Prefer reading trace blob files from this directory vs. the archive referred to or present in the trace file" },
         { "debug", 0, false, "Enable verbose debug information" },
         { "logfile", 1, false, "Create logfile" },
@@ -399,6 +408,14 @@ static bool vogl_replay_init(int argc, char *argv[])
                                                                  TELEMETRY_LEVEL_MIN + 1, TELEMETRY_LEVEL_MIN, TELEMETRY_LEVEL_MAX);
     telemetry_set_level(telemetry_level);
     telemetry_tick();
+#elif defined(USE_VOGL_PROFILER)
+    // Profiling is off unless asked for, every enabled zone is recorded.
+    if (g_command_line_params().has_key("telemetry_file"))
+        telemetry_set_output_filename(g_command_line_params().get_value_as_string_or_empty("telemetry_file").get_ptr());
+    if (g_command_line_params().has_key("telemetry_level"))
+        telemetry_set_level(g_command_line_params().get_value_as_int("telemetry_level", 0,
+                                                                     TELEMETRY_LEVEL_MIN, TELEMETRY_LEVEL_MIN, TELEMETRY_LEVEL_MAX));
+    telemetry_tick();
 #endif
 
     vogl_common_lib_early_init();
@@ -416,15 +433,13 @@ static bool vogl_replay_init(int argc, char *argv[])
     if (!load_gl())
         return false;
 
-    bool wrap_all_gl_calls = true;
-
-    if (g_command_line_params().get_value_as_bool("benchmark"))
-        wrap_all_gl_calls = false;
+    bool wrap_all_gl_calls = g_command_line_params().get_value_as_bool("gl_debug_log");
 
     vogl_init_actual_gl_entrypoints(vogl_get_proc_address_helper, wrap_all_gl_calls);
 
 #if 0
 	// HACK HACK - for testing
+	vogl_set_gl_entrypoint_wrapping(true);
 	vogl_set_direct_gl_func_prolog(vogl_direct_gl_func_prolog, NULL);
 	vogl_set_direct_gl_func_epilog(vogl_direct_gl_func_epilog, NULL);
 #endif
@@ -524,7 +539,7 @@ static vogl_gl_state_snapshot *read_state_snapshot_from_trace(dynamic_string fil
         if (pTrace_reader->get_packet_type() != cTSPTGLEntrypoint)
             continue;
 
-        if (!keyframe_trace_packet.deserialize(pTrace_reader->get_packet_buf().get_ptr(), pTrace_reader->get_packet_buf().size(), false))
+        if (!keyframe_trace_packet.deserialize(pTrace_reader->get_packet_ptr(), pTrace_reader->get_packet_size(), false))
         {
             vogl_error_printf("%s: Failed parsing GL entrypoint packet in keyframe file\n", VOGL_FUNCTION_INFO_CSTR);
             return NULL;
@@ -556,10 +571,10 @@ static vogl_gl_state_snapshot *read_state_snapshot_from_trace(dynamic_string fil
                     dynamic_string cmd_type(kvm.get_string("command_type"));
                     if (cmd_type == "state_snapshot")
                     {
-                        dynamic_string id(kvm.get_string("binary_id"));
+                        dynamic_string id(vogl_gl_state_snapshot::get_blob_id(kvm));
                         if (id.is_empty())
                         {
-                            vogl_error_printf("%s: Missing binary_id field in glInternalTraceCommandRAD key_valye_map command type: \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, cmd_type.get_ptr());
+                            vogl_error_printf("%s: Missing native_id/binary_id field in glInternalTraceCommandRAD key_valye_map command type: \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, cmd_type.get_ptr());
                             return NULL;
                         }
 
@@ -575,20 +590,10 @@ static vogl_gl_state_snapshot *read_state_snapshot_from_trace(dynamic_string fil
 
                         vogl_message_printf("%s: Deserializing state snapshot \"%s\", %u bytes\n", VOGL_FUNCTION_INFO_CSTR, id.get_ptr(), snapshot_data.size());
 
-                        json_document doc;
-                        {
-                            timed_scope ts2("doc.binary_deserialize");
-                            if (!doc.binary_deserialize(snapshot_data) || (!doc.get_root()))
-                            {
-                                vogl_error_printf("%s: Failed deserializing JSON snapshot blob data \"%s\"!\n", VOGL_FUNCTION_INFO_CSTR, id.get_ptr());
-                                return NULL;
-                            }
-                        }
-
                         pSnapshot = vogl_new(vogl_gl_state_snapshot);
 
-                        timed_scope ts2("pSnapshot->deserialize");
-                        if (!pSnapshot->deserialize(*doc.get_root(), pTrace_reader->get_multi_blob_manager(), &trace_gl_ctypes))
+                        timed_scope ts2("pSnapshot->deserialize_blob");
+                        if (!pSnapshot->deserialize_blob(snapshot_data, pTrace_reader->get_multi_blob_manager(), &trace_gl_ctypes))
                         {
                             vogl_delete(pSnapshot);
                             pSnapshot = NULL;
@@ -679,6 +684,13 @@ static uint get_replayer_flags_from_command_line_params(bool interactive_mode)
 
         vogl_printf("Reading trace file %s\n", actual_trace_filename.get_ptr());
 
+        if (pTrace_reader->get_type() == cJSON_TRACE_FILE_READER)
+        {
+            uint json_prefetch_mb = g_command_line_params().get_value_as_uint("json_prefetch_mb", 0, vogl_json_trace_file_reader::cDefaultMaxPrefetchBytes / (1024 * 1024));
+            if (json_prefetch_mb)
+                static_cast<vogl_json_trace_file_reader *>(pTrace_reader.get())->init_prefetch(1, json_prefetch_mb * 1024ULL * 1024ULL);
+        }
+
         bool interactive_mode = g_command_line_params().get_value_as_bool("interactive");
 
         vogl_gl_replayer replayer;
@@ -778,6 +790,7 @@ static uint get_replayer_flags_from_command_line_params(bool interactive_mode)
         int loop_frame = g_command_line_params().get_value_as_int("loop_frame", 0, -1);
         int loop_len = math::maximum<int>(g_command_line_params().get_value_as_int("loop_len", 0, 1), 1);
         int loop_count = math::maximum<int>(g_command_line_params().get_value_as_int("loop_count", 0, cINT32_MAX), 1);
+        bool loop_full_restore = g_command_line_params().get_value_as_bool("loop_full_restore");
         int draw_kill_max_thresh = g_command_line_params().get_value_as_int("draw_kill_max_thresh", 0, -1);
         bool endless_mode = g_command_line_params().get_value_as_bool("endless");
 
@@ -1130,6 +1143,7 @@ static uint get_replayer_flags_from_command_line_params(bool interactive_mode)
 
                             keys_pressed.erase(XK_space);
 
+                            replayer.end_loop();
                             vogl_delete(pSnapshot);
                             pSnapshot = NULL;
 
@@ -1150,6 +1164,7 @@ static uint get_replayer_flags_from_command_line_params(bool interactive_mode)
                     // Snapshot the current state
                     if (take_new_snapshot)
                     {
+                        replayer.end_loop();
                         vogl_delete(pSnapshot);
                         pSnapshot = NULL;
 
@@ -1186,6 +1201,7 @@ static uint get_replayer_flags_from_command_line_params(bool interactive_mode)
                                 }
                                 else
                                 {
+                                    replayer.end_loop();
                                     vogl_delete(pSnapshot);
 
                                     pSnapshot = pNew_snapshot;
@@ -1239,6 +1255,8 @@ static uint get_replayer_flags_from_command_line_params(bool interactive_mode)
                             dynamic_string trim_filename(trim_name + "/" + trim_name + ".bin");
                             dynamic_string snapshot_id;
                             uint write_trim_file_flags = vogl_gl_replayer::cWriteTrimFileFromStartOfFrame | (g_command_line_params().get_value_as_bool("no_trim_optimization") ? 0 : vogl_gl_replayer::cWriteTrimFileOptimizeSnapshot);
+                            if (g_command_line_params().get_value_as_bool("chunk_trim_blobs"))
+                                write_trim_file_flags |= vogl_gl_replayer::cWriteTrimFileChunkBlobs;
                             if (replayer.write_trim_file(write_trim_file_flags, trim_filename, 1, *pTrace_reader, &snapshot_id))
                             {
                                 dynamic_string json_trim_base_filename(trim_name + "/j" + trim_name);
@@ -1315,6 +1333,7 @@ static uint get_replayer_flags_from_command_line_params(bool interactive_mode)
                         paused_mode = false;
                     }
 
+                    replayer.end_loop();
                     vogl_delete(pSnapshot);
                     pSnapshot = NULL;
                 }
@@ -1326,6 +1345,7 @@ static uint get_replayer_flags_from_command_line_params(bool interactive_mode)
                         bool ctrl = (keys_down.contains(XK_Control_L) || keys_down.contains(XK_Control_R));
                         keys_pressed.erase('r');
 
+                        replayer.end_loop();
                         vogl_delete(pSnapshot);
                         pSnapshot = NULL;
 
@@ -1353,6 +1373,7 @@ static uint get_replayer_flags_from_command_line_params(bool interactive_mode)
 
                         if (paused_mode)
                         {
+                            replayer.end_loop();
                             vogl_delete(pSnapshot);
                             pSnapshot = NULL;
 
@@ -1471,6 +1492,7 @@ static uint get_replayer_flags_from_command_line_params(bool interactive_mode)
 
                             keys_pressed.erase(XK_space);
 
+                            replayer.end_loop();
                             vogl_delete(pSnapshot);
                             pSnapshot = NULL;
 
@@ -1496,6 +1518,7 @@ static uint get_replayer_flags_from_command_line_params(bool interactive_mode)
                 // Seek to target frame
                 if (seek_to_target_frame != -1)
                 {
+                    replayer.end_loop();
                     vogl_delete(pSnapshot);
                     pSnapshot = NULL;
                     paused_mode_frame_index = -1;
@@ -1682,6 +1705,8 @@ static uint get_replayer_flags_from_command_line_params(bool interactive_mode)
                             file_utils::create_directories(trim_path, false);
 
                             uint write_trim_file_flags = vogl_gl_replayer::cWriteTrimFileFromStartOfFrame | (g_command_line_params().get_value_as_bool("no_trim_optimization") ? 0 : vogl_gl_replayer::cWriteTrimFileOptimizeSnapshot);
+                            if (g_command_line_params().get_value_as_bool("chunk_trim_blobs"))
+                                write_trim_file_flags |= vogl_gl_replayer::cWriteTrimFileChunkBlobs;
                             if (!replayer.write_trim_file(write_trim_file_flags, filename, multitrim_mode ? 1 : len, *pTrace_reader))
                                 goto error_exit;
 
@@ -1722,6 +1747,9 @@ static uint get_replayer_flags_from_command_line_params(bool interactive_mode)
                             snapshot_loop_start_frame = pTrace_reader->get_cur_frame();
                             snapshot_loop_end_frame = pTrace_reader->get_cur_frame() + loop_len;
 
+                            if (!loop_full_restore)
+                                replayer.begin_loop(pSnapshot);
+
                             if (draw_kill_max_thresh > 0)
                             {
                                 replayer.set_frame_draw_counter_kill_threshold(0);
@@ -1780,6 +1808,7 @@ static uint get_replayer_flags_from_command_line_params(bool interactive_mode)
                                         vogl_printf("Successfully wrote JSON snapshot to file \"%s\"\n", filename.get_ptr());
                                     }
 
+                                    replayer.end_loop();
                                     vogl_delete(pSnapshot);
                                     pSnapshot = NULL;
                                 }
@@ -1799,7 +1828,8 @@ static uint get_replayer_flags_from_command_line_params(bool interactive_mode)
 
                                 file_utils::create_directories(trim_path, false);
 
-                                if (!replayer.write_trim_file(0, filename, trim_lens.size() ? trim_lens[0] : 1, *pTrace_reader, NULL))
+                                uint write_trim_file_flags = g_command_line_params().get_value_as_bool("chunk_trim_blobs") ? vogl_gl_replayer::cWriteTrimFileChunkBlobs : 0;
+                                if (!replayer.write_trim_file(write_trim_file_flags, filename, trim_lens.size() ? trim_lens[0] : 1, *pTrace_reader, NULL))
                                     goto error_exit;
 
                                 vogl_message_printf("%s: Trim file written, stopping replay\n", VOGL_FUNCTION_INFO_CSTR);
@@ -1822,7 +1852,7 @@ static uint get_replayer_flags_from_command_line_params(bool interactive_mode)
 
                 if ((replayer.get_at_frame_boundary()) && (pSnapshot) && (loop_count > 0) && ((pTrace_reader->get_cur_frame() == snapshot_loop_end_frame) || (status == vogl_gl_replayer::cStatusAtEOF)))
                 {
-                    status = replayer.begin_applying_snapshot(pSnapshot, false);
+                    status = replayer.is_looping() ? replayer.restore_loop_snapshot() : replayer.begin_applying_snapshot(pSnapshot, false);
                     if ((status != vogl_gl_replayer::cStatusOK) && (status != vogl_gl_replayer::cStatusResizeWindow))
                         goto error_exit;
 
@@ -1952,114 +1982,184 @@ static uint get_replayer_flags_from_command_line_params(bool interactive_mode)
 
 
 //----------------------------------------------------------------------------------------------------------------------
-// tool_dump_mode
+// struct dump_context
 //----------------------------------------------------------------------------------------------------------------------
-static bool tool_dump_mode()
+struct dump_context
+{
+    dynamic_string m_input_trace_filename;
+    dynamic_string m_loose_file_path;
+    dynamic_string m_output_base_filename;
+    dynamic_string m_archive_name;
+    vogl_loose_file_blob_manager *m_pBlob_manager;
+    bool m_full_verification;
+    bool m_debug;
+    bool m_write_debug_info;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+// add_dump_frame_meta_node
+//----------------------------------------------------------------------------------------------------------------------
+static void add_dump_frame_meta_node(json_document &doc, vogl_trace_file_reader &trace_reader, uint frame_index)
 {
     VOGL_FUNC_TRACER
 
-    dynamic_string input_trace_filename(g_command_line_params().get_value_as_string_or_empty("", 1));
-    if (input_trace_filename.is_empty())
-    {
-        vogl_error_printf("Must specify filename of input binary trace file!\n");
-        return false;
-    }
+    json_node &note_node = doc.get_root()->add_object("meta");
+    note_node.add_key_value("cur_frame", frame_index);
 
-    dynamic_string output_base_filename(g_command_line_params().get_value_as_string_or_empty("", 2));
-    if (output_base_filename.is_empty())
-    {
-        vogl_error_printf("Must specify base filename of output JSON/blob files!\n");
-        return false;
-    }
+    json_node &uuid_array = note_node.add_array("uuid");
+    for (uint i = 0; i < VOGL_ARRAY_SIZE(trace_reader.get_sof_packet().m_uuid); i++)
+        uuid_array.add_value(trace_reader.get_sof_packet().m_uuid[i]);
+}
 
-    vogl_loose_file_blob_manager output_file_blob_manager;
+// Frames with more GL calls than this are split over several JSON files, so the files no longer match the frame indices.
+const uint cMaxDumpFilePackets = 1000000;
 
-    dynamic_string output_trace_path(file_utils::get_pathname(output_base_filename.get_ptr()));
-    vogl_debug_printf("%s: Output trace path: %s\n", VOGL_FUNCTION_INFO_CSTR, output_trace_path.get_ptr());
-    output_file_blob_manager.init(cBMFReadWrite, output_trace_path.get_ptr());
+//----------------------------------------------------------------------------------------------------------------------
+// scan_forced_dump_flushes
+// Adds the forced flushes in frames [first_frame, end_frame) to num_forced_flushes, reading from the reader's current
+// position (the start of first_frame). Mirrors the document flushing in dump_trace_frames(), including skipping packets
+// that fail to deserialize, so the counts match the files it writes.
+//----------------------------------------------------------------------------------------------------------------------
+static bool scan_forced_dump_flushes(vogl_trace_file_reader &trace_reader, vogl_trace_packet &gl_packet_cracker, uint first_frame, uint end_frame, uint &num_forced_flushes)
+{
+    VOGL_FUNC_TRACER
 
-    file_utils::create_directories(output_trace_path, false);
+    uint cur_frame_index = first_frame;
+    uint cur_doc_packets = 0;
+    bool flush_current_document = false;
 
-    dynamic_string actual_input_trace_filename;
-    vogl_unique_ptr<vogl_trace_file_reader> pTrace_reader(vogl_open_trace_file(input_trace_filename, actual_input_trace_filename, g_command_line_params().get_value_as_string_or_empty("loose_file_path").get_ptr()));
-    if (!pTrace_reader.get())
+    for (;;)
     {
-        vogl_error_printf("%s: Failed opening input trace file \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, input_trace_filename.get_ptr());
-        return false;
-    }
+        vogl_trace_file_reader::trace_file_reader_status_t read_status = trace_reader.read_next_packet();
+        if (read_status == vogl_trace_file_reader::cEOF)
+            break;
+        else if (read_status != vogl_trace_file_reader::cOK)
+            return false;
 
-    const bool full_verification = g_command_line_params().get_value_as_bool("verify");
+        if (trace_reader.get_packet_type() != cTSPTGLEntrypoint)
+            break;
 
-    vogl_ctypes trace_gl_ctypes;
-    trace_gl_ctypes.init(pTrace_reader->get_sof_packet().m_pointer_sizes);
+        if (flush_current_document)
+        {
+            flush_current_document = false;
+            cur_doc_packets = 0;
 
-    dynamic_string archive_name;
-    if (pTrace_reader->get_archive_blob_manager().is_initialized())
-    {
-        dynamic_string archive_filename(output_base_filename.get_ptr());
-        archive_filename += "_trace_archive.zip";
+            if (cur_frame_index >= end_frame)
+                break;
+        }
 
-        archive_name = file_utils::get_filename(archive_filename.get_ptr());
+        if (!gl_packet_cracker.deserialize(trace_reader.get_packet_ptr(), trace_reader.get_packet_size(), true))
+            continue;
 
-        vogl_message_printf("Writing trace archive \"%s\", size %" PRIu64 " bytes\n", archive_filename.get_ptr(), pTrace_reader->get_archive_blob_manager().get_archive_size());
+        cur_doc_packets++;
 
-        cfile_stream archive_stream;
-        if (!archive_stream.open(archive_filename.get_ptr(), cDataStreamWritable | cDataStreamSeekable))
+        const vogl_trace_gl_entrypoint_packet &gl_packet = trace_reader.get_packet<vogl_trace_gl_entrypoint_packet>();
+        if (vogl_is_swap_buffers_entrypoint(static_cast<gl_entrypoint_id_t>(gl_packet.m_entrypoint_id)))
         {
-            vogl_error_printf("%s: Failed opening output trace archive \"%s\"!\n", VOGL_FUNCTION_INFO_CSTR, archive_filename.get_ptr());
-            return false;
+            flush_current_document = true;
+            cur_frame_index++;
         }
-
-        if (!pTrace_reader->get_archive_blob_manager().write_archive_to_stream(archive_stream))
+        else if (cur_doc_packets >= cMaxDumpFilePackets)
         {
-            vogl_error_printf("%s: Failed writing to output trace archive \"%s\"!\n", VOGL_FUNCTION_INFO_CSTR, archive_filename.get_ptr());
-            return false;
+            flush_current_document = true;
+            num_forced_flushes++;
         }
+    }
 
-        if (!archive_stream.close())
-        {
-            vogl_error_printf("%s: Failed writing to output trace archive \"%s\"!\n", VOGL_FUNCTION_INFO_CSTR, archive_filename.get_ptr());
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// count_forced_dump_flushes
+// Counts the extra JSON files dump_trace_frames() will write for frames [first_frame, end_frame) because of frames with
+// more than cMaxDumpFilePackets GL calls, starting at the reader's current position (the start of first_frame). With a
+// complete trace index only the frames it says are big enough are read.
+//----------------------------------------------------------------------------------------------------------------------
+static bool count_forced_dump_flushes(vogl_trace_file_reader &trace_reader, uint first_frame, uint end_frame, uint &num_forced_flushes)
+{
+    VOGL_FUNC_TRACER
+
+    num_forced_flushes = 0;
+
+    vogl_ctypes trace_gl_ctypes;
+    trace_gl_ctypes.init(trace_reader.get_sof_packet().m_pointer_sizes);
+
+    vogl_trace_packet gl_packet_cracker(&trace_gl_ctypes);
+
+    const vogl_trace_index &trace_index = trace_reader.get_index();
+    if ((!trace_index.is_valid()) || (!trace_index.is_complete()))
+        return scan_forced_dump_flushes(trace_reader, gl_packet_cracker, first_frame, end_frame, num_forced_flushes);
+
+    // A document never spans frames, so frames with fewer packets (of any type) than the limit can't force a flush.
+    const uint num_frames = math::minimum(end_frame, trace_index.get_num_frames());
+    for (uint frame_index = first_frame; frame_index < num_frames; frame_index++)
+    {
+        if (trace_index.get_frame(frame_index).m_num_packets < cMaxDumpFilePackets)
+            continue;
+
+        if (!trace_reader.seek_to_frame(frame_index))
+            return false;
+
+        if (!scan_forced_dump_flushes(trace_reader, gl_packet_cracker, frame_index, frame_index + 1, num_forced_flushes))
             return false;
-        }
     }
 
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// dump_trace_frames
+// Dumps frames [first_frame, end_frame) to one JSON file per frame (or more, see cMaxDumpFilePackets), starting at the
+// reader's current position (which must be the start of first_frame). first_file_index is the index of first_frame's
+// file, so ranges can be dumped independently once the files before them have been counted.
+//----------------------------------------------------------------------------------------------------------------------
+static bool dump_trace_frames(const dump_context &context, vogl_trace_file_reader &trace_reader, uint first_frame, uint end_frame, uint first_file_index, uint &num_files_written)
+{
+    VOGL_FUNC_TRACER
+
+    vogl_ctypes trace_gl_ctypes;
+    trace_gl_ctypes.init(trace_reader.get_sof_packet().m_pointer_sizes);
+
     vogl_trace_packet gl_packet_cracker(&trace_gl_ctypes);
 
-    uint cur_file_index = 0;
-    uint cur_frame_index = 0;
+    uint cur_file_index = first_file_index;
+    uint cur_frame_index = first_frame;
     uint64_t cur_packet_index = 0;
     VOGL_NOTE_UNUSED(cur_packet_index);
     json_document cur_doc;
 
+    json_node *pPacket_array = NULL;
+
+    if (!cur_frame_index)
     {
         json_node &meta_node = cur_doc.get_root()->add_object("meta");
         meta_node.add_key_value("cur_frame", cur_frame_index);
 
         json_node &sof_node = cur_doc.get_root()->add_object("sof");
-        sof_node.add_key_value("pointer_sizes", pTrace_reader->get_sof_packet().m_pointer_sizes);
-        sof_node.add_key_value("version", to_hex_string(pTrace_reader->get_sof_packet().m_version));
-        if (!archive_name.is_empty())
-            sof_node.add_key_value("archive_filename", archive_name);
+        sof_node.add_key_value("pointer_sizes", trace_reader.get_sof_packet().m_pointer_sizes);
+        sof_node.add_key_value("version", to_hex_string(trace_reader.get_sof_packet().m_version));
+        if (!context.m_archive_name.is_empty())
+            sof_node.add_key_value("archive_filename", context.m_archive_name);
 
         json_node &uuid_array = sof_node.add_array("uuid");
-        for (uint i = 0; i < VOGL_ARRAY_SIZE(pTrace_reader->get_sof_packet().m_uuid); i++)
-            uuid_array.add_value(pTrace_reader->get_sof_packet().m_uuid[i]);
+        for (uint i = 0; i < VOGL_ARRAY_SIZE(trace_reader.get_sof_packet().m_uuid); i++)
+            uuid_array.add_value(trace_reader.get_sof_packet().m_uuid[i]);
+
+        pPacket_array = &cur_doc.get_root()->add_array("packets");
     }
 
     // TODO: Automatically dump binary snapshot file to text?
     // Right now we can't afford to do it at trace time, it takes too much memory.
 
-    json_node *pPacket_array = &cur_doc.get_root()->add_array("packets");
-
     bool flush_current_document = false;
 
     bool status = true;
 
     for (;;)
     {
-        uint64_t cur_packet_ofs = (pTrace_reader->get_type() == cBINARY_TRACE_FILE_READER) ? static_cast<vogl_binary_trace_file_reader *>(pTrace_reader.get())->get_cur_file_ofs() : 0;
+        uint64_t cur_packet_ofs = (trace_reader.get_type() == cBINARY_TRACE_FILE_READER) ? static_cast<vogl_binary_trace_file_reader &>(trace_reader).get_cur_file_ofs() : 0;
 
-        vogl_trace_file_reader::trace_file_reader_status_t read_status = pTrace_reader->read_next_packet();
+        vogl_trace_file_reader::trace_file_reader_status_t read_status = trace_reader.read_next_packet();
 
         if (read_status == vogl_trace_file_reader::cEOF)
         {
@@ -2074,9 +2174,9 @@ static bool tool_dump_mode()
             break;
         }
 
-        if (pTrace_reader->get_packet_type() != cTSPTGLEntrypoint)
+        if (trace_reader.get_packet_type() != cTSPTGLEntrypoint)
         {
-            if (pTrace_reader->get_packet_type() == cTSPTSOF)
+            if (trace_reader.get_packet_type() == cTSPTSOF)
             {
                 vogl_error_printf("Encountered redundant SOF packet!\n");
                 status = false;
@@ -2084,7 +2184,7 @@ static bool tool_dump_mode()
 
             json_node *pMeta_node = cur_doc.get_root()->find_child_object("meta");
             if (pMeta_node)
-                pMeta_node->add_key_value("eof", (pTrace_reader->get_packet_type() == cTSPTEOF) ? 1 : 2);
+                pMeta_node->add_key_value("eof", (trace_reader.get_packet_type() == cTSPTEOF) ? 1 : 2);
 
             break;
         }
@@ -2093,7 +2193,7 @@ static bool tool_dump_mode()
         {
             flush_current_document = false;
 
-            dynamic_string output_filename(cVarArg, "%s_%06u.json", output_base_filename.get_ptr(), cur_file_index);
+            dynamic_string output_filename(cVarArg, "%s_%06u.json", context.m_output_base_filename.get_ptr(), cur_file_index);
             vogl_message_printf("Writing file: \"%s\"\n", output_filename.get_ptr());
 
             if (!cur_doc.serialize_to_file(output_filename.get_ptr(), true))
@@ -2112,21 +2212,25 @@ static bool tool_dump_mode()
             pPacket_array = NULL;
             cur_doc.clear();
 
-            json_node &note_node = cur_doc.get_root()->add_object("meta");
-            note_node.add_key_value("cur_frame", cur_frame_index);
+            // The first packet of end_frame belongs to the next range, leave it to whoever dumps that range.
+            if (cur_frame_index >= end_frame)
+                break;
+        }
 
-            json_node &uuid_array = note_node.add_array("uuid");
-            for (uint i = 0; i < VOGL_ARRAY_SIZE(pTrace_reader->get_sof_packet().m_uuid); i++)
-                uuid_array.add_value(pTrace_reader->get_sof_packet().m_uuid[i]);
+        // Documents are only started by a GL packet, so a range which starts at the trace's EOF writes nothing (the
+        // range before it has already flagged its last document).
+        if (!pPacket_array)
+        {
+            add_dump_frame_meta_node(cur_doc, trace_reader, cur_frame_index);
 
             pPacket_array = &cur_doc.get_root()->add_array("packets");
         }
 
-        const vogl_trace_gl_entrypoint_packet &gl_packet = pTrace_reader->get_packet<vogl_trace_gl_entrypoint_packet>();
+        const vogl_trace_gl_entrypoint_packet &gl_packet = trace_reader.get_packet<vogl_trace_gl_entrypoint_packet>();
         const char *pFunc_name = g_vogl_entrypoint_descs[gl_packet.m_entrypoint_id].m_pName;
         VOGL_NOTE_UNUSED(pFunc_name);
 
-        if (g_command_line_params().get_value_as_bool("debug"))
+        if (context.m_debug)
         {
             vogl_debug_printf("Trace packet: File offset: %" PRIu64 ", Total size %u, Param size: %u, Client mem size %u, Name value size %u, call %" PRIu64 ", ID: %s (%u), Thread ID: 0x%" PRIX64 ", Trace Context: 0x%" PRIX64 "\n",
                              cur_packet_ofs,
@@ -2141,7 +2245,7 @@ static bool tool_dump_mode()
                              gl_packet.m_context_handle);
         }
 
-        if (!gl_packet_cracker.deserialize(pTrace_reader->get_packet_buf().get_ptr(), pTrace_reader->get_packet_buf().size(), true))
+        if (!gl_packet_cracker.deserialize(trace_reader.get_packet_ptr(), trace_reader.get_packet_size(), true))
         {
             vogl_error_printf("Failed deserializing GL entrypoint packet. Trying to continue parsing the file, this may die!\n");
 
@@ -2153,10 +2257,10 @@ static bool tool_dump_mode()
         json_node &new_node = pPacket_array->add_object();
 
         vogl_trace_packet::json_serialize_params serialize_params;
-        serialize_params.m_output_basename = file_utils::get_filename(output_base_filename.get_ptr());
-        serialize_params.m_pBlob_manager = &output_file_blob_manager;
+        serialize_params.m_output_basename = file_utils::get_filename(context.m_output_base_filename.get_ptr());
+        serialize_params.m_pBlob_manager = context.m_pBlob_manager;
         serialize_params.m_cur_frame = cur_file_index;
-        serialize_params.m_write_debug_info = g_command_line_params().get_value_as_bool("write_debug_info");
+        serialize_params.m_write_debug_info = context.m_write_debug_info;
         if (!gl_packet_cracker.json_serialize(new_node, serialize_params))
         {
             vogl_error_printf("JSON serialization failed!\n");
@@ -2165,7 +2269,7 @@ static bool tool_dump_mode()
             break;
         }
 
-        if (full_verification)
+        if (context.m_full_verification)
         {
 #if 0
             if (!strcmp(pFunc_name, "glClearColor"))
@@ -2195,7 +2299,7 @@ static bool tool_dump_mode()
             else
             {
                 vogl_trace_packet temp_cracker(&trace_gl_ctypes);
-                bool success = temp_cracker.json_deserialize(*round_tripped_node.get_root(), "<memory>", &output_file_blob_manager);
+                bool success = temp_cracker.json_deserialize(*round_tripped_node.get_root(), "<memory>", context.m_pBlob_manager);
                 if (!success)
                 {
                     vogl_error_printf("Failed verifying serialized JSON data (step 2)!\n");
@@ -2247,7 +2351,7 @@ static bool tool_dump_mode()
                             else
                             {
                                 uint64_t binary_serialized_size = dyn_stream.get_size();
-                                if (binary_serialized_size != pTrace_reader->get_packet_buf().size())
+                                if (binary_serialized_size != trace_reader.get_packet_size())
                                 {
                                     vogl_error_printf("Round-tripped binary serialized size differs from original packet's' size (step 7)!\n");
 
@@ -2260,7 +2364,7 @@ static bool tool_dump_mode()
 									// This is excessive- the key value map fields may be binary serialized in different orders
 									// TODO: maybe fix the key value map class so it serializes in a stable order (independent of hash table construction)?
 									const uint8 *p = static_cast<const uint8 *>(dyn_stream.get_ptr());
-									const uint8 *q = static_cast<const uint8 *>(pTrace_reader->get_packet_buf().get_ptr());
+									const uint8 *q = trace_reader.get_packet_ptr();
 									if (memcmp(p, q, binary_serialized_size) != 0)
 									{
 										file_utils::write_buf_to_file("p.bin", p, binary_serialized_size);
@@ -2285,7 +2389,7 @@ static bool tool_dump_mode()
             cur_frame_index++;
         }
 
-        if (cur_doc.get_root()->size() >= 1 * 1000 * 1000)
+        if (pPacket_array->size() >= cMaxDumpFilePackets)
         {
             // TODO: Support replaying dumps like this, or fix the code to serialize the text as it goes.
             vogl_error_printf("Haven't encountered a SwapBuffers() call in over 1000000 GL calls, dumping current in-memory JSON document to disk to avoid running out of memory. This JSON dump may not be replayable, but writing it anyway.\n");
@@ -2300,7 +2404,7 @@ static bool tool_dump_mode()
         if (!pMeta_node->has_key("eof"))
             pMeta_node->add_key_value("eof", 2);
 
-        dynamic_string output_filename(cVarArg, "%s_%06u.json", output_base_filename.get_ptr(), cur_file_index);
+        dynamic_string output_filename(cVarArg, "%s_%06u.json", context.m_output_base_filename.get_ptr(), cur_file_index);
         vogl_message_printf("Writing file: \"%s\"\n", output_filename.get_ptr());
 
         if (!cur_doc.serialize_to_file(output_filename.get_ptr(), true))
@@ -2316,14 +2420,378 @@ static bool tool_dump_mode()
         cur_file_index++;
     }
 
+    num_files_written = cur_file_index - first_file_index;
+
+    return status;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// struct dump_frames_job
+//----------------------------------------------------------------------------------------------------------------------
+struct dump_frames_job
+{
+    const dump_context *m_pContext;
+    uint m_first_frame;
+    uint m_end_frame;
+    bool m_count_only; // only count the range's forced flushes, see count_forced_dump_flushes()
+    uint m_num_forced_flushes;
+    uint m_first_file_index;
+    uint m_num_files_written;
+    bool m_status;
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+// dump_frames_task
+// Each job opens its own reader, so jobs share nothing but the (thread safe) loose file blob manager.
+//----------------------------------------------------------------------------------------------------------------------
+static void dump_frames_task(uint64_t data, void *pData_ptr)
+{
+    VOGL_FUNC_TRACER
+
+    VOGL_NOTE_UNUSED(data);
+
+    dump_frames_job &job = *static_cast<dump_frames_job *>(pData_ptr);
+    const dump_context &context = *job.m_pContext;
+
+    dynamic_string input_trace_filename(context.m_input_trace_filename);
+    dynamic_string actual_input_trace_filename;
+    vogl_unique_ptr<vogl_trace_file_reader> pTrace_reader(vogl_open_trace_file(input_trace_filename, actual_input_trace_filename, context.m_loose_file_path.get_ptr()));
+    if (!pTrace_reader.get())
+    {
+        vogl_error_printf("%s: Failed opening input trace file \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, input_trace_filename.get_ptr());
+        return;
+    }
+
+    if ((job.m_first_frame) && (!pTrace_reader->seek_to_frame(job.m_first_frame)))
+    {
+        vogl_error_printf("%s: Failed seeking to frame %u\n", VOGL_FUNCTION_INFO_CSTR, job.m_first_frame);
+        return;
+    }
+
+    if (job.m_count_only)
+        job.m_status = count_forced_dump_flushes(*pTrace_reader, job.m_first_frame, job.m_end_frame, job.m_num_forced_flushes);
+    else
+        job.m_status = dump_trace_frames(context, *pTrace_reader, job.m_first_frame, job.m_end_frame, job.m_first_file_index, job.m_num_files_written);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// run_dump_frames_jobs
+//----------------------------------------------------------------------------------------------------------------------
+static bool run_dump_frames_jobs(vogl::vector<dump_frames_job> &jobs, uint num_threads)
+{
+    VOGL_FUNC_TRACER
+
+    task_pool tasks;
+    if (!tasks.init(num_threads - 1))
+    {
+        vogl_error_printf("%s: Failed initializing task pool\n", VOGL_FUNCTION_INFO_CSTR);
+        return false;
+    }
+
+    for (uint i = 0; i < jobs.size(); i++)
+    {
+        if (!tasks.queue_task(dump_frames_task, 0, &jobs[i]))
+            dump_frames_task(0, &jobs[i]);
+    }
+
+    tasks.join();
+    tasks.deinit();
+
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// dump_trace_frames_in_parallel
+// Splits the trace into frame ranges using its frame offsets and dumps them on num_threads threads. The output is
+// identical to a serial dump, because every frame's JSON file (and blob IDs) only depend on the frame's own packets and
+// file index. Frames too big for one file shift the file indices of the frames after them, so if any range has such
+// frames the ranges' first file indices are computed from the files the ranges before them write.
+//----------------------------------------------------------------------------------------------------------------------
+static bool dump_trace_frames_in_parallel(const dump_context &context, uint total_frames, uint num_threads, uint &num_files_written)
+{
+    VOGL_FUNC_TRACER
+
+    // Use several ranges per thread to even out frames of very different cost, but keep them big enough to amortize
+    // opening a reader per range.
+    const uint cMinFramesPerJob = 8;
+    uint frames_per_job = math::maximum(cMinFramesPerJob, (total_frames + num_threads * 4 - 1) / (num_threads * 4));
+    uint num_jobs = (total_frames + frames_per_job - 1) / frames_per_job;
+
+    vogl_message_printf("Dumping %u frames as %u ranges on %u threads\n", total_frames, num_jobs, num_threads);
+
+    vogl::vector<dump_frames_job> jobs(num_jobs);
+    for (uint i = 0; i < num_jobs; i++)
+    {
+        dump_frames_job &job = jobs[i];
+        job.m_pContext = &context;
+        job.m_first_frame = i * frames_per_job;
+        // The last range runs to the end of the trace, so it also picks up any packets following the last frame.
+        job.m_end_frame = ((i + 1) == num_jobs) ? cUINT32_MAX : (job.m_first_frame + frames_per_job);
+        job.m_count_only = true;
+        job.m_num_forced_flushes = 0;
+        job.m_first_file_index = job.m_first_frame;
+        job.m_num_files_written = 0;
+        job.m_status = false;
+    }
+
+    if (!run_dump_frames_jobs(jobs, num_threads))
+        return false;
+
+    uint num_forced_flushes = 0;
+    for (uint i = 0; i < num_jobs; i++)
+    {
+        dump_frames_job &job = jobs[i];
+        if (!job.m_status)
+        {
+            vogl_error_printf("%s: Failed reading frames [%u, %u)\n", VOGL_FUNCTION_INFO_CSTR, job.m_first_frame, math::minimum(job.m_end_frame, total_frames));
+            return false;
+        }
+
+        job.m_first_file_index = job.m_first_frame + num_forced_flushes;
+        num_forced_flushes += job.m_num_forced_flushes;
+
+        job.m_count_only = false;
+        job.m_status = false;
+    }
+
+    if (num_forced_flushes)
+        vogl_warning_printf("%s: Frames with more than %u GL calls need %u extra JSON file(s)\n", VOGL_FUNCTION_INFO_CSTR, cMaxDumpFilePackets, num_forced_flushes);
+
+    if (!run_dump_frames_jobs(jobs, num_threads))
+        return false;
+
+    bool status = true;
+    num_files_written = 0;
+    for (uint i = 0; i < num_jobs; i++)
+    {
+        num_files_written += jobs[i].m_num_files_written;
+        if (!jobs[i].m_status)
+        {
+            vogl_error_printf("%s: Failed dumping frames [%u, %u)\n", VOGL_FUNCTION_INFO_CSTR, jobs[i].m_first_frame, math::minimum(jobs[i].m_end_frame, total_frames));
+            status = false;
+        }
+    }
+
+    return status;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// tool_dump_mode
+//----------------------------------------------------------------------------------------------------------------------
+static bool tool_dump_mode()
+{
+    VOGL_FUNC_TRACER
+
+    dynamic_string input_trace_filename(g_command_line_params().get_value_as_string_or_empty("", 1));
+    if (input_trace_filename.is_empty())
+    {
+        vogl_error_printf("Must specify filename of input binary trace file!\n");
+        return false;
+    }
+
+    dynamic_string output_base_filename(g_command_line_params().get_value_as_string_or_empty("", 2));
+    if (output_base_filename.is_empty())
+    {
+        vogl_error_printf("Must specify base filename of output JSON/blob files!\n");
+        return false;
+    }
+
+    vogl_loose_file_blob_manager output_file_blob_manager;
+
+    dynamic_string output_trace_path(file_utils::get_pathname(output_base_filename.get_ptr()));
+    vogl_debug_printf("%s: Output trace path: %s\n", VOGL_FUNCTION_INFO_CSTR, output_trace_path.get_ptr());
+    output_file_blob_manager.init(cBMFReadWrite, output_trace_path.get_ptr());
+
+    file_utils::create_directories(output_trace_path, false);
+
+    dynamic_string actual_input_trace_filename;
+    vogl_unique_ptr<vogl_trace_file_reader> pTrace_reader(vogl_open_trace_file(input_trace_filename, actual_input_trace_filename, g_command_line_params().get_value_as_string_or_empty("loose_file_path").get_ptr()));
+    if (!pTrace_reader.get())
+    {
+        vogl_error_printf("%s: Failed opening input trace file \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, input_trace_filename.get_ptr());
+        return false;
+    }
+
+    const bool full_verification = g_command_line_params().get_value_as_bool("verify");
+
+    dynamic_string archive_name;
+    if (pTrace_reader->get_archive_blob_manager().is_initialized())
+    {
+        dynamic_string archive_filename(output_base_filename.get_ptr());
+        archive_filename += "_trace_archive.zip";
+
+        archive_name = file_utils::get_filename(archive_filename.get_ptr());
+
+        vogl_message_printf("Writing trace archive \"%s\", size %" PRIu64 " bytes\n", archive_filename.get_ptr(), pTrace_reader->get_archive_blob_manager().get_archive_size());
+
+        cfile_stream archive_stream;
+        if (!archive_stream.open(archive_filename.get_ptr(), cDataStreamWritable | cDataStreamSeekable))
+        {
+            vogl_error_printf("%s: Failed opening output trace archive \"%s\"!\n", VOGL_FUNCTION_INFO_CSTR, archive_filename.get_ptr());
+            return false;
+        }
+
+        if (!pTrace_reader->get_archive_blob_manager().write_archive_to_stream(archive_stream))
+        {
+            vogl_error_printf("%s: Failed writing to output trace archive \"%s\"!\n", VOGL_FUNCTION_INFO_CSTR, archive_filename.get_ptr());
+            return false;
+        }
+
+        if (!archive_stream.close())
+        {
+            vogl_error_printf("%s: Failed writing to output trace archive \"%s\"!\n", VOGL_FUNCTION_INFO_CSTR, archive_filename.get_ptr());
+            return false;
+        }
+    }
+
+    dump_context context;
+    context.m_input_trace_filename = actual_input_trace_filename;
+    context.m_loose_file_path = g_command_line_params().get_value_as_string_or_empty("loose_file_path");
+    context.m_output_base_filename = output_base_filename;
+    context.m_archive_name = archive_name;
+    context.m_pBlob_manager = &output_file_blob_manager;
+    context.m_full_verification = full_verification;
+    context.m_debug = g_command_line_params().get_value_as_bool("debug");
+    context.m_write_debug_info = g_command_line_params().get_value_as_bool("write_debug_info");
+
+    uint num_threads = g_command_line_params().get_value_as_uint("dump_threads", 0, vogl_get_max_helper_threads() + 1);
+
+    uint total_frames = 0;
+    if ((num_threads > 1) && (pTrace_reader->get_type() == cBINARY_TRACE_FILE_READER) && (pTrace_reader->can_quickly_seek_forward()))
+        total_frames = static_cast<uint>(math::maximum<int64_t>(pTrace_reader->get_max_frame_index() + 1, 0));
+
+    uint num_files_written = 0;
+    bool status;
+    if (total_frames > 1)
+    {
+        pTrace_reader.reset();
+
+        status = dump_trace_frames_in_parallel(context, total_frames, num_threads, num_files_written);
+    }
+    else
+    {
+        status = dump_trace_frames(context, *pTrace_reader, 0, cUINT32_MAX, 0, num_files_written);
+    }
+
     if (!status)
         vogl_error_printf("Failed dumping binary trace to JSON files starting with filename prefix \"%s\" (but wrote as much as possible)\n", output_base_filename.get_ptr());
     else
-        vogl_message_printf("Successfully dumped binary trace to %u JSON file(s) starting with filename prefix \"%s\"\n", cur_file_index, output_base_filename.get_ptr());
+        vogl_message_printf("Successfully dumped binary trace to %u JSON file(s) starting with filename prefix \"%s\"\n", num_files_written, output_base_filename.get_ptr());
 
     return status;
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+// struct parse_frame_job
+//----------------------------------------------------------------------------------------------------------------------
+struct parse_frame_job
+{
+    parse_frame_job()
+        : m_pTrace_reader(NULL),
+          m_frame_index(0),
+          m_is_last_frame(false),
+          m_status(false),
+          m_done(0, 1)
+    {
+    }
+
+    const vogl_json_trace_file_reader *m_pTrace_reader;
+    uint m_frame_index;
+    vogl_trace_packet_array m_packets;
+    bool m_is_last_frame;
+    bool m_status;
+    semaphore m_done; // released by parse_frame_task()
+};
+
+static void parse_frame_task(uint64_t data, void *pData_ptr)
+{
+    VOGL_NOTE_UNUSED(data);
+
+    parse_frame_job *pJob = static_cast<parse_frame_job *>(pData_ptr);
+
+    pJob->m_status = pJob->m_pTrace_reader->convert_frame(pJob->m_frame_index, pJob->m_packets, pJob->m_is_last_frame);
+
+    pJob->m_done.release();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// parse_json_frames
+// Converts the JSON trace's frames on num_threads helper threads, and writes their packets in frame order.
+//----------------------------------------------------------------------------------------------------------------------
+static bool parse_json_frames(vogl_json_trace_file_reader &trace_reader, vogl_trace_file_writer &trace_writer, uint num_threads)
+{
+    VOGL_FUNC_TRACER
+
+    task_pool tasks;
+    if (!tasks.init(num_threads))
+    {
+        vogl_error_printf("%s: Failed starting helper threads\n", VOGL_FUNCTION_INFO_CSTR);
+        return false;
+    }
+
+    // Enough frames to keep the threads busy, without holding much of the trace in memory.
+    const uint max_jobs_in_flight = num_threads * 2;
+    const uint total_frames = static_cast<uint>(trace_reader.get_max_frame_index() + 1);
+
+    vogl::vector<parse_frame_job *> jobs;
+    uint next_frame_index = 0;
+    bool at_last_frame = false;
+    bool success = true;
+
+    for (;;)
+    {
+        while ((success) && (!at_last_frame) && (next_frame_index < total_frames) && (jobs.size() < max_jobs_in_flight))
+        {
+            parse_frame_job *pJob = vogl_new(parse_frame_job);
+            pJob->m_pTrace_reader = &trace_reader;
+            pJob->m_frame_index = next_frame_index++;
+
+            jobs.push_back(pJob);
+
+            if (!tasks.queue_task(parse_frame_task, 0, pJob))
+                parse_frame_task(0, pJob);
+        }
+
+        if (jobs.is_empty())
+            break;
+
+        parse_frame_job *pJob = jobs[0];
+        pJob->m_done.wait();
+
+        jobs.erase(0U);
+
+        // Frames past the one with the eof meta key are ignored, like the JSON reader does.
+        if ((success) && (!at_last_frame))
+        {
+            if (!pJob->m_status)
+            {
+                vogl_error_printf("Failed parsing frame %u\n", pJob->m_frame_index);
+                success = false;
+            }
+
+            for (uint i = 0; (success) && (i < pJob->m_packets.size()); i++)
+            {
+                if (!trace_writer.write_packet(pJob->m_packets.get_packet_ptr(i), pJob->m_packets.get_packet_size(i), pJob->m_packets.is_swap_buffers_packet(i)))
+                {
+                    vogl_error_printf("Failed writing frame %u's packets to output trace file\n", pJob->m_frame_index);
+                    success = false;
+                }
+            }
+
+            at_last_frame = pJob->m_is_last_frame;
+        }
+
+        vogl_delete(pJob);
+    }
+
+    tasks.deinit();
+
+    if ((success) && (!at_last_frame))
+        vogl_warning_printf("%s: Last JSON document %u did not have a non-zero eof meta key\n", VOGL_FUNCTION_INFO_CSTR, total_frames - 1);
+
+    return success;
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 // tool_parse_mode
 //----------------------------------------------------------------------------------------------------------------------
@@ -2360,6 +2828,9 @@ static bool tool_parse_mode()
     trace_ctypes.init(pTrace_reader->get_sof_packet().m_pointer_sizes);
 
     vogl_trace_file_writer trace_writer(&trace_ctypes);
+    if (g_command_line_params().get_value_as_bool("compress_trace"))
+        trace_writer.init_compression(vogl_trace_block_writer_stream::cDefaultBlockSize, vogl_get_max_helper_threads());
+
     if (!trace_writer.open(output_trace_filename.get_ptr(), NULL, true, false, pTrace_reader->get_sof_packet().m_pointer_sizes))
     {
         vogl_error_printf("Unable to create file \"%s\"!\n", output_trace_filename.get_ptr());
@@ -2393,28 +2864,35 @@ static bool tool_parse_mode()
         }
     }
 
-    for (;;)
+    if ((pTrace_reader->get_type() == cJSON_TRACE_FILE_READER) && (vogl_get_max_helper_threads()))
     {
-        vogl_trace_file_reader::trace_file_reader_status_t read_status = pTrace_reader->read_next_packet();
-
-        if ((read_status != vogl_trace_file_reader::cOK) && (read_status != vogl_trace_file_reader::cEOF))
-        {
-            vogl_error_printf("Failed reading from trace file\n");
+        // Each frame is a separate JSON file, so they can be parsed in parallel.
+        if (!parse_json_frames(*static_cast<vogl_json_trace_file_reader *>(pTrace_reader.get()), trace_writer, vogl_get_max_helper_threads()))
             goto failed;
-        }
-
-        if ((read_status == vogl_trace_file_reader::cEOF) || (pTrace_reader->is_eof_packet()))
+    }
+    else
+    {
+        for (;;)
         {
-            vogl_message_printf("At trace file EOF\n");
-            break;
-        }
+            vogl_trace_file_reader::trace_file_reader_status_t read_status = pTrace_reader->read_next_packet();
 
-        const vogl::vector<uint8> &packet_buf = pTrace_reader->get_packet_buf();
+            if ((read_status != vogl_trace_file_reader::cOK) && (read_status != vogl_trace_file_reader::cEOF))
+            {
+                vogl_error_printf("Failed reading from trace file\n");
+                goto failed;
+            }
 
-        if (!trace_writer.write_packet(packet_buf.get_ptr(), packet_buf.size(), pTrace_reader->is_swap_buffers_packet()))
-        {
-            vogl_error_printf("Failed writing to output trace file \"%s\"\n", output_trace_filename.get_ptr());
-            goto failed;
+            if ((read_status == vogl_trace_file_reader::cEOF) || (pTrace_reader->is_eof_packet()))
+            {
+                vogl_message_printf("At trace file EOF\n");
+                break;
+            }
+
+            if (!trace_writer.write_packet(pTrace_reader->get_packet_ptr(), pTrace_reader->get_packet_size(), pTrace_reader->is_swap_buffers_packet()))
+            {
+                vogl_error_printf("Failed writing to output trace file \"%s\"\n", output_trace_filename.get_ptr());
+                goto failed;
+            }
         }
     }
 
@@ -2515,11 +2993,13 @@ static bool tool_info_mode()
 
     vogl_printf("SOF packet size: %" PRIu64 " bytes\n", sof_packet.m_size);
     vogl_printf("Version: 0x%04X\n", sof_packet.m_version);
+    vogl_printf("Compressed packet blocks: %u\n", (sof_packet.m_flags & cTSFCompressedPacketBlocks) != 0);
     vogl_printf("UUID: 0x%08x 0x%08x 0x%08x 0x%08x\n", sof_packet.m_uuid[0], sof_packet.m_uuid[1], sof_packet.m_uuid[2], sof_packet.m_uuid[3]);
     vogl_printf("First packet offset: %" PRIu64 "\n", sof_packet.m_first_packet_offset);
     vogl_printf("Trace pointer size: %u\n", sof_packet.m_pointer_sizes);
     vogl_printf("Trace archive size: %" PRIu64 " offset: %" PRIu64 "\n", sof_packet.m_archive_size, sof_packet.m_archive_offset);
     vogl_printf("Can quickly seek forward: %u\nMax frame index: %" PRIu64 "\n", pTrace_reader->can_quickly_seek_forward(), pTrace_reader->get_max_frame_index());
+    vogl_printf("Trace index file: %s\n", pTrace_reader->get_index().is_valid() ? pTrace_reader->get_index_filename().get_ptr() : "none");
 
     if (!pTrace_reader->get_archive_blob_manager().is_initialized())
     {
@@ -2582,7 +3062,8 @@ static bool tool_info_mode()
 
     vogl_ctypes trace_gl_ctypes(pTrace_reader->get_sof_packet().m_pointer_sizes);
 
-    vogl_trace_packet trace_packet(&trace_gl_ctypes);
+    vogl_trace_packet_view trace_packet(&trace_gl_ctypes);
+    key_value_map kvm;
 
     for (;;)
     {
@@ -2601,9 +3082,6 @@ static bool tool_info_mode()
             break;
         }
 
-        const vogl::vector<uint8> &packet_buf = pTrace_reader->get_packet_buf();
-        VOGL_NOTE_UNUSED(packet_buf);
-
         uint packet_size = pTrace_reader->get_packet_size();
 
         min_packet_size = math::minimum<uint>(min_packet_size, packet_size);
@@ -2619,7 +3097,7 @@ static bool tool_info_mode()
 
         if (pTrace_reader->get_packet_type() == cTSPTGLEntrypoint)
         {
-            if (!trace_packet.deserialize(pTrace_reader->get_packet_buf().get_ptr(), pTrace_reader->get_packet_buf().size(), false))
+            if (!trace_packet.init(pTrace_reader->get_packet_ptr(), pTrace_reader->get_packet_size(), false))
             {
                 console::error("%s: Failed parsing GL entrypoint packet\n", VOGL_FUNCTION_INFO_CSTR);
                 goto done;
@@ -2693,10 +3171,8 @@ static bool tool_info_mode()
                     GLuint size = trace_packet.get_param_value<GLuint>(1);
                     VOGL_NOTE_UNUSED(size);
 
-                    if (cmd == cITCRKeyValueMap)
+                    if ((cmd == cITCRKeyValueMap) && (trace_packet.decode_key_value_map(kvm)))
                     {
-                        key_value_map &kvm = trace_packet.get_key_value_map();
-
                         dynamic_string cmd_type(kvm.get_string("command_type"));
                         if (cmd_type == "state_snapshot")
                         {
@@ -2928,8 +3404,14 @@ static bool param_value_matches(const bigint128 &value_to_find, vogl_namespace_t
 //----------------------------------------------------------------------------------------------------------------------
 // print_match
 //----------------------------------------------------------------------------------------------------------------------
-static void print_match(const vogl_trace_packet &trace_packet, int param_index, int array_element_index, uint64_t total_swaps)
+static void print_match(const vogl_trace_packet_view &packet_view, vogl_trace_packet &trace_packet, int param_index, int array_element_index, uint64_t total_swaps)
 {
+    if (!trace_packet.deserialize(packet_view, false))
+    {
+        vogl_error_printf("%s: Failed deserializing GL entrypoint packet\n", VOGL_FUNCTION_INFO_CSTR);
+        return;
+    }
+
     json_document doc;
     vogl_trace_packet::json_serialize_params params;
     trace_packet.json_serialize(*doc.get_root(), params);
@@ -3030,7 +3512,8 @@ static bool tool_find_mode()
     vogl_printf("Scanning trace file %s\n", actual_input_filename.get_ptr());
 
     vogl_ctypes trace_gl_ctypes(pTrace_reader->get_sof_packet().m_pointer_sizes);
-    vogl_trace_packet trace_packet(&trace_gl_ctypes);
+    vogl_trace_packet_view trace_packet(&trace_gl_ctypes);
+    vogl_trace_packet match_packet(&trace_gl_ctypes);
 
     uint64_t total_matches = 0;
     uint64_t total_swaps = 0;
@@ -3048,9 +3531,6 @@ static bool tool_find_mode()
         if (read_status == vogl_trace_file_reader::cEOF)
             break;
 
-        const vogl::vector<uint8> &packet_buf = pTrace_reader->get_packet_buf();
-        VOGL_NOTE_UNUSED(packet_buf);
-
         const vogl_trace_stream_packet_base &base_packet = pTrace_reader->get_base_packet();
         VOGL_NOTE_UNUSED(base_packet);
 
@@ -3062,7 +3542,7 @@ static bool tool_find_mode()
         else if (pTrace_reader->get_packet_type() != cTSPTGLEntrypoint)
             continue;
 
-        if (!trace_packet.deserialize(pTrace_reader->get_packet_buf().get_ptr(), pTrace_reader->get_packet_buf().size(), false))
+        if (!trace_packet.init(pTrace_reader->get_packet_ptr(), pTrace_reader->get_packet_size(), false))
         {
             console::error("%s: Failed parsing GL entrypoint packet\n", VOGL_FUNCTION_INFO_CSTR);
             goto done;
@@ -3100,7 +3580,7 @@ static bool tool_find_mode()
 
         if (!has_find_param)
         {
-            print_match(trace_packet, -2, -1, total_swaps);
+            print_match(trace_packet, match_packet, -2, -1, total_swaps);
             total_matches++;
         }
         else
@@ -3111,7 +3591,7 @@ static bool tool_find_mode()
                 {
                     if (param_value_matches(value_to_find, find_namespace, trace_packet.get_return_value_data(), trace_packet.get_return_value_ctype(), trace_packet.get_return_value_namespace()))
                     {
-                        print_match(trace_packet, -1, -1, total_swaps);
+                        print_match(trace_packet, match_packet, -1, -1, total_swaps);
                         total_matches++;
                     }
                 }
@@ -3134,7 +3614,7 @@ static bool tool_find_mode()
                         {
                             if (param_value_matches(value_to_find, find_namespace, array.get_element<uint64_t>(j), array.get_element_ctype(), trace_packet.get_param_namespace(i)))
                             {
-                                print_match(trace_packet, i, j, total_swaps);
+                                print_match(trace_packet, match_packet, i, j, total_swaps);
                                 total_matches++;
                             }
                         }
@@ -3142,7 +3622,7 @@ static bool tool_find_mode()
                 }
                 else if (param_value_matches(value_to_find, find_namespace, trace_packet.get_param_data(i), trace_packet.get_param_ctype(i), trace_packet.get_param_namespace(i)))
                 {
-                    print_match(trace_packet, i, -1, total_swaps);
+                    print_match(trace_packet, match_packet, i, -1, total_swaps);
                     total_matches++;
                 }
             }
@@ -3298,6 +3778,212 @@ static bool tool_compare_hash_files()
     return true;
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+// tool_index_mode
+//----------------------------------------------------------------------------------------------------------------------
+static bool tool_index_mode()
+{
+    VOGL_FUNC_TRACER
+
+    dynamic_string input_base_filename(g_command_line_params().get_value_as_string_or_empty("", 1));
+    if (input_base_filename.is_empty())
+    {
+        vogl_error_printf("Must specify filename of input JSON/blob trace files!\n");
+        return false;
+    }
+
+    dynamic_string actual_input_filename;
+    vogl_unique_ptr<vogl_trace_file_reader> pTrace_reader(vogl_open_trace_file(input_base_filename, actual_input_filename, g_command_line_params().get_value_as_string_or_empty("loose_file_path").get_ptr()));
+    if (!pTrace_reader.get())
+        return false;
+
+    vogl_printf("Indexing trace file %s\n", actual_input_filename.get_ptr());
+
+    if (!pTrace_reader->build_index(true))
+    {
+        vogl_error_printf("Failed indexing trace file %s\n", actual_input_filename.get_ptr());
+        return false;
+    }
+
+    const vogl_trace_index &index = pTrace_reader->get_index();
+
+    uint64_t total_packets = 0, total_draws = 0, total_bytes = 0;
+    for (uint i = 0; i < index.get_num_frames(); i++)
+    {
+        const vogl_trace_index_frame &frame = index.get_frame(i);
+        total_packets += frame.m_num_packets;
+        total_draws += frame.m_num_draws;
+        total_bytes += frame.m_total_bytes;
+    }
+
+    vogl_printf("Frames: %u\n", index.get_num_frames());
+    vogl_printf("Total packets: %" PRIu64 ", draws: %" PRIu64 ", packet bytes: %s\n", total_packets, total_draws, uint64_to_string_with_commas(total_bytes).get_ptr());
+
+    if (!index.is_complete())
+        vogl_warning_printf("Trace file is truncated or corrupted, the index stops at the last readable packet\n");
+
+    vogl_message_printf("Wrote trace index file \"%s\"\n", pTrace_reader->get_index_filename().get_ptr());
+
+    return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// tool_bench_snapshots_mode
+// Round trips every state snapshot in the trace through both the JSON/UBJ and native encodings, reporting the encoded
+// sizes and serialize/deserialize times of each.
+//----------------------------------------------------------------------------------------------------------------------
+static bool tool_bench_snapshots_mode()
+{
+    VOGL_FUNC_TRACER
+
+    dynamic_string input_base_filename(g_command_line_params().get_value_as_string_or_empty("", 1));
+    if (input_base_filename.is_empty())
+    {
+        vogl_error_printf("Must specify filename of input JSON/blob trace files!\n");
+        return false;
+    }
+
+    dynamic_string actual_input_filename;
+    vogl_unique_ptr<vogl_trace_file_reader> pTrace_reader(vogl_open_trace_file(input_base_filename, actual_input_filename, g_command_line_params().get_value_as_string_or_empty("loose_file_path").get_ptr()));
+    if (!pTrace_reader.get())
+        return false;
+
+    vogl_ctypes trace_gl_ctypes(pTrace_reader->get_sof_packet().m_pointer_sizes);
+    vogl_trace_packet trace_packet(&trace_gl_ctypes);
+
+    uint total_snapshots = 0;
+    double total_ubj_write_secs = 0, total_ubj_read_secs = 0, total_native_write_secs = 0, total_native_read_secs = 0;
+    uint64_t total_ubj_bytes = 0, total_native_bytes = 0;
+
+    for (;;)
+    {
+        vogl_trace_file_reader::trace_file_reader_status_t read_status = pTrace_reader->read_next_packet();
+        if (read_status == vogl_trace_file_reader::cEOF)
+            break;
+
+        if (read_status != vogl_trace_file_reader::cOK)
+        {
+            vogl_error_printf("Failed reading from trace file %s\n", actual_input_filename.get_ptr());
+            return false;
+        }
+
+        if (pTrace_reader->get_packet_type() == cTSPTEOF)
+            break;
+
+        if (pTrace_reader->get_packet_type() != cTSPTGLEntrypoint)
+            continue;
+
+        const vogl_trace_gl_entrypoint_packet &gl_packet = pTrace_reader->get_packet<vogl_trace_gl_entrypoint_packet>();
+        if (gl_packet.m_entrypoint_id != VOGL_ENTRYPOINT_glInternalTraceCommandRAD)
+            continue;
+
+        if (!trace_packet.deserialize(pTrace_reader->get_packet_ptr(), pTrace_reader->get_packet_size(), false))
+        {
+            vogl_error_printf("Failed parsing GL entrypoint packet\n");
+            return false;
+        }
+
+        if (trace_packet.get_param_value<GLuint>(0) != cITCRKeyValueMap)
+            continue;
+
+        const key_value_map &kvm = trace_packet.get_key_value_map();
+        if (kvm.get_string("command_type") != "state_snapshot")
+            continue;
+
+        dynamic_string id(vogl_gl_state_snapshot::get_blob_id(kvm));
+
+        uint8_vec snapshot_data;
+        if ((id.is_empty()) || (!pTrace_reader->get_multi_blob_manager().get(id, snapshot_data)) || (snapshot_data.is_empty()))
+        {
+            vogl_error_printf("Failed reading snapshot blob data \"%s\"\n", id.get_ptr());
+            return false;
+        }
+
+        vogl_gl_state_snapshot snapshot;
+        if (!snapshot.deserialize_blob(snapshot_data, pTrace_reader->get_multi_blob_manager(), &trace_gl_ctypes))
+        {
+            vogl_error_printf("Failed deserializing snapshot blob data \"%s\"\n", id.get_ptr());
+            return false;
+        }
+
+        // Both encodings write their texture/buffer data blobs to a memory blob manager so only the encoding itself is timed.
+        vogl_memory_blob_manager mem_blob_manager;
+        mem_blob_manager.init(cBMFReadWrite);
+
+        timer tm;
+        uint8_vec ubj_data;
+
+        tm.start();
+        {
+            json_document doc;
+            if (!snapshot.serialize(*doc.get_root(), mem_blob_manager, &trace_gl_ctypes))
+            {
+                vogl_error_printf("Failed serializing snapshot \"%s\" to JSON\n", id.get_ptr());
+                return false;
+            }
+            doc.binary_serialize(ubj_data);
+        }
+        double ubj_write_secs = tm.get_elapsed_secs();
+
+        tm.start();
+        {
+            json_document doc;
+            vogl_gl_state_snapshot ubj_snapshot;
+            if ((!doc.binary_deserialize(ubj_data)) || (!ubj_snapshot.deserialize(*doc.get_root(), mem_blob_manager, &trace_gl_ctypes)))
+            {
+                vogl_error_printf("Failed deserializing snapshot \"%s\" from UBJ\n", id.get_ptr());
+                return false;
+            }
+        }
+        double ubj_read_secs = tm.get_elapsed_secs();
+
+        uint8_vec native_data;
+
+        tm.start();
+        if (!snapshot.native_serialize(native_data, mem_blob_manager, &trace_gl_ctypes))
+        {
+            vogl_error_printf("Failed serializing snapshot \"%s\" to the native encoding\n", id.get_ptr());
+            return false;
+        }
+        double native_write_secs = tm.get_elapsed_secs();
+
+        tm.start();
+        {
+            vogl_gl_state_snapshot native_snapshot;
+            if (!native_snapshot.deserialize_blob(native_data, mem_blob_manager, &trace_gl_ctypes))
+            {
+                vogl_error_printf("Failed deserializing snapshot \"%s\" from the native encoding\n", id.get_ptr());
+                return false;
+            }
+        }
+        double native_read_secs = tm.get_elapsed_secs();
+
+        vogl_printf("Snapshot %u \"%s\":\n", total_snapshots, id.get_ptr());
+        vogl_printf("  UBJ:    %s bytes, serialize %3.3f ms, deserialize %3.3f ms\n", uint64_to_string_with_commas(ubj_data.size()).get_ptr(), ubj_write_secs * 1000.0f, ubj_read_secs * 1000.0f);
+        vogl_printf("  Native: %s bytes, serialize %3.3f ms, deserialize %3.3f ms\n", uint64_to_string_with_commas(native_data.size()).get_ptr(), native_write_secs * 1000.0f, native_read_secs * 1000.0f);
+
+        total_snapshots++;
+        total_ubj_bytes += ubj_data.size();
+        total_native_bytes += native_data.size();
+        total_ubj_write_secs += ubj_write_secs;
+        total_ubj_read_secs += ubj_read_secs;
+        total_native_write_secs += native_write_secs;
+        total_native_read_secs += native_read_secs;
+    }
+
+    if (!total_snapshots)
+    {
+        vogl_warning_printf("Trace file %s contains no state snapshots\n", actual_input_filename.get_ptr());
+        return true;
+    }
+
+    vogl_printf("Totals for %u snapshot(s):\n", total_snapshots);
+    vogl_printf("  UBJ:    %s bytes, serialize %3.3f ms, deserialize %3.3f ms\n", uint64_to_string_with_commas(total_ubj_bytes).get_ptr(), total_ubj_write_secs * 1000.0f, total_ubj_read_secs * 1000.0f);
+    vogl_printf("  Native: %s bytes, serialize %3.3f ms, deserialize %3.3f ms\n", uint64_to_string_with_commas(total_native_bytes).get_ptr(), total_native_write_secs * 1000.0f, total_native_read_secs * 1000.0f);
+
+    return true;
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 // tool_unpack_json_mode
 //----------------------------------------------------------------------------------------------------------------------
@@ -3500,6 +4186,20 @@ int main(int argc, char *argv[])
 
        success = tool_compare_hash_files();
     }
+    else if (g_command_line_params().get_value_as_bool("index"))
+    {
+        tmZone(TELEMETRY_LEVEL0, TMZF_NONE, "index");
+        vogl_message_printf("Index mode\n");
+
+        success = tool_index_mode();
+    }
+    else if (g_command_line_params().get_value_as_bool("bench_snapshots"))
+    {
+        tmZone(TELEMETRY_LEVEL0, TMZF_NONE, "bench_snapshots");
+        vogl_message_printf("Snapshot benchmark mode\n");
+
+        success = tool_bench_snapshots_mode();
+    }
     else
     {
         tmZone(TELEMETRY_LEVEL0, TMZF_NONE, "replay_mode");
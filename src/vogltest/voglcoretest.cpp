@@ -33,6 +33,9 @@
 #include "vogl_sparse_vector.h"
 #include "vogl_sort.h"
 #include "vogl_hash_map.h"
+#include "vogl_hash_bimap.h"
+#include "vogl_hash.h"
+#include "vogl_json.h"
 #include "vogl_map.h"
 #include "vogl_md5.h"
 #include "vogl_rh_hash_map.h"
@@ -68,6 +71,14 @@ static const struct test_data_t g_tests[] =
     DEFTEST(strutils),
     DEFTEST(map),
     DEFTEST(hash_map),
+    DEFTEST(hash_bimap),
+    DEFTEST(hash_bimap_perf),
+    DEFTEST(hash),
+    DEFTEST(hash_perf),
+    DEFTEST(content_chunk),
+    DEFTEST(json_key_index),
+    DEFTEST(json_key_index_perf),
+    DEFTEST(malloc_perf),
     DEFTEST(sort),
     DEFTEST2(sparse_vector),
     DEFTEST2(bigint128),
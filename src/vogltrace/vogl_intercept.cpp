@@ -31,6 +31,7 @@
 #include "vogl_trace_packet.h"
 #include "vogl_texture_format.h"
 #include "vogl_gl_state_snapshot.h"
+#include "vogl_native_snapshot.h"
 #include "vogl_trace_file_writer.h"
 #include "vogl_framebuffer_capturer.h"
 #include "vogl_trace_file_reader.h"
@@ -71,6 +72,10 @@
 #include <turbojpeg.h>
 #endif
 
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+
 #define VOGL_INTERCEPT_TRACE_FILE_VERSION 0x0102
 
 #define VOGL_STOP_CAPTURE_FILENAME "__stop_capture__"
@@ -165,6 +170,17 @@ static command_line_param_desc g_command_line_param_descs[] =
         { "vogl_debug", 0, false, NULL },
         { "vogl_flush_files_after_each_call", 0, false, NULL },
         { "vogl_flush_files_after_each_swap", 0, false, NULL },
+        { "vogl_async_writer", 0, false, NULL },
+        { "vogl_async_writer_max_mb", 1, false, NULL },
+        { "vogl_async_writer_packets_per_thread", 1, false, NULL },
+        { "vogl_async_writer_drop_when_full", 0, false, NULL },
+        { "vogl_compress_trace", 0, false, NULL },
+        { "vogl_compress_trace_block_kb", 1, false, NULL },
+        { "vogl_compress_trace_threads", 1, false, NULL },
+        { "vogl_archive_threads", 1, false, NULL },
+        { "vogl_archive_store_only", 0, false, NULL },
+        { "vogl_sparse_buffer_maps", 0, false, NULL },
+        { "vogl_json_snapshots", 0, false, NULL },
         { "vogl_disable_signal_interception", 0, false, NULL },
         { "vogl_logfile", 1, false, NULL },
         { "vogl_logfile_append", 1, false, NULL },
@@ -200,6 +216,8 @@ bool g_null_mode;
 bool g_backtrace_all_calls;
 bool g_backtrace_no_calls;
 static bool g_disable_client_side_array_tracing;
+static bool g_sparse_buffer_maps;
+static bool g_json_snapshots;
 
 static bool g_flush_files_after_each_call;
 static bool g_flush_files_after_each_swap;
@@ -426,6 +444,7 @@ class vogl_thread_local_data
 public:
     vogl_thread_local_data()
         : m_pContext(NULL),
+          m_pPacket_queue(NULL),
           m_calling_driver_entrypoint_id(VOGL_ENTRYPOINT_INVALID)
     {
     }
@@ -433,10 +452,25 @@ public:
     ~vogl_thread_local_data()
     {
         m_pContext = NULL;
+
+        if (m_pPacket_queue)
+        {
+            get_vogl_trace_writer().release_packet_queue(m_pPacket_queue);
+            m_pPacket_queue = NULL;
+        }
+    }
+
+    // Created on first use, only when the async trace writer is enabled.
+    vogl_trace_packet_queue *get_packet_queue()
+    {
+        if (!m_pPacket_queue)
+            m_pPacket_queue = get_vogl_trace_writer().create_packet_queue();
+        return m_pPacket_queue;
     }
 
     vogl_context *m_pContext;
     vogl_entrypoint_serializer m_serializer;
+    vogl_trace_packet_queue *m_pPacket_queue;
 
     // Set to a valid entrypoint ID if we're currently trying to call the driver on this thread. The "direct" GL function wrappers (in
     // vogl_entrypoints.cpp) call our vogl_direct_gl_func_prolog/epilog func callbacks below, which manipulate this member.
@@ -875,11 +909,53 @@ static void vogl_init_command_line_params()
     g_flush_files_after_each_call = g_command_line_params().get_value_as_bool("vogl_flush_files_after_each_call");
     g_flush_files_after_each_swap = g_command_line_params().get_value_as_bool("vogl_flush_files_after_each_swap");
 
+    if (g_command_line_params().get_value_as_bool("vogl_async_writer"))
+    {
+        if (g_flush_files_after_each_call)
+        {
+            vogl_warning_printf("%s: -vogl_async_writer is ignored when -vogl_flush_files_after_each_call is specified\n", VOGL_FUNCTION_INFO_CSTR);
+        }
+        else
+        {
+            uint max_queued_mb = g_command_line_params().get_value_as_uint("vogl_async_writer_max_mb", 0, 256, 1, 65536);
+            uint packets_per_thread = g_command_line_params().get_value_as_uint("vogl_async_writer_packets_per_thread", 0, 4096, 2, 65536);
+            vogl_trace_writer_queue_full_policy queue_full_policy = g_command_line_params().get_value_as_bool("vogl_async_writer_drop_when_full") ? cTWQueueFullDrop : cTWQueueFullBlock;
+
+            get_vogl_trace_writer().init_async_writer(packets_per_thread, static_cast<uint64_t>(max_queued_mb) * 1024U * 1024U, queue_full_policy, g_flush_files_after_each_swap);
+        }
+    }
+
+    if (g_command_line_params().get_value_as_bool("vogl_compress_trace"))
+    {
+        if (g_flush_files_after_each_call)
+        {
+            vogl_warning_printf("%s: -vogl_compress_trace is ignored when -vogl_flush_files_after_each_call is specified\n", VOGL_FUNCTION_INFO_CSTR);
+        }
+        else
+        {
+            uint block_kb = g_command_line_params().get_value_as_uint("vogl_compress_trace_block_kb", 0, 1024, 64, 16384);
+            uint num_threads = g_command_line_params().get_value_as_uint("vogl_compress_trace_threads", 0, 2, 0, 12);
+
+            get_vogl_trace_writer().init_compression(block_kb * 1024U, num_threads);
+        }
+    }
+
+    {
+        // Blobs (mostly snapshot texture and buffer data) are compressed off the calling thread by default, so
+        // triggering a capture doesn't stall the app while hundreds of MB are deflated.
+        uint archive_threads = g_command_line_params().get_value_as_uint("vogl_archive_threads", 0, 2, 0, vogl_archive_blob_manager::cMaxBlobsInFlight);
+        int archive_level = g_command_line_params().get_value_as_bool("vogl_archive_store_only") ? MZ_NO_COMPRESSION : MZ_BEST_SPEED;
+
+        get_vogl_trace_writer().init_archive_compression(archive_threads, archive_level);
+    }
+
     g_gather_statistics = g_command_line_params().get_value_as_bool("vogl_dump_stats");
     g_null_mode = g_command_line_params().get_value_as_bool("vogl_null_mode");
     g_backtrace_all_calls = g_command_line_params().get_value_as_bool("vogl_backtrace_all_calls");
     g_backtrace_no_calls = g_command_line_params().get_value_as_bool("vogl_backtrace_no_calls");
     g_disable_client_side_array_tracing = g_command_line_params().get_value_as_bool("vogl_disable_client_side_array_tracing");
+    g_sparse_buffer_maps = g_command_line_params().get_value_as_bool("vogl_sparse_buffer_maps");
+    g_json_snapshots = g_command_line_params().get_value_as_bool("vogl_json_snapshots");
 
     if (g_command_line_params().get_value_as_bool("vogl_dump_gl_full"))
     {
@@ -958,6 +1034,9 @@ static void vogl_global_init()
 
             exit(EXIT_FAILURE);
         }
+
+        if (get_vogl_trace_writer().is_async_writer_enabled())
+            get_vogl_trace_writer().start_async_writer();
     }
 
     if (!g_command_line_params().get_value_as_bool("vogl_disable_signal_interception"))
@@ -1084,6 +1163,12 @@ struct gl_vertex_attribute
 };
 const uint VOGL_MAX_SUPPORTED_GL_VERTEX_ATTRIBUTES = 32;
 
+// Element array buffers larger than this are always read back from GL instead of being shadowed.
+const uint64_t cVoglMaxShadowedIndexBufferSize = 64U * 1024U * 1024U;
+
+// Granularity of the change detection done on writable maps with -vogl_sparse_buffer_maps.
+const uint cVoglSparseMapBlockSize = 256;
+
 typedef vogl::hash_map<GLenum, GLuint> gl_buffer_binding_map;
 //----------------------------------------------------------------------------------------------------------------------
 // struct gl_buffer_desc
@@ -1119,6 +1204,44 @@ struct gl_buffer_desc
     };
     vogl::vector<flushed_range> m_flushed_ranges;
 
+    // True if the current mapping can be read back by the tracer (write only maps are only upgraded while capturing).
+    bool m_map_readable;
+
+    // CPU copy of the buffer's contents, only created for buffers that are used as the index source of client side
+    // array draws. Kept in sync from glBufferData/glBufferSubData/unmap, so the index range of these draws can be
+    // determined without reading the buffer back from GL every draw.
+    uint8_vec m_shadow;
+    uint64_t m_shadow_generation;
+    bool m_shadow_valid;
+
+    // Set once the buffer is bound to a target GL can write through (transform feedback, pack, SSBO, etc.)
+    bool m_shadow_disabled;
+
+    struct index_range
+    {
+        uint64_t m_generation;
+        int64_t m_ofs;
+        GLsizei m_count;
+        GLenum m_type;
+        uint m_start;
+        uint m_end;
+    };
+
+    enum
+    {
+        cMaxIndexRanges = 8
+    };
+    index_range m_index_ranges[cMaxIndexRanges];
+    uint m_next_index_range;
+
+    // -vogl_sparse_buffer_maps: copy of the mapped range taken at map time, unmap only serializes the blocks that differ from it.
+    uint8_vec m_map_snapshot;
+    bool m_map_sparse;
+
+    // One bit per cVoglSparseMapBlockSize bytes of the buffer, set once the block's contents are known to be identical
+    // during replay. Blocks orphaned by glBufferData(NULL) hold whatever the driver handed out, so they're always serialized.
+    vogl::vector<uint64_t> m_defined_blocks;
+
     inline gl_buffer_desc()
     {
         clear();
@@ -1140,6 +1263,97 @@ struct gl_buffer_desc
         m_map_access = 0;
         m_map_range = false;
         m_flushed_ranges.clear();
+        m_map_readable = false;
+        m_shadow.clear();
+        m_shadow_generation = 0;
+        m_shadow_valid = false;
+        m_shadow_disabled = false;
+        utils::zero_object(m_index_ranges);
+        m_next_index_range = 0;
+        m_map_snapshot.clear();
+        m_map_sparse = false;
+        m_defined_blocks.clear();
+    }
+
+    inline bool is_block_defined(int64_t block) const
+    {
+        uint64_t word = static_cast<uint64_t>(block) >> 6U;
+        if ((block < 0) || (word >= m_defined_blocks.size()))
+            return false;
+        return (m_defined_blocks[static_cast<uint>(word)] & (1ULL << (block & 63))) != 0;
+    }
+
+    // Marks the blocks entirely covered by [ofs, ofs + size) as defined.
+    inline void set_blocks_defined(int64_t ofs, int64_t size)
+    {
+        if ((ofs < 0) || (size <= 0))
+            return;
+
+        int64_t first_block = (ofs + cVoglSparseMapBlockSize - 1) / cVoglSparseMapBlockSize;
+        int64_t end_block = (ofs + size) / cVoglSparseMapBlockSize;
+        if (((ofs + size) == m_size) && (m_size % cVoglSparseMapBlockSize))
+            end_block++;
+
+        if (end_block <= first_block)
+            return;
+
+        uint num_words = static_cast<uint>((end_block + 63) >> 6);
+        if (m_defined_blocks.size() < num_words)
+            m_defined_blocks.resize(num_words);
+
+        for (int64_t block = first_block; block < end_block; block++)
+            m_defined_blocks[static_cast<uint>(block >> 6)] |= (1ULL << (block & 63));
+    }
+
+    // Any change to the shadow bumps the generation, which retires all the memoized index ranges.
+    inline void invalidate_shadow()
+    {
+        m_shadow.clear();
+        m_shadow_valid = false;
+        m_shadow_generation++;
+    }
+
+    inline void update_shadow(int64_t ofs, const void *pData, int64_t size)
+    {
+        if (!m_shadow_valid)
+            return;
+
+        if ((ofs < 0) || (size < 0) || ((ofs + size) > static_cast<int64_t>(m_shadow.size())))
+        {
+            invalidate_shadow();
+            return;
+        }
+
+        if (pData)
+            memcpy(m_shadow.get_ptr() + ofs, pData, static_cast<size_t>(size));
+        else
+            memset(m_shadow.get_ptr() + ofs, 0, static_cast<size_t>(size));
+
+        m_shadow_generation++;
+    }
+
+    inline const index_range *find_index_range(int64_t ofs, GLsizei count, GLenum type) const
+    {
+        for (uint i = 0; i < cMaxIndexRanges; i++)
+        {
+            const index_range &r = m_index_ranges[i];
+            if ((r.m_generation == m_shadow_generation) && (r.m_ofs == ofs) && (r.m_count == count) && (r.m_type == type))
+                return &r;
+        }
+        return NULL;
+    }
+
+    inline void add_index_range(int64_t ofs, GLsizei count, GLenum type, uint start, uint end)
+    {
+        index_range &r = m_index_ranges[m_next_index_range];
+        m_next_index_range = (m_next_index_range + 1) % cMaxIndexRanges;
+
+        r.m_generation = m_shadow_generation;
+        r.m_ofs = ofs;
+        r.m_count = count;
+        r.m_type = type;
+        r.m_start = start;
+        r.m_end = end;
     }
 };
 
@@ -1620,6 +1834,36 @@ public:
             // This is the first bind, so record the target. Otherwise they are rebinding to a different target, which shouldn't matter to us for snapshotting purposes (right??).
             *pTarget = target;
         }
+
+        switch (target)
+        {
+            case GL_TRANSFORM_FEEDBACK_BUFFER:
+            case GL_PIXEL_PACK_BUFFER:
+            case GL_SHADER_STORAGE_BUFFER:
+            case GL_ATOMIC_COUNTER_BUFFER:
+            case GL_QUERY_BUFFER_AMD:
+            {
+                // GL can write to the buffer behind our back from now on, so its contents can't be shadowed.
+                gl_buffer_desc &buf_desc = get_or_create_buffer_desc(id);
+                buf_desc.invalidate_shadow();
+                buf_desc.m_shadow_disabled = true;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    void invalidate_buffer_shadow(GLuint id)
+    {
+        if (!id)
+            return;
+
+        vogl_scoped_context_shadow_lock lock;
+
+        gl_buffer_desc_map::iterator buf_it(get_shared_state()->m_buffer_descs.find(id));
+        if (buf_it != get_shared_state()->m_buffer_descs.end())
+            buf_it->second.invalidate_shadow();
     }
 
     void delete_buffers(GLsizei n, const GLuint *buffers)
@@ -4031,12 +4275,38 @@ static inline void vogl_write_packet_to_trace(vogl_trace_packet &packet)
     if (!get_vogl_trace_writer().is_opened())
         return;
 
+    if (get_vogl_trace_writer().is_async_writer_enabled())
+    {
+        // Serialize into this thread's packet queue without taking the trace mutex. This fails if the async writer
+        // isn't running yet (or anymore), in which case we fall back to the locked path below.
+        if (get_vogl_trace_writer().queue_packet(vogl_get_or_create_thread_local_data()->get_packet_queue(), packet))
+        {
+            if (get_vogl_trace_writer().get_async_writer_failed())
+            {
+                vogl_error_printf("%s: Failed writing to trace file! Exiting app.\n", VOGL_FUNCTION_INFO_CSTR);
+                exit(EXIT_FAILURE);
+            }
+
+            if ((g_flush_files_after_each_swap) && (g_vogl_pLog_stream) && (packet.get_entrypoint_id() == VOGL_ENTRYPOINT_glXSwapBuffers))
+                g_vogl_pLog_stream->flush();
+
+            return;
+        }
+    }
+
     scoped_mutex lock(get_vogl_trace_mutex());
 
     // The trace got closed on another thread while we where serializing - this is OK I guess.
     // This can happen when control+c is pressed.
     if (get_vogl_trace_writer().is_opened())
     {
+        // The async writer may have been started while we where waiting on the lock.
+        if ((get_vogl_trace_writer().is_async_writer_running()) &&
+            (get_vogl_trace_writer().queue_packet(vogl_get_or_create_thread_local_data()->get_packet_queue(), packet)))
+        {
+            return;
+        }
+
         bool success = get_vogl_trace_writer().write_packet(packet);
 
         if (success)
@@ -5204,6 +5474,62 @@ static void vogl_check_for_capture_trigger_file()
         vogl_message_printf("%s: Successfully enabled capture mode, will capture up to %u frame(s), override path \"%s\", override base_name \"%s\"\n", VOGL_FUNCTION_INFO_CSTR, total_frames, path.get_ptr(), base_name.get_ptr());
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_add_snapshot_to_archive
+// Adds a state snapshot to the trace archive in the native binary encoding, or as UBJ with -vogl_json_snapshots (for
+// tools which predate the native encoding). Returns the blob id, pID_key is set to the key_value_map key to store it under.
+//----------------------------------------------------------------------------------------------------------------------
+static dynamic_string vogl_add_snapshot_to_archive(const vogl_gl_state_snapshot &snapshot, vogl_archive_blob_manager &trace_archive, const char *&pID_key)
+{
+    VOGL_FUNC_TRACER
+
+    uint8_vec snapshot_data;
+
+    if (g_json_snapshots)
+    {
+        vogl_message_printf("%s: Serializing snapshot data to JSON document\n", VOGL_FUNCTION_INFO_CSTR);
+
+        // TODO: This can take a lot of memory, probably better off to split the snapshot into separate smaller binary json or whatever files stored directly in the archive.
+        json_document doc;
+        if (!snapshot.serialize(*doc.get_root(), trace_archive, &get_vogl_process_gl_ctypes()))
+        {
+            vogl_error_printf("%s: Failed serializing GL state snapshot!\n", VOGL_FUNCTION_INFO_CSTR);
+            return dynamic_string();
+        }
+
+        vogl_message_printf("%s: Serializing JSON document to UBJ\n", VOGL_FUNCTION_INFO_CSTR);
+
+        // TODO: This can take a lot of memory
+        doc.binary_serialize(snapshot_data);
+
+        doc.clear(false);
+
+        if (g_pJSON_node_pool)
+        {
+            uint64_t total_bytes_freed = static_cast<uint64_t>(g_pJSON_node_pool->free_unused_blocks());
+            vogl_debug_printf("%s: Freed %" PRIu64 " bytes from the JSON object pool (%" PRIu64 " bytes remaining)\n", VOGL_FUNCTION_INFO_CSTR, total_bytes_freed, static_cast<uint64_t>(g_pJSON_node_pool->get_total_heap_bytes()));
+        }
+
+        vogl_message_printf("%s: Compressing UBJ data and adding to trace archive\n", VOGL_FUNCTION_INFO_CSTR);
+
+        pID_key = "binary_id";
+        return trace_archive.add_buf_compute_unique_id(snapshot_data.get_ptr(), snapshot_data.size(), "binary_state_snapshot", VOGL_BINARY_JSON_EXTENSION);
+    }
+
+    vogl_message_printf("%s: Serializing native snapshot data\n", VOGL_FUNCTION_INFO_CSTR);
+
+    if (!snapshot.native_serialize(snapshot_data, trace_archive, &get_vogl_process_gl_ctypes()))
+    {
+        vogl_error_printf("%s: Failed serializing GL state snapshot!\n", VOGL_FUNCTION_INFO_CSTR);
+        return dynamic_string();
+    }
+
+    vogl_message_printf("%s: Compressing native snapshot data and adding to trace archive\n", VOGL_FUNCTION_INFO_CSTR);
+
+    pID_key = "native_id";
+    return trace_archive.add_buf_compute_unique_id(snapshot_data.get_ptr(), snapshot_data.size(), "native_state_snapshot", VOGL_NATIVE_SNAPSHOT_EXTENSION);
+}
+
 #if (VOGL_PLATFORM_HAS_GLX)
     //----------------------------------------------------------------------------------------------------------------------
     static vogl_gl_state_snapshot *vogl_snapshot_state(const Display *dpy, GLXDrawable drawable, vogl_context *pCur_context)
@@ -5380,13 +5706,11 @@ static void vogl_check_for_capture_trigger_file()
 
         vogl_archive_blob_manager &trace_archive = *get_vogl_trace_writer().get_trace_archive();
 
-        vogl_message_printf("%s: Serializing snapshot data to JSON document\n", VOGL_FUNCTION_INFO_CSTR);
-
-        // TODO: This can take a lot of memory, probably better off to split the snapshot into separate smaller binary json or whatever files stored directly in the archive.
-        json_document doc;
-        if (!pSnapshot->serialize(*doc.get_root(), trace_archive, &get_vogl_process_gl_ctypes()))
+        const char *pSnapshot_id_key = NULL;
+        dynamic_string snapshot_id(vogl_add_snapshot_to_archive(*pSnapshot, trace_archive, pSnapshot_id_key));
+        if (snapshot_id.is_empty())
         {
-            vogl_error_printf("%s: Failed serializing GL state snapshot!\n", VOGL_FUNCTION_INFO_CSTR);
+            vogl_error_printf("%s: Failed adding GL snapshot file to output blob manager!\n", VOGL_FUNCTION_INFO_CSTR);
 
             VOGL_FUNC_TRACER
                 vogl_end_capture();
@@ -5395,51 +5719,9 @@ static void vogl_check_for_capture_trigger_file()
 
         pSnapshot.reset();
 
-        vogl_message_printf("%s: Serializing JSON document to UBJ\n", VOGL_FUNCTION_INFO_CSTR);
-
-        uint8_vec binary_snapshot_data;
-        vogl::vector<char> snapshot_data;
-
-        // TODO: This can take a lot of memory
-        doc.binary_serialize(binary_snapshot_data);
-
-        vogl_message_printf("%s: Compressing UBJ data and adding to trace archive\n", VOGL_FUNCTION_INFO_CSTR);
-
-        dynamic_string binary_snapshot_id(trace_archive.add_buf_compute_unique_id(binary_snapshot_data.get_ptr(), binary_snapshot_data.size(), "binary_state_snapshot", VOGL_BINARY_JSON_EXTENSION));
-        if (binary_snapshot_id.is_empty())
-        {
-            vogl_error_printf("%s: Failed adding binary GL snapshot file to output blob manager!\n", VOGL_FUNCTION_INFO_CSTR);
-
-            VOGL_FUNC_TRACER
-                vogl_end_capture();
-            return false;
-        }
-
-        binary_snapshot_data.clear();
-
-        snapshot_data.clear();
-
-    #if 0
-        // TODO: This requires too much temp memory!
-        doc.serialize(snapshot_data, true, 0, false);
-
-        dynamic_string snapshot_id(trace_archive.add_buf_compute_unique_id(snapshot_data.get_ptr(), snapshot_data.size(), "state_snapshot", VOGL_TEXT_JSON_EXTENSION));
-        if (snapshot_id.is_empty())
-        {
-            vogl_error_printf("%s: Failed adding binary GL snapshot file to output blob manager!\n", VOGL_FUNCTION_INFO_CSTR);
-            get_vogl_trace_writer().deinit();
-            return false;
-        }
-    #endif
-
         key_value_map snapshot_key_value_map;
         snapshot_key_value_map.insert("command_type", "state_snapshot");
-        snapshot_key_value_map.insert("binary_id", binary_snapshot_id);
-
-    #if 0
-        // TODO: This requires too much temp memory!
-        snapshot_key_value_map.insert("id", snapshot_id);
-    #endif
+        snapshot_key_value_map.insert(pSnapshot_id_key, snapshot_id);
 
         vogl_ctypes &trace_gl_ctypes = get_vogl_process_gl_ctypes();
         if (!vogl_write_glInternalTraceCommandRAD(get_vogl_trace_writer().get_stream(), &trace_gl_ctypes, cITCRKeyValueMap, sizeof(snapshot_key_value_map), reinterpret_cast<const GLubyte *>(&snapshot_key_value_map)))
@@ -5458,16 +5740,11 @@ static void vogl_check_for_capture_trigger_file()
             return false;
         }
 
-        doc.clear(false);
-
-        if (g_pJSON_node_pool)
-        {
-            uint64_t total_bytes_freed = static_cast<uint64_t>(g_pJSON_node_pool->free_unused_blocks());
-            vogl_debug_printf("%s: Freed %" PRIu64 " bytes from the JSON object pool (%" PRIu64 " bytes remaining)\n", VOGL_FUNCTION_INFO_CSTR, total_bytes_freed, static_cast<uint64_t>(g_pJSON_node_pool->get_total_heap_bytes()));
-        }
-
         vogl_message_printf("%s: Snapshot complete\n", VOGL_FUNCTION_INFO_CSTR);
 
+        if (get_vogl_trace_writer().is_async_writer_enabled())
+            get_vogl_trace_writer().start_async_writer();
+
         return true;
     }
 
@@ -6415,13 +6692,11 @@ static void vogl_check_for_capture_trigger_file()
 
         vogl_archive_blob_manager &trace_archive = *get_vogl_trace_writer().get_trace_archive();
 
-        vogl_message_printf("%s: Serializing snapshot data to JSON document\n", VOGL_FUNCTION_INFO_CSTR);
-
-        // TODO: This can take a lot of memory, probably better off to split the snapshot into separate smaller binary json or whatever files stored directly in the archive.
-        json_document doc;
-        if (!pSnapshot->serialize(*doc.get_root(), trace_archive, &get_vogl_process_gl_ctypes()))
+        const char *pSnapshot_id_key = NULL;
+        dynamic_string snapshot_id(vogl_add_snapshot_to_archive(*pSnapshot, trace_archive, pSnapshot_id_key));
+        if (snapshot_id.is_empty())
         {
-            vogl_error_printf("%s: Failed serializing GL state snapshot!\n", VOGL_FUNCTION_INFO_CSTR);
+            vogl_error_printf("%s: Failed adding GL snapshot file to output blob manager!\n", VOGL_FUNCTION_INFO_CSTR);
 
             VOGL_FUNC_TRACER
                 vogl_end_capture();
@@ -6430,51 +6705,9 @@ static void vogl_check_for_capture_trigger_file()
 
         pSnapshot.reset();
 
-        vogl_message_printf("%s: Serializing JSON document to UBJ\n", VOGL_FUNCTION_INFO_CSTR);
-
-        uint8_vec binary_snapshot_data;
-        vogl::vector<char> snapshot_data;
-
-        // TODO: This can take a lot of memory
-        doc.binary_serialize(binary_snapshot_data);
-
-        vogl_message_printf("%s: Compressing UBJ data and adding to trace archive\n", VOGL_FUNCTION_INFO_CSTR);
-
-        dynamic_string binary_snapshot_id(trace_archive.add_buf_compute_unique_id(binary_snapshot_data.get_ptr(), binary_snapshot_data.size(), "binary_state_snapshot", VOGL_BINARY_JSON_EXTENSION));
-        if (binary_snapshot_id.is_empty())
-        {
-            vogl_error_printf("%s: Failed adding binary GL snapshot file to output blob manager!\n", VOGL_FUNCTION_INFO_CSTR);
-
-            VOGL_FUNC_TRACER
-                vogl_end_capture();
-            return false;
-        }
-
-        binary_snapshot_data.clear();
-
-        snapshot_data.clear();
-
-    #if 0
-        // TODO: This requires too much temp memory!
-        doc.serialize(snapshot_data, true, 0, false);
-
-        dynamic_string snapshot_id(trace_archive.add_buf_compute_unique_id(snapshot_data.get_ptr(), snapshot_data.size(), "state_snapshot", VOGL_TEXT_JSON_EXTENSION));
-        if (snapshot_id.is_empty())
-        {
-            vogl_error_printf("%s: Failed adding binary GL snapshot file to output blob manager!\n", VOGL_FUNCTION_INFO_CSTR);
-            get_vogl_trace_writer().deinit();
-            return false;
-        }
-    #endif
-
         key_value_map snapshot_key_value_map;
         snapshot_key_value_map.insert("command_type", "state_snapshot");
-        snapshot_key_value_map.insert("binary_id", binary_snapshot_id);
-
-    #if 0
-        // TODO: This requires too much temp memory!
-        snapshot_key_value_map.insert("id", snapshot_id);
-    #endif
+        snapshot_key_value_map.insert(pSnapshot_id_key, snapshot_id);
 
         vogl_ctypes &trace_gl_ctypes = get_vogl_process_gl_ctypes();
         if (!vogl_write_glInternalTraceCommandRAD(get_vogl_trace_writer().get_stream(), &trace_gl_ctypes, cITCRKeyValueMap, sizeof(snapshot_key_value_map), reinterpret_cast<const GLubyte *>(&snapshot_key_value_map)))
@@ -6493,16 +6726,11 @@ static void vogl_check_for_capture_trigger_file()
             return false;
         }
 
-        doc.clear(false);
-
-        if (g_pJSON_node_pool)
-        {
-            uint64_t total_bytes_freed = static_cast<uint64_t>(g_pJSON_node_pool->free_unused_blocks());
-            vogl_debug_printf("%s: Freed %" PRIu64 " bytes from the JSON object pool (%" PRIu64 " bytes remaining)\n", VOGL_FUNCTION_INFO_CSTR, total_bytes_freed, static_cast<uint64_t>(g_pJSON_node_pool->get_total_heap_bytes()));
-        }
-
         vogl_message_printf("%s: Snapshot complete\n", VOGL_FUNCTION_INFO_CSTR);
 
+        if (get_vogl_trace_writer().is_async_writer_enabled())
+            get_vogl_trace_writer().start_async_writer();
+
         return true;
     }
 
@@ -7068,6 +7296,153 @@ static bool vogl_uses_client_side_arrays(vogl_context *pContext, bool indexed)
     return false;
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_scan_index_range
+//----------------------------------------------------------------------------------------------------------------------
+#if defined(__SSE4_1__)
+static inline uint vogl_hmin_epu32(__m128i v)
+{
+    v = _mm_min_epu32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_min_epu32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return static_cast<uint>(_mm_cvtsi128_si32(v));
+}
+
+static inline uint vogl_hmax_epu32(__m128i v)
+{
+    v = _mm_max_epu32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_max_epu32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return static_cast<uint>(_mm_cvtsi128_si32(v));
+}
+#endif
+
+// Finds the min/max index of count indices, 16 bytes at a time where possible.
+static void vogl_scan_index_range(const void *pIndices, GLsizei count, GLenum type, uint &start, uint &end)
+{
+    uint lo = cUINT32_MAX, hi = 0;
+    GLsizei i = 0;
+
+#if defined(__SSE4_1__)
+    const uint8 *pBytes = static_cast<const uint8 *>(pIndices);
+
+    if (type == GL_UNSIGNED_BYTE)
+    {
+        __m128i vlo = _mm_set1_epi8(-1), vhi = _mm_setzero_si128();
+        for (; (i + 16) <= count; i += 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pBytes + i));
+            vlo = _mm_min_epu8(vlo, v);
+            vhi = _mm_max_epu8(vhi, v);
+        }
+        if (i)
+        {
+            // Widen to 16-bit lanes and let phminposuw do the horizontal min, max is the min of the complement.
+            __m128i zero = _mm_setzero_si128();
+            __m128i l = _mm_min_epu16(_mm_unpacklo_epi8(vlo, zero), _mm_unpackhi_epi8(vlo, zero));
+            __m128i h = _mm_max_epu16(_mm_unpacklo_epi8(vhi, zero), _mm_unpackhi_epi8(vhi, zero));
+            lo = _mm_cvtsi128_si32(_mm_minpos_epu16(l)) & 0xFFFF;
+            hi = 0xFFFF - (_mm_cvtsi128_si32(_mm_minpos_epu16(_mm_xor_si128(h, _mm_set1_epi16(-1)))) & 0xFFFF);
+        }
+    }
+    else if (type == GL_UNSIGNED_SHORT)
+    {
+        __m128i vlo = _mm_set1_epi16(-1), vhi = _mm_setzero_si128();
+        for (; (i + 8) <= count; i += 8)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pBytes + i * sizeof(uint16)));
+            vlo = _mm_min_epu16(vlo, v);
+            vhi = _mm_max_epu16(vhi, v);
+        }
+        if (i)
+        {
+            lo = _mm_cvtsi128_si32(_mm_minpos_epu16(vlo)) & 0xFFFF;
+            hi = 0xFFFF - (_mm_cvtsi128_si32(_mm_minpos_epu16(_mm_xor_si128(vhi, _mm_set1_epi16(-1)))) & 0xFFFF);
+        }
+    }
+    else if (type == GL_UNSIGNED_INT)
+    {
+        __m128i vlo = _mm_set1_epi32(-1), vhi = _mm_setzero_si128();
+        for (; (i + 4) <= count; i += 4)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pBytes + i * sizeof(uint32)));
+            vlo = _mm_min_epu32(vlo, v);
+            vhi = _mm_max_epu32(vhi, v);
+        }
+        if (i)
+        {
+            lo = vogl_hmin_epu32(vlo);
+            hi = vogl_hmax_epu32(vhi);
+        }
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        uint v = 0;
+
+        if (type == GL_UNSIGNED_BYTE)
+            v = static_cast<const uint8 *>(pIndices)[i];
+        else if (type == GL_UNSIGNED_SHORT)
+            v = static_cast<const uint16 *>(pIndices)[i];
+        else if (type == GL_UNSIGNED_INT)
+            v = static_cast<const uint32 *>(pIndices)[i];
+        else
+        {
+            VOGL_ASSERT_ALWAYS;
+        }
+
+        lo = math::minimum(lo, v);
+        hi = math::maximum(hi, v);
+    }
+
+    start = lo;
+    end = hi;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_get_shadowed_index_range
+// Returns false if the index range must be found by reading the element array buffer back from GL.
+//----------------------------------------------------------------------------------------------------------------------
+static bool vogl_get_shadowed_index_range(vogl_context *pContext, GLuint buffer, GLintptr ofs, GLsizei count, GLenum type, uint index_size, uint &start, uint &end)
+{
+    vogl_scoped_context_shadow_lock lock;
+
+    gl_buffer_desc &buf_desc = pContext->get_or_create_buffer_desc(buffer);
+    if ((buf_desc.m_shadow_disabled) || (buf_desc.m_pMap))
+        return false;
+
+    if (!buf_desc.m_shadow_valid)
+    {
+        // First client side array draw sourcing its indices from this buffer: read it back once and keep it in sync from here on.
+        GLint64 actual_buf_size = 0;
+        GL_ENTRYPOINT(glGetBufferParameteri64v)(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &actual_buf_size);
+        if ((actual_buf_size <= 0) || (static_cast<uint64_t>(actual_buf_size) > cVoglMaxShadowedIndexBufferSize))
+            return false;
+
+        buf_desc.m_size = actual_buf_size;
+        buf_desc.m_shadow.resize(static_cast<uint>(actual_buf_size));
+        GL_ENTRYPOINT(glGetBufferSubData)(GL_ELEMENT_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(actual_buf_size), buf_desc.m_shadow.get_ptr());
+
+        buf_desc.m_shadow_valid = true;
+        buf_desc.m_shadow_generation++;
+    }
+
+    if ((ofs < 0) || ((static_cast<uint64_t>(ofs) + static_cast<uint64_t>(count) * index_size) > buf_desc.m_shadow.size()))
+        return false;
+
+    const gl_buffer_desc::index_range *pRange = buf_desc.find_index_range(ofs, count, type);
+    if (pRange)
+    {
+        start = pRange->m_start;
+        end = pRange->m_end;
+        return true;
+    }
+
+    vogl_scan_index_range(buf_desc.m_shadow.get_ptr() + ofs, count, type, start, end);
+    buf_desc.add_index_range(ofs, count, type, start, end);
+
+    return true;
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 // vogl_serialize_client_side_arrays_helper
 //----------------------------------------------------------------------------------------------------------------------
@@ -7206,40 +7581,19 @@ static void vogl_serialize_client_side_arrays_helper(
     {
         if (!start_end_valid)
         {
-            uint total_index_data_size = count * index_size;
-
-            // FIXME: Move index_data array to context state
-            vogl::vector<uint8> index_data;
-            const uint8 *pIndices_to_scan = static_cast<const uint8 *>(indices);
-
-            if (element_array_buffer)
+            if (!element_array_buffer)
             {
-                index_data.resize(total_index_data_size);
-                pIndices_to_scan = index_data.get_ptr();
-
-                GL_ENTRYPOINT(glGetBufferSubData)(GL_ELEMENT_ARRAY_BUFFER, (GLintptr)indices, total_index_data_size, index_data.get_ptr());
+                vogl_scan_index_range(indices, count, type, start, end);
             }
-
-            start = cUINT32_MAX;
-            end = 0;
-
-            for (int i = 0; i < count; i++)
+            else if (!vogl_get_shadowed_index_range(pContext, element_array_buffer, (GLintptr)indices, count, type, index_size, start, end))
             {
-                uint v = 0;
-
-                if (type == GL_UNSIGNED_BYTE)
-                    v = pIndices_to_scan[i];
-                else if (type == GL_UNSIGNED_SHORT)
-                    v = reinterpret_cast<const uint16 *>(pIndices_to_scan)[i];
-                else if (type == GL_UNSIGNED_INT)
-                    v = reinterpret_cast<const uint32 *>(pIndices_to_scan)[i];
-                else
-                {
-                    VOGL_ASSERT_ALWAYS;
-                }
+                uint total_index_data_size = count * index_size;
 
-                start = math::minimum(start, v);
-                end = math::maximum(end, v);
+                // FIXME: Move index_data array to context state
+                vogl::vector<uint8> index_data(total_index_data_size);
+                GL_ENTRYPOINT(glGetBufferSubData)(GL_ELEMENT_ARRAY_BUFFER, (GLintptr)indices, total_index_data_size, index_data.get_ptr());
+
+                vogl_scan_index_range(index_data.get_ptr(), count, type, start, end);
             }
         }
 
@@ -7566,6 +7920,26 @@ static inline void vogl_named_buffer_data_ext_helper(vogl_context *pContext, vog
     buf_desc.m_map_access = 0;
     buf_desc.m_map_range = 0;
     buf_desc.m_flushed_ranges.resize(0);
+
+    buf_desc.m_map_snapshot.clear();
+    buf_desc.m_map_sparse = false;
+
+    buf_desc.m_defined_blocks.resize(0);
+    if ((g_sparse_buffer_maps) && (data))
+        buf_desc.set_blocks_defined(0, size);
+
+    if (buf_desc.m_shadow_valid)
+    {
+        if ((size < 0) || (static_cast<uint64_t>(size) > cVoglMaxShadowedIndexBufferSize))
+        {
+            buf_desc.invalidate_shadow();
+        }
+        else
+        {
+            buf_desc.m_shadow.resize(static_cast<uint>(size));
+            buf_desc.update_shadow(0, data, size);
+        }
+    }
 }
 
 #define DEF_FUNCTION_CUSTOM_FUNC_EPILOG_glBufferData(exported, category, ret, ret_type_enum, num_params, name, args, params) vogl_buffer_data_helper(pContext, trace_serializer, target, size, data, usage);
@@ -7591,9 +7965,7 @@ static inline void vogl_buffer_data_helper(vogl_context *pContext, vogl_entrypoi
 #define DEF_FUNCTION_CUSTOM_FUNC_EPILOG_glNamedBufferSubDataEXT(exported, category, ret, ret_type_enum, num_params, name, args, params) vogl_named_buffer_subdata_ext_helper(pContext, trace_serializer, buffer, offset, size, data);
 static inline void vogl_named_buffer_subdata_ext_helper(vogl_context *pContext, vogl_entrypoint_serializer &trace_serializer, GLuint buffer, GLintptr offset, GLsizeiptr size, const GLvoid *data)
 {
-    VOGL_NOTE_UNUSED(buffer);
     VOGL_NOTE_UNUSED(trace_serializer);
-    VOGL_NOTE_UNUSED(pContext);
 
     if (g_dump_gl_buffers_flag)
     {
@@ -7601,6 +7973,18 @@ static inline void vogl_named_buffer_subdata_ext_helper(vogl_context *pContext,
         vogl_print_hex(data, size, 1);
         vogl_log_printf("\n");
     }
+
+    if (pContext)
+    {
+        gl_buffer_desc &buf_desc = pContext->get_or_create_buffer_desc(buffer);
+        if (data)
+            buf_desc.update_shadow(offset, data, size);
+        else
+            buf_desc.invalidate_shadow();
+
+        if ((g_sparse_buffer_maps) && (data))
+            buf_desc.set_blocks_defined(offset, size);
+    }
 }
 
 #define DEF_FUNCTION_CUSTOM_FUNC_EPILOG_glBufferSubData(exported, category, ret, ret_type_enum, num_params, name, args, params) vogl_buffer_subdata_helper(pContext, trace_serializer, target, offset, size, data);
@@ -7622,17 +8006,94 @@ static inline void vogl_buffer_subdata_helper(vogl_context *pContext, vogl_entry
     vogl_named_buffer_subdata_ext_helper(pContext, trace_serializer, buffer, offset, size, data);
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_snapshot_sparse_map
+//----------------------------------------------------------------------------------------------------------------------
+static inline void vogl_snapshot_sparse_map(gl_buffer_desc &buf_desc, bool sparse_map)
+{
+    buf_desc.m_map_snapshot.clear();
+    buf_desc.m_map_sparse = false;
+
+    if ((!sparse_map) || (!buf_desc.m_map_readable) || (buf_desc.m_map_size <= 0))
+        return;
+
+    if (static_cast<uint64_t>(buf_desc.m_map_size) > cUINT32_MAX)
+    {
+        vogl_warning_printf("%s: Mapping of buffer 0x%08X is too large to snapshot, the entire mapping will be serialized\n", VOGL_FUNCTION_INFO_CSTR, buf_desc.m_handle);
+        return;
+    }
+
+    buf_desc.m_map_snapshot.append(static_cast<const uint8_t *>(buf_desc.m_pMap), static_cast<uint>(buf_desc.m_map_size));
+    buf_desc.m_map_sparse = true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+// vogl_serialize_sparse_map_ranges
+// Serializes the runs of blocks within the given map relative ranges that changed since the map's snapshot, or whose
+// contents can't be relied on during replay.
+//----------------------------------------------------------------------------------------------------------------------
+static void vogl_serialize_sparse_map_ranges(vogl_entrypoint_serializer &trace_serializer, gl_buffer_desc &buf_desc, const vogl::vector<gl_buffer_desc::flushed_range> &ranges)
+{
+    const uint8_t *pMap = static_cast<const uint8_t *>(buf_desc.m_pMap);
+    const uint8_t *pSnapshot = buf_desc.m_map_snapshot.get_ptr();
+
+    vogl::vector<gl_buffer_desc::flushed_range> runs;
+    uint64_t total_run_bytes = 0;
+
+    for (uint i = 0; i < ranges.size(); i++)
+    {
+        int64_t ofs = math::clamp<int64_t>(ranges[i].m_ofs, 0, buf_desc.m_map_size);
+        int64_t end = math::clamp<int64_t>(ranges[i].m_ofs + ranges[i].m_size, 0, buf_desc.m_map_size);
+        int64_t range_ofs = ofs;
+
+        while (ofs < end)
+        {
+            int64_t block = (buf_desc.m_map_ofs + ofs) / cVoglSparseMapBlockSize;
+            int64_t seg_end = math::minimum<int64_t>(end, (block + 1) * cVoglSparseMapBlockSize - buf_desc.m_map_ofs);
+            int64_t seg_size = seg_end - ofs;
+
+            if ((!buf_desc.is_block_defined(block)) || (memcmp(pMap + ofs, pSnapshot + ofs, static_cast<size_t>(seg_size)) != 0))
+            {
+                if ((runs.size()) && ((runs.back().m_ofs + runs.back().m_size) == ofs))
+                    runs.back().m_size += seg_size;
+                else
+                    runs.push_back(gl_buffer_desc::flushed_range(ofs, seg_size));
+
+                total_run_bytes += seg_size;
+            }
+
+            ofs = seg_end;
+        }
+
+        // Whatever replay ends up with in this range now matches the capture.
+        buf_desc.set_blocks_defined(buf_desc.m_map_ofs + range_ofs, end - range_ofs);
+    }
+
+    trace_serializer.add_key_value(string_hash("sparse_ranges"), runs.size());
+    trace_serializer.add_key_value(string_hash("sparse_bytes"), total_run_bytes);
+
+    for (uint i = 0; i < runs.size(); i++)
+    {
+        int key_index = i * 4;
+        trace_serializer.add_key_value(key_index, runs[i].m_ofs);
+        trace_serializer.add_key_value(key_index + 1, runs[i].m_size);
+        trace_serializer.add_key_value_blob(key_index + 2, pMap + runs[i].m_ofs, static_cast<uint>(runs[i].m_size));
+    }
+}
+
 #define DEF_FUNCTION_CUSTOM_GL_PROLOG_glMapBuffer(exported, category, ret, ret_type_enum, num_params, name, args, params) \
     GLenum orig_access = access;                                                                                          \
-    vogl_map_buffer_gl_prolog_helper(pContext, trace_serializer, target, access);
+    bool sparse_map = vogl_map_buffer_gl_prolog_helper(pContext, trace_serializer, target, access);
 #define DEF_FUNCTION_CUSTOM_GL_PROLOG_glMapBufferARB(exported, category, ret, ret_type_enum, num_params, name, args, params) \
     GLenum orig_access = access;                                                                                             \
-    vogl_map_buffer_gl_prolog_helper(pContext, trace_serializer, target, access);
-static inline void vogl_map_buffer_gl_prolog_helper(vogl_context *pContext, vogl_entrypoint_serializer &trace_serializer, GLenum target, GLenum &access)
+    bool sparse_map = vogl_map_buffer_gl_prolog_helper(pContext, trace_serializer, target, access);
+static inline bool vogl_map_buffer_gl_prolog_helper(vogl_context *pContext, vogl_entrypoint_serializer &trace_serializer, GLenum target, GLenum &access)
 {
     VOGL_NOTE_UNUSED(target);
     VOGL_NOTE_UNUSED(pContext);
 
+    bool sparse_map = false;
+
     if (trace_serializer.is_in_begin() || g_dump_gl_buffers_flag)
     {
         if (access == GL_WRITE_ONLY)
@@ -7640,11 +8101,19 @@ static inline void vogl_map_buffer_gl_prolog_helper(vogl_context *pContext, vogl
             access = GL_READ_WRITE;
         }
     }
+
+    if ((g_sparse_buffer_maps) && (trace_serializer.is_in_begin()) && (access != GL_READ_ONLY))
+    {
+        trace_serializer.add_key_value(string_hash("sparse_map"), true);
+        sparse_map = true;
+    }
+
+    return sparse_map;
 }
 
-#define DEF_FUNCTION_CUSTOM_GL_EPILOG_glMapBuffer(exported, category, ret, ret_type_enum, num_params, name, args, params) vogl_map_buffer_gl_epilog_helper(pContext, target, orig_access, result);
-#define DEF_FUNCTION_CUSTOM_GL_EPILOG_glMapBufferARB(exported, category, ret, ret_type_enum, num_params, name, args, params) vogl_map_buffer_gl_epilog_helper(pContext, target, orig_access, result);
-static inline void vogl_map_buffer_gl_epilog_helper(vogl_context *pContext, GLenum target, GLenum access, GLvoid *pPtr)
+#define DEF_FUNCTION_CUSTOM_GL_EPILOG_glMapBuffer(exported, category, ret, ret_type_enum, num_params, name, args, params) vogl_map_buffer_gl_epilog_helper(pContext, target, orig_access, access, sparse_map, result);
+#define DEF_FUNCTION_CUSTOM_GL_EPILOG_glMapBufferARB(exported, category, ret, ret_type_enum, num_params, name, args, params) vogl_map_buffer_gl_epilog_helper(pContext, target, orig_access, access, sparse_map, result);
+static inline void vogl_map_buffer_gl_epilog_helper(vogl_context *pContext, GLenum target, GLenum access, GLenum actual_access, bool sparse_map, GLvoid *pPtr)
 {
     if (!pContext)
         return;
@@ -7682,18 +8151,23 @@ static inline void vogl_map_buffer_gl_epilog_helper(vogl_context *pContext, GLen
     buf_desc.m_map_size = actual_buf_size;
     buf_desc.m_map_access = access;
     buf_desc.m_map_range = false;
+    buf_desc.m_map_readable = (actual_access != GL_WRITE_ONLY);
+
+    vogl_snapshot_sparse_map(buf_desc, sparse_map);
 }
 
 #define DEF_FUNCTION_CUSTOM_GL_PROLOG_glMapBufferRange(exported, category, ret, ret_type_enum, num_params, name, args, params) \
     GLbitfield orig_access = access;                                                                                           \
-    vogl_map_buffer_range_gl_prolog_helper(pContext, trace_serializer, target, offset, length, access);
-static inline void vogl_map_buffer_range_gl_prolog_helper(vogl_context *pContext, vogl_entrypoint_serializer &trace_serializer, GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield &access)
+    bool sparse_map = vogl_map_buffer_range_gl_prolog_helper(pContext, trace_serializer, target, offset, length, access);
+static inline bool vogl_map_buffer_range_gl_prolog_helper(vogl_context *pContext, vogl_entrypoint_serializer &trace_serializer, GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield &access)
 {
     VOGL_NOTE_UNUSED(length);
     VOGL_NOTE_UNUSED(offset);
     VOGL_NOTE_UNUSED(target);
     VOGL_NOTE_UNUSED(pContext);
 
+    bool sparse_map = false;
+
     if (trace_serializer.is_in_begin() || g_dump_gl_buffers_flag)
     {
         if (access & GL_MAP_WRITE_BIT)
@@ -7706,10 +8180,19 @@ static inline void vogl_map_buffer_range_gl_prolog_helper(vogl_context *pContext
             access |= GL_MAP_READ_BIT;
         }
     }
+
+    if ((g_sparse_buffer_maps) && (trace_serializer.is_in_begin()) && (access & GL_MAP_WRITE_BIT))
+    {
+        // Tells the replayer to drop the invalidate bits too, so the blocks we don't serialize keep their contents.
+        trace_serializer.add_key_value(string_hash("sparse_map"), true);
+        sparse_map = true;
+    }
+
+    return sparse_map;
 }
 
-#define DEF_FUNCTION_CUSTOM_GL_EPILOG_glMapBufferRange(exported, category, ret, ret_type_enum, num_params, name, args, params) vogl_map_buffer_range_gl_epilog_helper(pContext, target, offset, length, orig_access, result);
-static inline void vogl_map_buffer_range_gl_epilog_helper(vogl_context *pContext, GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield &access, GLvoid *pPtr)
+#define DEF_FUNCTION_CUSTOM_GL_EPILOG_glMapBufferRange(exported, category, ret, ret_type_enum, num_params, name, args, params) vogl_map_buffer_range_gl_epilog_helper(pContext, target, offset, length, orig_access, access, sparse_map, result);
+static inline void vogl_map_buffer_range_gl_epilog_helper(vogl_context *pContext, GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield &access, GLbitfield actual_access, bool sparse_map, GLvoid *pPtr)
 {
     if (!pContext)
         return;
@@ -7752,6 +8235,9 @@ static inline void vogl_map_buffer_range_gl_epilog_helper(vogl_context *pContext
     buf_desc.m_map_size = length;
     buf_desc.m_map_access = access;
     buf_desc.m_map_range = true;
+    buf_desc.m_map_readable = (actual_access & GL_MAP_READ_BIT) != 0;
+
+    vogl_snapshot_sparse_map(buf_desc, sparse_map);
 }
 
 #define DEF_FUNCTION_CUSTOM_FUNC_EPILOG_glFlushMappedBufferRange(exported, category, ret, ret_type_enum, num_params, name, args, params) vogl_flush_mapped_buffer_range(pContext, target, offset, length);
@@ -7850,8 +8336,18 @@ static inline void vogl_unmap_buffer_helper(vogl_context *pContext, vogl_entrypo
                 }
             }
 
-            if (trace_serializer.is_in_begin())
+            if ((trace_serializer.is_in_begin()) && (buf_desc.m_map_sparse))
             {
+                vogl_serialize_sparse_map_ranges(trace_serializer, buf_desc, buf_desc.m_flushed_ranges);
+            }
+            else if (trace_serializer.is_in_begin())
+            {
+                if (g_sparse_buffer_maps)
+                {
+                    for (uint i = 0; i < buf_desc.m_flushed_ranges.size(); i++)
+                        buf_desc.set_blocks_defined(buf_desc.m_map_ofs + buf_desc.m_flushed_ranges[i].m_ofs, buf_desc.m_flushed_ranges[i].m_size);
+                }
+
                 trace_serializer.add_key_value(string_hash("flushed_ranges"), buf_desc.m_flushed_ranges.size());
                 for (uint i = 0; i < buf_desc.m_flushed_ranges.size(); i++)
                 {
@@ -7863,6 +8359,19 @@ static inline void vogl_unmap_buffer_helper(vogl_context *pContext, vogl_entrypo
                     trace_serializer.add_key_value_blob(key_index + 2, static_cast<const uint8_t *>(buf_desc.m_pMap) + buf_desc.m_flushed_ranges[i].m_ofs, static_cast<uint>(buf_desc.m_flushed_ranges[i].m_size));
                 }
             }
+
+            if (buf_desc.m_shadow_valid)
+            {
+                if (!buf_desc.m_map_readable)
+                    buf_desc.invalidate_shadow();
+
+                for (uint i = 0; (i < buf_desc.m_flushed_ranges.size()) && (buf_desc.m_shadow_valid); i++)
+                {
+                    buf_desc.update_shadow(buf_desc.m_map_ofs + buf_desc.m_flushed_ranges[i].m_ofs,
+                                           static_cast<const uint8_t *>(buf_desc.m_pMap) + buf_desc.m_flushed_ranges[i].m_ofs,
+                                           buf_desc.m_flushed_ranges[i].m_size);
+                }
+            }
         }
         else
         {
@@ -7873,14 +8382,32 @@ static inline void vogl_unmap_buffer_helper(vogl_context *pContext, vogl_entrypo
                 vogl_log_printf("\n");
             }
 
-            if (trace_serializer.is_in_begin())
+            if ((trace_serializer.is_in_begin()) && (buf_desc.m_map_sparse))
             {
+                vogl::vector<gl_buffer_desc::flushed_range> whole_map(1);
+                whole_map[0] = gl_buffer_desc::flushed_range(0, buf_desc.m_map_size);
+
+                vogl_serialize_sparse_map_ranges(trace_serializer, buf_desc, whole_map);
+            }
+            else if (trace_serializer.is_in_begin())
+            {
+                if (g_sparse_buffer_maps)
+                    buf_desc.set_blocks_defined(buf_desc.m_map_ofs, buf_desc.m_map_size);
+
                 trace_serializer.add_key_value(0, buf_desc.m_map_ofs);
                 trace_serializer.add_key_value(1, buf_desc.m_map_size);
                 // TODO
                 VOGL_ASSERT(buf_desc.m_map_size <= cUINT32_MAX);
                 trace_serializer.add_key_value_blob(2, static_cast<const uint8_t *>(buf_desc.m_pMap), static_cast<uint>(buf_desc.m_map_size));
             }
+
+            if (buf_desc.m_shadow_valid)
+            {
+                if (buf_desc.m_map_readable)
+                    buf_desc.update_shadow(buf_desc.m_map_ofs, buf_desc.m_pMap, buf_desc.m_map_size);
+                else
+                    buf_desc.invalidate_shadow();
+            }
         }
     }
 
@@ -7888,9 +8415,39 @@ static inline void vogl_unmap_buffer_helper(vogl_context *pContext, vogl_entrypo
     buf_desc.m_map_ofs = 0;
     buf_desc.m_map_size = 0;
     buf_desc.m_map_access = 0;
+    buf_desc.m_map_readable = false;
     buf_desc.m_flushed_ranges.resize(0);
+    buf_desc.m_map_snapshot.clear();
+    buf_desc.m_map_sparse = false;
 }
 
+//----------------------------------------------------------------------------------------------------------------------
+// Buffer writes the tracer can't shadow
+//----------------------------------------------------------------------------------------------------------------------
+#define DEF_FUNCTION_CUSTOM_FUNC_EPILOG_glCopyBufferSubData(exported, category, ret, ret_type_enum, num_params, name, args, params) vogl_invalidate_bound_buffer_shadow(pContext, writeTarget);
+#define DEF_FUNCTION_CUSTOM_FUNC_EPILOG_glClearBufferData(exported, category, ret, ret_type_enum, num_params, name, args, params) vogl_invalidate_bound_buffer_shadow(pContext, target);
+#define DEF_FUNCTION_CUSTOM_FUNC_EPILOG_glClearBufferSubData(exported, category, ret, ret_type_enum, num_params, name, args, params) vogl_invalidate_bound_buffer_shadow(pContext, target);
+static inline void vogl_invalidate_bound_buffer_shadow(vogl_context *pContext, GLenum target)
+{
+    if (!pContext)
+        return;
+
+    vogl_scoped_gl_error_absorber gl_error_absorber(pContext);
+    VOGL_NOTE_UNUSED(gl_error_absorber);
+
+    pContext->invalidate_buffer_shadow(vogl_get_bound_gl_buffer(target));
+}
+
+#define DEF_FUNCTION_CUSTOM_FUNC_EPILOG_glNamedCopyBufferSubDataEXT(exported, category, ret, ret_type_enum, num_params, name, args, params) \
+    if (pContext)                                                                                                                          \
+        pContext->invalidate_buffer_shadow(writeBuffer);
+#define DEF_FUNCTION_CUSTOM_FUNC_EPILOG_glClearNamedBufferDataEXT(exported, category, ret, ret_type_enum, num_params, name, args, params) \
+    if (pContext)                                                                                                                        \
+        pContext->invalidate_buffer_shadow(buffer);
+#define DEF_FUNCTION_CUSTOM_FUNC_EPILOG_glClearNamedBufferSubDataEXT(exported, category, ret, ret_type_enum, num_params, name, args, params) \
+    if (pContext)                                                                                                                           \
+        pContext->invalidate_buffer_shadow(buffer);
+
 //----------------------------------------------------------------------------------------------------------------------
 // glCreateProgram/glCreateProgramARB function epilog
 //----------------------------------------------------------------------------------------------------------------------